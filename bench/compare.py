@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+"""Keep per-variant benchmark baselines and check new runs against them.
+
+Usage:
+  bench/compare.py save  BASELINE_DIR RUN_DIR
+  bench/compare.py check BASELINE_DIR RUN_DIR [--threshold 0.05] [--alpha 0.05]
+
+RUN_DIR holds one google-benchmark JSON file per variant, as
+bench/run_all.sh writes them to <output dir>/json/. BASELINE_DIR holds one
+history file per variant, <variant>.json, whose "history" list gets one
+entry per `save`: the date, the machine context and, for every benchmark
+(operation/workload/size), the cpu_time of each repetition.
+
+`check` compares every benchmark of RUN_DIR with the latest saved entry of
+its variant. A benchmark regressed when its median cpu_time grew by more
+than --threshold (default 5%) and, with at least 4 repetitions on both
+sides, a two-sided Mann-Whitney U test says the samples differ at level
+--alpha. With fewer repetitions the threshold alone decides, marked "n/a"
+in the p column; run with BENCH_REPETITIONS=10 or so for a real test.
+Prints a table of every change beyond the threshold and exits 1 if any
+benchmark regressed, 0 otherwise.
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import datetime
+import json
+import math
+import os
+import sys
+
+
+def load_run(path):
+    """Return {benchmark name: [cpu_time per repetition]} and the unit and
+    context of one google-benchmark JSON file. Aggregate rows (mean,
+    median, stddev) and skipped benchmarks are left out."""
+    with open(path) as f:
+        data = json.load(f)
+    samples, units = {}, {}
+    for b in data.get("benchmarks", []):
+        if b.get("run_type", "iteration") != "iteration":
+            continue
+        if b.get("error_occurred"):
+            continue
+        name = b.get("run_name", b["name"])
+        samples.setdefault(name, []).append(float(b["cpu_time"]))
+        units[name] = b.get("time_unit", "ns")
+    return samples, units, data.get("context", {})
+
+
+def variant_files(run_dir):
+    """Return (variant, path) for every JSON run file in run_dir."""
+    for entry in sorted(os.listdir(run_dir)):
+        if entry.endswith(".json"):
+            yield entry[:-len(".json")], os.path.join(run_dir, entry)
+
+
+def median(xs):
+    s = sorted(xs)
+    n = len(s)
+    return s[n // 2] if n % 2 else (s[n // 2 - 1] + s[n // 2]) / 2
+
+
+def mann_whitney_p(a, b):
+    """Two-sided p-value of the Mann-Whitney U test of samples a and
+    b: exact for small samples without ties, else the normal
+    approximation with tie correction."""
+    n, m = len(a), len(b)
+    pooled = sorted([(x, 0) for x in a] + [(x, 1) for x in b])
+    ranks = [0.0] * len(pooled)
+    ties = 0.0
+    i = 0
+    while i < len(pooled):
+        j = i
+        while j + 1 < len(pooled) and pooled[j + 1][0] == pooled[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2 + 1
+        t = j - i + 1
+        ties += t ** 3 - t
+        i = j + 1
+    r1 = sum(r for r, (_, side) in zip(ranks, pooled) if side == 0)
+    u = r1 - n * (n + 1) / 2
+    u = min(u, n * m - u)
+
+    if ties == 0 and n * m <= 400:
+        # count[k] = number of orderings of the pooled sample with U == k
+        count = [[[0] * (i * j + 1) for j in range(m + 1)] for i in range(n + 1)]
+        for i in range(n + 1):
+            for j in range(m + 1):
+                if i == 0 or j == 0:
+                    count[i][j][0] = 1
+                    continue
+                for k in range(i * j + 1):
+                    c = count[i - 1][j][k - j] if k >= j else 0
+                    if k <= (i * (j - 1)):
+                        c += count[i][j - 1][k]
+                    count[i][j][k] = c
+        total = math.comb(n + m, n)
+        tail = sum(count[n][m][:int(u) + 1]) / total
+        return min(1.0, 2 * tail)
+
+    mean = n * m / 2
+    var = n * m / 12 * ((n + m + 1) - ties / ((n + m) * (n + m - 1)))
+    if var <= 0:
+        return 1.0
+    z = (u - mean + 0.5) / math.sqrt(var)   # continuity correction
+    return min(1.0, math.erfc(abs(z) / math.sqrt(2)))
+
+
+def save(baseline_dir, run_dir):
+    os.makedirs(baseline_dir, exist_ok=True)
+    date = datetime.datetime.now().isoformat(timespec="seconds")
+    for variant, path in variant_files(run_dir):
+        samples, units, context = load_run(path)
+        if not samples:
+            continue
+        history_path = os.path.join(baseline_dir, variant + ".json")
+        history = {"variant": variant, "history": []}
+        if os.path.exists(history_path):
+            with open(history_path) as f:
+                history = json.load(f)
+        history["history"].append({
+            "date": date,
+            "context": context,
+            "benchmarks": {name: {"time_unit": units[name], "cpu_time": xs}
+                           for name, xs in sorted(samples.items())},
+        })
+        with open(history_path, "w") as f:
+            json.dump(history, f, indent=1)
+            f.write("\n")
+        print("saved %s: %d benchmarks" % (variant, len(samples)))
+    return 0
+
+
+def check(baseline_dir, run_dir, threshold, alpha):
+    rows, regressions, compared = [], 0, 0
+    for variant, path in variant_files(run_dir):
+        history_path = os.path.join(baseline_dir, variant + ".json")
+        if not os.path.exists(history_path):
+            print("no baseline for %s" % variant)
+            continue
+        with open(history_path) as f:
+            history = json.load(f)["history"]
+        if not history:
+            continue
+        base = history[-1]["benchmarks"]
+        samples, units, _ = load_run(path)
+        for name, new in sorted(samples.items()):
+            if name not in base:
+                continue
+            old = base[name]["cpu_time"]
+            compared += 1
+            change = median(new) / median(old) - 1 if median(old) > 0 else 0
+            if min(len(old), len(new)) >= 4:
+                p = mann_whitney_p(old, new)
+                significant = p < alpha
+                p_text = "%.3f" % p
+            else:
+                significant = True
+                p_text = "n/a"
+            if abs(change) <= threshold or not significant:
+                continue
+            verdict = "SLOWER" if change > 0 else "faster"
+            regressions += change > 0
+            rows.append((variant, name, "%.4g %s" % (median(old), units[name]),
+                         "%.4g %s" % (median(new), units[name]),
+                         "%+.1f%%" % (100 * change), p_text, verdict))
+
+    header = ("variant", "benchmark", "baseline", "new", "change", "p",
+              "verdict")
+    if rows:
+        widths = [max(len(r[i]) for r in rows + [header])
+                  for i in range(len(header))]
+        for r in [header] + rows:
+            print("  ".join(c.ljust(w) for c, w in zip(r, widths)).rstrip())
+    print("%d benchmarks compared, %d changed by more than %.0f%%, "
+          "%d slower" % (compared, len(rows), 100 * threshold, regressions))
+    return 1 if regressions else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Save or check per-variant benchmark baselines.")
+    parser.add_argument("mode", choices=["save", "check"])
+    parser.add_argument("baseline_dir")
+    parser.add_argument("run_dir")
+    parser.add_argument("--threshold", type=float, default=0.05,
+                        help="relative change of the median that counts "
+                             "(default 0.05)")
+    parser.add_argument("--alpha", type=float, default=0.05,
+                        help="significance level of the Mann-Whitney test "
+                             "(default 0.05)")
+    args = parser.parse_args()
+    if args.mode == "save":
+        return save(args.baseline_dir, args.run_dir)
+    return check(args.baseline_dir, args.run_dir, args.threshold, args.alpha)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,105 @@
+#!/bin/sh
+# Differential validation: replay the same random operation stream against
+# a reference Graph.hpp and every optimized storage mode, and report the
+# first operation where a mode answers differently.
+#
+# Usage: bench/diff_all.sh [CME212 include dir] [output dir]
+#
+# The include dir is as for bench/run_all.sh. Each mode is built from
+# bench/graph_replay.cpp; see that file for the stream and what is
+# compared. $DIFF_SEEDS lists the seeds to replay (default "1 2 3"),
+# $DIFF_OPS the operations per stream (default 20000). Modes are the lines
+# of $DIFF_MODES, each "header|graph type|extra compiler flags|replay
+# flags"; the first line is the reference. The default list covers the
+# storage policies of Graph-5038 and the compressed, batched and checked
+# modes of Graph-24726. To validate a mode of a variant that differs from
+# the reference in its own right, make its default mode the first line,
+# e.g. for segmented storage:
+#
+#   DIFF_MODES='hw1/Graph-16706.hpp|Graph<int>||
+#   hw1/Graph-16706.hpp|Graph<int>|-DCME212_SEGMENTED_STORAGE=1|' \
+#       bench/diff_all.sh
+#
+# Exits 1 if any mode diverged or failed to build, 0 otherwise. Outputs of
+# a diverged run are kept in the output dir (default: diff_out).
+set -u
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+INCLUDE=${1:-${CME212_INCLUDE:-$ROOT}}
+OUT=${2:-diff_out}
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O1 -g}
+SEEDS=${DIFF_SEEDS:-1 2 3}
+OPS=${DIFF_OPS:-20000}
+
+DEFAULT_MODES='hw1/Graph-5038.hpp|Graph<int>||
+hw1/Graph-5038.hpp|Graph<int, sorted_adjacency>||
+hw1/Graph-5038.hpp|Graph<int, hash_adjacency>||
+hw1/Graph-5038.hpp|Graph<int, dense_adjacency>||
+hw1/Graph-24726.hpp|Graph<int>||
+hw1/Graph-24726.hpp|Graph<int>||--freeze
+hw1/Graph-24726.hpp|Graph<int>||--batched
+hw1/Graph-24726.hpp|Graph<int>|-DCME212_CHECKED_ACCESS=1|--freeze --batched'
+MODES=${DIFF_MODES:-$DEFAULT_MODES}
+
+mkdir -p "$OUT/bin"
+status=0
+reference=
+k=0
+
+# Read the modes on file descriptor 3 so the loop body keeps stdin.
+echo "$MODES" > "$OUT/modes.txt"
+while IFS='|' read -r header type cflags rflags <&3; do
+  [ -z "$header" ] && continue
+  k=$((k + 1))
+  label="$header $type${cflags:+ $cflags}${rflags:+ $rflags}"
+  bin="$OUT/bin/mode$k"
+  # shellcheck disable=SC2086
+  if ! $CXX $CXXFLAGS $cflags -std=c++17 -I"$ROOT" -I"$INCLUDE" \
+       -DGRAPH_HEADER="\"$header\"" -DGRAPH_TYPE="$type" \
+       "$ROOT/bench/graph_replay.cpp" -lpthread -o "$bin" \
+       2> "$bin.log"; then
+    echo "FAIL  $label (does not compile, see $bin.log)"
+    status=1
+    continue
+  fi
+
+  diverged=
+  for seed in $SEEDS; do
+    # shellcheck disable=SC2086
+    "$bin" --seed "$seed" --ops "$OPS" $rflags > "$bin.$seed.out"
+    code=$?
+    if [ $code -ne 0 ]; then
+      diverged="exit status $code on seed $seed"
+      break
+    fi
+    if [ -z "$reference" ]; then
+      continue
+    fi
+    if ! cmp -s "$reference.$seed.out" "$bin.$seed.out"; then
+      line=$(cmp "$reference.$seed.out" "$bin.$seed.out" |
+             sed -n 's/.* line \([0-9]*\).*/\1/p')
+      diverged="seed $seed, output line $line:
+        reference: $(sed -n "${line}p" "$reference.$seed.out")
+        this mode: $(sed -n "${line}p" "$bin.$seed.out")"
+      break
+    fi
+  done
+
+  if [ -z "$reference" ]; then
+    if [ -n "$diverged" ]; then
+      echo "FAIL  reference $label: $diverged"
+      exit 1
+    fi
+    reference=$bin
+    echo "ref   $label"
+  elif [ -n "$diverged" ]; then
+    echo "DIFF  $label: $diverged"
+    status=1
+  else
+    echo "same  $label"
+    rm -f "$bin".*.out
+  fi
+done 3< "$OUT/modes.txt"
+
+exit $status
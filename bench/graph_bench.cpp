@@ -0,0 +1,1144 @@
+/** @file graph_bench.cpp
+ * @brief google-benchmark suite for a single Graph.hpp variant.
+ *
+ * This translation unit is compiled once per header, so every variant gets
+ * its own binary and the identically named Graph classes never meet:
+ *
+ *   g++ -O2 -std=c++17 -I. -I<CME212 include dir> \
+ *       -DGRAPH_HEADER='"hw1/Graph-24726.hpp"' -DGRAPH_TYPE='Graph<int>' \
+ *       bench/graph_bench.cpp -lbenchmark -lpthread -o graph_bench
+ *
+ * hw0 headers define a plain class, so they are built with
+ * -DGRAPH_TYPE=Graph. bench/run_all.sh does this for every header in hw0/
+ * and hw1/ and merges the results into a CSV leaderboard.
+ *
+ * Workloads are 2D grids, uniform random graphs and preferential-attachment
+ * (power-law) graphs. Capabilities a variant lacks (e.g. incident iterators
+ * in hw0) are reported as skipped instead of failing the build. Set
+ * GRAPH_BENCH_MAX_NODES to cap the largest size (default 1e7) when a variant
+ * is too slow to finish the big runs.
+ *
+ * NodeAccess and the traversal benchmarks measure proxy dereferencing. Build
+ * the same header a second time with -DCME212_CHECKED_ACCESS=1 to compare
+ * bounds-checked against unchecked access (see common/checked_access.hpp);
+ * the rows of such a binary are labelled "checked".
+ *
+ * SpringForces compares the mass-spring force sum written against the
+ * proxies ("proxy") with SpringKernel from common/spring_forces.hpp
+ * ("kernel"); add -mavx2 or -march=native to get its SIMD edge pass.
+ * SymplecticStep times one whole mass-spring time step under springs and
+ * gravity, as the proxy loop ("proxy") and as SymplecticEuler from
+ * common/symplectic.hpp ("integrator"); its items are node updates.
+ * HasEdgesBatched answers the queries of HasEdgeHit and HasEdgeMiss with
+ * one Graph::has_edges() call instead of one has_edge() each.
+ * EdgeLengths compares per-edge norms through the proxies ("proxy") with
+ * one Graph::edge_lengths() pass ("batched"); add -fno-math-errno so its
+ * square roots vectorize.
+ * ProxyOverhead runs two reductions, the neighbor position sum of
+ * NeighborPositions and the sum of the edge lengths, three ways: through
+ * the iterators and proxies ("proxy"), through the ranges of nodes(),
+ * edges() and Node::neighbors() ("range"), and over plain position, edge
+ * endpoint and CSR neighbor arrays copied out once ("raw"; a variant with
+ * positions_data() and edge_endpoints_data() lends those two instead).
+ * Each row's "penalty" counter is its time over that of as many raw
+ * passes, so the raw rows read about 1 and the others the abstraction's
+ * cost as a factor.
+ * Generate times building each workload shape with the parallel
+ * generators of common/graph_generators.hpp (a grid, Erdos-Renyi and
+ * R-MAT); its items are edges.
+ *
+ * Set GRAPH_BENCH_PERF=1 to also count hardware events over each timed
+ * loop with common/perf_counters.hpp. Every row then gets the cycles,
+ * instructions, branch mispredictions and L1D, LLC and dTLB read misses
+ * per item, so per edge or per node operation as above, and the IPC, as
+ * extra columns. Events the machine does not expose read NaN. Only the
+ * benchmark thread is counted, so the threaded Generate rows undercount.
+ *
+ * Build with -DGRAPH_BENCH_MEMORY=1 for the memory footprint instead of
+ * the speed benchmarks. Global operator new and delete then count every
+ * heap block and its usable size, and Memory/<shape> builds the graph
+ * once per size from 1e4 nodes up, reporting per row:
+ *   bytes_per_node, bytes_per_edge    heap growth of adding the nodes, then
+ *                                     the edges, over their counts
+ *   allocs_per_node, allocs_per_edge  allocations made by the same steps
+ *   steady_bytes, peak_bytes          heap in use once built, and the most
+ *                                     in use at any point while building
+ *   leaked_bytes                      heap still in use after destruction
+ * All figures are relative to the heap in use before the build, and count
+ * what the graph holds, not the edge list the workload reads from.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#ifndef GRAPH_HEADER
+#error "Define GRAPH_HEADER, e.g. -DGRAPH_HEADER='\"hw1/Graph-24726.hpp\"'"
+#endif
+#include GRAPH_HEADER
+#include "common/csr_snapshot.hpp"
+#include "common/graph_generators.hpp"
+#include "common/perf_counters.hpp"
+#include "common/spring_forces.hpp"
+#include "common/symplectic.hpp"
+
+#ifndef GRAPH_TYPE
+#define GRAPH_TYPE Graph<int>
+#endif
+
+#ifndef GRAPH_BENCH_MEMORY
+#define GRAPH_BENCH_MEMORY 0
+#endif
+
+#if GRAPH_BENCH_MEMORY
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+
+//
+// Heap accounting: replacements of the global allocation functions
+//
+
+namespace heap {
+
+std::atomic<std::int64_t> live(0);       // bytes in use
+std::atomic<std::int64_t> peak(0);       // most bytes in use since reset_peak()
+std::atomic<std::uint64_t> allocations(0);
+
+void on_alloc(void* p) {
+  std::int64_t n = std::int64_t(malloc_usable_size(p));
+  std::int64_t now = live.fetch_add(n, std::memory_order_relaxed) + n;
+  std::int64_t top = peak.load(std::memory_order_relaxed);
+  while (now > top &&
+         !peak.compare_exchange_weak(top, now, std::memory_order_relaxed)) {
+  }
+  allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void on_free(void* p) {
+  if (p)
+    live.fetch_sub(std::int64_t(malloc_usable_size(p)),
+                   std::memory_order_relaxed);
+}
+
+void reset_peak() {
+  peak.store(live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void* allocate(std::size_t n) {
+  void* p = std::malloc(n ? n : 1);
+  if (!p)
+    throw std::bad_alloc();
+  on_alloc(p);
+  return p;
+}
+
+void* allocate(std::size_t n, std::align_val_t a) {
+  std::size_t align = std::max(std::size_t(a), sizeof(void*));
+  void* p = nullptr;
+  if (::posix_memalign(&p, align, n ? n : 1) != 0)
+    throw std::bad_alloc();
+  on_alloc(p);
+  return p;
+}
+
+void release(void* p) {
+  on_free(p);
+  std::free(p);
+}
+
+} // end namespace heap
+
+void* operator new(std::size_t n) { return heap::allocate(n); }
+void* operator new[](std::size_t n) { return heap::allocate(n); }
+void* operator new(std::size_t n, std::align_val_t a) { return heap::allocate(n, a); }
+void* operator new[](std::size_t n, std::align_val_t a) { return heap::allocate(n, a); }
+void operator delete(void* p) noexcept { heap::release(p); }
+void operator delete[](void* p) noexcept { heap::release(p); }
+void operator delete(void* p, std::size_t) noexcept { heap::release(p); }
+void operator delete[](void* p, std::size_t) noexcept { heap::release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { heap::release(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { heap::release(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { heap::release(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { heap::release(p); }
+#endif
+
+namespace {
+
+using graph_type = GRAPH_TYPE;
+using edge_list = std::vector<std::pair<unsigned, unsigned>>;
+
+//
+// Capability detection
+//
+
+template <typename G, typename = void>
+struct has_edge_iterator : std::false_type {};
+template <typename G>
+struct has_edge_iterator<G, std::void_t<
+    decltype(std::declval<const G&>().edge_begin() !=
+             std::declval<const G&>().edge_end())>> : std::true_type {};
+
+template <typename G, typename = void>
+struct has_incident_iterator : std::false_type {};
+template <typename G>
+struct has_incident_iterator<G, std::void_t<
+    decltype(std::declval<const G&>().node(0).edge_begin() !=
+             std::declval<const G&>().node(0).edge_end())>> : std::true_type {};
+
+template <typename G, typename = void>
+struct has_node_value : std::false_type {};
+template <typename G>
+struct has_node_value<G, std::void_t<
+    decltype(std::declval<const G&>().node(0).value())>> : std::true_type {};
+
+template <typename G, typename = void>
+struct has_mutable_position : std::false_type {};
+template <typename G>
+struct has_mutable_position<G, std::void_t<
+    decltype(std::declval<G&>().node(0).position() = Point())>>
+    : std::true_type {};
+
+/** Callback that ignores its edge, for detection only. */
+struct edge_sink {
+  template <typename E>
+  void operator()(const E&) const {
+  }
+};
+
+template <typename G, typename = void>
+struct has_for_each_neighbor : std::false_type {};
+template <typename G>
+struct has_for_each_neighbor<G, std::void_t<
+    decltype(std::declval<const G&>().for_each_neighbor(
+        std::declval<const G&>().node(0), edge_sink()))>> : std::true_type {};
+
+template <typename G, typename = void>
+struct has_batched_has_edge : std::false_type {};
+template <typename G>
+struct has_batched_has_edge<G, std::void_t<
+    decltype(std::declval<const G&>().has_edges(
+        std::declval<const std::pair<unsigned, unsigned>*>(), 0,
+        std::declval<bool*>()))>> : std::true_type {};
+
+template <typename G, typename = void>
+struct has_edge_lengths : std::false_type {};
+template <typename G>
+struct has_edge_lengths<G, std::void_t<
+    decltype(std::declval<const G&>().edge_lengths(
+        std::declval<double*>()))>> : std::true_type {};
+
+#if defined(CME212_CHECKED_ACCESS) && CME212_CHECKED_ACCESS
+constexpr const char* access_label = "checked";
+#else
+constexpr const char* access_label = "";
+#endif
+
+//
+// Hardware counters
+//
+
+/** Counters of the benchmark thread, set in main() when GRAPH_BENCH_PERF
+ * is set. */
+PerfCounters* perf = nullptr;
+
+/** Hardware events of one benchmark's timed loop. Make it just before the
+ * loop, pause() and resume() it instead of the state's timer, and end with
+ * finish() instead of SetItemsProcessed(). */
+class counted {
+ public:
+  counted() {
+    if (perf) {
+      perf->reset();
+      perf->start();
+    }
+  }
+
+  void pause(benchmark::State& state) {
+    state.PauseTiming();
+    if (perf)
+      perf->stop();
+  }
+
+  void resume(benchmark::State& state) {
+    if (perf)
+      perf->start();
+    state.ResumeTiming();
+  }
+
+  /** Set the items processed to @a items and, when counting, add every
+   * event per item and the instructions per cycle as user counters. Events
+   * the machine lacks are reported as NaN so every row has the same
+   * columns. */
+  void finish(benchmark::State& state, std::int64_t items) {
+    state.SetItemsProcessed(items);
+    if (!perf)
+      return;
+    perf->stop();
+    perf_sample s = perf->read();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (std::size_t i = 0; i < perf_event_count; ++i) {
+      perf_event e = perf_event(i);
+      state.counters[std::string(perf_event_name(e)) + "/item"] =
+          s.has(e) && items > 0 ? s[e] / double(items) : nan;
+    }
+    state.counters["IPC"] = s.ipc() > 0 ? s.ipc() : nan;
+  }
+};
+
+//
+// Workloads
+//
+
+enum class shape { grid, random, power_law };
+
+const char* shape_name(shape s) {
+  switch (s) {
+    case shape::grid:      return "grid";
+    case shape::random:    return "random";
+    case shape::power_law: return "power_law";
+  }
+  return "?";
+}
+
+/** Edges of a 4-neighbor grid with about @a n nodes. */
+edge_list make_grid(unsigned n) {
+  unsigned side = std::max(1u, unsigned(std::sqrt(double(n))));
+  edge_list edges;
+  edges.reserve(2 * std::size_t(n));
+  for (unsigned i = 0; i < n; ++i) {
+    if ((i + 1) % side != 0 && i + 1 < n)
+      edges.emplace_back(i, i + 1);
+    if (i + side < n)
+      edges.emplace_back(i, i + side);
+  }
+  return edges;
+}
+
+/** Edges of a uniform random graph on @a n nodes with average degree 8. */
+edge_list make_random(unsigned n) {
+  std::mt19937 gen(212);
+  std::uniform_int_distribution<unsigned> pick(0, n - 1);
+  edge_list edges;
+  edges.reserve(4 * std::size_t(n));
+  while (edges.size() < 4 * std::size_t(n)) {
+    unsigned a = pick(gen), b = pick(gen);
+    if (a != b)
+      edges.emplace_back(a, b);
+  }
+  return edges;
+}
+
+/** Edges of a preferential-attachment graph: node i links to 4 earlier
+ * nodes chosen proportionally to their degree, giving a power-law tail. */
+edge_list make_power_law(unsigned n) {
+  std::mt19937 gen(212);
+  edge_list edges;
+  std::vector<unsigned> ends;  // every edge endpoint, for degree sampling
+  edges.reserve(4 * std::size_t(n));
+  ends.reserve(8 * std::size_t(n));
+  for (unsigned i = 1; i < n; ++i) {
+    for (unsigned k = 0; k < std::min(i, 4u); ++k) {
+      unsigned j = ends.empty() ? 0 : ends[gen() % ends.size()];
+      if (j == i)
+        j = gen() % i;
+      edges.emplace_back(i, j);
+      ends.push_back(i);
+      ends.push_back(j);
+    }
+  }
+  return edges;
+}
+
+/** Return the cached edge list for (@a s, @a n). */
+const edge_list& workload(shape s, unsigned n) {
+  static std::map<std::pair<int, unsigned>, edge_list> cache;
+  auto key = std::make_pair(int(s), n);
+  auto it = cache.find(key);
+  if (it == cache.end()) {
+    edge_list edges = s == shape::grid   ? make_grid(n)
+                    : s == shape::random ? make_random(n)
+                                         : make_power_law(n);
+    it = cache.emplace(key, std::move(edges)).first;
+  }
+  return it->second;
+}
+
+/** Return @a edges followed by @a dup_percent % of its entries again, half
+ * of them reversed, in shuffled order. */
+edge_list with_duplicates(const edge_list& edges, unsigned dup_percent) {
+  std::mt19937 gen(48);
+  edge_list out(edges);
+  std::size_t extra = edges.size() * dup_percent / 100;
+  for (std::size_t i = 0; i < extra; ++i) {
+    auto e = edges[gen() % edges.size()];
+    if (i % 2)
+      std::swap(e.first, e.second);
+    out.push_back(e);
+  }
+  std::shuffle(out.begin(), out.end(), gen);
+  return out;
+}
+
+void add_nodes(graph_type& g, unsigned n) {
+  for (unsigned i = 0; i < n; ++i)
+    g.add_node(Point(i, 0, 0));
+}
+
+void add_all(graph_type& g, const edge_list& edges) {
+  for (const auto& e : edges)
+    g.add_edge(g.node(e.first), g.node(e.second));
+}
+
+//
+// Benchmarks
+//
+
+void BM_AddNode(benchmark::State& state) {
+  unsigned n = unsigned(state.range(0));
+  counted perf_scope;
+  for (auto _ : state) {
+    graph_type g;
+    add_nodes(g, n);
+    benchmark::DoNotOptimize(g.size());
+  }
+  perf_scope.finish(state, state.iterations() * n);
+}
+
+void BM_AddEdge(benchmark::State& state, shape s, unsigned dup_percent) {
+  unsigned n = unsigned(state.range(0));
+  edge_list edges = with_duplicates(workload(s, n), dup_percent);
+  counted perf_scope;
+  for (auto _ : state) {
+    perf_scope.pause(state);
+    {
+      graph_type g;
+      add_nodes(g, n);
+      perf_scope.resume(state);
+      add_all(g, edges);
+      benchmark::DoNotOptimize(g.num_edges());
+      perf_scope.pause(state);
+    }
+    perf_scope.resume(state);
+  }
+  perf_scope.finish(state, state.iterations() * edges.size());
+}
+
+/** Number of has_edge() queries per iteration. */
+constexpr unsigned queries = 1u << 14;
+
+/** Answer every query in @a probes, one has_edge() at a time or, when
+ * @a batched is set, with one has_edges() call. */
+template <typename G>
+unsigned count_edges(G& g, const edge_list& probes, bool batched,
+                     std::vector<char>& out) {
+  if constexpr (has_batched_has_edge<G>::value) {
+    if (batched)
+      return unsigned(g.has_edges(probes.data(), probes.size(),
+                                  reinterpret_cast<bool*>(out.data())));
+  }
+  unsigned found = 0;
+  for (const auto& p : probes)
+    found += g.has_edge(g.node(p.first), g.node(p.second));
+  return found;
+}
+
+void BM_HasEdge(benchmark::State& state, shape s, bool hit, bool batched) {
+  if (batched && !has_batched_has_edge<graph_type>::value) {
+    state.SkipWithError("no has_edges()");
+    for (auto _ : state) {
+    }
+    return;
+  }
+  unsigned n = unsigned(state.range(0));
+  const edge_list& edges = workload(s, n);
+  graph_type g;
+  add_nodes(g, n);
+  add_all(g, edges);
+
+  std::mt19937 gen(7);
+  edge_list probes;
+  probes.reserve(queries);
+  while (probes.size() < queries) {
+    if (hit) {
+      probes.push_back(edges[gen() % edges.size()]);
+    } else {
+      unsigned a = gen() % n, b = gen() % n;
+      if (a != b && !g.has_edge(g.node(a), g.node(b)))
+        probes.emplace_back(a, b);
+    }
+  }
+
+  std::vector<char> out(probes.size());
+  counted perf_scope;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(count_edges(g, probes, batched, out));
+  perf_scope.finish(state, state.iterations() * queries);
+}
+
+/** Visit every edge once, through edge_begin()..edge_end() when the variant
+ * has an edge iterator and through edge(i) otherwise. */
+template <typename G>
+std::uint64_t walk_edges(const G& g) {
+  std::uint64_t sum = 0;
+  if constexpr (has_edge_iterator<G>::value) {
+    for (auto it = g.edge_begin(); it != g.edge_end(); ++it)
+      sum += (*it).node1().index();
+  } else {
+    for (unsigned i = 0; i < g.num_edges(); ++i)
+      sum += g.edge(i).node1().index();
+  }
+  return sum;
+}
+
+/** Visit every incident edge of every node. */
+template <typename G>
+std::uint64_t walk_incident(const G& g) {
+  std::uint64_t sum = 0;
+  if constexpr (has_incident_iterator<G>::value) {
+    for (unsigned i = 0; i < g.size(); ++i) {
+      auto node = g.node(i);
+      for (auto it = node.edge_begin(); it != node.edge_end(); ++it)
+        sum += (*it).node2().index();
+    }
+  }
+  return sum;
+}
+
+/** Read the position, and the value when there is one, of every node.
+ * Nodes are visited in a random order so the bounds checks cannot be
+ * hoisted out of a sequential loop. */
+template <typename G>
+double read_nodes(const G& g, const std::vector<unsigned>& order) {
+  double sum = 0;
+  for (unsigned i : order) {
+    auto node = g.node(i);
+    sum += node.position().x;
+    if constexpr (has_node_value<G>::value)
+      sum += double(node.value());
+  }
+  return sum;
+}
+
+void BM_NodeAccess(benchmark::State& state) {
+  unsigned n = unsigned(state.range(0));
+  graph_type g;
+  add_nodes(g, n);
+  std::vector<unsigned> order(n);
+  for (unsigned i = 0; i < n; ++i)
+    order[i] = i;
+  std::shuffle(order.begin(), order.end(), std::mt19937(3));
+
+  counted perf_scope;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(read_nodes(g, order));
+  state.SetLabel(access_label);
+  perf_scope.finish(state, state.iterations() * n);
+}
+
+void BM_EdgeIteration(benchmark::State& state, shape s) {
+  unsigned n = unsigned(state.range(0));
+  graph_type g;
+  add_nodes(g, n);
+  add_all(g, workload(s, n));
+
+  counted perf_scope;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(walk_edges(g));
+  if (!has_edge_iterator<graph_type>::value)
+    state.SetLabel("edge(i) fallback");
+  else
+    state.SetLabel(access_label);
+  perf_scope.finish(state, state.iterations() * g.num_edges());
+}
+
+void BM_IncidentTraversal(benchmark::State& state, shape s) {
+  if (!has_incident_iterator<graph_type>::value) {
+    state.SkipWithError("no incident iterator");
+    for (auto _ : state) {
+    }
+    return;
+  }
+  unsigned n = unsigned(state.range(0));
+  graph_type g;
+  add_nodes(g, n);
+  add_all(g, workload(s, n));
+
+  counted perf_scope;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(walk_incident(g));
+  state.SetLabel(access_label);
+  perf_scope.finish(state, state.iterations() * 2 * g.num_edges());
+}
+
+/** Sum the neighbor positions of every node, through the incident
+ * iterators or, when @a distance is set, for_each_neighbor() prefetching
+ * that far ahead. */
+template <typename G>
+double sum_neighbor_positions(const G& g, unsigned distance) {
+  double sum = 0;
+  if constexpr (has_for_each_neighbor<G>::value) {
+    if (distance != 0) {
+      for (unsigned i = 0; i < g.size(); ++i) {
+        g.for_each_neighbor(g.node(i), [&](const typename G::edge_type& e) {
+          sum += e.node2().position().x;
+        }, distance);
+      }
+      return sum;
+    }
+  }
+  if constexpr (has_incident_iterator<G>::value) {
+    for (unsigned i = 0; i < g.size(); ++i) {
+      auto node = g.node(i);
+      for (auto it = node.edge_begin(); it != node.edge_end(); ++it)
+        sum += (*it).node2().position().x;
+    }
+  }
+  return sum;
+}
+
+void BM_NeighborPositions(benchmark::State& state, shape s, unsigned distance) {
+  if (!has_incident_iterator<graph_type>::value ||
+      (distance != 0 && !has_for_each_neighbor<graph_type>::value)) {
+    state.SkipWithError("no incident traversal of this kind");
+    for (auto _ : state) {
+    }
+    return;
+  }
+  unsigned n = unsigned(state.range(0));
+  graph_type g;
+  add_nodes(g, n);
+  add_all(g, workload(s, n));
+
+  counted perf_scope;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(sum_neighbor_positions(g, distance));
+  perf_scope.finish(state, state.iterations() * 2 * g.num_edges());
+}
+
+/** Add @a n nodes on a jittered square lattice, so springs have varied
+ * lengths. */
+void add_lattice_nodes(graph_type& g, unsigned n) {
+  unsigned side = std::max(1u, unsigned(std::sqrt(double(n))));
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<double> jitter(-0.25, 0.25);
+  for (unsigned i = 0; i < n; ++i)
+    g.add_node(Point(i % side + jitter(gen), i / side + jitter(gen), 0));
+}
+
+/** Spring forces the way the mass-spring step writes them: every node sums
+ * Hooke's law over its incident edges through the proxies. */
+template <typename G>
+void proxy_forces(const G& g, double K, double L, std::vector<Point>& force) {
+  if constexpr (has_incident_iterator<G>::value) {
+    for (unsigned i = 0; i < g.size(); ++i) {
+      auto node = g.node(i);
+      Point f(0, 0, 0);
+      for (auto it = node.edge_begin(); it != node.edge_end(); ++it) {
+        Point d = (*it).node2().position() - node.position();
+        double len = norm(d);
+        if (len > 0)
+          f += K * (len - L) / len * d;
+      }
+      force[i] = f;
+    }
+  }
+}
+
+void BM_SpringForces(benchmark::State& state, shape s, bool kernel) {
+  if constexpr (!has_incident_iterator<graph_type>::value) {
+    state.SkipWithError("no incident iterator");
+    for (auto _ : state) {
+    }
+  } else {
+    unsigned n = unsigned(state.range(0));
+    graph_type g;
+    add_lattice_nodes(g, n);
+    add_all(g, workload(s, n));
+    std::vector<Point> force(g.size());
+
+    if (kernel) {
+      SpringKernel<graph_type> springs(g);
+      counted perf_scope;
+      for (auto _ : state) {
+        springs.compute(g, 100.0, 1.0, force.data());
+        benchmark::DoNotOptimize(force.data());
+      }
+      perf_scope.finish(state, state.iterations() * g.num_edges());
+    } else {
+      counted perf_scope;
+      for (auto _ : state) {
+        proxy_forces(g, 100.0, 1.0, force);
+        benchmark::DoNotOptimize(force.data());
+      }
+      perf_scope.finish(state, state.iterations() * g.num_edges());
+    }
+  }
+}
+
+/** Write the length of every edge to @a len, in one edge_lengths() pass
+ * when @a batched is set and through the edge proxies otherwise. */
+template <typename G>
+void edge_lengths(const G& g, bool batched, std::vector<double>& len) {
+  if constexpr (has_edge_lengths<G>::value) {
+    if (batched) {
+      g.edge_lengths(len.data());
+      return;
+    }
+  }
+  if constexpr (has_edge_iterator<G>::value) {
+    unsigned k = 0;
+    for (auto it = g.edge_begin(); it != g.edge_end(); ++it, ++k) {
+      auto e = *it;
+      len[k] = norm(e.node2().position() - e.node1().position());
+    }
+  }
+}
+
+void BM_EdgeLengths(benchmark::State& state, shape s, bool batched) {
+  if (!has_edge_iterator<graph_type>::value ||
+      (batched && !has_edge_lengths<graph_type>::value)) {
+    state.SkipWithError("no edge traversal of this kind");
+    for (auto _ : state) {
+    }
+    return;
+  }
+  unsigned n = unsigned(state.range(0));
+  graph_type g;
+  add_lattice_nodes(g, n);
+  add_all(g, workload(s, n));
+  std::vector<double> len(g.num_edges());
+
+  counted perf_scope;
+  for (auto _ : state) {
+    edge_lengths(g, batched, len);
+    benchmark::DoNotOptimize(len.data());
+  }
+  perf_scope.finish(state, state.iterations() * g.num_edges());
+}
+
+//
+// Abstraction penalty
+//
+
+template <typename G, typename = void>
+struct has_range_views : std::false_type {};
+template <typename G>
+struct has_range_views<G, std::void_t<
+    decltype(std::declval<const G&>().nodes().begin()),
+    decltype(std::declval<const G&>().node(0).neighbors().begin()),
+    decltype(std::declval<const G&>().edges().begin())>> : std::true_type {};
+
+template <typename G, typename = void>
+struct has_exported_arrays : std::false_type {};
+template <typename G>
+struct has_exported_arrays<G, std::void_t<
+    std::enable_if_t<std::is_convertible<
+        decltype(std::declval<const G&>().positions_data()), const Point*>::value>,
+    decltype(*std::declval<const G&>().edge_endpoints_data())>>
+    : std::true_type {};
+
+enum class reduction { neighbor_sum, edge_length };
+enum class access_path { proxy, range, raw };
+
+const char* path_name(access_path p) {
+  switch (p) {
+    case access_path::proxy: return "proxy";
+    case access_path::range: return "range";
+    case access_path::raw:   return "raw";
+  }
+  return "?";
+}
+
+/** The graph as plain arrays: positions, edge endpoints and CSR rows of
+ * neighbor indices. A variant that exports its positions and endpoints
+ * lends them without a copy; the rows are always a snapshot. */
+template <typename G>
+struct raw_arrays {
+  std::vector<Point> own_positions;
+  std::vector<unsigned> own_endpoints;
+  const Point* positions = nullptr;
+  std::size_t num_edges = 0;
+  std::vector<std::size_t> offsets;
+  std::vector<unsigned> neighbors;
+
+  explicit raw_arrays(const G& g) {
+    std::size_t n = std::size_t(g.size());
+    num_edges = std::size_t(g.num_edges());
+    if constexpr (has_exported_arrays<G>::value)
+      positions = g.positions_data();
+    if (!positions) {
+      own_positions.resize(n);
+      for (std::size_t i = 0; i < n; ++i) {
+        const auto node = g.node(unsigned(i));
+        own_positions[i] = node.position();
+      }
+      positions = own_positions.data();
+    }
+    if constexpr (!has_exported_arrays<G>::value &&
+                  has_edge_iterator<G>::value) {
+      own_endpoints.reserve(2 * num_edges);
+      for (auto it = g.edge_begin(); it != g.edge_end(); ++it) {
+        own_endpoints.push_back(unsigned((*it).node1().index()));
+        own_endpoints.push_back(unsigned((*it).node2().index()));
+      }
+    }
+    if constexpr (has_incident_iterator<G>::value) {
+      offsets = csr_snapshot::row_offsets(g, 1);
+      neighbors.resize(offsets.back());
+      csr_snapshot::fill_rows(g, offsets, 1, [&](std::size_t k, const auto& e) {
+        neighbors[k] = unsigned(e.node2().index());
+      });
+    }
+  }
+
+  /** Node index @a k of the edge endpoint array. */
+  unsigned endpoint(const G& g, std::size_t k) const {
+    if constexpr (has_exported_arrays<G>::value)
+      return unsigned(g.edge_endpoints_data()[k]);
+    else
+      return own_endpoints[k];
+  }
+};
+
+/** The neighbor position sum of sum_neighbor_positions(), through the
+ * incident iterators, through g.nodes() and Node::neighbors(), or over
+ * @a raw. */
+template <typename G>
+double neighbor_sum(const G& g, access_path p, const raw_arrays<G>& raw) {
+  double sum = 0;
+  if (p == access_path::raw) {
+    std::size_t n = raw.offsets.size() - 1;
+    for (std::size_t i = 0; i < n; ++i)
+      for (std::size_t k = raw.offsets[i]; k < raw.offsets[i + 1]; ++k)
+        sum += raw.positions[raw.neighbors[k]].x;
+    return sum;
+  }
+  if constexpr (has_range_views<G>::value) {
+    if (p == access_path::range) {
+      for (auto node : g.nodes())
+        for (auto adj : node.neighbors())
+          sum += adj.position().x;
+      return sum;
+    }
+  }
+  return sum_neighbor_positions(g, 0);
+}
+
+/** The sum of every edge length, through the edge iterator, through
+ * g.edges(), or over @a raw. */
+template <typename G>
+double edge_length_sum(const G& g, access_path p, const raw_arrays<G>& raw) {
+  double sum = 0;
+  if (p == access_path::raw) {
+    for (std::size_t k = 0; k < raw.num_edges; ++k)
+      sum += norm(raw.positions[raw.endpoint(g, 2 * k + 1)] -
+                  raw.positions[raw.endpoint(g, 2 * k)]);
+    return sum;
+  }
+  if constexpr (has_range_views<G>::value) {
+    if (p == access_path::range) {
+      for (auto e : g.edges())
+        sum += norm(e.node2().position() - e.node1().position());
+      return sum;
+    }
+  }
+  if constexpr (has_edge_iterator<G>::value) {
+    for (auto it = g.edge_begin(); it != g.edge_end(); ++it) {
+      auto e = *it;
+      sum += norm(e.node2().position() - e.node1().position());
+    }
+  }
+  return sum;
+}
+
+template <typename G>
+double reduce(const G& g, reduction r, access_path p,
+              const raw_arrays<G>& raw) {
+  return r == reduction::neighbor_sum ? neighbor_sum(g, p, raw)
+                                      : edge_length_sum(g, p, raw);
+}
+
+void BM_ProxyOverhead(benchmark::State& state, shape s, reduction r,
+                      access_path p) {
+  bool traversable = r == reduction::neighbor_sum
+                         ? has_incident_iterator<graph_type>::value
+                         : has_edge_iterator<graph_type>::value;
+  if (!traversable ||
+      (p == access_path::range && !has_range_views<graph_type>::value)) {
+    state.SkipWithError("no traversal of this kind");
+    for (auto _ : state) {
+    }
+    return;
+  }
+  unsigned n = unsigned(state.range(0));
+  graph_type g;
+  add_lattice_nodes(g, n);
+  add_all(g, workload(s, n));
+  raw_arrays<graph_type> raw(g);
+
+  using clock = std::chrono::steady_clock;
+  counted perf_scope;
+  auto start = clock::now();
+  for (auto _ : state)
+    benchmark::DoNotOptimize(reduce(g, r, p, raw));
+  double seconds = std::chrono::duration<double>(clock::now() - start).count();
+  std::int64_t items = r == reduction::neighbor_sum ? 2 * g.num_edges()
+                                                    : g.num_edges();
+  perf_scope.finish(state, state.iterations() * items);
+
+  // The same number of passes over the raw arrays, untimed by the library
+  start = clock::now();
+  for (std::int64_t i = 0; i < std::int64_t(state.iterations()); ++i)
+    benchmark::DoNotOptimize(reduce(g, r, access_path::raw, raw));
+  double raw_seconds =
+      std::chrono::duration<double>(clock::now() - start).count();
+  state.counters["penalty"] = raw_seconds > 0 ? seconds / raw_seconds : 0;
+  state.SetLabel(access_label);
+}
+
+/** Body of BM_SymplecticStep, a template so that the branch for the
+ * capabilities G lacks is discarded. */
+template <typename G>
+void symplectic_step(benchmark::State& state, shape s, bool integrator) {
+  if constexpr (!has_incident_iterator<G>::value ||
+                !has_mutable_position<G>::value) {
+    state.SkipWithError("no incident iterator or settable position");
+    for (auto _ : state) {
+    }
+  } else {
+    unsigned n = unsigned(state.range(0));
+    G g;
+    add_lattice_nodes(g, n);
+    add_all(g, workload(s, n));
+    const double dt = 1e-4, K = 100.0, L = 1.0, mass = 1.0;
+    const Point gravity(0, 0, -9.81);
+
+    if (integrator) {
+      SpringKernel<G> springs(g);
+      SymplecticEuler<G> euler(g);
+      auto forces = make_forces(
+          spring_force(springs, g, K, L),
+          node_force([&](std::size_t, const Point&, const Point&) {
+            return mass * gravity;
+          }));
+      counted perf_scope;
+      for (auto _ : state) {
+        euler.step(dt, forces);
+        benchmark::DoNotOptimize(euler.velocities());
+      }
+      perf_scope.finish(state, state.iterations() * g.size());
+    } else {
+      // The usual hand-written loop, with velocities kept beside the graph
+      // since G's node values are ints
+      std::vector<Point> vel(g.size(), Point(0, 0, 0));
+      std::vector<Point> force(g.size());
+      counted perf_scope;
+      for (auto _ : state) {
+        for (unsigned i = 0; i < g.size(); ++i)
+          g.node(i).position() += vel[i] * dt;
+        proxy_forces(g, K, L, force);
+        for (unsigned i = 0; i < g.size(); ++i)
+          vel[i] += (force[i] + mass * gravity) * (dt / mass);
+        benchmark::DoNotOptimize(vel.data());
+      }
+      perf_scope.finish(state, state.iterations() * g.size());
+    }
+  }
+}
+
+void BM_SymplecticStep(benchmark::State& state, shape s, bool integrator) {
+  symplectic_step<graph_type>(state, s, integrator);
+}
+
+void BM_Generate(benchmark::State& state, shape s) {
+  unsigned n = unsigned(state.range(0));
+  std::uint64_t edges = 0;
+  counted perf_scope;
+  for (auto _ : state) {
+    graph_type g;
+    generator_report r;
+    if (s == shape::grid) {
+      unsigned side = std::max(1u, unsigned(std::sqrt(double(n))));
+      r = grid_graph(g, side, side);
+    } else if (s == shape::random) {
+      r = erdos_renyi_graph(g, n, 4 * std::uint64_t(n));
+    } else {
+      unsigned scale = unsigned(std::ceil(std::log2(double(n))));
+      r = rmat_graph(g, scale, 4 * std::uint64_t(n));
+    }
+    edges += r.edges;
+    benchmark::DoNotOptimize(g.num_edges());
+  }
+  perf_scope.finish(state, std::int64_t(edges));
+}
+
+#if GRAPH_BENCH_MEMORY
+void BM_Memory(benchmark::State& state, shape s) {
+  unsigned n = unsigned(state.range(0));
+  const edge_list& edges = workload(s, n);
+  std::int64_t node_bytes = 0, edge_bytes = 0, steady = 0, peak = 0, leaked = 0;
+  std::uint64_t node_allocs = 0, edge_allocs = 0, m = 0;
+  for (auto _ : state) {
+    std::int64_t base = heap::live.load();
+    std::uint64_t allocs = heap::allocations.load();
+    heap::reset_peak();
+    {
+      graph_type g;
+      add_nodes(g, n);
+      node_bytes = heap::live.load() - base;
+      node_allocs = heap::allocations.load() - allocs;
+      add_all(g, edges);
+      steady = heap::live.load() - base;
+      edge_bytes = steady - node_bytes;
+      edge_allocs = heap::allocations.load() - allocs - node_allocs;
+      peak = heap::peak.load() - base;
+      m = std::uint64_t(g.num_edges());
+      benchmark::DoNotOptimize(m);
+    }
+    leaked = heap::live.load() - base;
+  }
+  state.counters["bytes_per_node"] = double(node_bytes) / double(n);
+  state.counters["bytes_per_edge"] = m ? double(edge_bytes) / double(m) : 0;
+  state.counters["allocs_per_node"] = double(node_allocs) / double(n);
+  state.counters["allocs_per_edge"] = m ? double(edge_allocs) / double(m) : 0;
+  state.counters["steady_bytes"] = double(steady);
+  state.counters["peak_bytes"] = double(peak);
+  state.counters["leaked_bytes"] = double(leaked);
+  state.SetItemsProcessed(std::int64_t(n + m));
+}
+#endif
+
+/** Register @a fn over sizes 1e3, 1e4, ... up to @a max_nodes. */
+template <typename Fn>
+void register_sizes(const std::string& name, Fn fn, long max_nodes) {
+  auto* b = benchmark::RegisterBenchmark(name.c_str(), fn);
+  for (long n = 1000; n <= max_nodes; n *= 10)
+    b->Arg(n);
+  b->Unit(benchmark::kMillisecond);
+}
+
+void register_all(long max_nodes) {
+#if GRAPH_BENCH_MEMORY
+  // One build per size is exact: the footprint does not vary between runs
+  for (shape s : {shape::grid, shape::random, shape::power_law}) {
+    auto* b = benchmark::RegisterBenchmark(
+        ("Memory/" + std::string(shape_name(s))).c_str(),
+        [=](benchmark::State& st) { BM_Memory(st, s); });
+    for (long n = 10000; n <= max_nodes; n *= 10)
+      b->Arg(n);
+    b->Iterations(1)->Unit(benchmark::kMillisecond);
+  }
+  return;
+#endif
+  register_sizes("AddNode", BM_AddNode, max_nodes);
+  register_sizes("NodeAccess", BM_NodeAccess, max_nodes);
+  for (shape s : {shape::grid, shape::random, shape::power_law}) {
+    std::string tag = shape_name(s);
+    register_sizes("Generate/" + tag,
+                   [=](benchmark::State& st) { BM_Generate(st, s); },
+                   max_nodes);
+    for (unsigned dup : {0u, 25u}) {
+      register_sizes("AddEdge/" + tag + "/dup" + std::to_string(dup),
+                     [=](benchmark::State& st) { BM_AddEdge(st, s, dup); },
+                     max_nodes);
+    }
+    for (bool batched : {false, true}) {
+      std::string kind = batched ? "HasEdgesBatched" : "HasEdge";
+      register_sizes(kind + "Hit/" + tag,
+                     [=](benchmark::State& st) {
+                       BM_HasEdge(st, s, true, batched);
+                     },
+                     max_nodes);
+      register_sizes(kind + "Miss/" + tag,
+                     [=](benchmark::State& st) {
+                       BM_HasEdge(st, s, false, batched);
+                     },
+                     max_nodes);
+    }
+    register_sizes("EdgeIteration/" + tag,
+                   [=](benchmark::State& st) { BM_EdgeIteration(st, s); },
+                   max_nodes);
+    register_sizes("IncidentTraversal/" + tag,
+                   [=](benchmark::State& st) { BM_IncidentTraversal(st, s); },
+                   max_nodes);
+    for (unsigned distance : {0u, 4u, 8u, 16u}) {
+      register_sizes("NeighborPositions/prefetch" + std::to_string(distance) +
+                         "/" + tag,
+                     [=](benchmark::State& st) {
+                       BM_NeighborPositions(st, s, distance);
+                     },
+                     max_nodes);
+    }
+    for (bool kernel : {false, true}) {
+      register_sizes(std::string("SpringForces/") +
+                         (kernel ? "kernel/" : "proxy/") + tag,
+                     [=](benchmark::State& st) { BM_SpringForces(st, s, kernel); },
+                     max_nodes);
+    }
+    for (bool batched : {false, true}) {
+      register_sizes(std::string("EdgeLengths/") +
+                         (batched ? "batched/" : "proxy/") + tag,
+                     [=](benchmark::State& st) { BM_EdgeLengths(st, s, batched); },
+                     max_nodes);
+    }
+    for (reduction r : {reduction::neighbor_sum, reduction::edge_length}) {
+      for (access_path p : {access_path::proxy, access_path::range,
+                            access_path::raw}) {
+        register_sizes(std::string("ProxyOverhead/") +
+                           (r == reduction::neighbor_sum ? "neighbor_sum/"
+                                                         : "edge_length/") +
+                           path_name(p) + "/" + tag,
+                       [=](benchmark::State& st) {
+                         BM_ProxyOverhead(st, s, r, p);
+                       },
+                       max_nodes);
+      }
+    }
+    for (bool integrator : {false, true}) {
+      register_sizes(std::string("SymplecticStep/") +
+                         (integrator ? "integrator/" : "proxy/") + tag,
+                     [=](benchmark::State& st) {
+                       BM_SymplecticStep(st, s, integrator);
+                     },
+                     max_nodes);
+    }
+  }
+}
+
+} // end namespace
+
+int main(int argc, char** argv) {
+  long max_nodes = 10000000;
+  if (const char* env = std::getenv("GRAPH_BENCH_MAX_NODES"))
+    max_nodes = std::atol(env);
+  register_all(max_nodes);
+
+  PerfCounters counters;
+  if (std::getenv("GRAPH_BENCH_PERF")) {
+    if (counters.any())
+      perf = &counters;
+    else
+      std::fprintf(stderr, "GRAPH_BENCH_PERF: %s\n", counters.error().c_str());
+  }
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,352 @@
+/** @file graph_replay.cpp
+ * @brief Replays a random stream of graph operations against one Graph.hpp
+ *        variant and prints every observable result, for differential
+ *        validation of storage modes against a reference implementation.
+ *
+ * Like graph_bench.cpp, this is compiled once per header and mode, so the
+ * identically named Graph classes never meet:
+ *
+ *   g++ -O1 -std=c++17 -I. -I<CME212 include dir> \
+ *       -DGRAPH_HEADER='"hw1/Graph-5038.hpp"' \
+ *       -DGRAPH_TYPE='Graph<int, hash_adjacency>' \
+ *       bench/graph_replay.cpp -lpthread -o replay
+ *   ./replay [--seed S] [--ops N] [--freeze] [--batched] [--dump]
+ *
+ * The stream depends only on the seed and the number of operations: node
+ * additions, edge additions (a quarter of them repeating an earlier pair,
+ * half of those reversed), has_edge() queries that hit and miss, and
+ * checkpoints. Each operation prints one line of what the graph answered:
+ * the index of a new node, whether an added edge came back oriented from
+ * its first argument, has_edge() in both orientations. A checkpoint prints
+ * num_nodes(), num_edges() and digests of the positions, of the edge set
+ * as the edge iterators and edge(i) see it, and of every node's incident
+ * neighbors; --dump prints those lists in full. Everything is independent
+ * of storage order, so two correct variants print the same lines, and the
+ * first differing line names the operation that diverged.
+ *
+ * --freeze calls freeze() before every checkpoint, so queries run on the
+ * compressed rows, and --batched hands runs of edge additions and queries
+ * to add_edges() and has_edges(); a variant without them exits with
+ * status 2. bench/diff_all.sh builds the reference and each mode and
+ * compares their output.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifndef GRAPH_HEADER
+#error "Define GRAPH_HEADER, e.g. -DGRAPH_HEADER='\"hw1/Graph-5038.hpp\"'"
+#endif
+#include GRAPH_HEADER
+
+#ifndef GRAPH_TYPE
+#define GRAPH_TYPE Graph<int>
+#endif
+
+namespace {
+
+using graph_type = GRAPH_TYPE;
+using pair_list = std::vector<std::pair<unsigned, unsigned>>;
+
+//
+// Capability detection
+//
+
+template <typename G, typename = void>
+struct has_freeze : std::false_type {};
+template <typename G>
+struct has_freeze<G, std::void_t<decltype(std::declval<G&>().freeze())>>
+    : std::true_type {};
+
+template <typename G, typename = void>
+struct has_add_edges : std::false_type {};
+template <typename G>
+struct has_add_edges<G, std::void_t<
+    decltype(std::declval<G&>().add_edges(
+        std::declval<pair_list&>().begin(),
+        std::declval<pair_list&>().end()))>> : std::true_type {};
+
+template <typename G, typename = void>
+struct has_batched_has_edge : std::false_type {};
+template <typename G>
+struct has_batched_has_edge<G, std::void_t<
+    decltype(std::declval<const G&>().has_edges(
+        std::declval<const std::pair<unsigned, unsigned>*>(), 0,
+        std::declval<bool*>()))>> : std::true_type {};
+
+template <typename G, typename = void>
+struct has_degree : std::false_type {};
+template <typename G>
+struct has_degree<G, std::void_t<
+    decltype(std::declval<const G&>().node(0).degree())>> : std::true_type {};
+
+struct replay_options {
+  std::uint64_t seed = 212;
+  unsigned ops = 20000;
+  bool freeze = false;
+  bool batched = false;
+  bool dump = false;
+};
+
+//
+// Output
+//
+
+/** FNV-1a over a stream of integers. */
+struct digest {
+  std::uint64_t h = 1469598103934665603ull;
+  void add(std::uint64_t x) {
+    for (int i = 0; i < 8; ++i, x >>= 8) {
+      h ^= x & 0xFF;
+      h *= 1099511628211ull;
+    }
+  }
+};
+
+std::uint64_t bits(double x) {
+  std::uint64_t b;
+  std::memcpy(&b, &x, sizeof(b));
+  return b;
+}
+
+/** Print the state of @a g as the checkpoint line described above. */
+template <typename G>
+void checkpoint(const G& g, const replay_options& opt) {
+  digest positions;
+  for (auto it = g.node_begin(); it != g.node_end(); ++it) {
+    auto n = *it;
+    Point p = n.position();
+    positions.add(n.index());
+    positions.add(bits(p.x));
+    positions.add(bits(p.y));
+    positions.add(bits(p.z));
+  }
+
+  // The edge set, through the edge iterators and through edge(i)
+  pair_list iterated, indexed;
+  for (auto it = g.edge_begin(); it != g.edge_end(); ++it) {
+    unsigned a = unsigned((*it).node1().index());
+    unsigned b = unsigned((*it).node2().index());
+    iterated.emplace_back(std::min(a, b), std::max(a, b));
+  }
+  for (unsigned i = 0; i < g.num_edges(); ++i) {
+    unsigned a = unsigned(g.edge(i).node1().index());
+    unsigned b = unsigned(g.edge(i).node2().index());
+    indexed.emplace_back(std::min(a, b), std::max(a, b));
+  }
+  std::sort(iterated.begin(), iterated.end());
+  std::sort(indexed.begin(), indexed.end());
+  digest edges;
+  for (const auto& e : iterated) {
+    edges.add(e.first);
+    edges.add(e.second);
+  }
+
+  // Incident neighbors of every node, which must start at the node
+  digest incident;
+  unsigned misoriented = 0, bad_degree = 0;
+  std::vector<std::vector<unsigned>> rows(g.num_nodes());
+  for (unsigned i = 0; i < g.num_nodes(); ++i) {
+    auto n = g.node(i);
+    std::vector<unsigned>& row = rows[i];
+    for (auto it = n.edge_begin(); it != n.edge_end(); ++it) {
+      auto e = *it;
+      misoriented += !(e.node1() == n);
+      row.push_back(unsigned(e.node2().index()));
+    }
+    if constexpr (has_degree<G>::value)
+      bad_degree += std::size_t(n.degree()) != row.size();
+    std::sort(row.begin(), row.end());
+    incident.add(row.size());
+    for (unsigned j : row)
+      incident.add(j);
+  }
+
+  std::printf("c %u %u %016llx %016llx %s %016llx %u %u\n",
+              unsigned(g.num_nodes()), unsigned(g.num_edges()),
+              (unsigned long long)positions.h, (unsigned long long)edges.h,
+              iterated == indexed ? "same" : "differ",
+              (unsigned long long)incident.h, misoriented, bad_degree);
+  if (opt.dump) {
+    for (const auto& e : iterated)
+      std::printf("  edge %u %u\n", e.first, e.second);
+    for (unsigned i = 0; i < rows.size(); ++i) {
+      std::printf("  row %u:", i);
+      for (unsigned j : rows[i])
+        std::printf(" %u", j);
+      std::printf("\n");
+    }
+  }
+}
+
+//
+// The operation stream
+//
+
+enum class op_kind { add_node, add_edge, has_edge, checkpoint };
+
+struct op {
+  op_kind kind;
+  unsigned a, b;
+  Point p;
+};
+
+/** Return the stream for @a opt: its draws depend on nothing but the seed,
+ * so every variant replays the same operations. */
+std::vector<op> make_stream(const replay_options& opt) {
+  std::mt19937_64 gen(opt.seed);
+  std::uniform_real_distribution<double> coord(-10, 10);
+  std::vector<op> ops;
+  pair_list added;
+  unsigned nodes = 0;
+  auto pick = [&] { return unsigned(gen() % nodes); };
+  for (unsigned k = 0; k < opt.ops; ++k) {
+    unsigned r = unsigned(gen() % 100);
+    if (nodes < 2 || r < 15) {
+      double x = coord(gen), y = coord(gen), z = coord(gen);
+      ops.push_back({op_kind::add_node, nodes++, 0, Point(x, y, z)});
+    } else if (r < 60) {
+      unsigned a = pick(), b = pick();
+      if (!added.empty() && gen() % 4 == 0) {
+        std::tie(a, b) = added[gen() % added.size()];
+        if (gen() % 2)
+          std::swap(a, b);
+      }
+      if (a == b)
+        continue;
+      added.emplace_back(a, b);
+      ops.push_back({op_kind::add_edge, a, b, Point()});
+    } else if (r < 98) {
+      unsigned a = pick(), b = pick();
+      if (!added.empty() && gen() % 2 == 0)
+        std::tie(a, b) = added[gen() % added.size()];
+      if (a == b)
+        continue;
+      ops.push_back({op_kind::has_edge, a, b, Point()});
+    } else {
+      ops.push_back({op_kind::checkpoint, 0, 0, Point()});
+    }
+  }
+  ops.push_back({op_kind::checkpoint, 0, 0, Point()});
+  return ops;
+}
+
+/** Apply ops[k] and the ops of the same kind after it, one call each or,
+ * in batched mode, one add_edges() or has_edges() call; return the index
+ * of the next op. A template so that the branches for the capabilities G
+ * lacks are discarded. */
+template <typename G>
+std::size_t apply(G& g, const std::vector<op>& ops, std::size_t k,
+                  const replay_options& opt) {
+  const op& o = ops[k];
+  if (o.kind == op_kind::add_node) {
+    auto n = g.add_node(o.p);
+    std::printf("n %u\n", unsigned(n.index()));
+    return k + 1;
+  }
+  if (o.kind == op_kind::checkpoint) {
+    if constexpr (has_freeze<G>::value) {
+      if (opt.freeze)
+        g.freeze();
+    }
+    checkpoint(g, opt);
+    return k + 1;
+  }
+
+  std::size_t end = k + 1;
+  if (opt.batched) {
+    while (end < ops.size() && ops[end].kind == o.kind)
+      ++end;
+  }
+  if (o.kind == op_kind::add_edge) {
+    if constexpr (has_add_edges<G>::value) {
+      if (opt.batched) {
+        pair_list pairs;
+        for (std::size_t i = k; i < end; ++i)
+          pairs.emplace_back(ops[i].a, ops[i].b);
+        g.add_edges(pairs.begin(), pairs.end());
+        // Orientation is not observable through add_edges(); print what an
+        // add_edge() call would have, once the edge is there
+        for (std::size_t i = k; i < end; ++i) {
+          bool there = g.has_edge(g.node(ops[i].a), g.node(ops[i].b));
+          std::printf("e %u %u %s\n", ops[i].a, ops[i].b,
+                      there ? "ok" : "missing");
+        }
+        return end;
+      }
+    }
+    auto e = g.add_edge(g.node(o.a), g.node(o.b));
+    bool oriented = e.node1() == g.node(o.a) && e.node2() == g.node(o.b);
+    std::printf("e %u %u %s\n", o.a, o.b, oriented ? "ok" : "flipped");
+    return k + 1;
+  }
+
+  // has_edge
+  if constexpr (has_batched_has_edge<G>::value) {
+    if (opt.batched) {
+      pair_list queries, reversed;
+      for (std::size_t i = k; i < end; ++i) {
+        queries.emplace_back(ops[i].a, ops[i].b);
+        reversed.emplace_back(ops[i].b, ops[i].a);
+      }
+      std::vector<char> fwd(queries.size()), bwd(queries.size());
+      g.has_edges(queries.data(), queries.size(),
+                  reinterpret_cast<bool*>(fwd.data()));
+      g.has_edges(reversed.data(), reversed.size(),
+                  reinterpret_cast<bool*>(bwd.data()));
+      for (std::size_t i = 0; i < queries.size(); ++i)
+        std::printf("h %u %u %d %d\n", queries[i].first, queries[i].second,
+                    int(fwd[i]), int(bwd[i]));
+      return end;
+    }
+  }
+  std::printf("h %u %u %d %d\n", o.a, o.b,
+              int(g.has_edge(g.node(o.a), g.node(o.b))),
+              int(g.has_edge(g.node(o.b), g.node(o.a))));
+  return k + 1;
+}
+
+} // end namespace
+
+int main(int argc, char** argv) {
+  replay_options opt;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--seed" && i + 1 < argc) {
+      opt.seed = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--ops" && i + 1 < argc) {
+      opt.ops = unsigned(std::strtoul(argv[++i], nullptr, 10));
+    } else if (arg == "--freeze") {
+      opt.freeze = true;
+    } else if (arg == "--batched") {
+      opt.batched = true;
+    } else if (arg == "--dump") {
+      opt.dump = true;
+    } else {
+      std::fprintf(stderr, "usage: %s [--seed S] [--ops N] [--freeze] "
+                           "[--batched] [--dump]\n", argv[0]);
+      return 1;
+    }
+  }
+  if ((opt.freeze && !has_freeze<graph_type>::value) ||
+      (opt.batched && !has_add_edges<graph_type>::value &&
+       !has_batched_has_edge<graph_type>::value)) {
+    std::fprintf(stderr, "mode not supported by this variant\n");
+    return 2;
+  }
+
+  std::vector<op> ops = make_stream(opt);
+  graph_type g;
+  for (std::size_t k = 0; k < ops.size();)
+    k = apply(g, ops, k, opt);
+  return 0;
+}
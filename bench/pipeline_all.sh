@@ -0,0 +1,79 @@
+#!/bin/sh
+# Run the mass-spring pipeline of bench/pipeline_bench.cpp against several
+# Graph.hpp variants and storage modes, and merge their per-phase time and
+# heap breakdowns into one CSV.
+#
+# Usage: bench/pipeline_all.sh [CME212 include dir] [output dir]
+#
+# The include dir is as for bench/run_all.sh. Modes are the lines of
+# $PIPELINE_MODES, each "header|graph type|extra compiler flags|pipeline
+# flags", as in bench/diff_all.sh; the default list runs Graph-24726 as
+# loaded, reordered along a Hilbert curve and frozen, and with both.
+# $PIPELINE_ARGS are passed to every run, e.g. "--side 2048 --steps 5000"
+# for a 4M-node mesh. Each run gets $BENCH_TIMEOUT seconds (default 3600).
+#
+# Outputs, in the output dir (default: pipeline_out):
+#   pipeline.csv  one row per mode: the mode, total_s (the figure to
+#                 track), the peak heap and RSS, then seconds, heap at the
+#                 end and peak heap of each phase
+#   failed.txt    modes that did not compile, crashed or timed out; modes
+#                 a variant does not support are skipped, not failed
+set -u
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+INCLUDE=${1:-${CME212_INCLUDE:-$ROOT}}
+OUT=${2:-pipeline_out}
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2 -DNDEBUG}
+
+DEFAULT_MODES='hw1/Graph-24726.hpp|Graph<int>||
+hw1/Graph-24726.hpp|Graph<int>||--reorder hilbert
+hw1/Graph-24726.hpp|Graph<int>||--freeze
+hw1/Graph-24726.hpp|Graph<int>||--reorder hilbert --freeze'
+MODES=${PIPELINE_MODES:-$DEFAULT_MODES}
+
+mkdir -p "$OUT/bin"
+: > "$OUT/pipeline.csv.tmp"
+: > "$OUT/failed.txt"
+header=
+k=0
+
+# Read the modes on file descriptor 3 so the loop body keeps stdin.
+echo "$MODES" > "$OUT/modes.txt"
+while IFS='|' read -r header_file type cflags pflags <&3; do
+  [ -z "$header_file" ] && continue
+  k=$((k + 1))
+  label="$header_file $type${cflags:+ $cflags}${pflags:+ $pflags}"
+  bin="$OUT/bin/mode$k"
+  # shellcheck disable=SC2086
+  if ! $CXX $CXXFLAGS $cflags -std=c++17 -I"$ROOT" -I"$INCLUDE" \
+       -DGRAPH_HEADER="\"$header_file\"" -DGRAPH_TYPE="$type" \
+       "$ROOT/bench/pipeline_bench.cpp" -lpthread -o "$bin" \
+       2> "$bin.log"; then
+    echo "$label: $(grep -m1 'error' "$bin.log")" >> "$OUT/failed.txt"
+    echo "FAIL  $label (does not compile, see $bin.log)"
+    continue
+  fi
+
+  # shellcheck disable=SC2086
+  timeout "${BENCH_TIMEOUT:-3600}" "$bin" --csv --dir "$OUT" \
+      ${PIPELINE_ARGS:-} $pflags > "$bin.csv" 2> "$bin.err"
+  code=$?
+  if [ $code -eq 2 ]; then
+    echo "skip  $label ($(cat "$bin.err"))"
+    continue
+  elif [ $code -ne 0 ]; then
+    echo "$label: exit status $code" >> "$OUT/failed.txt"
+    echo "FAIL  $label (exit status $code)"
+    continue
+  fi
+  [ -z "$header" ] && header="mode,$(head -n 1 "$bin.csv")"
+  echo "\"$label\",$(tail -n 1 "$bin.csv")" >> "$OUT/pipeline.csv.tmp"
+  echo "ran   $label: $(tail -n 1 "$bin.csv" | cut -d, -f1) s"
+done 3< "$OUT/modes.txt"
+
+{ echo "$header"; cat "$OUT/pipeline.csv.tmp"; } > "$OUT/pipeline.csv"
+rm -f "$OUT/pipeline.csv.tmp" "$OUT/pipeline_grid.nodes" \
+      "$OUT/pipeline_grid.tris" "$OUT/pipeline.ckpt"
+echo "wrote $OUT/pipeline.csv"
+echo "$(wc -l < "$OUT/failed.txt") modes failed, see $OUT/failed.txt"
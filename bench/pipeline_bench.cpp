@@ -0,0 +1,481 @@
+/** @file pipeline_bench.cpp
+ * @brief Macro-benchmark of a whole mass-spring run against one Graph.hpp
+ *        variant: load, build, freeze, simulate and checkpoint, with the
+ *        time and heap of each phase.
+ *
+ * The micro-benchmarks of graph_bench.cpp time each operation on a graph
+ * built for it. A production run strings them together, and what one
+ * phase leaves behind (a heap grown by reallocation during the load, rows
+ * scattered by insertion order, a checkpoint thread competing for cores)
+ * is what the next one runs on. Like graph_bench.cpp this is compiled
+ * once per header and mode:
+ *
+ *   g++ -O2 -DNDEBUG -std=c++17 -I. -I<CME212 include dir> \
+ *       -DGRAPH_HEADER='"hw1/Graph-24726.hpp"' -DGRAPH_TYPE='Graph<int>' \
+ *       bench/pipeline_bench.cpp -lpthread -o pipeline
+ *   ./pipeline [--side N] [--steps S] [--every K] [--reorder ORDER]
+ *              [--freeze] [--threads T] [--dir D] [--mesh PREFIX] [--csv]
+ *
+ * The run is
+ *
+ *   load      load_nodes() of PREFIX.nodes (graph_loader.hpp)
+ *   build     load_triangles() of PREFIX.tris, through add_edges() when
+ *             the variant has it
+ *   freeze    reorder(ORDER) with ORDER one of hilbert, morton or rcm,
+ *             then freeze(), each only if asked for
+ *   setup     the SpringKernel and SymplecticEuler of the run
+ *   simulate  S steps of springs and gravity, with two corners pinned and
+ *             the plane and sphere constraints of hw2
+ *   checkpoint
+ *             CheckpointWriter opening the file and writing the edges, a
+ *             frame every K steps, and close(); 0 turns it off
+ *
+ * Without --mesh, a side x side grid of right triangles over the unit
+ * square (2 (side - 1)^2 triangles) is written to D (default /tmp) first,
+ * untimed. The simulate row does not include the time spent in
+ * CheckpointWriter::write(), which is the checkpoint row's, while the
+ * worker encoding frames on its own thread slows whatever runs beside it.
+ *
+ * Global operator new and delete count the heap as in graph_bench.cpp's
+ * memory mode. Each phase reports its wall time, the heap in use at its
+ * end and the most in use during it, relative to the start of the run.
+ * The last line is the single figure to track, the sum of the phase
+ * times; --csv prints one header and one row instead of the table, for
+ * bench/pipeline_all.sh to merge.
+ *
+ * A variant without incident iterators, settable positions or a trivially
+ * copyable node value, or without reorder() or freeze() when they are
+ * asked for, exits with status 2.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <malloc.h>
+#include <sys/resource.h>
+
+#ifndef GRAPH_HEADER
+#error "Define GRAPH_HEADER, e.g. -DGRAPH_HEADER='\"hw1/Graph-24726.hpp\"'"
+#endif
+#include GRAPH_HEADER
+#include "common/checkpoint.hpp"
+#include "common/graph_loader.hpp"
+#include "common/spring_forces.hpp"
+#include "common/symplectic.hpp"
+
+#ifndef GRAPH_TYPE
+#define GRAPH_TYPE Graph<int>
+#endif
+
+//
+// Heap accounting: replacements of the global allocation functions
+//
+
+namespace heap {
+
+std::atomic<std::int64_t> live(0);       // bytes in use
+std::atomic<std::int64_t> peak(0);       // most bytes in use since reset_peak()
+
+void on_alloc(void* p) {
+  std::int64_t n = std::int64_t(malloc_usable_size(p));
+  std::int64_t now = live.fetch_add(n, std::memory_order_relaxed) + n;
+  std::int64_t top = peak.load(std::memory_order_relaxed);
+  while (now > top &&
+         !peak.compare_exchange_weak(top, now, std::memory_order_relaxed)) {
+  }
+}
+
+void on_free(void* p) {
+  if (p)
+    live.fetch_sub(std::int64_t(malloc_usable_size(p)),
+                   std::memory_order_relaxed);
+}
+
+void reset_peak() {
+  peak.store(live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void* allocate(std::size_t n) {
+  void* p = std::malloc(n ? n : 1);
+  if (!p)
+    throw std::bad_alloc();
+  on_alloc(p);
+  return p;
+}
+
+void* allocate_aligned(std::size_t n, std::size_t align) {
+  void* p = nullptr;
+  if (posix_memalign(&p, std::max(align, sizeof(void*)), n ? n : 1) != 0)
+    throw std::bad_alloc();
+  on_alloc(p);
+  return p;
+}
+
+void release(void* p) {
+  on_free(p);
+  std::free(p);
+}
+
+} // end namespace heap
+
+void* operator new(std::size_t n) {
+  return heap::allocate(n);
+}
+void* operator new[](std::size_t n) {
+  return heap::allocate(n);
+}
+void* operator new(std::size_t n, std::align_val_t a) {
+  return heap::allocate_aligned(n, std::size_t(a));
+}
+void* operator new[](std::size_t n, std::align_val_t a) {
+  return heap::allocate_aligned(n, std::size_t(a));
+}
+void operator delete(void* p) noexcept {
+  heap::release(p);
+}
+void operator delete[](void* p) noexcept {
+  heap::release(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+  heap::release(p);
+}
+void operator delete[](void* p, std::size_t) noexcept {
+  heap::release(p);
+}
+void operator delete(void* p, std::align_val_t) noexcept {
+  heap::release(p);
+}
+void operator delete[](void* p, std::align_val_t) noexcept {
+  heap::release(p);
+}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+  heap::release(p);
+}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+  heap::release(p);
+}
+
+namespace {
+
+using graph_type = GRAPH_TYPE;
+using clock_type = std::chrono::steady_clock;
+
+//
+// Capability detection
+//
+
+template <typename G, typename = void>
+struct has_incident_iterator : std::false_type {};
+template <typename G>
+struct has_incident_iterator<G, std::void_t<
+    decltype(std::declval<const G&>().node(0).edge_begin() !=
+             std::declval<const G&>().node(0).edge_end())>> : std::true_type {};
+
+template <typename G, typename = void>
+struct has_mutable_position : std::false_type {};
+template <typename G>
+struct has_mutable_position<G, std::void_t<
+    decltype(std::declval<G&>().node(0).position() = Point())>>
+    : std::true_type {};
+
+template <typename G, typename = void>
+struct has_checkpoint_values : std::false_type {};
+template <typename G>
+struct has_checkpoint_values<G, std::void_t<typename G::node_value_type>>
+    : std::is_trivially_copyable<typename G::node_value_type> {};
+
+template <typename G, typename = void>
+struct has_freeze : std::false_type {};
+template <typename G>
+struct has_freeze<G, std::void_t<decltype(std::declval<G&>().freeze())>>
+    : std::true_type {};
+
+template <typename G, typename = void>
+struct has_reorder : std::false_type {};
+template <typename G>
+struct has_reorder<G, std::void_t<
+    decltype(std::declval<G&>().reorder(G::Order::RCM))>> : std::true_type {};
+
+template <typename G>
+constexpr bool can_simulate =
+    has_incident_iterator<G>::value && has_mutable_position<G>::value;
+
+struct pipeline_options {
+  unsigned side = 512;
+  unsigned steps = 1000;
+  unsigned every = 100;        // checkpoint interval; 0 for none
+  std::string reorder;         // "", "hilbert", "morton" or "rcm"
+  bool freeze = false;
+  unsigned threads = 0;
+  std::string dir = "/tmp";
+  std::string mesh;            // PREFIX of existing .nodes and .tris files
+  bool csv = false;
+};
+
+/** Time and heap of one phase. */
+struct phase {
+  const char* name;
+  double seconds = 0;
+  std::int64_t live = 0;       // heap in use at the end
+  std::int64_t peak = 0;       // most heap in use during the phase
+};
+
+/** Times one phase from construction to finish(), and records its heap
+ * relative to @a base. */
+class phase_timer {
+ public:
+  phase_timer(phase& p, std::int64_t base)
+      : p_(p), base_(base), start_(clock_type::now()) {
+    heap::reset_peak();
+  }
+  void finish() {
+    p_.seconds += std::chrono::duration<double>(clock_type::now() -
+                                                start_).count();
+    p_.live = heap::live.load() - base_;
+    p_.peak = std::max(p_.peak, heap::peak.load() - base_);
+  }
+
+ private:
+  phase& p_;
+  std::int64_t base_;
+  clock_type::time_point start_;
+};
+
+/** Write the side x side grid mesh as PREFIX.nodes and PREFIX.tris. */
+void write_grid_mesh(const std::string& prefix, unsigned side) {
+  std::FILE* nodes = std::fopen((prefix + ".nodes").c_str(), "w");
+  std::FILE* tris = std::fopen((prefix + ".tris").c_str(), "w");
+  if (!nodes || !tris)
+    throw std::runtime_error("pipeline: cannot write " + prefix + ".*");
+  double h = side > 1 ? 1.0 / double(side - 1) : 1.0;
+  for (unsigned j = 0; j < side; ++j)
+    for (unsigned i = 0; i < side; ++i)
+      std::fprintf(nodes, "%.17g %.17g 0\n", i * h, j * h);
+  for (unsigned j = 0; j + 1 < side; ++j) {
+    for (unsigned i = 0; i + 1 < side; ++i) {
+      unsigned a = j * side + i, b = a + 1, c = a + side, d = c + 1;
+      std::fprintf(tris, "%u %u %u\n%u %u %u\n", a, b, c, b, d, c);
+    }
+  }
+  std::fclose(nodes);
+  std::fclose(tris);
+}
+
+/** Return the index of the node of @a g nearest to @a p. */
+template <typename G>
+typename G::size_type nearest_node(const G& g, const Point& p) {
+  typename G::size_type best = 0;
+  double best_d = norm(g.node(0).position() - p);
+  for (typename G::size_type i = 1; i < g.size(); ++i) {
+    double d = norm(g.node(i).position() - p);
+    if (d < best_d) {
+      best = i;
+      best_d = d;
+    }
+  }
+  return best;
+}
+
+/** Run the pipeline on a fresh graph, filling @a phases. */
+template <typename G>
+int run(const pipeline_options& opt, const std::string& prefix,
+        std::vector<phase>& phases) {
+  if constexpr (!can_simulate<G>) {
+    std::fprintf(stderr, "variant has no incident iterator or settable "
+                         "position\n");
+    return 2;
+  } else {
+    const std::int64_t base = heap::live.load();
+    phase& load = phases[0];
+    phase& build = phases[1];
+    phase& freeze = phases[2];
+    phase& setup = phases[3];
+    phase& simulate = phases[4];
+    phase& checkpoint = phases[5];
+    load_options lopt;
+    lopt.threads = opt.threads;
+
+    G g;
+    {
+      phase_timer t(load, base);
+      load_nodes(g, prefix + ".nodes", lopt);
+      t.finish();
+    }
+    {
+      phase_timer t(build, base);
+      load_triangles(g, prefix + ".tris", lopt);
+      t.finish();
+    }
+    {
+      phase_timer t(freeze, base);
+      if constexpr (has_reorder<G>::value) {
+        if (opt.reorder == "hilbert")
+          g.reorder(G::Order::Hilbert);
+        else if (opt.reorder == "morton")
+          g.reorder(G::Order::Morton);
+        else if (opt.reorder == "rcm")
+          g.reorder(G::Order::RCM);
+      }
+      if constexpr (has_freeze<G>::value) {
+        if (opt.freeze)
+          g.freeze();
+      }
+      t.finish();
+    }
+
+    // The hw2 setup: springs at the grid spacing under gravity, the
+    // corners at (0, 0) and (1, 0) held, a floor and a ball below
+    const double dt = 1e-3, K = 100.0;
+    double L = 1.0 / double(std::max(opt.side, 2u) - 1);
+    if (!opt.mesh.empty() && g.num_edges() > 0)
+      L = norm(g.edge(0).node1().position() - g.edge(0).node2().position());
+    const Point gravity(0, 0, -9.81);
+    auto constraints = make_constraints(
+        plane_constraint(Point(0, 0, 1), -0.75),
+        sphere_constraint(Point(0.5, 0.5, -0.5), 0.15));
+
+    phase_timer setup_timer(setup, base);
+    SpringKernel<G> springs(g, opt.threads);
+    SymplecticEuler<G> euler(g, opt.threads);
+    euler.pin(nearest_node(g, Point(0, 0, 0)));
+    euler.pin(nearest_node(g, Point(1, 0, 0)));
+    auto forces = make_forces(
+        spring_force(springs, g, K, L),
+        node_force([&](std::size_t i, const Point&, const Point&) {
+          return euler.mass(i) * gravity;
+        }));
+    setup_timer.finish();
+
+    using writer_type = CheckpointWriter<G>;
+    std::unique_ptr<writer_type> writer;
+    if (opt.every > 0) {
+      phase_timer t(checkpoint, base);
+      writer.reset(new writer_type(g, opt.dir + "/pipeline.ckpt"));
+      t.finish();
+    }
+    for (unsigned s = 0; s < opt.steps; ++s) {
+      phase_timer t(simulate, base);
+      euler.step(dt, forces, constraints);
+      t.finish();
+      if (writer && s % opt.every == 0) {
+        phase_timer c(checkpoint, base);
+        writer->write(s);
+        c.finish();
+      }
+    }
+    if (writer) {
+      phase_timer t(checkpoint, base);
+      writer->close();
+      t.finish();
+    }
+    return 0;
+  }
+}
+
+} // end namespace
+
+int main(int argc, char** argv) {
+  pipeline_options opt;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--side" && i + 1 < argc) {
+      opt.side = unsigned(std::strtoul(argv[++i], nullptr, 10));
+    } else if (arg == "--steps" && i + 1 < argc) {
+      opt.steps = unsigned(std::strtoul(argv[++i], nullptr, 10));
+    } else if (arg == "--every" && i + 1 < argc) {
+      opt.every = unsigned(std::strtoul(argv[++i], nullptr, 10));
+    } else if (arg == "--reorder" && i + 1 < argc) {
+      opt.reorder = argv[++i];
+    } else if (arg == "--freeze") {
+      opt.freeze = true;
+    } else if (arg == "--threads" && i + 1 < argc) {
+      opt.threads = unsigned(std::strtoul(argv[++i], nullptr, 10));
+    } else if (arg == "--dir" && i + 1 < argc) {
+      opt.dir = argv[++i];
+    } else if (arg == "--mesh" && i + 1 < argc) {
+      opt.mesh = argv[++i];
+    } else if (arg == "--csv") {
+      opt.csv = true;
+    } else {
+      std::fprintf(stderr, "usage: %s [--side N] [--steps S] [--every K] "
+                           "[--reorder hilbert|morton|rcm] [--freeze] "
+                           "[--threads T] [--dir D] [--mesh PREFIX] "
+                           "[--csv]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (!can_simulate<graph_type>) {
+    std::fprintf(stderr, "variant has no incident iterator or settable "
+                         "position\n");
+    return 2;
+  }
+  if ((!opt.reorder.empty() && opt.reorder != "none" &&
+       (!has_reorder<graph_type>::value ||
+        (opt.reorder != "hilbert" && opt.reorder != "morton" &&
+         opt.reorder != "rcm"))) ||
+      (opt.freeze && !has_freeze<graph_type>::value) ||
+      (opt.every > 0 && !has_checkpoint_values<graph_type>::value)) {
+    std::fprintf(stderr, "mode not supported by this variant\n");
+    return 2;
+  }
+
+  std::vector<phase> phases = {{"load"}, {"build"}, {"freeze"}, {"setup"},
+                               {"simulate"}, {"checkpoint"}};
+  try {
+    std::string prefix = opt.mesh;
+    if (prefix.empty()) {
+      prefix = opt.dir + "/pipeline_grid";
+      write_grid_mesh(prefix, opt.side);
+    }
+    int status = run<graph_type>(opt, prefix, phases);
+    if (status != 0)
+      return status;
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "pipeline: %s\n", e.what());
+    return 1;
+  }
+
+  double total = 0;
+  std::int64_t peak = 0;
+  for (const phase& p : phases) {
+    total += p.seconds;
+    peak = std::max(peak, p.peak);
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  double rss_mb = double(usage.ru_maxrss) / 1024.0;
+
+  if (opt.csv) {
+    std::printf("total_s,peak_heap_mb,max_rss_mb");
+    for (const phase& p : phases)
+      std::printf(",%s_s,%s_heap_mb,%s_peak_mb", p.name, p.name, p.name);
+    std::printf("\n%.6f,%.3f,%.3f", total, double(peak) / 1048576.0, rss_mb);
+    for (const phase& p : phases)
+      std::printf(",%.6f,%.3f,%.3f", p.seconds, double(p.live) / 1048576.0,
+                  double(p.peak) / 1048576.0);
+    std::printf("\n");
+    return 0;
+  }
+  std::printf("%-12s %12s %12s %12s\n", "phase", "seconds", "heap MB",
+              "peak MB");
+  for (const phase& p : phases)
+    std::printf("%-12s %12.4f %12.2f %12.2f\n", p.name, p.seconds,
+                double(p.live) / 1048576.0, double(p.peak) / 1048576.0);
+  std::printf("max RSS %.2f MB, peak heap %.2f MB\n", rss_mb,
+              double(peak) / 1048576.0);
+  std::printf("total_seconds %.6f\n", total);
+  return 0;
+}
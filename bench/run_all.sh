@@ -0,0 +1,115 @@
+#!/bin/sh
+# Build bench/graph_bench.cpp once per Graph.hpp variant in hw0/ and hw1/,
+# run each binary, and merge the results into a CSV leaderboard.
+#
+# Usage: bench/run_all.sh [CME212 include dir] [output dir]
+#
+# The include dir must contain CME212/Point.hpp and CME212/Util.hpp from the
+# course distribution (default: $CME212_INCLUDE, else the repo root). Extra
+# arguments for the benchmark binaries can be passed in $BENCH_ARGS, e.g.
+# BENCH_ARGS=--benchmark_filter=HasEdge. Set GRAPH_BENCH_MAX_NODES to cap the
+# graph size for a quick run, and GRAPH_BENCH_PERF=1 to add hardware counter
+# columns (see bench/graph_bench.cpp). Each variant gets $BENCH_TIMEOUT seconds
+# (default 3600) so one that loops forever does not stall the sweep.
+#
+# Memory footprint: set BENCH_MEMORY=1 to build every variant with
+# -DGRAPH_BENCH_MEMORY=1 and run the Memory benchmarks instead of the speed
+# ones (see bench/graph_bench.cpp). The default output dir is then
+# bench_memory_out, and the bytes_per_node, bytes_per_edge, allocation and
+# peak columns of results.csv are the figures to compare; the leaderboard
+# still orders by time.
+#
+# Regression checks: set BENCH_BASELINE to a baseline dir to compare this
+# run with the last one saved there (bench/compare.py check) and exit 1 on
+# benchmarks more than 5% slower, or add BENCH_BASELINE_SAVE=1 to append
+# this run to its per-variant history instead. Set BENCH_REPETITIONS
+# (e.g. 10) so the comparison can test significance; the CSVs then also
+# get the mean, median and stddev rows of google-benchmark.
+#
+# Outputs, in the output dir (default: bench_out):
+#   results.csv      every benchmark row, prefixed with the variant name
+#   leaderboard.csv  the same rows ordered by benchmark, fastest first
+#   json/            the full JSON output of each variant, for compare.py
+#   failed.txt       variants that did not compile, with the first error,
+#                    and variants that crashed or timed out
+set -u
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+INCLUDE=${1:-${CME212_INCLUDE:-$ROOT}}
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2 -DNDEBUG}
+if [ -n "${BENCH_MEMORY:-}" ]; then
+  OUT=${2:-bench_memory_out}
+  CXXFLAGS="$CXXFLAGS -DGRAPH_BENCH_MEMORY=1"
+else
+  OUT=${2:-bench_out}
+fi
+
+mkdir -p "$OUT/bin" "$OUT/json"
+rm -f "$OUT"/json/*.json
+: > "$OUT/results.csv.tmp"
+: > "$OUT/failed.txt"
+header=
+
+for f in "$ROOT"/hw0/Graph-*.hpp "$ROOT"/hw1/Graph-*.hpp; do
+  rel=${f#"$ROOT"/}
+  name=$(echo "$rel" | sed 's#/#_#; s#\.hpp$##')
+  # hw0 defines a plain class Graph and hw1 a class template Graph<V>, but a
+  # few hw1 headers are plain classes as well, so check the header itself.
+  if grep -Eq '^ *template *< *(typename|class) +V' "$f"; then
+    type='Graph<int>'
+  else
+    type=Graph
+  fi
+
+  # Some variants need C++20 (e.g. designated initializers); try C++17 first.
+  built=
+  for std in c++17 c++20; do
+    if $CXX $CXXFLAGS -std=$std -I"$ROOT" -I"$INCLUDE" \
+         -DGRAPH_HEADER="\"$rel\"" -DGRAPH_TYPE="$type" \
+         "$ROOT/bench/graph_bench.cpp" -lbenchmark -lpthread \
+         -o "$OUT/bin/$name" 2> "$OUT/bin/$name.log"; then
+      built=yes
+      break
+    fi
+  done
+  if [ -z "$built" ]; then
+    echo "$rel: $(grep -m1 'error' "$OUT/bin/$name.log")" >> "$OUT/failed.txt"
+    echo "skip  $rel (does not compile)"
+    continue
+  fi
+
+  echo "run   $rel"
+  if ! timeout "${BENCH_TIMEOUT:-3600}" "$OUT/bin/$name" \
+         --benchmark_format=csv ${BENCH_ARGS:-} \
+         --benchmark_repetitions="${BENCH_REPETITIONS:-1}" \
+         --benchmark_out="$OUT/json/$name.json" --benchmark_out_format=json \
+         2> /dev/null > "$OUT/bin/$name.csv"; then
+    echo "$rel: timed out or crashed" >> "$OUT/failed.txt"
+  fi
+  # Rows start at the line beginning with "name,"; keep its header once.
+  csv=$(sed -n '/^name,/,$p' "$OUT/bin/$name.csv")
+  [ -z "$header" ] && header="variant,$(echo "$csv" | head -n 1)"
+  echo "$csv" | tail -n +2 | sed "s#^#$rel,#" >> "$OUT/results.csv.tmp"
+done
+
+{ echo "$header"; cat "$OUT/results.csv.tmp"; } > "$OUT/results.csv"
+rm -f "$OUT/results.csv.tmp"
+
+# Leaderboard: group by benchmark (field 2), fastest cpu_time (field 5) first.
+# Rows for skipped capabilities (error_occurred == true) are left out.
+{
+  echo "$header"
+  tail -n +2 "$OUT/results.csv" | grep -v ',true,' | sort -t, -k2,2 -k5,5g
+} > "$OUT/leaderboard.csv"
+
+echo "wrote $OUT/results.csv and $OUT/leaderboard.csv"
+echo "$(wc -l < "$OUT/failed.txt") variants failed, see $OUT/failed.txt"
+
+if [ -n "${BENCH_BASELINE:-}" ]; then
+  if [ -n "${BENCH_BASELINE_SAVE:-}" ]; then
+    python3 "$ROOT/bench/compare.py" save "$BENCH_BASELINE" "$OUT/json"
+  else
+    python3 "$ROOT/bench/compare.py" check "$BENCH_BASELINE" "$OUT/json"
+  fi
+fi
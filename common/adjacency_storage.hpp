@@ -0,0 +1,355 @@
+#ifndef CME212_ADJACENCY_STORAGE_HPP
+#define CME212_ADJACENCY_STORAGE_HPP
+
+/** @file adjacency_storage.hpp
+ * @brief Interchangeable adjacency storage policies for undirected graphs.
+ *
+ * A graph parameterized on a policy (e.g. hw1/Graph-5038.hpp's
+ * Graph<V, Storage>) keeps its neighbor sets in
+ * Storage::storage<size_type>:
+ *
+ *   list_adjacency    Per-node rows in insertion order. has_edge() scans.
+ *   sorted_adjacency  Per-node rows sorted by neighbor. has_edge() bisects.
+ *   hash_adjacency    Rows in insertion order plus an EdgeIndex of all
+ *                     pairs. has_edge() is one expected probe.
+ *   dense_adjacency   An N x N bit matrix. has_edge() tests one bit.
+ *
+ * Every storage has the same interface, so the graph is written once:
+ *
+ *   add_node(), clear()
+ *   contains(a, b), insert(a, b), degree(a)
+ *   begin(a), end(a), next(a, c), neighbor(a, c)
+ *
+ * The last four walk the neighbors of a with an opaque cursor c of type
+ * storage::cursor, which is what an IncidentIterator holds. Cursors compare
+ * with == and !=.
+ *
+ * These cover graphs that grow one edge at a time. A graph that is built
+ * once and then only read is best copied into CSR arrays instead
+ * (csr_snapshot.hpp).
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common/edge_index.hpp"
+#include "common/sorted_search.hpp"
+
+
+namespace adjacency_storage_detail {
+
+/** Return the index of the lowest set bit of @a x.
+ * @pre @a x != 0 */
+inline unsigned lowest_bit(std::uint64_t x) {
+#if defined(__GNUC__)
+  return unsigned(__builtin_ctzll(x));
+#else
+  unsigned k = 0;
+  while (!((x >> k) & 1))
+    ++k;
+  return k;
+#endif
+}
+
+} // end namespace adjacency_storage_detail
+
+
+/** @class AdjacencyRows
+ * @brief One vector of neighbor indices per node.
+ *
+ * The cursor is a position in the row.
+ *
+ * @tparam S       Node index type.
+ * @tparam Sorted  Keep every row sorted by neighbor, so contains() is a
+ *                 branchless binary search (sorted_search.hpp) and
+ *                 iteration visits neighbors in index order. Otherwise rows
+ *                 keep insertion order and contains() scans.
+ */
+template <typename S, bool Sorted>
+class AdjacencyRows {
+ public:
+  using size_type = S;
+  using cursor = S;
+
+  void add_node() {
+    rows_.emplace_back();
+  }
+  void clear() {
+    rows_.clear();
+  }
+
+  /** Return true if @a b is a neighbor of @a a.
+   * Complexity: O(degree(a)), or O(log degree(a)) if Sorted.
+   */
+  bool contains(size_type a, size_type b) const {
+    const std::vector<size_type>& row = rows_[a];
+    if (Sorted)
+      return sorted_contains(row.data(), row.size(), b);
+    return std::find(row.begin(), row.end(), b) != row.end();
+  }
+
+  /** Make @a a and @a b neighbors.
+   * @pre !contains(@a a, @a b) and @a a != @a b
+   * Complexity: O(1) amortized, or O(degree) if Sorted.
+   */
+  void insert(size_type a, size_type b) {
+    add(rows_[a], b);
+    add(rows_[b], a);
+  }
+
+  /** Complexity: O(1). */
+  size_type degree(size_type a) const {
+    return size_type(rows_[a].size());
+  }
+
+  cursor begin(size_type) const {
+    return 0;
+  }
+  cursor end(size_type a) const {
+    return degree(a);
+  }
+  cursor next(size_type, cursor c) const {
+    return c + 1;
+  }
+  size_type neighbor(size_type a, cursor c) const {
+    return rows_[a][c];
+  }
+
+ private:
+  std::vector<std::vector<size_type>> rows_;
+
+  static void add(std::vector<size_type>& row, size_type id) {
+    if (Sorted)
+      row.insert(std::lower_bound(row.begin(), row.end(), id), id);
+    else
+      row.push_back(id);
+  }
+};
+
+/** @class AdjacencyHashedRows
+ * @brief Rows in insertion order, with an EdgeIndex for contains().
+ *
+ * Iteration and degree() are those of unsorted rows, and contains() costs
+ * one expected hash probe whatever the degree, for 16 to 32 more bytes per
+ * edge. Node indices must fit in 32 bits.
+ *
+ * @tparam S  Node index type.
+ */
+template <typename S>
+class AdjacencyHashedRows {
+ public:
+  using size_type = S;
+  using cursor = typename AdjacencyRows<S, false>::cursor;
+
+  void add_node() {
+    rows_.add_node();
+  }
+  void clear() {
+    rows_.clear();
+    pairs_.clear();
+  }
+
+  /** Complexity: O(1) expected. */
+  bool contains(size_type a, size_type b) const {
+    return pairs_.contains(std::uint32_t(a), std::uint32_t(b));
+  }
+
+  /** Make @a a and @a b neighbors.
+   * @pre !contains(@a a, @a b) and @a a != @a b
+   * Complexity: O(1) amortized expected.
+   */
+  void insert(size_type a, size_type b) {
+    rows_.insert(a, b);
+    pairs_.insert(std::uint32_t(a), std::uint32_t(b), 0);
+  }
+
+  /** Complexity: O(1). */
+  size_type degree(size_type a) const {
+    return rows_.degree(a);
+  }
+
+  cursor begin(size_type a) const {
+    return rows_.begin(a);
+  }
+  cursor end(size_type a) const {
+    return rows_.end(a);
+  }
+  cursor next(size_type a, cursor c) const {
+    return rows_.next(a, c);
+  }
+  size_type neighbor(size_type a, cursor c) const {
+    return rows_.neighbor(a, c);
+  }
+
+ private:
+  AdjacencyRows<S, false> rows_;
+  // Every pair {a, b} once; the stored ids are unused
+  EdgeIndex<std::uint8_t> pairs_;
+};
+
+/** @class AdjacencyBitMatrix
+ * @brief The adjacency matrix, one bit per node pair.
+ *
+ * Row a is a run of 64-bit words whose bit b is set when a and b are
+ * neighbors. contains() and insert() are single bit operations, and
+ * iteration scans the row a word at a time, so a row of 4096 nodes costs at
+ * most 64 word loads however many neighbors it has. The cursor holds the
+ * current neighbor and the bits of its word still to visit, so stepping
+ * within a word touches no memory. Neighbors come in index order. Degrees are
+ * counted on insert() rather than by a popcount over the row, which would
+ * cost those 64 words on every degree() call.
+ *
+ * Memory is N^2 / 8 bytes (2 MiB at 4096 nodes), independent of the edge
+ * count: this pays off for small graphs that are dense, roughly above a
+ * few percent of all pairs. Growing past the current capacity doubles it
+ * and copies the matrix.
+ *
+ * @tparam S  Node index type.
+ */
+template <typename S>
+class AdjacencyBitMatrix {
+ public:
+  using size_type = S;
+
+  /** Position of a walk over a row: the current neighbor, or N at the end,
+   * and the bits of its word that are not visited yet. */
+  struct cursor {
+    size_type pos;
+    std::uint64_t rest;
+
+    bool operator==(const cursor& c) const {
+      return pos == c.pos;
+    }
+    bool operator!=(const cursor& c) const {
+      return pos != c.pos;
+    }
+  };
+
+  void add_node() {
+    if (n_ == capacity_)
+      grow();
+    ++n_;
+    used_words_ = (n_ + 63) / 64;
+    degree_.push_back(0);
+  }
+  void clear() {
+    bits_.clear();
+    degree_.clear();
+    n_ = 0;
+    used_words_ = 0;
+    capacity_ = 0;
+    words_ = 0;
+  }
+
+  /** Complexity: O(1), one bit test. */
+  bool contains(size_type a, size_type b) const {
+    return (row(a)[b / 64] >> (b % 64)) & 1;
+  }
+
+  /** Make @a a and @a b neighbors.
+   * @pre !contains(@a a, @a b) and @a a != @a b
+   * Complexity: O(1).
+   */
+  void insert(size_type a, size_type b) {
+    row(a)[b / 64] |= bit(b);
+    row(b)[a / 64] |= bit(a);
+    ++degree_[a];
+    ++degree_[b];
+  }
+
+  /** Complexity: O(1). */
+  size_type degree(size_type a) const {
+    return degree_[a];
+  }
+
+  cursor begin(size_type a) const {
+    if (n_ == 0)
+      return end(a);
+    return scan(a, 0, row(a)[0]);
+  }
+  cursor end(size_type) const {
+    return cursor{size_type(n_), 0};
+  }
+  cursor next(size_type a, cursor c) const {
+    return scan(a, std::size_t(c.pos) / 64, c.rest & (c.rest - 1));
+  }
+  size_type neighbor(size_type, cursor c) const {
+    return c.pos;
+  }
+
+ private:
+  // Row-major matrix of capacity_ rows of words_ words each, of which the
+  // first used_words_ can hold bits of the n_ nodes
+  std::vector<std::uint64_t> bits_;
+  std::vector<size_type> degree_;
+  std::size_t n_ = 0;
+  std::size_t capacity_ = 0;
+  std::size_t words_ = 0;
+  std::size_t used_words_ = 0;
+
+  static std::uint64_t bit(size_type v) {
+    return std::uint64_t(1) << (v % 64);
+  }
+  std::uint64_t* row(size_type a) {
+    return bits_.data() + std::size_t(a) * words_;
+  }
+  const std::uint64_t* row(size_type a) const {
+    return bits_.data() + std::size_t(a) * words_;
+  }
+  /** Return the cursor at the lowest bit of @a x, the unvisited bits of
+   * word @a w of row @a a, or at the first set bit of a later word. */
+  cursor scan(size_type a, std::size_t w, std::uint64_t x) const {
+    if (x == 0) {
+      const std::uint64_t* r = row(a);
+      do {
+        if (++w >= used_words_)
+          return end(a);
+        x = r[w];
+      } while (x == 0);
+    }
+    return cursor{size_type(w * 64 + adjacency_storage_detail::lowest_bit(x)), x};
+  }
+
+  /** Double the capacity, moving every row to its new stride. */
+  void grow() {
+    std::size_t capacity = capacity_ ? 2 * capacity_ : 64;
+    std::size_t words = capacity / 64;
+    std::vector<std::uint64_t> bits(capacity * words, 0);
+    for (std::size_t a = 0; a < n_; ++a)
+      std::copy(bits_.begin() + a * words_, bits_.begin() + (a + 1) * words_,
+                bits.begin() + a * words);
+    bits_.swap(bits);
+    capacity_ = capacity;
+    words_ = words;
+  }
+};
+
+
+/** Policy: AdjacencyRows in insertion order. */
+struct list_adjacency {
+  template <typename S>
+  using storage = AdjacencyRows<S, false>;
+};
+
+/** Policy: AdjacencyRows sorted by neighbor. */
+struct sorted_adjacency {
+  template <typename S>
+  using storage = AdjacencyRows<S, true>;
+};
+
+/** Policy: AdjacencyHashedRows. */
+struct hash_adjacency {
+  template <typename S>
+  using storage = AdjacencyHashedRows<S>;
+};
+
+/** Policy: AdjacencyBitMatrix. */
+struct dense_adjacency {
+  template <typename S>
+  using storage = AdjacencyBitMatrix<S>;
+};
+
+#endif // CME212_ADJACENCY_STORAGE_HPP
@@ -0,0 +1,670 @@
+#ifndef CME212_APPROX_ANALYTICS_HPP
+#define CME212_APPROX_ANALYTICS_HPP
+
+/** @file approx_analytics.hpp
+ * @brief Estimates of betweenness, closeness, diameter and the
+ *        neighborhood function, within a time or accuracy budget.
+ *
+ * Exact betweenness and closeness take a search from every node, and the
+ * exact diameter and distance distribution in general do too: hours on a
+ * billion edges. ApproxAnalytics answers from a few parallel searches of
+ * one BfsEngine snapshot instead:
+ *
+ *   centrality()   Brandes' dependency accumulation ("A Faster Algorithm
+ *                  for Betweenness Centrality", 2001) from sampled sources,
+ *                  as Brandes and Pich ("Centrality Estimation in Large
+ *                  Networks", 2007) propose, giving normalized betweenness
+ *                  and harmonic closeness of every node. Both are means of
+ *                  per-source terms in [0, 1], so Hoeffding's inequality
+ *                  bounds the error of all nodes at once: see
+ *                  centrality_report::error.
+ *   diameter()     Repeated double sweeps in the 4-sweep form of Crescenzi
+ *                  et al. ("On computing the diameter of real-world
+ *                  undirected graphs", 2013): a search from the far end of
+ *                  a longest path found gives a lower bound, and one from
+ *                  the middle of that path twice its eccentricity as an
+ *                  upper bound.
+ *   neighborhood_function()
+ *                  HyperANF (Boldi, Rosa and Vigna, "HyperANF:
+ *                  Approximating the Neighbourhood Function of Very Large
+ *                  Graphs on a Budget", WWW 2011): every node keeps a
+ *                  HyperLogLog counter of the nodes within t hops, and step
+ *                  t + 1 merges each node's counter with its neighbors'.
+ *                  The sums give the number of pairs within t hops, and
+ *                  from them the effective diameter and average distance.
+ *   degree_distribution()
+ *                  Exact, as one pass over the offsets costs less than any
+ *                  search.
+ *
+ * Searches and merges run on all threads over the CSR snapshot; budgets
+ * are checked between searches or steps, so a time budget overruns by at
+ * most one of them:
+ *
+ *   ApproxAnalytics<GraphType> stats(g);
+ *   centrality_options opt;
+ *   opt.error = 0.01;
+ *   opt.seconds = 60;
+ *   std::vector<double> bc, closeness;
+ *   centrality_report r = stats.centrality(bc, closeness, opt);
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/graph_generators.hpp"
+#include "common/parallel_bfs.hpp"
+#include "common/trace.hpp"
+
+
+/** Budget of ApproxAnalytics::centrality(). Sampling stops at the first
+ * budget met; a budget of 0 does not apply, and with none at all size()
+ * sources are drawn. */
+struct centrality_options {
+  /** Largest error of every estimate that is acceptable. */
+  double error = 0.1;
+  /** Probability with which the error bound holds for all nodes at once. */
+  double confidence = 0.95;
+  /** Most sources to search from. */
+  std::size_t max_samples = 0;
+  /** Wall time after which no further search is started. */
+  double seconds = 0;
+  std::uint64_t seed = 1;
+};
+
+/** What centrality() did, and how good its estimates are. */
+struct centrality_report {
+  std::uint64_t samples = 0;     // sources searched from
+  /** With probability confidence, every betweenness and closeness
+   * estimate is within error of its true value. */
+  double error = 1;
+  double confidence = 0;
+  double seconds = 0;
+};
+
+/** Budget of ApproxAnalytics::diameter(). */
+struct diameter_options {
+  /** Most searches; each round of the 4-sweep takes three. */
+  unsigned max_searches = 30;
+  /** Wall time after which no further search is started, 0 for none. */
+  double seconds = 0;
+};
+
+/** Bounds found by diameter() on the diameter of one component. */
+struct diameter_report {
+  std::uint64_t lower = 0;       // eccentricity of some node: a true bound
+  std::uint64_t upper = 0;       // twice the smallest eccentricity seen
+  std::uint64_t searches = 0;
+  std::uint64_t component = 0;   // nodes of the component searched
+  double seconds = 0;
+
+  /** Return true if the bounds meet, so lower is the exact diameter. */
+  bool exact() const {
+    return lower == upper;
+  }
+};
+
+/** Budget and precision of ApproxAnalytics::neighborhood_function(). */
+struct anf_options {
+  /** Registers per counter, as a power of two, 4 to 16. Each node takes
+   * 2^log2_registers bytes, and an estimate's relative standard error is
+   * about 1.04 / sqrt(2^log2_registers). */
+  unsigned log2_registers = 6;
+  /** Most merge steps, i.e. the largest distance resolved. */
+  unsigned max_steps = 1000;
+  /** Wall time after which no further step is started, 0 for none. */
+  double seconds = 0;
+  std::uint64_t seed = 1;
+};
+
+/** The neighborhood function found by neighborhood_function(). */
+struct anf_report {
+  /** pairs[t] estimates the ordered pairs (u, v), u == v included, with v
+   * within t hops of u. */
+  std::vector<double> pairs;
+  std::uint64_t steps = 0;
+  bool converged = false;        // no counter changed in the last step
+  double effective_diameter = 0; // hops within which 90% of pairs lie,
+                                 // interpolated
+  double average_distance = 0;   // over connected pairs of distinct nodes
+  double relative_error = 0;     // standard error of each pairs[t]
+  double seconds = 0;
+};
+
+
+/** @class ApproxAnalytics
+ * @brief Sampled and sketched whole-graph statistics over one BfsEngine
+ *        snapshot of a graph.
+ *
+ * The snapshot is taken by the constructor; changes to the graph after
+ * that are not seen. The methods are const, but each uses working arrays
+ * of O(size()) values, or O(size() * 2^log2_registers) bytes for
+ * neighborhood_function().
+ *
+ * @tparam G  Graph type with size(), node(i).edge_begin()/edge_end() and
+ *            size_type.
+ */
+template <typename G>
+class ApproxAnalytics {
+ public:
+  /** Type of node indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Snapshot the adjacency of @a g.
+   * @param[in] threads  Threads for every method; 0 means all cores
+   *
+   * Complexity: O(g.size() + g.num_edges()), spread over the threads.
+   */
+  explicit ApproxAnalytics(const G& g, unsigned threads = 0)
+      : threads_(csr_snapshot::thread_count(threads)),
+        n_(std::size_t(g.size())), bfs_(g, options(threads_)) {
+  }
+
+  /** Return the number of nodes in the snapshot. */
+  size_type size() const {
+    return size_type(n_);
+  }
+
+  /** Return the search engine over the snapshot. */
+  const BfsEngine<G>& bfs() const {
+    return bfs_;
+  }
+
+  /** Return the degree distribution as (degree, nodes of that degree)
+   * pairs in increasing degree, degrees with no node left out.
+   * Complexity: O(size()), spread over the threads, plus a sort of the
+   * nodes of degree 65536 or more. */
+  std::vector<std::pair<std::size_t, std::uint64_t>>
+  degree_distribution() const {
+    constexpr std::size_t dense = 65536;
+    std::vector<std::vector<std::uint64_t>> counts(threads_);
+    std::vector<std::vector<std::size_t>> large(threads_);
+    csr_snapshot::parallel_ranges(threads_, n_, 4096,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          counts[t].assign(dense, 0);
+          for (std::size_t i = b; i < e; ++i) {
+            std::size_t d = degree(i);
+            if (d < dense)
+              ++counts[t][d];
+            else
+              large[t].push_back(d);
+          }
+        });
+    std::vector<std::pair<std::size_t, std::uint64_t>> out;
+    for (std::size_t d = 0; d < dense; ++d) {
+      std::uint64_t c = 0;
+      for (const auto& part : counts)
+        c += part.empty() ? 0 : part[d];
+      if (c != 0)
+        out.emplace_back(d, c);
+    }
+    std::vector<std::size_t> big;
+    for (const auto& part : large)
+      big.insert(big.end(), part.begin(), part.end());
+    std::sort(big.begin(), big.end());
+    for (std::size_t x = 0; x < big.size(); ++x) {
+      if (x == 0 || big[x] != big[x - 1])
+        out.emplace_back(big[x], 0);
+      ++out.back().second;
+    }
+    return out;
+  }
+
+  /** Estimate the betweenness and harmonic closeness of every node.
+   * @param[out] betweenness  Resized to size(); entry v estimates the
+   *     fraction of the ordered pairs (s, t) of other nodes whose shortest
+   *     paths run through v, counting a pair with several shortest paths by
+   *     the share of them that do: 0 to 1
+   * @param[out] closeness    Resized to size(); entry v estimates the mean
+   *     of 1 / d(u, v) over the other nodes u, with 1 / d = 0 for nodes out
+   *     of reach: 0 to 1
+   * @return Samples taken and the error bound they give
+   *
+   * Sources are drawn uniformly, with replacement. Each contributes one
+   * term in [0, 1] per node and estimate, and the estimates scale the
+   * means of those terms by n / (n - 1), so by Hoeffding's inequality and
+   * a union bound over the nodes, k samples keep every estimate within
+   * n / (n - 1) sqrt(ln(4 n / (1 - confidence)) / (2 k)) of its true
+   * value with probability confidence. Sampling stops once that reaches
+   * opt.error, or at the first other budget met.
+   *
+   * Complexity: O(number of edges) per sample, spread over the threads.
+   */
+  centrality_report centrality(std::vector<double>& betweenness,
+                               std::vector<double>& closeness,
+                               const centrality_options& opt =
+                                   centrality_options()) const {
+    CME212_TRACE_SCOPE("approx_centrality");
+    auto start = std::chrono::steady_clock::now();
+    centrality_report report;
+    report.confidence = opt.confidence;
+    betweenness.assign(n_, 0.0);
+    closeness.assign(n_, 0.0);
+    if (n_ < 3)
+      return report;
+
+    double n = double(n_);
+    double scale = n / (n - 1);
+    double log_term = std::log(4 * n / (1 - opt.confidence));
+    auto bound = [&](std::uint64_t k) {
+      return scale * std::sqrt(log_term / (2 * double(k)));
+    };
+    std::uint64_t limit = opt.max_samples;
+    if (opt.error > 0) {
+      auto need = std::uint64_t(std::ceil(
+          scale * scale * log_term / (2 * opt.error * opt.error)));
+      limit = limit ? std::min(limit, need) : need;
+    }
+    if (limit == 0 && opt.seconds <= 0)
+      limit = n_;
+
+    std::vector<size_type> dist;
+    std::vector<size_type> order;
+    std::vector<std::size_t> levels;
+    std::vector<double> sigma(n_), delta(n_);
+    graph_generators_detail::element_rng rng(opt.seed, sample_salt, 0);
+    while ((limit == 0 || report.samples < limit) &&
+           !(report.samples > 0 && out_of_time(start, opt.seconds))) {
+      size_type s = size_type(rng.below(n_));
+      bfs_.run(s, dist);
+      level_order(dist, order, levels);
+      dependencies(s, dist, order, levels, sigma, delta);
+      csr_snapshot::parallel_ranges(threads_, order.size(), 4096,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t x = std::max<std::size_t>(b, 1); x < e; ++x) {
+              size_type v = order[x];
+              betweenness[v] += delta[v] / (n - 2);
+              closeness[v] += 1.0 / double(dist[v]);
+            }
+          });
+      ++report.samples;
+    }
+
+    double k = double(report.samples);
+    csr_snapshot::parallel_ranges(threads_, n_, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t v = b; v < e; ++v) {
+            betweenness[v] *= scale / k;
+            closeness[v] *= scale / k;
+          }
+        });
+    report.error = std::min(1.0, bound(report.samples));
+    report.seconds = elapsed(start);
+    return report;
+  }
+
+  /** Bound the diameter of the component of the node of highest degree,
+   * usually the largest one, by repeated double sweeps.
+   * @return The bounds; exact() when they meet, which on real-world graphs
+   *         a few rounds usually achieve
+   *
+   * Each round searches from a start node, then from the farthest node a
+   * found, then from the node halfway along the path to the farthest node
+   * b from a. Every search raises the lower bound to its eccentricity if
+   * larger, and lowers the upper bound to twice it if smaller. The next
+   * round starts from the farthest node of the halfway search.
+   *
+   * Complexity: O(number of edges) per search, spread over the threads.
+   */
+  diameter_report diameter(const diameter_options& opt =
+                               diameter_options()) const {
+    CME212_TRACE_SCOPE("approx_diameter");
+    auto start = std::chrono::steady_clock::now();
+    diameter_report report;
+    if (n_ == 0)
+      return report;
+    report.upper = std::uint64_t(-1);
+
+    // Start from the node of highest degree
+    size_type u = 0;
+    for (std::size_t i = 1; i < n_; ++i) {
+      if (degree(i) > degree(u))
+        u = size_type(i);
+    }
+    std::vector<size_type> dist;
+    // Search from v; return its farthest node and set ecc to its distance
+    auto sweep = [&](size_type v, std::uint64_t& ecc) {
+      bfs_.run(v, dist);
+      std::pair<size_type, size_type> far = farthest(dist);
+      ecc = far.second;
+      report.lower = std::max(report.lower, ecc);
+      report.upper = std::min(report.upper, 2 * ecc);
+      ++report.searches;
+      return far.first;
+    };
+    auto budget_left = [&] {
+      return report.searches + 3 <= opt.max_searches &&
+             !(report.searches > 0 && out_of_time(start, opt.seconds));
+    };
+
+    while (report.lower < report.upper && budget_left()) {
+      std::uint64_t ecc;
+      size_type a = sweep(u, ecc);
+      if (report.searches == 1) {
+        report.component = 0;
+        for (size_type d : dist)
+          report.component += d != BfsEngine<G>::unreached;
+      }
+      size_type b = sweep(a, ecc);
+      if (report.lower >= report.upper)
+        break;
+      // dist holds the distances from a: walk back from b to halfway
+      size_type mid = b;
+      for (std::uint64_t steps = ecc / 2; steps > 0; --steps)
+        mid = parent(mid, dist);
+      u = sweep(mid, ecc);
+    }
+    if (report.upper == std::uint64_t(-1))
+      report.upper = report.lower;
+    report.seconds = elapsed(start);
+    return report;
+  }
+
+  /** Estimate the neighborhood function with HyperLogLog counters.
+   * @return pairs[t] for t = 0, 1, ... up to the step at which no counter
+   *         changed or a budget ran out, and the statistics derived from it
+   *
+   * Counter registers of neighbors are merged by taking maxima, and only
+   * nodes with a neighbor whose counter changed in the last step are
+   * merged again.
+   *
+   * Complexity: O((size() + number of edges) * 2^log2_registers) per step,
+   * spread over the threads.
+   */
+  anf_report neighborhood_function(const anf_options& opt =
+                                       anf_options()) const {
+    CME212_TRACE_SCOPE("hyper_anf");
+    auto start = std::chrono::steady_clock::now();
+    assert(opt.log2_registers >= 4 && opt.log2_registers <= 16);
+    anf_report report;
+    const unsigned p = opt.log2_registers;
+    const std::size_t m = std::size_t(1) << p;
+    report.relative_error = 1.04 / std::sqrt(double(m));
+
+    std::vector<std::uint8_t> cur(n_ * m, 0), next(n_ * m);
+    std::vector<std::uint8_t> changed(n_, 1), changed_next(n_);
+    csr_snapshot::parallel_ranges(threads_, n_, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t v = b; v < e; ++v) {
+            std::uint64_t h = graph_generators_detail::mix(
+                opt.seed ^ graph_generators_detail::mix(v));
+            std::size_t j = std::size_t(h >> (64 - p));
+            std::uint64_t w = h << p;
+            unsigned rank = w == 0 ? 65 - p : leading_zeros(w) + 1;
+            cur[v * m + j] = std::uint8_t(rank);
+          }
+        });
+    report.pairs.push_back(total_count(cur, m));
+
+    while (report.steps < opt.max_steps &&
+           !(report.steps > 0 && out_of_time(start, opt.seconds))) {
+      std::vector<std::uint64_t> moved(threads_, 0);
+      csr_snapshot::parallel_ranges(threads_, n_, 1024,
+          [&](unsigned t, std::size_t b, std::size_t e) {
+            for (std::size_t v = b; v < e; ++v) {
+              std::uint8_t* out = &next[v * m];
+              const std::uint8_t* own = &cur[v * m];
+              std::copy(own, own + m, out);
+              changed_next[v] = 0;
+              bool stale = false;
+              for (std::size_t k = bfs_.offset(size_type(v));
+                   k < bfs_.offset(size_type(v + 1)) && !stale; ++k)
+                stale = changed[bfs_.neighbor(k)] != 0;
+              if (!stale)
+                continue;
+              for (std::size_t k = bfs_.offset(size_type(v));
+                   k < bfs_.offset(size_type(v + 1)); ++k) {
+                const std::uint8_t* in = &cur[bfs_.neighbor(k) * m];
+                for (std::size_t j = 0; j < m; ++j)
+                  out[j] = std::max(out[j], in[j]);
+              }
+              if (!std::equal(out, out + m, own)) {
+                changed_next[v] = 1;
+                ++moved[t];
+              }
+            }
+          });
+      cur.swap(next);
+      changed.swap(changed_next);
+      ++report.steps;
+      std::uint64_t total = 0;
+      for (std::uint64_t c : moved)
+        total += c;
+      if (total == 0) {
+        report.converged = true;
+        break;
+      }
+      report.pairs.push_back(total_count(cur, m));
+    }
+
+    summarize(report);
+    report.seconds = elapsed(start);
+    return report;
+  }
+
+ private:
+  // Salt of the source sampling stream, apart from the generators'
+  static constexpr std::uint64_t sample_salt = 4;
+
+  unsigned threads_;
+  std::size_t n_;
+  BfsEngine<G> bfs_;
+
+  static bfs_options options(unsigned threads) {
+    bfs_options opt;
+    opt.threads = threads;
+    return opt;
+  }
+
+  static double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+  }
+  static bool out_of_time(std::chrono::steady_clock::time_point start,
+                          double seconds) {
+    return seconds > 0 && elapsed(start) >= seconds;
+  }
+
+  /** Return the number of leading zero bits of @a x.
+   * @pre @a x != 0 */
+  static unsigned leading_zeros(std::uint64_t x) {
+#if defined(__GNUC__)
+    return unsigned(__builtin_clzll(x));
+#else
+    unsigned k = 0;
+    while (!((x >> (63 - k)) & 1))
+      ++k;
+    return k;
+#endif
+  }
+
+  std::size_t degree(std::size_t v) const {
+    return bfs_.offset(size_type(v + 1)) - bfs_.offset(size_type(v));
+  }
+
+  /** Return a reached node of largest distance in @a dist, and that
+   * distance; ties go to the lowest index.
+   * @pre @a dist reaches at least its root */
+  std::pair<size_type, size_type> farthest(
+      const std::vector<size_type>& dist) const {
+    constexpr size_type none = BfsEngine<G>::unreached;
+    std::vector<std::pair<size_type, size_type>> best(threads_, {none, 0});
+    csr_snapshot::parallel_ranges(threads_, n_, 4096,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          std::pair<size_type, size_type> mine(none, 0);
+          for (std::size_t v = b; v < e; ++v) {
+            if (dist[v] != none &&
+                (mine.first == none || dist[v] > mine.second))
+              mine = {size_type(v), dist[v]};
+          }
+          best[t] = mine;
+        });
+    std::pair<size_type, size_type> far(none, 0);
+    for (const auto& b : best) {
+      if (b.first != none && (far.first == none || b.second > far.second))
+        far = b;
+    }
+    return far;
+  }
+
+  /** Return a neighbor of @a v one hop nearer the root of @a dist.
+   * @pre 0 < dist[v] < unreached */
+  size_type parent(size_type v, const std::vector<size_type>& dist) const {
+    for (std::size_t k = bfs_.offset(v); k < bfs_.offset(size_type(v + 1));
+         ++k) {
+      if (dist[bfs_.neighbor(k)] + 1 == dist[v])
+        return bfs_.neighbor(k);
+    }
+    assert(false);
+    return v;
+  }
+
+  /** Fill @a order with the nodes @a dist reaches, by distance, and
+   * @a levels with the start of every distance in it, plus its end. */
+  void level_order(const std::vector<size_type>& dist,
+                   std::vector<size_type>& order,
+                   std::vector<std::size_t>& levels) const {
+    std::size_t depth = std::size_t(farthest(dist).second) + 1;
+    std::vector<std::vector<std::size_t>> counts(threads_);
+    csr_snapshot::parallel_ranges(threads_, n_, 4096,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          counts[t].assign(depth, 0);
+          for (std::size_t v = b; v < e; ++v) {
+            if (dist[v] != BfsEngine<G>::unreached)
+              ++counts[t][dist[v]];
+          }
+        });
+    // Thread t's nodes of level d go after those of threads before it
+    levels.assign(depth + 1, 0);
+    for (std::size_t d = 0; d < depth; ++d) {
+      std::size_t at = levels[d];
+      for (auto& c : counts) {
+        if (c.empty())
+          continue;
+        std::size_t here = c[d];
+        c[d] = at;
+        at += here;
+      }
+      levels[d + 1] = at;
+    }
+    order.resize(levels[depth]);
+    csr_snapshot::parallel_ranges(threads_, n_, 4096,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          std::vector<std::size_t>& at = counts[t];
+          for (std::size_t v = b; v < e; ++v) {
+            if (dist[v] != BfsEngine<G>::unreached)
+              order[at[dist[v]]++] = size_type(v);
+          }
+        });
+  }
+
+  /** Count the shortest paths from @a s into @a sigma level by level, then
+   * accumulate Brandes' dependencies into @a delta from the deepest level
+   * up. Every node of a level is written by one thread and reads only the
+   * level next to it, so no atomics are needed. */
+  void dependencies(size_type s, const std::vector<size_type>& dist,
+                    const std::vector<size_type>& order,
+                    const std::vector<std::size_t>& levels,
+                    std::vector<double>& sigma,
+                    std::vector<double>& delta) const {
+    std::size_t depth = levels.size() - 1;
+    sigma[s] = 1;
+    for (std::size_t d = 1; d < depth; ++d) {
+      csr_snapshot::parallel_ranges(threads_, levels[d + 1] - levels[d], 1024,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t x = levels[d] + b; x < levels[d] + e; ++x) {
+              size_type v = order[x];
+              double paths = 0;
+              for (std::size_t k = bfs_.offset(v);
+                   k < bfs_.offset(size_type(v + 1)); ++k) {
+                size_type u = bfs_.neighbor(k);
+                if (dist[u] + 1 == dist[v])
+                  paths += sigma[u];
+              }
+              sigma[v] = paths;
+            }
+          });
+    }
+    for (std::size_t d = depth; d-- > 0;) {
+      csr_snapshot::parallel_ranges(threads_, levels[d + 1] - levels[d], 1024,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t x = levels[d] + b; x < levels[d] + e; ++x) {
+              size_type v = order[x];
+              double sum = 0;
+              if (d + 1 < depth) {
+                for (std::size_t k = bfs_.offset(v);
+                     k < bfs_.offset(size_type(v + 1)); ++k) {
+                  size_type w = bfs_.neighbor(k);
+                  if (dist[w] == dist[v] + 1)
+                    sum += (1 + delta[w]) / sigma[w];
+                }
+              }
+              delta[v] = sigma[v] * sum;
+            }
+          });
+    }
+  }
+
+  /** Return the sum over the nodes of their counters' estimates. */
+  double total_count(const std::vector<std::uint8_t>& regs,
+                     std::size_t m) const {
+    double alpha = m == 16 ? 0.673 : m == 32 ? 0.697 : m == 64 ? 0.709
+                 : 0.7213 / (1 + 1.079 / double(m));
+    std::vector<double> sums(threads_, 0.0);
+    csr_snapshot::parallel_ranges(threads_, n_, 4096,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          double s = 0;
+          for (std::size_t v = b; v < e; ++v) {
+            const std::uint8_t* r = &regs[v * m];
+            double inverse = 0;
+            std::size_t zeros = 0;
+            for (std::size_t j = 0; j < m; ++j) {
+              inverse += std::ldexp(1.0, -int(r[j]));
+              zeros += r[j] == 0;
+            }
+            double est = alpha * double(m) * double(m) / inverse;
+            // Linear counting for small counts, as HyperLogLog does
+            if (est <= 2.5 * double(m) && zeros != 0)
+              est = double(m) * std::log(double(m) / double(zeros));
+            s += est;
+          }
+          sums[t] = s;
+        });
+    double total = 0;
+    for (double s : sums)
+      total += s;
+    return total;
+  }
+
+  /** Fill the effective diameter and average distance of @a r from
+   * r.pairs. */
+  static void summarize(anf_report& r) {
+    const std::vector<double>& N = r.pairs;
+    if (N.size() < 2)
+      return;
+    double all = N.back();
+    double target = N[0] + 0.9 * (all - N[0]);
+    for (std::size_t t = 1; t < N.size(); ++t) {
+      if (N[t] >= target) {
+        double below = N[t - 1];
+        double step = N[t] - below;
+        r.effective_diameter = double(t - 1) +
+            (step > 0 ? (target - below) / step : 1.0);
+        break;
+      }
+    }
+    double weighted = 0;
+    for (std::size_t t = 1; t < N.size(); ++t)
+      weighted += double(t) * std::max(0.0, N[t] - N[t - 1]);
+    double connected = all - N[0];
+    r.average_distance = connected > 0 ? weighted / connected : 0;
+  }
+};
+
+#endif // CME212_APPROX_ANALYTICS_HPP
@@ -0,0 +1,704 @@
+#ifndef CME212_ARROW_EXPORT_HPP
+#define CME212_ARROW_EXPORT_HPP
+
+/** @file arrow_export.hpp
+ * @brief The node and edge arrays of a graph as Apache Arrow tables,
+ *        handed over without a copy or written as one Arrow IPC file.
+ *
+ * Arrow is the column format pandas, Polars, DuckDB and Spark read without
+ * parsing. export_nodes() and export_edges() describe a graph's own
+ * arrays through the Arrow C data interface
+ * (https://arrow.apache.org/docs/format/CDataInterface.html), a pair of
+ * plain C structs every Arrow implementation imports, so the consumer
+ * reads positions_data(), values_data(), edge_endpoints_data() and
+ * edge_values_data() in place:
+ *
+ *   ArrowArray array;
+ *   ArrowSchema schema;
+ *   export_nodes(g, &array, &schema);
+ *   // e.g. pyarrow.RecordBatch._import_from_c(addressof(array),
+ *   //                                         addressof(schema))
+ *
+ *   write_arrow_file("edges.arrow", g, arrow_table::edges);
+ *   // pandas.read_feather("edges.arrow"), or in DuckDB through the
+ *   // arrow extension
+ *
+ * The node table has a column "position", a fixed size list of the
+ * point's coordinates (three doubles for Point), and the edge table a
+ * column "endpoints", a fixed size list of the two node indices of the
+ * edge, as edge_endpoints_data() interleaves them. Both have a column
+ * "value" when the value type is an arithmetic type, exported as the Arrow
+ * integer or floating point type of its size (bool as uint8), or another
+ * trivially copyable type, exported as fixed size binary; empty and other
+ * value types get no value column.
+ *
+ * Nothing is copied, so the graph must outlive the exported arrays and
+ * must not change until the consumer releases them. Lazily removed nodes
+ * or edges are still in the arrays, so exporting a graph that has any is
+ * an error: compact() it first.
+ *
+ * write_arrow_file() writes the same table as an Arrow IPC file (the
+ * Feather v2 format): one schema, one record batch whose buffers are the
+ * graph's arrays written as they are, and the footer. It writes only the
+ * types listed above, non-null, in little endian order.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+/** Type of an exported array, as the Arrow C data interface defines it. */
+struct ArrowSchema {
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+  void (*release)(struct ArrowSchema*);
+  void* private_data;
+};
+
+/** Buffers of an exported array, as the Arrow C data interface defines
+ * them. */
+struct ArrowArray {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+  void (*release)(struct ArrowArray*);
+  void* private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+
+/** Which table of a graph to export. */
+enum class arrow_table { nodes, edges };
+
+
+namespace arrow_export_detail {
+
+template <typename G, typename = void>
+struct has_removals : std::false_type {};
+template <typename G>
+struct has_removals<G, std::void_t<
+    decltype(std::declval<const G&>().num_removed_nodes()),
+    decltype(std::declval<const G&>().num_removed_edges())>>
+    : std::true_type {};
+
+/** Return the Arrow format string of a column of T, or "" if T is not
+ * exported. */
+template <typename T>
+std::string format_of() {
+  if constexpr (std::is_same<T, float>::value) {
+    return "f";
+  } else if constexpr (std::is_same<T, double>::value) {
+    return "g";
+  } else if constexpr (std::is_same<T, bool>::value) {
+    static_assert(sizeof(bool) == 1, "bool is exported as uint8");
+    return "C";
+  } else if constexpr (std::is_integral<T>::value) {
+    const char* s = std::is_signed<T>::value ? "csil" : "CSIL";
+    switch (sizeof(T)) {
+      case 1: return std::string(1, s[0]);
+      case 2: return std::string(1, s[1]);
+      case 4: return std::string(1, s[2]);
+      case 8: return std::string(1, s[3]);
+    }
+    return "w:" + std::to_string(sizeof(T));
+  } else if constexpr (std::is_trivially_copyable<T>::value &&
+                       !std::is_empty<T>::value) {
+    return "w:" + std::to_string(sizeof(T));
+  } else {
+    return "";
+  }
+}
+
+/** Return the bytes per element of a primitive or fixed size binary
+ * format, or 0 for a nested one. */
+inline std::size_t width_of(const std::string& format) {
+  if (format.size() == 1) {
+    switch (format[0]) {
+      case 'c': case 'C': return 1;
+      case 's': case 'S': return 2;
+      case 'i': case 'I': case 'f': return 4;
+      case 'l': case 'L': case 'g': return 8;
+    }
+  }
+  if (format.compare(0, 2, "w:") == 0)
+    return std::size_t(std::stoul(format.substr(2)));
+  return 0;
+}
+
+/** Return N of a "+w:N" format, or 0 for any other format. */
+inline std::size_t list_size_of(const std::string& format) {
+  if (format.compare(0, 3, "+w:") == 0)
+    return std::size_t(std::stoul(format.substr(3)));
+  return 0;
+}
+
+/** One column of an exported table: @a length elements of @a format at
+ * @a data, or, for a fixed size list, @a length lists of @a list_size
+ * elements of @a format each. */
+struct column {
+  std::string name;
+  std::string format;
+  std::size_t list_size;
+  const void* data;
+};
+
+struct schema_data {
+  std::string format, name;
+  std::vector<ArrowSchema*> children;
+};
+
+inline void release_schema(ArrowSchema* s) {
+  auto* d = static_cast<schema_data*>(s->private_data);
+  for (ArrowSchema* c : d->children) {
+    if (c->release)
+      c->release(c);
+    delete c;
+  }
+  delete d;
+  s->release = nullptr;
+}
+
+/** Fill in @a out, which takes ownership of @a children. */
+inline void make_schema(ArrowSchema* out, std::string format, std::string name,
+                        std::int64_t flags, std::vector<ArrowSchema*> children) {
+  auto* d = new schema_data{std::move(format), std::move(name),
+                            std::move(children)};
+  out->format = d->format.c_str();
+  out->name = d->name.c_str();
+  out->metadata = nullptr;
+  out->flags = flags;
+  out->n_children = std::int64_t(d->children.size());
+  out->children = d->children.empty() ? nullptr : d->children.data();
+  out->dictionary = nullptr;
+  out->release = release_schema;
+  out->private_data = d;
+}
+
+struct array_data {
+  std::vector<const void*> buffers;
+  std::vector<ArrowArray*> children;
+};
+
+inline void release_array(ArrowArray* a) {
+  auto* d = static_cast<array_data*>(a->private_data);
+  for (ArrowArray* c : d->children) {
+    if (c->release)
+      c->release(c);
+    delete c;
+  }
+  delete d;
+  a->release = nullptr;
+}
+
+/** Fill in @a out, with no nulls, over @a buffers, which it does not own,
+ * taking ownership of @a children. */
+inline void make_array(ArrowArray* out, std::size_t length,
+                       std::vector<const void*> buffers,
+                       std::vector<ArrowArray*> children) {
+  auto* d = new array_data{std::move(buffers), std::move(children)};
+  out->length = std::int64_t(length);
+  out->null_count = 0;
+  out->offset = 0;
+  out->n_buffers = std::int64_t(d->buffers.size());
+  out->n_children = std::int64_t(d->children.size());
+  out->buffers = d->buffers.data();
+  out->children = d->children.empty() ? nullptr : d->children.data();
+  out->dictionary = nullptr;
+  out->release = release_array;
+  out->private_data = d;
+}
+
+/** Export @a columns of @a rows rows as one struct array, the Arrow form of
+ * a record batch. */
+inline void export_columns(const std::vector<column>& columns, std::size_t rows,
+                           ArrowArray* array, ArrowSchema* schema) {
+  std::vector<ArrowSchema*> fields;
+  std::vector<ArrowArray*> arrays;
+  for (const column& c : columns) {
+    auto* s = new ArrowSchema;
+    auto* a = new ArrowArray;
+    if (c.list_size == 0) {
+      make_schema(s, c.format, c.name, 0, {});
+      make_array(a, rows, {nullptr, c.data}, {});
+    } else {
+      auto* item = new ArrowSchema;
+      auto* items = new ArrowArray;
+      make_schema(item, c.format, "item", 0, {});
+      make_array(items, rows * c.list_size, {nullptr, c.data}, {});
+      make_schema(s, "+w:" + std::to_string(c.list_size), c.name, 0, {item});
+      make_array(a, rows, {nullptr}, {items});
+    }
+    fields.push_back(s);
+    arrays.push_back(a);
+  }
+  make_schema(schema, "+s", "", 0, std::move(fields));
+  make_array(array, rows, {nullptr}, std::move(arrays));
+}
+
+/** Append the value column of @a n values at @a data, if T is exported. */
+template <typename T>
+void add_value_column(std::vector<column>& columns, const T* data) {
+  std::string format = format_of<T>();
+  if (!format.empty())
+    columns.push_back({"value", format, 0, data});
+}
+
+//
+// Arrow IPC metadata: FlatBuffers tables
+//
+
+/** A FlatBuffers table under construction. Fields are scalars, strings,
+ * child tables, vectors of tables and vectors of structs, given as raw
+ * little endian bytes. */
+struct fb_table {
+  enum kind { scalar, string, child, tables, structs };
+  struct field {
+    std::uint16_t id;
+    kind k;
+    std::vector<std::uint8_t> bytes;       // scalar value, string, structs
+    std::size_t size;                      // scalar size, struct size
+    std::vector<fb_table> list;            // child (one entry), tables
+  };
+  std::vector<field> fields;
+
+  template <typename T>
+  fb_table& add(std::uint16_t id, T v) {
+    static_assert(std::is_trivially_copyable<T>::value, "scalar field");
+    field f{id, scalar, std::vector<std::uint8_t>(sizeof(T)), sizeof(T), {}};
+    std::memcpy(f.bytes.data(), &v, sizeof(T));
+    fields.push_back(std::move(f));
+    return *this;
+  }
+  fb_table& add_string(std::uint16_t id, const std::string& s) {
+    fields.push_back({id, string, std::vector<std::uint8_t>(s.begin(), s.end()),
+                      0, {}});
+    return *this;
+  }
+  fb_table& add_table(std::uint16_t id, fb_table t) {
+    field f{id, child, {}, 0, {}};
+    f.list.push_back(std::move(t));
+    fields.push_back(std::move(f));
+    return *this;
+  }
+  fb_table& add_tables(std::uint16_t id, std::vector<fb_table> ts) {
+    fields.push_back({id, tables, {}, 0, std::move(ts)});
+    return *this;
+  }
+  /** Add a vector of structs of @a size bytes each, 8-byte aligned. */
+  fb_table& add_structs(std::uint16_t id, std::vector<std::uint8_t> bytes,
+                        std::size_t size) {
+    fields.push_back({id, structs, std::move(bytes), size, {}});
+    return *this;
+  }
+};
+
+/** Serializes an fb_table tree. Every table precedes what it points to, so
+ * each offset points forward as FlatBuffers requires, and is patched once
+ * its target is placed. */
+class fb_writer {
+ public:
+  /** Return the buffer of the root table @a root, padded to 8 bytes. */
+  std::vector<std::uint8_t> finish(const fb_table& root) {
+    buf_.assign(4, 0);
+    patch(0, table(root));
+    pad(8);
+    return std::move(buf_);
+  }
+
+ private:
+  std::vector<std::uint8_t> buf_;
+
+  void pad(std::size_t align) {
+    while (buf_.size() % align)
+      buf_.push_back(0);
+  }
+  template <typename T>
+  void put(T v) {
+    std::size_t at = buf_.size();
+    buf_.resize(at + sizeof(T));
+    std::memcpy(buf_.data() + at, &v, sizeof(T));
+  }
+  template <typename T>
+  void put_at(std::size_t at, T v) {
+    std::memcpy(buf_.data() + at, &v, sizeof(T));
+  }
+  /** Point the offset at @a at to @a target. */
+  void patch(std::size_t at, std::size_t target) {
+    put_at(at, std::uint32_t(target - at));
+  }
+
+  std::size_t table(const fb_table& t) {
+    std::uint16_t slots = 0;
+    for (const fb_table::field& f : t.fields)
+      slots = std::max<std::uint16_t>(slots, std::uint16_t(f.id + 1));
+    pad(2);
+    std::size_t vtable = buf_.size();
+    put(std::uint16_t(4 + 2 * slots));
+    put(std::uint16_t(0));
+    for (std::uint16_t i = 0; i < slots; ++i)
+      put(std::uint16_t(0));
+
+    pad(8);
+    std::size_t start = buf_.size();
+    put(std::int32_t(start - vtable));
+    std::vector<std::pair<std::size_t, const fb_table::field*>> refs;
+    for (const fb_table::field& f : t.fields) {
+      std::size_t at;
+      if (f.k == fb_table::scalar) {
+        pad(f.size);
+        at = buf_.size();
+        buf_.insert(buf_.end(), f.bytes.begin(), f.bytes.end());
+      } else {
+        pad(4);
+        at = buf_.size();
+        put(std::uint32_t(0));
+        refs.push_back({at, &f});
+      }
+      put_at(vtable + 4 + 2 * std::size_t(f.id), std::uint16_t(at - start));
+    }
+    put_at(vtable + 2, std::uint16_t(buf_.size() - start));
+
+    for (const auto& r : refs) {
+      const fb_table::field& f = *r.second;
+      switch (f.k) {
+        case fb_table::string:
+          pad(4);
+          patch(r.first, buf_.size());
+          put(std::uint32_t(f.bytes.size()));
+          buf_.insert(buf_.end(), f.bytes.begin(), f.bytes.end());
+          buf_.push_back(0);
+          break;
+        case fb_table::child:
+          patch(r.first, table(f.list[0]));
+          break;
+        case fb_table::tables: {
+          pad(4);
+          std::size_t vec = buf_.size();
+          patch(r.first, vec);
+          put(std::uint32_t(f.list.size()));
+          for (std::size_t i = 0; i < f.list.size(); ++i)
+            put(std::uint32_t(0));
+          for (std::size_t i = 0; i < f.list.size(); ++i)
+            patch(vec + 4 + 4 * i, table(f.list[i]));
+          break;
+        }
+        case fb_table::structs:
+          // The elements after the length must be 8-byte aligned
+          while ((buf_.size() + 4) % 8)
+            buf_.push_back(0);
+          patch(r.first, buf_.size());
+          put(std::uint32_t(f.bytes.size() / f.size));
+          buf_.insert(buf_.end(), f.bytes.begin(), f.bytes.end());
+          break;
+        case fb_table::scalar:
+          break;
+      }
+    }
+    return start;
+  }
+};
+
+// Enumerators of the Arrow schema files Schema.fbs, Message.fbs and File.fbs
+constexpr std::int16_t metadata_v5 = 4;
+constexpr std::uint8_t type_int = 2;
+constexpr std::uint8_t type_floating_point = 3;
+constexpr std::uint8_t type_struct = 13;
+constexpr std::uint8_t type_fixed_size_binary = 15;
+constexpr std::uint8_t type_fixed_size_list = 16;
+constexpr std::uint8_t header_schema = 1;
+constexpr std::uint8_t header_record_batch = 3;
+
+/** Return the Field table of @a s and its children. */
+inline fb_table field_table(const ArrowSchema& s) {
+  std::string format = s.format;
+  fb_table type;
+  std::uint8_t type_id;
+  if (format == "f" || format == "g") {
+    type_id = type_floating_point;
+    type.add<std::int16_t>(0, format == "f" ? 1 : 2);
+  } else if (format == "+s") {
+    type_id = type_struct;
+  } else if (list_size_of(format)) {
+    type_id = type_fixed_size_list;
+    type.add<std::int32_t>(0, std::int32_t(list_size_of(format)));
+  } else if (format.compare(0, 2, "w:") == 0) {
+    type_id = type_fixed_size_binary;
+    type.add<std::int32_t>(0, std::int32_t(width_of(format)));
+  } else if (format.size() == 1 && std::string("cCsSiIlL").find(format) !=
+                                       std::string::npos) {
+    type_id = type_int;
+    type.add<std::int32_t>(0, std::int32_t(8 * width_of(format)));
+    type.add<std::uint8_t>(1, std::islower(format[0]) ? 1 : 0);
+  } else {
+    throw std::runtime_error("arrow_export: cannot write format " + format);
+  }
+  std::vector<fb_table> children;
+  for (std::int64_t i = 0; i < s.n_children; ++i)
+    children.push_back(field_table(*s.children[i]));
+  fb_table f;
+  f.add_string(0, s.name ? s.name : "");
+  f.add<std::uint8_t>(1, (s.flags & ARROW_FLAG_NULLABLE) ? 1 : 0);
+  f.add<std::uint8_t>(2, type_id);
+  f.add_table(3, std::move(type));
+  f.add_tables(5, std::move(children));
+  return f;
+}
+
+/** Return the Schema table of the record batch @a s, a struct. */
+inline fb_table schema_table(const ArrowSchema& s) {
+  std::vector<fb_table> fields;
+  for (std::int64_t i = 0; i < s.n_children; ++i)
+    fields.push_back(field_table(*s.children[i]));
+  fb_table t;
+  t.add<std::int16_t>(0, 0);              // little endian
+  t.add_tables(1, std::move(fields));
+  return t;
+}
+
+/** A body buffer of a record batch: @a bytes at @a data. */
+struct body_buffer {
+  const void* data;
+  std::size_t bytes;
+};
+
+/** Append to @a nodes and @a buffers the field nodes and body buffers of
+ * array @a a of type @a s and its children, in depth-first order. */
+inline void flatten(const ArrowSchema& s, const ArrowArray& a,
+                    std::vector<std::int64_t>& nodes,
+                    std::vector<body_buffer>& buffers) {
+  if (a.offset != 0 || a.null_count != 0)
+    throw std::runtime_error("arrow_export: can only write arrays with no "
+                             "offset and no nulls");
+  nodes.push_back(a.length);
+  nodes.push_back(0);
+  buffers.push_back({nullptr, 0});          // validity: none, as no nulls
+  std::string format = s.format;
+  std::size_t width = width_of(format);
+  if (width)
+    buffers.push_back({a.buffers[1], std::size_t(a.length) * width});
+  for (std::int64_t i = 0; i < s.n_children; ++i)
+    flatten(*s.children[i], *a.children[i], nodes, buffers);
+}
+
+/** Write @a bytes, or @a n zero bytes if @a bytes is null. */
+inline void write(std::ostream& out, const void* bytes, std::size_t n) {
+  static const char zeros[64] = {};
+  if (bytes) {
+    out.write(static_cast<const char*>(bytes), std::streamsize(n));
+  } else {
+    for (std::size_t k = 0; k < n; k += sizeof(zeros))
+      out.write(zeros, std::streamsize(std::min(n - k, sizeof(zeros))));
+  }
+  if (!out)
+    throw std::runtime_error("arrow_export: write failed");
+}
+
+/** Write one encapsulated message, @a meta then @a body_bytes of body
+ * written by @a body. Return the bytes of its metadata prefix and
+ * flatbuffer. */
+template <typename Body>
+std::size_t write_message(std::ostream& out, const fb_table& meta, Body body) {
+  std::vector<std::uint8_t> fb = fb_writer().finish(meta);
+  std::uint32_t marker = 0xFFFFFFFFu;
+  std::int32_t size = std::int32_t(fb.size());
+  write(out, &marker, 4);
+  write(out, &size, 4);
+  write(out, fb.data(), fb.size());
+  body();
+  return 8 + fb.size();
+}
+
+} // end namespace arrow_export_detail
+
+
+/**
+ * Describe the node table of @a g in @a array and @a schema, without
+ * copying: columns "position" and, if exported, "value".
+ * @pre @a array and @a schema are not released, or not filled in yet
+ * @post @a array and @a schema are the consumer's, to release once: the
+ *       buffers stay the graph's
+ * @throws std::runtime_error if @a g has lazily removed nodes or edges
+ *
+ * @tparam G  Graph type with size(), positions_data() and values_data(),
+ *            e.g. hw1/Graph-24726.hpp.
+ *
+ * Complexity: O(1).
+ */
+template <typename G>
+void export_nodes(const G& g, ArrowArray* array, ArrowSchema* schema) {
+  using namespace arrow_export_detail;
+  if constexpr (has_removals<G>::value) {
+    if (g.num_removed_nodes() || g.num_removed_edges())
+      throw std::runtime_error("arrow_export: compact() the graph before "
+                               "exporting it");
+  }
+  using point = std::decay_t<decltype(*g.positions_data())>;
+  using coordinate = std::decay_t<decltype(g.positions_data()->x)>;
+  static_assert(sizeof(point) % sizeof(coordinate) == 0,
+                "positions must be packed coordinates");
+  std::vector<column> columns;
+  columns.push_back({"position", format_of<coordinate>(),
+                     sizeof(point) / sizeof(coordinate), g.positions_data()});
+  add_value_column(columns, g.values_data());
+  export_columns(columns, std::size_t(g.size()), array, schema);
+}
+
+/**
+ * Describe the edge table of @a g in @a array and @a schema, without
+ * copying: columns "endpoints" and, if exported, "value". As for
+ * export_nodes().
+ *
+ * @tparam G  Graph type with num_edges(), edge_endpoints_data() and
+ *            edge_values_data(), e.g. hw1/Graph-24726.hpp.
+ */
+template <typename G>
+void export_edges(const G& g, ArrowArray* array, ArrowSchema* schema) {
+  using namespace arrow_export_detail;
+  if constexpr (has_removals<G>::value) {
+    if (g.num_removed_nodes() || g.num_removed_edges())
+      throw std::runtime_error("arrow_export: compact() the graph before "
+                               "exporting it");
+  }
+  using index = std::decay_t<decltype(*g.edge_endpoints_data())>;
+  std::vector<column> columns;
+  columns.push_back({"endpoints", format_of<index>(), 2,
+                     g.edge_endpoints_data()});
+  add_value_column(columns, g.edge_values_data());
+  export_columns(columns, std::size_t(g.num_edges()), array, schema);
+}
+
+/**
+ * Write the record batch @a array, of struct type @a schema, to @a out as
+ * an Arrow IPC file.
+ * @throws std::runtime_error if a column has a type this file does not
+ *         write, nulls or an offset, or if writing fails
+ *
+ * The buffers go to the stream as they are, each padded to 8 bytes, so the
+ * cost is the write itself.
+ *
+ * Complexity: O(bytes of the arrays).
+ */
+inline void write_arrow_file(std::ostream& out, const ArrowSchema& schema,
+                             const ArrowArray& array) {
+  using namespace arrow_export_detail;
+  if (std::string(schema.format) != "+s")
+    throw std::runtime_error("arrow_export: a record batch must be a struct");
+
+  std::vector<std::int64_t> nodes;
+  std::vector<body_buffer> buffers;
+  for (std::int64_t i = 0; i < schema.n_children; ++i)
+    flatten(*schema.children[i], *array.children[i], nodes, buffers);
+  std::vector<std::int64_t> layout;          // {offset, length} pairs
+  std::int64_t body = 0;
+  for (const body_buffer& b : buffers) {
+    layout.push_back(body);
+    layout.push_back(std::int64_t(b.bytes));
+    body += (std::int64_t(b.bytes) + 7) / 8 * 8;
+  }
+  auto bytes = [](const std::vector<std::int64_t>& v) {
+    std::vector<std::uint8_t> b(v.size() * 8);
+    std::memcpy(b.data(), v.data(), b.size());
+    return b;
+  };
+
+  write(out, "ARROW1\0\0", 8);
+  std::int64_t offset = 8;
+
+  fb_table schema_message;
+  schema_message.add<std::int16_t>(0, metadata_v5)
+      .add<std::uint8_t>(1, header_schema)
+      .add_table(2, schema_table(schema))
+      .add<std::int64_t>(3, 0);
+  offset += std::int64_t(write_message(out, schema_message, [] {}));
+
+  fb_table batch;
+  batch.add<std::int64_t>(0, array.length)
+      .add_structs(1, bytes(nodes), 16)
+      .add_structs(2, bytes(layout), 16);
+  fb_table batch_message;
+  batch_message.add<std::int16_t>(0, metadata_v5)
+      .add<std::uint8_t>(1, header_record_batch)
+      .add_table(2, std::move(batch))
+      .add<std::int64_t>(3, body);
+  std::int64_t batch_offset = offset;
+  std::int32_t batch_meta = std::int32_t(write_message(out, batch_message, [&] {
+    for (const body_buffer& b : buffers) {
+      write(out, b.data, b.bytes);
+      write(out, nullptr, (8 - b.bytes % 8) % 8);
+    }
+  }));
+
+  std::uint32_t end_of_stream[2] = {0xFFFFFFFFu, 0};
+  write(out, end_of_stream, 8);
+
+  // Block {offset, metaDataLength, padding, bodyLength}
+  std::vector<std::uint8_t> block(24, 0);
+  std::memcpy(block.data(), &batch_offset, 8);
+  std::memcpy(block.data() + 8, &batch_meta, 4);
+  std::memcpy(block.data() + 16, &body, 8);
+  fb_table footer;
+  footer.add<std::int16_t>(0, metadata_v5)
+      .add_table(1, schema_table(schema))
+      .add_structs(2, {}, 24)
+      .add_structs(3, std::move(block), 24);
+  std::vector<std::uint8_t> fb = fb_writer().finish(footer);
+  std::int32_t size = std::int32_t(fb.size());
+  write(out, fb.data(), fb.size());
+  write(out, &size, 4);
+  write(out, "ARROW1", 6);
+}
+
+/**
+ * Write the nodes or edges of @a g to the file @a path as an Arrow IPC
+ * file, as export_nodes() or export_edges() describe them.
+ * @throws std::runtime_error if the file cannot be written, or as
+ *         export_nodes()
+ */
+template <typename G>
+void write_arrow_file(const std::string& path, const G& g, arrow_table table) {
+  ArrowArray array;
+  ArrowSchema schema;
+  if (table == arrow_table::nodes)
+    export_nodes(g, &array, &schema);
+  else
+    export_edges(g, &array, &schema);
+  std::unique_ptr<ArrowArray, void (*)(ArrowArray*)> array_guard(
+      &array, [](ArrowArray* a) { a->release(a); });
+  std::unique_ptr<ArrowSchema, void (*)(ArrowSchema*)> schema_guard(
+      &schema, [](ArrowSchema* s) { s->release(s); });
+  std::ofstream out(path, std::ios::binary);
+  if (!out)
+    throw std::runtime_error("arrow_export: cannot create " + path);
+  write_arrow_file(out, schema, array);
+}
+
+#endif // CME212_ARROW_EXPORT_HPP
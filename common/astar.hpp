@@ -0,0 +1,304 @@
+#ifndef CME212_ASTAR_HPP
+#define CME212_ASTAR_HPP
+
+/** @file astar.hpp
+ * @brief Point-to-point shortest paths by A* over a weighted snapshot of a
+ *        graph, for many queries on one graph.
+ *
+ * A single source search settles every node closer than the target; A*
+ * (Hart, Nilsson and Raphael, 1968) orders the search by distance so far
+ * plus the straight-line distance between node positions and the target,
+ * so on a road mesh it settles little more than a band around the path.
+ * The straight line never overestimates when every edge weighs at least
+ * the distance between its endpoints, as with euclidean_weight, so the
+ * paths found are shortest ones.
+ *
+ *   AStar<GraphType> engine(g);                  // once per graph
+ *   // per worker thread
+ *   AStar<GraphType>::scratch s;
+ *   std::vector<GraphType::size_type> path;
+ *   astar_report r = engine.run(source, target, s, &path);
+ *
+ * The open set is a binary heap indexed by node index, with a position
+ * table for decrease-key, rather than a std::priority_queue of proxies.
+ * A scratch keeps the heap and the per-node labels between queries and
+ * clears them by bumping a query stamp, so a query costs the nodes it
+ * touches, not num_nodes(). run() is const: threads share one engine and
+ * each brings its own scratch.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/delta_stepping.hpp"
+#include "common/trace.hpp"
+#include "CME212/Point.hpp"
+
+
+/** Tuning knobs for AStar. */
+struct astar_options {
+  /** Threads for building the snapshot. 0 means ThreadPool::shared(). */
+  unsigned threads = 0;
+  /** Factor of the straight-line heuristic. 1 is exact for weights no
+   * smaller than the endpoint distance; 0 turns A* into Dijkstra, for
+   * weights that may be smaller; above 1 trades optimality for speed. */
+  double heuristic_scale = 1;
+};
+
+/** What one query did. */
+struct astar_report {
+  bool found = false;                 // the target is reachable
+  double distance = std::numeric_limits<double>::infinity();
+  std::uint64_t settled = 0;          // nodes taken from the open set
+  std::uint64_t relaxations = 0;      // arcs relaxed
+};
+
+
+/** @class AStar
+ * @brief Reusable point-to-point shortest path engine.
+ *
+ * The constructor copies the node positions and evaluates the weight of
+ * every incident edge once into a CSR array, as DeltaStepping does, so the
+ * queries never call back into the graph. Changes to the graph after
+ * construction are not seen.
+ *
+ * @tparam G  Graph type with size(), node(i).position(),
+ *            node(i).edge_begin()/edge_end() and size_type.
+ */
+template <typename G>
+class AStar {
+ public:
+  /** Type of node indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Per-thread state of the queries: node labels and the open set. Reused
+   * across queries, and may be used with several engines. */
+  class scratch {
+   public:
+    scratch() = default;
+
+   private:
+    friend class AStar;
+    // The open set: a binary heap on key, where node n sits at
+    // heap[label[n].slot] while it is open
+    struct entry {
+      double key;
+      size_type node;
+    };
+    // Valid for this query only if stamp matches the scratch's
+    struct label {
+      double dist;
+      size_type parent;
+      size_type slot;
+      std::uint32_t stamp = 0;
+    };
+    std::vector<label> labels;
+    std::vector<entry> heap;
+    std::uint32_t stamp = 0;
+  };
+
+  /** Snapshot @a g, weighting each edge by @a weight.
+   * @pre @a weight returns a non-negative finite value for every edge
+   *
+   * Complexity: O(g.size() + g.num_edges()) weight evaluations and work,
+   * spread over opt.threads threads.
+   */
+  template <typename Weight = euclidean_weight>
+  explicit AStar(const G& g, Weight weight = Weight(),
+                 const astar_options& opt = astar_options())
+      : n_(std::size_t(g.size())), scale_(opt.heuristic_scale) {
+    unsigned threads = csr_snapshot::thread_count(opt.threads);
+    offsets_ = csr_snapshot::row_offsets(g, threads);
+    arcs_.resize(offsets_[n_]);
+    csr_snapshot::fill_rows(g, offsets_, threads,
+        [&](std::size_t k, const auto& e) {
+          arcs_[k] = arc{e.node2().index(), weight(e)};
+          assert(arcs_[k].weight >= 0);
+        });
+    positions_.resize(n_);
+    csr_snapshot::parallel_ranges(threads, n_, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i)
+            positions_[i] = g.node(size_type(i)).position();
+        });
+  }
+
+  /** Return the number of nodes in the snapshot. */
+  size_type size() const {
+    return size_type(n_);
+  }
+
+  /** Find a shortest path from @a source to @a target.
+   * @param[in,out] s  Scratch of the calling thread
+   * @param[out] path  If not null, set to the nodes of the path from
+   *                   @a source to @a target, or emptied if there is none
+   * @return Whether a path was found, its length and the search's counts
+   *
+   * @pre @a source < size() and @a target < size()
+   *
+   * Complexity: O((S + R) log S) for the S nodes settled and R arcs
+   * relaxed; O(size()) on the first query with @a s and once every 2^32
+   * queries.
+   */
+  astar_report run(size_type source, size_type target, scratch& s,
+                   std::vector<size_type>* path = nullptr) const {
+    assert(std::size_t(source) < n_ && std::size_t(target) < n_);
+    CME212_TRACE_SCOPE("astar");
+    astar_report report;
+    begin(s);
+    const Point goal = positions_[target];
+
+    open(s, source, 0, source, heuristic(source, goal));
+    while (!s.heap.empty()) {
+      size_type u = pop(s);
+      ++report.settled;
+      if (u == target) {
+        report.found = true;
+        break;
+      }
+      double du = s.labels[u].dist;
+      for (std::size_t j = offsets_[u]; j < offsets_[u + 1]; ++j) {
+        const arc& a = arcs_[j];
+        ++report.relaxations;
+        double d = du + a.weight;
+        auto& l = s.labels[a.node];
+        if (l.stamp != s.stamp)
+          open(s, a.node, d, u, d + heuristic(a.node, goal));
+        else if (d < l.dist && l.slot != closed)
+          lower(s, a.node, d, u, d + heuristic(a.node, goal));
+      }
+    }
+
+    if (report.found)
+      report.distance = s.labels[target].dist;
+    if (path) {
+      path->clear();
+      if (report.found) {
+        for (size_type v = target; v != source; v = s.labels[v].parent)
+          path->push_back(v);
+        path->push_back(source);
+        std::reverse(path->begin(), path->end());
+      }
+    }
+    return report;
+  }
+
+  /** Return the length of a shortest path from @a source to @a target, or
+   * infinity if there is none, with a scratch of this engine's own.
+   * Not for concurrent use; give each thread a scratch and call run()
+   * instead. */
+  double distance(size_type source, size_type target) {
+    return run(source, target, own_).distance;
+  }
+
+ private:
+  // One incidence: the neighbor across the edge and the edge's weight
+  struct arc {
+    size_type node;
+    double weight;
+  };
+  // Heap slot of nodes that have been settled
+  static constexpr size_type closed = size_type(-1);
+
+  std::size_t n_;
+  double scale_;
+  std::vector<std::size_t> offsets_;    // row i is arcs_[offsets_[i]..)
+  std::vector<arc> arcs_;
+  std::vector<Point> positions_;
+  scratch own_;                         // behind distance()
+
+  double heuristic(size_type v, const Point& goal) const {
+    return scale_ * norm(positions_[v] - goal);
+  }
+
+  /** Start a query on @a s: every label becomes stale. */
+  void begin(scratch& s) const {
+    s.heap.clear();
+    if (s.labels.size() < n_)
+      s.labels.resize(n_);
+    if (++s.stamp == 0) {
+      // The stamp wrapped: old labels could look current
+      for (auto& l : s.labels)
+        l.stamp = 0;
+      s.stamp = 1;
+    }
+  }
+
+  /** Label @a v with distance @a d via @a parent and put it in the open
+   * set with @a key. */
+  void open(scratch& s, size_type v, double d, size_type parent,
+            double key) const {
+    auto& l = s.labels[v];
+    l.dist = d;
+    l.parent = parent;
+    l.stamp = s.stamp;
+    l.slot = size_type(s.heap.size());
+    s.heap.push_back({key, v});
+    sift_up(s, l.slot);
+  }
+
+  /** Lower the distance of open node @a v to @a d via @a parent, and its
+   * key to @a key. */
+  void lower(scratch& s, size_type v, double d, size_type parent,
+             double key) const {
+    auto& l = s.labels[v];
+    l.dist = d;
+    l.parent = parent;
+    s.heap[l.slot].key = key;
+    sift_up(s, l.slot);
+  }
+
+  /** Take the node of smallest key from the open set and close it. */
+  size_type pop(scratch& s) const {
+    size_type u = s.heap.front().node;
+    s.labels[u].slot = closed;
+    s.heap.front() = s.heap.back();
+    s.heap.pop_back();
+    if (!s.heap.empty()) {
+      s.labels[s.heap.front().node].slot = 0;
+      sift_down(s, 0);
+    }
+    return u;
+  }
+
+  void sift_up(scratch& s, size_type i) const {
+    auto x = s.heap[i];
+    while (i > 0) {
+      size_type p = (i - 1) / 2;
+      if (!(x.key < s.heap[p].key))
+        break;
+      s.heap[i] = s.heap[p];
+      s.labels[s.heap[i].node].slot = i;
+      i = p;
+    }
+    s.heap[i] = x;
+    s.labels[x.node].slot = i;
+  }
+
+  void sift_down(scratch& s, size_type i) const {
+    auto x = s.heap[i];
+    std::size_t n = s.heap.size();
+    for (;;) {
+      std::size_t c = 2 * std::size_t(i) + 1;
+      if (c >= n)
+        break;
+      if (c + 1 < n && s.heap[c + 1].key < s.heap[c].key)
+        ++c;
+      if (!(s.heap[c].key < x.key))
+        break;
+      s.heap[i] = s.heap[c];
+      s.labels[s.heap[i].node].slot = i;
+      i = size_type(c);
+    }
+    s.heap[i] = x;
+    s.labels[x.node].slot = i;
+  }
+};
+
+#endif // CME212_ASTAR_HPP
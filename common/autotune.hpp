@@ -0,0 +1,631 @@
+#ifndef CME212_AUTOTUNE_HPP
+#define CME212_AUTOTUNE_HPP
+
+/** @file autotune.hpp
+ * @brief Picks an adjacency storage policy, a node order, a thread count
+ *        and a chunk size for one graph by timing a short workload on it,
+ *        and remembers the choice for graphs of the same shape.
+ *
+ * Which adjacency_storage.hpp policy is fastest depends on the degrees and
+ * the mix of iteration and has_edge() calls; which node order helps depends
+ * on how local the positions and the topology are; and the grain of
+ * csr_snapshot::parallel_ranges() and the thread count pay off only above
+ * some work per range. Autotuner measures all four on the graph at hand:
+ *
+ *   adjacency  Each policy's storage is built from the graph's edges and
+ *              timed on autotune_options::passes sweeps over every row plus
+ *              autotune_options::lookups has_edge() queries, a hit_rate
+ *              share of them existing edges. dense_adjacency is tried only
+ *              up to dense_limit nodes.
+ *   order      The snapshot is renumbered by each of Graph::Order's
+ *              orderings, Hilbert, Morton and reverse Cuthill-McKee, and
+ *              kept as is, and each is timed on sweeps that read the
+ *              positions of every node's neighbors, as spring forces do.
+ *   threads    The sweep in the best order is timed for every grain of
+ *   grain      autotune_options::grains on 1, 2, 4, ... threads.
+ *
+ *   Autotuner<GraphType> tuner(g);
+ *   autotune_options opt;
+ *   opt.cache_path = "graph.tuning";
+ *   autotune_report r = tuner.tune(opt);     // read from the file if known
+ *   with_adjacency(r.best.adjacency, [&](auto policy) {
+ *     Graph<V, decltype(policy)> h;          // hw1/Graph-5038.hpp
+ *     ...
+ *   });
+ *
+ * Decisions are stored by graph_shape::key(): the node count, mean and
+ * largest degree, each rounded to a power of two, and the hardware thread
+ * count. A graph of the same shape on the same machine reuses the decision
+ * without timing anything. The cache is a text file of one line per shape,
+ *
+ *   <key> <adjacency> <order> <threads> <grain>
+ *
+ * with the names of adjacency_name() and order_name(), so it can be read
+ * and edited by hand.
+ *
+ * The timings are wall clock times of a few milliseconds each, the least
+ * of autotune_options::repeats runs, so they carry noise: choices whose
+ * times differ by a few percent are equally good.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/adjacency_storage.hpp"
+#include "common/csr_snapshot.hpp"
+#include "common/graph_generators.hpp"
+#include "common/space_filling_curve.hpp"
+#include "common/trace.hpp"
+
+
+/** The adjacency storage policies of adjacency_storage.hpp. */
+enum class adjacency_choice { list, sorted, hash, dense };
+
+/** The node orders of Graph::reorder(), and none for the order as is. */
+enum class order_choice { none, hilbert, morton, rcm };
+
+/** Return the name of @a a: "list", "sorted", "hash" or "dense". */
+inline const char* adjacency_name(adjacency_choice a) {
+  switch (a) {
+    case adjacency_choice::sorted: return "sorted";
+    case adjacency_choice::hash:   return "hash";
+    case adjacency_choice::dense:  return "dense";
+    default:                       return "list";
+  }
+}
+
+/** Return the name of @a o: "none", "hilbert", "morton" or "rcm". */
+inline const char* order_name(order_choice o) {
+  switch (o) {
+    case order_choice::hilbert: return "hilbert";
+    case order_choice::morton:  return "morton";
+    case order_choice::rcm:     return "rcm";
+    default:                    return "none";
+  }
+}
+
+/** Call fn with a value of the policy type @a a names, e.g. to build a
+ * Graph<V, decltype(policy)>, and return its result. */
+template <typename Fn>
+decltype(auto) with_adjacency(adjacency_choice a, Fn&& fn) {
+  switch (a) {
+    case adjacency_choice::sorted: return fn(sorted_adjacency());
+    case adjacency_choice::hash:   return fn(hash_adjacency());
+    case adjacency_choice::dense:  return fn(dense_adjacency());
+    default:                       return fn(list_adjacency());
+  }
+}
+
+
+/** Size and degree statistics by which decisions are cached. */
+struct graph_shape {
+  std::uint64_t nodes = 0;
+  std::uint64_t edges = 0;        // undirected: half the incidences
+  std::uint64_t max_degree = 0;
+  unsigned hardware_threads = 0;
+
+  /** Return the cache key: log2 of the node count, of the mean degree and
+   * of the largest degree, rounded, and the hardware thread count. */
+  std::string key() const {
+    double mean = nodes ? 2.0 * double(edges) / double(nodes) : 0.0;
+    std::ostringstream out;
+    out << "n" << log2_round(double(nodes)) << "-d" << log2_round(mean)
+        << "-m" << log2_round(double(max_degree)) << "-t"
+        << hardware_threads;
+    return out.str();
+  }
+
+ private:
+  static int log2_round(double x) {
+    return x < 1 ? -1 : int(std::lround(std::log2(x)));
+  }
+};
+
+/** A decision of Autotuner::tune(). */
+struct tuning {
+  adjacency_choice adjacency = adjacency_choice::list;
+  order_choice order = order_choice::none;
+  unsigned threads = 1;
+  std::size_t grain = 1024;
+};
+
+/** The workload Autotuner::tune() times, and where it keeps decisions. */
+struct autotune_options {
+  /** Sweeps over every row per timed run. */
+  unsigned passes = 4;
+  /** has_edge() queries per timed run of a storage policy. */
+  std::size_t lookups = 100000;
+  /** Share of the queries that ask about an existing edge. */
+  double hit_rate = 0.5;
+  /** Count the time to build each storage from the edges, once. */
+  bool count_build = true;
+  /** Largest node count for which dense_adjacency is tried. */
+  std::size_t dense_limit = std::size_t(1) << 14;
+  /** Grains tried for the parallel sweep; those above size() are not. */
+  std::vector<std::size_t> grains = {256, 1024, 4096, 16384};
+  /** Most threads tried; 0 means the size of ThreadPool::shared(). */
+  unsigned max_threads = 0;
+  /** Runs per candidate; the fastest counts. */
+  unsigned repeats = 3;
+  /** File of decisions by shape; empty to neither read nor write one. */
+  std::string cache_path;
+  std::uint64_t seed = 1;
+};
+
+/** One candidate timed by Autotuner::tune(). */
+struct autotune_trial {
+  std::string what;   // e.g. "adjacency sorted", "order rcm", "grain 4 1024"
+  double seconds = 0;
+};
+
+/** The decision of Autotuner::tune() and how it was reached. */
+struct autotune_report {
+  tuning best;
+  graph_shape shape;
+  bool cached = false;                 // read from cache_path, nothing timed
+  std::vector<autotune_trial> trials;  // in the order they ran
+  double seconds = 0;
+};
+
+
+namespace autotune_detail {
+
+/** Set @a out to the choice @a name names; return false if none does. */
+template <typename Choice, typename Name, std::size_t N>
+bool parse_choice(const std::string& name, const Choice (&all)[N],
+                  Name name_of, Choice& out) {
+  for (Choice c : all) {
+    if (name == name_of(c)) {
+      out = c;
+      return true;
+    }
+  }
+  return false;
+}
+
+inline bool parse(const std::string& name, adjacency_choice& out) {
+  static const adjacency_choice all[] = {
+      adjacency_choice::list, adjacency_choice::sorted,
+      adjacency_choice::hash, adjacency_choice::dense};
+  return parse_choice(name, all, adjacency_name, out);
+}
+
+inline bool parse(const std::string& name, order_choice& out) {
+  static const order_choice all[] = {order_choice::none, order_choice::hilbert,
+                                     order_choice::morton, order_choice::rcm};
+  return parse_choice(name, all, order_name, out);
+}
+
+} // end namespace autotune_detail
+
+
+/** Look up the decision stored for @a key in the cache file @a path.
+ * @return true and set @a out if found; false if the file or the key is
+ *         missing. Lines that do not parse are skipped. */
+inline bool load_tuning(const std::string& path, const std::string& key,
+                        tuning& out) {
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string k, adjacency, order;
+    tuning t;
+    if (!(fields >> k >> adjacency >> order >> t.threads >> t.grain) ||
+        k != key || t.threads == 0 || t.grain == 0)
+      continue;
+    if (autotune_detail::parse(adjacency, t.adjacency) &&
+        autotune_detail::parse(order, t.order)) {
+      out = t;
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Store @a t for @a key in the cache file @a path, replacing any earlier
+ * decision for it and keeping the others.
+ * @throws std::runtime_error if the file cannot be written
+ *
+ * The file is rewritten to a temporary beside it and renamed over it, so
+ * a reader sees the old file or the new one, never half of one. */
+inline void save_tuning(const std::string& path, const std::string& key,
+                        const tuning& t) {
+  std::vector<std::string> lines;
+  {
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+      std::istringstream fields(line);
+      std::string k;
+      if (fields >> k && k != key)
+        lines.push_back(line);
+    }
+  }
+  std::ostringstream entry;
+  entry << key << ' ' << adjacency_name(t.adjacency) << ' '
+        << order_name(t.order) << ' ' << t.threads << ' ' << t.grain;
+  lines.push_back(entry.str());
+
+  std::string temp = path + ".tmp";
+  {
+    std::ofstream out(temp, std::ios::trunc);
+    for (const std::string& line : lines)
+      out << line << '\n';
+    if (!out.flush())
+      throw std::runtime_error("autotune: cannot write " + temp);
+  }
+  if (std::rename(temp.c_str(), path.c_str()) != 0)
+    throw std::runtime_error("autotune: cannot replace " + path);
+}
+
+
+/** @class Autotuner
+ * @brief Times storage policies, node orders, thread counts and grains on
+ *        a snapshot of one graph.
+ *
+ * The constructor copies the adjacency into CSR arrays and the positions
+ * into an array; the graph is not touched again, and the decision is
+ * applied by the caller: with_adjacency() for the policy, Graph::reorder()
+ * for the order, and the threads and grain for its parallel_ranges() calls.
+ *
+ * @tparam G  Graph type with size(), node(i).position(),
+ *            node(i).edge_begin()/edge_end() and size_type.
+ */
+template <typename G>
+class Autotuner {
+ public:
+  /** Type of node indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Snapshot the adjacency and positions of @a g.
+   * Complexity: O(g.size() + g.num_edges()). */
+  explicit Autotuner(const G& g)
+      : n_(std::size_t(g.size())),
+        offsets_(csr_snapshot::row_offsets(g, 0)) {
+    neighbors_.resize(offsets_[n_]);
+    csr_snapshot::fill_neighbors(g, offsets_, 0, neighbors_.data());
+    positions_.resize(n_);
+    for (std::size_t i = 0; i < n_; ++i)
+      positions_[i] = g.node(size_type(i)).position();
+  }
+
+  /** Return the shape of the snapshot on this machine. */
+  graph_shape shape() const {
+    graph_shape s;
+    s.nodes = n_;
+    s.edges = offsets_[n_] / 2;
+    for (std::size_t i = 0; i < n_; ++i)
+      s.max_degree = std::max<std::uint64_t>(s.max_degree,
+                                             offsets_[i + 1] - offsets_[i]);
+    s.hardware_threads = ThreadPool::shared().size();
+    return s;
+  }
+
+  /** Return the decision for this graph: the one stored for its shape in
+   * opt.cache_path if there is one, and otherwise the fastest candidates,
+   * which are then stored there.
+   * @throws std::runtime_error if the decision cannot be stored
+   *
+   * The choices are made one after the other: the policy, then the order,
+   * then threads and grain in that order.
+   *
+   * Complexity: O((size() + number of edges) * passes * candidates +
+   * lookups * policies) when nothing is cached, plus the storages' build
+   * times.
+   */
+  autotune_report tune(const autotune_options& opt = autotune_options()) {
+    CME212_TRACE_SCOPE("autotune");
+    auto start = std::chrono::steady_clock::now();
+    autotune_report report;
+    report.shape = shape();
+    std::string key = report.shape.key();
+    if (!opt.cache_path.empty() &&
+        load_tuning(opt.cache_path, key, report.best)) {
+      report.cached = true;
+      report.seconds = elapsed(start);
+      return report;
+    }
+
+    report.best.adjacency = pick_adjacency(opt, report);
+    std::vector<std::size_t> offsets;
+    std::vector<size_type> neighbors;
+    std::vector<Point> positions;
+    report.best.order = pick_order(opt, report, offsets, neighbors,
+                                   positions);
+    pick_parallel(opt, report, offsets, neighbors, positions);
+
+    if (!opt.cache_path.empty())
+      save_tuning(opt.cache_path, key, report.best);
+    report.seconds = elapsed(start);
+    return report;
+  }
+
+ private:
+  // Salt of the query stream, apart from the generators' and samplers'
+  static constexpr std::uint64_t query_salt = 5;
+
+  std::size_t n_;
+  std::vector<std::size_t> offsets_;   // row i is neighbors_[offsets_[i]..)
+  std::vector<size_type> neighbors_;
+  std::vector<Point> positions_;
+  // Results of the timed loops, written so they are not optimized away
+  volatile double sink_ = 0;
+
+  static double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+  }
+
+  /** Return the least wall time of @a repeats calls of @a fn. */
+  template <typename Fn>
+  static double best_of(unsigned repeats, Fn&& fn) {
+    double best = 0;
+    for (unsigned r = 0; r < std::max(1u, repeats); ++r) {
+      auto start = std::chrono::steady_clock::now();
+      fn();
+      double t = elapsed(start);
+      best = r == 0 ? t : std::min(best, t);
+    }
+    return best;
+  }
+
+  /** Return the fastest storage policy for the workload. */
+  adjacency_choice pick_adjacency(const autotune_options& opt,
+                                  autotune_report& report) {
+    // The queries: existing edges at hit_rate, random pairs otherwise
+    std::vector<std::pair<size_type, size_type>> queries(
+        n_ < 2 ? 0 : opt.lookups);
+    graph_generators_detail::element_rng rng(opt.seed, query_salt, 0);
+    for (auto& q : queries) {
+      if (offsets_[n_] != 0 && rng.uniform() < opt.hit_rate) {
+        std::size_t k = std::size_t(rng.below(offsets_[n_]));
+        std::size_t a = std::upper_bound(offsets_.begin(), offsets_.end(), k) -
+                        offsets_.begin() - 1;
+        q = {size_type(a), neighbors_[k]};
+      } else {
+        q = {size_type(rng.below(n_)), size_type(rng.below(n_))};
+      }
+    }
+
+    adjacency_choice best = adjacency_choice::list;
+    double best_time = -1;
+    for (adjacency_choice a : {adjacency_choice::list, adjacency_choice::sorted,
+                               adjacency_choice::hash,
+                               adjacency_choice::dense}) {
+      if (a == adjacency_choice::dense && n_ > opt.dense_limit)
+        continue;
+      double t = with_adjacency(a, [&](auto policy) {
+        return time_storage<decltype(policy)>(opt, queries);
+      });
+      report.trials.push_back({std::string("adjacency ") + adjacency_name(a),
+                               t});
+      if (best_time < 0 || t < best_time) {
+        best = a;
+        best_time = t;
+      }
+    }
+    return best;
+  }
+
+  /** Return the time of the workload on policy P's storage. */
+  template <typename P>
+  double time_storage(
+      const autotune_options& opt,
+      const std::vector<std::pair<size_type, size_type>>& queries) {
+    typename P::template storage<size_type> s;
+    auto build = [&] {
+      s.clear();
+      for (std::size_t i = 0; i < n_; ++i)
+        s.add_node();
+      for (std::size_t a = 0; a < n_; ++a) {
+        for (std::size_t k = offsets_[a]; k < offsets_[a + 1]; ++k) {
+          size_type b = neighbors_[k];
+          if (std::size_t(b) > a && !s.contains(size_type(a), b))
+            s.insert(size_type(a), b);
+        }
+      }
+    };
+    double t = best_of(opt.count_build ? opt.repeats : 1, build);
+    if (!opt.count_build)
+      t = 0;
+    t += best_of(opt.repeats, [&] {
+      std::uint64_t sum = 0;
+      for (unsigned p = 0; p < opt.passes; ++p) {
+        for (std::size_t a = 0; a < n_; ++a) {
+          size_type u = size_type(a);
+          for (auto c = s.begin(u); c != s.end(u); c = s.next(u, c))
+            sum += s.neighbor(u, c);
+        }
+      }
+      for (const auto& q : queries)
+        sum += q.first != q.second && s.contains(q.first, q.second);
+      sink_ = double(sum);
+    });
+    return t;
+  }
+
+  /** Return the fastest node order for the position sweep, and set
+   * @a offsets, @a neighbors and @a positions to the snapshot in it. */
+  order_choice pick_order(const autotune_options& opt,
+                          autotune_report& report,
+                          std::vector<std::size_t>& offsets,
+                          std::vector<size_type>& neighbors,
+                          std::vector<Point>& positions) {
+    order_choice best = order_choice::none;
+    double best_time = -1;
+    std::vector<std::size_t> o;
+    std::vector<size_type> nb;
+    std::vector<Point> pos;
+    for (order_choice c : {order_choice::none, order_choice::hilbert,
+                           order_choice::morton, order_choice::rcm}) {
+      renumber(sequence(c), o, nb, pos);
+      double t = best_of(opt.repeats, [&] {
+        double sum = 0;
+        for (unsigned p = 0; p < opt.passes; ++p)
+          sum += sweep(o, nb, pos, 0, n_);
+        sink_ = sum;
+      });
+      report.trials.push_back({std::string("order ") + order_name(c), t});
+      if (best_time < 0 || t < best_time) {
+        best = c;
+        best_time = t;
+        offsets.swap(o);
+        neighbors.swap(nb);
+        positions.swap(pos);
+      }
+    }
+    return best;
+  }
+
+  /** Set the threads and grain of report.best to the fastest pair for the
+   * position sweep over the given snapshot. */
+  void pick_parallel(const autotune_options& opt, autotune_report& report,
+                     const std::vector<std::size_t>& offsets,
+                     const std::vector<size_type>& neighbors,
+                     const std::vector<Point>& positions) {
+    unsigned most = csr_snapshot::thread_count(opt.max_threads);
+    std::vector<unsigned> counts;
+    for (unsigned t = 1; t < most; t *= 2)
+      counts.push_back(t);
+    counts.push_back(most);
+    std::vector<std::size_t> grains;
+    for (std::size_t g : opt.grains) {
+      if (g > 0 && (g <= n_ || grains.empty()))
+        grains.push_back(g);
+    }
+    if (grains.empty())
+      grains.push_back(1024);
+
+    double best_time = -1;
+    for (unsigned threads : counts) {
+      for (std::size_t grain : grains) {
+        std::vector<double> sums(threads, 0.0);
+        double t = best_of(opt.repeats, [&] {
+          for (unsigned p = 0; p < opt.passes; ++p) {
+            csr_snapshot::parallel_ranges(threads, n_, grain,
+                [&](unsigned r, std::size_t b, std::size_t e) {
+                  sums[r] += sweep(offsets, neighbors, positions, b, e);
+                });
+          }
+          sink_ = sums[0];
+        });
+        report.trials.push_back({"grain " + std::to_string(threads) + " " +
+                                     std::to_string(grain), t});
+        if (best_time < 0 || t < best_time) {
+          report.best.threads = threads;
+          report.best.grain = grain;
+          best_time = t;
+        }
+      }
+    }
+  }
+
+  /** Return the summed lengths of the edges of nodes [@a b, @a e), read
+   * from both ends, as a spring force pass reads positions. */
+  static double sweep(const std::vector<std::size_t>& offsets,
+                      const std::vector<size_type>& neighbors,
+                      const std::vector<Point>& positions,
+                      std::size_t b, std::size_t e) {
+    double sum = 0;
+    for (std::size_t i = b; i < e; ++i) {
+      const Point& p = positions[i];
+      for (std::size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+        const Point& q = positions[neighbors[k]];
+        double dx = p.x - q.x, dy = p.y - q.y, dz = p.z - q.z;
+        sum += std::sqrt(dx * dx + dy * dy + dz * dz);
+      }
+    }
+    return sum;
+  }
+
+  /** Return the old node indices in the new order @a c gives them. */
+  std::vector<std::size_t> sequence(order_choice c) const {
+    if (c == order_choice::hilbert)
+      return sfc::curve_order(positions_.data(), n_, sfc::hilbert_key);
+    if (c == order_choice::morton)
+      return sfc::curve_order(positions_.data(), n_, sfc::morton_key);
+    if (c == order_choice::rcm)
+      return rcm_sequence();
+    std::vector<std::size_t> seq(n_);
+    for (std::size_t i = 0; i < n_; ++i)
+      seq[i] = i;
+    return seq;
+  }
+
+  /** Return the reverse Cuthill-McKee order of the snapshot: each
+   * component breadth first from a node of least degree, neighbors by
+   * increasing degree, and the whole sequence reversed. Graph::reorder()
+   * also starts each component from a pseudo-peripheral node, which for
+   * timing the order's locality makes little difference. */
+  std::vector<std::size_t> rcm_sequence() const {
+    auto degree = [&](std::size_t v) {
+      return offsets_[v + 1] - offsets_[v];
+    };
+    std::vector<std::size_t> by_degree(n_);
+    for (std::size_t i = 0; i < n_; ++i)
+      by_degree[i] = i;
+    std::stable_sort(by_degree.begin(), by_degree.end(),
+                     [&](std::size_t a, std::size_t b) {
+                       return degree(a) < degree(b);
+                     });
+    std::vector<char> seen(n_, 0);
+    std::vector<std::size_t> seq;
+    seq.reserve(n_);
+    for (std::size_t root : by_degree) {
+      if (seen[root])
+        continue;
+      seen[root] = 1;
+      seq.push_back(root);
+      for (std::size_t head = seq.size() - 1; head < seq.size(); ++head) {
+        std::size_t u = seq[head], first = seq.size();
+        for (std::size_t k = offsets_[u]; k < offsets_[u + 1]; ++k) {
+          std::size_t v = neighbors_[k];
+          if (!seen[v]) {
+            seen[v] = 1;
+            seq.push_back(v);
+          }
+        }
+        std::stable_sort(seq.begin() + first, seq.end(),
+                         [&](std::size_t a, std::size_t b) {
+                           return degree(a) < degree(b);
+                         });
+      }
+    }
+    std::reverse(seq.begin(), seq.end());
+    return seq;
+  }
+
+  /** Set @a offsets, @a neighbors and @a positions to the snapshot with
+   * node seq[k] renumbered k. */
+  void renumber(const std::vector<std::size_t>& seq,
+                std::vector<std::size_t>& offsets,
+                std::vector<size_type>& neighbors,
+                std::vector<Point>& positions) const {
+    std::vector<size_type> perm(n_);
+    for (std::size_t k = 0; k < n_; ++k)
+      perm[seq[k]] = size_type(k);
+    offsets.assign(n_ + 1, 0);
+    neighbors.resize(neighbors_.size());
+    positions.resize(n_);
+    for (std::size_t k = 0; k < n_; ++k) {
+      std::size_t old = seq[k];
+      positions[k] = positions_[old];
+      std::size_t at = offsets[k];
+      for (std::size_t j = offsets_[old]; j < offsets_[old + 1]; ++j)
+        neighbors[at++] = perm[neighbors_[j]];
+      offsets[k + 1] = at;
+    }
+  }
+};
+
+#endif // CME212_AUTOTUNE_HPP
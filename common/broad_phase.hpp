@@ -0,0 +1,394 @@
+#ifndef CME212_BROAD_PHASE_HPP
+#define CME212_BROAD_PHASE_HPP
+
+/** @file broad_phase.hpp
+ * @brief Self-collision broad phase: every pair of nodes closer than a
+ *        contact distance, found through a uniform grid rebuilt per step.
+ *
+ * A cloth step that tests node-node contacts with two nested loops over
+ * node_begin()..node_end() costs O(N^2). BroadPhase puts the nodes into
+ * cubic cells as wide as the contact distance, so only nodes in the same
+ * or adjacent cells are compared:
+ *
+ *   BroadPhase<G> broad;                    // keep it across time steps
+ *   std::vector<BroadPhase<G>::pair_type> contacts;
+ *   for (int step = 0; step < steps; ++step) {
+ *     advance(g, dt);
+ *     broad.find(g, 2 * radius, contacts);  // pairs within 2 * radius
+ *     for (auto [a, b] : contacts)
+ *       push_apart(g.node(a), g.node(b));
+ *   }
+ *
+ * Rather than hashing cells into buckets, which makes every neighbor cell
+ * lookup a cache miss, the nodes are radix sorted by a cell key that
+ * orders cells by z, then y, then x. The cells a node searches then form
+ * a few runs of consecutive keys, and those runs only move forward as the
+ * node does, so the search streams through the sorted arrays with one
+ * cursor per run and no lookups at all. Every phase runs on the threads of
+ * ThreadPool::shared(): cell keys straight from positions_data() where the
+ * graph has it (hw1/Graph-24726.hpp), the sort, and the search, in which
+ * each node looks at its own cell and the 13 neighbor cells "after" it, so
+ * every pair is met once. Pairs joined by an edge are no contacts; they
+ * are dropped with one batched has_edges() call where the graph has it,
+ * or has_edge() per pair otherwise. The buffers are kept between calls, so
+ * a step allocates nothing once they have grown.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/graph_traits.hpp"
+#include "common/trace.hpp"
+#include "CME212/Point.hpp"
+
+
+/** Options of BroadPhase. */
+struct broad_phase_options {
+  /** Threads to search with; 0 means all cores. */
+  unsigned threads = 0;
+  /** Leave out pairs of nodes that share an edge. */
+  bool exclude_edges = true;
+};
+
+/** What BroadPhase::find() found. */
+struct broad_phase_report {
+  std::size_t candidates = 0;  // pairs within the distance, edges included
+  std::size_t excluded = 0;    // of them, pairs that share an edge
+  unsigned key_bits = 0;       // bits of the cell keys that were sorted
+};
+
+
+namespace broad_phase_detail {
+
+template <typename G, typename P, typename = void>
+struct has_batched_has_edge : std::false_type {};
+template <typename G, typename P>
+struct has_batched_has_edge<G, P, std::void_t<decltype(
+    std::declval<const G&>().has_edges(std::declval<const P*>(),
+                                       typename G::size_type(0),
+                                       std::declval<bool*>(), 0u))>>
+    : std::true_type {};
+
+/** Return the number of bits needed to write @a v. */
+inline unsigned bit_width(std::uint64_t v) {
+  unsigned b = 0;
+  while (v != 0) {
+    ++b;
+    v >>= 1;
+  }
+  return b;
+}
+
+} // end namespace broad_phase_detail
+
+
+/** @class BroadPhase
+ * @brief Finds the pairs of nodes of a graph that lie within a distance of
+ *        each other, reusing its buffers from call to call.
+ *
+ * @tparam G  Graph type with size(), node(i).position() and has_edge().
+ */
+template <typename G>
+class BroadPhase {
+ public:
+  using size_type = typename G::size_type;
+  /** A contact, as (smaller index, larger index). */
+  using pair_type = std::pair<size_type, size_type>;
+
+  explicit BroadPhase(const broad_phase_options& opt = {})
+      : opt_(opt) {
+  }
+
+  /** Replace @a pairs by every pair of nodes of @a g at most @a distance
+   * apart.
+   *
+   * @pre @a distance > 0
+   * @post Every (a, b) in @a pairs has a < b and
+   *       norm(g.node(a).position() - g.node(b).position()) <= @a distance,
+   *       every such pair is listed once, and unless the options say
+   *       otherwise, no listed pair shares an edge.
+   * @throws std::runtime_error if the nodes span so many cells that a cell
+   *         key does not fit in 64 bits
+   *
+   * The pairs come in cell order: the same positions give the same list,
+   * whatever the thread count.
+   *
+   * Complexity: O(g.size() + number of node pairs in adjacent cells),
+   * spread over the threads.
+   */
+  broad_phase_report find(const G& g, double distance,
+                          std::vector<pair_type>& pairs) {
+    CME212_TRACE_SCOPE_N("broad_phase", g.size());
+    assert(distance > 0);
+    unsigned threads = csr_snapshot::thread_count(opt_.threads);
+    std::size_t n = std::size_t(g.size());
+    pairs.clear();
+    broad_phase_report report;
+    if (n < 2)
+      return report;
+
+    const Point* pos = positions(g, threads);
+    report.key_bits = make_keys(pos, n, 1 / distance, threads);
+    sort_keys(n, report.key_bits, threads);
+    sorted_pos_.resize(n);
+    csr_snapshot::parallel_ranges(threads, n, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t s = b; s < e; ++s)
+            sorted_pos_[s] = pos[index_[s]];
+        });
+    search(n, distance * distance, threads);
+
+    std::size_t total = 0;
+    for (const std::vector<pair_type>& found : found_)
+      total += found.size();
+    pairs.reserve(total);
+    for (std::vector<pair_type>& found : found_)
+      pairs.insert(pairs.end(), found.begin(), found.end());
+    report.candidates = pairs.size();
+    if (opt_.exclude_edges)
+      report.excluded = drop_edges(g, pairs, threads);
+    return report;
+  }
+
+ private:
+  // Number of key bits each radix sort pass handles
+  static constexpr unsigned radix_bits = 11;
+  static constexpr std::size_t radix = std::size_t(1) << radix_bits;
+
+  broad_phase_options opt_;
+  std::vector<Point> gathered_;       // positions of graphs without
+                                      // positions_data()
+  std::vector<std::int64_t> cell_;    // x, y, z cell of every node
+  std::vector<std::uint64_t> key_;    // cell keys, sorted by sort_keys()
+  std::vector<size_type> index_;      // node of every sorted key
+  std::vector<std::uint64_t> key_tmp_;
+  std::vector<size_type> index_tmp_;
+  std::vector<Point> sorted_pos_;     // position of every sorted key
+  std::vector<std::size_t> histogram_;  // radix counts, per thread
+  std::uint64_t y_step_ = 0;          // key distance of adjacent y and z
+  std::uint64_t z_step_ = 0;
+  std::vector<std::vector<pair_type>> found_;  // pairs of each thread
+  std::unique_ptr<bool[]> is_edge_;
+  std::size_t is_edge_size_ = 0;
+
+  /** Return the positions of @a g as one array. */
+  const Point* positions(const G& g, unsigned threads) {
+    if constexpr (graph_traits::has_soa_positions<G>::value) {
+      (void)threads;
+      return g.positions_data();
+    } else {
+      gathered_.resize(std::size_t(g.size()));
+      csr_snapshot::parallel_ranges(threads, gathered_.size(), 4096,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t i = b; i < e; ++i)
+              gathered_[i] = g.node(size_type(i)).position();
+          });
+      return gathered_.data();
+    }
+  }
+
+  /** Compute the cell key of every node into key_, with index_ the
+   * identity.
+   * @return The number of significant key bits
+   *
+   * A key packs the cell's x, y and z, counted from one below the lowest
+   * occupied cell, into as many bits as each axis needs, x lowest. Adding
+   * dx + dy * y_step_ + dz * z_step_ to a key then gives the key of the
+   * cell (dx, dy, dz) away, for offsets of -1, 0 or 1 on every axis. */
+  unsigned make_keys(const Point* pos, std::size_t n, double inv,
+                     unsigned threads) {
+    cell_.resize(3 * n);
+    std::vector<std::int64_t> lo(3 * threads,
+                                 std::numeric_limits<std::int64_t>::max());
+    std::vector<std::int64_t> hi(3 * threads,
+                                 std::numeric_limits<std::int64_t>::min());
+    csr_snapshot::parallel_ranges(threads, n, 4096,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i) {
+            const double x[3] = {pos[i].x, pos[i].y, pos[i].z};
+            for (int a = 0; a < 3; ++a) {
+              std::int64_t c = std::int64_t(std::floor(x[a] * inv));
+              cell_[3 * i + a] = c;
+              lo[3 * t + a] = std::min(lo[3 * t + a], c);
+              hi[3 * t + a] = std::max(hi[3 * t + a], c);
+            }
+          }
+        });
+    std::int64_t base[3];
+    unsigned width[3];
+    for (int a = 0; a < 3; ++a) {
+      std::int64_t l = lo[a], h = hi[a];
+      for (unsigned t = 1; t < threads; ++t) {
+        l = std::min(l, lo[3 * t + a]);
+        h = std::max(h, hi[3 * t + a]);
+      }
+      // One spare cell on each side keeps neighbor offsets inside the field
+      base[a] = l - 1;
+      width[a] = broad_phase_detail::bit_width(std::uint64_t(h - l + 2));
+    }
+    unsigned bits = width[0] + width[1] + width[2];
+    if (bits > 64)
+      throw std::runtime_error("broad_phase: the nodes span too many cells "
+                               "for a 64-bit cell key");
+    y_step_ = std::uint64_t(1) << width[0];
+    z_step_ = std::uint64_t(1) << (width[0] + width[1]);
+
+    key_.resize(n);
+    index_.resize(n);
+    csr_snapshot::parallel_ranges(threads, n, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i) {
+            key_[i] = std::uint64_t(cell_[3 * i] - base[0]) +
+                      std::uint64_t(cell_[3 * i + 1] - base[1]) * y_step_ +
+                      std::uint64_t(cell_[3 * i + 2] - base[2]) * z_step_;
+            index_[i] = size_type(i);
+          }
+        });
+    return bits;
+  }
+
+  /** Stable LSD radix sort of key_ and index_ by the low @a bits of the
+   * keys, radix_bits per pass. Each pass counts digits per thread, turns
+   * the counts into offsets in (digit, thread) order and scatters. */
+  void sort_keys(std::size_t n, unsigned bits, unsigned threads) {
+    key_tmp_.resize(n);
+    index_tmp_.resize(n);
+    // Fixed split, so thread t scatters the range it counted
+    threads = unsigned(std::max<std::size_t>(
+        1, std::min<std::size_t>(threads, n / 4096)));
+    auto bound = [&](unsigned t) {
+      return n * t / threads;
+    };
+    histogram_.assign(radix * threads, 0);
+    for (unsigned shift = 0; shift < bits; shift += radix_bits) {
+      csr_snapshot::parallel_ranges(threads, threads, 1,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t t = b; t < e; ++t) {
+              std::size_t* count = histogram_.data() + radix * t;
+              std::fill(count, count + radix, 0);
+              for (std::size_t i = bound(unsigned(t)); i < bound(unsigned(t + 1)); ++i)
+                ++count[(key_[i] >> shift) & (radix - 1)];
+            }
+          });
+      std::size_t at = 0;
+      for (std::size_t d = 0; d < radix; ++d) {
+        for (unsigned t = 0; t < threads; ++t) {
+          std::size_t c = histogram_[radix * t + d];
+          histogram_[radix * t + d] = at;
+          at += c;
+        }
+      }
+      csr_snapshot::parallel_ranges(threads, threads, 1,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t t = b; t < e; ++t) {
+              std::size_t* next = histogram_.data() + radix * t;
+              for (std::size_t i = bound(unsigned(t)); i < bound(unsigned(t + 1)); ++i) {
+                std::size_t slot = next[(key_[i] >> shift) & (radix - 1)]++;
+                key_tmp_[slot] = key_[i];
+                index_tmp_[slot] = index_[i];
+              }
+            }
+          });
+      key_.swap(key_tmp_);
+      index_.swap(index_tmp_);
+    }
+  }
+
+  /** Collect the close pairs of the sorted nodes.
+   *
+   * Node s searches the rest of its own cell, the cell after it in x, and
+   * four rows of three cells: (y + 1, z), and (y - 1, y, y + 1) at z + 1.
+   * Each of the five runs starts at key_[s] plus a fixed offset, so its
+   * cursor only ever moves forward. */
+  void search(std::size_t n, double d2, unsigned threads) {
+    found_.resize(threads);
+    for (std::vector<pair_type>& found : found_)
+      found.clear();
+    const std::uint64_t first[5] = {
+      1,
+      y_step_ - 1,
+      z_step_ - y_step_ - 1,
+      z_step_ - 1,
+      z_step_ + y_step_ - 1,
+    };
+    const std::uint64_t last[5] = {
+      1,
+      y_step_ + 1,
+      z_step_ - y_step_ + 1,
+      z_step_ + 1,
+      z_step_ + y_step_ + 1,
+    };
+    const std::uint64_t* key = key_.data();
+    const Point* p = sorted_pos_.data();
+    csr_snapshot::parallel_ranges(threads, n, 1024,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          if (b == e)
+            return;
+          std::vector<pair_type>& found = found_[t];
+          std::size_t cursor[5];
+          for (int r = 0; r < 5; ++r)
+            cursor[r] = std::size_t(
+                std::lower_bound(key, key + n, key[b] + first[r]) - key);
+          for (std::size_t s = b; s < e; ++s) {
+            size_type i = index_[s];
+            std::uint64_t k = key[s];
+            auto consider = [&](std::size_t j) {
+              if (normSq(p[j] - p[s]) <= d2) {
+                size_type other = index_[j];
+                found.emplace_back(std::min(i, other), std::max(i, other));
+              }
+            };
+            for (std::size_t j = s + 1; j < n && key[j] == k; ++j)
+              consider(j);
+            for (int r = 0; r < 5; ++r) {
+              std::size_t& c = cursor[r];
+              while (c < n && key[c] < k + first[r])
+                ++c;
+              for (std::size_t j = c; j < n && key[j] <= k + last[r]; ++j)
+                consider(j);
+            }
+          }
+        });
+  }
+
+  /** Remove the pairs of @a pairs that are edges of @a g, keeping the
+   * order of the others.
+   * @return The number of pairs removed */
+  std::size_t drop_edges(const G& g, std::vector<pair_type>& pairs,
+                         unsigned threads) {
+    std::size_t m = pairs.size();
+    if (is_edge_size_ < m) {
+      is_edge_.reset(new bool[m]);
+      is_edge_size_ = m;
+    }
+    if constexpr (broad_phase_detail::has_batched_has_edge<G, pair_type>::value) {
+      g.has_edges(pairs.data(), size_type(m), is_edge_.get(), threads);
+    } else {
+      csr_snapshot::parallel_ranges(threads, m, 1024,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t k = b; k < e; ++k)
+              is_edge_[k] = g.has_edge(g.node(pairs[k].first),
+                                       g.node(pairs[k].second));
+          });
+    }
+    std::size_t kept = 0;
+    for (std::size_t k = 0; k < m; ++k) {
+      if (!is_edge_[k])
+        pairs[kept++] = pairs[k];
+    }
+    pairs.resize(kept);
+    return m - kept;
+  }
+};
+
+#endif // CME212_BROAD_PHASE_HPP
@@ -0,0 +1,61 @@
+#ifndef CME212_CHECKED_ACCESS_HPP
+#define CME212_CHECKED_ACCESS_HPP
+
+/** @file checked_access.hpp
+ * @brief Compile-time choice between bounds-checked and unchecked element
+ *        access for Graph internals.
+ *
+ * Graph proxies reach their data through element_access<...>::get() instead
+ * of calling at() or operator[] directly. By default get() is a plain
+ * operator[]: the proxies already assert their preconditions, so debug
+ * builds catch bad indices and release builds pay nothing. Build with
+ * -DCME212_CHECKED_ACCESS=1 to keep a real bounds check, which throws
+ * std::out_of_range, in release builds too.
+ */
+
+#include <cstddef>
+#include <stdexcept>
+
+#ifndef CME212_CHECKED_ACCESS
+#define CME212_CHECKED_ACCESS 0
+#endif
+
+// [[likely]] is C++20. Older dialects get no hint rather than a warning.
+#if defined(__has_cpp_attribute) && __cplusplus > 201703L
+#if __has_cpp_attribute(likely)
+#define CME212_LIKELY [[likely]]
+#endif
+#endif
+#ifndef CME212_LIKELY
+#define CME212_LIKELY
+#endif
+
+
+/** @class element_access
+ * @brief Indexes a contiguous container, checking the index when @a Checked.
+ */
+template <bool Checked>
+struct element_access;
+
+/** Unchecked access: operator[] only. */
+template <>
+struct element_access<false> {
+  template <typename Container>
+  static auto get(Container& c, std::size_t i) -> decltype(c[i]) {
+    return c[i];
+  }
+};
+
+/** Checked access: the in-range branch is the predicted one. */
+template <>
+struct element_access<true> {
+  template <typename Container>
+  static auto get(Container& c, std::size_t i) -> decltype(c[i]) {
+    if (i < c.size()) CME212_LIKELY {
+      return c[i];
+    }
+    throw std::out_of_range("element_access: index out of range");
+  }
+};
+
+#endif // CME212_CHECKED_ACCESS_HPP
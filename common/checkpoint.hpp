@@ -0,0 +1,750 @@
+#ifndef CME212_CHECKPOINT_HPP
+#define CME212_CHECKPOINT_HPP
+
+/** @file checkpoint.hpp
+ * @brief Incremental checkpoints of a simulation with fixed topology: the
+ *        edges once, then one compressed frame of node positions and
+ *        values per step, written by a background thread.
+ *
+ * In a mass-spring run only positions and values change between steps.
+ * CheckpointWriter writes the edges when it is made and afterwards only
+ * frames. write() copies the positions and values into a spare buffer and
+ * returns; a worker thread encodes the copy and appends it to the file, so
+ * the time-stepping loop waits only when max_pending frames are already
+ * queued:
+ *
+ *   CheckpointWriter<GraphType> ckpt(graph, "run.ckpt");
+ *   for (std::uint64_t s = 0; s < steps; ++s) {
+ *     euler.step(dt, forces, fixed);
+ *     if (s % 10 == 0)
+ *       ckpt.write(s);
+ *   }
+ *   checkpoint_report r = ckpt.close();
+ *
+ *   CheckpointReader<NodeData> in("run.ckpt");
+ *   GraphType g;
+ *   in.build(g);                     // nodes, edges and the first frame
+ *   in.seek(in.frames() - 1);
+ *   in.restore(g);                   // positions and values of that frame
+ *
+ * Every keyframe_interval frames a keyframe stores positions and values
+ * exactly. The frames in between store each coordinate relative to the
+ * previous frame as the reader will see it:
+ *
+ *   exact      XOR of the IEEE bits, as a varint: coordinates that moved a
+ *              little share their sign, exponent and leading mantissa bits
+ *              with the previous ones, so the XOR is short
+ *   half       the difference as an IEEE float16, 2 bytes
+ *   quantized  the difference in multiples of quantum, as a zigzag varint
+ *
+ * Node values are always stored exactly, as the XOR of their bytes with the
+ * previous frame's in 8-byte varints. The lossy modes encode against the
+ * reconstruction rather than the true previous position, so their error
+ * does not accumulate: it stays within half a quantum (or one float16
+ * rounding of a step) of the true position.
+ *
+ * The file is in native byte order:
+ *
+ *   header           checkpoint_detail::file_header
+ *   edges            num_edges {node1, node2} pairs of uint64 indices
+ *   frames           frame_header, then its payload, per frame
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "CME212/Point.hpp"
+
+
+/** How the frames between keyframes store positions. */
+enum class checkpoint_precision : std::uint32_t { exact, half, quantized };
+
+/** Tuning knobs for CheckpointWriter. */
+struct checkpoint_options {
+  checkpoint_precision precision = checkpoint_precision::exact;
+  /** Grid spacing of checkpoint_precision::quantized. */
+  double quantum = 1e-6;
+  /** A keyframe every this many frames; 1 makes every frame a keyframe. */
+  unsigned keyframe_interval = 64;
+  /** Frames copied but not yet written before write() waits. */
+  unsigned max_pending = 2;
+};
+
+/** What a writer has done so far and what it cost the caller. */
+struct checkpoint_report {
+  std::uint64_t frames = 0;
+  std::uint64_t keyframes = 0;
+  std::uint64_t raw_bytes = 0;     // positions and values as they are in memory
+  std::uint64_t file_bytes = 0;    // the whole file, header and edges included
+  double copy_seconds = 0;         // write() copying the state
+  double wait_seconds = 0;         // write() waiting for a free buffer
+  double encode_seconds = 0;       // the worker encoding and writing
+};
+
+
+namespace checkpoint_detail {
+
+/** Bumped whenever the layout changes. */
+constexpr std::uint32_t version = 1;
+
+/** Leading block of a checkpoint file. */
+struct file_header {
+  char magic[8];                   // "CME212C" plus a terminating 0
+  std::uint32_t version;
+  std::uint32_t value_size;        // sizeof(node_value_type)
+  std::uint64_t num_nodes;
+  std::uint64_t num_edges;
+  std::uint32_t precision;         // a checkpoint_precision
+  std::uint32_t keyframe_interval;
+  double quantum;
+};
+
+/** Leading block of every frame. */
+struct frame_header {
+  std::uint64_t step;              // as passed to write()
+  std::uint32_t keyframe;          // 1 if stored exactly
+  std::uint32_t reserved;
+  std::uint64_t bytes;             // of the payload that follows
+};
+
+/** Append @a x to @a out, 7 bits per byte, low bits first. */
+inline void put_varint(std::vector<unsigned char>& out, std::uint64_t x) {
+  while (x >= 0x80) {
+    out.push_back(static_cast<unsigned char>(x | 0x80));
+    x >>= 7;
+  }
+  out.push_back(static_cast<unsigned char>(x));
+}
+
+/** Read a varint written by put_varint() at @a p, which must not pass
+ * @a end. */
+inline std::uint64_t get_varint(const unsigned char*& p,
+                                const unsigned char* end) {
+  std::uint64_t x = 0;
+  for (unsigned shift = 0; p != end && shift < 64; shift += 7) {
+    unsigned char b = *p++;
+    x |= std::uint64_t(b & 0x7f) << shift;
+    if (!(b & 0x80))
+      return x;
+  }
+  throw std::runtime_error("checkpoint: corrupt frame");
+}
+
+inline std::uint64_t zigzag(std::int64_t x) {
+  return (std::uint64_t(x) << 1) ^ std::uint64_t(x >> 63);
+}
+
+inline std::int64_t unzigzag(std::uint64_t x) {
+  return std::int64_t(x >> 1) ^ -std::int64_t(x & 1);
+}
+
+inline std::uint64_t bits(double x) {
+  std::uint64_t b;
+  std::memcpy(&b, &x, sizeof(b));
+  return b;
+}
+
+inline double from_bits(std::uint64_t b) {
+  double x;
+  std::memcpy(&x, &b, sizeof(x));
+  return x;
+}
+
+/** Round @a f to the nearest IEEE binary16, ties to even. */
+inline std::uint16_t to_half(float f) {
+  std::uint32_t x;
+  std::memcpy(&x, &f, sizeof(x));
+  std::uint32_t sign = (x >> 16) & 0x8000;
+  std::uint32_t mag = x & 0x7fffffff;
+  if (mag >= 0x7f800000)                    // infinity or NaN
+    return std::uint16_t(sign | 0x7c00 | (mag > 0x7f800000 ? 0x200 : 0));
+  if (mag >= 0x477ff000)                    // rounds past 65504
+    return std::uint16_t(sign | 0x7c00);
+  if (mag < 0x38800000) {                   // below 2^-14: subnormal half
+    if (mag < 0x33000000)                   // at most 2^-25: rounds to 0
+      return std::uint16_t(sign);
+    std::uint32_t shift = 126 - (mag >> 23);
+    std::uint32_t m = (mag & 0x7fffff) | 0x800000;
+    std::uint32_t h = m >> shift;
+    std::uint32_t rest = m & ((1u << shift) - 1);
+    std::uint32_t tie = 1u << (shift - 1);
+    if (rest > tie || (rest == tie && (h & 1)))
+      ++h;
+    return std::uint16_t(sign | h);
+  }
+  std::uint32_t h = (mag - 0x38000000) >> 13;
+  std::uint32_t rest = mag & 0x1fff;
+  if (rest > 0x1000 || (rest == 0x1000 && (h & 1)))
+    ++h;
+  return std::uint16_t(sign | h);
+}
+
+/** Return the float equal to the IEEE binary16 @a h. */
+inline float from_half(std::uint16_t h) {
+  std::uint32_t sign = std::uint32_t(h & 0x8000) << 16;
+  std::uint32_t e = (h >> 10) & 0x1f;
+  std::uint32_t m = h & 0x3ff;
+  if (e == 0) {
+    float f = std::ldexp(float(m), -24);
+    return sign ? -f : f;
+  }
+  std::uint32_t x = e == 31 ? sign | 0x7f800000 | (m << 13)
+                            : sign | ((e + 112) << 23) | (m << 13);
+  float f;
+  std::memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+/** Encoder and decoder of frames, which both keep the last frame as the
+ * reader sees it.
+ *
+ * @tparam V  Node value type, trivially copyable
+ */
+template <typename V>
+class frame_codec {
+ public:
+  frame_codec(std::size_t n, const file_header& h)
+      : precision_(checkpoint_precision(h.precision)), quantum_(h.quantum),
+        x_(n, Point(0, 0, 0)), v_(n) {
+  }
+
+  /** Append frame @a x, @a v to @a out and remember it. */
+  void encode(const std::vector<Point>& x, const std::vector<V>& v,
+              bool keyframe, std::vector<unsigned char>& out) {
+    for (std::size_t i = 0; i < x.size(); ++i)
+      for (double Point::* c : axes)
+        encode_coordinate(x[i].*c, x_[i].*c, keyframe, out);
+    for (std::size_t i = 0; i < v.size(); ++i) {
+      encode_value(v[i], v_[i], keyframe, out);
+      v_[i] = v[i];
+    }
+  }
+
+  /** Decode the payload [p, end) of a frame into the remembered frame. */
+  void decode(const unsigned char* p, const unsigned char* end,
+              bool keyframe) {
+    for (Point& x : x_)
+      for (double Point::* c : axes)
+        x.*c = decode_coordinate(x.*c, keyframe, p, end);
+    for (V& v : v_)
+      decode_value(v, keyframe, p, end);
+    if (p != end)
+      throw std::runtime_error("checkpoint: corrupt frame");
+  }
+
+  const std::vector<Point>& positions() const {
+    return x_;
+  }
+  const std::vector<V>& values() const {
+    return v_;
+  }
+
+ private:
+  static constexpr double Point::* axes[3] = {&Point::x, &Point::y, &Point::z};
+
+  checkpoint_precision precision_;
+  double quantum_;
+  std::vector<Point> x_;
+  std::vector<V> v_;
+
+  /** Encode @a x against @a last and set @a last to what decoding gives. */
+  void encode_coordinate(double x, double& last, bool keyframe,
+                         std::vector<unsigned char>& out) {
+    if (keyframe) {
+      put_varint(out, bits(x));
+      last = x;
+    } else if (precision_ == checkpoint_precision::exact) {
+      put_varint(out, bits(x) ^ bits(last));
+      last = x;
+    } else if (precision_ == checkpoint_precision::half) {
+      std::uint16_t h = to_half(float(x - last));
+      out.push_back(static_cast<unsigned char>(h));
+      out.push_back(static_cast<unsigned char>(h >> 8));
+      last += double(from_half(h));
+    } else {
+      std::int64_t q = std::llround((x - last) / quantum_);
+      put_varint(out, zigzag(q));
+      last += double(q) * quantum_;
+    }
+  }
+
+  double decode_coordinate(double last, bool keyframe,
+                           const unsigned char*& p,
+                           const unsigned char* end) const {
+    if (keyframe)
+      return from_bits(get_varint(p, end));
+    if (precision_ == checkpoint_precision::exact)
+      return from_bits(get_varint(p, end) ^ bits(last));
+    if (precision_ == checkpoint_precision::half) {
+      if (end - p < 2)
+        throw std::runtime_error("checkpoint: corrupt frame");
+      std::uint16_t h = std::uint16_t(p[0] | (p[1] << 8));
+      p += 2;
+      return last + double(from_half(h));
+    }
+    return last + double(unzigzag(get_varint(p, end))) * quantum_;
+  }
+
+  /** Encode the bytes of @a v, XORed with @a last unless @a keyframe, as
+   * 8-byte words. */
+  static void encode_value(const V& v, const V& last, bool keyframe,
+                           std::vector<unsigned char>& out) {
+    const unsigned char* a = reinterpret_cast<const unsigned char*>(&v);
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(&last);
+    for (std::size_t k = 0; k < sizeof(V); k += 8) {
+      std::uint64_t x = 0, y = 0;
+      std::size_t len = sizeof(V) - k < 8 ? sizeof(V) - k : 8;
+      std::memcpy(&x, a + k, len);
+      std::memcpy(&y, b + k, len);
+      put_varint(out, keyframe ? x : x ^ y);
+    }
+  }
+
+  static void decode_value(V& v, bool keyframe, const unsigned char*& p,
+                           const unsigned char* end) {
+    unsigned char* a = reinterpret_cast<unsigned char*>(&v);
+    for (std::size_t k = 0; k < sizeof(V); k += 8) {
+      std::uint64_t x = 0;
+      std::size_t len = sizeof(V) - k < 8 ? sizeof(V) - k : 8;
+      std::memcpy(&x, a + k, len);
+      x = keyframe ? get_varint(p, end) : x ^ get_varint(p, end);
+      std::memcpy(a + k, &x, len);
+    }
+  }
+};
+
+template <typename G, typename = void>
+struct has_mark_positions_changed : std::false_type {};
+template <typename G>
+struct has_mark_positions_changed<G, std::void_t<
+    decltype(std::declval<G&>().mark_positions_changed(0, 0))>>
+    : std::true_type {};
+
+inline double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+} // end namespace checkpoint_detail
+
+
+/** @class CheckpointWriter
+ * @brief Appends frames of a graph's node positions and values to a
+ *        checkpoint file from a background thread.
+ *
+ * The topology must not change while the writer is open: frames only hold
+ * positions and values, by node index.
+ *
+ * @tparam G  Graph type with size(), num_edges(), node(i).position(),
+ *            node(i).value(), edge(i).node1()/node2() and a trivially
+ *            copyable node_value_type.
+ */
+template <typename G>
+class CheckpointWriter {
+ public:
+  using size_type = typename G::size_type;
+  using value_type = typename G::node_value_type;
+  static_assert(std::is_trivially_copyable<value_type>::value,
+                "checkpoint: node values are stored as raw bytes");
+
+  /** Create @a path and write the header and edges of @a g to it.
+   * @throws std::runtime_error if the file cannot be written
+   *
+   * Complexity: O(g.num_edges()) on the calling thread.
+   */
+  CheckpointWriter(const G& g, const std::string& path,
+                   const checkpoint_options& opt = checkpoint_options())
+      : g_(g), opt_(opt), n_(std::size_t(g.size())),
+        out_(path, std::ios::binary | std::ios::trunc) {
+    if (!out_)
+      throw std::runtime_error("checkpoint: cannot open " + path);
+    if (opt_.keyframe_interval == 0)
+      opt_.keyframe_interval = 1;
+    if (opt_.max_pending == 0)
+      opt_.max_pending = 1;
+
+    std::memset(&header_, 0, sizeof(header_));
+    std::memcpy(header_.magic, "CME212C", 8);
+    header_.version = checkpoint_detail::version;
+    header_.value_size = sizeof(value_type);
+    header_.num_nodes = n_;
+    header_.num_edges = std::uint64_t(g.num_edges());
+    header_.precision = std::uint32_t(opt_.precision);
+    header_.keyframe_interval = opt_.keyframe_interval;
+    header_.quantum = opt_.quantum;
+    write_bytes(&header_, sizeof(header_));
+    std::vector<std::uint64_t> ends;
+    ends.reserve(2 * std::size_t(header_.num_edges));
+    for (size_type k = 0; k < size_type(header_.num_edges); ++k) {
+      auto e = g.edge(k);
+      ends.push_back(std::uint64_t(e.node1().index()));
+      ends.push_back(std::uint64_t(e.node2().index()));
+    }
+    write_bytes(ends.data(), ends.size() * sizeof(std::uint64_t));
+    out_.flush();
+    report_.file_bytes = sizeof(header_) + ends.size() * sizeof(std::uint64_t);
+
+    worker_ = std::thread([this] { run(); });
+  }
+
+  /** Write the frames still queued and close the file. Errors are lost;
+   * call close() first to see them. */
+  ~CheckpointWriter() {
+    try {
+      close();
+    } catch (...) {
+    }
+  }
+
+  CheckpointWriter(const CheckpointWriter&) = delete;
+  CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+  /** Queue a frame of the graph's current positions and values, labelled
+   * @a step.
+   * @throws std::runtime_error if the worker failed to write an earlier
+   *         frame, or the writer is closed
+   *
+   * Copies the state on the calling thread and returns; it only waits if
+   * max_pending frames are already queued.
+   *
+   * Complexity: O(g.size()) on the calling thread.
+   */
+  void write(std::uint64_t step) {
+    auto start = std::chrono::steady_clock::now();
+    frame f;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait(lock, [&] {
+        return queue_.size() < opt_.max_pending || error_ || closing_;
+      });
+      rethrow();
+      if (closing_)
+        throw std::runtime_error("checkpoint: writer is closed");
+      if (!spare_.empty()) {
+        f = std::move(spare_.back());
+        spare_.pop_back();
+      }
+    }
+    auto copied = std::chrono::steady_clock::now();
+    f.step = step;
+    f.x.resize(n_);
+    f.v.resize(n_);
+    for (std::size_t i = 0; i < n_; ++i) {
+      auto u = g_.node(size_type(i));
+      f.x[i] = u.position();
+      f.v[i] = u.value();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    report_.wait_seconds += std::chrono::duration<double>(copied - start).count();
+    report_.copy_seconds += checkpoint_detail::seconds_since(copied);
+    queue_.push_back(std::move(f));
+    changed_.notify_all();
+  }
+
+  /** Wait until every queued frame is in the file.
+   * @throws std::runtime_error if one could not be written */
+  void flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [&] { return (queue_.empty() && !busy_) || error_; });
+    rethrow();
+  }
+
+  /** Write the queued frames, stop the worker and close the file.
+   * @return What the writer did; later calls return the same
+   * @throws std::runtime_error if a frame could not be written */
+  checkpoint_report close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closing_ = true;
+      changed_.notify_all();
+    }
+    if (worker_.joinable())
+      worker_.join();
+    if (out_.is_open()) {
+      out_.close();
+      if (!out_ && !error_)
+        error_ = std::make_exception_ptr(
+            std::runtime_error("checkpoint: write failed"));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    rethrow();
+    return report_;
+  }
+
+  /** Return what the writer has done so far. */
+  checkpoint_report report() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return report_;
+  }
+
+ private:
+  struct frame {
+    std::uint64_t step = 0;
+    std::vector<Point> x;
+    std::vector<value_type> v;
+  };
+
+  const G& g_;
+  checkpoint_options opt_;
+  std::size_t n_;
+  std::ofstream out_;
+  checkpoint_detail::file_header header_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<frame> queue_;
+  std::vector<frame> spare_;      // buffers of written frames, for reuse
+  bool busy_ = false;             // the worker holds a frame
+  bool closing_ = false;
+  std::exception_ptr error_;
+  checkpoint_report report_;
+  std::thread worker_;
+
+  void write_bytes(const void* data, std::size_t bytes) {
+    out_.write(static_cast<const char*>(data), std::streamsize(bytes));
+    if (!out_)
+      throw std::runtime_error("checkpoint: write failed");
+  }
+
+  void rethrow() {
+    if (error_)
+      std::rethrow_exception(error_);
+  }
+
+  /** Body of the worker: encode and append frames until closed. */
+  void run() {
+    checkpoint_detail::frame_codec<value_type> codec(n_, header_);
+    std::vector<unsigned char> payload;
+    std::uint64_t count = 0;
+    for (;;) {
+      frame f;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&] { return !queue_.empty() || closing_; });
+        if (queue_.empty() || error_)
+          return;
+        f = std::move(queue_.front());
+        queue_.pop_front();
+        busy_ = true;
+      }
+      auto start = std::chrono::steady_clock::now();
+      bool keyframe = count % opt_.keyframe_interval == 0;
+      try {
+        payload.clear();
+        codec.encode(f.x, f.v, keyframe, payload);
+        checkpoint_detail::frame_header h = {};
+        h.step = f.step;
+        h.keyframe = keyframe ? 1 : 0;
+        h.bytes = payload.size();
+        write_bytes(&h, sizeof(h));
+        write_bytes(payload.data(), payload.size());
+        out_.flush();
+        if (!out_)
+          throw std::runtime_error("checkpoint: write failed");
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = std::current_exception();
+        busy_ = false;
+        changed_.notify_all();
+        return;
+      }
+      ++count;
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++report_.frames;
+      report_.keyframes += keyframe ? 1 : 0;
+      report_.raw_bytes += n_ * (sizeof(Point) + sizeof(value_type));
+      report_.file_bytes += sizeof(checkpoint_detail::frame_header) +
+                            payload.size();
+      report_.encode_seconds += checkpoint_detail::seconds_since(start);
+      spare_.push_back(std::move(f));
+      busy_ = false;
+      changed_.notify_all();
+    }
+  }
+};
+
+
+/** @class CheckpointReader
+ * @brief Reads a file written by CheckpointWriter back, frame by frame.
+ *
+ * @tparam V  Node value type of the graph that was written
+ */
+template <typename V>
+class CheckpointReader {
+ public:
+  /** Open @a path and index its frames.
+   * @throws std::runtime_error if it is not a checkpoint of value type V or
+   *         its header or edges are cut short. A last frame cut short, as
+   *         left by a run that died while writing it, is ignored.
+   *
+   * Complexity: O(num_edges() + frames()), reading only the frame headers.
+   */
+  explicit CheckpointReader(const std::string& path)
+      : in_(path, std::ios::binary) {
+    if (!in_)
+      throw std::runtime_error("checkpoint: cannot open " + path);
+    read_bytes(&header_, sizeof(header_));
+    if (std::memcmp(header_.magic, "CME212C", 8) != 0)
+      throw std::runtime_error("checkpoint: not a checkpoint file");
+    if (header_.version != checkpoint_detail::version)
+      throw std::runtime_error("checkpoint: unsupported version " +
+                               std::to_string(header_.version));
+    if (header_.value_size != sizeof(V))
+      throw std::runtime_error("checkpoint: node value size mismatch");
+    ends_.resize(2 * std::size_t(header_.num_edges));
+    read_bytes(ends_.data(), ends_.size() * sizeof(std::uint64_t));
+
+    // Index the frames by skipping over their payloads
+    in_.seekg(0, std::ios::end);
+    std::uint64_t size = std::uint64_t(in_.tellg());
+    std::uint64_t at = sizeof(header_) + ends_.size() * sizeof(std::uint64_t);
+    for (;;) {
+      if (size - at < sizeof(checkpoint_detail::frame_header))
+        break;
+      in_.seekg(std::streamoff(at));
+      entry e;
+      read_bytes(&e.header, sizeof(e.header));
+      e.offset = at + sizeof(e.header);
+      if (size - e.offset < e.header.bytes)
+        break;
+      at = e.offset + e.header.bytes;
+      index_.push_back(e);
+    }
+    in_.clear();
+  }
+
+  /** Return the number of nodes and of edges of the checkpointed graph. */
+  std::uint64_t num_nodes() const {
+    return header_.num_nodes;
+  }
+  std::uint64_t num_edges() const {
+    return header_.num_edges;
+  }
+
+  /** Return the number of complete frames in the file. */
+  std::size_t frames() const {
+    return index_.size();
+  }
+
+  /** Return the step that frame @a k was written at. */
+  std::uint64_t step(std::size_t k) const {
+    return index_[k].header.step;
+  }
+
+  /** Return the frame seek() last decoded, or npos if none. */
+  std::size_t current() const {
+    return current_;
+  }
+
+  static constexpr std::size_t npos = std::size_t(-1);
+
+  /** Decode frame @a k.
+   * @pre k < frames()
+   * @throws std::runtime_error if a frame on the way is corrupt
+   *
+   * Complexity: O(num_nodes()) per frame decoded: from the last keyframe
+   * at or before @a k, or from the current frame when seeking forward
+   * past no keyframe.
+   */
+  void seek(std::size_t k) {
+    if (!codec_)
+      codec_ = std::make_unique<checkpoint_detail::frame_codec<V>>(
+          std::size_t(header_.num_nodes), header_);
+    // The first frame is always a keyframe
+    std::size_t first = k;
+    while (first > 0 && !index_[first].header.keyframe)
+      --first;
+    if (current_ != npos && current_ >= first && current_ <= k)
+      first = current_ + 1;
+    std::vector<unsigned char> payload;
+    for (std::size_t j = first; j <= k; ++j) {
+      const entry& e = index_[j];
+      payload.resize(std::size_t(e.header.bytes));
+      in_.seekg(std::streamoff(e.offset));
+      read_bytes(payload.data(), payload.size());
+      current_ = npos;
+      codec_->decode(payload.data(), payload.data() + payload.size(),
+                     e.header.keyframe != 0);
+      current_ = j;
+    }
+  }
+
+  /** Return the positions, and the values, of the frame seek() decoded.
+   * @pre current() < frames() */
+  const std::vector<Point>& positions() const {
+    return codec_->positions();
+  }
+  const std::vector<V>& values() const {
+    return codec_->values();
+  }
+
+  /** Add the checkpointed nodes, at the positions and with the values of
+   * the first frame, and edges to the empty graph @a g.
+   * @pre g.size() == 0 && frames() > 0
+   *
+   * Complexity: O(num_nodes() + num_edges()) plus the add_edge() calls.
+   */
+  template <typename G>
+  void build(G& g) {
+    seek(0);
+    for (std::size_t i = 0; i < positions().size(); ++i)
+      g.add_node(positions()[i], values()[i]);
+    for (std::size_t k = 0; k < ends_.size(); k += 2)
+      g.add_edge(g.node(typename G::size_type(ends_[k])),
+                 g.node(typename G::size_type(ends_[k + 1])));
+  }
+
+  /** Set the positions and values of the nodes of @a g to those of the
+   * frame seek() decoded, and report the positions changed on graphs that
+   * track changes.
+   * @pre g has num_nodes() nodes; current() < frames() */
+  template <typename G>
+  void restore(G& g) const {
+    std::size_t n = positions().size();
+    for (std::size_t i = 0; i < n; ++i) {
+      auto u = g.node(typename G::size_type(i));
+      u.position() = positions()[i];
+      u.value() = values()[i];
+    }
+    if constexpr (checkpoint_detail::has_mark_positions_changed<G>::value)
+      g.mark_positions_changed(0, typename G::size_type(n));
+  }
+
+ private:
+  struct entry {
+    checkpoint_detail::frame_header header;
+    std::uint64_t offset;
+  };
+
+  std::ifstream in_;
+  checkpoint_detail::file_header header_;
+  std::vector<std::uint64_t> ends_;
+  std::vector<entry> index_;
+  std::unique_ptr<checkpoint_detail::frame_codec<V>> codec_;
+  std::size_t current_ = npos;
+
+  void read_bytes(void* data, std::size_t bytes) {
+    if (bytes == 0)
+      return;
+    in_.read(static_cast<char*>(data), std::streamsize(bytes));
+    if (!in_ || std::size_t(in_.gcount()) != bytes)
+      throw std::runtime_error("checkpoint: truncated file");
+  }
+};
+
+#endif // CME212_CHECKPOINT_HPP
@@ -0,0 +1,490 @@
+#ifndef CME212_COARSENING_HPP
+#define CME212_COARSENING_HPP
+
+/** @file coarsening.hpp
+ * @brief Heavy-edge matching coarsening of a graph into a hierarchy of
+ *        coarser graphs, with restriction and prolongation between them.
+ *
+ * Every level pairs up nodes along heavy edges and merges each pair into
+ * one coarse node; an unmatched node is carried over alone. The coarse edge
+ * between two coarse nodes weighs the sum of the fine edges between their
+ * members, so later levels keep matching along the strongest connections:
+ *
+ *   CoarseningHierarchy<G> h(g);               // g is level 0
+ *   const G& coarse = h.level(h.num_levels() - 1);
+ *   h.restrict_to(0, r0.data(), r1.data());     // residual, fine -> coarse
+ *   h.prolong(0, e1.data(), e0.data());         // correction, coarse -> fine
+ *
+ * The matching is the parallel locally-dominant (handshake) variant: in
+ * each round every unmatched node proposes to its heaviest unmatched
+ * neighbor, and two nodes that propose to each other are matched. A round
+ * only writes each node's own entries, so no locks or atomics are needed,
+ * and the result does not depend on the number of threads.
+ *
+ * Each coarse level is a graph of the same type, built in bulk through
+ * add_nodes() and add_edges() when the graph has them, so its nodes and
+ * edges are stored contiguously. Coarse positions and values are reduced
+ * from the two members by user functors, the midpoint and the sum by
+ * default.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/laplacian.hpp"
+#include "CME212/Point.hpp"
+
+
+/** Tuning knobs for CoarseningHierarchy. */
+struct coarsening_options {
+  /** Worker threads. 0 means std::thread::hardware_concurrency(). */
+  unsigned threads = 0;
+  /** Most levels, the input graph included. */
+  unsigned max_levels = 16;
+  /** Stop once a level has at most this many nodes. */
+  std::size_t min_nodes = 64;
+  /** Drop a new level, and stop, if it keeps more than this fraction of
+   * the nodes of the level below. */
+  double min_reduction = 0.9;
+  /** Handshake rounds per matching. */
+  unsigned match_rounds = 8;
+};
+
+/** Reduction of two positions to their midpoint. */
+struct midpoint_reduce {
+  Point operator()(const Point& a, const Point& b) const {
+    return (a + b) / 2;
+  }
+};
+
+/** Reduction of two values to their sum, e.g. of node masses. */
+struct sum_reduce {
+  template <typename T>
+  T operator()(const T& a, const T& b) const {
+    return a + b;
+  }
+};
+
+
+namespace coarsening_detail {
+
+template <typename G, typename = void>
+struct has_node_value : std::false_type {};
+template <typename G>
+struct has_node_value<G, std::void_t<typename G::node_value_type,
+    decltype(std::declval<const G&>().node(0).value())>> : std::true_type {};
+
+template <typename G, typename PosIt, typename ValIt, typename = void>
+struct has_add_nodes : std::false_type {};
+template <typename G, typename PosIt, typename ValIt>
+struct has_add_nodes<G, PosIt, ValIt, decltype(void(std::declval<G&>().add_nodes(
+    std::declval<PosIt>(), std::declval<PosIt>(), std::declval<ValIt>())))>
+    : std::true_type {};
+
+template <typename G, typename It, typename = void>
+struct has_add_points : std::false_type {};
+template <typename G, typename It>
+struct has_add_points<G, It, decltype(void(std::declval<G&>().add_nodes(
+    std::declval<It>(), std::declval<It>())))> : std::true_type {};
+
+template <typename G, typename It, typename = void>
+struct has_add_edges : std::false_type {};
+template <typename G, typename It>
+struct has_add_edges<G, It, decltype(void(std::declval<G&>().add_edges(
+    std::declval<It>(), std::declval<It>())))> : std::true_type {};
+
+/** One level's adjacency with edge weights: row i is
+ * nbr[off[i] .. off[i + 1]) and w at the same positions. */
+template <typename S>
+struct weighted_rows {
+  std::vector<std::size_t> off;
+  std::vector<S> nbr;
+  std::vector<double> w;
+
+  std::size_t size() const {
+    return off.size() - 1;
+  }
+};
+
+/** Return @a rows contracted by @a parent into @a nc groups: group c is
+ * joined to every other group a member of c has a neighbor in, with the
+ * summed weight of those entries. Members are visited in increasing index
+ * order.
+ * @param[out] internal  If not null, internal[c] receives the summed
+ *                       weight of the entries between members of c, in
+ *                       which an edge inside c counts from both ends
+ * @pre parent[u] < @a nc for every node u of @a rows
+ *
+ * Complexity: O((n + m log d) / threads) for rows of degree at most d,
+ * plus O(n) to list the members of every group.
+ */
+template <typename S>
+weighted_rows<S> contract_groups(const weighted_rows<S>& rows,
+                                 const std::vector<S>& parent, std::size_t nc,
+                                 unsigned threads,
+                                 std::vector<double>* internal = nullptr) {
+  std::size_t n = rows.size();
+  std::vector<std::size_t> member_off(nc + 1, 0);
+  std::vector<S> members(n);
+  for (std::size_t u = 0; u < n; ++u)
+    ++member_off[std::size_t(parent[u]) + 1];
+  for (std::size_t c = 0; c < nc; ++c)
+    member_off[c + 1] += member_off[c];
+  {
+    std::vector<std::size_t> next(member_off.begin(), member_off.end() - 1);
+    for (std::size_t u = 0; u < n; ++u)
+      members[next[parent[u]]++] = S(u);
+  }
+  if (internal)
+    internal->assign(nc, 0.0);
+
+  std::vector<std::vector<std::pair<S, double>>> parts(threads);
+  std::vector<std::size_t> length(nc + 1, 0);
+  csr_snapshot::parallel_ranges(threads, nc, 1024,
+      [&](unsigned t, std::size_t b, std::size_t e) {
+        std::vector<std::pair<S, double>> row;
+        for (std::size_t c = b; c < e; ++c) {
+          row.clear();
+          double inside = 0;
+          for (std::size_t j = member_off[c]; j < member_off[c + 1]; ++j) {
+            S u = members[j];
+            for (std::size_t k = rows.off[u]; k < rows.off[u + 1]; ++k) {
+              S d = parent[rows.nbr[k]];
+              if (d != S(c))
+                row.emplace_back(d, rows.w[k]);
+              else
+                inside += rows.w[k];
+            }
+          }
+          if (internal)
+            (*internal)[c] = inside;
+          // Sorting by weight too sums each coarse edge in the same
+          // order from both of its ends, so both see the same weight
+          std::sort(row.begin(), row.end());
+          std::size_t before = parts[t].size();
+          for (const auto& x : row) {
+            if (parts[t].size() > before && parts[t].back().first == x.first)
+              parts[t].back().second += x.second;
+            else
+              parts[t].push_back(x);
+          }
+          length[c + 1] = parts[t].size() - before;
+        }
+      });
+
+  weighted_rows<S> coarse;
+  coarse.off.resize(nc + 1);
+  coarse.off[0] = 0;
+  for (std::size_t c = 0; c < nc; ++c)
+    coarse.off[c + 1] = coarse.off[c] + length[c + 1];
+  coarse.nbr.reserve(coarse.off[nc]);
+  coarse.w.reserve(coarse.off[nc]);
+  // The threads' ranges are contiguous and in order, so their buffers
+  // joined in order are the rows in order
+  for (auto& part : parts) {
+    for (const auto& x : part) {
+      coarse.nbr.push_back(x.first);
+      coarse.w.push_back(x.second);
+    }
+    std::vector<std::pair<S, double>>().swap(part);
+  }
+  return coarse;
+}
+
+} // end namespace coarsening_detail
+
+
+/** @class CoarseningHierarchy
+ * @brief A graph and successively coarser graphs of the same type.
+ *
+ * Level 0 is the input graph, which the hierarchy refers to and which must
+ * outlive it; levels 1 and up are owned. Node i of level l belongs to
+ * coarse node parent(l)[i] of level l + 1, whose members are
+ * children(l)[c], with the second entry no_node for a carried-over node.
+ * Like the other engines here, the hierarchy does not follow later changes
+ * of the input graph.
+ *
+ * @tparam G  Graph type with size(), node(i).position(),
+ *            node(i).edge_begin()/edge_end(), add_node() and add_edge().
+ */
+template <typename G>
+class CoarseningHierarchy {
+ public:
+  /** Type of node indices, as in the graph. */
+  using size_type = typename G::size_type;
+  /** The members of one coarse node. */
+  using member_pair = std::array<size_type, 2>;
+
+  /** Second member of a coarse node that has only one. */
+  static constexpr size_type no_node = size_type(-1);
+
+  /** Coarsen @a g until a stopping rule of @a opt applies.
+   * @param[in] weight   Edge weight functor on level 0's Edges, as for
+   *                     LaplacianOperator; heavier edges are matched first
+   * @param[in] pos      Reduces two member positions to the coarse one
+   * @param[in] value    Reduces two member values to the coarse one, for
+   *                     graphs with node values
+   *
+   * Complexity: O(levels * (n + m) * rounds / threads) for the matchings
+   * and coarse rows, plus adding the coarse levels to their graphs.
+   */
+  template <typename Weight = unit_weight, typename PosReduce = midpoint_reduce,
+            typename ValueReduce = sum_reduce>
+  explicit CoarseningHierarchy(const G& g,
+                               const coarsening_options& opt = coarsening_options(),
+                               Weight weight = Weight(), PosReduce pos = PosReduce(),
+                               ValueReduce value = ValueReduce())
+      : opt_(opt), threads_(csr_snapshot::thread_count(opt.threads)), fine_(&g) {
+    coarsening_detail::weighted_rows<size_type> rows;
+    rows.off = csr_snapshot::row_offsets(g, threads_);
+    rows.nbr.resize(rows.off.back());
+    rows.w.resize(rows.off.back());
+    csr_snapshot::fill_rows(g, rows.off, threads_,
+        [&](std::size_t k, const auto& e) {
+          rows.nbr[k] = size_type(e.node2().index());
+          rows.w[k] = weight(e);
+        });
+
+    while (num_levels() < opt_.max_levels && rows.size() > opt_.min_nodes) {
+      std::vector<size_type> parent;
+      std::vector<member_pair> children;
+      match(rows, parent, children);
+      if (double(children.size()) > opt_.min_reduction * double(rows.size()))
+        break;
+      coarsening_detail::weighted_rows<size_type> coarse =
+          coarsening_detail::contract_groups(rows, parent, children.size(),
+                                             threads_);
+      levels_.push_back(build_level(level(num_levels() - 1), coarse, children,
+                                    pos, value));
+      parents_.push_back(std::move(parent));
+      children_.push_back(std::move(children));
+      rows = std::move(coarse);
+    }
+  }
+
+  /** Return the number of levels, the input graph included. */
+  std::size_t num_levels() const {
+    return levels_.size() + 1;
+  }
+
+  /** Return level @a l; level 0 is the input graph.
+   * @pre @a l < num_levels() */
+  const G& level(std::size_t l) const {
+    assert(l < num_levels());
+    return l == 0 ? *fine_ : *levels_[l - 1];
+  }
+
+  /** Return the coarse node of level @a l + 1 that each node of level @a l
+   * belongs to. @pre @a l + 1 < num_levels() */
+  const std::vector<size_type>& parent(std::size_t l) const {
+    return parents_[l];
+  }
+
+  /** Return the members in level @a l of each node of level @a l + 1.
+   * @pre @a l + 1 < num_levels() */
+  const std::vector<member_pair>& children(std::size_t l) const {
+    return children_[l];
+  }
+
+  /** Restrict per-node data of level @a l to level @a l + 1:
+   * coarse[c] = reduce(fine[a], fine[b]) for the members a, b of c, or
+   * fine[a] for a single member.
+   * @param[in]  fine    level(l).size() values
+   * @param[out] coarse  level(l + 1).size() values
+   *
+   * The default sum is the transpose of prolong(), as a multigrid
+   * restriction of residuals usually is. Complexity: O(coarse size).
+   */
+  template <typename T, typename Reduce = sum_reduce>
+  void restrict_to(std::size_t l, const T* fine, T* coarse,
+                   Reduce reduce = Reduce()) const {
+    const std::vector<member_pair>& c = children_[l];
+    csr_snapshot::parallel_ranges(threads_, c.size(), 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i) {
+            coarse[i] = c[i][1] == no_node ? fine[c[i][0]]
+                                           : reduce(fine[c[i][0]], fine[c[i][1]]);
+          }
+        });
+  }
+
+  /** Prolong per-node data of level @a l + 1 to level @a l by injection:
+   * fine[i] = coarse[parent(l)[i]].
+   * Complexity: O(fine size). */
+  template <typename T>
+  void prolong(std::size_t l, const T* coarse, T* fine) const {
+    const std::vector<size_type>& p = parents_[l];
+    csr_snapshot::parallel_ranges(threads_, p.size(), 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i)
+            fine[i] = coarse[p[i]];
+        });
+  }
+
+ private:
+  coarsening_options opt_;
+  unsigned threads_;
+  const G* fine_;
+  std::vector<std::unique_ptr<G>> levels_;
+  std::vector<std::vector<size_type>> parents_;
+  std::vector<std::vector<member_pair>> children_;
+
+  /** Return true if edge {@a u, @a v} precedes edge {@a u, @a w} in a
+   * fixed pseudo-random order of all edges. Ordering ties by index instead
+   * would chain: on a path of equal weights only one edge per round is
+   * proposed from both ends. */
+  static bool edge_less(size_type u, size_type v, size_type w) {
+    return edge_hash(u, v) < edge_hash(u, w);
+  }
+
+  static std::uint64_t edge_hash(size_type a, size_type b) {
+    std::uint64_t x = (std::uint64_t(std::min(a, b)) << 32) ^ std::max(a, b);
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ull;
+    return x ^ (x >> 33);
+  }
+
+  /** Match the nodes of @a rows and number the coarse nodes: pairs by
+   * their smaller member, in order. */
+  void match(const coarsening_detail::weighted_rows<size_type>& rows,
+             std::vector<size_type>& parent,
+             std::vector<member_pair>& children) const {
+    std::size_t n = rows.size();
+    std::vector<size_type> mate(n, no_node), proposal(n, no_node);
+    for (unsigned round = 0; round < opt_.match_rounds; ++round) {
+      csr_snapshot::parallel_ranges(threads_, n, 1024,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t u = b; u < e; ++u) {
+              size_type best = no_node;
+              double best_w = 0;
+              if (mate[u] == no_node) {
+                for (std::size_t k = rows.off[u]; k < rows.off[u + 1]; ++k) {
+                  size_type v = rows.nbr[k];
+                  if (mate[v] != no_node)
+                    continue;
+                  // Heaviest first, ties by edge_less(), so all nodes rank
+                  // edges by one order and the heaviest unmatched edge is
+                  // always proposed from both ends
+                  if (best == no_node || rows.w[k] > best_w ||
+                      (rows.w[k] == best_w &&
+                       edge_less(size_type(u), v, best))) {
+                    best = v;
+                    best_w = rows.w[k];
+                  }
+                }
+              }
+              proposal[u] = best;
+            }
+          });
+      std::vector<std::size_t> matched(threads_, 0);
+      csr_snapshot::parallel_ranges(threads_, n, 1024,
+          [&](unsigned t, std::size_t b, std::size_t e) {
+            for (std::size_t u = b; u < e; ++u) {
+              size_type v = proposal[u];
+              if (v != no_node && proposal[v] == size_type(u)) {
+                mate[u] = v;
+                ++matched[t];
+              }
+            }
+          });
+      std::size_t total = 0;
+      for (std::size_t m : matched)
+        total += m;
+      if (total == 0)
+        break;
+    }
+
+    parent.resize(n);
+    children.clear();
+    for (std::size_t u = 0; u < n; ++u) {
+      if (mate[u] == no_node || size_type(u) < mate[u]) {
+        parent[u] = size_type(children.size());
+        children.push_back(member_pair{size_type(u), mate[u]});
+      }
+    }
+    csr_snapshot::parallel_ranges(threads_, n, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t u = b; u < e; ++u) {
+            if (mate[u] != no_node && mate[u] < size_type(u))
+              parent[u] = parent[mate[u]];
+          }
+        });
+  }
+
+  /** Return the graph of the coarse level with rows @a coarse, reducing
+   * positions and values from @a below, the level it coarsens. */
+  template <typename PosReduce, typename ValueReduce>
+  std::unique_ptr<G> build_level(const G& below,
+                                 const coarsening_detail::weighted_rows<size_type>& coarse,
+                                 const std::vector<member_pair>& children,
+                                 PosReduce pos, ValueReduce value) const {
+    using namespace coarsening_detail;
+    std::size_t nc = children.size();
+    std::vector<Point> points(nc);
+    csr_snapshot::parallel_ranges(threads_, nc, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t c = b; c < e; ++c) {
+            const member_pair& m = children[c];
+            Point p = below.node(m[0]).position();
+            points[c] = m[1] == no_node ? p : pos(p, below.node(m[1]).position());
+          }
+        });
+
+    auto g = std::make_unique<G>();
+    using point_iter = std::vector<Point>::const_iterator;
+    if constexpr (has_node_value<G>::value) {
+      using value_type = typename G::node_value_type;
+      std::vector<value_type> values(nc);
+      csr_snapshot::parallel_ranges(threads_, nc, 4096,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t c = b; c < e; ++c) {
+              const member_pair& m = children[c];
+              const value_type& v = below.node(m[0]).value();
+              values[c] = m[1] == no_node ? v
+                                          : value_type(value(v, below.node(m[1]).value()));
+            }
+          });
+      using value_iter = typename std::vector<value_type>::iterator;
+      if constexpr (has_add_nodes<G, point_iter, value_iter>::value) {
+        g->add_nodes(points.cbegin(), points.cend(), values.begin());
+      } else {
+        for (std::size_t c = 0; c < nc; ++c)
+          g->add_node(points[c], values[c]);
+      }
+    } else if constexpr (has_add_points<G, point_iter>::value) {
+      g->add_nodes(points.cbegin(), points.cend());
+    } else {
+      for (const Point& p : points)
+        g->add_node(p);
+    }
+
+    using pair_type = std::pair<size_type, size_type>;
+    std::vector<pair_type> pairs;
+    pairs.reserve(coarse.off[nc] / 2);
+    for (std::size_t c = 0; c < nc; ++c) {
+      for (std::size_t k = coarse.off[c]; k < coarse.off[c + 1]; ++k) {
+        if (coarse.nbr[k] > size_type(c))
+          pairs.emplace_back(size_type(c), coarse.nbr[k]);
+      }
+    }
+    if constexpr (has_add_edges<G, typename std::vector<pair_type>::const_iterator>::value) {
+      g->add_edges(pairs.cbegin(), pairs.cend());
+    } else {
+      for (const pair_type& p : pairs)
+        g->add_edge(g->node(p.first), g->node(p.second));
+    }
+    return g;
+  }
+};
+
+#endif // CME212_COARSENING_HPP
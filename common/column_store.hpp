@@ -0,0 +1,317 @@
+#ifndef CME212_COLUMN_STORE_HPP
+#define CME212_COLUMN_STORE_HPP
+
+/** @file column_store.hpp
+ * @brief Node and edge attributes kept as one memory-mapped file per
+ *        column, mapped only when a job first asks for them.
+ *
+ * A node value that carries every attribute is loaded in full even by jobs
+ * that read one of them. A ColumnStore instead keeps each attribute as its
+ * own column file in a directory: a small header followed by one element
+ * per node (or edge), in index order. A job maps the columns it uses and
+ * nothing else, and even those are paged in by the kernel only as they are
+ * touched, so startup time and resident memory follow the columns and the
+ * pages actually read:
+ *
+ *   // Once, after building the graph
+ *   ColumnStore out("attrs");
+ *   out.write("mass", mass.values());            // e.g. a NodeProperty<float>
+ *   out.write("temperature", temperature.values());
+ *
+ *   // In a job that only needs masses
+ *   ColumnStore in("attrs");
+ *   MappedColumn<float> m = in.column<float>("mass");
+ *   for (auto n : g.nodes())
+ *     total += m[n];                              // n.index() picks the row
+ *
+ * Columns are mapped privately, so writes through a MappedColumn are
+ * copy-on-write and never reach the file, as with MappedGraph. Element
+ * types must be trivially copyable; the header records the element size
+ * and the file is rejected if it does not match the type asked for.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace column_file {
+
+/** Bumped whenever the layout changes. */
+constexpr std::uint32_t version = 1;
+/** Offset of the first element; a multiple of any element alignment. */
+constexpr std::uint64_t data_offset = 64;
+
+/** Leading block of a column file. */
+struct header {
+  char magic[8];               // "CME212C" plus a terminating 0
+  std::uint32_t version;
+  std::uint32_t element_size;  // sizeof(T) of the writer
+  std::uint64_t count;         // number of elements
+};
+
+inline void set_magic(header& h) {
+  std::memcpy(h.magic, "CME212C", 8);
+}
+
+inline bool has_magic(const header& h) {
+  return std::memcmp(h.magic, "CME212C", 8) == 0;
+}
+
+/** A whole column file mapped into memory, unmapped on destruction. */
+struct mapping {
+  char* base = nullptr;
+  std::size_t bytes = 0;
+  header head{};
+
+  mapping() = default;
+  mapping(const mapping&) = delete;
+  mapping& operator=(const mapping&) = delete;
+
+  ~mapping() {
+    if (base)
+      ::munmap(base, bytes);
+  }
+};
+
+/** Map the column file at @a path, holding elements of @a element_size
+ * bytes.
+ * @throws std::runtime_error if the file cannot be opened or mapped, is not
+ *         a column file, or holds elements of another size
+ *
+ * Complexity: O(1); pages are faulted in as they are touched.
+ */
+inline std::shared_ptr<mapping> map(const std::string& path,
+                                    std::size_t element_size) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("ColumnStore: cannot open " + path);
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || std::uint64_t(st.st_size) < data_offset) {
+    ::close(fd);
+    throw std::runtime_error("ColumnStore: not a column file: " + path);
+  }
+  auto m = std::make_shared<mapping>();
+  m->bytes = std::size_t(st.st_size);
+  void* p = ::mmap(nullptr, m->bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                   fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED)
+    throw std::runtime_error("ColumnStore: cannot map " + path);
+  m->base = static_cast<char*>(p);
+
+  std::memcpy(&m->head, m->base, sizeof(header));
+  const header& h = m->head;
+  if (!has_magic(h) || h.version != version ||
+      h.element_size != element_size ||
+      data_offset + h.count * h.element_size > m->bytes)
+    throw std::runtime_error("ColumnStore: incompatible column file " + path);
+  return m;
+}
+
+} // end namespace column_file
+
+
+/** @class MappedColumn
+ * @brief One mapped column: element i is the attribute of the node or edge
+ *        with index i.
+ *
+ * A small handle; copies share the mapping, which stays mapped as long as
+ * any handle or the ColumnStore that opened it refers to it. A default
+ * constructed column is empty and maps nothing.
+ *
+ * @tparam T  Trivially copyable element type, the one the column was
+ *            written with.
+ */
+template <typename T>
+class MappedColumn {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "MappedColumn requires a trivially copyable element type");
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+
+  MappedColumn() = default;
+  explicit MappedColumn(std::shared_ptr<column_file::mapping> m)
+      : map_(std::move(m)),
+        data_(reinterpret_cast<T*>(map_->base + column_file::data_offset)),
+        size_(std::size_t(map_->head.count)) {
+  }
+
+  /** Return element @a i. Complexity: O(1), plus a page fault the first
+   * time its page is touched. */
+  T& operator[](size_type i) {
+    return data_[i];
+  }
+  const T& operator[](size_type i) const {
+    return data_[i];
+  }
+  /** Return the element of node or edge @a key, by key.index(). */
+  template <typename Key,
+            typename = decltype(std::declval<const Key&>().index())>
+  T& operator[](const Key& key) {
+    return data_[key.index()];
+  }
+  template <typename Key,
+            typename = decltype(std::declval<const Key&>().index())>
+  const T& operator[](const Key& key) const {
+    return data_[key.index()];
+  }
+
+  size_type size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+  T* data() {
+    return data_;
+  }
+  const T* data() const {
+    return data_;
+  }
+
+  /** Ask the kernel to start reading elements [@a first, @a first +
+   * @a count) in ahead of a pass over them. Only a hint. */
+  void prefetch(size_type first, size_type count) const {
+    if (count == 0 || first >= size_)
+      return;
+    count = std::min(count, size_ - first);
+    long page = ::sysconf(_SC_PAGESIZE);
+    std::uintptr_t lo = reinterpret_cast<std::uintptr_t>(data_ + first);
+    std::uintptr_t hi = reinterpret_cast<std::uintptr_t>(data_ + first + count);
+    lo -= lo % std::uintptr_t(page);
+    ::madvise(reinterpret_cast<void*>(lo), hi - lo, MADV_WILLNEED);
+  }
+
+ private:
+  std::shared_ptr<column_file::mapping> map_;
+  T* data_ = nullptr;
+  size_type size_ = 0;
+};
+
+
+/** @class ColumnStore
+ * @brief A directory of column files, one per named attribute.
+ *
+ * column<T>(name) maps a column the first time it is asked for and hands
+ * out the same mapping afterwards; columns never asked for are never
+ * opened. Thread safe: several threads may ask for columns at once.
+ */
+class ColumnStore {
+ public:
+  /** Refer to the column files in directory @a dir, which must exist. */
+  explicit ColumnStore(std::string dir) : dir_(std::move(dir)) {
+  }
+
+  ColumnStore(const ColumnStore&) = delete;
+  ColumnStore& operator=(const ColumnStore&) = delete;
+
+  /** Return the directory. */
+  const std::string& directory() const {
+    return dir_;
+  }
+
+  /** Return the path of the file of column @a name. */
+  std::string path(const std::string& name) const {
+    return dir_ + "/" + name + ".col";
+  }
+
+  /** Return true if the directory holds a file for column @a name. */
+  bool has_column(const std::string& name) const {
+    struct stat st;
+    return ::stat(path(name).c_str(), &st) == 0;
+  }
+
+  /** Write the @a count elements at @a data as column @a name, replacing
+   * any earlier column of that name. A column already mapped by this store
+   * keeps showing its old contents until close(@a name).
+   * @throws std::runtime_error if the file cannot be written
+   *
+   * Complexity: O(count), one sequential write.
+   */
+  template <typename T>
+  void write(const std::string& name, const T* data, std::size_t count) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "ColumnStore requires a trivially copyable element type");
+    column_file::header h{};
+    column_file::set_magic(h);
+    h.version = column_file::version;
+    h.element_size = std::uint32_t(sizeof(T));
+    h.count = count;
+
+    std::string p = path(name);
+    std::FILE* f = std::fopen(p.c_str(), "wb");
+    if (!f)
+      throw std::runtime_error("ColumnStore: cannot create " + p);
+    char pad[column_file::data_offset] = {};
+    std::memcpy(pad, &h, sizeof(h));
+    bool ok = std::fwrite(pad, 1, sizeof(pad), f) == sizeof(pad) &&
+              (count == 0 ||
+               std::fwrite(data, sizeof(T), count, f) == count);
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok)
+      throw std::runtime_error("ColumnStore: cannot write " + p);
+  }
+  /** Write the elements of @a values, e.g. NodeProperty::values(), as
+   * column @a name. */
+  template <typename T, typename A>
+  void write(const std::string& name, const std::vector<T, A>& values) {
+    write(name, values.data(), values.size());
+  }
+
+  /** Return column @a name, mapping it on the first call.
+   * @throws std::runtime_error if the column is missing or was written with
+   *         elements of another size than T
+   *
+   * Complexity: O(1) expected after the first call; the first maps the file
+   * without reading it.
+   */
+  template <typename T>
+  MappedColumn<T> column(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = open_.find(name);
+    if (it == open_.end())
+      it = open_.emplace(name, column_file::map(path(name), sizeof(T))).first;
+    else if (it->second->head.element_size != sizeof(T))
+      throw std::runtime_error("ColumnStore: column " + name +
+                               " has another element size");
+    return MappedColumn<T>(it->second);
+  }
+
+  /** Forget the mapping of column @a name; handles already given out keep
+   * it alive. */
+  void close(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_.erase(name);
+  }
+
+  /** Return the number of columns mapped so far and not closed. */
+  std::size_t mapped_columns() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return open_.size();
+  }
+
+ private:
+  std::string dir_;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<column_file::mapping>> open_;
+};
+
+#endif // CME212_COLUMN_STORE_HPP
@@ -0,0 +1,275 @@
+#ifndef CME212_COMPRESSED_ADJACENCY_HPP
+#define CME212_COMPRESSED_ADJACENCY_HPP
+
+/** @file compressed_adjacency.hpp
+ * @brief Read-only adjacency with gap-encoded varint rows.
+ *
+ * Sorted neighbor lists of a mesh that has been reordered (e.g. by
+ * Graph::reorder()) hold small, nearby numbers: consecutive neighbors
+ * differ by a little, and the first one lies close to the node itself.
+ * CompressedAdjacency stores each row as those differences in LEB128
+ * varints, 7 bits per byte:
+ *
+ *   row i   degree, zigzag(first - i), next - prev - 1, ...
+ *
+ * so most entries take one byte instead of four. Sweeps that are bound by
+ * memory bandwidth read correspondingly less, at the price of a short
+ * decode loop per neighbor. Like the BfsEngine snapshot, it holds the
+ * topology only (no edge ids or values) and does not follow later
+ * changes of the graph.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+
+
+namespace compressed_adjacency_detail {
+
+/** Append @a x to @a out as a LEB128 varint. */
+inline void put_varint(std::vector<std::uint8_t>& out, std::uint64_t x) {
+  while (x >= 0x80) {
+    out.push_back(std::uint8_t(x | 0x80));
+    x >>= 7;
+  }
+  out.push_back(std::uint8_t(x));
+}
+
+/** Decode the varint at @a p and advance @a p past it. */
+inline std::uint64_t get_varint(const std::uint8_t*& p) {
+  std::uint64_t x = *p++;
+  if (x < 0x80)
+    return x;
+  x &= 0x7f;
+  for (unsigned shift = 7; ; shift += 7) {
+    std::uint64_t b = *p++;
+    x |= (b & 0x7f) << shift;
+    if (b < 0x80)
+      return x;
+  }
+}
+
+inline std::uint64_t zigzag(std::int64_t v) {
+  return (std::uint64_t(v) << 1) ^ std::uint64_t(v >> 63);
+}
+inline std::int64_t unzigzag(std::uint64_t u) {
+  return std::int64_t(u >> 1) ^ -std::int64_t(u & 1);
+}
+
+} // end namespace compressed_adjacency_detail
+
+
+/** @class CompressedAdjacency
+ * @brief Neighbor lists of a graph, sorted and varint-compressed.
+ *
+ * Built from any graph with incident iterators, on several threads; each
+ * row is sorted before it is encoded, whatever order the graph keeps. A
+ * node costs 8 bytes of row offset plus its encoded row.
+ *
+ * @tparam S  Node index type.
+ */
+template <typename S>
+class CompressedAdjacency {
+ public:
+  using size_type = S;
+
+  class neighbor_iterator;
+
+  /** Construct an empty adjacency. */
+  CompressedAdjacency() : start_(1, 0) {
+  }
+
+  /** Encode the neighbor lists of @a g.
+   * @param[in] threads  Threads for the encoding; 0 means all cores
+   *
+   * Each thread encodes a contiguous block of rows into a buffer of its
+   * own, and the buffers are then appended in order, so the peak memory is
+   * about twice the compressed size, never that of a plain CSR copy.
+   *
+   * Complexity: O(g.size() + sum of d log d over the degrees d).
+   */
+  template <typename G>
+  explicit CompressedAdjacency(const G& g, unsigned threads = 0) {
+    std::size_t n = std::size_t(g.size());
+    unsigned t = csr_snapshot::thread_count(threads);
+    std::vector<std::vector<std::uint8_t>> bytes(t);
+    std::vector<std::size_t> lengths(n + 1, 0);
+    std::vector<std::size_t> counts(t, 0);
+    csr_snapshot::parallel_ranges(t, n, 1024,
+        [&](unsigned k, std::size_t b, std::size_t e) {
+          std::vector<size_type> row;
+          std::vector<std::uint8_t>& out = bytes[k];
+          for (std::size_t i = b; i < e; ++i) {
+            row.clear();
+            auto u = g.node(typename G::size_type(i));
+            for (auto it = u.edge_begin(); it != u.edge_end(); ++it)
+              row.push_back(size_type((*it).node2().index()));
+            std::sort(row.begin(), row.end());
+            std::size_t before = out.size();
+            encode(out, size_type(i), row);
+            lengths[i + 1] = out.size() - before;
+            counts[k] += row.size();
+          }
+        });
+
+    start_.resize(n + 1);
+    start_[0] = 0;
+    for (std::size_t i = 0; i < n; ++i)
+      start_[i + 1] = start_[i] + lengths[i + 1];
+    data_.reserve(start_[n]);
+    for (std::size_t k = 0; k < t; ++k) {
+      data_.insert(data_.end(), bytes[k].begin(), bytes[k].end());
+      std::vector<std::uint8_t>().swap(bytes[k]);
+      num_incidences_ += counts[k];
+    }
+    assert(data_.size() == start_[n]);
+  }
+
+  /** Return the number of nodes. */
+  size_type size() const {
+    return size_type(start_.size() - 1);
+  }
+
+  /** Return the number of stored neighbors, twice the number of edges. */
+  std::size_t num_incidences() const {
+    return num_incidences_;
+  }
+
+  /** Return the bytes held: the encoded rows and their offsets. */
+  std::size_t memory_bytes() const {
+    return data_.size() + start_.size() * sizeof(std::size_t);
+  }
+
+  /** Return the number of neighbors of node @a i.
+   * Complexity: O(1), one varint decode. */
+  size_type degree(size_type i) const {
+    const std::uint8_t* p = row(i);
+    return size_type(compressed_adjacency_detail::get_varint(p));
+  }
+
+  /** Call f(j) for every neighbor j of node @a i, in increasing order.
+   *
+   * The tightest way to read a row: one decode per neighbor and no
+   * iterator state. Complexity: O(degree(i)).
+   */
+  template <typename F>
+  void for_each_neighbor(size_type i, F f) const {
+    using namespace compressed_adjacency_detail;
+    const std::uint8_t* p = row(i);
+    std::uint64_t d = get_varint(p);
+    if (d == 0)
+      return;
+    std::int64_t j = std::int64_t(i) + unzigzag(get_varint(p));
+    for (;;) {
+      f(size_type(j));
+      if (--d == 0)
+        return;
+      std::uint64_t b = *p++;
+      if (b >= 0x80) {
+        --p;
+        b = get_varint(p);
+      }
+      j += std::int64_t(b) + 1;
+    }
+  }
+
+  /** Return true if @a j is a neighbor of @a i.
+   * Complexity: O(degree(i)), stopping at the first neighbor >= @a j. */
+  bool contains(size_type i, size_type j) const {
+    for (auto it = begin(i); it != end(i); ++it) {
+      if (*it >= j)
+        return *it == j;
+    }
+    return false;
+  }
+
+  /** Return an iterator to the smallest neighbor of node @a i. */
+  neighbor_iterator begin(size_type i) const {
+    return neighbor_iterator(row(i), i);
+  }
+  /** Return the end of the neighbors of node @a i. */
+  neighbor_iterator end(size_type) const {
+    return neighbor_iterator();
+  }
+
+  /** @class neighbor_iterator
+   * @brief Forward iterator over one row, decoding as it goes.
+   *
+   * Iterators of different rows must not be compared. */
+  class neighbor_iterator {
+   public:
+    using value_type = size_type;
+    using pointer = const size_type*;
+    using reference = size_type;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    neighbor_iterator() = default;
+
+    size_type operator*() const {
+      return size_type(value_);
+    }
+    neighbor_iterator& operator++() {
+      if (--left_ != 0)
+        value_ += std::int64_t(compressed_adjacency_detail::get_varint(p_)) + 1;
+      return *this;
+    }
+    neighbor_iterator operator++(int) {
+      neighbor_iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    bool operator==(const neighbor_iterator& x) const {
+      return left_ == x.left_;
+    }
+    bool operator!=(const neighbor_iterator& x) const {
+      return left_ != x.left_;
+    }
+
+   private:
+    friend class CompressedAdjacency;
+
+    const std::uint8_t* p_ = nullptr;
+    std::uint64_t left_ = 0;   // neighbors not yet passed, this one included
+    std::int64_t value_ = 0;
+
+    neighbor_iterator(const std::uint8_t* p, size_type i) : p_(p) {
+      using namespace compressed_adjacency_detail;
+      left_ = get_varint(p_);
+      if (left_ != 0)
+        value_ = std::int64_t(i) + unzigzag(get_varint(p_));
+    }
+  };
+
+ private:
+  // Row i is data_[start_[i] .. start_[i + 1])
+  std::vector<std::size_t> start_;
+  std::vector<std::uint8_t> data_;
+  std::size_t num_incidences_ = 0;
+
+  const std::uint8_t* row(size_type i) const {
+    assert(std::size_t(i) + 1 < start_.size());
+    return data_.data() + start_[i];
+  }
+
+  /** Append the encoding of node @a i's sorted @a row to @a out. */
+  static void encode(std::vector<std::uint8_t>& out, size_type i,
+                     const std::vector<size_type>& row) {
+    using namespace compressed_adjacency_detail;
+    put_varint(out, row.size());
+    if (row.empty())
+      return;
+    put_varint(out, zigzag(std::int64_t(row[0]) - std::int64_t(i)));
+    for (std::size_t k = 1; k < row.size(); ++k) {
+      assert(row[k] > row[k - 1]);
+      put_varint(out, std::uint64_t(row[k] - row[k - 1] - 1));
+    }
+  }
+};
+
+#endif // CME212_COMPRESSED_ADJACENCY_HPP
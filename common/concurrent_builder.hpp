@@ -0,0 +1,234 @@
+#ifndef CME212_CONCURRENT_BUILDER_HPP
+#define CME212_CONCURRENT_BUILDER_HPP
+
+/** @file concurrent_builder.hpp
+ * @brief Lock-free staging of nodes and edges from many threads, merged
+ *        into a Graph at the end.
+ *
+ * Graph::add_edge() mutates the edge array and two adjacency rows, so
+ * generator threads cannot call it at once. ConcurrentGraphBuilder gives
+ * every thread a slot of its own instead: add_node() and add_edge() append
+ * to the caller's slot without any synchronization beyond one atomic
+ * counter for node indices, and finish() merges all slots into the graph
+ * in one batch:
+ *
+ *   ConcurrentGraphBuilder<G> builder(g, threads);
+ *   csr_snapshot::parallel_ranges(threads, cells, 64,
+ *       [&](unsigned t, std::size_t b, std::size_t e) {
+ *         for (std::size_t c = b; c < e; ++c)
+ *           builder.add_edge(t, u[c], v[c]);     // slot t, no locks
+ *       });
+ *   builder.finish(true);                         // merge, then freeze()
+ *
+ * Per-thread buffers beat striped locks on the rows here: the rows are
+ * only touched once, by finish(), and the expensive sort and deduplication
+ * of the edges runs on all threads there too.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "CME212/Point.hpp"
+
+
+namespace concurrent_builder_detail {
+
+template <typename G, typename It, typename = void>
+struct has_add_nodes : std::false_type {};
+template <typename G, typename It>
+struct has_add_nodes<G, It, decltype(void(std::declval<G&>().add_nodes(
+    std::declval<It>(), std::declval<It>())))> : std::true_type {};
+
+template <typename G, typename It, typename = void>
+struct has_add_edges : std::false_type {};
+template <typename G, typename It>
+struct has_add_edges<G, It, decltype(void(std::declval<G&>().add_edges(
+    std::declval<It>(), std::declval<It>())))> : std::true_type {};
+
+template <typename G, typename = void>
+struct has_freeze : std::false_type {};
+template <typename G>
+struct has_freeze<G, std::void_t<decltype(std::declval<G&>().freeze())>>
+    : std::true_type {};
+
+} // end namespace concurrent_builder_detail
+
+
+/** @class ConcurrentGraphBuilder
+ * @brief Nodes and edges for a graph, collected concurrently.
+ *
+ * Slot t may only be used by one thread at a time; different slots may be
+ * used at once. Node indices are handed out in the order threads claim
+ * them, continuing after the nodes the graph already has.
+ *
+ * @tparam G  Graph type with add_node() and add_edge(). Graphs with
+ *            add_nodes() and add_edges() batches (hw1/Graph-24726.hpp)
+ *            take everything in one call each.
+ */
+template <typename G>
+class ConcurrentGraphBuilder {
+ public:
+  using size_type = typename G::size_type;
+  using edge_pair = std::pair<size_type, size_type>;
+
+  /** Stage additions to @a g from up to @a threads threads.
+   * @param[in] threads  Number of slots; 0 means one per core
+   */
+  explicit ConcurrentGraphBuilder(G& g, unsigned threads = 0)
+      : g_(&g), base_(size_type(g.size())), next_(0),
+        slots_(csr_snapshot::thread_count(threads)) {
+  }
+
+  ConcurrentGraphBuilder(const ConcurrentGraphBuilder&) = delete;
+  ConcurrentGraphBuilder& operator=(const ConcurrentGraphBuilder&) = delete;
+
+  /** Return the number of slots. */
+  unsigned num_slots() const {
+    return unsigned(slots_.size());
+  }
+
+  /** Stage a node at @a position from slot @a t.
+   * @return The index the node will have in the graph
+   *
+   * Complexity: O(1) amortized, one atomic increment.
+   */
+  size_type add_node(unsigned t, const Point& position) {
+    assert(t < slots_.size());
+    size_type i = next_.fetch_add(1, std::memory_order_relaxed);
+    slots_[t].nodes.emplace_back(i, position);
+    return base_ + i;
+  }
+
+  /** Stage the edge between nodes @a a and @a b from slot @a t.
+   * @pre @a a != @a b, and both are nodes of the graph or were returned by
+   *      add_node() before finish()
+   *
+   * Repeats, in either orientation and from any slots, become one edge.
+   * Complexity: O(1) amortized, and no synchronization.
+   */
+  void add_edge(unsigned t, size_type a, size_type b) {
+    assert(t < slots_.size() && a != b);
+    slots_[t].edges.emplace_back(std::min(a, b), std::max(a, b));
+  }
+
+  /** Return the number of staged edges, repeats included. Not to be called
+   * while other threads add. */
+  std::size_t num_staged_edges() const {
+    std::size_t total = 0;
+    for (const slot& s : slots_)
+      total += s.edges.size();
+    return total;
+  }
+
+  /** Add the staged nodes, then the distinct staged edges, to the graph.
+   * @param[in] freeze  Call the graph's freeze() afterwards, if it has one
+   * @return The number of new edges
+   *
+   * @pre No thread is adding
+   * @post Every staged node has the index add_node() returned and its
+   *       position, with a default value. The builder is empty and may be
+   *       used again.
+   *
+   * Each slot's edges are sorted and deduplicated on its own thread, then
+   * the sorted runs are merged pairwise, one level at a time, with every
+   * merge on a thread of its own.
+   *
+   * Complexity: O(k log k / threads + k log threads) for k staged edges,
+   * plus adding the result to the graph.
+   */
+  std::size_t finish(bool freeze = false) {
+    add_staged_nodes();
+
+    unsigned threads = unsigned(slots_.size());
+    std::vector<std::vector<edge_pair>> runs(threads);
+    csr_snapshot::parallel_ranges(threads, threads, 1,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t k = b; k < e; ++k) {
+            std::vector<edge_pair>& r = slots_[k].edges;
+            std::sort(r.begin(), r.end());
+            r.erase(std::unique(r.begin(), r.end()), r.end());
+            runs[k].swap(r);
+          }
+        });
+    for (std::size_t width = 1; width < runs.size(); width *= 2) {
+      std::size_t pairs = (runs.size() + 2 * width - 1) / (2 * width);
+      csr_snapshot::parallel_ranges(threads, pairs, 1,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t p = b; p < e; ++p) {
+              std::size_t x = 2 * width * p;
+              std::size_t y = x + width;
+              if (y >= runs.size())
+                continue;
+              std::vector<edge_pair> out;
+              out.reserve(runs[x].size() + runs[y].size());
+              std::set_union(runs[x].begin(), runs[x].end(),
+                             runs[y].begin(), runs[y].end(),
+                             std::back_inserter(out));
+              runs[x].swap(out);
+              std::vector<edge_pair>().swap(runs[y]);
+            }
+          });
+    }
+    std::vector<edge_pair> edges;
+    if (!runs.empty())
+      edges.swap(runs[0]);
+
+    std::size_t before = std::size_t(g_->num_edges());
+    using pair_iter = typename std::vector<edge_pair>::const_iterator;
+    if constexpr (concurrent_builder_detail::has_add_edges<G, pair_iter>::value) {
+      g_->add_edges(edges.cbegin(), edges.cend());
+    } else {
+      for (const edge_pair& e : edges)
+        g_->add_edge(g_->node(e.first), g_->node(e.second));
+    }
+    if constexpr (concurrent_builder_detail::has_freeze<G>::value) {
+      if (freeze)
+        g_->freeze();
+    }
+    base_ = size_type(g_->size());
+    return std::size_t(g_->num_edges()) - before;
+  }
+
+ private:
+  // One writer's staging area, padded so that two slots never share a
+  // cache line
+  struct alignas(64) slot {
+    std::vector<std::pair<size_type, Point>> nodes;
+    std::vector<edge_pair> edges;
+  };
+
+  G* g_;
+  size_type base_;
+  std::atomic<size_type> next_;
+  std::vector<slot> slots_;
+
+  /** Append the staged nodes to the graph in index order. */
+  void add_staged_nodes() {
+    size_type count = next_.exchange(0, std::memory_order_relaxed);
+    if (count == 0)
+      return;
+    assert(size_type(g_->size()) == base_);
+    std::vector<Point> positions(count);
+    for (slot& s : slots_) {
+      for (const auto& p : s.nodes)
+        positions[p.first] = p.second;
+      std::vector<std::pair<size_type, Point>>().swap(s.nodes);
+    }
+    using point_iter = std::vector<Point>::const_iterator;
+    if constexpr (concurrent_builder_detail::has_add_nodes<G, point_iter>::value) {
+      g_->add_nodes(positions.cbegin(), positions.cend());
+    } else {
+      for (const Point& p : positions)
+        g_->add_node(p);
+    }
+  }
+};
+
+#endif // CME212_CONCURRENT_BUILDER_HPP
@@ -0,0 +1,199 @@
+#ifndef CME212_CONNECTED_COMPONENTS_HPP
+#define CME212_CONNECTED_COMPONENTS_HPP
+
+/** @file connected_components.hpp
+ * @brief Multithreaded connected component labeling by lock-free
+ *        union-find over the edge array.
+ *
+ * A BFS labels components one level at a time, so on a mesh with a long
+ * diameter it runs many short, poorly parallel steps. connected_components()
+ * instead makes a single parallel pass over the edges, joining the trees of
+ * the two endpoints of each one, in the style of Shiloach and Vishkin's
+ * hooking and of the concurrent union-find of Jayanti and Tarjan:
+ *
+ *   auto comp = g.make_node_property<Graph<int>::size_type>();
+ *   cc_report r = connected_components(g, comp);   // comp[n] = label of n
+ *
+ * Every tree is hooked under the root with the smaller index, with one
+ * compare-and-swap, and finds halve their paths as they go, so no locks
+ * are taken and the trees stay flat. A second pass then writes each node's
+ * root as its label. The edges come straight from edge_endpoints_data() on
+ * graphs that have it (hw1/Graph-24726.hpp) and from edge(k) otherwise.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/trace.hpp"
+
+
+/** Tuning knobs for connected_components(). */
+struct cc_options {
+  /** Worker threads. 0 means std::thread::hardware_concurrency(). */
+  unsigned threads = 0;
+};
+
+/** What one labeling found and how fast. */
+struct cc_report {
+  std::uint64_t components = 0;   // distinct labels, isolated nodes included
+  std::uint64_t largest = 0;      // nodes in the largest component
+  double seconds = 0;             // wall time, including the label fill
+};
+
+
+namespace connected_components_detail {
+
+template <typename G, typename = void>
+struct has_endpoints_data : std::false_type {};
+template <typename G>
+struct has_endpoints_data<G, std::void_t<
+    decltype(std::declval<const G&>().edge_endpoints_data())>>
+    : std::true_type {};
+
+template <typename G, typename = void>
+struct has_edge_tombstones : std::false_type {};
+template <typename G>
+struct has_edge_tombstones<G, std::void_t<
+    decltype(std::declval<const G&>().num_removed_edges()),
+    decltype(std::declval<const G&>().is_removed(
+        std::declval<const G&>().edge(0)))>> : std::true_type {};
+
+/** Union-find forest on atomic parent links. */
+template <typename S>
+class forest {
+ public:
+  forest(std::size_t n, unsigned threads) : parent_(new std::atomic<S>[n]) {
+    csr_snapshot::parallel_ranges(threads, n, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i)
+            parent_[i].store(S(i), std::memory_order_relaxed);
+        });
+  }
+
+  /** Return the root of @a x, pointing every node on the way at its
+   * grandparent. The root found was a root at some moment during the
+   * call. */
+  S find(S x) {
+    for (;;) {
+      S p = parent_[x].load(std::memory_order_relaxed);
+      if (p == x)
+        return x;
+      S gp = parent_[p].load(std::memory_order_relaxed);
+      if (gp != p)
+        parent_[x].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+      x = gp;
+    }
+  }
+
+  /** Merge the trees of @a a and @a b by hooking the larger root under the
+   * smaller one. Retries if another thread hooks either root first. */
+  void link(S a, S b) {
+    for (;;) {
+      a = find(a);
+      b = find(b);
+      if (a == b)
+        return;
+      if (a < b)
+        std::swap(a, b);
+      S expected = a;
+      if (parent_[a].compare_exchange_strong(expected, b,
+                                             std::memory_order_relaxed))
+        return;
+    }
+  }
+
+ private:
+  std::unique_ptr<std::atomic<S>[]> parent_;
+};
+
+} // end namespace connected_components_detail
+
+
+/** Label every node of @a g with the smallest node index in its connected
+ * component.
+ * @param[out] labels  Receives labels[i] for every node index i
+ * @return Number of components, size of the largest one, and timing
+ *
+ * @tparam Labels  Indexable by node index with at least g.size() entries,
+ *                 e.g. a NodeProperty<size_type> from make_node_property()
+ *                 or a std::vector<size_type>
+ *
+ * @post labels[i] == labels[j] exactly when nodes i and j are connected,
+ *       and labels[i] <= i
+ *
+ * The labels do not depend on the number of threads. Edges removed by
+ * lazy_remove_edge() join nothing; a node removed by lazy_remove_node()
+ * ends up alone in its own component. Reading the graph from several
+ * threads must be safe, which holds as long as operation counting
+ * (CME212_GRAPH_STATS) is off.
+ *
+ * Complexity: O((g.size() + g.num_edges()) / threads) for the flat trees
+ * that hooking to the smaller root gives on meshes, and
+ * O(g.num_edges() log g.size() / threads) at worst.
+ */
+template <typename G, typename Labels>
+cc_report connected_components(const G& g, Labels& labels,
+                               const cc_options& opt = cc_options()) {
+  using namespace connected_components_detail;
+  using size_type = typename G::size_type;
+  CME212_TRACE_SCOPE("connected_components");
+  auto start = std::chrono::steady_clock::now();
+  unsigned threads = csr_snapshot::thread_count(opt.threads);
+  std::size_t n = std::size_t(g.size());
+  std::size_t m = std::size_t(g.num_edges());
+
+  forest<size_type> f(n, threads);
+  bool tombstones = false;
+  if constexpr (has_edge_tombstones<G>::value)
+    tombstones = g.num_removed_edges() != 0;
+  csr_snapshot::parallel_ranges(threads, m, 4096,
+      [&](unsigned, std::size_t b, std::size_t e) {
+        for (std::size_t k = b; k < e; ++k) {
+          if constexpr (has_edge_tombstones<G>::value) {
+            if (tombstones && g.is_removed(g.edge(size_type(k))))
+              continue;
+          }
+          if constexpr (has_endpoints_data<G>::value) {
+            const size_type* ends = g.edge_endpoints_data();
+            f.link(ends[2 * k], ends[2 * k + 1]);
+          } else {
+            auto edge = g.edge(size_type(k));
+            f.link(size_type(edge.node1().index()),
+                   size_type(edge.node2().index()));
+          }
+        }
+      });
+
+  // Roots are the smallest index of their tree, so a node's label is final
+  // once its own root is found; count each tree at its root
+  std::vector<std::size_t> roots(threads, 0);
+  csr_snapshot::parallel_ranges(threads, n, 4096,
+      [&](unsigned t, std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i) {
+          size_type r = f.find(size_type(i));
+          labels[i] = r;
+          roots[t] += (r == size_type(i));
+        }
+      });
+
+  cc_report report;
+  for (std::size_t c : roots)
+    report.components += c;
+  std::vector<size_type> sizes(n, 0);
+  for (std::size_t i = 0; i < n; ++i)
+    report.largest = std::max<std::uint64_t>(report.largest,
+                                             ++sizes[size_type(labels[i])]);
+  report.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return report;
+}
+
+#endif // CME212_CONNECTED_COMPONENTS_HPP
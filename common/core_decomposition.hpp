@@ -0,0 +1,268 @@
+#ifndef CME212_CORE_DECOMPOSITION_HPP
+#define CME212_CORE_DECOMPOSITION_HPP
+
+/** @file core_decomposition.hpp
+ * @brief Degree ordering and parallel k-core decomposition, returned as
+ *        node permutations for Graph::permute_nodes().
+ *
+ * The k-core of a graph is its largest subgraph in which every node has at
+ * least k neighbors, and a node's core number is the largest k whose core
+ * contains it. core_numbers() finds them by peeling, one k at a time, in
+ * the style of the ParK and PKC algorithms: every node left with degree k
+ * is removed at once, on several threads, and the neighbors it leaves
+ * behind with degree k are removed in the next round, until none remains.
+ *
+ *   std::vector<Graph<int>::size_type> core;
+ *   core_report r = core_numbers(g, core);       // core[i] of node i
+ *   g.permute_nodes(core_order(g));              // densest core first
+ *   g.permute_nodes(degree_order(g, true));      // hubs first
+ *
+ * The orderings return perm with perm[i] the new index of node i, the
+ * convention of Graph::reorder() and Graph::permute_nodes(). Degrees come
+ * from g.degrees() in O(1) per node on graphs that have it
+ * (hw1/Graph-24726.hpp), and are counted over the incident iterators
+ * otherwise.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/trace.hpp"
+
+
+/** Tuning knobs for core_numbers() and core_order(). */
+struct core_options {
+  /** Worker threads. 0 means std::thread::hardware_concurrency(). */
+  unsigned threads = 0;
+};
+
+/** What one decomposition found and how fast. */
+struct core_report {
+  std::uint64_t max_core = 0;    // the degeneracy of the graph
+  std::uint64_t rounds = 0;      // peeling rounds over all k
+  double seconds = 0;
+};
+
+
+namespace core_decomposition_detail {
+
+template <typename T>
+struct is_vector : std::false_type {};
+template <typename T, typename A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+/** Return perm with perm[i] the rank of node i when the nodes are sorted by
+ * @a key, stably, by counting sort.
+ *
+ * Complexity: O(key.size() + largest key).
+ */
+template <typename S>
+std::vector<S> bucket_permutation(const std::vector<std::size_t>& key,
+                                  bool descending) {
+  std::size_t n = key.size();
+  std::size_t top = 0;
+  for (std::size_t k : key)
+    top = std::max(top, k);
+  // start[b] is the first rank of bucket b, buckets taken in sorted order
+  std::vector<std::size_t> start(top + 2, 0);
+  for (std::size_t k : key)
+    ++start[(descending ? top - k : k) + 1];
+  for (std::size_t b = 0; b <= top; ++b)
+    start[b + 1] += start[b];
+  std::vector<S> perm(n);
+  for (std::size_t i = 0; i < n; ++i)
+    perm[i] = S(start[descending ? top - key[i] : key[i]]++);
+  return perm;
+}
+
+/** Peel @a g into its cores. Sets core[i] to the core number of node i and
+ * order to the node indices in the order they were peeled. */
+template <typename G>
+core_report peel(const G& g, std::vector<std::size_t>& core,
+                 std::vector<typename G::size_type>& order, unsigned threads) {
+  using size_type = typename G::size_type;
+  std::size_t n = std::size_t(g.size());
+  std::vector<std::size_t> offsets = csr_snapshot::row_offsets(g, threads);
+  std::vector<size_type> neighbors(offsets[n]);
+  csr_snapshot::fill_neighbors(g, offsets, threads, neighbors.data());
+
+  std::unique_ptr<std::atomic<std::size_t>[]> degree(
+      new std::atomic<std::size_t>[n]);
+  for (std::size_t i = 0; i < n; ++i)
+    degree[i].store(offsets[i + 1] - offsets[i], std::memory_order_relaxed);
+  std::vector<std::uint8_t> done(n, 0);
+  core.assign(n, 0);
+  order.clear();
+  order.reserve(n);
+
+  core_report report;
+  std::vector<size_type> alive(n);
+  for (std::size_t i = 0; i < n; ++i)
+    alive[i] = size_type(i);
+  std::vector<std::vector<size_type>> local(threads);
+  std::vector<std::size_t> lowest(threads);
+  std::vector<size_type> frontier;
+  std::size_t k = 0;
+
+  while (!alive.empty()) {
+    // Drop the nodes peeled at the last k and find the next k: no node left
+    // has a degree below it
+    std::size_t kept = 0;
+    for (size_type v : alive)
+      if (!done[v])
+        alive[kept++] = v;
+    alive.resize(kept);
+    if (alive.empty())
+      break;
+    std::fill(lowest.begin(), lowest.end(), SIZE_MAX);
+    csr_snapshot::parallel_ranges(threads, alive.size(), 4096,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          std::size_t m = SIZE_MAX;
+          for (std::size_t x = b; x < e; ++x)
+            m = std::min(m, degree[alive[x]].load(std::memory_order_relaxed));
+          lowest[t] = m;
+        });
+    k = std::max(k, *std::min_element(lowest.begin(), lowest.end()));
+    report.max_core = k;
+
+    frontier.clear();
+    for (size_type v : alive)
+      if (degree[v].load(std::memory_order_relaxed) == k)
+        frontier.push_back(v);
+
+    while (!frontier.empty()) {
+      for (size_type v : frontier) {
+        done[v] = 1;
+        core[v] = k;
+      }
+      order.insert(order.end(), frontier.begin(), frontier.end());
+      for (auto& l : local)
+        l.clear();
+      // A neighbor above k loses one degree per peeled neighbor. The one
+      // decrement that takes it from k + 1 to k queues it, and decrements
+      // that lose a race below k are undone, so it rests at exactly k.
+      csr_snapshot::parallel_ranges(threads, frontier.size(), 256,
+          [&](unsigned t, std::size_t b, std::size_t e) {
+            for (std::size_t x = b; x < e; ++x) {
+              size_type v = frontier[x];
+              for (std::size_t j = offsets[v]; j < offsets[v + 1]; ++j) {
+                size_type u = neighbors[j];
+                if (degree[u].load(std::memory_order_relaxed) <= k)
+                  continue;
+                std::size_t before =
+                    degree[u].fetch_sub(1, std::memory_order_relaxed);
+                if (before == k + 1)
+                  local[t].push_back(u);
+                else if (before <= k)
+                  degree[u].fetch_add(1, std::memory_order_relaxed);
+              }
+            }
+          });
+      frontier.clear();
+      for (const auto& l : local)
+        frontier.insert(frontier.end(), l.begin(), l.end());
+      // Which thread queues a node depends on timing; sorting keeps the
+      // peeling order the same for every thread count
+      std::sort(frontier.begin(), frontier.end());
+      ++report.rounds;
+    }
+  }
+  return report;
+}
+
+} // end namespace core_decomposition_detail
+
+
+/** Return the permutation that numbers the nodes of @a g by degree.
+ * @param[in] descending  Whether the highest degree comes first
+ * @param[in] threads     Threads for counting degrees on graphs without
+ *                        degrees(); 0 means all cores
+ * @return perm with perm[i] the new index of node i, for
+ *         g.permute_nodes(perm). Nodes of equal degree keep their relative
+ *         order.
+ *
+ * Complexity: O(g.size() + largest degree) with degrees(), plus
+ * O(g.num_edges()) over the threads without.
+ */
+template <typename G>
+std::vector<typename G::size_type> degree_order(const G& g,
+                                                bool descending = false,
+                                                unsigned threads = 0) {
+  std::size_t n = std::size_t(g.size());
+  std::vector<std::size_t> offsets =
+      csr_snapshot::row_offsets(g, csr_snapshot::thread_count(threads));
+  std::vector<std::size_t> degree(n);
+  for (std::size_t i = 0; i < n; ++i)
+    degree[i] = offsets[i + 1] - offsets[i];
+  return core_decomposition_detail::bucket_permutation<
+      typename G::size_type>(degree, descending);
+}
+
+/** Set core[i] to the core number of node i of @a g.
+ * @param[out] core  Receives core[i] for every node index i
+ * @return The largest core number, the peeling rounds, and timing
+ *
+ * @tparam Cores  Indexable by node index with at least g.size() entries,
+ *                e.g. a NodeProperty<size_type> from make_node_property()
+ *                or a std::vector<size_type>, resized if it is a vector
+ *
+ * The result does not depend on the number of threads. Reading the graph
+ * from several threads must be safe, which holds as long as operation
+ * counting (CME212_GRAPH_STATS) is off.
+ *
+ * Complexity: O(g.size() * distinct core numbers + g.num_edges()), spread
+ * over the threads within every peeling round.
+ */
+template <typename G, typename Cores>
+core_report core_numbers(const G& g, Cores& core,
+                         const core_options& opt = core_options()) {
+  CME212_TRACE_SCOPE("core_numbers");
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::size_t> c;
+  std::vector<typename G::size_type> order;
+  core_report report = core_decomposition_detail::peel(
+      g, c, order, csr_snapshot::thread_count(opt.threads));
+  if constexpr (core_decomposition_detail::is_vector<Cores>::value)
+    core.resize(c.size());
+  for (std::size_t i = 0; i < c.size(); ++i)
+    core[i] = c[i];
+  report.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return report;
+}
+
+/** Return the permutation that numbers the nodes of @a g in the order
+ * core_numbers() peels them: a degeneracy ordering, in which every node has
+ * at most max_core neighbors later in the order.
+ * @param[in] densest_first  Whether to reverse it, so the innermost core
+ *                           gets the lowest indices
+ * @return perm with perm[i] the new index of node i, for
+ *         g.permute_nodes(perm). Core numbers never decrease along the
+ *         peeling order.
+ *
+ * Complexity: as core_numbers().
+ */
+template <typename G>
+std::vector<typename G::size_type> core_order(
+    const G& g, bool densest_first = true,
+    const core_options& opt = core_options()) {
+  using size_type = typename G::size_type;
+  std::vector<std::size_t> c;
+  std::vector<size_type> order;
+  core_decomposition_detail::peel(g, c, order,
+                                  csr_snapshot::thread_count(opt.threads));
+  std::size_t n = order.size();
+  std::vector<size_type> perm(n);
+  for (std::size_t k = 0; k < n; ++k)
+    perm[order[k]] = size_type(densest_first ? n - 1 - k : k);
+  return perm;
+}
+
+#endif // CME212_CORE_DECOMPOSITION_HPP
@@ -0,0 +1,141 @@
+#ifndef CME212_CSR_SNAPSHOT_HPP
+#define CME212_CSR_SNAPSHOT_HPP
+
+/** @file csr_snapshot.hpp
+ * @brief Helpers for copying a graph's adjacency into flat CSR arrays on
+ *        several threads.
+ *
+ * The traversal engines (parallel_bfs.hpp, delta_stepping.hpp) run on their
+ * own compressed sparse row copy of the adjacency, which makes them fast on
+ * every Graph variant that has incident iterators. These are the shared
+ * pieces: a thread splitter over ThreadPool::shared() (thread_pool.hpp)
+ * and the two passes that build the copy.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/graph_traits.hpp"
+#include "common/thread_pool.hpp"
+
+
+namespace csr_snapshot {
+
+/** Return @a threads, or the size of ThreadPool::shared() if it is 0:
+ * std::thread::hardware_concurrency() unless ThreadPool::configure() set
+ * another count. */
+inline unsigned thread_count(unsigned threads) {
+  return threads ? threads : ThreadPool::shared().size();
+}
+
+/** Split [0, n) into at most @a threads contiguous ranges whose bounds are
+ * multiples of @a grain and call fn(t, begin, end) for range t, each on its
+ * own thread. The calling thread runs range 0 and worker t of
+ * ThreadPool::shared() range t, so repeated calls with the same split put
+ * the same range on the same thread. */
+template <typename Fn>
+void parallel_ranges(unsigned threads, std::size_t n, std::size_t grain,
+                     Fn fn) {
+  std::size_t blocks = (n + grain - 1) / grain;
+  threads = unsigned(std::max<std::size_t>(
+      1, std::min<std::size_t>(threads, blocks)));
+  if (threads == 1) {
+    fn(0u, std::size_t(0), n);
+    return;
+  }
+  auto bound = [&](unsigned t) {
+    return std::min(n, blocks * t / threads * grain);
+  };
+  ThreadPool::shared().run_ranges(threads, [&](unsigned t) {
+    fn(t, bound(t), bound(t + 1));
+  });
+}
+
+/** Return the CSR row offsets of @a g: entry i + 1 - entry i is the degree
+ * of node i. Copied from g.offset() on graphs with CSR rows, taken from
+ * g.degrees() or Node::degree() when the graph has them, and counted over
+ * the incident iterators otherwise (graph_traits.hpp). */
+template <typename G>
+std::vector<std::size_t> row_offsets(const G& g, unsigned threads) {
+  using size_type = typename G::size_type;
+  std::size_t n = std::size_t(g.size());
+  std::vector<std::size_t> offsets(n + 1, 0);
+  if constexpr (graph_traits::has_csr_rows<G>::value) {
+    std::size_t first = std::size_t(g.offset(0));
+    for (std::size_t i = 0; i <= n; ++i)
+      offsets[i] = std::size_t(g.offset(size_type(i))) - first;
+    return offsets;
+  } else if constexpr (graph_traits::has_degree_array<G>::value) {
+    const auto* degree = g.degrees();
+    for (std::size_t i = 0; i < n; ++i)
+      offsets[i + 1] = std::size_t(degree[i]);
+  } else {
+    parallel_ranges(threads, n, 1024,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i) {
+            auto u = g.node(size_type(i));
+            std::size_t d = 0;
+            if constexpr (graph_traits::has_constant_degree<G>::value) {
+              d = std::size_t(u.degree());
+            } else {
+              for (auto it = u.edge_begin(); it != u.edge_end(); ++it)
+                ++d;
+            }
+            offsets[i + 1] = d;
+          }
+        });
+  }
+  for (std::size_t i = 0; i < n; ++i)
+    offsets[i + 1] += offsets[i];
+  return offsets;
+}
+
+/** Call fill(k, edge) for every incident edge of every node i of @a g, in
+ * incident iterator order, with k running over [offsets[i], offsets[i + 1]).
+ * edge.node1() is node i. */
+template <typename G, typename Fill>
+void fill_rows(const G& g, const std::vector<std::size_t>& offsets,
+               unsigned threads, Fill fill) {
+  parallel_ranges(threads, std::size_t(g.size()), 1024,
+      [&](unsigned, std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i) {
+          auto u = g.node(typename G::size_type(i));
+          std::size_t k = offsets[i];
+          for (auto it = u.edge_begin(); it != u.edge_end(); ++it)
+            fill(k++, *it);
+          assert(k == offsets[i + 1]);
+        }
+      });
+}
+
+/** Write the neighbor index of every incident edge of every node i of
+ * @a g to @a neighbors[offsets[i], offsets[i + 1]), in incident iterator
+ * order: a copy of g.neighbors_data() on graphs with CSR rows, and
+ * fill_rows() over e.node2().index() otherwise.
+ * @pre @a offsets is row_offsets(g, ...)
+ */
+template <typename G, typename T>
+void fill_neighbors(const G& g, const std::vector<std::size_t>& offsets,
+                    unsigned threads, T* neighbors) {
+  if constexpr (graph_traits::has_csr_rows<G>::value) {
+    const auto* row = g.neighbors_data() + g.offset(0);
+    parallel_ranges(threads, offsets.back(), 1 << 14,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t k = b; k < e; ++k)
+            neighbors[k] = T(row[k]);
+        });
+  } else {
+    fill_rows(g, offsets, threads, [&](std::size_t k, const auto& e) {
+      neighbors[k] = T(e.node2().index());
+    });
+  }
+}
+
+} // end namespace csr_snapshot
+
+#endif // CME212_CSR_SNAPSHOT_HPP
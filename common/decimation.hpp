@@ -0,0 +1,493 @@
+#ifndef CME212_DECIMATION_HPP
+#define CME212_DECIMATION_HPP
+
+/** @file decimation.hpp
+ * @brief Triangle mesh simplification by quadric error edge collapse, in
+ *        place on a graph with lazy node removal.
+ *
+ * Following Garland and Heckbert ("Surface simplification using quadric
+ * error metrics", SIGGRAPH 1997), every node carries a quadric: the sum of
+ * the squared distance functions to the planes of the triangles around it.
+ * Collapsing an edge merges its two nodes into one, placed where the sum
+ * of their quadrics is smallest, and that sum is the cost of the collapse.
+ * The cheapest edge goes first, again and again, until the mesh is small
+ * enough:
+ *
+ *   decimation_options opt;
+ *   opt.target_nodes = g.num_nodes() / 10;         // level of detail 1
+ *   decimation_report r = decimate(g, opt);
+ *
+ * The triangles are those of the graph: three pairwise adjacent nodes, as
+ * a mesh loaded through mesh.hpp leaves them. Boundary edges, those of a
+ * single triangle, add a plane through the edge perpendicular to their
+ * triangle, so the outline of an open mesh is kept as well as its surface.
+ *
+ * A collapse of (a, b) moves a, rewires the edges of b to a, with add_edge()
+ * and each its old value, and removes b with lazy_remove_node(), so node
+ * and edge indices stay put until the single compact() at the end. The
+ * costs are kept in a binary heap indexed by edge, and after a collapse
+ * only the edges around the merged node, the only ones whose cost
+ * changed, are updated in it.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "common/trace.hpp"
+#include "CME212/Point.hpp"
+
+
+/** Tuning knobs for decimate(). */
+struct decimation_options {
+  /** Stop once at most this many nodes are left. */
+  std::size_t target_nodes = 0;
+  /** Stop before the first collapse that costs more than this. */
+  double max_error = std::numeric_limits<double>::infinity();
+  /** Weight of the planes that hold boundary edges in place, relative to
+   * the triangle planes: 0 lets the outline shrink freely. */
+  double boundary_weight = 1000;
+  /** Compact the graph once the collapses are done. */
+  bool compact = true;
+};
+
+/** What one decimation did. */
+struct decimation_report {
+  std::uint64_t collapses = 0;    // edges collapsed, one node less each
+  std::uint64_t rejected = 0;     // collapses refused by the mesh checks
+  std::uint64_t updates = 0;      // edge costs recomputed after collapses
+  std::uint64_t nodes = 0;        // live nodes left
+  std::uint64_t edges = 0;        // live edges left
+  double max_cost = 0;            // largest cost collapsed
+  double seconds = 0;             // wall time, compaction included
+};
+
+
+namespace decimation_detail {
+
+/** Symmetric 4x4 quadric Q, as the 10 coefficients of its upper triangle.
+ * The error of a point v is [v 1] Q [v 1]^T. */
+struct quadric {
+  double q[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+  /** Add @a w times the squared distance to the plane n.v + d = 0, with
+   * |n| = 1. */
+  void add_plane(const Point& n, double d, double w) {
+    const double p[4] = {n.x, n.y, n.z, d};
+    int k = 0;
+    for (int i = 0; i < 4; ++i)
+      for (int j = i; j < 4; ++j)
+        q[k++] += w * p[i] * p[j];
+  }
+
+  quadric& operator+=(const quadric& o) {
+    for (int k = 0; k < 10; ++k)
+      q[k] += o.q[k];
+    return *this;
+  }
+
+  double error(const Point& v) const {
+    const double x = v.x, y = v.y, z = v.z;
+    return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+         + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+         + q[7] * z * z + 2 * q[8] * z
+         + q[9];
+  }
+
+  /** Set @a v to the point of least error and return true, or return false
+   * if the quadric is too close to singular to have one. */
+  bool minimum(Point& v) const {
+    // Solve A v = -b by Cramer's rule, with A the upper 3x3 block
+    const double a00 = q[0], a01 = q[1], a02 = q[2];
+    const double a11 = q[4], a12 = q[5], a22 = q[7];
+    const double b0 = -q[3], b1 = -q[6], b2 = -q[8];
+    const double c00 = a11 * a22 - a12 * a12;
+    const double c01 = a02 * a12 - a01 * a22;
+    const double c02 = a01 * a12 - a02 * a11;
+    const double det = a00 * c00 + a01 * c01 + a02 * c02;
+    const double scale = a00 + a11 + a22;
+    if (!(std::abs(det) > 1e-10 * scale * scale * scale))
+      return false;
+    const double c11 = a00 * a22 - a02 * a02;
+    const double c12 = a01 * a02 - a00 * a12;
+    const double c22 = a00 * a11 - a01 * a01;
+    v = Point((c00 * b0 + c01 * b1 + c02 * b2) / det,
+              (c01 * b0 + c11 * b1 + c12 * b2) / det,
+              (c02 * b0 + c12 * b1 + c22 * b2) / det);
+    return true;
+  }
+};
+
+/** Binary min-heap of edge indices by (cost, tie), with a slot table so
+ * that any edge's entry can be updated or removed in O(log n). */
+template <typename S>
+class edge_heap {
+ public:
+  struct entry {
+    double cost;
+    double tie;
+    S edge;
+  };
+
+  bool empty() const {
+    return heap_.empty();
+  }
+  const entry& top() const {
+    return heap_.front();
+  }
+
+  /** Insert edge @a e, or move it to its new key if it is in. */
+  void set(S e, double cost, double tie) {
+    if (std::size_t(e) >= slot_.size())
+      slot_.resize(std::size_t(e) + 1, none);
+    std::size_t i = slot_[e];
+    if (i == none) {
+      i = heap_.size();
+      heap_.push_back({cost, tie, e});
+      slot_[e] = i;
+      sift_up(i);
+      return;
+    }
+    entry old = heap_[i];
+    heap_[i].cost = cost;
+    heap_[i].tie = tie;
+    if (less(heap_[i], old))
+      sift_up(i);
+    else
+      sift_down(i);
+  }
+
+  /** Remove edge @a e, if it is in. */
+  void erase(S e) {
+    if (std::size_t(e) >= slot_.size() || slot_[e] == none)
+      return;
+    std::size_t i = slot_[e];
+    slot_[e] = none;
+    entry last = heap_.back();
+    heap_.pop_back();
+    if (i == heap_.size())
+      return;
+    heap_[i] = last;
+    slot_[last.edge] = i;
+    sift_up(i);
+    sift_down(slot_[last.edge]);
+  }
+
+ private:
+  static constexpr std::size_t none = std::size_t(-1);
+  std::vector<entry> heap_;
+  std::vector<std::size_t> slot_;   // slot_[e] is e's place in heap_
+
+  static bool less(const entry& x, const entry& y) {
+    return x.cost < y.cost ||
+           (x.cost == y.cost && (x.tie < y.tie ||
+                                 (x.tie == y.tie && x.edge < y.edge)));
+  }
+
+  void sift_up(std::size_t i) {
+    entry x = heap_[i];
+    while (i > 0) {
+      std::size_t p = (i - 1) / 2;
+      if (!less(x, heap_[p]))
+        break;
+      heap_[i] = heap_[p];
+      slot_[heap_[i].edge] = i;
+      i = p;
+    }
+    heap_[i] = x;
+    slot_[x.edge] = i;
+  }
+
+  void sift_down(std::size_t i) {
+    entry x = heap_[i];
+    std::size_t n = heap_.size();
+    for (;;) {
+      std::size_t c = 2 * i + 1;
+      if (c >= n)
+        break;
+      if (c + 1 < n && less(heap_[c + 1], heap_[c]))
+        ++c;
+      if (!less(heap_[c], x))
+        break;
+      heap_[i] = heap_[c];
+      slot_[heap_[i].edge] = i;
+      i = c;
+    }
+    heap_[i] = x;
+    slot_[x.edge] = i;
+  }
+};
+
+/** The state of one decimate() call. */
+template <typename G>
+class collapser {
+ public:
+  using size_type = typename G::size_type;
+
+  collapser(G& g, const decimation_options& opt) : g_(g), opt_(opt) {
+  }
+
+  decimation_report run() {
+    decimation_report report;
+    std::size_t n = std::size_t(g_.num_nodes());
+    std::size_t live = n - std::size_t(g_.num_removed_nodes());
+    pos_.resize(n);
+    for (std::size_t i = 0; i < n; ++i)
+      pos_[i] = g_.node(size_type(i)).position();
+    init_quadrics();
+    for (auto it = g_.edge_begin(); it != g_.edge_end(); ++it)
+      update((*it).index());
+
+    const double inf = std::numeric_limits<double>::infinity();
+    while (live > opt_.target_nodes && !heap_.empty()) {
+      typename edge_heap<size_type>::entry top = heap_.top();
+      if (!(top.cost < inf) || top.cost > opt_.max_error)
+        break;
+      auto e = g_.edge(top.edge);
+      size_type a = e.node1().index();
+      size_type b = e.node2().index();
+      Point v;
+      evaluate(a, b, v);
+      if (!can_collapse(a, b, v)) {
+        heap_.set(top.edge, inf, top.tie);   // until its neighbors change
+        ++report.rejected;
+        continue;
+      }
+      report.max_cost = std::max(report.max_cost, top.cost);
+      report.updates += collapse(top.edge, a, b, v);
+      ++report.collapses;
+      --live;
+    }
+
+    if (opt_.compact)
+      g_.compact();
+    report.nodes = std::uint64_t(live);
+    report.edges = std::uint64_t(g_.num_edges() - g_.num_removed_edges());
+    return report;
+  }
+
+ private:
+  G& g_;
+  const decimation_options& opt_;
+  std::vector<Point> pos_;             // positions, kept up to date
+  std::vector<quadric> q_;             // per node quadric
+  edge_heap<size_type> heap_;
+  std::vector<size_type> na_, nb_;     // neighbor scratch
+
+  /** Set @a out to the live neighbors of @a i, sorted. */
+  void neighbors(size_type i, std::vector<size_type>& out) const {
+    out.clear();
+    auto n = g_.node(i);
+    for (auto it = n.edge_begin(); it != n.edge_end(); ++it)
+      out.push_back((*it).node2().index());
+    std::sort(out.begin(), out.end());
+  }
+
+  /** Sum the triangle planes, and the boundary planes, into q_. Each
+   * triangle a < b < c is found once, from its edge (a, b). */
+  void init_quadrics() {
+    q_.assign(pos_.size(), quadric());
+    std::vector<size_type> common;
+    for (auto it = g_.edge_begin(); it != g_.edge_end(); ++it) {
+      size_type a = (*it).node1().index();
+      size_type b = (*it).node2().index();
+      if (b < a)
+        std::swap(a, b);
+      neighbors(a, na_);
+      neighbors(b, nb_);
+      common.clear();
+      std::set_intersection(na_.begin(), na_.end(), nb_.begin(), nb_.end(),
+                            std::back_inserter(common));
+      for (size_type c : common) {
+        if (c < b)
+          continue;
+        Point n = cross(pos_[b] - pos_[a], pos_[c] - pos_[a]);
+        double area2 = norm(n);
+        if (!(area2 > 0))
+          continue;
+        n = n / area2;
+        double d = -dot(n, pos_[a]);
+        for (size_type x : {a, b, c})
+          q_[x].add_plane(n, d, area2 / 2);
+      }
+      if (common.size() == 1 && opt_.boundary_weight > 0) {
+        size_type c = common.front();
+        Point edge = pos_[b] - pos_[a];
+        Point m = cross(edge, cross(edge, pos_[c] - pos_[a]));
+        double len = norm(m);
+        if (!(len > 0))
+          continue;
+        m = m / len;
+        double d = -dot(m, pos_[a]);
+        double w = opt_.boundary_weight * normSq(edge);
+        q_[a].add_plane(m, d, w);
+        q_[b].add_plane(m, d, w);
+      }
+    }
+  }
+
+  /** Return the cost of collapsing (@a a, @a b), and set @a v to where the
+   * merged node goes: the quadric's minimum, or failing that the best of
+   * the endpoints and their midpoint. */
+  double evaluate(size_type a, size_type b, Point& v) const {
+    quadric q = q_[a];
+    q += q_[b];
+    if (q.minimum(v))
+      return std::max(0.0, q.error(v));
+    double best = std::numeric_limits<double>::infinity();
+    for (const Point& p : {pos_[a], pos_[b], (pos_[a] + pos_[b]) / 2}) {
+      double err = q.error(p);
+      if (err < best) {
+        best = err;
+        v = p;
+      }
+    }
+    return std::max(0.0, best);
+  }
+
+  /** Put edge @a k in the heap at its current cost. */
+  void update(size_type k) {
+    auto e = g_.edge(k);
+    size_type a = e.node1().index();
+    size_type b = e.node2().index();
+    Point v;
+    double cost = evaluate(a, b, v);
+    heap_.set(k, cost, normSq(pos_[a] - pos_[b]));
+  }
+
+  /** Return whether merging @a a and @a b at @a v keeps the mesh a
+   * manifold without folds: the two share at most the two nodes of the
+   * triangles on the edge, and no other triangle around either of them
+   * turns its normal over. */
+  bool can_collapse(size_type a, size_type b, const Point& v) {
+    neighbors(a, na_);
+    neighbors(b, nb_);
+    std::size_t common = 0;
+    for (std::size_t i = 0, j = 0; i < na_.size() && j < nb_.size();) {
+      if (na_[i] < nb_[j]) {
+        ++i;
+      } else if (nb_[j] < na_[i]) {
+        ++j;
+      } else {
+        ++common;
+        ++i;
+        ++j;
+      }
+    }
+    if (common > 2)
+      return false;
+    return keeps_orientation(a, b, na_, v) && keeps_orientation(b, a, nb_, v);
+  }
+
+  /** Return whether moving @a x to @a v leaves every triangle (x, c, d)
+   * without @a other facing the same way. @a nx holds x's neighbors. */
+  bool keeps_orientation(size_type x, size_type other,
+                         const std::vector<size_type>& nx, const Point& v) {
+    for (std::size_t i = 0; i < nx.size(); ++i) {
+      size_type c = nx[i];
+      if (c == other)
+        continue;
+      for (std::size_t j = i + 1; j < nx.size(); ++j) {
+        size_type d = nx[j];
+        if (d == other || !g_.has_edge(g_.node(c), g_.node(d)))
+          continue;
+        Point before = cross(pos_[c] - pos_[x], pos_[d] - pos_[x]);
+        Point after = cross(pos_[c] - v, pos_[d] - v);
+        if (!(dot(before, after) > 0))
+          return false;
+      }
+    }
+    return true;
+  }
+
+  /** Merge @a b into @a a at @a v, through edge @a k. Return the number of
+   * edge costs recomputed. */
+  std::uint64_t collapse(size_type k, size_type a, size_type b,
+                         const Point& v) {
+    auto na = g_.node(a);
+    auto nb = g_.node(b);
+    // Incident edges of b, gathered before the rows change under them
+    struct incidence {
+      size_type edge;
+      size_type node;
+    };
+    std::vector<incidence> around;
+    for (auto it = nb.edge_begin(); it != nb.edge_end(); ++it)
+      around.push_back({(*it).index(), (*it).node2().index()});
+
+    heap_.erase(k);
+    for (const incidence& x : around) {
+      if (x.node == a)
+        continue;
+      heap_.erase(x.edge);
+      auto c = g_.node(x.node);
+      if (!g_.has_edge(na, c)) {
+        auto value = g_.edge(x.edge).value();
+        g_.add_edge(na, c, value);
+      }
+    }
+    g_.lazy_remove_node(nb);
+
+    pos_[a] = v;
+    na.position() = typename G::point_type(v);
+    q_[a] += q_[b];
+
+    std::uint64_t updated = 0;
+    for (auto it = na.edge_begin(); it != na.edge_end(); ++it) {
+      update((*it).index());
+      ++updated;
+    }
+    return updated;
+  }
+};
+
+} // end namespace decimation_detail
+
+
+/** Simplify the triangle mesh @a g by quadric error edge collapses.
+ * @param[in,out] g  Graph whose triangles are its 3-cliques
+ * @return Counts, the largest cost collapsed and timing
+ *
+ * @post Live nodes <= max(opt.target_nodes, the nodes no collapse could
+ *       remove), unless a collapse would have cost more than opt.max_error
+ *
+ * A collapse is refused if the two nodes share more than the two nodes of
+ * the triangles on the edge, which would glue the surface into a
+ * non-manifold, or if it would turn a triangle around either node over.
+ * A refused edge waits, at infinite cost, until a collapse next to it
+ * recomputes it. The merged node keeps the value of the endpoint it
+ * replaces, node1() of the edge; edges rewired to it keep their values.
+ * Automatic compaction is held off during the collapses and the graph is
+ * compacted once afterwards, unless opt.compact is false, which leaves the
+ * removed nodes and edges as tombstones.
+ *
+ * @tparam G  Graph type with lazy_remove_node(), compact(),
+ *            set_compaction_threshold(), has_edge(), add_edge(), node and
+ *            edge iteration, Edge::value() and a mutable Node::position(),
+ *            such as hw1/Graph-24726.hpp.
+ *
+ * Complexity: O(E d^2 log d) to set up, for the E edges and degrees d, and
+ * O(d^2 log d + d log E) per collapse.
+ */
+template <typename G>
+decimation_report decimate(G& g,
+                           const decimation_options& opt = decimation_options()) {
+  CME212_TRACE_SCOPE("decimate");
+  auto start = std::chrono::steady_clock::now();
+  double threshold = g.compaction_threshold();
+  g.set_compaction_threshold(1);
+  decimation_report report = decimation_detail::collapser<G>(g, opt).run();
+  g.set_compaction_threshold(threshold);
+  report.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return report;
+}
+
+#endif // CME212_DECIMATION_HPP
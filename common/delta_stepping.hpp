@@ -0,0 +1,324 @@
+#ifndef CME212_DELTA_STEPPING_HPP
+#define CME212_DELTA_STEPPING_HPP
+
+/** @file delta_stepping.hpp
+ * @brief Multithreaded single-source shortest paths by delta-stepping.
+ *
+ * Delta-stepping (Meyer and Sanders, "Delta-stepping: a parallelizable
+ * shortest path algorithm", J. Algorithms 2003) keeps tentative distances
+ * in buckets of width delta instead of a priority queue. All nodes of the
+ * lowest non-empty bucket are settled together: their light edges
+ * (weight <= delta) are relaxed in parallel, repeatedly, until the bucket
+ * stays empty, and then their heavy edges are relaxed once. Every relaxation
+ * phase is spread over the threads, with distances lowered by an atomic
+ * compare-and-swap.
+ *
+ * Edge weights come from a weight functor called on each incident Edge:
+ * euclidean_weight (the default) uses the distance between the endpoint
+ * positions, edge_value_weight uses Edge::value() and stored_weight uses
+ * Edge::weight().
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/trace.hpp"
+#include "CME212/Point.hpp"
+
+
+/** Tuning knobs for DeltaStepping. */
+struct sssp_options {
+  /** Worker threads. 0 means std::thread::hardware_concurrency(). */
+  unsigned threads = 0;
+  /** Bucket width. 0 picks the mean edge weight. */
+  double delta = 0;
+};
+
+/** What one search did and how fast. */
+struct sssp_report {
+  std::uint64_t reached = 0;      // nodes with a finite distance
+  std::uint64_t buckets = 0;      // non-empty buckets settled
+  std::uint64_t relaxations = 0;  // edges relaxed, light and heavy
+  double seconds = 0;             // wall time of run()
+};
+
+/** Edge weight = Euclidean distance between the endpoint positions. */
+struct euclidean_weight {
+  template <typename Edge>
+  double operator()(const Edge& e) const {
+    return norm(e.node1().position() - e.node2().position());
+  }
+};
+
+/** Edge weight = the edge's value, for graphs that store one. */
+struct edge_value_weight {
+  template <typename Edge>
+  double operator()(const Edge& e) const {
+    return double(e.value());
+  }
+};
+
+/** Edge weight = the edge's stored weight, for graphs with weight arrays
+ * (Graph::enable_weights()). */
+struct stored_weight {
+  template <typename Edge>
+  double operator()(const Edge& e) const {
+    return double(e.weight());
+  }
+};
+
+
+/** @class DeltaStepping
+ * @brief Reusable parallel SSSP engine over a weighted snapshot of a graph.
+ *
+ * The constructor evaluates the weight of every incident edge once and
+ * stores it beside the neighbor in a CSR array, light edges first in every
+ * row, so a search never calls back into the graph. Changes to the graph
+ * after construction are not seen.
+ *
+ * Reading the graph from several threads at once must be safe, which holds
+ * for the Graph variants as long as operation counting
+ * (CME212_GRAPH_STATS) is off.
+ *
+ * @tparam G  Graph type with size(), node(i).edge_begin()/edge_end() and
+ *            size_type.
+ */
+template <typename G>
+class DeltaStepping {
+ public:
+  /** Type of node indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Snapshot the adjacency of @a g, weighting each edge by @a weight.
+   * @pre @a weight returns a non-negative finite value for every edge
+   *
+   * Complexity: O(g.size() + g.num_edges()) weight evaluations and work,
+   * spread over the threads.
+   */
+  template <typename Weight = euclidean_weight>
+  explicit DeltaStepping(const G& g, Weight weight = Weight(),
+                         const sssp_options& opt = sssp_options())
+      : threads_(csr_snapshot::thread_count(opt.threads)),
+        n_(std::size_t(g.size())),
+        offsets_(csr_snapshot::row_offsets(g, threads_)) {
+    arcs_.resize(offsets_[n_]);
+    csr_snapshot::fill_rows(g, offsets_, threads_,
+        [&](std::size_t k, const auto& e) {
+          arcs_[k] = arc{e.node2().index(), weight(e)};
+          assert(arcs_[k].weight >= 0);
+        });
+
+    delta_ = opt.delta;
+    if (!(delta_ > 0)) {
+      double sum = 0;
+      for (const arc& a : arcs_)
+        sum += a.weight;
+      delta_ = (sum > 0) ? sum / double(arcs_.size()) : 1;
+    }
+
+    // Light edges first in every row
+    light_end_.resize(n_);
+    csr_snapshot::parallel_ranges(threads_, n_, 1024,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i) {
+            auto mid = std::partition(
+                arcs_.begin() + offsets_[i], arcs_.begin() + offsets_[i + 1],
+                [this](const arc& a) { return a.weight <= delta_; });
+            light_end_[i] = std::size_t(mid - arcs_.begin());
+          }
+        });
+  }
+
+  /** Return the number of nodes in the snapshot. */
+  size_type size() const {
+    return size_type(n_);
+  }
+
+  /** Return the bucket width in use. */
+  double delta() const {
+    return delta_;
+  }
+
+  /** Fill @a dist with the shortest path distance of every node from
+   * @a root.
+   * @param[out] dist  Resized to size(); dist[i] is the length of a
+   *                   shortest path from @a root to node i, or infinity if
+   *                   there is none
+   * @return Counts and timing of the search
+   *
+   * @pre @a root < size()
+   *
+   * Complexity: O(size() + number of edges * (1 + L / delta)) work for a
+   * largest shortest path length L, spread over the threads.
+   */
+  sssp_report run(size_type root, std::vector<double>& dist) const {
+    assert(std::size_t(root) < n_);
+    CME212_TRACE_SCOPE("shortest_paths");
+    auto start = std::chrono::steady_clock::now();
+    sssp_report report;
+    const double inf = std::numeric_limits<double>::infinity();
+
+    std::vector<std::atomic<double>> best(n_);
+    csr_snapshot::parallel_ranges(threads_, n_, 1024,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i)
+            best[i].store(inf, std::memory_order_relaxed);
+        });
+    best[root].store(0, std::memory_order_relaxed);
+
+    std::vector<std::vector<size_type>> buckets(1, std::vector<size_type>(1, root));
+    std::vector<std::uint8_t> listed(n_, 0);
+    std::vector<size_type> frontier, settled;
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+      settled.clear();
+      while (!buckets[i].empty()) {
+        // Entries whose distance has since dropped into this bucket again
+        // are listed once; entries that left the bucket are stale
+        std::vector<size_type> raw;
+        raw.swap(buckets[i]);
+        frontier.clear();
+        for (size_type v : raw) {
+          if (!listed[v] && bucket_of(best[v].load(std::memory_order_relaxed)) == i) {
+            listed[v] = 1;
+            frontier.push_back(v);
+          }
+        }
+        for (size_type v : frontier)
+          listed[v] = 0;
+        report.relaxations += relax(frontier, true, best, buckets);
+        settled.insert(settled.end(), frontier.begin(), frontier.end());
+      }
+      if (settled.empty())
+        continue;
+
+      // Heavy edges of every node settled in this bucket, once each
+      std::size_t unique = 0;
+      for (size_type v : settled) {
+        if (!listed[v]) {
+          listed[v] = 1;
+          settled[unique++] = v;
+        }
+      }
+      settled.resize(unique);
+      for (size_type v : settled)
+        listed[v] = 0;
+      report.relaxations += relax(settled, false, best, buckets);
+      ++report.buckets;
+    }
+
+    dist.resize(n_);
+    std::vector<std::uint64_t> reached(threads_, 0);
+    csr_snapshot::parallel_ranges(threads_, n_, 1024,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i) {
+            dist[i] = best[i].load(std::memory_order_relaxed);
+            reached[t] += (dist[i] != inf);
+          }
+        });
+    for (std::uint64_t r : reached)
+      report.reached += r;
+
+    report.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return report;
+  }
+
+ private:
+  // One incidence: the neighbor across the edge and the edge's weight
+  struct arc {
+    size_type node;
+    double weight;
+  };
+
+  unsigned threads_;
+  std::size_t n_;
+  std::vector<std::size_t> offsets_;    // row i is arcs_[offsets_[i]..)
+  std::vector<arc> arcs_;
+  std::vector<std::size_t> light_end_;  // end of the light arcs of row i
+  double delta_;
+
+  std::size_t bucket_of(double d) const {
+    return std::size_t(d / delta_);
+  }
+
+  /** Lower @a a to @a d if that is smaller.
+   * @return True if this call lowered it */
+  static bool atomic_min(std::atomic<double>& a, double d) {
+    double cur = a.load(std::memory_order_relaxed);
+    while (d < cur) {
+      if (a.compare_exchange_weak(cur, d, std::memory_order_relaxed))
+        return true;
+    }
+    return false;
+  }
+
+  /** Relax the light (or heavy) arcs of every node in @a nodes in
+   * parallel, then file every node whose distance dropped in its bucket.
+   * @return The number of arcs relaxed */
+  std::uint64_t relax(const std::vector<size_type>& nodes, bool light,
+                      std::vector<std::atomic<double>>& best,
+                      std::vector<std::vector<size_type>>& buckets) const {
+    std::vector<std::vector<size_type>> lowered(threads_);
+    std::vector<std::uint64_t> count(threads_, 0);
+    csr_snapshot::parallel_ranges(threads_, nodes.size(), 64,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for (std::size_t k = b; k < e; ++k) {
+            size_type u = nodes[k];
+            double du = best[u].load(std::memory_order_relaxed);
+            std::size_t first = light ? offsets_[u] : light_end_[u];
+            std::size_t last = light ? light_end_[u] : offsets_[u + 1];
+            for (std::size_t j = first; j < last; ++j) {
+              if (atomic_min(best[arcs_[j].node], du + arcs_[j].weight))
+                lowered[t].push_back(arcs_[j].node);
+            }
+            count[t] += last - first;
+          }
+        });
+
+    std::uint64_t total = 0;
+    for (unsigned t = 0; t < threads_; ++t) {
+      for (size_type v : lowered[t]) {
+        std::size_t b = bucket_of(best[v].load(std::memory_order_relaxed));
+        if (b >= buckets.size())
+          buckets.resize(b + 1);
+        buckets[b].push_back(v);
+      }
+      total += count[t];
+    }
+    return total;
+  }
+};
+
+/** Store the shortest path distance of every node of @a g from @a root in
+ * the node's value.
+ * @param[in] weight  Edge weight functor, as for DeltaStepping
+ * @return Counts and timing of the search
+ *
+ * @pre The node value type can be constructed from a double
+ * @post g.node(i).value() is the distance of node i, or infinity converted
+ *       to the value type for nodes in other components
+ *
+ * Builds a DeltaStepping engine for the one search; keep an engine around
+ * to run several.
+ */
+template <typename G, typename Weight = euclidean_weight>
+sssp_report shortest_paths(G& g, typename G::size_type root,
+                           Weight weight = Weight(),
+                           const sssp_options& opt = sssp_options()) {
+  std::vector<double> dist;
+  sssp_report report = DeltaStepping<G>(g, weight, opt).run(root, dist);
+  for (std::size_t i = 0; i < dist.size(); ++i)
+    g.node(typename G::size_type(i)).value() =
+        typename G::node_value_type(dist[i]);
+  return report;
+}
+
+#endif // CME212_DELTA_STEPPING_HPP
@@ -0,0 +1,359 @@
+#ifndef CME212_DETERMINISTIC_HPP
+#define CME212_DETERMINISTIC_HPP
+
+/** @file deterministic.hpp
+ * @brief Parallel reductions and scatter-adds whose floating point results
+ *        are the same bits on any number of threads.
+ *
+ * Floating point addition is not associative, so a parallel sum is only
+ * reproducible if the order of its additions does not depend on how the
+ * work was split. The engines that write each output from one thread
+ * (SpringKernel's node pass, LaplacianOperator, SymplecticEuler, the pull
+ * rounds of VertexEngine) already add in a fixed order. What varies run to
+ * run are
+ *
+ *   sums split by thread     csr_snapshot::parallel_ranges() cuts [0, n)
+ *                            into one range per thread, so the partial sums
+ *                            and their grouping change with the count
+ *   scatter-adds             a ReductionBuffer under parallel_for_edges()
+ *                            adds each edge into the array of whichever
+ *                            thread ran it, and work stealing makes that a
+ *                            matter of timing
+ *
+ * This header replaces both with schedules fixed by the data alone:
+ *
+ *   fixed partition   [0, n) is cut into blocks of deterministic_options::
+ *                     block elements, whatever the thread count; threads
+ *                     take whole blocks
+ *   ordered tree      ordered_reduce() keeps one partial per block and adds
+ *                     the partials pairwise, (p0 + p1) + (p2 + p3), ...,
+ *                     in block order
+ *   colored scatter   ColoredScatter splits the edges into classes of
+ *                     which no two share a node, with a coloring that is
+ *                     itself independent of the thread count, and visits
+ *                     the classes one after another; every node then
+ *                     receives its contributions in class order, from one
+ *                     thread at a time, with plain adds
+ *
+ *   deterministic_options det;
+ *   double energy = ordered_reduce<double>(g.size(),
+ *       [&](std::size_t b, std::size_t e) {
+ *         double s = 0;
+ *         for (std::size_t i = b; i < e; ++i)
+ *           s += kinetic(i);
+ *         return s;
+ *       }, det);
+ *   ColoredScatter<GraphType> scatter(g, det);     // once per topology
+ *   scatter.for_each_edge([&](auto k, auto a, auto b) {
+ *     Point f = spring(g.edge(k));
+ *     force[a] += f;
+ *     force[b] -= f;
+ *   });
+ *
+ * The results equal the sequential ones of the same schedule, not those of
+ * a plain loop in index order, and hold from one thread count to another
+ * within one build; a different compiler or -ffast-math may still change
+ * them.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/trace.hpp"
+
+
+/** Schedule of the deterministic loops. */
+struct deterministic_options {
+  /** Worker threads. 0 means the size of ThreadPool::shared(). Changes
+   *  the speed only, never the result. */
+  unsigned threads = 0;
+  /** Elements per block of the fixed partition. Changes the result, so
+   *  runs meant to agree must use the same value. */
+  std::size_t block = 4096;
+};
+
+
+/** Call fn(j, begin, end) for every block j of the fixed partition of
+ * [0, @a n) into blocks of opt.block, [j * block, min(n, (j + 1) * block)),
+ * with whole blocks spread over opt.threads threads.
+ * Complexity: O(n) calls' work, spread over the threads. */
+template <typename Fn>
+void fixed_blocks(std::size_t n, Fn fn,
+                  const deterministic_options& opt = deterministic_options()) {
+  assert(opt.block > 0);
+  std::size_t blocks = (n + opt.block - 1) / opt.block;
+  csr_snapshot::parallel_ranges(csr_snapshot::thread_count(opt.threads),
+      blocks, 1, [&](unsigned, std::size_t b, std::size_t e) {
+        for (std::size_t j = b; j < e; ++j)
+          fn(j, j * opt.block, std::min(n, (j + 1) * opt.block));
+      });
+}
+
+/** Return the sum of @a partial(begin, end) over the blocks of
+ * fixed_blocks(), added pairwise in block order, or T() if @a n is 0.
+ *
+ * @tparam T  Value type with + and value initialization as zero, e.g.
+ *            double or Point
+ * @param[in] partial  Returns the sum over its range; it runs on several
+ *                     threads, one block at a time
+ *
+ * The same @a n, @a partial and opt.block give the same bits on any number
+ * of threads. Pairwise addition also keeps the rounding error of the sum
+ * of the partials at O(log(blocks)) instead of O(blocks).
+ *
+ * Complexity: O(n) work in @a partial, spread over the threads, and
+ * O(n / opt.block) additions.
+ */
+template <typename T, typename Fn>
+T ordered_reduce(std::size_t n, Fn partial,
+                 const deterministic_options& opt = deterministic_options()) {
+  CME212_TRACE_SCOPE_N("ordered_reduce", n);
+  std::size_t blocks = (n + opt.block - 1) / opt.block;
+  if (blocks == 0)
+    return T();
+  std::vector<T> sums(blocks);
+  fixed_blocks(n, [&](std::size_t j, std::size_t b, std::size_t e) {
+    sums[j] = partial(b, e);
+  }, opt);
+  // Add neighbors in place, doubling the stride each level
+  for (std::size_t stride = 1; stride < blocks; stride *= 2) {
+    for (std::size_t j = 0; j + stride < blocks; j += 2 * stride)
+      sums[j] = sums[j] + sums[j + stride];
+  }
+  return sums[0];
+}
+
+/** Return the sum of @a x[0, @a n) as ordered_reduce() adds it. */
+template <typename T>
+T ordered_sum(const T* x, std::size_t n,
+              const deterministic_options& opt = deterministic_options()) {
+  return ordered_reduce<T>(n, [x](std::size_t b, std::size_t e) {
+    T s = T();
+    for (std::size_t i = b; i < e; ++i)
+      s = s + x[i];
+    return s;
+  }, opt);
+}
+
+
+/** @class ColoredScatter
+ * @brief The edges of a graph in classes of which no two share a node,
+ *        for scatter loops that give the same bits on any thread count.
+ *
+ * The constructor colors the edges in rounds, as Jones and Plassmann
+ * ("A Parallel Graph Coloring Heuristic", SIAM J. Sci. Comput. 1993) do
+ * nodes. Every edge has a priority, a fixed hash of its index. In each
+ * round, every uncolored edge whose uncolored neighbors all have lower
+ * priority takes the smallest color that no colored neighbor has. Such
+ * edges are never adjacent, and a round reads only colors fixed in
+ * earlier rounds, so the coloring depends on the graph alone, unlike
+ * Graph::edge_coloring(), whose threads read each other's colors as they
+ * go. It uses at most 2 * max degree - 1 colors.
+ *
+ * for_each_edge() then visits the classes in order and the edges of one
+ * class in parallel. Classes of fewer than deterministic_options::block
+ * edges run on one thread, as a round trip through the pool would cost
+ * more than it saves.
+ *
+ * Changes to the edges after construction are not seen.
+ *
+ * @tparam G  Graph type with size(), num_edges(), edge(k).node1()/node2()
+ *            and size_type.
+ */
+template <typename G>
+class ColoredScatter {
+ public:
+  /** Type of node and edge indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Color the edges of @a g.
+   * Complexity: O(rounds * sum of the degrees of the endpoints of the
+   * edges still uncolored), spread over the threads; a few rounds on
+   * meshes. */
+  explicit ColoredScatter(const G& g,
+                          const deterministic_options& opt =
+                              deterministic_options())
+      : opt_(opt), threads_(csr_snapshot::thread_count(opt.threads)),
+        n_(std::size_t(g.size())), m_(std::size_t(g.num_edges())),
+        ends_(2 * m_) {
+    CME212_TRACE_SCOPE_N("colored_scatter", m_);
+    csr_snapshot::parallel_ranges(threads_, m_, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t k = b; k < e; ++k) {
+            auto edge = g.edge(size_type(k));
+            ends_[2 * k] = size_type(edge.node1().index());
+            ends_[2 * k + 1] = size_type(edge.node2().index());
+          }
+        });
+    color();
+  }
+
+  /** Return the number of edges. */
+  std::size_t num_edges() const {
+    return m_;
+  }
+  /** Return the number of classes. */
+  std::size_t colors() const {
+    return class_offsets_.size() - 1;
+  }
+  /** Return the edges of class @a c, [first, last), in increasing index
+   * order. */
+  std::pair<const size_type*, const size_type*> edges(std::size_t c) const {
+    return {order_.data() + class_offsets_[c],
+            order_.data() + class_offsets_[c + 1]};
+  }
+
+  /** Call fn(k, a, b) for every edge k with endpoints a = node1() and
+   * b = node2(), class after class.
+   * @pre No two calls of @a fn for edges without a common node write to
+   *      the same memory
+   *
+   * Calls for edges with a common node never overlap, and a node's calls
+   * come in the same order on any thread count, so @a fn may add into per
+   * node arrays at a and b with plain adds and the sums are reproducible.
+   *
+   * Complexity: O(num_edges()) calls and colors() joins of the threads.
+   */
+  template <typename Fn>
+  void for_each_edge(Fn fn) const {
+    CME212_TRACE_SCOPE_N("scatter", m_);
+    for (std::size_t c = 0; c + 1 < class_offsets_.size(); ++c) {
+      std::size_t first = class_offsets_[c];
+      std::size_t size = class_offsets_[c + 1] - first;
+      unsigned threads = size < opt_.block ? 1 : threads_;
+      csr_snapshot::parallel_ranges(threads, size, 1024,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t x = first + b; x < first + e; ++x) {
+              size_type k = order_[x];
+              fn(k, ends_[2 * std::size_t(k)], ends_[2 * std::size_t(k) + 1]);
+            }
+          });
+    }
+  }
+
+ private:
+  static constexpr size_type npos = size_type(-1);
+
+  deterministic_options opt_;
+  unsigned threads_;
+  std::size_t n_, m_;
+  std::vector<size_type> ends_;              // node1, node2 of each edge
+  std::vector<size_type> order_;             // edges by class, then index
+  std::vector<std::size_t> class_offsets_;   // class c is order_[c..c + 1)
+
+  /** Return the priority of edge @a k in the coloring, the splitmix64
+   * finalizer of its index: by index alone, a path of edges in index order
+   * would be colored one edge per round. */
+  static std::uint64_t mix(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  /** Fill order_ and class_offsets_ as the class comment describes. */
+  void color() {
+    // Incident edges of every node, by counting sort
+    std::vector<std::size_t> offsets(n_ + 1, 0);
+    for (std::size_t x = 0; x < 2 * m_; ++x)
+      ++offsets[std::size_t(ends_[x]) + 1];
+    for (std::size_t i = 0; i < n_; ++i)
+      offsets[i + 1] += offsets[i];
+    std::vector<size_type> incident(2 * m_);
+    std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t x = 0; x < 2 * m_; ++x)
+      incident[fill[ends_[x]]++] = size_type(x / 2);
+
+    // Call visit(f) for the edges f next to k until it returns false;
+    // return false if it did
+    auto for_each_neighbor = [&](size_type k, auto visit) {
+      for (std::size_t side = 0; side < 2; ++side) {
+        std::size_t u = ends_[2 * std::size_t(k) + side];
+        for (std::size_t y = offsets[u]; y < offsets[u + 1]; ++y) {
+          if (incident[y] != k && !visit(incident[y]))
+            return false;
+        }
+      }
+      return true;
+    };
+    std::vector<std::uint64_t> priority(m_);
+    csr_snapshot::parallel_ranges(threads_, m_, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t k = b; k < e; ++k)
+            priority[k] = mix(k);
+        });
+    auto before = [&](size_type f, size_type k) {
+      return priority[f] > priority[k] ||
+             (priority[f] == priority[k] && f < k);
+    };
+
+    // color[k] is final, picked[k] the color taken this round, if any
+    std::vector<size_type> color(m_, npos), picked(m_, npos);
+    std::vector<size_type> pending(m_);
+    for (std::size_t k = 0; k < m_; ++k)
+      pending[k] = size_type(k);
+    std::vector<std::vector<char>> taken(threads_);
+
+    while (!pending.empty()) {
+      csr_snapshot::parallel_ranges(threads_, pending.size(), 1024,
+          [&](unsigned t, std::size_t b, std::size_t e) {
+            std::vector<char>& used = taken[t];
+            for (std::size_t x = b; x < e; ++x) {
+              size_type k = pending[x];
+              bool first = for_each_neighbor(k, [&](size_type f) {
+                return color[f] != npos || !before(f, k);
+              });
+              if (!first)
+                continue;
+              std::size_t a = ends_[2 * std::size_t(k)];
+              std::size_t z = ends_[2 * std::size_t(k) + 1];
+              // An edge has fewer neighbors than this, so a color below
+              // it is always free
+              std::size_t bound = (offsets[a + 1] - offsets[a]) +
+                                  (offsets[z + 1] - offsets[z]);
+              used.assign(bound, 0);
+              for_each_neighbor(k, [&](size_type f) {
+                if (color[f] < bound)
+                  used[color[f]] = 1;
+                return true;
+              });
+              size_type c = 0;
+              while (used[c])
+                ++c;
+              picked[k] = c;
+            }
+          });
+      // Fix the colors only now, so the round above read the old ones
+      std::size_t left = 0;
+      for (std::size_t x = 0; x < pending.size(); ++x) {
+        size_type k = pending[x];
+        if (picked[k] == npos)
+          pending[left++] = k;
+        else
+          color[k] = picked[k];
+      }
+      pending.resize(left);
+    }
+
+    // Counting sort by color keeps each class in index order
+    std::size_t colors = 0;
+    for (std::size_t k = 0; k < m_; ++k)
+      colors = std::max(colors, std::size_t(color[k]) + 1);
+    class_offsets_.assign(colors + 1, 0);
+    for (std::size_t k = 0; k < m_; ++k)
+      ++class_offsets_[std::size_t(color[k]) + 1];
+    for (std::size_t c = 0; c < colors; ++c)
+      class_offsets_[c + 1] += class_offsets_[c];
+    order_.resize(m_);
+    fill.assign(class_offsets_.begin(), class_offsets_.end() - 1);
+    for (std::size_t k = 0; k < m_; ++k)
+      order_[fill[color[k]]++] = size_type(k);
+  }
+};
+
+#endif // CME212_DETERMINISTIC_HPP
@@ -0,0 +1,349 @@
+#ifndef CME212_DEVICE_MIRROR_HPP
+#define CME212_DEVICE_MIRROR_HPP
+
+/** @file device_mirror.hpp
+ * @brief A copy of a graph's adjacency, positions and values in GPU memory.
+ *
+ * Large mass-spring runs are bound by memory bandwidth, which a GPU has
+ * several times more of. DeviceMirror uploads the adjacency once, in the
+ * CSR layout the CPU engines use (csr_snapshot.hpp), and the positions and
+ * node values whenever asked. Kernels then work on a DeviceGraphView, a
+ * plain struct of device pointers that is passed to them by value:
+ *
+ *   DeviceMirror<G> mirror(g);                    // offsets, rows, data
+ *   for (int s = 0; s < steps; ++s)
+ *     my_step<<<blocks, threads>>>(mirror.view(), dt);
+ *   mirror.download_positions(g);                 // back to the proxies
+ *
+ * Between syncs the host graph is untouched and its proxies keep working,
+ * on the positions of the last sync. launch_spring_forces() is one such
+ * kernel, the per-node spring sum of SpringKernel.
+ *
+ * This header needs the CUDA runtime, or HIP when compiled with hipcc:
+ * include it only in programs built with nvcc or hipcc.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__HIPCC__)
+#include <hip/hip_runtime.h>
+#define CME212_DEVICE_API(name) hip##name
+#else
+#include <cuda_runtime.h>
+#define CME212_DEVICE_API(name) cuda##name
+#endif
+
+#include "common/csr_snapshot.hpp"
+#include "common/graph_traits.hpp"
+#include "CME212/Point.hpp"
+
+
+namespace device_mirror_detail {
+
+template <typename G, typename = void>
+struct has_values_data : std::false_type {};
+template <typename G>
+struct has_values_data<G, std::void_t<
+    decltype(std::declval<const G&>().values_data())>> : std::true_type {};
+
+template <typename G, typename = void>
+struct has_mark_positions_changed : std::false_type {};
+template <typename G>
+struct has_mark_positions_changed<G, std::void_t<
+    decltype(std::declval<G&>().mark_positions_changed(0, 0))>>
+    : std::true_type {};
+
+template <typename G, typename = void>
+struct has_invalidate_edge_cache : std::false_type {};
+template <typename G>
+struct has_invalidate_edge_cache<G, std::void_t<
+    decltype(std::declval<G&>().invalidate_edge_cache())>> : std::true_type {};
+
+template <typename G, typename = void>
+struct node_value {
+  using type = void;
+};
+template <typename G>
+struct node_value<G, std::void_t<typename G::node_value_type>> {
+  using type = typename G::node_value_type;
+};
+
+/** Throw if a runtime call failed. */
+inline void check(CME212_DEVICE_API(Error_t) status, const char* what) {
+  if (status != CME212_DEVICE_API(Success))
+    throw std::runtime_error(std::string("device_mirror: ") + what + ": " +
+                             CME212_DEVICE_API(GetErrorString)(status));
+}
+
+/** Allocate room for @a n elements of T on the device. */
+template <typename T>
+T* allocate(std::size_t n) {
+  void* p = nullptr;
+  if (n != 0)
+    check(CME212_DEVICE_API(Malloc)(&p, n * sizeof(T)), "allocation failed");
+  return static_cast<T*>(p);
+}
+
+template <typename T>
+void to_device(T* dst, const T* src, std::size_t n) {
+  if (n != 0)
+    check(CME212_DEVICE_API(Memcpy)(dst, src, n * sizeof(T),
+                                    CME212_DEVICE_API(MemcpyHostToDevice)),
+          "upload failed");
+}
+
+template <typename T>
+void to_host(T* dst, const T* src, std::size_t n) {
+  if (n != 0)
+    check(CME212_DEVICE_API(Memcpy)(dst, src, n * sizeof(T),
+                                    CME212_DEVICE_API(MemcpyDeviceToHost)),
+          "download failed");
+}
+
+} // end namespace device_mirror_detail
+
+
+/** @struct DeviceGraphView
+ * @brief Device pointers to a mirrored graph, to pass to kernels by value.
+ *
+ * Row i of the adjacency is neighbors[offsets[i] .. offsets[i + 1]), in
+ * the host graph's incident iterator order. Positions are 3 doubles per
+ * node (x, y, z), laid out like the host's Points. values is null unless
+ * the node values were mirrored.
+ *
+ * @tparam S  Node index type.
+ * @tparam V  Node value type, or void.
+ */
+template <typename S, typename V>
+struct DeviceGraphView {
+  S num_nodes;
+  std::size_t num_incidences;
+  const std::size_t* offsets;
+  const S* neighbors;
+  double* positions;
+  V* values;
+};
+
+
+/** @class DeviceMirror
+ * @brief Owner of the device copy of one graph.
+ *
+ * The adjacency is uploaded by the constructor and must not change on the
+ * host afterwards: freeze the graph first, or at least stop adding edges.
+ * Positions and values move only on explicit upload_*() and
+ * download_*() calls.
+ *
+ * @tparam G  Graph type with incident iterators. Graphs with
+ *            positions_data() and values_data() (hw1/Graph-24726.hpp) are
+ *            copied straight from those arrays; others through one proxy
+ *            per node. Values are mirrored only if node_value_type is
+ *            trivially copyable.
+ */
+template <typename G>
+class DeviceMirror {
+ public:
+  using size_type = typename G::size_type;
+  using value_type = typename device_mirror_detail::node_value<G>::type;
+  using view_type = DeviceGraphView<size_type, std::conditional_t<
+      std::is_trivially_copyable<value_type>::value, value_type, void>>;
+
+  static_assert(sizeof(Point) == 3 * sizeof(double) &&
+                    std::is_standard_layout<Point>::value,
+                "positions are mirrored as three packed doubles");
+
+  /** Upload the adjacency, positions and values of @a g.
+   * @throws std::runtime_error if device memory runs out
+   *
+   * Complexity: O(g.size() + g.num_edges()), plus the transfers.
+   */
+  explicit DeviceMirror(const G& g, unsigned threads = 0)
+      : n_(std::size_t(g.size())) {
+    unsigned t = csr_snapshot::thread_count(threads);
+    std::vector<std::size_t> offsets = csr_snapshot::row_offsets(g, t);
+    std::vector<size_type> neighbors(offsets.back());
+    csr_snapshot::fill_neighbors(g, offsets, t, neighbors.data());
+
+    view_.num_nodes = size_type(n_);
+    view_.num_incidences = neighbors.size();
+    try {
+      offsets_ = device_mirror_detail::allocate<std::size_t>(offsets.size());
+      neighbors_ = device_mirror_detail::allocate<size_type>(neighbors.size());
+      positions_ = device_mirror_detail::allocate<double>(3 * n_);
+      if constexpr (mirrors_values)
+        values_ = device_mirror_detail::allocate<value_type>(n_);
+      device_mirror_detail::to_device(offsets_, offsets.data(), offsets.size());
+      device_mirror_detail::to_device(neighbors_, neighbors.data(),
+                                      neighbors.size());
+    } catch (...) {
+      release();
+      throw;
+    }
+    view_.offsets = offsets_;
+    view_.neighbors = neighbors_;
+    view_.positions = positions_;
+    if constexpr (mirrors_values)
+      view_.values = values_;
+    upload_positions(g);
+    upload_values(g);
+  }
+
+  DeviceMirror(const DeviceMirror&) = delete;
+  DeviceMirror& operator=(const DeviceMirror&) = delete;
+
+  ~DeviceMirror() {
+    release();
+  }
+
+  /** Return the device pointers for a kernel launch. */
+  const view_type& view() const {
+    return view_;
+  }
+
+  /** Copy the host positions of @a g to the device. Complexity: O(size()). */
+  void upload_positions(const G& g) {
+    assert(std::size_t(g.size()) == n_);
+    if constexpr (graph_traits::has_soa_positions<G>::value) {
+      device_mirror_detail::to_device(
+          positions_, reinterpret_cast<const double*>(g.positions_data()),
+          3 * n_);
+    } else {
+      std::vector<Point> x(n_);
+      for (std::size_t i = 0; i < n_; ++i)
+        x[i] = g.node(size_type(i)).position();
+      device_mirror_detail::to_device(
+          positions_, reinterpret_cast<const double*>(x.data()), 3 * n_);
+    }
+  }
+
+  /** Copy the device positions back into @a g.
+   * @post g.node(i).position() is the device position of node i
+   *
+   * The graph's edge cache and change ranges, if it has them, are kept up
+   * to date.
+   * Complexity: O(size()).
+   */
+  void download_positions(G& g) const {
+    assert(std::size_t(g.size()) == n_);
+    if constexpr (graph_traits::has_soa_positions<G>::value) {
+      device_mirror_detail::to_host(
+          reinterpret_cast<double*>(g.positions_data()), positions_, 3 * n_);
+      if constexpr (device_mirror_detail::has_invalidate_edge_cache<G>::value)
+        g.invalidate_edge_cache();
+      if constexpr (device_mirror_detail::has_mark_positions_changed<G>::value)
+        g.mark_positions_changed(size_type(0), size_type(n_));
+    } else {
+      std::vector<Point> x(n_);
+      device_mirror_detail::to_host(reinterpret_cast<double*>(x.data()),
+                                    positions_, 3 * n_);
+      for (std::size_t i = 0; i < n_; ++i)
+        g.node(size_type(i)).position() = x[i];
+    }
+  }
+
+  /** Copy the host node values of @a g to the device. Does nothing if the
+   * values are not mirrored. Complexity: O(size()). */
+  void upload_values(const G& g) {
+    if constexpr (mirrors_values) {
+      if constexpr (device_mirror_detail::has_values_data<G>::value) {
+        device_mirror_detail::to_device(values_, g.values_data(), n_);
+      } else {
+        std::vector<value_type> v(n_);
+        for (std::size_t i = 0; i < n_; ++i)
+          v[i] = g.node(size_type(i)).value();
+        device_mirror_detail::to_device(values_, v.data(), n_);
+      }
+    }
+  }
+
+  /** Copy the device node values back into @a g. Does nothing if the
+   * values are not mirrored. Complexity: O(size()). */
+  void download_values(G& g) const {
+    if constexpr (mirrors_values) {
+      if constexpr (device_mirror_detail::has_values_data<G>::value) {
+        device_mirror_detail::to_host(g.values_data(), values_, n_);
+      } else {
+        std::vector<value_type> v(n_);
+        device_mirror_detail::to_host(v.data(), values_, n_);
+        for (std::size_t i = 0; i < n_; ++i)
+          g.node(size_type(i)).value() = v[i];
+      }
+    }
+  }
+
+ private:
+  static constexpr bool mirrors_values =
+      std::is_trivially_copyable<value_type>::value;
+
+  std::size_t n_;
+  std::size_t* offsets_ = nullptr;
+  size_type* neighbors_ = nullptr;
+  double* positions_ = nullptr;
+  value_type* values_ = nullptr;
+  view_type view_{};
+
+  void release() {
+    CME212_DEVICE_API(Free)(offsets_);
+    CME212_DEVICE_API(Free)(neighbors_);
+    CME212_DEVICE_API(Free)(positions_);
+    if constexpr (mirrors_values)
+      CME212_DEVICE_API(Free)(values_);
+  }
+};
+
+
+namespace device_mirror_detail {
+
+/** One thread per node: force[3i..3i+3) = the spring sum of node i. */
+template <typename S, typename V>
+__global__ void spring_forces_kernel(DeviceGraphView<S, V> g, double K,
+                                     double L, double* force) {
+  std::size_t i = std::size_t(blockIdx.x) * blockDim.x + threadIdx.x;
+  if (i >= std::size_t(g.num_nodes))
+    return;
+  const double* xi = g.positions + 3 * i;
+  double fx = 0, fy = 0, fz = 0;
+  for (std::size_t k = g.offsets[i]; k < g.offsets[i + 1]; ++k) {
+    const double* xj = g.positions + 3 * std::size_t(g.neighbors[k]);
+    double dx = xj[0] - xi[0], dy = xj[1] - xi[1], dz = xj[2] - xi[2];
+    double len = sqrt(dx * dx + dy * dy + dz * dz);
+    double s = (len > 0) ? K * (len - L) / len : 0;
+    fx += s * dx;
+    fy += s * dy;
+    fz += s * dz;
+  }
+  force[3 * i] = fx;
+  force[3 * i + 1] = fy;
+  force[3 * i + 2] = fz;
+}
+
+} // end namespace device_mirror_detail
+
+/** Write the spring force on every node of @a g into the device array
+ * @a force of 3 * g.num_nodes doubles, as SpringKernel::compute() defines
+ * it, without waiting for the kernel to finish.
+ * @throws std::runtime_error if the launch fails
+ *
+ * Each node sums its own row, so every spring is evaluated from both ends;
+ * on a GPU that is cheaper than a second pass over per-edge forces.
+ */
+template <typename S, typename V>
+void launch_spring_forces(const DeviceGraphView<S, V>& g, double K, double L,
+                          double* force,
+                          CME212_DEVICE_API(Stream_t) stream = 0) {
+  if (g.num_nodes == 0)
+    return;
+  const unsigned threads = 256;
+  unsigned blocks = unsigned((std::size_t(g.num_nodes) + threads - 1) / threads);
+  device_mirror_detail::spring_forces_kernel<<<blocks, threads, 0, stream>>>(
+      g, K, L, force);
+  device_mirror_detail::check(CME212_DEVICE_API(GetLastError)(),
+                              "kernel launch failed");
+}
+
+#endif // CME212_DEVICE_MIRROR_HPP
@@ -0,0 +1,605 @@
+#ifndef CME212_DIGRAPH_HPP
+#define CME212_DIGRAPH_HPP
+
+/** @file digraph.hpp
+ * @brief A directed graph with out-edge and in-edge rows for both push and
+ *        pull traversals.
+ *
+ * Every Graph variant is undirected: an edge sits in both endpoints' rows
+ * and either endpoint reaches the other. Dependency propagation needs the
+ * direction, and pull-style passes ("what does every node depend on?")
+ * need the reverse of it. A DiGraph keeps, for every node, a row of its
+ * out-edges and a row of its in-edges, and freeze() packs both into CSR
+ * arrays, so a pull pass never has to build a transpose first:
+ *
+ *   DiGraph<int> g;
+ *   auto a = g.add_node(Point(0, 0, 0));
+ *   auto b = g.add_node(Point(1, 0, 0));
+ *   g.add_edge(a, b);                        // a -> b
+ *   g.freeze();
+ *   for (auto n : g.nodes())
+ *     for (auto e : n.in_edges())            // every e.target() == n
+ *       ready[n.index()] &= done[e.source().index()];
+ *
+ * Node, Edge and the iterators follow Graph, with Node::edge_begin() on
+ * the out-edges, so generic algorithms (BfsEngine, connected components,
+ * ...) follow the edges forward. Edge::source() and Edge::target() give
+ * the direction; node1() is the node iterated around and node2() the one
+ * across the edge, out-edges and in-edges alike.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+#include "common/graph_range.hpp"
+#include "common/result_cache.hpp"
+#include "common/sparse_export.hpp"
+#include "CME212/Point.hpp"
+
+
+/** @class DiGraph
+ * @brief A directed graph of positioned nodes with values of type @a V
+ *        and edges with values of type @a E.
+ *
+ * There is at most one edge from a node to another, and none from a node
+ * to itself; an edge a -> b and an edge b -> a are distinct. Row entries
+ * are kept sorted by the index of the node across the edge, so has_edge()
+ * is a binary search.
+ *
+ * Before freeze(), each node has a row of out-edges and a row of in-edges
+ * of its own. freeze() packs all out-rows into one CSR array and all
+ * in-rows into another; while frozen, incident iteration walks those. Any
+ * added node or edge thaws the graph back to the per-node rows, which stay
+ * the source of truth.
+ *
+ * @tparam V  Node value type.
+ * @tparam E  Edge value type.
+ */
+template <typename V, typename E = double>
+class DiGraph {
+ private:
+  // One row entry: the node across the edge and the edge itself
+  struct arc {
+    std::uint32_t node;
+    std::uint32_t edge;
+  };
+
+ public:
+  using graph_type = DiGraph;
+  using size_type = std::uint32_t;
+  using node_value_type = V;
+  using edge_value_type = E;
+
+  class Node;
+  class Edge;
+  class NodeIterator;
+  class EdgeIterator;
+  class IncidentIterator;
+  using node_type = Node;
+  using edge_type = Edge;
+  using node_iterator = NodeIterator;
+  using edge_iterator = EdgeIterator;
+  using incident_iterator = IncidentIterator;
+  using node_range = GraphRange<NodeIterator>;
+  using edge_range = GraphRange<EdgeIterator>;
+  using incident_range = GraphRange<IncidentIterator>;
+  /** Type of out_csr() and in_csr(), see common/sparse_export.hpp. */
+  using csr_view_type = csr_view<size_type, size_type>;
+
+  /** Construct an empty graph. */
+  DiGraph() = default;
+
+  size_type size() const {
+    return size_type(positions_.size());
+  }
+  size_type num_nodes() const {
+    return size();
+  }
+  size_type num_edges() const {
+    return size_type(ends_.size());
+  }
+
+  /** Return a number that changes whenever a node or edge is added or the
+   * graph is cleared, as Graph::topology_version(). */
+  std::uint64_t topology_version() const {
+    return topology_version_;
+  }
+
+  /** Add a node at @a position with value @a value.
+   * @post result.index() == old num_nodes()
+   *
+   * Thaws a frozen graph. Complexity: O(1) amortized.
+   */
+  Node add_node(const Point& position,
+                const node_value_type& value = node_value_type()) {
+    positions_.push_back(position);
+    values_.push_back(value);
+    out_rows_.emplace_back();
+    in_rows_.emplace_back();
+    changed();
+    return Node(this, size() - 1);
+  }
+
+  /** Return the node with index @a i.
+   * @pre @a i < num_nodes()
+   */
+  Node node(size_type i) const {
+    assert(i < size());
+    return Node(this, i);
+  }
+
+  /** Return edge @a k, in the order the edges were added, oriented from
+   * its source to its target.
+   * @pre @a k < num_edges()
+   */
+  Edge edge(size_type k) const {
+    assert(k < num_edges());
+    return Edge(this, ends_[k].source, ends_[k].target, k);
+  }
+
+  bool has_node(const Node& n) const {
+    return n.g_ == this && n.i_ < size();
+  }
+
+  /** Return true if there is an edge from @a a to @a b.
+   * Complexity: O(log(a.out_degree())).
+   */
+  bool has_edge(const Node& a, const Node& b) const {
+    return find(out_rows_[a.i_], b.i_) != out_rows_[a.i_].end();
+  }
+
+  /** Add the edge from @a a to @a b with value @a value, or return the
+   * existing one, whose value is left as it is.
+   * @pre @a a and @a b are distinct nodes of this graph
+   * @post has_edge(@a a, @a b) and result.source() == @a a
+   *
+   * Thaws a frozen graph if the edge is new.
+   * Complexity: O(a.out_degree() + b.in_degree()).
+   */
+  Edge add_edge(const Node& a, const Node& b,
+                const edge_value_type& value = edge_value_type()) {
+    assert(has_node(a) && has_node(b) && a.i_ != b.i_);
+    std::vector<arc>& out = out_rows_[a.i_];
+    auto it = find(out, b.i_);
+    if (it != out.end())
+      return Edge(this, a.i_, b.i_, it->edge);
+
+    size_type k = num_edges();
+    ends_.push_back({a.i_, b.i_});
+    edge_values_.push_back(value);
+    insert(out, arc{b.i_, k});
+    insert(in_rows_[b.i_], arc{a.i_, k});
+    changed();
+    return Edge(this, a.i_, b.i_, k);
+  }
+
+  /** Remove every node and edge, keeping the storage of the arrays. */
+  void clear() {
+    positions_.clear();
+    values_.clear();
+    ends_.clear();
+    edge_values_.clear();
+    out_rows_.clear();
+    in_rows_.clear();
+    changed();
+  }
+
+  /** Pack the out-rows and the in-rows into two CSR arrays.
+   * @post is_frozen() and out_csr().valid() and in_csr().valid()
+   *
+   * Complexity: O(num_nodes() + num_edges()).
+   */
+  void freeze() {
+    if (frozen_)
+      return;
+    pack(out_rows_, out_offsets_, out_arcs_);
+    pack(in_rows_, in_offsets_, in_arcs_);
+    frozen_ = true;
+  }
+
+  /** Return true between freeze() and the next added node or edge. */
+  bool is_frozen() const {
+    return frozen_;
+  }
+
+  /** Return the out-edge CSR arrays of a frozen graph: row i lists the
+   * targets of the edges leaving node i, view.neighbor(k) over edge
+   * view.edge(k). Not valid() unless is_frozen(). Invalidated by every
+   * change to the graph. Complexity: O(1). */
+  csr_view_type out_csr() const {
+    return view(out_offsets_, out_arcs_);
+  }
+  /** Return the in-edge CSR arrays of a frozen graph: row i lists the
+   * sources of the edges entering node i. As out_csr() otherwise. */
+  csr_view_type in_csr() const {
+    return view(in_offsets_, in_arcs_);
+  }
+
+  /** Return the num_edges() edge values, indexed by Edge::index(). */
+  edge_value_type* edge_values_data() {
+    return edge_values_.data();
+  }
+  const edge_value_type* edge_values_data() const {
+    return edge_values_.data();
+  }
+
+  /** @class DiGraph::Node
+   * @brief A node of the graph, as the graph and an index. */
+  class Node {
+   public:
+    /** Construct an invalid node. */
+    Node() : g_(nullptr), i_(0) {
+    }
+
+    size_type index() const {
+      return i_;
+    }
+    Point& position() const {
+      return g_->positions_[i_];
+    }
+    node_value_type& value() const {
+      return g_->values_[i_];
+    }
+
+    size_type out_degree() const {
+      return size_type(g_->row(false, i_).size);
+    }
+    size_type in_degree() const {
+      return size_type(g_->row(true, i_).size);
+    }
+    /** Return out_degree(), the number of edges edge_begin() walks. */
+    size_type degree() const {
+      return out_degree();
+    }
+
+    /** Return an iterator to the first out-edge, in increasing order of
+     * target index. */
+    IncidentIterator edge_begin() const {
+      return out_edges().begin();
+    }
+    IncidentIterator edge_end() const {
+      return out_edges().end();
+    }
+    IncidentIterator in_edge_begin() const {
+      return in_edges().begin();
+    }
+    IncidentIterator in_edge_end() const {
+      return in_edges().end();
+    }
+
+    /** Return the edges leaving this node, with source() == node1() ==
+     * *this and in increasing order of target index. */
+    incident_range out_edges() const {
+      return g_->incident(false, i_);
+    }
+    /** Return the edges entering this node, with target() == node1() ==
+     * *this and in increasing order of source index. */
+    incident_range in_edges() const {
+      return g_->incident(true, i_);
+    }
+    /** Return out_edges(). */
+    incident_range incident_edges() const {
+      return out_edges();
+    }
+
+    bool operator==(const Node& x) const {
+      return g_ == x.g_ && i_ == x.i_;
+    }
+    bool operator!=(const Node& x) const {
+      return !(*this == x);
+    }
+    bool operator<(const Node& x) const {
+      return g_ != x.g_ ? std::less<const DiGraph*>()(g_, x.g_) : i_ < x.i_;
+    }
+
+   private:
+    friend class DiGraph;
+    DiGraph* g_;
+    size_type i_;
+
+    Node(const DiGraph* g, size_type i)
+        : g_(const_cast<DiGraph*>(g)), i_(i) {
+    }
+  };
+
+  /** @class DiGraph::Edge
+   * @brief A directed edge, seen from node1(). */
+  class Edge {
+   public:
+    /** Construct an invalid edge. */
+    Edge() : g_(nullptr), a_(0), b_(0), k_(0) {
+    }
+
+    /** Return the node this edge was reached from. */
+    Node node1() const {
+      return Node(g_, a_);
+    }
+    /** Return the node across the edge from node1(). */
+    Node node2() const {
+      return Node(g_, b_);
+    }
+    Node source() const {
+      return Node(g_, g_->ends_[k_].source);
+    }
+    Node target() const {
+      return Node(g_, g_->ends_[k_].target);
+    }
+    /** Return the index of the edge, in the order the edges were added. */
+    size_type index() const {
+      return k_;
+    }
+    edge_value_type& value() const {
+      return g_->edge_values_[k_];
+    }
+    double length() const {
+      return norm(node1().position() - node2().position());
+    }
+
+    /** Edges compare by their index, from whichever end they are seen. */
+    bool operator==(const Edge& x) const {
+      return g_ == x.g_ && k_ == x.k_;
+    }
+    bool operator!=(const Edge& x) const {
+      return !(*this == x);
+    }
+    bool operator<(const Edge& x) const {
+      return g_ != x.g_ ? std::less<const DiGraph*>()(g_, x.g_) : k_ < x.k_;
+    }
+
+   private:
+    friend class DiGraph;
+    DiGraph* g_;
+    size_type a_, b_, k_;
+
+    Edge(const DiGraph* g, size_type a, size_type b, size_type k)
+        : g_(const_cast<DiGraph*>(g)), a_(a), b_(b), k_(k) {
+    }
+  };
+
+  /** @class DiGraph::NodeIterator
+   * @brief Forward iterator over the nodes, in index order. */
+  class NodeIterator {
+   public:
+    using value_type = Node;
+    using pointer = Node*;
+    using reference = Node;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    NodeIterator() : g_(nullptr), i_(0) {
+    }
+
+    Node operator*() const {
+      return Node(g_, i_);
+    }
+    NodeIterator& operator++() {
+      ++i_;
+      return *this;
+    }
+    NodeIterator operator++(int) {
+      NodeIterator tmp = *this;
+      ++i_;
+      return tmp;
+    }
+    bool operator==(const NodeIterator& x) const {
+      return g_ == x.g_ && i_ == x.i_;
+    }
+    bool operator!=(const NodeIterator& x) const {
+      return !(*this == x);
+    }
+
+   private:
+    friend class DiGraph;
+    const DiGraph* g_;
+    size_type i_;
+
+    NodeIterator(const DiGraph* g, size_type i) : g_(g), i_(i) {
+    }
+  };
+
+  NodeIterator node_begin() const {
+    return NodeIterator(this, 0);
+  }
+  NodeIterator node_end() const {
+    return NodeIterator(this, size());
+  }
+  node_range nodes() const {
+    return node_range(node_begin(), node_end(), size());
+  }
+
+  /** @class DiGraph::EdgeIterator
+   * @brief Forward iterator over the edges, in index order, each oriented
+   *        from its source. */
+  class EdgeIterator {
+   public:
+    using value_type = Edge;
+    using pointer = Edge*;
+    using reference = Edge;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    EdgeIterator() : g_(nullptr), k_(0) {
+    }
+
+    Edge operator*() const {
+      return g_->edge(k_);
+    }
+    EdgeIterator& operator++() {
+      ++k_;
+      return *this;
+    }
+    EdgeIterator operator++(int) {
+      EdgeIterator tmp = *this;
+      ++k_;
+      return tmp;
+    }
+    bool operator==(const EdgeIterator& x) const {
+      return g_ == x.g_ && k_ == x.k_;
+    }
+    bool operator!=(const EdgeIterator& x) const {
+      return !(*this == x);
+    }
+
+   private:
+    friend class DiGraph;
+    const DiGraph* g_;
+    size_type k_;
+
+    EdgeIterator(const DiGraph* g, size_type k) : g_(g), k_(k) {
+    }
+  };
+
+  EdgeIterator edge_begin() const {
+    return EdgeIterator(this, 0);
+  }
+  EdgeIterator edge_end() const {
+    return EdgeIterator(this, num_edges());
+  }
+  edge_range edges() const {
+    return edge_range(edge_begin(), edge_end(), num_edges());
+  }
+
+  /** @class DiGraph::IncidentIterator
+   * @brief Forward iterator over one row of out-edges or in-edges. */
+  class IncidentIterator {
+   public:
+    using value_type = Edge;
+    using pointer = Edge*;
+    using reference = Edge;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    IncidentIterator() : g_(nullptr), i_(0), p_(nullptr) {
+    }
+
+    /** Return the edge, with node1() the node iterated around. */
+    Edge operator*() const {
+      return Edge(g_, i_, p_->node, p_->edge);
+    }
+    IncidentIterator& operator++() {
+      ++p_;
+      return *this;
+    }
+    IncidentIterator operator++(int) {
+      IncidentIterator tmp = *this;
+      ++p_;
+      return tmp;
+    }
+    bool operator==(const IncidentIterator& x) const {
+      return p_ == x.p_;
+    }
+    bool operator!=(const IncidentIterator& x) const {
+      return !(*this == x);
+    }
+
+   private:
+    friend class DiGraph;
+    const DiGraph* g_;
+    size_type i_;
+    const arc* p_;
+
+    IncidentIterator(const DiGraph* g, size_type i, const arc* p)
+        : g_(g), i_(i), p_(p) {
+    }
+  };
+
+ private:
+  struct edge_ends {
+    size_type source;
+    size_type target;
+  };
+
+  // A row as a pointer and length, from the CSR arrays or a per-node row
+  struct row_span {
+    const arc* first;
+    std::size_t size;
+  };
+
+  std::vector<Point> positions_;
+  std::vector<node_value_type> values_;
+  std::vector<edge_ends> ends_;
+  std::vector<edge_value_type> edge_values_;
+
+  // Per-node rows, sorted by the index of the node across the edge
+  std::vector<std::vector<arc>> out_rows_;
+  std::vector<std::vector<arc>> in_rows_;
+
+  // CSR copies of the rows, valid while frozen_: row i is
+  // out_arcs_[out_offsets_[i] .. out_offsets_[i + 1]), and the same for in
+  bool frozen_ = false;
+  std::vector<size_type> out_offsets_, in_offsets_;
+  std::vector<arc> out_arcs_, in_arcs_;
+
+  std::uint64_t topology_version_ = next_topology_version();
+
+  /** Thaw the graph and take a new topology version. */
+  void changed() {
+    frozen_ = false;
+    topology_version_ = next_topology_version();
+  }
+
+  static typename std::vector<arc>::const_iterator
+  find(const std::vector<arc>& row, size_type x) {
+    auto it = std::lower_bound(row.begin(), row.end(), x,
+        [](const arc& y, size_type v) { return y.node < v; });
+    return it != row.end() && it->node == x ? it : row.end();
+  }
+
+  static void insert(std::vector<arc>& row, arc x) {
+    auto it = std::lower_bound(row.begin(), row.end(), x,
+        [](const arc& y, const arc& v) { return y.node < v.node; });
+    row.insert(it, x);
+  }
+
+  /** Return node @a i's in-row if @a in, else its out-row. */
+  row_span row(bool in, size_type i) const {
+    if (frozen_) {
+      const std::vector<size_type>& offsets = in ? in_offsets_ : out_offsets_;
+      const std::vector<arc>& arcs = in ? in_arcs_ : out_arcs_;
+      return {arcs.data() + offsets[i],
+              std::size_t(offsets[i + 1] - offsets[i])};
+    }
+    const std::vector<arc>& r = in ? in_rows_[i] : out_rows_[i];
+    return {r.data(), r.size()};
+  }
+
+  incident_range incident(bool in, size_type i) const {
+    row_span r = row(in, i);
+    return incident_range(IncidentIterator(this, i, r.first),
+                          IncidentIterator(this, i, r.first + r.size),
+                          r.size);
+  }
+
+  static void pack(const std::vector<std::vector<arc>>& rows,
+                   std::vector<size_type>& offsets, std::vector<arc>& arcs) {
+    offsets.assign(rows.size() + 1, 0);
+    for (std::size_t i = 0; i < rows.size(); ++i)
+      offsets[i + 1] = offsets[i] + size_type(rows[i].size());
+    arcs.resize(offsets.back());
+    for (std::size_t i = 0; i < rows.size(); ++i)
+      std::copy(rows[i].begin(), rows[i].end(), arcs.begin() + offsets[i]);
+  }
+
+  csr_view_type view(const std::vector<size_type>& offsets,
+                     const std::vector<arc>& arcs) const {
+    static_assert(sizeof(arc) == 2 * sizeof(size_type),
+                  "arc must be two packed indices");
+    csr_view_type v;
+    if (!frozen_)
+      return v;
+    const size_type* entries = reinterpret_cast<const size_type*>(arcs.data());
+    v.offsets = offsets.data();
+    v.neighbors = entries;
+    v.edges = entries + 1;
+    v.stride = 2;
+    v.num_rows = size();
+    return v;
+  }
+};
+
+#endif // CME212_DIGRAPH_HPP
@@ -0,0 +1,87 @@
+#ifndef CME212_DIRTY_RANGE_HPP
+#define CME212_DIRTY_RANGE_HPP
+
+/** @file dirty_range.hpp
+ * @brief The span of array elements changed since a consumer last looked.
+ *
+ * A graph that exposes a contiguous array, such as its node positions, can
+ * keep a DirtyRange beside it so that a viewer uploads only the slice that
+ * changed since its previous frame instead of the whole array:
+ *
+ *   auto r = g.changed_positions();
+ *   upload(g.positions_data() + r.first, r.second - r.first);
+ *   g.clear_changes();
+ *
+ * One range, rather than a list of elements, keeps every mark O(1) and
+ * maps onto a single buffer sub-upload. Scattered changes widen it to
+ * cover all of them.
+ */
+
+#include <algorithm>
+#include <utility>
+
+
+/** @class DirtyRange
+ * @brief Half-open index range [first(), last()) covering every element
+ *        marked since the last clear().
+ *
+ * @tparam S  Index type.
+ */
+template <typename S>
+class DirtyRange {
+ public:
+  using size_type = S;
+
+  /** Construct an empty range. */
+  DirtyRange() : first_(0), last_(0) {
+  }
+
+  /** Return true if nothing was marked since the last clear(). */
+  bool empty() const {
+    return first_ == last_;
+  }
+
+  size_type first() const {
+    return first_;
+  }
+  size_type last() const {
+    return last_;
+  }
+
+  /** Return the range clipped to the first @a n elements, for arrays that
+   * shrank after their elements were marked. */
+  std::pair<size_type, size_type> clipped(size_type n) const {
+    size_type b = std::min(first_, n);
+    return {b, std::max(b, std::min(last_, n))};
+  }
+
+  /** Widen the range to cover element @a i. Complexity: O(1). */
+  void mark(size_type i) {
+    mark(i, i + 1);
+  }
+
+  /** Widen the range to cover [@a first, @a last). Complexity: O(1). */
+  void mark(size_type first, size_type last) {
+    if (first >= last)
+      return;
+    if (empty()) {
+      first_ = first;
+      last_ = last;
+    } else {
+      first_ = std::min(first_, first);
+      last_ = std::max(last_, last);
+    }
+  }
+
+  /** Forget every mark. */
+  void clear() {
+    first_ = 0;
+    last_ = 0;
+  }
+
+ private:
+  size_type first_;
+  size_type last_;
+};
+
+#endif // CME212_DIRTY_RANGE_HPP
@@ -0,0 +1,452 @@
+#ifndef CME212_DISTRIBUTED_TRAVERSAL_HPP
+#define CME212_DISTRIBUTED_TRAVERSAL_HPP
+
+/** @file distributed_traversal.hpp
+ * @brief MPI breadth-first search and single-source shortest paths over
+ *        the parts of a partitioned graph, with aggregated messages.
+ *
+ * Every rank holds one SubgraphView (graph_partition.hpp), with rank r
+ * owning part r, so no rank needs more than its own part and the ghosts
+ * around it. Each rank runs Dijkstra's algorithm over its view's CSR.
+ * Relaxing an edge to a ghost does not touch the ghost's owner right
+ * away: the new distance is queued in a buffer for that owner, and a
+ * buffer is sent as one message once it holds options.batch updates, so
+ * the sends go out while the expansion goes on. Expansion also polls for
+ * messages now and then and applies what has arrived.
+ *
+ *   DistributedShortestPaths<GraphType> sp(view);     // unit_length for BFS
+ *   std::vector<double> dist;                         // by local index
+ *   distributed_report r = sp.run(source, dist);      // collective
+ *
+ * The search runs in rounds. A rank that has nothing left to expand sends
+ * every peer a final message, holding the rest of its buffer, and then
+ * waits for the finals of its own peers; an allreduce ends the search once
+ * no rank has work left. A node whose distance a later message lowers is
+ * just expanded again, so the result is exact even though the parts
+ * settle nodes out of global order.
+ *
+ * With options.compress, each message is sorted by global index, and the
+ * indices are sent as delta-encoded varints. BFS hop counts go as varints
+ * too, and other distances as raw doubles. This header needs MPI: include
+ * it only in programs built with mpicxx.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <mpi.h>
+
+#include "common/graph_partition.hpp"
+#include "common/trace.hpp"
+#include "CME212/Point.hpp"
+
+
+/** Tuning knobs for DistributedShortestPaths. */
+struct distributed_options {
+  /** Updates per destination rank that fill a message. */
+  std::size_t batch = 4096;
+  /** Nodes expanded between two polls for incoming messages. */
+  std::size_t poll = 256;
+  /** Encode messages compactly rather than as raw (index, distance)
+   * records. Must be the same on every rank. */
+  bool compress = true;
+};
+
+/** What one search did on the calling rank. Sum over ranks with
+ * MPI_Reduce for the totals. */
+struct distributed_report {
+  std::uint64_t reached = 0;      // owned nodes with a finite distance
+  std::uint64_t rounds = 0;       // rounds until every rank ran dry
+  std::uint64_t settled = 0;      // nodes expanded, repeats included
+  std::uint64_t relaxations = 0;  // arcs relaxed
+  std::uint64_t updates = 0;      // distances sent to other ranks
+  std::uint64_t messages = 0;     // messages sent, finals included
+  std::uint64_t bytes = 0;        // bytes sent
+  double seconds = 0;             // wall time of run()
+};
+
+/** Arc length = Euclidean distance between the endpoint positions. */
+struct segment_length {
+  double operator()(const Point& a, const Point& b) const {
+    return norm(a - b);
+  }
+};
+
+/** Arc length = 1, for breadth-first search: distances are hop counts. */
+struct unit_length {
+  double operator()(const Point&, const Point&) const {
+    return 1;
+  }
+};
+
+
+/** @class DistributedShortestPaths
+ * @brief Reusable distributed search over one part of a partition.
+ *
+ * The constructor evaluates every arc length of the view once, from the
+ * local copy of the positions, and duplicates the communicator so that the
+ * search's messages cannot mix with any others of the program.
+ *
+ * @tparam G  Graph type of the SubgraphView.
+ */
+template <typename G>
+class DistributedShortestPaths {
+ public:
+  /** Type of node indices, local as well as global. */
+  using size_type = typename G::size_type;
+
+  /** Prepare the search of @a view on communicator @a comm, with arcs
+   * weighted by @a length(position, position). Collective over @a comm.
+   * @pre The calling rank of @a comm is view.part(), every rank builds the
+   *      view of its own part of the same partition, and @a length returns
+   *      a non-negative finite value for every arc
+   *
+   * Complexity: O(view.size() + number of local arcs).
+   */
+  template <typename Length = segment_length>
+  explicit DistributedShortestPaths(const SubgraphView<G>& view,
+                                    MPI_Comm comm = MPI_COMM_WORLD,
+                                    Length length = Length(),
+                                    const distributed_options& opt =
+                                        distributed_options())
+      : view_(view), opt_(opt),
+        hops_(std::is_same<Length, unit_length>::value),
+        num_owned_(std::size_t(view.num_owned())) {
+    MPI_Comm_dup(comm, &comm_);
+    int rank = 0;
+    MPI_Comm_rank(comm_, &rank);
+    assert(unsigned(rank) == view.part());
+    (void) rank;
+    assert(opt_.batch > 0 && opt_.poll > 0);
+
+    offsets_.assign(num_owned_ + 1, 0);
+    for (std::size_t k = 0; k < num_owned_; ++k)
+      offsets_[k + 1] = offsets_[k] + std::size_t(view.degree(size_type(k)));
+    arcs_.resize(offsets_[num_owned_]);
+    const std::vector<Point>& pos = view.positions();
+    for (std::size_t k = 0; k < num_owned_; ++k) {
+      auto nbrs = view.neighbors(size_type(k));
+      std::size_t j = offsets_[k];
+      for (auto q = nbrs.first; q != nbrs.second; ++q, ++j) {
+        arcs_[j] = arc{*q, double(length(pos[k], pos[*q]))};
+        assert(arcs_[j].length >= 0);
+      }
+    }
+
+    std::size_t parts = view.ghost_parts().size();
+    peers_.resize(parts);
+    owner_.resize(std::size_t(view.size()) - num_owned_);
+    for (std::size_t j = 0; j < parts; ++j) {
+      peers_[j].rank = int(view.ghost_parts()[j]);
+      auto range = view.ghost_range(j);
+      for (size_type k = range.first; k < range.second; ++k)
+        owner_[k - num_owned_] = j;
+    }
+  }
+
+  DistributedShortestPaths(const DistributedShortestPaths&) = delete;
+  DistributedShortestPaths& operator=(const DistributedShortestPaths&) = delete;
+
+  ~DistributedShortestPaths() {
+    MPI_Comm_free(&comm_);
+  }
+
+  /** Return the number of ranks this part exchanges updates with. */
+  std::size_t num_peers() const {
+    return peers_.size();
+  }
+
+  /** Find the distances from global node @a source to every owned node of
+   * the view. Collective: every rank calls it with the same @a source.
+   * @param[out] dist  Resized to view.num_owned(); dist[k] is the distance
+   *                   to local node k, infinity if it is unreachable
+   * @return This rank's counts and timing
+   *
+   * Complexity: O((S + R) log S) local work for the S nodes settled and R
+   * arcs relaxed, plus one allreduce per round.
+   */
+  distributed_report run(size_type source, std::vector<double>& dist) {
+    CME212_TRACE_SCOPE("distributed_sssp");
+    auto start = std::chrono::steady_clock::now();
+    distributed_report report;
+    const double inf = std::numeric_limits<double>::infinity();
+    dist_.assign(std::size_t(view_.size()), inf);
+    pending_.assign(owner_.size(), 0);
+    heap_ = heap_type();
+
+    size_type s = view_.local(source);
+    if (s != SubgraphView<G>::npos && std::size_t(s) < num_owned_) {
+      dist_[s] = 0;
+      heap_.push({0.0, s});
+    }
+
+    for (;;) {
+      ++report.rounds;
+      expand(report);
+      for (std::size_t j = 0; j < peers_.size(); ++j)
+        flush(j, true, report);
+      // Take messages until every peer's final for this round is in.
+      // Messages from one rank arrive in the order they were sent, so
+      // the final comes after all of the round's updates.
+      while (finals_ < peers_.size()) {
+        MPI_Status status;
+        MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, comm_, &status);
+        receive(status);
+      }
+      finals_ = 0;
+      wait_sends();
+
+      int local = !heap_.empty(), any = 0;
+      MPI_Allreduce(&local, &any, 1, MPI_INT, MPI_LOR, comm_);
+      if (!any)
+        break;
+    }
+
+    dist.assign(dist_.begin(), dist_.begin() + num_owned_);
+    for (double d : dist)
+      report.reached += (d < inf);
+    report.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return report;
+  }
+
+ private:
+  // One local arc: the neighbor's local index and the arc's length
+  struct arc {
+    size_type node;
+    double length;
+  };
+  // An update in flight: a global index and a distance
+  struct record {
+    std::uint64_t node;
+    double dist;
+  };
+  // What is exchanged with one neighboring rank
+  struct peer {
+    int rank;
+    std::vector<size_type> queued;       // local ghosts with a new distance
+    std::vector<record> records;         // scratch of encode()
+  };
+  struct send {
+    std::vector<unsigned char> buffer;
+    MPI_Request request;
+  };
+  using entry = std::pair<double, size_type>;
+  using heap_type =
+      std::priority_queue<entry, std::vector<entry>, std::greater<entry>>;
+
+  static constexpr int update_tag = 0;
+  static constexpr int final_tag = 1;
+
+  const SubgraphView<G>& view_;
+  MPI_Comm comm_;
+  distributed_options opt_;
+  bool hops_;                           // lengths are all 1: send varints
+  std::size_t num_owned_;
+  std::vector<std::size_t> offsets_;    // row k is arcs_[offsets_[k]..)
+  std::vector<arc> arcs_;
+  std::vector<std::size_t> owner_;      // peer of each ghost, from num_owned_
+  std::vector<peer> peers_;
+
+  // State of one run
+  std::vector<double> dist_;            // owned: tentative; ghost: last queued
+  std::vector<std::uint8_t> pending_;   // ghost is in its peer's queue
+  heap_type heap_;
+  std::vector<send> sends_;             // in flight until wait_sends()
+  std::vector<send> spare_;             // their buffers, for reuse
+  std::vector<unsigned char> incoming_;
+  std::size_t finals_ = 0;              // peers' finals this round
+
+  /** Expand owned nodes until the heap is empty, queueing ghost updates
+   * and applying incoming ones on the way. */
+  void expand(distributed_report& report) {
+    std::size_t since_poll = 0;
+    while (!heap_.empty()) {
+      entry top = heap_.top();
+      heap_.pop();
+      size_type u = top.second;
+      if (top.first > dist_[u])
+        continue;                       // stale: lowered since pushed
+      ++report.settled;
+      for (std::size_t j = offsets_[u]; j < offsets_[u + 1]; ++j) {
+        const arc& a = arcs_[j];
+        ++report.relaxations;
+        double d = top.first + a.length;
+        if (!(d < dist_[a.node]))
+          continue;
+        dist_[a.node] = d;
+        if (std::size_t(a.node) < num_owned_) {
+          heap_.push({d, a.node});
+        } else {
+          std::size_t g = std::size_t(a.node) - num_owned_;
+          if (!pending_[g]) {
+            pending_[g] = 1;
+            std::size_t p = owner_[g];
+            peers_[p].queued.push_back(a.node);
+            if (peers_[p].queued.size() >= opt_.batch)
+              flush(p, false, report);
+          }
+        }
+      }
+      if (++since_poll == opt_.poll) {
+        since_poll = 0;
+        poll();
+      }
+      if (heap_.empty())
+        poll();
+    }
+  }
+
+  /** Apply every message that has already arrived. */
+  void poll() {
+    for (;;) {
+      int flag = 0;
+      MPI_Status status;
+      MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, comm_, &flag, &status);
+      if (!flag)
+        return;
+      receive(status);
+    }
+  }
+
+  /** Send the queue of peer @a j, as its final message of the round if
+   * @a final. */
+  void flush(std::size_t j, bool final, distributed_report& report) {
+    peer& p = peers_[j];
+    if (p.queued.empty() && !final)
+      return;
+    send out;
+    if (!spare_.empty()) {
+      out = std::move(spare_.back());
+      spare_.pop_back();
+    }
+    encode(p, out.buffer);
+    report.updates += p.queued.size();
+    report.bytes += out.buffer.size();
+    ++report.messages;
+    for (size_type k : p.queued)
+      pending_[std::size_t(k) - num_owned_] = 0;
+    p.queued.clear();
+    MPI_Isend(out.buffer.data(), int(out.buffer.size()), MPI_BYTE, p.rank,
+              final ? final_tag : update_tag, comm_, &out.request);
+    sends_.push_back(std::move(out));
+  }
+
+  /** Complete the sends in flight and keep their buffers. */
+  void wait_sends() {
+    for (send& s : sends_) {
+      MPI_Wait(&s.request, MPI_STATUS_IGNORE);
+      spare_.push_back(std::move(s));
+    }
+    sends_.clear();
+  }
+
+  /** Receive the message @a status announces and lower the distances it
+   * carries. */
+  void receive(const MPI_Status& status) {
+    int bytes = 0;
+    MPI_Get_count(&status, MPI_BYTE, &bytes);
+    incoming_.resize(std::size_t(bytes));
+    MPI_Recv(incoming_.data(), bytes, MPI_BYTE, status.MPI_SOURCE,
+             status.MPI_TAG, comm_, MPI_STATUS_IGNORE);
+    if (status.MPI_TAG == final_tag)
+      ++finals_;
+    decode(incoming_, [&](std::uint64_t node, double d) {
+      size_type k = view_.local(size_type(node));
+      assert(k != SubgraphView<G>::npos && std::size_t(k) < num_owned_);
+      if (d < dist_[k]) {
+        dist_[k] = d;
+        heap_.push({d, k});
+      }
+    });
+  }
+
+  /** Write the queue of @a p into @a out. */
+  void encode(peer& p, std::vector<unsigned char>& out) const {
+    p.records.clear();
+    for (size_type k : p.queued)
+      p.records.push_back({std::uint64_t(view_.global(k)), dist_[k]});
+    out.clear();
+    if (!opt_.compress) {
+      out.resize(p.records.size() * sizeof(record));
+      if (!out.empty())
+        std::memcpy(out.data(), p.records.data(), out.size());
+      return;
+    }
+    std::sort(p.records.begin(), p.records.end(),
+              [](const record& a, const record& b) {
+                return a.node < b.node;
+              });
+    std::uint64_t last = 0;
+    for (const record& r : p.records) {
+      put_varint(out, r.node - last);
+      last = r.node;
+      if (hops_) {
+        put_varint(out, std::uint64_t(r.dist));
+      } else {
+        unsigned char raw[sizeof(double)];
+        std::memcpy(raw, &r.dist, sizeof(double));
+        out.insert(out.end(), raw, raw + sizeof(double));
+      }
+    }
+  }
+
+  /** Call @a fn(global index, distance) on every record of @a in. */
+  template <typename Fn>
+  void decode(const std::vector<unsigned char>& in, Fn fn) const {
+    if (!opt_.compress) {
+      assert(in.size() % sizeof(record) == 0);
+      for (std::size_t i = 0; i < in.size(); i += sizeof(record)) {
+        record r;
+        std::memcpy(&r, in.data() + i, sizeof(record));
+        fn(r.node, r.dist);
+      }
+      return;
+    }
+    const unsigned char* q = in.data();
+    const unsigned char* end = q + in.size();
+    std::uint64_t node = 0;
+    while (q != end) {
+      node += get_varint(q);
+      double d;
+      if (hops_) {
+        d = double(get_varint(q));
+      } else {
+        std::memcpy(&d, q, sizeof(double));
+        q += sizeof(double);
+      }
+      fn(node, d);
+    }
+  }
+
+  static void put_varint(std::vector<unsigned char>& out, std::uint64_t x) {
+    while (x >= 0x80) {
+      out.push_back(static_cast<unsigned char>(x | 0x80));
+      x >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(x));
+  }
+
+  static std::uint64_t get_varint(const unsigned char*& q) {
+    std::uint64_t x = 0;
+    for (int shift = 0;; shift += 7) {
+      unsigned char b = *q++;
+      x |= std::uint64_t(b & 0x7f) << shift;
+      if (!(b & 0x80))
+        return x;
+    }
+  }
+};
+
+#endif // CME212_DISTRIBUTED_TRAVERSAL_HPP
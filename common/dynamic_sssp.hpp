@@ -0,0 +1,217 @@
+#ifndef CME212_DYNAMIC_SSSP_HPP
+#define CME212_DYNAMIC_SSSP_HPP
+
+/** @file dynamic_sssp.hpp
+ * @brief Single-source shortest path distances kept up to date as nodes
+ *        and edges are added, by repairing only what the new edges improve.
+ *
+ * Adding an edge can only shorten paths. A new edge (a, b) of weight w
+ * improves anything only if dist[a] + w < dist[b] (or the other way,
+ * since edges are undirected), and then only the nodes whose shortest
+ * path now runs through it. Following Ramalingam and Reps ("An
+ * incremental algorithm for a generalization of the shortest-path
+ * problem", J. Algorithms 1996), the repair seeds a Dijkstra search with
+ * the improved endpoints and expands a node only when its distance drops,
+ * so a batch costs the region whose distances change, not the graph:
+ *
+ *   DynamicShortestPaths<GraphType> sp(g, source);   // one full search
+ *   // each frame
+ *   auto batch = log.take();
+ *   apply_updates(g, batch);                         // update_log.hpp
+ *   sssp_repair_report r = sp.repair(batch);
+ *   double d = sp.distance(i);
+ *
+ * Only insertions are handled: after a removal, or a change that makes an
+ * edge heavier, call reset(). Edge weights come from a weight functor, as
+ * for DeltaStepping, evaluated on the graph as it is at repair time; with
+ * unit_weight (laplacian.hpp) the distances are BFS hop counts.
+ */
+
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "common/delta_stepping.hpp"
+#include "common/trace.hpp"
+#include "common/update_log.hpp"
+
+
+/** What one repair did. */
+struct sssp_repair_report {
+  std::uint64_t edges = 0;        // inserted edges looked at
+  std::uint64_t seeds = 0;        // endpoints an inserted edge improved
+  std::uint64_t improved = 0;     // nodes whose distance dropped
+  std::uint64_t relaxations = 0;  // edges relaxed by the search
+  double seconds = 0;             // wall time of repair()
+};
+
+
+/** @class DynamicShortestPaths
+ * @brief Distances from one source, repaired after edge insertions.
+ *
+ * Keeps a pointer to the graph, which must outlive it; the graph may grow
+ * between repairs, and nodes added since the last one start out
+ * unreachable. Reading the graph must be safe from the calling thread.
+ *
+ * @tparam G       Graph type with size(), node(i).edge_begin()/edge_end()
+ *                 and size_type.
+ * @tparam Weight  Edge weight functor, as for DeltaStepping.
+ */
+template <typename G, typename Weight = euclidean_weight>
+class DynamicShortestPaths {
+ public:
+  /** Type of node indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Compute the distances of every node of @a g from @a source.
+   * @pre @a source < g.size() and @a weight returns a non-negative finite
+   *      value for every edge
+   *
+   * The full search is run by DeltaStepping with @a opt.
+   */
+  DynamicShortestPaths(const G& g, size_type source, Weight weight = Weight(),
+                       const sssp_options& opt = sssp_options())
+      : g_(&g), weight_(weight), opt_(opt) {
+    reset(source);
+  }
+
+  /** Recompute every distance from scratch, from @a source. */
+  sssp_report reset(size_type source) {
+    assert(std::size_t(source) < std::size_t(g_->size()));
+    source_ = source;
+    return DeltaStepping<G>(*g_, weight_, opt_).run(source, dist_);
+  }
+
+  /** Return the source of the distances. */
+  size_type source() const {
+    return source_;
+  }
+
+  /** Return the distance of node @a i from source(), or infinity if it is
+   * unreachable.
+   * @pre @a i < size() */
+  double distance(size_type i) const {
+    assert(std::size_t(i) < dist_.size());
+    return dist_[i];
+  }
+
+  /** Return the distances, indexed by node index. */
+  const std::vector<double>& distances() const {
+    return dist_;
+  }
+
+  /** Return the number of nodes the distances cover. */
+  size_type size() const {
+    return size_type(dist_.size());
+  }
+
+  /** Lower the distances the edges @a edges, already added to the graph,
+   * make shorter.
+   * @param[in] edges  Endpoints of the inserted edges; repeats and edges
+   *                   the graph already had are harmless
+   *
+   * @post distance(i) is the shortest path distance from source() for
+   *       every node i of the graph, if it was before the insertions
+   *
+   * Complexity: O(sum of the degrees of both endpoints of @a edges) to
+   * find their weights, plus O((N + R) log N) for the N nodes improved
+   * and the R edges around them.
+   */
+  sssp_repair_report repair(
+      const std::vector<std::pair<size_type, size_type>>& edges) {
+    CME212_TRACE_SCOPE_N("sssp_repair", edges.size());
+    auto start = std::chrono::steady_clock::now();
+    sssp_repair_report report;
+    grow();
+
+    for (const auto& e : edges) {
+      ++report.edges;
+      size_type a = e.first, b = e.second;
+      if (!(dist_[a] < dist_[b]))
+        std::swap(a, b);
+      // Only the farther endpoint can improve, through the nearer one
+      if (!(dist_[a] < dist_[b]))
+        continue;
+      double w = 0;
+      if (!edge_weight(a, b, w))
+        continue;
+      if (lower(b, dist_[a] + w))
+        ++report.seeds;
+    }
+
+    while (!heap_.empty()) {
+      entry top = heap_.top();
+      heap_.pop();
+      size_type u = top.second;
+      if (top.first > dist_[u])
+        continue;                       // stale: lowered since pushed
+      ++report.improved;
+      auto n = g_->node(u);
+      for (auto it = n.edge_begin(); it != n.edge_end(); ++it) {
+        auto edge = *it;
+        ++report.relaxations;
+        lower(edge.node2().index(), top.first + double(weight_(edge)));
+      }
+    }
+
+    report.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return report;
+  }
+
+  /** As repair(batch.edges), for a batch applied by apply_updates(). */
+  sssp_repair_report repair(const update_batch<size_type>& batch) {
+    return repair(batch.edges);
+  }
+
+ private:
+  using entry = std::pair<double, size_type>;
+
+  const G* g_;
+  Weight weight_;
+  sssp_options opt_;
+  size_type source_ = 0;
+  std::vector<double> dist_;
+  std::priority_queue<entry, std::vector<entry>, std::greater<entry>> heap_;
+
+  /** Give the nodes added since the last repair infinite distances. */
+  void grow() {
+    std::size_t n = std::size_t(g_->size());
+    if (dist_.size() < n)
+      dist_.resize(n, std::numeric_limits<double>::infinity());
+  }
+
+  /** Set @a w to the weight of the edge between @a a and @a b, looked up
+   * from the endpoint of smaller degree. Return false if there is none. */
+  bool edge_weight(size_type a, size_type b, double& w) const {
+    auto na = g_->node(a), nb = g_->node(b);
+    if (nb.degree() < na.degree())
+      std::swap(na, nb);
+    for (auto it = na.edge_begin(); it != na.edge_end(); ++it) {
+      auto edge = *it;
+      if (edge.node2() == nb) {
+        w = double(weight_(edge));
+        assert(w >= 0);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /** Lower the distance of @a v to @a d and queue it, if that is lower. */
+  bool lower(size_type v, double d) {
+    if (!(d < dist_[v]))
+      return false;
+    dist_[v] = d;
+    heap_.push({d, v});
+    return true;
+  }
+};
+
+#endif // CME212_DYNAMIC_SSSP_HPP
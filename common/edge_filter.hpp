@@ -0,0 +1,188 @@
+#ifndef CME212_EDGE_FILTER_HPP
+#define CME212_EDGE_FILTER_HPP
+
+/** @file edge_filter.hpp
+ * @brief Opt-in Bloom filter that answers most has_edge() misses without
+ *        touching the adjacency.
+ *
+ * Contact and candidate searches ask has_edge() mostly about pairs that are
+ * not connected, and a Graph that scans an adjacency row per query pays a
+ * row lookup and a scan for every one of those misses. A Graph can keep an
+ * edge_filter beside its edges and consult it first:
+ *
+ *   if (!filter_.may_contain(a, b))
+ *     return false;            // certain: no such edge
+ *   ...                        // the exact search, as before
+ *
+ * Build with -DCME212_EDGE_FILTER=1 to enable it. By default edge_filter is
+ * NullEdgeFilter, whose may_contain() is always true, so the check compiles
+ * away and the Graph keeps its exact memory and speed.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifndef CME212_EDGE_FILTER
+#define CME212_EDGE_FILTER 0
+#endif
+
+
+/** @class EdgeFilter
+ * @brief Split-block Bloom filter over undirected node pairs.
+ *
+ * Every pair {a, b} maps to one 32-byte block of eight 32-bit words and
+ * sets one bit in each word, so a query reads a single cache line and no
+ * false negatives are possible. At the 16 bits per edge that grow() keeps,
+ * about 1 query in 500 for an absent pair is a false positive; the caller
+ * then falls back to its exact search.
+ *
+ * A Bloom filter cannot drop keys or grow in place. The Graph calls
+ * needs_growth() before each insert and, when it returns true, reset()s
+ * the filter for the new capacity and inserts all its edges again, which
+ * costs O(1) amortized per edge because the capacity doubles each time.
+ */
+class EdgeFilter {
+ public:
+  /** Type of sizes. */
+  using size_type = std::size_t;
+
+  /** Construct an empty filter. No memory is allocated until reset(). */
+  EdgeFilter() : size_(0), capacity_(0) {
+  }
+
+  /** Return false if the edge {@a a, @a b} was certainly never inserted.
+   *
+   * Complexity: O(1), one cache line.
+   */
+  bool may_contain(std::uint32_t a, std::uint32_t b) const {
+    if (blocks_.empty())
+      return false;
+    std::uint64_t h = hash(a, b);
+    const block& blk = blocks_[block_of(h)];
+    std::uint32_t low = std::uint32_t(h);
+    for (unsigned w = 0; w < 8; ++w) {
+      if ((blk.word[w] & bit(low, w)) == 0)
+        return false;
+    }
+    return true;
+  }
+
+  /** Add the edge {@a a, @a b}.
+   * @pre !needs_growth()
+   * @post may_contain(@a a, @a b) and may_contain(@a b, @a a)
+   *
+   * Complexity: O(1).
+   */
+  void insert(std::uint32_t a, std::uint32_t b) {
+    std::uint64_t h = hash(a, b);
+    block& blk = blocks_[block_of(h)];
+    std::uint32_t low = std::uint32_t(h);
+    for (unsigned w = 0; w < 8; ++w)
+      blk.word[w] |= bit(low, w);
+    ++size_;
+  }
+
+  /** Return the number of inserts since the last reset(). */
+  size_type size() const {
+    return size_;
+  }
+
+  /** Return true if one more insert would exceed the capacity. */
+  bool needs_growth() const {
+    return size_ >= capacity_;
+  }
+
+  /** Return a capacity that makes room for twice @a n edges. */
+  static size_type grown_capacity(size_type n) {
+    return n < 64 ? 128 : 2 * n;
+  }
+
+  /** Forget every edge and size the filter for @a capacity edges. */
+  void reset(size_type capacity) {
+    size_type n = (capacity * bits_per_edge + 255) / 256;
+    blocks_.assign(n == 0 ? 1 : n, block());
+    capacity_ = capacity;
+    size_ = 0;
+  }
+
+  /** Forget every edge and release the memory. */
+  void clear() {
+    std::vector<block>().swap(blocks_);
+    size_ = 0;
+    capacity_ = 0;
+  }
+
+ private:
+  struct alignas(32) block {
+    std::uint32_t word[8] = {};
+  };
+
+  static constexpr size_type bits_per_edge = 16;
+
+  std::vector<block> blocks_;
+  size_type size_;
+  size_type capacity_;
+
+  /** Mix the canonical key of {@a a, @a b} into 64 well-spread bits. */
+  static std::uint64_t hash(std::uint32_t a, std::uint32_t b) {
+    if (b < a)
+      std::swap(a, b);
+    std::uint64_t x = (std::uint64_t(a) << 32) | b;
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ull;
+    x ^= x >> 33;
+    return x;
+  }
+
+  /** Map the high half of @a h onto [0, blocks_.size()). */
+  size_type block_of(std::uint64_t h) const {
+    return size_type(((h >> 32) * std::uint64_t(blocks_.size())) >> 32);
+  }
+
+  /** Return the bit of word @a w selected by @a low, one odd multiplier per
+   * word as in split-block Bloom filters. */
+  static std::uint32_t bit(std::uint32_t low, unsigned w) {
+    static constexpr std::uint32_t salt[8] = {
+        0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+        0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u};
+    return std::uint32_t(1) << ((low * salt[w]) >> 27);
+  }
+};
+
+
+/** Stand-in for EdgeFilter when CME212_EDGE_FILTER is 0: it holds nothing
+ * and never rules an edge out. */
+class NullEdgeFilter {
+ public:
+  using size_type = std::size_t;
+
+  bool may_contain(std::uint32_t, std::uint32_t) const {
+    return true;
+  }
+  void insert(std::uint32_t, std::uint32_t) {
+  }
+  size_type size() const {
+    return 0;
+  }
+  bool needs_growth() const {
+    return false;
+  }
+  static size_type grown_capacity(size_type n) {
+    return n;
+  }
+  void reset(size_type) {
+  }
+  void clear() {
+  }
+};
+
+/** Edge filter for Graph internals, chosen by CME212_EDGE_FILTER. */
+using edge_filter = std::conditional_t<bool(CME212_EDGE_FILTER), EdgeFilter,
+                                       NullEdgeFilter>;
+
+#endif // CME212_EDGE_FILTER_HPP
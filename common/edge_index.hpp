@@ -0,0 +1,176 @@
+#ifndef CME212_EDGE_INDEX_HPP
+#define CME212_EDGE_INDEX_HPP
+
+/** @file edge_index.hpp
+ * @brief A flat hash index from undirected node pairs to edge ids.
+ *
+ * Shared by the Graph variants so that has_edge() and the dedup check in
+ * add_edge() cost one expected O(1) probe instead of a scan over every edge.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+/** @class EdgeIndex
+ * @brief Open-addressing hash table keyed on packed undirected edges.
+ *
+ * An undirected edge {a, b} is stored under the 64-bit key
+ * (min(a, b) << 32) | max(a, b), so both orientations hit the same slot.
+ * Keys and values live in one flat array probed linearly, which keeps a
+ * lookup to one or two cache lines in the common case.
+ *
+ * @tparam T  Type of the stored edge id (the Graph's size_type).
+ *
+ * Node indices must fit in 32 bits and must not both be 0xFFFFFFFF, which
+ * is reserved as the empty-slot marker.
+ */
+template <typename T = unsigned>
+class EdgeIndex {
+ public:
+  /** Type of the packed undirected edge key. */
+  using key_type = std::uint64_t;
+  /** Type of the stored edge id. */
+  using value_type = T;
+  /** Type of sizes. */
+  using size_type = std::size_t;
+
+  /** Construct an empty index. No memory is allocated until first insert. */
+  EdgeIndex() : slots_(), size_(0), mask_(0) {
+  }
+
+  /** Return the canonical key of the undirected edge {@a a, @a b}.
+   *
+   * make_key(a, b) == make_key(b, a) for all a, b.
+   */
+  static key_type make_key(std::uint32_t a, std::uint32_t b) {
+    if (b < a)
+      std::swap(a, b);
+    return (key_type(a) << 32) | key_type(b);
+  }
+
+  /** Return the number of edges in the index. */
+  size_type size() const {
+    return size_;
+  }
+
+  /** Return true if the index holds no edges. */
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  /** Look up the edge {@a a, @a b}.
+   * @param[out] value  Set to the stored edge id if the edge is present
+   * @return True if the edge is present
+   *
+   * Complexity: O(1) expected.
+   */
+  bool find(std::uint32_t a, std::uint32_t b, value_type& value) const {
+    if (size_ == 0)
+      return false;
+    const key_type key = make_key(a, b);
+    for (size_type i = slot_of(key); ; i = (i + 1) & mask_) {
+      const slot& s = slots_[i];
+      if (s.key == key) {
+        value = s.value;
+        return true;
+      }
+      if (s.key == empty_key)
+        return false;
+    }
+  }
+
+  /** Return true if the edge {@a a, @a b} is present.
+   *
+   * Complexity: O(1) expected.
+   */
+  bool contains(std::uint32_t a, std::uint32_t b) const {
+    value_type ignored;
+    return find(a, b, ignored);
+  }
+
+  /** Insert the edge {@a a, @a b} with id @a value unless it is present.
+   * @return The id stored for the edge, and true if it was newly inserted.
+   *         An existing edge keeps its original id.
+   *
+   * @post contains(@a a, @a b)
+   *
+   * Complexity: O(1) amortized expected.
+   */
+  std::pair<value_type, bool> insert(std::uint32_t a, std::uint32_t b,
+                                     value_type value) {
+    // Grow before the table passes a 1/2 load factor, which keeps probe
+    // sequences for misses short.
+    if (2 * (size_ + 1) > slots_.size())
+      rehash(slots_.empty() ? min_slots : 2 * slots_.size());
+
+    const key_type key = make_key(a, b);
+    assert(key != empty_key);
+    for (size_type i = slot_of(key); ; i = (i + 1) & mask_) {
+      slot& s = slots_[i];
+      if (s.key == key)
+        return {s.value, false};
+      if (s.key == empty_key) {
+        s.key = key;
+        s.value = value;
+        ++size_;
+        return {value, true};
+      }
+    }
+  }
+
+  /** Make room for @a n edges without further rehashing. */
+  void reserve(size_type n) {
+    size_type want = min_slots;
+    while (want < 2 * n)
+      want *= 2;
+    if (want > slots_.size())
+      rehash(want);
+  }
+
+  /** Remove every edge. Keeps the allocated table. */
+  void clear() {
+    for (slot& s : slots_)
+      s.key = empty_key;
+    size_ = 0;
+  }
+
+ private:
+  struct slot {
+    key_type key;
+    value_type value;
+  };
+
+  static constexpr key_type empty_key = ~key_type(0);
+  static constexpr size_type min_slots = 16;
+
+  std::vector<slot> slots_;
+  size_type size_;
+  size_type mask_;
+
+  /** Fibonacci hashing of the packed key onto the power-of-two table. */
+  size_type slot_of(key_type key) const {
+    key *= 0x9E3779B97F4A7C15ull;
+    return size_type(key ^ (key >> 32)) & mask_;
+  }
+
+  /** Move every entry into a fresh table of @a n slots (a power of two). */
+  void rehash(size_type n) {
+    std::vector<slot> old(n, slot{empty_key, value_type()});
+    old.swap(slots_);
+    mask_ = n - 1;
+    for (const slot& s : old) {
+      if (s.key == empty_key)
+        continue;
+      size_type i = slot_of(s.key);
+      while (slots_[i].key != empty_key)
+        i = (i + 1) & mask_;
+      slots_[i] = s;
+    }
+  }
+};
+
+#endif // CME212_EDGE_INDEX_HPP
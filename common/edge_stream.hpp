@@ -0,0 +1,507 @@
+#ifndef CME212_EDGE_STREAM_HPP
+#define CME212_EDGE_STREAM_HPP
+
+/** @file edge_stream.hpp
+ * @brief Semi-external graphs: node data in memory, edges in a file of
+ *        source-sorted blocks streamed through a double buffer.
+ *
+ * A graph whose edges do not fit in memory can still be processed by
+ * algorithms that look at each edge once per pass and keep only per-node
+ * state: connected components, PageRank, force sums. An edge file holds
+ * the edges sorted by source, in fixed-size blocks; an EdgeStream reads
+ * block i + 1 on another thread while the caller works on block i, so a
+ * pass costs one sequential read of the file, overlapped with the work:
+ *
+ *   // Write once, from any source of edges, in bounded memory
+ *   EdgeFileWriter<std::uint32_t> out("edges.bin");
+ *   for (...) out.add(u, v);
+ *   out.finish();                          // external sort into blocks
+ *
+ *   // Any number of passes after that
+ *   EdgeStream<std::uint32_t> edges("edges.bin");
+ *   edges.for_each_block([&](const auto* e, std::size_t n) {
+ *     for (std::size_t k = 0; k < n; ++k)
+ *       rank_next[e[k].target] += rank[e[k].source] / degree[e[k].source];
+ *   });
+ *   cc_report r = stream_components(edges, num_nodes, labels);
+ *
+ * The writer sorts runs of edges in memory, spills each to a run file and
+ * merges the runs into the edge file, so the edges never have to fit in
+ * memory at once. Edges are kept as written, so an undirected graph is
+ * written once per edge or once per direction, as the algorithm needs.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/connected_components.hpp"
+#include "common/trace.hpp"
+
+
+/** One edge of an edge file. */
+template <typename S>
+struct stream_edge {
+  S source;
+  S target;
+
+  bool operator<(const stream_edge& e) const {
+    return source < e.source || (source == e.source && target < e.target);
+  }
+};
+
+
+namespace edge_file {
+
+/** Bumped whenever the layout changes. */
+constexpr std::uint32_t version = 1;
+/** Offset of the first edge; a multiple of any index alignment. */
+constexpr std::uint64_t data_offset = 64;
+
+/** Leading block of an edge file. */
+struct header {
+  char magic[8];               // "CME212E" plus a terminating 0
+  std::uint32_t version;
+  std::uint32_t index_size;    // sizeof(S) of the writer
+  std::uint64_t count;         // number of edges
+  std::uint64_t block_edges;   // edges per block, the last may be shorter
+  std::uint64_t num_nodes;     // one more than the largest index written
+};
+
+inline void set_magic(header& h) {
+  std::memcpy(h.magic, "CME212E", 8);
+}
+
+inline bool has_magic(const header& h) {
+  return std::memcmp(h.magic, "CME212E", 8) == 0;
+}
+
+/** Read exactly @a bytes at @a offset of @a fd into @a data.
+ * @throws std::runtime_error if the file ends early or the read fails */
+inline void read_at(int fd, void* data, std::size_t bytes,
+                    std::uint64_t offset) {
+  char* p = static_cast<char*>(data);
+  while (bytes > 0) {
+    ssize_t got = ::pread(fd, p, bytes, off_t(offset));
+    if (got <= 0)
+      throw std::runtime_error("EdgeStream: truncated edge file");
+    p += got;
+    bytes -= std::size_t(got);
+    offset += std::uint64_t(got);
+  }
+}
+
+} // end namespace edge_file
+
+
+/** Options of EdgeFileWriter. */
+struct edge_file_options {
+  /** Edges sorted in memory at once before they are spilled to a run
+   * file; the writer holds up to this many. */
+  std::size_t run_edges = std::size_t(1) << 24;
+  /** Edges per block of the file, and so per for_each_block() call. */
+  std::size_t block_edges = std::size_t(1) << 20;
+};
+
+
+/** @class EdgeFileWriter
+ * @brief Collects edges in any order and writes them as an edge file,
+ *        sorted by source, then target.
+ *
+ * Memory use is bounded by opt.run_edges edges plus one read buffer per
+ * run during the merge. Run files are named after the edge file and
+ * removed by finish(). Not thread safe.
+ *
+ * @tparam S  Unsigned node index type of the file.
+ */
+template <typename S>
+class EdgeFileWriter {
+  static_assert(std::is_unsigned<S>::value,
+                "EdgeFileWriter requires an unsigned index type");
+
+ public:
+  using size_type = S;
+  using edge_type = stream_edge<S>;
+
+  explicit EdgeFileWriter(std::string path,
+                          const edge_file_options& opt = edge_file_options())
+      : path_(std::move(path)), opt_(opt) {
+    opt_.run_edges = std::max<std::size_t>(opt_.run_edges, 1);
+    opt_.block_edges = std::max<std::size_t>(opt_.block_edges, 1);
+    run_.reserve(opt_.run_edges);
+  }
+
+  EdgeFileWriter(const EdgeFileWriter&) = delete;
+  EdgeFileWriter& operator=(const EdgeFileWriter&) = delete;
+
+  ~EdgeFileWriter() {
+    for (const std::string& r : runs_)
+      std::remove(r.c_str());
+  }
+
+  /** Add the edge from @a source to @a target.
+   * @throws std::runtime_error if a full run cannot be spilled
+   *
+   * Complexity: O(1) amortized, plus O(R log R) to sort every run of R =
+   * opt.run_edges edges.
+   */
+  void add(S source, S target) {
+    run_.push_back({source, target});
+    num_nodes_ = std::max<std::uint64_t>(num_nodes_,
+        std::uint64_t(std::max(source, target)) + 1);
+    if (run_.size() == opt_.run_edges)
+      spill();
+  }
+
+  /** Return the number of edges added so far. */
+  std::uint64_t size() const {
+    return count_ + run_.size();
+  }
+
+  /** Write the edge file and remove the run files.
+   * @throws std::runtime_error if a file cannot be read or written
+   *
+   * Complexity: O(E log(E / R)) for E edges in runs of R, with one
+   * sequential write of every edge per spill and one for the merge.
+   */
+  void finish() {
+    std::FILE* out = std::fopen(path_.c_str(), "wb");
+    if (!out)
+      throw std::runtime_error("EdgeFileWriter: cannot create " + path_);
+    edge_file::header h{};
+    edge_file::set_magic(h);
+    h.version = edge_file::version;
+    h.index_size = std::uint32_t(sizeof(S));
+    h.count = size();
+    h.block_edges = opt_.block_edges;
+    h.num_nodes = num_nodes_;
+    char pad[edge_file::data_offset] = {};
+    std::memcpy(pad, &h, sizeof(h));
+    bool ok = std::fwrite(pad, 1, sizeof(pad), out) == sizeof(pad);
+
+    std::sort(run_.begin(), run_.end());
+    if (runs_.empty()) {
+      ok = ok && write(out, run_.data(), run_.size());
+    } else {
+      if (!run_.empty())
+        spill();
+      ok = ok && merge(out);
+    }
+    ok = std::fclose(out) == 0 && ok;
+    for (const std::string& r : runs_)
+      std::remove(r.c_str());
+    runs_.clear();
+    run_.clear();
+    count_ = 0;
+    if (!ok)
+      throw std::runtime_error("EdgeFileWriter: cannot write " + path_);
+  }
+
+ private:
+  std::string path_;
+  edge_file_options opt_;
+  std::vector<edge_type> run_;
+  std::vector<std::string> runs_;
+  std::uint64_t count_ = 0;      // edges in the run files
+  std::uint64_t num_nodes_ = 0;
+
+  static bool write(std::FILE* f, const edge_type* e, std::size_t n) {
+    return n == 0 || std::fwrite(e, sizeof(edge_type), n, f) == n;
+  }
+
+  /** Sort the edges in memory and write them to a new run file. */
+  void spill() {
+    std::sort(run_.begin(), run_.end());
+    std::string name = path_ + ".run" + std::to_string(runs_.size());
+    std::FILE* f = std::fopen(name.c_str(), "wb");
+    bool ok = f && write(f, run_.data(), run_.size());
+    ok = f && std::fclose(f) == 0 && ok;
+    if (!ok)
+      throw std::runtime_error("EdgeFileWriter: cannot write " + name);
+    runs_.push_back(name);
+    count_ += run_.size();
+    run_.clear();
+  }
+
+  /** Merge the sorted run files into @a out. */
+  bool merge(std::FILE* out) {
+    struct source {
+      std::FILE* f;
+      std::vector<edge_type> buf;
+      std::size_t pos = 0;
+      std::size_t len = 0;
+    };
+    std::size_t chunk = std::max<std::size_t>(1024,
+        opt_.run_edges / (runs_.size() + 1));
+    std::vector<source> in(runs_.size());
+    bool ok = true;
+    auto refill = [&](source& s) {
+      s.len = std::fread(s.buf.data(), sizeof(edge_type), s.buf.size(), s.f);
+      s.pos = 0;
+      return s.len > 0;
+    };
+    using item = std::pair<edge_type, std::size_t>;
+    auto later = [](const item& a, const item& b) { return b.first < a.first; };
+    std::priority_queue<item, std::vector<item>, decltype(later)> heap(later);
+    for (std::size_t r = 0; r < runs_.size(); ++r) {
+      in[r].f = std::fopen(runs_[r].c_str(), "rb");
+      if (!in[r].f) {
+        ok = false;
+        continue;
+      }
+      in[r].buf.resize(chunk);
+      if (refill(in[r]))
+        heap.push({in[r].buf[0], r});
+    }
+
+    std::vector<edge_type> block;
+    block.reserve(chunk);
+    while (ok && !heap.empty()) {
+      item top = heap.top();
+      heap.pop();
+      block.push_back(top.first);
+      if (block.size() == chunk) {
+        ok = write(out, block.data(), block.size());
+        block.clear();
+      }
+      source& s = in[top.second];
+      if (++s.pos < s.len || refill(s))
+        heap.push({s.buf[s.pos], top.second});
+    }
+    ok = ok && write(out, block.data(), block.size());
+    for (source& s : in)
+      if (s.f)
+        std::fclose(s.f);
+    return ok;
+  }
+};
+
+
+/** @class EdgeStream
+ * @brief Sequential, double-buffered passes over an edge file.
+ *
+ * Each for_each_block() call is one pass in file order: while the callback
+ * runs on one block, the next one is read on a background thread into the
+ * other buffer. The two buffers of one block each are the stream's only
+ * edge memory. Passes must not overlap; use one stream per concurrent
+ * pass.
+ *
+ * @tparam S  Node index type the file was written with.
+ */
+template <typename S>
+class EdgeStream {
+ public:
+  using size_type = S;
+  using edge_type = stream_edge<S>;
+
+  /** Open the edge file at @a path.
+   * @throws std::runtime_error if it cannot be opened, is not an edge file
+   *         or holds indices of another size
+   */
+  explicit EdgeStream(const std::string& path) : path_(path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+      throw std::runtime_error("EdgeStream: cannot open " + path);
+    struct stat st;
+    bool ok = ::fstat(fd_, &st) == 0 &&
+              std::uint64_t(st.st_size) >= edge_file::data_offset;
+    if (ok) {
+      edge_file::read_at(fd_, &head_, sizeof(head_), 0);
+      ok = edge_file::has_magic(head_) &&
+           head_.version == edge_file::version &&
+           head_.index_size == sizeof(S) && head_.block_edges > 0 &&
+           edge_file::data_offset + head_.count * sizeof(edge_type) <=
+               std::uint64_t(st.st_size);
+    }
+    if (!ok) {
+      ::close(fd_);
+      throw std::runtime_error("EdgeStream: incompatible edge file " + path);
+    }
+  }
+
+  EdgeStream(const EdgeStream&) = delete;
+  EdgeStream& operator=(const EdgeStream&) = delete;
+
+  ~EdgeStream() {
+    ::close(fd_);
+  }
+
+  /** Return the number of edges in the file. */
+  std::uint64_t num_edges() const {
+    return head_.count;
+  }
+  /** Return one more than the largest node index in the file. */
+  std::uint64_t num_nodes() const {
+    return head_.num_nodes;
+  }
+  /** Return the number of edges per block. */
+  std::size_t block_edges() const {
+    return std::size_t(head_.block_edges);
+  }
+  /** Return the number of blocks. */
+  std::size_t num_blocks() const {
+    return std::size_t((head_.count + head_.block_edges - 1) /
+                       head_.block_edges);
+  }
+
+  /** Call fn(edges, n) for every block in file order, with the n edges of
+   * the block at edges, sorted by source, then target.
+   * @throws std::runtime_error if the file cannot be read, and whatever
+   *         @a fn throws, after the read in flight has finished
+   *
+   * Complexity: one sequential read of the file, overlapped with @a fn.
+   */
+  template <typename Fn>
+  void for_each_block(Fn fn) {
+    CME212_TRACE_SCOPE("edge_stream_pass");
+    std::size_t blocks = num_blocks();
+    if (blocks == 0)
+      return;
+    std::size_t cap = block_edges();
+    for (auto& b : buffers_)
+      b.resize(cap);
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    std::size_t n = read_block(0, buffers_[0].data());
+    for (std::size_t i = 0; i < blocks; ++i) {
+      std::future<std::size_t> next;
+      if (i + 1 < blocks)
+        next = std::async(std::launch::async, &EdgeStream::read_block, this,
+                          i + 1, buffers_[(i + 1) % 2].data());
+      try {
+        fn(static_cast<const edge_type*>(buffers_[i % 2].data()), n);
+      } catch (...) {
+        if (next.valid())
+          next.wait();
+        throw;
+      }
+      if (next.valid())
+        n = next.get();
+    }
+  }
+
+  /** Call fn(source, target) for every edge in file order, as
+   * for_each_block(). */
+  template <typename Fn>
+  void for_each_edge(Fn fn) {
+    for_each_block([&](const edge_type* e, std::size_t n) {
+      for (std::size_t k = 0; k < n; ++k)
+        fn(e[k].source, e[k].target);
+    });
+  }
+
+ private:
+  std::string path_;
+  int fd_ = -1;
+  edge_file::header head_{};
+  std::vector<edge_type> buffers_[2];
+
+  /** Read block @a i into @a out; return its number of edges. */
+  std::size_t read_block(std::size_t i, edge_type* out) const {
+    std::uint64_t first = std::uint64_t(i) * head_.block_edges;
+    std::size_t n = std::size_t(std::min<std::uint64_t>(head_.block_edges,
+                                                        head_.count - first));
+    edge_file::read_at(fd_, out, n * sizeof(edge_type),
+                       edge_file::data_offset + first * sizeof(edge_type));
+    return n;
+  }
+};
+
+
+/** Write every edge of @a g to an edge file at @a path, once per edge from
+ * node1() to node2(), or in both directions if @a both_directions.
+ * @throws std::runtime_error if the file cannot be written
+ *
+ * Complexity: that of EdgeFileWriter for g.num_edges() or twice as many
+ * edges.
+ */
+template <typename G>
+void write_edge_file(const G& g, const std::string& path,
+                     bool both_directions = false,
+                     const edge_file_options& opt = edge_file_options()) {
+  using size_type = std::make_unsigned_t<typename G::size_type>;
+  EdgeFileWriter<size_type> out(path, opt);
+  for (auto it = g.edge_begin(); it != g.edge_end(); ++it) {
+    auto e = *it;
+    size_type a = size_type(e.node1().index());
+    size_type b = size_type(e.node2().index());
+    out.add(a, b);
+    if (both_directions)
+      out.add(b, a);
+  }
+  out.finish();
+}
+
+
+/** Label every node of the graph of @a edges with the smallest node index
+ * in its connected component, with the edges taken as undirected.
+ * @param[in] num_nodes  Number of nodes, at least edges.num_nodes()
+ * @param[out] labels    Receives labels[i] for every i < @a num_nodes
+ * @return Number of components, size of the largest one, and timing
+ *
+ * One pass over the file; the union-find forest of connected_components()
+ * is the only per-node state, and each block is joined on several threads.
+ *
+ * Complexity: one read of the file, and the labeling work of
+ * connected_components() for its edges.
+ */
+template <typename S, typename Labels>
+cc_report stream_components(EdgeStream<S>& edges, std::size_t num_nodes,
+                            Labels& labels,
+                            const cc_options& opt = cc_options()) {
+  using namespace connected_components_detail;
+  CME212_TRACE_SCOPE("stream_components");
+  auto start = std::chrono::steady_clock::now();
+  unsigned threads = csr_snapshot::thread_count(opt.threads);
+  if (edges.num_nodes() > num_nodes)
+    throw std::runtime_error("stream_components: the edge file has node "
+                             "indices beyond num_nodes");
+
+  forest<S> f(num_nodes, threads);
+  edges.for_each_block([&](const stream_edge<S>* e, std::size_t n) {
+    csr_snapshot::parallel_ranges(threads, n, 4096,
+        [&](unsigned, std::size_t b, std::size_t end) {
+          for (std::size_t k = b; k < end; ++k)
+            f.link(e[k].source, e[k].target);
+        });
+  });
+
+  std::vector<std::size_t> roots(threads, 0);
+  csr_snapshot::parallel_ranges(threads, num_nodes, 4096,
+      [&](unsigned t, std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i) {
+          S r = f.find(S(i));
+          labels[i] = r;
+          roots[t] += (r == S(i));
+        }
+      });
+
+  cc_report report;
+  for (std::size_t c : roots)
+    report.components += c;
+  std::vector<std::uint64_t> sizes(num_nodes, 0);
+  for (std::size_t i = 0; i < num_nodes; ++i)
+    report.largest = std::max(report.largest, ++sizes[std::size_t(labels[i])]);
+  report.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return report;
+}
+
+#endif // CME212_EDGE_STREAM_HPP
@@ -0,0 +1,259 @@
+#ifndef CME212_EIGEN_MAP_HPP
+#define CME212_EIGEN_MAP_HPP
+
+/** @file eigen_map.hpp
+ * @brief Eigen views of a frozen graph's weighted adjacency that copy
+ *        nothing, for handing a topology to Eigen's solvers.
+ *
+ * Building an Eigen::SparseMatrix from triplets sorts every entry again,
+ * although a frozen Graph already holds its adjacency in compressed row
+ * form with the columns of each row in increasing order. eigen_adjacency()
+ * instead maps an Eigen::SparseMatrix onto the graph's own arrays: the CSR
+ * offsets of view_csr(), the neighbor columns of columns_view() and the
+ * weights in entry order of weights_view(). The matrix W has W(i, j) the
+ * weight of edge {i, j} (summed over parallel edges) and nothing on the
+ * diagonal:
+ *
+ *   g.enable_weights();                    // and set_weight() as needed
+ *   g.freeze();
+ *   auto W = eigen_adjacency(g);           // Eigen::Map, float entries
+ *   Eigen::VectorXf y = W * x;
+ *
+ * Operators of the form D + s W, a diagonal supplied separately plus a
+ * multiple of the adjacency, are what implicit spring and diffusion steps
+ * solve with; the graph Laplacian is D the weighted degrees and s = -1.
+ * GraphSystem applies one without ever forming it, in any scalar type, and
+ * plugs into Eigen's iterative solvers as a matrix-free operator:
+ *
+ *   Eigen::VectorXd d = ...;               // e.g. mass / dt^2 + degrees
+ *   GraphSystem<Graph<V>> A(g, d, -1.0);
+ *   Eigen::ConjugateGradient<GraphSystem<Graph<V>>, Eigen::Lower | Eigen::Upper,
+ *                            Eigen::IdentityPreconditioner> cg(A);
+ *   Eigen::VectorXd x = cg.solve(b);
+ *
+ * Both read the graph in place, so they are invalidated by whatever
+ * invalidates view_csr() and weights_view(): any change to the edges,
+ * freeze(), clear(), and set_weight().
+ */
+
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+#include "common/csr_snapshot.hpp"
+
+
+namespace eigen_map_detail {
+
+/** Eigen's index type for the arrays of graph type G: the signed integer
+ * of the same width as its indices, which Eigen requires. */
+template <typename G>
+using storage_index = std::make_signed_t<typename G::size_type>;
+
+/** Throw unless @a g is frozen, weighted and small enough for
+ * storage_index<G>; @a who names the caller in the message. */
+template <typename G, typename View>
+void check_mappable(const G& g, const View& view, const char* who) {
+  if (!view.valid())
+    throw std::runtime_error(std::string(who) + ": the graph must be frozen "
+                             "without stale rows or removed elements");
+  if (!g.has_weights())
+    throw std::runtime_error(std::string(who) + ": the graph has no weights; "
+                             "call enable_weights() first");
+  using I = storage_index<G>;
+  if (view.nnz() > std::size_t(std::numeric_limits<I>::max()))
+    throw std::runtime_error(std::string(who) +
+                             ": the graph has too many entries for its "
+                             "index type");
+}
+
+} // end namespace eigen_map_detail
+
+
+/** Type of the matrix eigen_adjacency() maps for graph type G. */
+template <typename G>
+using eigen_adjacency_matrix =
+    Eigen::SparseMatrix<float, Eigen::RowMajor,
+                        eigen_map_detail::storage_index<G>>;
+
+/** Return the weighted adjacency of @a g as a read-only Eigen sparse
+ * matrix over the graph's own arrays.
+ * @return A g.size() by g.size() row major map: row i holds W(i, j), the
+ *         weight of each edge {i, j}, at column j, columns increasing, and
+ *         nothing on the diagonal
+ * @throws std::runtime_error if @a g is not frozen with view_csr() valid,
+ *         has no weights, or has more entries than its index type's
+ *         signed range holds
+ *
+ * The offsets and columns are the graph's unsigned indices read as their
+ * signed counterparts, which Eigen requires and which agree with them
+ * below that range. Parallel edges give repeated columns in a row; Eigen's
+ * products sum them, but coeff() finds only one.
+ *
+ * Complexity: O(1), or O(num_edges()) when columns_view() or
+ * weights_view() must first refresh its array.
+ */
+template <typename G>
+Eigen::Map<const eigen_adjacency_matrix<G>> eigen_adjacency(const G& g) {
+  using I = eigen_map_detail::storage_index<G>;
+  auto view = g.view_csr();
+  eigen_map_detail::check_mappable(g, view, "eigen_adjacency");
+  static_assert(sizeof(*view.offsets) == sizeof(I),
+                "eigen_adjacency: CSR offsets must be as wide as the indices");
+  const float* weights = g.weights_view();
+  const auto* columns = g.columns_view();
+  Eigen::Index n = Eigen::Index(view.num_rows);
+  return Eigen::Map<const eigen_adjacency_matrix<G>>(
+      n, n, Eigen::Index(view.nnz()),
+      reinterpret_cast<const I*>(view.offsets),
+      reinterpret_cast<const I*>(columns), weights);
+}
+
+
+template <typename G, typename T = double>
+class GraphSystem;
+
+namespace Eigen {
+namespace internal {
+
+/** Eigen's solvers take GraphSystem for a sparse matrix. */
+template <typename G, typename Scalar>
+struct traits<GraphSystem<G, Scalar>>
+    : public traits<SparseMatrix<Scalar, RowMajor,
+                                 eigen_map_detail::storage_index<G>>> {};
+
+} // end namespace internal
+} // end namespace Eigen
+
+
+/** @class GraphSystem
+ * @brief The operator A = diag(d) + s W on a frozen, weighted graph, for
+ *        Eigen's matrix-free iterative solvers.
+ *
+ * @tparam G  Graph type with view_csr(), columns_view(), weights_view()
+ * @tparam T  Scalar of the vectors it applies to; the float weights are
+ *            widened on the fly
+ *
+ * A is symmetric, as W is, so ConjugateGradient solves with it whenever
+ * it is positive definite, e.g. for d_i > |s| sum_j W(i, j); BiCGSTAB and
+ * GMRES take it otherwise. Products split the rows over @a threads
+ * threads. Only the product with a dense vector or matrix is provided,
+ * which is all the iterative solvers use, so preconditioners that read
+ * coefficients are out: use Eigen::IdentityPreconditioner.
+ *
+ * The diagonal is held by reference and may be changed between solves,
+ * e.g. for a new time step. It must outlive the operator, as must @a g.
+ */
+template <typename G, typename T>
+class GraphSystem : public Eigen::EigenBase<GraphSystem<G, T>> {
+ public:
+  using Scalar = T;
+  using RealScalar = typename Eigen::NumTraits<Scalar>::Real;
+  using StorageIndex = eigen_map_detail::storage_index<G>;
+  using Diagonal = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+  enum {
+    ColsAtCompileTime = Eigen::Dynamic,
+    MaxColsAtCompileTime = Eigen::Dynamic,
+    IsRowMajor = true
+  };
+
+  /** Construct the operator diag(@a diagonal) + @a scale W of @a g.
+   * @throws std::runtime_error as eigen_adjacency(), or if
+   *         @a diagonal.size() != g.size()
+   */
+  GraphSystem(const G& g, const Diagonal& diagonal, Scalar scale = Scalar(1),
+              unsigned threads = 0)
+      : view_(g.view_csr()), diagonal_(&diagonal), scale_(scale),
+        threads_(csr_snapshot::thread_count(threads)) {
+    eigen_map_detail::check_mappable(g, view_, "GraphSystem");
+    columns_ = g.columns_view();
+    weights_ = g.weights_view();
+    if (std::size_t(diagonal.size()) != view_.num_rows)
+      throw std::runtime_error("GraphSystem: the diagonal has " +
+                               std::to_string(diagonal.size()) +
+                               " entries for " +
+                               std::to_string(view_.num_rows) + " nodes");
+  }
+
+  Eigen::Index rows() const {
+    return Eigen::Index(view_.num_rows);
+  }
+  Eigen::Index cols() const {
+    return Eigen::Index(view_.num_rows);
+  }
+
+  const Diagonal& diagonal() const {
+    return *diagonal_;
+  }
+  Scalar scale() const {
+    return scale_;
+  }
+
+  template <typename Rhs>
+  Eigen::Product<GraphSystem, Rhs, Eigen::AliasFreeProduct>
+  operator*(const Eigen::MatrixBase<Rhs>& x) const {
+    return Eigen::Product<GraphSystem, Rhs, Eigen::AliasFreeProduct>(
+        *this, x.derived());
+  }
+
+  /** Add @a alpha A @a x to @a y, column by column.
+   * Complexity: O(num_nodes() + num_edges()) per column, split over the
+   * threads. */
+  template <typename Dest, typename Rhs>
+  void add_product(Dest& y, const Rhs& x, Scalar alpha) const {
+    const Diagonal& d = *diagonal_;
+    for (Eigen::Index c = 0; c < x.cols(); ++c) {
+      csr_snapshot::parallel_ranges(threads_, view_.num_rows, 1024,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t i = b; i < e; ++i) {
+              Scalar s(0);
+              for (std::size_t k = view_.offsets[i]; k < view_.offsets[i + 1];
+                   ++k)
+                s += Scalar(weights_[k]) *
+                     x.coeff(Eigen::Index(columns_[k]), c);
+              Eigen::Index r = Eigen::Index(i);
+              y.coeffRef(r, c) += alpha * (d[r] * x.coeff(r, c) + scale_ * s);
+            }
+          });
+    }
+  }
+
+ private:
+  decltype(std::declval<const G&>().view_csr()) view_;
+  const typename G::size_type* columns_ = nullptr;
+  const float* weights_ = nullptr;
+  const Diagonal* diagonal_;
+  Scalar scale_;
+  unsigned threads_;
+};
+
+
+namespace Eigen {
+namespace internal {
+
+/** Products of a GraphSystem with dense vectors and matrices. */
+template <typename G, typename Scalar, typename Rhs>
+struct generic_product_impl<GraphSystem<G, Scalar>, Rhs, SparseShape,
+                            DenseShape, GemvProduct>
+    : generic_product_impl_base<
+          GraphSystem<G, Scalar>, Rhs,
+          generic_product_impl<GraphSystem<G, Scalar>, Rhs>> {
+  template <typename Dest>
+  static void scaleAndAddTo(Dest& dst, const GraphSystem<G, Scalar>& lhs,
+                            const Rhs& rhs, const Scalar& alpha) {
+    // Evaluate expressions once, so each coefficient is read as a load
+    const auto& x = rhs.eval();
+    lhs.add_product(dst, x, alpha);
+  }
+};
+
+} // end namespace internal
+} // end namespace Eigen
+
+#endif // CME212_EIGEN_MAP_HPP
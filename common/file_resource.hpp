@@ -0,0 +1,280 @@
+#ifndef CME212_FILE_RESOURCE_HPP
+#define CME212_FILE_RESOURCE_HPP
+
+/** @file file_resource.hpp
+ * @brief A memory resource that puts large graph buffers in a sparse file,
+ *        so a graph can be built beyond the size of RAM.
+ *
+ * Anonymous memory can only be swapped out, and most machines that build
+ * large graphs have little or no swap, so a build runs out of memory once
+ * its node, edge and CSR arrays outgrow RAM. FileResource instead places
+ * every buffer of at least file_options::threshold bytes in one file
+ * mapped MAP_SHARED. Its pages are ordinary page cache: the kernel writes
+ * cold ones back to the file and drops them when memory runs short, and
+ * faults them back in when they are touched again.
+ *
+ * The whole of file_options::reserve bytes of address space is mapped up
+ * front and the file grows under it with ftruncate(), in steps of at least
+ * file_options::grow bytes. Buffers therefore never move once handed out,
+ * which the containers that hold pointers into them need; growing the
+ * mapping itself with mremap() could move it. Freed buffers are reused
+ * first fit, and their blocks are punched out of the file so that the
+ * copies std::vector growth leaves behind take no disk space.
+ *
+ * Smaller requests go to the upstream resource. Any std::pmr container, or
+ * a Graph that takes a memory resource, can use it:
+ *
+ *   FileResource file(file_options{"/scratch/build.bin"});
+ *   Graph<V> g(&file);
+ *
+ * The file holds the buffers wherever they were placed, not in the graph
+ * file layout of mapped_graph.hpp. Graph::save_binary() writes that layout
+ * from the mapped arrays, which need not fit in RAM at once either.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "common/page_resource.hpp"
+
+
+/** Settings of a FileResource. */
+struct file_options {
+  /** Backing file, created or truncated. */
+  std::string path;
+  /** Address space reserved for the mapping, the most the file can hold. */
+  std::size_t reserve = std::size_t(1) << 40;
+  /** Requests of fewer bytes go to the upstream resource. */
+  std::size_t threshold = std::size_t(1) << 20;
+  /** Smallest step the file grows by. */
+  std::size_t grow = std::size_t(64) << 20;
+  /** Keep the file when the resource is destroyed instead of removing it. */
+  bool keep_file = false;
+  /** Resource for small requests. */
+  std::pmr::memory_resource* upstream = std::pmr::get_default_resource();
+};
+
+/** What a FileResource has placed in its file. */
+struct file_report {
+  std::size_t file_bytes = 0;          // length of the file
+  std::size_t mapped_bytes = 0;        // large buffers live now
+  std::size_t peak_mapped_bytes = 0;
+  std::uint64_t buffers = 0;           // large buffers placed so far
+  std::uint64_t reused = 0;            // of which in space freed before
+  std::uint64_t growths = 0;           // ftruncate() calls that grew the file
+  std::uint64_t holes_punched = 0;     // freed ranges given back to the disk
+};
+
+
+/** @class FileResource
+ * @brief std::pmr::memory_resource that places large buffers in a sparse,
+ *        shared file mapping, as described in the file comment.
+ *
+ * Allocation and deallocation may run on several threads at once. The
+ * resource must outlive everything allocated from it, and memory must be
+ * returned with the size it was allocated with, as std::pmr containers do.
+ */
+class FileResource : public std::pmr::memory_resource {
+ public:
+  /** Create the file and reserve its mapping.
+   * @throws std::runtime_error if the file cannot be created or mapped
+   */
+  explicit FileResource(const file_options& options)
+      : options_(options), fd_(-1), base_(nullptr) {
+    options_.reserve = page_resource_detail::round_up(
+        options_.reserve, page_resource_detail::page_size());
+    fd_ = ::open(options_.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+      throw std::runtime_error("FileResource: cannot create " + options_.path);
+    void* p = ::mmap(nullptr, options_.reserve, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_NORESERVE, fd_, 0);
+    if (p == MAP_FAILED) {
+      ::close(fd_);
+      throw std::runtime_error("FileResource: cannot map " + options_.path);
+    }
+    base_ = static_cast<char*>(p);
+  }
+
+  ~FileResource() override {
+    ::munmap(base_, options_.reserve);
+    ::close(fd_);
+    if (!options_.keep_file)
+      ::unlink(options_.path.c_str());
+  }
+
+  FileResource(const FileResource&) = delete;
+  FileResource& operator=(const FileResource&) = delete;
+
+  const file_options& options() const {
+    return options_;
+  }
+
+  /** Return the counts of large buffers so far. */
+  file_report report() const {
+    file_report r;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      r.file_bytes = file_size_;
+    }
+    r.mapped_bytes = mapped_.load(std::memory_order_relaxed);
+    r.peak_mapped_bytes = peak_.load(std::memory_order_relaxed);
+    r.buffers = buffers_.load(std::memory_order_relaxed);
+    r.reused = reused_.load(std::memory_order_relaxed);
+    r.growths = growths_.load(std::memory_order_relaxed);
+    r.holes_punched = holes_punched_.load(std::memory_order_relaxed);
+    return r;
+  }
+
+  /** Write every dirty page back to the file and wait for it, e.g. before
+   * handing the file to another process.
+   * @throws std::runtime_error if msync() fails
+   */
+  void flush() const {
+    std::size_t used;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      used = end_;
+    }
+    if (used != 0 && ::msync(base_, used, MS_SYNC) != 0)
+      throw std::runtime_error("FileResource: cannot sync " + options_.path);
+  }
+
+ private:
+  file_options options_;
+  int fd_;
+  char* base_;
+  std::atomic<std::size_t> mapped_{0};
+  std::atomic<std::size_t> peak_{0};
+  std::atomic<std::uint64_t> buffers_{0};
+  std::atomic<std::uint64_t> reused_{0};
+  std::atomic<std::uint64_t> growths_{0};
+  std::atomic<std::uint64_t> holes_punched_{0};
+
+  // Bytes of the file handed out so far, [0, end_), and its length. Freed
+  // ranges below end_ by offset, adjacent ones merged.
+  mutable std::mutex mutex_;
+  std::size_t end_ = 0;
+  std::size_t file_size_ = 0;
+  std::map<std::size_t, std::size_t> free_;
+
+  bool is_large(std::size_t bytes, std::size_t alignment) const {
+    return bytes >= options_.threshold
+        && alignment <= page_resource_detail::page_size();
+  }
+
+  /** Return the offset of a free range of @a size bytes, taken first fit
+   * from the freed ranges or else from the end of the file, which grows
+   * if it must. Needs mutex_. */
+  std::size_t take(std::size_t size) {
+    for (auto it = free_.begin(); it != free_.end(); ++it) {
+      if (it->second < size)
+        continue;
+      std::size_t at = it->first;
+      std::size_t rest = it->second - size;
+      free_.erase(it);
+      if (rest != 0)
+        free_[at + size] = rest;
+      reused_.fetch_add(1, std::memory_order_relaxed);
+      return at;
+    }
+    if (size > options_.reserve - end_)
+      throw std::bad_alloc();
+    std::size_t at = end_;
+    end_ += size;
+    if (end_ > file_size_) {
+      std::size_t want = std::max(end_, file_size_ + options_.grow);
+      want = std::min(page_resource_detail::round_up(
+                          want, page_resource_detail::page_size()),
+                      options_.reserve);
+      if (::ftruncate(fd_, off_t(want)) != 0) {
+        end_ = at;
+        throw std::bad_alloc();
+      }
+      file_size_ = want;
+      growths_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return at;
+  }
+
+  /** Return [@a at, @a at + @a size) to the free ranges, merging it with
+   * its neighbors and with the end of the used part. Needs mutex_. */
+  void give_back(std::size_t at, std::size_t size) {
+    auto next = free_.lower_bound(at);
+    if (next != free_.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second == at) {
+        at = prev->first;
+        size += prev->second;
+        free_.erase(prev);
+      }
+    }
+    if (next != free_.end() && at + size == next->first) {
+      size += next->second;
+      free_.erase(next);
+    }
+    if (at + size == end_)
+      end_ = at;
+    else
+      free_[at] = size;
+  }
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    if (!is_large(bytes, alignment))
+      return options_.upstream->allocate(bytes, alignment);
+    std::size_t size =
+        page_resource_detail::round_up(bytes, page_resource_detail::page_size());
+    std::size_t at;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      at = take(size);
+    }
+
+    buffers_.fetch_add(1, std::memory_order_relaxed);
+    std::size_t now = mapped_.fetch_add(size, std::memory_order_relaxed) + size;
+    std::size_t peak = peak_.load(std::memory_order_relaxed);
+    while (peak < now && !peak_.compare_exchange_weak(
+               peak, now, std::memory_order_relaxed)) {
+    }
+    return base_ + at;
+  }
+
+  void do_deallocate(void* p, std::size_t bytes,
+                     std::size_t alignment) override {
+    if (!is_large(bytes, alignment)) {
+      options_.upstream->deallocate(p, bytes, alignment);
+      return;
+    }
+    std::size_t size =
+        page_resource_detail::round_up(bytes, page_resource_detail::page_size());
+    std::size_t at = std::size_t(static_cast<char*>(p) - base_);
+    // Drop the pages and their disk blocks; the range reads back as zeros.
+    // Filesystems without hole punching keep the blocks until reuse.
+    if (::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                    off_t(at), off_t(size)) == 0)
+      holes_punched_.fetch_add(1, std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      give_back(at, size);
+    }
+    mapped_.fetch_sub(size, std::memory_order_relaxed);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+
+#endif // CME212_FILE_RESOURCE_HPP
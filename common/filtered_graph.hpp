@@ -0,0 +1,453 @@
+#ifndef CME212_FILTERED_GRAPH_HPP
+#define CME212_FILTERED_GRAPH_HPP
+
+/** @file filtered_graph.hpp
+ * @brief Induced subgraph view over a graph, without copying it.
+ *
+ * FilteredGraph keeps the set of selected nodes as one bit per node of the
+ * underlying graph and walks that graph directly, skipping what is not
+ * selected:
+ *
+ *   FilteredGraph<GraphType> hot(g, [](const auto& n) {
+ *     return n.position().x > threshold;
+ *   });
+ *   BfsEngine<FilteredGraph<GraphType>> bfs(hot);
+ *
+ * The view has the interface the generic algorithms use (size(), node(i),
+ * node and incident iterators, Node::index(), Edge::node2()), so they run
+ * on the subset unchanged. Its nodes are numbered 0 .. size() - 1 in the
+ * order of their indices in the graph; that numbering is built the first
+ * time it is needed and rebuilt only after the selection changes.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace filtered_graph_detail {
+
+template <typename G, typename = void>
+struct node_value_of {
+  using type = void;
+};
+template <typename G>
+struct node_value_of<G, std::void_t<typename G::node_value_type>> {
+  using type = typename G::node_value_type;
+};
+
+} // end namespace filtered_graph_detail
+
+
+/** @class FilteredGraph
+ * @brief The subgraph of a graph induced by a selection of its nodes.
+ *
+ * Node and Edge wrap the graph's own proxies: positions and values are the
+ * graph's, and writing them through the view writes the graph. An edge is
+ * in the view when both its endpoints are.
+ *
+ * The view refers to the graph and must not outlive it. It stays valid
+ * while the graph's node indices do not change; nodes added to the graph
+ * afterwards are not selected. Building the numbering (on the first
+ * size(), node(i) or Node::index()) must not race with other calls; after
+ * that, reading the view from several threads is as safe as reading the
+ * graph.
+ *
+ * @tparam G  Graph type with size(), node(i), has_edge(), size_type and
+ *            nodes with index() and edge_begin()/edge_end().
+ */
+template <typename G>
+class FilteredGraph {
+ public:
+  using graph_type = G;
+  using size_type = typename G::size_type;
+  using base_node_type = typename G::node_type;
+  using base_edge_type = typename G::edge_type;
+  using base_incident_iterator = typename G::incident_iterator;
+  using node_value_type = typename filtered_graph_detail::node_value_of<G>::type;
+
+  class Node;
+  class Edge;
+  class NodeIterator;
+  class IncidentIterator;
+  using node_type = Node;
+  using edge_type = Edge;
+  using node_iterator = NodeIterator;
+  using incident_iterator = IncidentIterator;
+
+  /** Construct the view of the nodes n of @a g with @a keep[n.index()].
+   * @pre @a keep has at most g.size() entries; nodes past its end are not
+   *      selected
+   *
+   * Complexity: O(1) beyond moving @a keep.
+   */
+  FilteredGraph(G& g, std::vector<bool> keep)
+      : g_(&g), keep_(std::move(keep)) {
+    assert(keep_.size() <= std::size_t(g.size()));
+  }
+
+  /** Construct the view of the nodes n of @a g with @a pred(n).
+   *
+   * The predicate is evaluated once per node, here.
+   * Complexity: O(g.size()) predicate calls.
+   */
+  template <typename Pred,
+            typename = std::enable_if_t<!std::is_convertible<Pred, std::vector<bool>>::value>>
+  FilteredGraph(G& g, Pred pred) : g_(&g), keep_(std::size_t(g.size())) {
+    for (size_type i = 0; i < g.size(); ++i)
+      keep_[i] = bool(pred(g.node(i)));
+  }
+
+  /** Return the graph this is a view of. */
+  G& graph() const {
+    return *g_;
+  }
+
+  /** Return true if node @a n of the graph is selected. Complexity: O(1). */
+  bool contains(const base_node_type& n) const {
+    return selected(n.index());
+  }
+
+  /** Select or deselect node @a n of the graph.
+   *
+   * Outstanding local indices, Nodes and iterators of the view become
+   * invalid; the numbering is rebuilt when next needed.
+   * Complexity: O(1).
+   */
+  void set(const base_node_type& n, bool keep) {
+    std::size_t i = std::size_t(n.index());
+    if (i >= keep_.size())
+      keep_.resize(i + 1, false);
+    if (keep_[i] != keep) {
+      keep_[i] = keep;
+      indexed_ = false;
+      num_edges_ = npos;
+    }
+  }
+
+  /** Return the number of selected nodes.
+   * Complexity: O(g.size()) the first time after a change, O(1) after.
+   */
+  size_type size() const {
+    build_index();
+    return size_type(global_.size());
+  }
+  size_type num_nodes() const {
+    return size();
+  }
+
+  /** Return the number of edges with both endpoints selected.
+   * Complexity: O(sum of the graph degrees of the selected nodes) the first
+   * time after a change, O(1) after.
+   */
+  size_type num_edges() const {
+    if (num_edges_ == npos) {
+      std::size_t twice = 0;
+      for (auto it = node_begin(); it != node_end(); ++it)
+        twice += std::size_t((*it).degree());
+      num_edges_ = size_type(twice / 2);
+    }
+    return num_edges_;
+  }
+
+  /** Return the node with local index @a i.
+   * @pre @a i < size()
+   */
+  Node node(size_type i) const {
+    build_index();
+    assert(std::size_t(i) < global_.size());
+    return Node(this, g_->node(global_[i]));
+  }
+
+  /** Return the view's node for selected graph node @a n.
+   * @pre contains(@a n)
+   */
+  Node node(const base_node_type& n) const {
+    assert(contains(n));
+    return Node(this, n);
+  }
+
+  bool has_node(const Node& n) const {
+    return n.view_ == this && contains(n.n_);
+  }
+
+  /** Return true if nodes @a a and @a b of the view are adjacent. */
+  bool has_edge(const Node& a, const Node& b) const {
+    return g_->has_edge(a.n_, b.n_);
+  }
+
+  /** Return the local index of selected graph node index @a i.
+   * @pre The node is selected
+   */
+  size_type local(size_type i) const {
+    build_index();
+    assert(selected(i));
+    return local_[i];
+  }
+
+  /** Return the graph index of local index @a k. */
+  size_type global(size_type k) const {
+    build_index();
+    return global_[k];
+  }
+
+  /** @class FilteredGraph::Node
+   * @brief A selected node, indexed by its local index. */
+  class Node {
+   public:
+    Node() : view_(nullptr) {
+    }
+
+    /** Return the local index, in [0, view size()). */
+    size_type index() const {
+      return view_->local(n_.index());
+    }
+    /** Return the node of the underlying graph. */
+    const base_node_type& base() const {
+      return n_;
+    }
+
+    decltype(auto) position() const {
+      return n_.position();
+    }
+    decltype(auto) position() {
+      return n_.position();
+    }
+    decltype(auto) value() const {
+      return n_.value();
+    }
+    decltype(auto) value() {
+      return n_.value();
+    }
+
+    /** Return the number of incident edges whose other end is selected.
+     * Complexity: O(degree in the graph).
+     */
+    size_type degree() const {
+      size_type d = 0;
+      for (auto it = edge_begin(); it != edge_end(); ++it)
+        ++d;
+      return d;
+    }
+
+    IncidentIterator edge_begin() const {
+      return IncidentIterator(view_, n_.edge_begin(), n_.edge_end());
+    }
+    IncidentIterator edge_end() const {
+      return IncidentIterator(view_, n_.edge_end(), n_.edge_end());
+    }
+
+    bool operator==(const Node& x) const {
+      return view_ == x.view_ && n_ == x.n_;
+    }
+    bool operator!=(const Node& x) const {
+      return !(*this == x);
+    }
+    bool operator<(const Node& x) const {
+      return n_ < x.n_;
+    }
+
+   private:
+    friend class FilteredGraph;
+    const FilteredGraph* view_;
+    base_node_type n_;
+
+    Node(const FilteredGraph* view, const base_node_type& n)
+        : view_(view), n_(n) {
+    }
+  };
+
+  /** @class FilteredGraph::Edge
+   * @brief An edge of the graph between two selected nodes. */
+  class Edge {
+   public:
+    Edge() : view_(nullptr) {
+    }
+
+    Node node1() const {
+      return Node(view_, e_.node1());
+    }
+    Node node2() const {
+      return Node(view_, e_.node2());
+    }
+    /** Return the edge of the underlying graph. */
+    const base_edge_type& base() const {
+      return e_;
+    }
+
+    decltype(auto) length() const {
+      return e_.length();
+    }
+    decltype(auto) value() const {
+      return e_.value();
+    }
+    decltype(auto) value() {
+      return e_.value();
+    }
+
+    bool operator==(const Edge& x) const {
+      return view_ == x.view_ && e_ == x.e_;
+    }
+    bool operator!=(const Edge& x) const {
+      return !(*this == x);
+    }
+    bool operator<(const Edge& x) const {
+      return e_ < x.e_;
+    }
+
+   private:
+    friend class FilteredGraph;
+    const FilteredGraph* view_;
+    base_edge_type e_;
+
+    Edge(const FilteredGraph* view, const base_edge_type& e)
+        : view_(view), e_(e) {
+    }
+  };
+
+  /** @class FilteredGraph::NodeIterator
+   * @brief Forward iterator over the selected nodes, in graph index order.
+   *
+   * Walks the selection bits directly, so it needs no numbering.
+   */
+  class NodeIterator {
+   public:
+    using value_type = Node;
+    using pointer = Node*;
+    using reference = Node;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    NodeIterator() : view_(nullptr), i_(0) {
+    }
+
+    Node operator*() const {
+      return Node(view_, view_->g_->node(size_type(i_)));
+    }
+    NodeIterator& operator++() {
+      i_ = view_->next_selected(i_ + 1);
+      return *this;
+    }
+    NodeIterator operator++(int) {
+      NodeIterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    bool operator==(const NodeIterator& x) const {
+      return view_ == x.view_ && i_ == x.i_;
+    }
+    bool operator!=(const NodeIterator& x) const {
+      return !(*this == x);
+    }
+
+   private:
+    friend class FilteredGraph;
+    const FilteredGraph* view_;
+    std::size_t i_;
+
+    NodeIterator(const FilteredGraph* view, std::size_t i)
+        : view_(view), i_(i) {
+    }
+  };
+
+  NodeIterator node_begin() const {
+    return NodeIterator(this, next_selected(0));
+  }
+  NodeIterator node_end() const {
+    return NodeIterator(this, keep_.size());
+  }
+
+  /** @class FilteredGraph::IncidentIterator
+   * @brief Forward iterator over the edges of a selected node whose other
+   *        end is selected too, in the graph's incident order. */
+  class IncidentIterator {
+   public:
+    using value_type = Edge;
+    using pointer = Edge*;
+    using reference = Edge;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::input_iterator_tag;
+
+    IncidentIterator() : view_(nullptr) {
+    }
+
+    /** Return the edge, with node1() the node iterated around. */
+    Edge operator*() const {
+      return Edge(view_, *it_);
+    }
+    IncidentIterator& operator++() {
+      ++it_;
+      skip();
+      return *this;
+    }
+    bool operator==(const IncidentIterator& x) const {
+      return it_ == x.it_;
+    }
+    bool operator!=(const IncidentIterator& x) const {
+      return !(*this == x);
+    }
+
+   private:
+    friend class FilteredGraph;
+    const FilteredGraph* view_;
+    base_incident_iterator it_;
+    base_incident_iterator end_;
+
+    IncidentIterator(const FilteredGraph* view, base_incident_iterator it,
+                     base_incident_iterator end)
+        : view_(view), it_(it), end_(end) {
+      skip();
+    }
+
+    /** Advance past edges to unselected nodes. */
+    void skip() {
+      while (it_ != end_ && !view_->selected((*it_).node2().index()))
+        ++it_;
+    }
+  };
+
+ private:
+  static constexpr size_type npos = size_type(-1);
+
+  G* g_;
+  std::vector<bool> keep_;
+
+  // Local numbering: global_[k] is the graph index of local node k, and
+  // local_[i] the local index of selected graph node i. Built on demand.
+  mutable bool indexed_ = false;
+  mutable std::vector<size_type> global_;
+  mutable std::vector<size_type> local_;
+  mutable size_type num_edges_ = npos;
+
+  bool selected(size_type i) const {
+    return std::size_t(i) < keep_.size() && keep_[std::size_t(i)];
+  }
+
+  /** Return the first selected graph index at or after @a i, or the end of
+   * the selection. */
+  std::size_t next_selected(std::size_t i) const {
+    while (i < keep_.size() && !keep_[i])
+      ++i;
+    return i;
+  }
+
+  /** Number the selected nodes in graph index order, if not done yet. */
+  void build_index() const {
+    if (indexed_)
+      return;
+    global_.clear();
+    local_.assign(keep_.size(), npos);
+    for (std::size_t i = 0; i < keep_.size(); ++i) {
+      if (keep_[i]) {
+        local_[i] = size_type(global_.size());
+        global_.push_back(size_type(i));
+      }
+    }
+    indexed_ = true;
+  }
+};
+
+#endif // CME212_FILTERED_GRAPH_HPP
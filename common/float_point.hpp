@@ -0,0 +1,171 @@
+#ifndef CME212_FLOAT_POINT_HPP
+#define CME212_FLOAT_POINT_HPP
+
+/** @file float_point.hpp
+ * @brief Single precision 3D points, for graphs whose positions need not
+ *        be doubles.
+ *
+ * Point holds three doubles, 24 bytes per node. float3 holds three floats
+ * in 12 bytes and halves the memory traffic of every pass over the
+ * positions; float4 adds a fourth lane that is kept at zero, so each point
+ * is one aligned 16-byte SIMD register:
+ *
+ *   Graph<int, double, std::uint32_t, float3> g;   // see hw1/Graph-24726.hpp
+ *   g.add_node(Point(1, 2, 3));                     // rounded to floats
+ *   Point p = g.node(0).position();                 // widened back
+ *
+ * The arithmetic of Point is available on both, in float; scalars are
+ * taken as double, as by Point, so that a * 2.0 stays a float point. Both
+ * convert implicitly to and from Point, so code written against Point
+ * reads float positions unchanged and mixed arithmetic widens to Point.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <ostream>
+
+#include "CME212/Point.hpp"
+
+
+namespace float_point_detail {
+
+template <unsigned Lanes>
+struct storage;
+
+template <>
+struct storage<3> {
+  float x, y, z;
+};
+
+template <>
+struct alignas(16) storage<4> {
+  float x, y, z;
+  float w;   // always 0
+};
+
+} // end namespace float_point_detail
+
+
+/** @class float_point
+ * @brief A 3D point of floats, stored in @a Lanes lanes.
+ *
+ * @tparam Lanes  3 for packed points, 4 for 16-byte aligned ones
+ */
+template <unsigned Lanes>
+struct float_point : float_point_detail::storage<Lanes> {
+  static_assert(Lanes == 3 || Lanes == 4, "float_point has 3 or 4 lanes");
+
+  /** The origin. */
+  float_point() : float_point(0, 0, 0) {
+  }
+  /** The point (b, b, b). */
+  explicit float_point(float b) : float_point(b, b, b) {
+  }
+  /** The point (a, b, c). */
+  float_point(float a, float b, float c) : float_point_detail::storage<Lanes>() {
+    this->x = a;
+    this->y = b;
+    this->z = c;
+  }
+  /** @a p rounded to floats. */
+  float_point(const Point& p)
+      : float_point(float(p.x), float(p.y), float(p.z)) {
+  }
+
+  /** Return this point widened to doubles. */
+  operator Point() const {
+    return Point(this->x, this->y, this->z);
+  }
+
+  float& operator[](unsigned i) {
+    return i == 0 ? this->x : i == 1 ? this->y : this->z;
+  }
+  const float& operator[](unsigned i) const {
+    return i == 0 ? this->x : i == 1 ? this->y : this->z;
+  }
+
+  float_point operator-() const {
+    return float_point(-this->x, -this->y, -this->z);
+  }
+  float_point& operator+=(const float_point& b) {
+    this->x += b.x; this->y += b.y; this->z += b.z;
+    return *this;
+  }
+  float_point& operator-=(const float_point& b) {
+    this->x -= b.x; this->y -= b.y; this->z -= b.z;
+    return *this;
+  }
+  float_point& operator*=(float b) {
+    this->x *= b; this->y *= b; this->z *= b;
+    return *this;
+  }
+  float_point& operator/=(float b) {
+    this->x /= b; this->y /= b; this->z /= b;
+    return *this;
+  }
+};
+
+/** Three packed floats, 12 bytes. */
+using float3 = float_point<3>;
+/** Three floats and a zero lane, 16 bytes and 16-byte aligned. */
+using float4 = float_point<4>;
+
+template <unsigned L>
+float_point<L> operator+(float_point<L> a, const float_point<L>& b) {
+  return a += b;
+}
+template <unsigned L>
+float_point<L> operator-(float_point<L> a, const float_point<L>& b) {
+  return a -= b;
+}
+template <unsigned L>
+float_point<L> operator*(float_point<L> a, double b) {
+  return a *= float(b);
+}
+template <unsigned L>
+float_point<L> operator*(double b, float_point<L> a) {
+  return a *= float(b);
+}
+template <unsigned L>
+float_point<L> operator/(float_point<L> a, double b) {
+  return a /= float(b);
+}
+template <unsigned L>
+bool operator==(const float_point<L>& a, const float_point<L>& b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+template <unsigned L>
+bool operator!=(const float_point<L>& a, const float_point<L>& b) {
+  return !(a == b);
+}
+template <unsigned L>
+float dot(const float_point<L>& a, const float_point<L>& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+template <unsigned L>
+float inner_prod(const float_point<L>& a, const float_point<L>& b) {
+  return dot(a, b);
+}
+template <unsigned L>
+float normSq(const float_point<L>& a) {
+  return dot(a, a);
+}
+template <unsigned L>
+float norm(const float_point<L>& a) {
+  return std::sqrt(normSq(a));
+}
+template <unsigned L>
+float norm_2(const float_point<L>& a) {
+  return norm(a);
+}
+template <unsigned L>
+float_point<L> cross(const float_point<L>& a, const float_point<L>& b) {
+  return float_point<L>(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+                        a.x * b.y - a.y * b.x);
+}
+template <unsigned L>
+std::ostream& operator<<(std::ostream& s, const float_point<L>& a) {
+  return s << a.x << ' ' << a.y << ' ' << a.z;
+}
+
+#endif // CME212_FLOAT_POINT_HPP
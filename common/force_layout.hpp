@@ -0,0 +1,540 @@
+#ifndef CME212_FORCE_LAYOUT_HPP
+#define CME212_FORCE_LAYOUT_HPP
+
+/** @file force_layout.hpp
+ * @brief Force-directed graph layout: springs along the edges, and
+ *        Barnes-Hut octree repulsion between all nodes.
+ *
+ * A force-directed layout pushes every pair of nodes apart and pulls the
+ * endpoints of every edge together. Summing the repulsion over all pairs
+ * is O(N^2); following Barnes and Hut ("A hierarchical O(N log N)
+ * force-calculation algorithm", Nature 1986), ForceLayout sorts the nodes
+ * along a Morton curve, builds an octree over the sorted order, and lets a
+ * cell of width w whose center of mass is at distance r stand in for all
+ * its nodes whenever w < theta r. Each iteration
+ *
+ *   gathers the positions into x, y and z arrays, in parallel,
+ *   sorts them by Morton key and builds the octree, whose subtrees are
+ *   built in parallel,
+ *   sums the repulsion on every node by walking the tree, in Morton order
+ *   so that neighboring nodes walk the same cells, in parallel,
+ *   adds the spring forces along the edges from CSR rows, one row per node,
+ *   moves every node along its force by at most the temperature, which
+ *   cools by a constant factor every iteration, as in Fruchterman and
+ *   Reingold, and writes the positions back in place:
+ *
+ *   ForceLayout<GraphType> layout(g);            // the edges, once
+ *   for (int i = 0; i < 100; ++i)
+ *     layout_report r = layout.step(g);
+ *
+ * Repulsion between nodes p and q is repulsion / |p - q|^2 and a spring
+ * pulls its endpoints with spring * (|p - q| - rest_length), so with the
+ * defaults edges settle near unit length. Positions are best started
+ * spread out, e.g. at random: nodes at the same point feel no force from
+ * one another.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/space_filling_curve.hpp"
+#include "common/trace.hpp"
+#include "CME212/Point.hpp"
+
+
+/** Parameters of ForceLayout. */
+struct layout_options {
+  double spring = 1.0;          // spring constant of every edge
+  double rest_length = 1.0;     // length at which a spring pulls nothing
+  double repulsion = 1.0;       // repulsion of two nodes at distance 1
+  double theta = 0.8;           // opening angle: smaller is more exact
+  double temperature = 1.0;     // largest move of the first iteration
+  double cooling = 0.95;        // temperature factor per iteration
+  unsigned leaf_size = 16;      // nodes a cell holds before it is split
+  unsigned threads = 0;         // 0 means all cores
+};
+
+/** What one step() did. */
+struct layout_report {
+  std::uint64_t iterations = 0;
+  std::uint64_t nodes = 0;
+  std::uint64_t cells = 0;          // octree cells of the last iteration
+  std::uint64_t interactions = 0;   // node-node and node-cell terms summed
+  double max_move = 0;              // longest move of the last iteration
+  double build_seconds = 0;         // sorting and building the octrees
+  double seconds = 0;               // wall time of step()
+};
+
+
+namespace force_layout_detail {
+
+template <typename G, typename = void>
+struct has_positions_data : std::false_type {};
+template <typename G>
+struct has_positions_data<G, std::enable_if_t<std::is_convertible<
+    decltype(std::declval<G&>().positions_data()), Point*>::value>>
+    : std::true_type {};
+
+template <typename G, typename = void>
+struct has_change_tracking : std::false_type {};
+template <typename G>
+struct has_change_tracking<G, std::void_t<
+    decltype(std::declval<G&>().mark_positions_changed(0, 0)),
+    decltype(std::declval<G&>().invalidate_edge_cache())>> : std::true_type {};
+
+/** One octree cube: its nodes are [first, last) of the Morton order. */
+struct cell {
+  double com[3];               // center of mass
+  double mass;                 // number of nodes
+  double width;                // side of the cube
+  std::uint32_t first, last;
+  std::int32_t child[8];       // cell indices, -1 for an empty octant
+  bool leaf;
+};
+
+} // end namespace force_layout_detail
+
+
+/** @class ForceLayout
+ * @brief Moves the nodes of a graph toward a force-directed layout.
+ *
+ * Keeps the edges of the graph it is built from, as CSR rows of neighbor
+ * indices; rebuild it after the edges change. Positions may change freely
+ * between steps. Graphs with positions_data() (hw1/Graph-24726.hpp) are
+ * read and written in place, in parallel, and told of the moves with
+ * mark_positions_changed() and invalidate_edge_cache(); others are read
+ * and written through node(i).position() on the calling thread.
+ *
+ * @tparam G  Graph type with size(), the incident iterators, size_type,
+ *            and either positions_data() or a node(i).position() that can
+ *            be assigned to.
+ */
+template <typename G>
+class ForceLayout {
+ public:
+  /** Record the edges of @a g. Complexity: O(g.size() + g.num_edges()). */
+  explicit ForceLayout(const G& g, const layout_options& opt = layout_options())
+      : opt_(opt), temperature_(opt.temperature) {
+    assert(opt.leaf_size > 0 && opt.theta >= 0);
+    threads_ = csr_snapshot::thread_count(opt.threads);
+    offsets_ = csr_snapshot::row_offsets(g, threads_);
+    neighbors_.resize(offsets_.back());
+    csr_snapshot::fill_neighbors(g, offsets_, threads_, neighbors_.data());
+  }
+
+  /** Return the largest move of the next iteration. */
+  double temperature() const {
+    return temperature_;
+  }
+
+  /** Set the temperature, e.g. to reheat a layout after the graph grew. */
+  void set_temperature(double t) {
+    temperature_ = t;
+  }
+
+  /** Return the octree cells of the last iteration. */
+  const std::vector<force_layout_detail::cell>& cells() const {
+    return cells_;
+  }
+
+  /**
+   * Run @a iterations iterations on the positions of @a g.
+   * @pre g.size() is the node count the layout was built for
+   *
+   * Complexity: O(N log N) per iteration for N nodes spread evenly, plus
+   * O(num_edges()), spread over the threads.
+   */
+  layout_report step(G& g, unsigned iterations = 1) {
+    CME212_TRACE_SCOPE_N("force_layout", std::size_t(g.size()) * iterations);
+    auto start = std::chrono::steady_clock::now();
+    std::size_t n = std::size_t(g.size());
+    assert(n + 1 == offsets_.size());
+    layout_report report;
+    report.nodes = n;
+    if (n == 0)
+      return report;
+
+    gather(g);
+    for (unsigned it = 0; it < iterations; ++it) {
+      auto built = std::chrono::steady_clock::now();
+      sort_nodes();
+      build_tree();
+      report.build_seconds += std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - built).count();
+      report.interactions += repel();
+      attract();
+      report.max_move = move();
+      temperature_ *= opt_.cooling;
+      ++report.iterations;
+    }
+    scatter(g);
+    report.cells = cells_.size();
+    report.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return report;
+  }
+
+ private:
+  using cell = force_layout_detail::cell;
+
+  layout_options opt_;
+  unsigned threads_;
+  double temperature_;
+  std::vector<std::size_t> offsets_;
+  std::vector<std::uint32_t> neighbors_;
+
+  // Positions and forces by node index
+  std::vector<double> x_[3];
+  std::vector<double> f_[3];
+  // The nodes in Morton order, their keys, and their positions in it
+  std::vector<std::pair<std::uint64_t, std::uint32_t>> keyed_;
+  std::vector<double> s_[3];
+  std::vector<cell> cells_;
+
+  // Cube of the Morton keys: corner and width
+  double lo_[3] = {0, 0, 0};
+  double width_ = 0;
+
+  /** Copy the positions of @a g into x_. */
+  void gather(const G& g) {
+    std::size_t n = std::size_t(g.size());
+    for (int a = 0; a < 3; ++a) {
+      x_[a].resize(n);
+      f_[a].resize(n);
+      s_[a].resize(n);
+    }
+    if constexpr (force_layout_detail::has_positions_data<G>::value) {
+      const Point* p = g.positions_data();
+      csr_snapshot::parallel_ranges(threads_, n, 1 << 14,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t i = b; i < e; ++i) {
+              x_[0][i] = p[i].x;
+              x_[1][i] = p[i].y;
+              x_[2][i] = p[i].z;
+            }
+          });
+    } else {
+      for (std::size_t i = 0; i < n; ++i) {
+        const Point& p = g.node(typename G::size_type(i)).position();
+        x_[0][i] = p.x;
+        x_[1][i] = p.y;
+        x_[2][i] = p.z;
+      }
+    }
+  }
+
+  /** Write x_ back to the positions of @a g. */
+  void scatter(G& g) {
+    std::size_t n = x_[0].size();
+    if constexpr (force_layout_detail::has_positions_data<G>::value) {
+      Point* p = g.positions_data();
+      csr_snapshot::parallel_ranges(threads_, n, 1 << 14,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t i = b; i < e; ++i)
+              p[i] = Point(x_[0][i], x_[1][i], x_[2][i]);
+          });
+      if constexpr (force_layout_detail::has_change_tracking<G>::value) {
+        g.mark_positions_changed(0, typename G::size_type(n));
+        g.invalidate_edge_cache();
+      }
+    } else {
+      for (std::size_t i = 0; i < n; ++i)
+        g.node(typename G::size_type(i)).position() =
+            Point(x_[0][i], x_[1][i], x_[2][i]);
+    }
+  }
+
+  /** Fit the key cube to x_, order the nodes by Morton key into keyed_,
+   * and copy their positions in that order into s_. */
+  void sort_nodes() {
+    std::size_t n = x_[0].size();
+    std::vector<double> lo(3 * threads_, HUGE_VAL), hi(3 * threads_, -HUGE_VAL);
+    csr_snapshot::parallel_ranges(threads_, n, 1 << 14,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for (int a = 0; a < 3; ++a) {
+            for (std::size_t i = b; i < e; ++i) {
+              lo[3 * t + a] = std::min(lo[3 * t + a], x_[a][i]);
+              hi[3 * t + a] = std::max(hi[3 * t + a], x_[a][i]);
+            }
+          }
+        });
+    double h[3];
+    for (int a = 0; a < 3; ++a) {
+      lo_[a] = lo[a];
+      h[a] = hi[a];
+      for (unsigned t = 1; t < threads_; ++t) {
+        lo_[a] = std::min(lo_[a], lo[3 * t + a]);
+        h[a] = std::max(h[a], hi[3 * t + a]);
+      }
+    }
+    width_ = std::max({h[0] - lo_[0], h[1] - lo_[1], h[2] - lo_[2]});
+    double scale = width_ > 0 ? double((1u << sfc::bits) - 1) / width_ : 0;
+
+    keyed_.resize(n);
+    csr_snapshot::parallel_ranges(threads_, n, 1 << 14,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i) {
+            std::uint32_t q[3];
+            for (int a = 0; a < 3; ++a)
+              q[a] = std::uint32_t((x_[a][i] - lo_[a]) * scale);
+            keyed_[i] = {sfc::morton_key(q[0], q[1], q[2]), std::uint32_t(i)};
+          }
+        });
+
+    // Sort one run per thread, then merge runs pairwise
+    unsigned runs = unsigned(std::min<std::size_t>(threads_, n));
+    auto bound = [&](std::size_t r) { return n * r / runs; };
+    csr_snapshot::parallel_ranges(threads_, runs, 1,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t r = b; r < e; ++r)
+            std::sort(keyed_.begin() + bound(r), keyed_.begin() + bound(r + 1));
+        });
+    for (std::size_t width = 1; width < runs; width *= 2) {
+      std::size_t pairs = (runs + 2 * width - 1) / (2 * width);
+      csr_snapshot::parallel_ranges(threads_, pairs, 1,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t p = b; p < e; ++p) {
+              std::size_t r = 2 * width * p;
+              if (r + width >= runs)
+                continue;
+              std::inplace_merge(keyed_.begin() + bound(r),
+                                 keyed_.begin() + bound(r + width),
+                                 keyed_.begin() + bound(std::min<std::size_t>(
+                                     runs, r + 2 * width)));
+            }
+          });
+    }
+
+    csr_snapshot::parallel_ranges(threads_, n, 1 << 14,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t k = b; k < e; ++k)
+            for (int a = 0; a < 3; ++a)
+              s_[a][k] = x_[a][keyed_[k].second];
+        });
+  }
+
+  /** Octant of Morton key @a key at tree depth @a level. */
+  static unsigned octant(std::uint64_t key, unsigned level) {
+    return unsigned(key >> (3 * (sfc::bits - 1 - level))) & 7u;
+  }
+
+  /** A subtree left for a worker: nodes [first, last) at depth level,
+   * to hang from child slot slot of cell parent. */
+  struct subtree {
+    std::uint32_t first, last;
+    unsigned level;
+    std::int32_t parent;
+    unsigned slot;
+  };
+
+  /** Add the cell of nodes [@a b, @a e) at depth @a level, and its
+   * descendants, to @a out; return its index there. Ranges of fewer than
+   * @a spawn nodes below the root are left to @a tasks, when given. */
+  std::int32_t build(std::vector<cell>& out, std::uint32_t b, std::uint32_t e,
+                     unsigned level, std::vector<subtree>* tasks,
+                     std::size_t spawn) const {
+    std::int32_t self = std::int32_t(out.size());
+    out.push_back(cell());
+    cell c = cell();
+    c.first = b;
+    c.last = e;
+    c.width = std::ldexp(width_, -int(level));
+    c.mass = double(e - b);
+    std::fill(c.child, c.child + 8, -1);
+    c.leaf = e - b <= opt_.leaf_size || level == sfc::bits;
+    if (c.leaf) {
+      for (std::uint32_t k = b; k < e; ++k)
+        for (int a = 0; a < 3; ++a)
+          c.com[a] += s_[a][k];
+    } else {
+      std::uint32_t lo = b;
+      for (unsigned o = 0; o < 8 && lo < e; ++o) {
+        std::uint32_t hi = std::uint32_t(std::partition_point(
+            keyed_.begin() + lo, keyed_.begin() + e,
+            [&](const std::pair<std::uint64_t, std::uint32_t>& k) {
+              return octant(k.first, level) <= o;
+            }) - keyed_.begin());
+        if (hi == lo)
+          continue;
+        if (tasks && hi - lo < spawn) {
+          tasks->push_back({lo, hi, level + 1, self, o});
+        } else {
+          std::int32_t child = build(out, lo, hi, level + 1, tasks, spawn);
+          c.child[o] = child;
+        }
+        lo = hi;
+      }
+    }
+    out[self] = c;
+    return self;
+  }
+
+  /** Fill in the center of mass of cell @a i of @a out from its children,
+   * or, for a leaf, from the coordinate sums build() left in it. */
+  static void finish(std::vector<cell>& out, std::int32_t i) {
+    cell& c = out[i];
+    if (!c.leaf) {
+      for (int a = 0; a < 3; ++a)
+        c.com[a] = 0;
+      for (std::int32_t child : c.child) {
+        if (child < 0)
+          continue;
+        for (int a = 0; a < 3; ++a)
+          c.com[a] += out[child].com[a] * out[child].mass;
+      }
+    }
+    for (int a = 0; a < 3; ++a)
+      c.com[a] /= c.mass;
+  }
+
+  /** Build the octree of keyed_ into cells_: the top levels here, and
+   * every subtree of fewer than n / (8 threads) nodes on a worker. */
+  void build_tree() {
+    std::uint32_t n = std::uint32_t(keyed_.size());
+    std::vector<subtree> tasks;
+    std::size_t spawn = threads_ > 1 ? std::max<std::size_t>(
+        n / (8 * threads_), opt_.leaf_size + 1) : 0;
+    cells_.clear();
+    build(cells_, 0, n, 0, threads_ > 1 ? &tasks : nullptr, spawn);
+    std::size_t top = cells_.size();
+
+    std::vector<std::vector<cell>> parts(tasks.size());
+    csr_snapshot::parallel_ranges(threads_, tasks.size(), 1,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t t = b; t < e; ++t) {
+            build(parts[t], tasks[t].first, tasks[t].last, tasks[t].level,
+                  nullptr, 0);
+            // Children follow their parents, so finish them last first
+            for (std::size_t i = parts[t].size(); i-- > 0;)
+              finish(parts[t], std::int32_t(i));
+          }
+        });
+
+    // Append the subtrees and link each root to its parent
+    for (std::size_t t = 0; t < tasks.size(); ++t) {
+      std::int32_t base = std::int32_t(cells_.size());
+      for (cell c : parts[t]) {
+        for (std::int32_t& child : c.child)
+          if (child >= 0)
+            child += base;
+        cells_.push_back(c);
+      }
+      cells_[tasks[t].parent].child[tasks[t].slot] = base;
+    }
+    for (std::size_t i = top; i-- > 0;)
+      finish(cells_, std::int32_t(i));
+  }
+
+  /** Set f_ to the repulsion on every node. Return the terms summed. */
+  std::uint64_t repel() {
+    std::size_t n = keyed_.size();
+    const double eps2 = 1e-4 * opt_.rest_length * opt_.rest_length;
+    const double theta2 = opt_.theta * opt_.theta;
+    std::vector<std::uint64_t> terms(threads_, 0);
+    csr_snapshot::parallel_ranges(threads_, n, 256,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          std::vector<std::int32_t> stack;
+          std::uint64_t count = 0;
+          for (std::size_t k = b; k < e; ++k) {
+            double p[3] = {s_[0][k], s_[1][k], s_[2][k]};
+            double f[3] = {0, 0, 0};
+            stack.assign(1, 0);
+            while (!stack.empty()) {
+              const cell& c = cells_[stack.back()];
+              stack.pop_back();
+              bool inside = c.first <= k && k < c.last;
+              double d[3] = {p[0] - c.com[0], p[1] - c.com[1], p[2] - c.com[2]};
+              double r2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+              if (!inside && c.width * c.width < theta2 * r2) {
+                add_repulsion(f, d, r2 + eps2, c.mass);
+                ++count;
+              } else if (c.leaf) {
+                for (std::uint32_t j = c.first; j < c.last; ++j) {
+                  if (j == k)
+                    continue;
+                  double q[3] = {p[0] - s_[0][j], p[1] - s_[1][j],
+                                 p[2] - s_[2][j]};
+                  add_repulsion(f, q, q[0] * q[0] + q[1] * q[1] +
+                                      q[2] * q[2] + eps2, 1.0);
+                }
+                count += c.last - c.first - (inside ? 1 : 0);
+              } else {
+                for (std::int32_t child : c.child)
+                  if (child >= 0)
+                    stack.push_back(child);
+              }
+            }
+            std::uint32_t i = keyed_[k].second;
+            for (int a = 0; a < 3; ++a)
+              f_[a][i] = f[a];
+          }
+          terms[t] = count;
+        });
+    std::uint64_t total = 0;
+    for (std::uint64_t c : terms)
+      total += c;
+    return total;
+  }
+
+  /** Add the repulsion of @a mass nodes at offset -@a d, |d|^2 = @a r2. */
+  void add_repulsion(double* f, const double* d, double r2, double mass) const {
+    double s = opt_.repulsion * mass / (r2 * std::sqrt(r2));
+    for (int a = 0; a < 3; ++a)
+      f[a] += s * d[a];
+  }
+
+  /** Add the spring forces along the edges to f_. */
+  void attract() {
+    std::size_t n = x_[0].size();
+    csr_snapshot::parallel_ranges(threads_, n, 1024,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i) {
+            double f[3] = {0, 0, 0};
+            for (std::size_t k = offsets_[i]; k < offsets_[i + 1]; ++k) {
+              std::uint32_t j = neighbors_[k];
+              double d[3] = {x_[0][j] - x_[0][i], x_[1][j] - x_[1][i],
+                             x_[2][j] - x_[2][i]};
+              double len = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+              if (len == 0)
+                continue;
+              double s = opt_.spring * (len - opt_.rest_length) / len;
+              for (int a = 0; a < 3; ++a)
+                f[a] += s * d[a];
+            }
+            for (int a = 0; a < 3; ++a)
+              f_[a][i] += f[a];
+          }
+        });
+  }
+
+  /** Move every node along f_ by at most the temperature. Return the
+   * longest move. */
+  double move() {
+    std::size_t n = x_[0].size();
+    std::vector<double> longest(threads_, 0);
+    csr_snapshot::parallel_ranges(threads_, n, 1 << 14,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i) {
+            double len = std::sqrt(f_[0][i] * f_[0][i] + f_[1][i] * f_[1][i] +
+                                   f_[2][i] * f_[2][i]);
+            if (!(len > 0))
+              continue;
+            double step = std::min(len, temperature_);
+            for (int a = 0; a < 3; ++a)
+              x_[a][i] += f_[a][i] / len * step;
+            longest[t] = std::max(longest[t], step);
+          }
+        });
+    return *std::max_element(longest.begin(), longest.end());
+  }
+};
+
+#endif // CME212_FORCE_LAYOUT_HPP
@@ -0,0 +1,397 @@
+#ifndef CME212_GRAPH_DIFF_HPP
+#define CME212_GRAPH_DIFF_HPP
+
+/** @file graph_diff.hpp
+ * @brief The difference between two states of a graph, and applying it to
+ *        a replica so that it catches up without a full copy.
+ *
+ * Keeping a replica in sync by shipping the whole graph after every change
+ * costs the size of the graph however little changed. diff() instead finds
+ * the nodes and edges that were added or removed and the positions and
+ * values that changed, and apply() replays exactly those on the receiver:
+ *
+ *   // Sender, holding the state the replica last saw
+ *   graph_diff<GraphType> d = diff(last_sent, g);
+ *   ship(d);
+ *   last_sent = g;
+ *   // Receiver
+ *   apply(replica, d);                   // replica now equals g
+ *
+ * Nodes are matched by index and edges by their canonical key, the pair
+ * (smaller endpoint index, larger endpoint index). Both graphs' keys are
+ * sorted once and merged, so diff() takes O(E log E) for E edges. When the
+ * graphs have topology_version() and it is the same for both, one is a
+ * copy of the other with no node or edge added or removed since, and diff()
+ * skips the keys and compares positions and values in one pass.
+ *
+ * Removals that renumber nodes, such as Graph::remove_node() moving the
+ * last node into the hole, show up as changed positions and values at the
+ * hole and edges removed and added there: apply() still produces the new
+ * graph, but the diff is larger than the removal.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace graph_diff_detail {
+
+template <typename G, typename = void>
+struct has_topology_version : std::false_type {};
+template <typename G>
+struct has_topology_version<G, std::void_t<decltype(std::declval<const G&>().topology_version())>>
+    : std::true_type {};
+
+template <typename G, typename = void>
+struct has_node_value : std::false_type {};
+template <typename G>
+struct has_node_value<G, std::void_t<decltype(std::declval<const typename G::node_type&>().value())>>
+    : std::true_type {};
+
+template <typename G, typename = void>
+struct has_edge_value : std::false_type {};
+template <typename G>
+struct has_edge_value<G, std::void_t<decltype(std::declval<const typename G::edge_type&>().value())>>
+    : std::true_type {};
+
+/** Stands in for the value of a graph without node or edge values. */
+struct no_value {
+  bool operator==(const no_value&) const {
+    return true;
+  }
+};
+
+template <typename G, bool = has_node_value<G>::value>
+struct node_value {
+  using type = no_value;
+};
+template <typename G>
+struct node_value<G, true> {
+  using type = std::decay_t<decltype(std::declval<const typename G::node_type&>().value())>;
+};
+
+template <typename G, bool = has_edge_value<G>::value>
+struct edge_value {
+  using type = no_value;
+};
+template <typename G>
+struct edge_value<G, true> {
+  using type = std::decay_t<decltype(std::declval<const typename G::edge_type&>().value())>;
+};
+
+} // end namespace graph_diff_detail
+
+
+/** @struct graph_diff
+ * @brief What turns one state of a graph into another: diff(a, b) applied
+ *        to a graph equal to @a a leaves it equal to @a b.
+ *
+ * Node indices below old_nodes refer to both states; nodes at old_nodes and
+ * beyond are added, and nodes at new_nodes and beyond, if new_nodes is the
+ * smaller, are removed together with their edges. Edge lists are sorted by
+ * canonical key, (smaller index, larger index).
+ *
+ * @tparam G  Graph type the diff was taken of. Graphs without node or edge
+ *            values get no_value in their place.
+ */
+template <typename G>
+struct graph_diff {
+  using size_type = typename G::size_type;
+  using point_type = std::decay_t<decltype(std::declval<const typename G::node_type&>().position())>;
+  using node_value_type = typename graph_diff_detail::node_value<G>::type;
+  using edge_value_type = typename graph_diff_detail::edge_value<G>::type;
+
+  /** A node whose position or value is set. */
+  struct node_entry {
+    size_type index;
+    point_type position;
+    node_value_type value;
+  };
+  /** An edge with its key and value. */
+  struct edge_entry {
+    size_type a;            // smaller endpoint index
+    size_type b;            // larger endpoint index
+    edge_value_type value;
+  };
+
+  /** Topology versions of the two states, 0 for graphs without them. A
+   * receiver that records the last to_version it applied can tell whether
+   * a diff continues from its state. */
+  std::uint64_t from_version = 0;
+  std::uint64_t to_version = 0;
+  /** Node counts of the two states. */
+  size_type old_nodes = 0;
+  size_type new_nodes = 0;
+
+  /** Nodes old_nodes, old_nodes + 1, ..., in index order. */
+  std::vector<node_entry> added_nodes;
+  /** Kept nodes whose position or value differs, in index order. */
+  std::vector<node_entry> changed_nodes;
+  /** Edges of the old state only, both ends below new_nodes: the edges of
+   * removed nodes go with them and are not listed. */
+  std::vector<std::pair<size_type, size_type>> removed_edges;
+  /** Edges of the new state only. */
+  std::vector<edge_entry> added_edges;
+  /** Edges of both states whose value differs. */
+  std::vector<edge_entry> changed_edges;
+
+  /** Return true if the two states are equal. */
+  bool empty() const {
+    return old_nodes == new_nodes && added_nodes.empty() &&
+           changed_nodes.empty() && removed_edges.empty() &&
+           added_edges.empty() && changed_edges.empty();
+  }
+
+  /** Return the number of nodes removed. */
+  size_type removed_nodes() const {
+    return old_nodes > new_nodes ? old_nodes - new_nodes : 0;
+  }
+};
+
+
+namespace graph_diff_detail {
+
+/** An edge by canonical key, with its position in the edge iteration. */
+template <typename S>
+struct keyed_edge {
+  S a;
+  S b;
+  std::size_t edge;
+
+  bool operator<(const keyed_edge& x) const {
+    return a < x.a || (a == x.a && b < x.b);
+  }
+};
+
+/** Return the edges of @a g sorted by canonical key, and the edges
+ * themselves in iteration order into @a edges. */
+template <typename G>
+std::vector<keyed_edge<typename G::size_type>>
+sorted_keys(const G& g, std::vector<typename G::edge_type>& edges) {
+  using S = typename G::size_type;
+  std::vector<keyed_edge<S>> keys;
+  keys.reserve(std::size_t(g.num_edges()));
+  edges.reserve(std::size_t(g.num_edges()));
+  for (auto it = g.edge_begin(); it != g.edge_end(); ++it) {
+    auto e = *it;
+    S i = e.node1().index();
+    S j = e.node2().index();
+    keys.push_back({std::min(i, j), std::max(i, j), edges.size()});
+    edges.push_back(e);
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+template <typename G>
+typename edge_value<G>::type value_of(const typename G::edge_type& e) {
+  if constexpr (has_edge_value<G>::value)
+    return e.value();
+  else
+    return no_value();
+}
+
+template <typename G>
+typename node_value<G>::type value_of(const typename G::node_type& n) {
+  if constexpr (has_node_value<G>::value)
+    return n.value();
+  else
+    return no_value();
+}
+
+/** Return the edge between nodes @a a and @a b of @a g, found in @a a's
+ * incident edges. @throws std::runtime_error if there is none */
+template <typename G>
+typename G::edge_type find_edge(G& g, typename G::size_type a,
+                                typename G::size_type b) {
+  auto u = g.node(a);
+  for (auto it = u.edge_begin(); it != u.edge_end(); ++it)
+    if ((*it).node2().index() == b)
+      return *it;
+  throw std::runtime_error("apply: the graph has no edge (" +
+                           std::to_string(a) + ", " + std::to_string(b) +
+                           ") to change");
+}
+
+} // end namespace graph_diff_detail
+
+
+/** Return the diff that turns @a g_old into @a g_new.
+ * @pre Both graphs' edge values and nodes' values, if any, have operator==
+ *
+ * With parallel edges, edges of one key are matched in the order the edge
+ * iterators reach them.
+ *
+ * Complexity: O(N + E log E) for N nodes and E edges of the two graphs;
+ * O(N + E) if both have the same topology_version().
+ */
+template <typename G>
+graph_diff<G> diff(const G& g_old, const G& g_new) {
+  using namespace graph_diff_detail;
+  using S = typename G::size_type;
+  graph_diff<G> d;
+  if constexpr (has_topology_version<G>::value) {
+    d.from_version = g_old.topology_version();
+    d.to_version = g_new.topology_version();
+  }
+  d.old_nodes = g_old.num_nodes();
+  d.new_nodes = g_new.num_nodes();
+
+  S kept = std::min(d.old_nodes, d.new_nodes);
+  for (S i = 0; i < kept; ++i) {
+    auto u = g_old.node(i);
+    auto v = g_new.node(i);
+    if (!(u.position() == v.position()) ||
+        !(value_of<G>(u) == value_of<G>(v)))
+      d.changed_nodes.push_back({i, v.position(), value_of<G>(v)});
+  }
+  for (S i = kept; i < d.new_nodes; ++i) {
+    auto v = g_new.node(i);
+    d.added_nodes.push_back({i, v.position(), value_of<G>(v)});
+  }
+
+  bool same_topology = false;
+  if constexpr (has_topology_version<G>::value)
+    same_topology = d.from_version == d.to_version;
+  if (same_topology) {
+    // One graph is an unchanged copy of the other, so both iterate the same
+    // edges in the same order and only their values can differ
+    auto jt = g_new.edge_begin();
+    for (auto it = g_old.edge_begin(); it != g_old.edge_end(); ++it, ++jt) {
+      auto e = *jt;
+      if (!(value_of<G>(*it) == value_of<G>(e))) {
+        S i = e.node1().index();
+        S j = e.node2().index();
+        d.changed_edges.push_back({std::min(i, j), std::max(i, j),
+                                   value_of<G>(e)});
+      }
+    }
+    std::sort(d.changed_edges.begin(), d.changed_edges.end(),
+              [](const auto& x, const auto& y) {
+                return x.a < y.a || (x.a == y.a && x.b < y.b);
+              });
+    return d;
+  }
+
+  std::vector<typename G::edge_type> old_edges, new_edges;
+  auto old_keys = sorted_keys(g_old, old_edges);
+  auto new_keys = sorted_keys(g_new, new_edges);
+  std::size_t p = 0, q = 0;
+  while (p < old_keys.size() || q < new_keys.size()) {
+    if (q == new_keys.size() ||
+        (p < old_keys.size() && old_keys[p] < new_keys[q])) {
+      const auto& k = old_keys[p++];
+      if (k.b < d.new_nodes)
+        d.removed_edges.emplace_back(k.a, k.b);
+    } else if (p == old_keys.size() || new_keys[q] < old_keys[p]) {
+      const auto& k = new_keys[q++];
+      d.added_edges.push_back({k.a, k.b, value_of<G>(new_edges[k.edge])});
+    } else {
+      const auto& k = new_keys[q++];
+      const auto& o = old_keys[p++];
+      auto value = value_of<G>(new_edges[k.edge]);
+      if (!(value_of<G>(old_edges[o.edge]) == value))
+        d.changed_edges.push_back({k.a, k.b, value});
+    }
+  }
+  return d;
+}
+
+/** Return true if @a a and @a b have the same nodes, positions, edges and
+ * values, i.e. diff(a, b).empty().
+ *
+ * Complexity: O(N) if the node counts differ, else that of diff().
+ */
+template <typename G>
+bool equal(const G& a, const G& b) {
+  if (a.num_nodes() != b.num_nodes() || a.num_edges() != b.num_edges())
+    return false;
+  return diff(a, b).empty();
+}
+
+
+/** What apply() did. */
+struct graph_diff_report {
+  std::size_t nodes_added = 0;
+  std::size_t nodes_removed = 0;
+  std::size_t nodes_changed = 0;
+  std::size_t edges_added = 0;
+  std::size_t edges_removed = 0;
+  std::size_t edges_changed = 0;
+};
+
+/** Apply @a d to @a g, which must equal the state @a d was taken from.
+ * @return The counts of what changed
+ * @throws std::runtime_error if @a g does not have d.old_nodes nodes, or
+ *         misses an edge the diff removes or changes. @a g may be partly
+ *         updated then.
+ * @post If @a g equaled the old state, it equals the new one
+ *
+ * Removes edges, then the trailing nodes, whose removal renumbers nothing,
+ * then sets positions and values, adds the nodes and finally the edges.
+ * Uses remove_edge(Node, Node), remove_node() and add_node(position, value)
+ * and add_edge(a, b, value) where the graph has values.
+ *
+ * Complexity: O(D * d) for a diff of D entries and degrees bounded by d,
+ * plus the cost of the graph's own calls.
+ */
+template <typename G>
+graph_diff_report apply(G& g, const graph_diff<G>& d) {
+  using namespace graph_diff_detail;
+  using S = typename G::size_type;
+  if (g.num_nodes() != d.old_nodes)
+    throw std::runtime_error("apply: the graph has " +
+                             std::to_string(g.num_nodes()) +
+                             " nodes, the diff starts from " +
+                             std::to_string(d.old_nodes));
+  graph_diff_report r;
+
+  for (const auto& k : d.removed_edges) {
+    if (!g.remove_edge(g.node(k.first), g.node(k.second)))
+      throw std::runtime_error("apply: the graph has no edge (" +
+                               std::to_string(k.first) + ", " +
+                               std::to_string(k.second) + ") to remove");
+    ++r.edges_removed;
+  }
+  for (S i = d.old_nodes; i > d.new_nodes; --i, ++r.nodes_removed)
+    g.remove_node(g.node(i - 1));
+
+  for (const auto& n : d.changed_nodes) {
+    auto u = g.node(n.index);
+    u.position() = n.position;
+    if constexpr (has_node_value<G>::value)
+      u.value() = n.value;
+    ++r.nodes_changed;
+  }
+  for (const auto& n : d.added_nodes) {
+    assert(n.index == g.num_nodes());
+    if constexpr (has_node_value<G>::value)
+      g.add_node(n.position, n.value);
+    else
+      g.add_node(n.position);
+    ++r.nodes_added;
+  }
+
+  for (const auto& e : d.added_edges) {
+    if constexpr (has_edge_value<G>::value)
+      g.add_edge(g.node(e.a), g.node(e.b), e.value);
+    else
+      g.add_edge(g.node(e.a), g.node(e.b));
+    ++r.edges_added;
+  }
+  for (const auto& e : d.changed_edges) {
+    if constexpr (has_edge_value<G>::value)
+      find_edge(g, e.a, e.b).value() = e.value;
+    ++r.edges_changed;
+  }
+  return r;
+}
+
+#endif // CME212_GRAPH_DIFF_HPP
@@ -0,0 +1,490 @@
+#ifndef CME212_GRAPH_GENERATORS_HPP
+#define CME212_GRAPH_GENERATORS_HPP
+
+/** @file graph_generators.hpp
+ * @brief Parallel generators for lattice, random geometric, Erdos-Renyi and
+ *        R-MAT test graphs.
+ *
+ * Each generator appends its nodes and edges to an existing graph:
+ *
+ *   Graph<int> g;
+ *   grid_graph(g, 1000, 1000);                // 2D lattice, 1e6 nodes
+ *   rmat_graph(g, 20, 16 << 20);              // power law, 2^20 nodes
+ *
+ * The positions and the endpoint pairs are computed on several threads
+ * straight into one buffer each, which then goes to the graph in one
+ * add_nodes() and one add_edges() call when the graph has them (see
+ * hw1/Graph-24726.hpp), and one call per element otherwise.
+ *
+ * Random draws come from a counter-based generator keyed by the seed and
+ * the element number, so a seed yields the same graph whatever the number
+ * of threads.
+ *
+ * build_knn_graph() and build_radius_graph() do the same for given points,
+ * such as a scanned point cloud, joining each to its nearest neighbors or to
+ * every point within a radius. Their neighbor queries go to a SpatialIndex
+ * in parallel, one point per query, instead of comparing all pairs.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/spatial_index.hpp"
+#include "CME212/Point.hpp"
+
+
+/** Tuning knobs shared by the generators. */
+struct generator_options {
+  /** Threads for generating. 0 means std::thread::hardware_concurrency(). */
+  unsigned threads = 0;
+  /** Seed of the random generators. */
+  std::uint64_t seed = 212;
+};
+
+/** What a generator added and how fast. */
+struct generator_report {
+  std::uint64_t nodes = 0;    // nodes added
+  std::uint64_t edges = 0;    // distinct new edges added
+  double seconds = 0;         // wall time, including adding to the graph
+};
+
+/** Quadrant probabilities of rmat_graph(); the fourth one is
+ * 1 - a - b - c. The defaults are those of the Graph500 benchmark. */
+struct rmat_params {
+  double a = 0.57;
+  double b = 0.19;
+  double c = 0.19;
+};
+
+
+namespace graph_generators_detail {
+
+/** Return a well-mixed 64-bit hash of @a x (the splitmix64 finalizer). */
+inline std::uint64_t mix(std::uint64_t x) {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+/** Random stream of one element: splitmix64 seeded by the generator seed,
+ * a salt naming the purpose and the element number. */
+class element_rng {
+ public:
+  element_rng(std::uint64_t seed, std::uint64_t salt, std::uint64_t k)
+      : state_(mix(seed ^ mix(salt ^ mix(k)))) {
+  }
+
+  std::uint64_t next() {
+    state_ += 0x9E3779B97F4A7C15ull;
+    std::uint64_t x = state_;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+  }
+
+  /** Return a double uniform in [0, 1). */
+  double uniform() {
+    return double(next() >> 11) * 0x1.0p-53;
+  }
+
+  /** Return an integer uniform in [0, @a n). */
+  std::uint64_t below(std::uint64_t n) {
+    return std::uint64_t((unsigned __int128)next() * n >> 64);
+  }
+
+ private:
+  std::uint64_t state_;
+};
+
+// Salts that keep the streams of positions and edges apart
+constexpr std::uint64_t position_salt = 1;
+constexpr std::uint64_t edge_salt = 2;
+
+template <typename G, typename It, typename = void>
+struct has_add_nodes : std::false_type {};
+template <typename G, typename It>
+struct has_add_nodes<G, It, decltype(void(std::declval<G&>().add_nodes(
+    std::declval<It>(), std::declval<It>())))> : std::true_type {};
+
+template <typename G, typename It, typename = void>
+struct has_add_edges : std::false_type {};
+template <typename G, typename It>
+struct has_add_edges<G, It, decltype(void(std::declval<G&>().add_edges(
+    std::declval<It>(), std::declval<It>())))> : std::true_type {};
+
+template <typename G>
+void add_points(G& g, const std::vector<Point>& points) {
+  if constexpr (has_add_nodes<G, std::vector<Point>::const_iterator>::value) {
+    g.add_nodes(points.cbegin(), points.cend());
+  } else {
+    for (const Point& p : points)
+      g.add_node(p);
+  }
+}
+
+template <typename G, typename S>
+void add_pairs(G& g, const std::vector<std::pair<S, S>>& pairs) {
+  using pair_iter = typename std::vector<std::pair<S, S>>::const_iterator;
+  if constexpr (has_add_edges<G, pair_iter>::value) {
+    g.add_edges(pairs.cbegin(), pairs.cend());
+  } else {
+    for (const auto& p : pairs)
+      g.add_edge(g.node(p.first), g.node(p.second));
+  }
+}
+
+/** Return @a n points uniform in the unit cube, or in the unit square at
+ * z = 0 if @a dims is 2. */
+inline std::vector<Point> random_points(std::size_t n, unsigned dims,
+                                        const generator_options& opt) {
+  std::vector<Point> points(n);
+  csr_snapshot::parallel_ranges(csr_snapshot::thread_count(opt.threads), n,
+      4096, [&](unsigned, std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i) {
+          element_rng rng(opt.seed, position_salt, i);
+          double x = rng.uniform();
+          double y = rng.uniform();
+          points[i] = Point(x, y, dims == 2 ? 0.0 : rng.uniform());
+        }
+      });
+  return points;
+}
+
+/** Call fn(i, out) for every i in [0, n) on several threads, each thread
+ * appending pairs to a buffer of its own, and return the buffers joined in
+ * order of i. */
+template <typename S, typename Fn>
+std::vector<std::pair<S, S>> collect_pairs(unsigned threads, std::size_t n,
+                                           std::size_t grain, Fn fn) {
+  threads = csr_snapshot::thread_count(threads);
+  std::vector<std::vector<std::pair<S, S>>> parts(threads);
+  csr_snapshot::parallel_ranges(threads, n, grain,
+      [&](unsigned t, std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i)
+          fn(i, parts[t]);
+      });
+  std::vector<std::size_t> start(threads + 1, 0);
+  for (unsigned t = 0; t < threads; ++t)
+    start[t + 1] = start[t] + parts[t].size();
+  std::vector<std::pair<S, S>> out(start[threads]);
+  csr_snapshot::parallel_ranges(threads, threads, 1,
+      [&](unsigned, std::size_t b, std::size_t e) {
+        for (std::size_t t = b; t < e; ++t) {
+          std::copy(parts[t].begin(), parts[t].end(), out.begin() + start[t]);
+          std::vector<std::pair<S, S>>().swap(parts[t]);
+        }
+      });
+  return out;
+}
+
+/** Add @a points and then @a pairs, whose indices count from the first
+ * new node, to @a g, and report on it. */
+template <typename G, typename S>
+generator_report finish(G& g, const std::vector<Point>& points,
+                        std::vector<std::pair<S, S>>& pairs,
+                        std::chrono::steady_clock::time_point start) {
+  S base = S(g.size());
+  std::size_t before = std::size_t(g.num_edges());
+  if (base != 0) {
+    for (auto& p : pairs) {
+      p.first += base;
+      p.second += base;
+    }
+  }
+  add_points(g, points);
+  add_pairs(g, pairs);
+
+  generator_report report;
+  report.nodes = points.size();
+  report.edges = std::size_t(g.num_edges()) - before;
+  report.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return report;
+}
+
+} // end namespace graph_generators_detail
+
+
+/** Append an @a nx by @a ny by @a nz lattice to @a g.
+ * @param[in] spacing  Distance between neighboring nodes
+ * @return Nodes, edges and wall time of the generation
+ *
+ * @post Lattice point (x, y, z) is the node of index
+ *       old g.size() + x + nx * (y + ny * z), at position
+ *       spacing * (x, y, z), with a default value
+ * @post Every node is joined to its 4 (nz == 1) or 6 nearest lattice
+ *       neighbors
+ *
+ * Leave @a nz at 1 for a 2D grid in the z = 0 plane.
+ * Complexity: O(nx * ny * nz / threads) plus adding to the graph.
+ */
+template <typename G>
+generator_report grid_graph(G& g, typename G::size_type nx,
+                            typename G::size_type ny,
+                            typename G::size_type nz = 1,
+                            double spacing = 1.0,
+                            const generator_options& opt = generator_options()) {
+  using size_type = typename G::size_type;
+  using pair_type = std::pair<size_type, size_type>;
+  auto start = std::chrono::steady_clock::now();
+  std::size_t n = std::size_t(nx) * ny * nz;
+  unsigned threads = csr_snapshot::thread_count(opt.threads);
+
+  std::vector<Point> points(n);
+  csr_snapshot::parallel_ranges(threads, n, 4096,
+      [&](unsigned, std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i) {
+          std::size_t x = i % nx, y = i / nx % ny, z = i / nx / ny;
+          points[i] = Point(spacing * double(x), spacing * double(y),
+                            spacing * double(z));
+        }
+      });
+
+  std::vector<pair_type> pairs = graph_generators_detail::collect_pairs<
+      size_type>(threads, n, 4096, [&](std::size_t i, std::vector<pair_type>& out) {
+        std::size_t x = i % nx, y = i / nx % ny, z = i / nx / ny;
+        if (x + 1 < nx)
+          out.emplace_back(size_type(i), size_type(i + 1));
+        if (y + 1 < ny)
+          out.emplace_back(size_type(i), size_type(i + nx));
+        if (z + 1 < nz)
+          out.emplace_back(size_type(i), size_type(i + std::size_t(nx) * ny));
+      });
+  return graph_generators_detail::finish(g, points, pairs, start);
+}
+
+/** Append @a n nodes at random in the unit cube, joining every two that
+ * lie within distance @a radius of each other.
+ * @param[in] dims  3, or 2 to place the nodes in the unit square at z = 0
+ * @return Nodes, edges and wall time of the generation
+ *
+ * The nodes are added first and bucketed by a SpatialIndex over @a g, so
+ * each node only looks at the grid cells its ball overlaps. Expect an
+ * average degree of about n * 4/3 pi r^3 (n pi r^2 in 2D), less near the
+ * boundary.
+ *
+ * Complexity: O((g.size() + n * degree) / threads) plus adding the edges.
+ */
+template <typename G>
+generator_report random_geometric_graph(G& g, typename G::size_type n,
+                                        double radius, unsigned dims = 3,
+                                        const generator_options& opt = generator_options()) {
+  using size_type = typename G::size_type;
+  using pair_type = std::pair<size_type, size_type>;
+  assert(radius > 0 && (dims == 2 || dims == 3));
+  auto start = std::chrono::steady_clock::now();
+  size_type base = size_type(g.size());
+  std::vector<Point> points = graph_generators_detail::random_points(n, dims, opt);
+  graph_generators_detail::add_points(g, points);
+
+  SpatialIndex<G> index(g);
+  std::vector<pair_type> pairs = graph_generators_detail::collect_pairs<
+      size_type>(opt.threads, n, 1024, [&](std::size_t i, std::vector<pair_type>& out) {
+        size_type u = size_type(base + i);
+        for (size_type v : index.nodes_within(points[i], radius)) {
+          if (v > u)
+            out.emplace_back(u, v);
+        }
+      });
+
+  generator_report report;
+  std::size_t before = std::size_t(g.num_edges());
+  graph_generators_detail::add_pairs(g, pairs);
+  report.nodes = n;
+  report.edges = std::size_t(g.num_edges()) - before;
+  report.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return report;
+}
+
+/** Append a G(n, m) Erdos-Renyi graph: @a n nodes at random in the unit
+ * cube and @a m edges between uniformly random pairs of them.
+ * @return Nodes, edges and wall time of the generation
+ *
+ * @pre @a n >= 2
+ *
+ * Pairs are drawn with replacement and repeats are merged, so slightly
+ * fewer than @a m edges result; about m^2 / (n^2 - n) fewer for sparse
+ * graphs.
+ *
+ * Complexity: O((n + m) / threads) plus adding to the graph.
+ */
+template <typename G>
+generator_report erdos_renyi_graph(G& g, typename G::size_type n,
+                                   std::uint64_t m,
+                                   const generator_options& opt = generator_options()) {
+  using namespace graph_generators_detail;
+  using size_type = typename G::size_type;
+  assert(n >= 2);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<Point> points = random_points(n, 3, opt);
+
+  std::vector<std::pair<size_type, size_type>> pairs(m);
+  csr_snapshot::parallel_ranges(csr_snapshot::thread_count(opt.threads), m,
+      4096, [&](unsigned, std::size_t b, std::size_t e) {
+        for (std::size_t k = b; k < e; ++k) {
+          element_rng rng(opt.seed, edge_salt, k);
+          size_type u, v;
+          do {
+            u = size_type(rng.below(n));
+            v = size_type(rng.below(n));
+          } while (u == v);
+          pairs[k] = std::make_pair(u, v);
+        }
+      });
+  return finish(g, points, pairs, start);
+}
+
+/** Append an R-MAT power-law graph with 2^@a scale nodes at random in the
+ * unit cube and @a m edges.
+ * @param[in] p  Probabilities of descending into each quadrant
+ * @return Nodes, edges and wall time of the generation
+ *
+ * @pre 1 <= @a scale < 8 * sizeof(size_type)
+ *
+ * Each edge picks its endpoints one bit at a time, descending into the
+ * quadrants of the adjacency matrix with probabilities a, b, c and
+ * 1 - a - b - c, which gives the skewed degrees of real networks. Self
+ * loops are drawn again and repeats merged, so fewer than @a m distinct
+ * edges result; with the default parameters about a quarter fewer at
+ * 16 edges per node.
+ *
+ * Complexity: O((2^scale + m * scale) / threads) plus adding to the graph.
+ */
+template <typename G>
+generator_report rmat_graph(G& g, unsigned scale, std::uint64_t m,
+                            const rmat_params& p = rmat_params(),
+                            const generator_options& opt = generator_options()) {
+  using namespace graph_generators_detail;
+  using size_type = typename G::size_type;
+  assert(scale >= 1 && scale < 8 * sizeof(size_type));
+  assert(p.a >= 0 && p.b >= 0 && p.c >= 0 && p.a + p.b + p.c <= 1);
+  auto start = std::chrono::steady_clock::now();
+  std::size_t n = std::size_t(1) << scale;
+  std::vector<Point> points = random_points(n, 3, opt);
+
+  double ab = p.a + p.b;
+  double abc = ab + p.c;
+  std::vector<std::pair<size_type, size_type>> pairs(m);
+  csr_snapshot::parallel_ranges(csr_snapshot::thread_count(opt.threads), m,
+      4096, [&](unsigned, std::size_t b, std::size_t e) {
+        for (std::size_t k = b; k < e; ++k) {
+          element_rng rng(opt.seed, edge_salt, k);
+          size_type u, v;
+          do {
+            u = 0;
+            v = 0;
+            for (unsigned bit = 0; bit < scale; ++bit) {
+              double r = rng.uniform();
+              u = size_type((u << 1) | (r >= ab));
+              v = size_type((v << 1) | ((r >= p.a && r < ab) || r >= abc));
+            }
+          } while (u == v);
+          pairs[k] = std::make_pair(u, v);
+        }
+      });
+  return finish(g, points, pairs, start);
+}
+
+/** Append a node at each of @a points and join each of them to its @a k
+ * nearest nodes.
+ * @return Nodes, edges and wall time of the construction
+ *
+ * @post Point i is the node of index old g.size() + i
+ * @post Every new node has an edge to each of the min(k, g.size() - 1)
+ *       nodes nearest to it other than itself, ties broken by index
+ *
+ * Neighbors are taken among all nodes of @a g, so nodes from an earlier
+ * call or scan count too. Nearness is not symmetric, so a node may end up
+ * with more than @a k edges; a pair that are each other's neighbors gets
+ * one edge, merged by add_edges().
+ *
+ * Complexity: O((g.size() + n * k) / threads) for evenly spread points,
+ * plus adding the edges.
+ */
+template <typename G>
+generator_report build_knn_graph(G& g, const std::vector<Point>& points,
+                                 typename G::size_type k,
+                                 const generator_options& opt = generator_options()) {
+  using size_type = typename G::size_type;
+  using pair_type = std::pair<size_type, size_type>;
+  auto start = std::chrono::steady_clock::now();
+  size_type base = size_type(g.size());
+  graph_generators_detail::add_points(g, points);
+
+  SpatialIndex<G> index(g);
+  std::vector<pair_type> pairs = graph_generators_detail::collect_pairs<
+      size_type>(opt.threads, points.size(), 1024,
+      [&](std::size_t i, std::vector<pair_type>& out) {
+        size_type u = size_type(base + i);
+        // One more than k, since the point itself is nearest
+        for (size_type v : index.nearest(points[i], size_type(k + 1))) {
+          if (v != u)
+            out.emplace_back(std::min(u, v), std::max(u, v));
+        }
+      });
+
+  generator_report report;
+  std::size_t before = std::size_t(g.num_edges());
+  graph_generators_detail::add_pairs(g, pairs);
+  report.nodes = points.size();
+  report.edges = std::size_t(g.num_edges()) - before;
+  report.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return report;
+}
+
+/** Append a node at each of @a points and join every two nodes within
+ * distance @a radius of each other, at least one of them new.
+ * @return Nodes, edges and wall time of the construction
+ *
+ * @post Point i is the node of index old g.size() + i
+ *
+ * As random_geometric_graph(), but for given points, and new nodes are
+ * joined to the nodes already in @a g as well.
+ *
+ * Complexity: O((g.size() + n * degree) / threads) plus adding the edges.
+ */
+template <typename G>
+generator_report build_radius_graph(G& g, const std::vector<Point>& points,
+                                    double radius,
+                                    const generator_options& opt = generator_options()) {
+  using size_type = typename G::size_type;
+  using pair_type = std::pair<size_type, size_type>;
+  assert(radius >= 0);
+  auto start = std::chrono::steady_clock::now();
+  size_type base = size_type(g.size());
+  graph_generators_detail::add_points(g, points);
+
+  SpatialIndex<G> index(g);
+  std::vector<pair_type> pairs = graph_generators_detail::collect_pairs<
+      size_type>(opt.threads, points.size(), 1024,
+      [&](std::size_t i, std::vector<pair_type>& out) {
+        size_type u = size_type(base + i);
+        // Each new pair once, from its larger index; old nodes never ask
+        for (size_type v : index.nodes_within(points[i], radius)) {
+          if (v < u)
+            out.emplace_back(v, u);
+        }
+      });
+
+  generator_report report;
+  std::size_t before = std::size_t(g.num_edges());
+  graph_generators_detail::add_pairs(g, pairs);
+  report.nodes = points.size();
+  report.edges = std::size_t(g.num_edges()) - before;
+  report.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return report;
+}
+
+#endif // CME212_GRAPH_GENERATORS_HPP
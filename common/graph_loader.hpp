@@ -0,0 +1,625 @@
+#ifndef CME212_GRAPH_LOADER_HPP
+#define CME212_GRAPH_LOADER_HPP
+
+/** @file graph_loader.hpp
+ * @brief Chunked, parallel loader for ASCII node and triangle files.
+ *
+ * A node file has one "x y z" line per node; a triangle file has one
+ * "n1 n2 n3" line of node indices per triangle, whose three sides become
+ * edges. Blank lines are ignored and fields may be separated by any mix of
+ * spaces and tabs.
+ *
+ * The file is read in large chunks. While one chunk is split at line
+ * boundaries and parsed with std::from_chars on several threads, the next
+ * chunk is already being read on another, so I/O overlaps with parsing.
+ * Parsed records go to the graph in bulk: through add_nodes(first, last) and
+ * add_edges(first, last) when the graph has them, and one call per record
+ * otherwise.
+ *
+ * AsyncGraphLoader runs the same pipeline on a background thread and
+ * returns at once, so a service can start answering queries on the part of
+ * the graph loaded so far instead of blocking until the whole graph is in:
+ *
+ *   AsyncGraphLoader<G> loader(g, "mesh.nodes", "mesh.tris");
+ *   loader.wait_for_nodes(1000);
+ *   loader.with_prefix([](const G& g, const load_progress& p) { ... });
+ *   load_report r = loader.get();            // rethrows a failed load
+ *
+ * Besides file paths, the loaders take any load_source, such as a reader
+ * over an object store download.
+ */
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/thread_pool.hpp"
+#include "common/trace.hpp"
+#include "CME212/Point.hpp"
+
+
+/** Tuning knobs for load_nodes() and load_triangles(). */
+struct load_options {
+  /** Bytes read per chunk. Two chunks are in memory at once. */
+  std::size_t chunk_bytes = std::size_t(64) << 20;
+  /** Parser threads per chunk. 0 means std::thread::hardware_concurrency(). */
+  unsigned threads = 0;
+};
+
+/** What a load did and how fast. */
+struct load_report {
+  std::uint64_t bytes = 0;    // bytes read from the file
+  std::uint64_t records = 0;  // nodes or triangles parsed
+  double seconds = 0;         // wall time, including adding to the graph
+
+  /** Return the read throughput in bytes per second. */
+  double bytes_per_second() const {
+    return seconds > 0 ? double(bytes) / seconds : 0;
+  }
+  /** Return the number of records parsed per second. */
+  double records_per_second() const {
+    return seconds > 0 ? double(records) / seconds : 0;
+  }
+};
+
+/** A stream of bytes to load from: read(buf, max) stores up to max bytes at
+ * buf and returns how many, and returns 0 only once the data is exhausted.
+ * It may throw to report a failed read. */
+using load_source = std::function<std::size_t(char*, std::size_t)>;
+
+
+namespace graph_loader_detail {
+
+/** Reads a file or a load_source in chunks that end on a line boundary. */
+class chunk_reader {
+ public:
+  chunk_reader(const std::string& path, std::size_t chunk_bytes)
+      : path_(path), file_(std::fopen(path.c_str(), "rb")),
+        chunk_bytes_(std::max<std::size_t>(chunk_bytes, 4096)) {
+    if (!file_)
+      throw std::runtime_error("graph_loader: cannot open " + path);
+  }
+
+  /** Read from @a source, calling it @a name in error messages. */
+  chunk_reader(const std::string& name, load_source source,
+               std::size_t chunk_bytes)
+      : path_(name), file_(nullptr), source_(std::move(source)),
+        chunk_bytes_(std::max<std::size_t>(chunk_bytes, 4096)) {
+  }
+
+  ~chunk_reader() {
+    if (file_)
+      std::fclose(file_);
+  }
+
+  chunk_reader(const chunk_reader&) = delete;
+  chunk_reader& operator=(const chunk_reader&) = delete;
+
+  /** Fill @a buf with the next chunk: the partial line left over from the
+   * previous chunk followed by fresh data, cut after its last newline.
+   * @return the number of bytes read from the file by this call
+   */
+  std::size_t next(std::vector<char>& buf) {
+    buf.assign(carry_.begin(), carry_.end());
+    carry_.clear();
+    std::size_t old_size = buf.size();
+    buf.resize(old_size + chunk_bytes_);
+    std::size_t got = 0;
+    while (got < chunk_bytes_ && !eof_) {
+      std::size_t r = read(buf.data() + old_size + got, chunk_bytes_ - got);
+      eof_ = (r == 0);
+      got += r;
+    }
+    bytes_.fetch_add(got, std::memory_order_relaxed);
+    buf.resize(old_size + got);
+
+    if (got != 0) {
+      auto rlast = std::find(buf.rbegin(), buf.rend(), '\n');
+      carry_.assign(rlast.base(), buf.end());
+      buf.erase(rlast.base(), buf.end());
+    }
+    return got;
+  }
+
+  /** Return true once the whole file has been handed out. */
+  bool done() const {
+    return eof_ && carry_.empty();
+  }
+
+  /** Return the path or name this reader reads from. */
+  const std::string& name() const {
+    return path_;
+  }
+
+  /** Return the bytes read so far. Safe to call while another thread is in
+   * next(). */
+  std::uint64_t bytes() const {
+    return bytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::string path_;
+  std::FILE* file_;
+  load_source source_;
+  std::size_t chunk_bytes_;
+  bool eof_ = false;
+  std::atomic<std::uint64_t> bytes_{0};
+  std::vector<char> carry_;
+
+  std::size_t read(char* buf, std::size_t max) {
+    if (!file_)
+      return source_(buf, max);
+    std::size_t got = std::fread(buf, 1, max, file_);
+    if (got < max && std::ferror(file_))
+      throw std::runtime_error("graph_loader: cannot read " + path_);
+    return got;
+  }
+};
+
+inline bool is_blank(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+/** Parse one field of type T at @a p, skipping leading blanks.
+ * @return a pointer past the field, or nullptr on a malformed field */
+template <typename T>
+const char* parse_field(const char* p, const char* end, T& out) {
+  while (p != end && is_blank(*p))
+    ++p;
+  auto result = std::from_chars(p, end, out);
+  return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+/** Parse a line of exactly @a N fields of type T.
+ * @return false if the line is malformed */
+template <typename T, std::size_t N>
+bool parse_line(const char* p, const char* end, std::array<T, N>& out) {
+  for (std::size_t k = 0; k < N; ++k) {
+    p = parse_field(p, end, out[k]);
+    if (!p)
+      return false;
+  }
+  while (p != end && is_blank(*p))
+    ++p;
+  return p == end;
+}
+
+/** Parse every non-blank line of [begin, end) into @a out, in order.
+ * @return the offset from @a begin of the first malformed line, or -1 */
+template <typename T, std::size_t N>
+std::ptrdiff_t parse_lines(const char* begin, const char* end,
+                           std::vector<std::array<T, N>>& out) {
+  std::array<T, N> rec;
+  for (const char* p = begin; p != end; ) {
+    const char* eol = std::find(p, end, '\n');
+    const char* q = p;
+    while (q != eol && is_blank(*q))
+      ++q;
+    if (q != eol) {
+      if (!parse_line(q, eol, rec))
+        return p - begin;
+      out.push_back(rec);
+    }
+    p = (eol == end) ? end : eol + 1;
+  }
+  return -1;
+}
+
+/** Parse [begin, end) on @a threads threads, each taking a slice that
+ * starts and ends on a line boundary, and concatenate the slices in order
+ * into @a out.
+ * @throws std::runtime_error on a malformed line; @a where is the file
+ *         offset of @a begin, used in the message
+ */
+template <typename T, std::size_t N>
+void parse_parallel(const char* begin, const char* end, unsigned threads,
+                    std::uint64_t where, const std::string& path,
+                    std::vector<std::array<T, N>>& out) {
+  std::size_t bytes = std::size_t(end - begin);
+  threads = unsigned(std::max<std::size_t>(
+      1, std::min<std::size_t>(threads, bytes / 4096)));
+
+  std::vector<const char*> cut(threads + 1, end);
+  cut[0] = begin;
+  for (unsigned t = 1; t < threads; ++t) {
+    const char* p = std::max(cut[t - 1], begin + bytes / threads * t);
+    p = std::find(p, end, '\n');
+    cut[t] = (p == end) ? end : p + 1;
+  }
+
+  std::vector<std::vector<std::array<T, N>>> parts(threads);
+  std::vector<std::ptrdiff_t> bad(threads, -1);
+  ThreadPool::shared().run_ranges(threads, [&](unsigned t) {
+    bad[t] = parse_lines(cut[t], cut[t + 1], parts[t]);
+  });
+
+  for (unsigned t = 0; t < threads; ++t) {
+    if (bad[t] >= 0)
+      throw std::runtime_error(
+          "graph_loader: malformed line at byte " +
+          std::to_string(where + std::uint64_t(cut[t] - begin + bad[t])) +
+          " of " + path);
+  }
+  std::size_t total = 0;
+  for (const auto& part : parts)
+    total += part.size();
+  out.clear();
+  out.reserve(total);
+  for (const auto& part : parts)
+    out.insert(out.end(), part.begin(), part.end());
+}
+
+/** Run the read-ahead pipeline over @a reader: while chunk k is parsed and
+ * handed to @a consume, chunk k + 1 is read on another thread. */
+template <typename T, std::size_t N, typename Consume>
+load_report pipeline(chunk_reader& reader, const load_options& opt,
+                     Consume consume) {
+  auto start = std::chrono::steady_clock::now();
+  unsigned threads = opt.threads ? opt.threads : ThreadPool::shared().size();
+  const std::string& path = reader.name();
+  load_report report;
+  std::vector<char> current, ahead;
+  std::vector<std::array<T, N>> records;
+
+  std::size_t got = reader.next(current);
+  std::uint64_t where = 0;
+  while (!current.empty() || got != 0) {
+    report.bytes += got;
+    bool more = !reader.done();
+    std::future<std::size_t> next;
+    if (more)
+      next = std::async(std::launch::async, [&] {
+        CME212_TRACE_SCOPE("read");
+        return reader.next(ahead);
+      });
+
+    {
+      CME212_TRACE_SCOPE_N("parse", current.size());
+      parse_parallel(current.data(), current.data() + current.size(), threads,
+                     where, path, records);
+    }
+    report.records += records.size();
+    {
+      CME212_TRACE_SCOPE_N("append", records.size());
+      consume(records);
+    }
+    where += current.size();
+
+    got = more ? next.get() : 0;
+    current.swap(ahead);
+    if (!more)
+      current.clear();
+  }
+
+  report.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return report;
+}
+
+template <typename G, typename It, typename = void>
+struct has_add_nodes : std::false_type {};
+template <typename G, typename It>
+struct has_add_nodes<G, It, decltype(void(std::declval<G&>().add_nodes(
+    std::declval<It>(), std::declval<It>())))> : std::true_type {};
+
+template <typename G, typename It, typename = void>
+struct has_add_edges : std::false_type {};
+template <typename G, typename It>
+struct has_add_edges<G, It, decltype(void(std::declval<G&>().add_edges(
+    std::declval<It>(), std::declval<It>())))> : std::true_type {};
+
+/** Add one node per record of @a recs to @a g, staging the positions in
+ * @a points. */
+template <typename G>
+void append_nodes(G& g, const std::vector<std::array<double, 3>>& recs,
+                  std::vector<Point>& points) {
+  points.clear();
+  points.reserve(recs.size());
+  for (const auto& r : recs)
+    points.emplace_back(r[0], r[1], r[2]);
+  if constexpr (has_add_nodes<G, std::vector<Point>::const_iterator>::value) {
+    g.add_nodes(points.cbegin(), points.cend());
+  } else {
+    for (const Point& p : points)
+      g.add_node(p);
+  }
+}
+
+/** Add the three sides of every triangle of @a recs to @a g, staging the
+ * node pairs in @a pairs. */
+template <typename G, typename S>
+void append_triangles(G& g, const std::vector<std::array<S, 3>>& recs,
+                      std::vector<std::pair<S, S>>& pairs) {
+  using pair_type = std::pair<S, S>;
+  pairs.clear();
+  pairs.reserve(3 * recs.size());
+  for (const auto& t : recs) {
+    pairs.emplace_back(t[0], t[1]);
+    pairs.emplace_back(t[1], t[2]);
+    pairs.emplace_back(t[0], t[2]);
+  }
+  if constexpr (has_add_edges<
+                    G, typename std::vector<pair_type>::const_iterator>::value) {
+    g.add_edges(pairs.cbegin(), pairs.cend());
+  } else {
+    for (const pair_type& p : pairs)
+      g.add_edge(g.node(p.first), g.node(p.second));
+  }
+}
+
+} // end namespace graph_loader_detail
+
+
+/** Append one node per line of the node file @a path to @a g.
+ * @param[in,out] g  Graph to add to. New nodes get default values.
+ * @return bytes, nodes and wall time of the load
+ * @throws std::runtime_error if the file cannot be read or has a line that
+ *         is not three numbers
+ *
+ * @post new g.num_nodes() == old g.num_nodes() + result.records, with nodes
+ *       in file order
+ */
+template <typename G>
+load_report load_nodes(G& g, const std::string& path,
+                       const load_options& opt = load_options()) {
+  CME212_TRACE_SCOPE("load_nodes");
+  graph_loader_detail::chunk_reader reader(path, opt.chunk_bytes);
+  std::vector<Point> points;
+  return graph_loader_detail::pipeline<double, 3>(
+      reader, opt, [&](const std::vector<std::array<double, 3>>& recs) {
+        graph_loader_detail::append_nodes(g, recs, points);
+      });
+}
+
+/** Add the three sides of every triangle in the triangle file @a path to
+ * @a g as edges.
+ * @param[in,out] g  Graph whose nodes the triangle indices refer to.
+ * @return bytes, triangles and wall time of the load
+ * @throws std::runtime_error if the file cannot be read or has a line that
+ *         is not three non-negative integers
+ *
+ * @pre Every index in the file is less than g.num_nodes() and no triangle
+ *      repeats a node
+ * @post g.has_edge() holds for every side of every triangle
+ */
+template <typename G>
+load_report load_triangles(G& g, const std::string& path,
+                           const load_options& opt = load_options()) {
+  using size_type = typename G::size_type;
+  CME212_TRACE_SCOPE("load_triangles");
+  graph_loader_detail::chunk_reader reader(path, opt.chunk_bytes);
+  std::vector<std::pair<size_type, size_type>> pairs;
+  return graph_loader_detail::pipeline<size_type, 3>(
+      reader, opt, [&](const std::vector<std::array<size_type, 3>>& recs) {
+        graph_loader_detail::append_triangles(g, recs, pairs);
+      });
+}
+
+
+/** How far an AsyncGraphLoader has got. */
+struct load_progress {
+  std::uint64_t bytes = 0;       // bytes read from both inputs so far
+  std::uint64_t nodes = 0;       // nodes added to the graph
+  std::uint64_t triangles = 0;   // triangles whose sides were added
+  bool finished = false;         // the load succeeded, failed or was cancelled
+};
+
+
+/** @class AsyncGraphLoader
+ * @brief Loads a node file and then a triangle file into a graph on a
+ *        background thread, with access to the prefix loaded so far.
+ *
+ * The background thread runs the load_nodes() and load_triangles()
+ * pipelines in turn. Reading and parsing happen outside any lock; only
+ * adding a parsed chunk to the graph takes the loader's lock exclusively.
+ * with_prefix() takes it shared, so a query sees the graph between two
+ * chunks: nodes in file order, and edges only once all nodes are in, so
+ * every edge it sees has both endpoints.
+ *
+ * While the load runs, the graph must be touched only through
+ * with_prefix(). Concurrent with_prefix() calls read the graph from several
+ * threads at once, which is safe as long as operation counting
+ * (CME212_GRAPH_STATS) is off.
+ *
+ * @tparam G  Graph type with add_node() or add_nodes(), add_edge() or
+ *            add_edges(), node() and size_type.
+ */
+template <typename G>
+class AsyncGraphLoader {
+ public:
+  using size_type = typename G::size_type;
+
+  /** Start loading the node file @a nodes and then, unless it is empty,
+   * the triangle file @a triangles into @a g. Returns at once; errors,
+   * including a file that cannot be opened, surface from get(). */
+  AsyncGraphLoader(G& g, std::string nodes, std::string triangles = "",
+                   const load_options& opt = load_options())
+      : g_(g), opt_(opt) {
+    nodes_.path = std::move(nodes);
+    triangles_.path = std::move(triangles);
+    start();
+  }
+
+  /** Start loading nodes from @a nodes and then, unless it is empty,
+   * triangles from @a triangles into @a g. */
+  AsyncGraphLoader(G& g, load_source nodes, load_source triangles,
+                   const load_options& opt = load_options())
+      : g_(g), opt_(opt) {
+    nodes_.source = std::move(nodes);
+    triangles_.source = std::move(triangles);
+    start();
+  }
+
+  /** Cancel the load if it still runs and wait for the thread to end. The
+   * graph then holds whatever prefix had been added. */
+  ~AsyncGraphLoader() {
+    cancel();
+    worker_.join();
+  }
+
+  AsyncGraphLoader(const AsyncGraphLoader&) = delete;
+  AsyncGraphLoader& operator=(const AsyncGraphLoader&) = delete;
+
+  /** Wait for the load to end.
+   * @return bytes, nodes plus triangles, and wall time of the whole load
+   * @throws what load_nodes() or load_triangles() would have, or
+   *         std::runtime_error if the load was cancelled
+   */
+  load_report get() const {
+    return result_.get();
+  }
+
+  /** Return the future of get(), e.g. to poll it with wait_for(). */
+  std::shared_future<load_report> future() const {
+    return result_;
+  }
+
+  /** Return how far the load has got. */
+  load_progress progress() const {
+    std::lock_guard<std::mutex> lock(progress_mutex_);
+    return progress_;
+  }
+
+  /** Block until at least @a n nodes are in the graph or the load ends.
+   * @return true if @a n nodes were reached */
+  bool wait_for_nodes(std::uint64_t n) const {
+    std::unique_lock<std::mutex> lock(progress_mutex_);
+    changed_.wait(lock, [&] { return progress_.nodes >= n || progress_.finished; });
+    return progress_.nodes >= n;
+  }
+
+  /** Return fn(g, progress) with the graph held still between two chunks.
+   * The progress passed matches the graph @a fn sees. */
+  template <typename Fn>
+  decltype(auto) with_prefix(Fn fn) const {
+    std::shared_lock<std::shared_mutex> lock(graph_mutex_);
+    return fn(static_cast<const G&>(g_), progress());
+  }
+
+  /** Ask the load to stop after the chunk in progress. get() then throws. */
+  void cancel() {
+    cancelled_.store(true, std::memory_order_relaxed);
+  }
+
+ private:
+  struct input {
+    std::string path;
+    load_source source;
+
+    bool empty() const {
+      return path.empty() && !source;
+    }
+    graph_loader_detail::chunk_reader open(std::size_t chunk_bytes) const {
+      if (source)
+        return graph_loader_detail::chunk_reader("<source>", source,
+                                                 chunk_bytes);
+      return graph_loader_detail::chunk_reader(path, chunk_bytes);
+    }
+  };
+
+  /** Thrown out of the pipeline to stop a cancelled load. */
+  struct stop {};
+
+  G& g_;
+  load_options opt_;
+  input nodes_, triangles_;
+  std::atomic<bool> cancelled_{false};
+  mutable std::shared_mutex graph_mutex_;
+  mutable std::mutex progress_mutex_;
+  mutable std::condition_variable changed_;
+  load_progress progress_;
+  std::promise<load_report> promise_;
+  std::shared_future<load_report> result_;
+  std::thread worker_;
+
+  void start() {
+    result_ = promise_.get_future().share();
+    worker_ = std::thread([this] { run(); });
+  }
+
+  /** Add one parsed chunk with @a append under the exclusive lock and
+   * publish the new progress. */
+  template <typename Append>
+  void add_chunk(Append append, std::uint64_t nodes, std::uint64_t triangles,
+                 std::uint64_t bytes) {
+    if (cancelled_.load(std::memory_order_relaxed))
+      throw stop();
+    std::unique_lock<std::shared_mutex> lock(graph_mutex_);
+    append();
+    {
+      std::lock_guard<std::mutex> guard(progress_mutex_);
+      progress_.nodes += nodes;
+      progress_.triangles += triangles;
+      progress_.bytes = bytes;
+    }
+    changed_.notify_all();
+  }
+
+  void run() {
+    auto start = std::chrono::steady_clock::now();
+    load_report total;
+    try {
+      if (!nodes_.empty()) {
+        graph_loader_detail::chunk_reader reader = nodes_.open(opt_.chunk_bytes);
+        std::vector<Point> points;
+        load_report r = graph_loader_detail::pipeline<double, 3>(
+            reader, opt_, [&](const std::vector<std::array<double, 3>>& recs) {
+              add_chunk([&] { graph_loader_detail::append_nodes(g_, recs, points); },
+                        recs.size(), 0, total.bytes + reader.bytes());
+            });
+        total.bytes += r.bytes;
+        total.records += r.records;
+      }
+      if (!triangles_.empty()) {
+        graph_loader_detail::chunk_reader reader =
+            triangles_.open(opt_.chunk_bytes);
+        std::vector<std::pair<size_type, size_type>> pairs;
+        load_report r = graph_loader_detail::pipeline<size_type, 3>(
+            reader, opt_, [&](const std::vector<std::array<size_type, 3>>& recs) {
+              add_chunk([&] { graph_loader_detail::append_triangles(g_, recs, pairs); },
+                        0, recs.size(), total.bytes + reader.bytes());
+            });
+        total.bytes += r.bytes;
+        total.records += r.records;
+      }
+      total.seconds = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count();
+      finish();
+      promise_.set_value(total);
+    } catch (const stop&) {
+      finish();
+      promise_.set_exception(std::make_exception_ptr(
+          std::runtime_error("graph_loader: load cancelled")));
+    } catch (...) {
+      finish();
+      promise_.set_exception(std::current_exception());
+    }
+  }
+
+  void finish() {
+    {
+      std::lock_guard<std::mutex> guard(progress_mutex_);
+      progress_.finished = true;
+    }
+    changed_.notify_all();
+  }
+};
+
+#endif // CME212_GRAPH_LOADER_HPP
@@ -0,0 +1,363 @@
+#ifndef CME212_GRAPH_PARTITION_HPP
+#define CME212_GRAPH_PARTITION_HPP
+
+/** @file graph_partition.hpp
+ * @brief Geometric partitioning of a graph and per-partition subgraph views.
+ *
+ * bisection_partition() splits the nodes into parts of equal size by
+ * recursive coordinate bisection (RCB): the bounding box of a set of nodes
+ * is cut across its longest side at the position that divides the nodes in
+ * the ratio of the parts wanted on each side, and both halves are cut
+ * again. Meshes get compact, roughly cubic parts, so few edges cross
+ * between them.
+ *
+ * SubgraphView gives one part a local numbering. Its nodes come first,
+ * then the ghost nodes: nodes of other parts that share an edge with it.
+ * The owned nodes are ordered interior first, then boundary (those with a
+ * ghost neighbor), and the ghosts are grouped by the part that owns them.
+ * Every group is a contiguous range of local indices, so a halo exchange
+ * can pack and unpack it with one copy.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common/trace.hpp"
+#include "CME212/Point.hpp"
+
+
+/** Return a part in [0, @a parts) for every node of @a g, computed by
+ * recursive coordinate bisection of the node positions.
+ * @pre @a parts > 0
+ * @post Part sizes differ by at most one
+ *
+ * Each cut runs along the axis in which the nodes being split spread
+ * furthest. A part count that is not a power of two is split unevenly, for
+ * example 5 as 2 + 3, at the matching fraction of the nodes.
+ *
+ * @tparam G  Graph type with size() and node(i).position().
+ *
+ * Complexity: O(g.size() log @a parts) expected.
+ */
+template <typename G>
+std::vector<unsigned> bisection_partition(const G& g, unsigned parts) {
+  assert(parts > 0);
+  CME212_TRACE_SCOPE("bisection_partition");
+  using size_type = typename G::size_type;
+  std::size_t n = std::size_t(g.size());
+  std::vector<Point> pos(n);
+  std::vector<std::size_t> order(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    pos[i] = g.node(size_type(i)).position();
+    order[i] = i;
+  }
+
+  std::vector<unsigned> part(n, 0);
+  // Pending cuts: nodes order[first, last) go to parts [p, p + count)
+  struct cut {
+    std::size_t first, last;
+    unsigned p, count;
+  };
+  std::vector<cut> stack(1, cut{0, n, 0, parts});
+  while (!stack.empty()) {
+    cut c = stack.back();
+    stack.pop_back();
+    if (c.count == 1 || c.last - c.first <= 1) {
+      for (std::size_t k = c.first; k < c.last; ++k)
+        part[order[k]] = c.p;
+      continue;
+    }
+
+    Point lo = pos[order[c.first]], hi = lo;
+    for (std::size_t k = c.first; k < c.last; ++k) {
+      const Point& x = pos[order[k]];
+      for (int a = 0; a < 3; ++a) {
+        lo[a] = std::min(lo[a], x[a]);
+        hi[a] = std::max(hi[a], x[a]);
+      }
+    }
+    int axis = 0;
+    for (int a = 1; a < 3; ++a) {
+      if (hi[a] - lo[a] > hi[axis] - lo[axis])
+        axis = a;
+    }
+
+    unsigned left = c.count / 2;
+    std::size_t mid = c.first + (c.last - c.first) * left / c.count;
+    std::nth_element(order.begin() + c.first, order.begin() + mid,
+                     order.begin() + c.last,
+                     [&](std::size_t i, std::size_t j) {
+                       return pos[i][axis] < pos[j][axis] ||
+                              (pos[i][axis] == pos[j][axis] && i < j);
+                     });
+    stack.push_back(cut{c.first, mid, c.p, left});
+    stack.push_back(cut{mid, c.last, c.p + left, c.count - left});
+  }
+  return part;
+}
+
+/** Return the number of edges of @a g whose endpoints lie in different
+ * parts of @a part.
+ *
+ * Complexity: O(g.num_edges()).
+ */
+template <typename G>
+std::size_t edge_cut(const G& g, const std::vector<unsigned>& part) {
+  using size_type = typename G::size_type;
+  std::size_t cut = 0;
+  for (size_type e = 0; e < g.num_edges(); ++e) {
+    auto edge = g.edge(e);
+    cut += part[edge.node1().index()] != part[edge.node2().index()];
+  }
+  return cut;
+}
+
+
+/** @class SubgraphView
+ * @brief One part of a partitioned graph, with local indices and ghosts.
+ *
+ * Local indices run over [0, size()):
+ *
+ *   [0, num_interior())             owned nodes with only owned neighbors
+ *   [num_interior(), num_owned())   owned nodes with a ghost neighbor
+ *   [num_owned(), size())           ghost nodes, grouped by owning part
+ *
+ * Within each range nodes keep their global order. The view stores the
+ * local adjacency of the owned nodes in CSR form and copies of the owned
+ * and ghost positions, so a rank computes on contiguous local arrays and
+ * only goes back to the graph through global().
+ *
+ * @tparam G  Graph type with size(), num_edges(), edge(i).node1/node2(),
+ *            node(i).position() and size_type.
+ */
+template <typename G>
+class SubgraphView {
+ public:
+  /** Type of node indices, local as well as global. */
+  using size_type = typename G::size_type;
+
+  /** Index returned by local() for nodes not in the view. */
+  static constexpr size_type npos = size_type(-1);
+
+  /** Build the view of part @a p of the partition @a part of @a g.
+   * @pre @a part.size() == g.size()
+   *
+   * Complexity: O(g.size() + g.num_edges()).
+   */
+  SubgraphView(const G& g, const std::vector<unsigned>& part, unsigned p)
+      : part_(p) {
+    assert(part.size() == std::size_t(g.size()));
+    std::size_t n = std::size_t(g.size());
+    std::size_t m = std::size_t(g.num_edges());
+
+    // Edges with at least one owned endpoint, and which owned nodes touch
+    // another part
+    std::vector<std::pair<size_type, size_type>> edges;
+    std::vector<std::uint8_t> role(n, 0);  // 1 owned, 2 boundary, 4 ghost
+    for (std::size_t i = 0; i < n; ++i)
+      role[i] = (part[i] == p);
+    for (std::size_t e = 0; e < m; ++e) {
+      auto edge = g.edge(size_type(e));
+      size_type a = edge.node1().index(), b = edge.node2().index();
+      bool own_a = part[a] == p, own_b = part[b] == p;
+      if (!own_a && !own_b)
+        continue;
+      edges.emplace_back(a, b);
+      if (own_a != own_b) {
+        role[own_a ? a : b] |= 2;
+        role[own_a ? b : a] |= 4;
+      }
+    }
+
+    // Local numbering: interior, boundary, then ghosts by owner
+    for (std::size_t i = 0; i < n; ++i) {
+      if (role[i] == 1)
+        global_.push_back(size_type(i));
+    }
+    num_interior_ = size_type(global_.size());
+    for (std::size_t i = 0; i < n; ++i) {
+      if (role[i] == 3)
+        global_.push_back(size_type(i));
+    }
+    num_owned_ = size_type(global_.size());
+    std::vector<size_type> ghosts;
+    for (std::size_t i = 0; i < n; ++i) {
+      if (role[i] & 4)
+        ghosts.push_back(size_type(i));
+    }
+    std::stable_sort(ghosts.begin(), ghosts.end(),
+                     [&](size_type x, size_type y) {
+                       return part[x] < part[y];
+                     });
+    for (size_type x : ghosts) {
+      if (ghost_parts_.empty() || ghost_parts_.back() != part[x]) {
+        ghost_parts_.push_back(part[x]);
+        ghost_offsets_.push_back(size_type(global_.size()));
+      }
+      global_.push_back(x);
+    }
+    ghost_offsets_.push_back(size_type(global_.size()));
+
+    // Sorted (global, local) pairs behind local()
+    index_.resize(global_.size());
+    for (std::size_t k = 0; k < global_.size(); ++k)
+      index_[k] = {global_[k], size_type(k)};
+    std::sort(index_.begin(), index_.end());
+
+    // CSR adjacency of the owned nodes; ghost rows are empty
+    offsets_.assign(global_.size() + 1, 0);
+    for (auto& e : edges) {
+      e = {local(e.first), local(e.second)};
+      if (e.first < num_owned_)
+        ++offsets_[e.first + 1];
+      if (e.second < num_owned_)
+        ++offsets_[e.second + 1];
+    }
+    for (std::size_t k = 0; k < global_.size(); ++k)
+      offsets_[k + 1] += offsets_[k];
+    neighbors_.resize(offsets_.back());
+    std::vector<std::size_t> fill(offsets_.begin(), offsets_.end() - 1);
+    for (const auto& e : edges) {
+      if (e.first < num_owned_)
+        neighbors_[fill[e.first]++] = e.second;
+      if (e.second < num_owned_)
+        neighbors_[fill[e.second]++] = e.first;
+    }
+    for (std::size_t k = 0; k < num_owned_; ++k)
+      std::sort(neighbors_.begin() + offsets_[k],
+                neighbors_.begin() + offsets_[k + 1]);
+
+    positions_.resize(global_.size());
+    for (std::size_t k = 0; k < global_.size(); ++k)
+      positions_[k] = g.node(global_[k]).position();
+  }
+
+  /** Return the part this view belongs to. */
+  unsigned part() const {
+    return part_;
+  }
+
+  /** Return the number of local nodes, owned and ghost. */
+  size_type size() const {
+    return size_type(global_.size());
+  }
+
+  /** Return the number of owned nodes. */
+  size_type num_owned() const {
+    return num_owned_;
+  }
+
+  /** Return the number of owned nodes with no ghost neighbor. */
+  size_type num_interior() const {
+    return num_interior_;
+  }
+
+  /** Return the number of owned nodes with a ghost neighbor. */
+  size_type num_boundary() const {
+    return num_owned_ - num_interior_;
+  }
+
+  /** Return the number of ghost nodes. */
+  size_type num_ghosts() const {
+    return size() - num_owned_;
+  }
+
+  /** Return true if local node @a k is a ghost. */
+  bool is_ghost(size_type k) const {
+    return k >= num_owned_;
+  }
+
+  /** Return the global index of local node @a k.
+   * @pre @a k < size() */
+  size_type global(size_type k) const {
+    assert(k < size());
+    return global_[k];
+  }
+
+  /** Return the local index of global node @a i, or npos if it is neither
+   * owned nor a ghost.
+   *
+   * Complexity: O(log size()).
+   */
+  size_type local(size_type i) const {
+    auto it = std::lower_bound(index_.begin(), index_.end(),
+                               std::make_pair(i, size_type(0)));
+    if (it == index_.end() || it->first != i)
+      return npos;
+    return it->second;
+  }
+
+  /** Return the map from local to global indices. */
+  const std::vector<size_type>& local_to_global() const {
+    return global_;
+  }
+
+  /** Return the parts that own ghosts of this view, in increasing order. */
+  const std::vector<unsigned>& ghost_parts() const {
+    return ghost_parts_;
+  }
+
+  /** Return the local range [first, last) of the ghosts owned by
+   * ghost_parts()[@a j]. */
+  std::pair<size_type, size_type> ghost_range(std::size_t j) const {
+    assert(j < ghost_parts_.size());
+    return {ghost_offsets_[j], ghost_offsets_[j + 1]};
+  }
+
+  /** Return the local neighbors of local node @a k in increasing order as
+   * a [first, last) pointer range. Ghosts have no stored neighbors.
+   * @pre @a k < size() */
+  std::pair<const size_type*, const size_type*> neighbors(size_type k) const {
+    assert(k < size());
+    const size_type* base = neighbors_.data();
+    return {base + offsets_[k], base + offsets_[k + 1]};
+  }
+
+  /** Return the number of local neighbors of local node @a k. */
+  size_type degree(size_type k) const {
+    assert(k < size());
+    return size_type(offsets_[k + 1] - offsets_[k]);
+  }
+
+  /** Return the local copy of the node positions, indexed by local index. */
+  std::vector<Point>& positions() {
+    return positions_;
+  }
+  const std::vector<Point>& positions() const {
+    return positions_;
+  }
+
+ private:
+  unsigned part_;
+  size_type num_interior_ = 0;
+  size_type num_owned_ = 0;
+  std::vector<size_type> global_;                         // local -> global
+  std::vector<std::pair<size_type, size_type>> index_;    // sorted (global, local)
+  std::vector<unsigned> ghost_parts_;
+  std::vector<size_type> ghost_offsets_;  // ghosts of ghost_parts_[j] start here
+  std::vector<std::size_t> offsets_;      // CSR row offsets, one per local node + 1
+  std::vector<size_type> neighbors_;
+  std::vector<Point> positions_;
+};
+
+/** Return the views of all @a parts parts of @a g, partitioned by
+ * bisection_partition(). A distributed run builds only its own view, with
+ * SubgraphView(g, part, rank).
+ *
+ * Complexity: O(@a parts * (g.size() + g.num_edges())).
+ */
+template <typename G>
+std::vector<SubgraphView<G>> partition_views(const G& g, unsigned parts) {
+  std::vector<unsigned> part = bisection_partition(g, parts);
+  std::vector<SubgraphView<G>> views;
+  views.reserve(parts);
+  for (unsigned p = 0; p < parts; ++p)
+    views.emplace_back(g, part, p);
+  return views;
+}
+
+#endif // CME212_GRAPH_PARTITION_HPP
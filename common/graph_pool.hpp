@@ -0,0 +1,185 @@
+#ifndef CME212_GRAPH_POOL_HPP
+#define CME212_GRAPH_POOL_HPP
+
+/** @file graph_pool.hpp
+ * @brief Recycled graphs for code that builds a short-lived graph per
+ *        request.
+ *
+ * Constructing and destroying a graph per query allocates and frees every
+ * array, row and table each time. A GraphPool instead hands out graphs
+ * that earlier requests gave back, emptied with clear(true) so that they
+ * keep their buffers:
+ *
+ *   GraphPool<GraphType> pool;
+ *   void handle(const query& q) {
+ *     auto g = pool.acquire();        // empty, with the old capacity
+ *     build(*g, q);
+ *     answer(*g);
+ *   }                                 // back to the pool here
+ *
+ * Once the pool holds as many graphs as there are requests in flight and
+ * each has grown to its requests' sizes, acquire() and the build no longer
+ * call the allocator. For graphs without clear(bool), the plain clear()
+ * is used, which keeps whatever that graph keeps.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace graph_pool_detail {
+
+template <typename G, typename = void>
+struct has_keep_capacity_clear : std::false_type {};
+template <typename G>
+struct has_keep_capacity_clear<G, std::void_t<decltype(std::declval<G&>().clear(true))>>
+    : std::true_type {};
+
+/** Empty @a g, keeping its storage where the graph supports it. */
+template <typename G>
+void recycle(G& g) {
+  if constexpr (has_keep_capacity_clear<G>::value)
+    g.clear(true);
+  else
+    g.clear();
+}
+
+} // end namespace graph_pool_detail
+
+
+/** Counts of a GraphPool's graphs. */
+struct graph_pool_report {
+  std::size_t created = 0;   // graphs constructed by acquire() or reserve()
+  std::size_t reused = 0;    // acquire() calls served by a returned graph
+  std::size_t dropped = 0;   // returned graphs destroyed, the pool being full
+};
+
+
+/** @class GraphPool
+ * @brief A free list of empty graphs, handed out as owning handles that
+ *        return their graph when destroyed.
+ *
+ * acquire() and the return of a handle may be called from several threads
+ * at once; each takes a mutex for a few pointer moves. A returned graph is
+ * cleared on the returning thread, outside the lock. The pool keeps at most
+ * max_idle() graphs and destroys the ones returned beyond that, and must
+ * outlive every handle it gave out.
+ *
+ * @tparam G  Default constructible graph type with clear(bool keep_capacity)
+ *            or clear().
+ */
+template <typename G>
+class GraphPool {
+ public:
+  /** Returns the graph of a handle to its pool. */
+  struct deleter {
+    GraphPool* pool;
+    void operator()(G* g) const {
+      pool->release(g);
+    }
+  };
+  /** Owning handle to a pooled graph. */
+  using handle = std::unique_ptr<G, deleter>;
+
+  /** Construct an empty pool that keeps up to @a max_idle returned graphs. */
+  explicit GraphPool(std::size_t max_idle = 64) : max_idle_(max_idle) {
+    idle_.reserve(max_idle_);
+  }
+
+  GraphPool(const GraphPool&) = delete;
+  GraphPool& operator=(const GraphPool&) = delete;
+
+  ~GraphPool() {
+    assert(outstanding_ == 0);
+    for (G* g : idle_)
+      delete g;
+  }
+
+  /** Return an empty graph: a returned one if there is any, else a new one.
+   *
+   * Complexity: O(1), plus constructing a graph when none is idle.
+   */
+  handle acquire() {
+    G* g = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++outstanding_;
+      if (!idle_.empty()) {
+        g = idle_.back();
+        idle_.pop_back();
+        ++report_.reused;
+      } else {
+        ++report_.created;
+      }
+    }
+    if (g == nullptr)
+      g = new G();
+    return handle(g, deleter{this});
+  }
+
+  /** Construct graphs until @a n are idle, e.g. one per worker thread, at
+   * most max_idle(). */
+  void reserve(std::size_t n) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (; idle_.size() < n && idle_.size() < max_idle_; ++report_.created)
+      idle_.push_back(new G());
+  }
+
+  /** Destroy every idle graph, freeing its storage. */
+  void shrink() {
+    std::vector<G*> gone;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      gone.swap(idle_);
+      idle_.reserve(max_idle_);
+    }
+    for (G* g : gone)
+      delete g;
+  }
+
+  /** Return the number of graphs ready to be handed out. */
+  std::size_t idle() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+  }
+
+  std::size_t max_idle() const {
+    return max_idle_;
+  }
+
+  /** Return the created, reused and dropped counts so far. */
+  graph_pool_report report() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return report_;
+  }
+
+ private:
+  std::size_t max_idle_;
+  mutable std::mutex mutex_;
+  // Reserved to max_idle_ up front, so returning a graph never allocates
+  std::vector<G*> idle_;
+  std::size_t outstanding_ = 0;
+  graph_pool_report report_;
+
+  /** Clear @a g and keep it, or destroy it if the pool is full. */
+  void release(G* g) {
+    graph_pool_detail::recycle(*g);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --outstanding_;
+      if (idle_.size() < max_idle_) {
+        idle_.push_back(g);
+        return;
+      }
+      ++report_.dropped;
+    }
+    delete g;
+  }
+};
+
+#endif // CME212_GRAPH_POOL_HPP
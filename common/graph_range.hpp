@@ -0,0 +1,96 @@
+#ifndef CME212_GRAPH_RANGE_HPP
+#define CME212_GRAPH_RANGE_HPP
+
+/** @file graph_range.hpp
+ * @brief An iterator and sentinel pair with a known size, returned by a
+ *        Graph's nodes(), edges() and Node::neighbors().
+ *
+ * A GraphRange is a range for range-for loops in C++17. In C++20 it is
+ * also a std::ranges view and a borrowed range, so it composes into lazy
+ * pipelines without copying the graph or allocating:
+ *
+ *   auto heavy = g.nodes()
+ *              | std::views::filter([](auto n) { return n.degree() > 8; })
+ *              | std::views::transform([](auto n) { return n.position(); });
+ *   for (Point p : heavy)
+ *     box |= p;
+ *
+ * Ranges are borrowed because their iterators refer to the graph, not to
+ * the range: they stay valid after the range object is gone, for as long
+ * as the graph itself leaves them valid.
+ */
+
+#include <cstddef>
+#include <utility>
+
+#if __cplusplus >= 202002L && __has_include(<ranges>)
+#include <ranges>
+#endif
+
+
+namespace graph_range_detail {
+
+#ifdef __cpp_lib_ranges
+using view_base = std::ranges::view_base;
+#else
+struct view_base {};
+#endif
+
+} // end namespace graph_range_detail
+
+
+/** @class GraphRange
+ * @brief The elements from an iterator up to a sentinel, @a size() of
+ *        them.
+ *
+ * @tparam It  Iterator type, default constructible.
+ * @tparam S   Sentinel type, It itself or an empty end marker It compares
+ *             equal to.
+ */
+template <typename It, typename S = It>
+class GraphRange : public graph_range_detail::view_base {
+ public:
+  using iterator = It;
+  using sentinel = S;
+  using size_type = std::size_t;
+
+  /** Construct an empty range of default constructed iterators. */
+  constexpr GraphRange() : first_(), last_(), size_(0) {
+  }
+
+  /** Construct the range [@a first, @a last) of @a size elements.
+   * @pre Incrementing @a first @a size times reaches @a last
+   */
+  constexpr GraphRange(It first, S last, size_type size)
+      : first_(std::move(first)), last_(std::move(last)), size_(size) {
+  }
+
+  constexpr It begin() const {
+    return first_;
+  }
+  constexpr S end() const {
+    return last_;
+  }
+
+  /** Return the number of elements the range visits. */
+  constexpr size_type size() const {
+    return size_;
+  }
+  constexpr bool empty() const {
+    return size_ == 0;
+  }
+
+ private:
+  It first_;
+  S last_;
+  size_type size_;
+};
+
+#ifdef __cpp_lib_ranges
+namespace std::ranges {
+template <typename It, typename S>
+inline constexpr bool enable_borrowed_range<GraphRange<It, S>> = true;
+}
+#endif
+
+#endif // CME212_GRAPH_RANGE_HPP
@@ -0,0 +1,111 @@
+#ifndef CME212_GRAPH_SNAPSHOT_HPP
+#define CME212_GRAPH_SNAPSHOT_HPP
+
+/** @file graph_snapshot.hpp
+ * @brief Stream format of Graph::serialize() and Graph::deserialize().
+ *
+ * A snapshot is the mutable graph as it sits in memory: one header followed
+ * by raw blocks, in native byte order and without padding:
+ *
+ *   positions        num_nodes points of the graph's point_type
+ *   values           num_nodes node values
+ *   edges            num_edges {source, dest} pairs of indices
+ *   edge values      num_edges edge values
+ *   degrees          num_nodes live degrees
+ *   row offsets      num_nodes + 1 offsets into the incidences
+ *   incidences       row_entries {neighbor, edge} pairs, each row sorted by
+ *                    neighbor and including tombstoned edges
+ *   removed nodes    removed_node_flags bytes, 0 or 1
+ *   removed edges    removed_edge_flags bytes, 0 or 1
+ *
+ * Unlike the graph file of mapped_graph.hpp, which is laid out for mmap and
+ * only holds frozen graphs, a snapshot is meant to be streamed: restoring
+ * it is one large read per block into presized arrays, with no sorting,
+ * hashing or add_edge() replay. The header records every element size, so
+ * a snapshot is only read back by a graph of the same types.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+
+namespace graph_snapshot {
+
+/** Bumped whenever the layout changes. */
+constexpr std::uint32_t version = 1;
+
+/** Leading block of a snapshot. */
+struct header {
+  char magic[8];                   // "CME212S" plus a terminating 0
+  std::uint32_t version;
+  std::uint32_t index_size;        // sizeof(size_type) of the writer
+  std::uint32_t offset_size;       // sizeof of its row offsets
+  std::uint32_t point_size;        // sizeof(point_type)
+  std::uint32_t value_size;        // sizeof(V)
+  std::uint32_t edge_value_size;   // sizeof(E)
+  std::uint32_t frozen;            // 1 if the graph was frozen
+  std::uint32_t reserved;
+  std::uint64_t num_nodes;
+  std::uint64_t num_edges;
+  std::uint64_t row_entries;
+  std::uint64_t num_removed_nodes;
+  std::uint64_t num_removed_edges;
+  std::uint64_t removed_node_flags;
+  std::uint64_t removed_edge_flags;
+  double compaction_threshold;
+};
+
+inline void set_magic(header& h) {
+  std::memcpy(h.magic, "CME212S", 8);
+}
+
+inline bool has_magic(const header& h) {
+  return std::memcmp(h.magic, "CME212S", 8) == 0;
+}
+
+/** Write @a bytes bytes from @a data to @a out.
+ * @throws std::runtime_error if the stream fails */
+inline void write_block(std::ostream& out, const void* data,
+                        std::size_t bytes) {
+  if (bytes != 0)
+    out.write(static_cast<const char*>(data), std::streamsize(bytes));
+  if (!out)
+    throw std::runtime_error("graph_snapshot: write failed");
+}
+
+/** Read exactly @a bytes bytes from @a in into @a data.
+ * @throws std::runtime_error if the stream ends early or fails */
+inline void read_block(std::istream& in, void* data, std::size_t bytes) {
+  if (bytes == 0)
+    return;
+  in.read(static_cast<char*>(data), std::streamsize(bytes));
+  if (!in || std::size_t(in.gcount()) != bytes)
+    throw std::runtime_error("graph_snapshot: truncated snapshot");
+}
+
+/** Check that @a h is a snapshot that a graph whose sizes are in @a expect
+ * can read.
+ * @throws std::runtime_error naming the first mismatch */
+inline void check(const header& h, const header& expect) {
+  if (!has_magic(h))
+    throw std::runtime_error("graph_snapshot: not a graph snapshot");
+  if (h.version != expect.version)
+    throw std::runtime_error("graph_snapshot: unsupported version " +
+                             std::to_string(h.version));
+  if (h.index_size != expect.index_size ||
+      h.offset_size != expect.offset_size ||
+      h.point_size != expect.point_size)
+    throw std::runtime_error("graph_snapshot: index or Point size mismatch");
+  if (h.value_size != expect.value_size ||
+      h.edge_value_size != expect.edge_value_size)
+    throw std::runtime_error("graph_snapshot: value type size mismatch");
+}
+
+} // end namespace graph_snapshot
+
+#endif // CME212_GRAPH_SNAPSHOT_HPP
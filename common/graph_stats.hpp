@@ -0,0 +1,310 @@
+#ifndef CME212_GRAPH_STATS_HPP
+#define CME212_GRAPH_STATS_HPP
+
+/** @file graph_stats.hpp
+ * @brief Opt-in operation counters and timers for Graph implementations.
+ *
+ * Instrumentation is selected at compile time. Build with
+ * -DCME212_GRAPH_STATS=1 to enable it; by default every recording call is an
+ * empty inline function and the recorder is an empty class, so instrumented
+ * code compiles to the same machine code as uninstrumented code.
+ *
+ * Besides totals, single add_node(), add_edge() and has_edge() calls are
+ * recorded in latency histograms, whose p99 and max show the occasional
+ * call that pays for regrowing an array. Calls during which an array
+ * reallocated or a hash table rehashed are recorded a second time in
+ * growth_latency, so a tail can be told apart from one such event:
+ *
+ *   const graph_stats& s = g.stats();
+ *   std::cout << s.add_edge_latency.p99() << " ns p99, "
+ *             << s.growth_latency.count() << " calls regrew\n";
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef CME212_GRAPH_STATS
+#define CME212_GRAPH_STATS 0
+#endif
+
+
+/** @class latency_histogram
+ * @brief Counts of latencies in nanoseconds, in buckets no wider than 1/16
+ *        of their lower bound, as HDR histograms keep them.
+ *
+ * Values below 32 get a bucket each; above that, every power of two is cut
+ * into 16 buckets. Percentiles are therefore within 6.25% and max() is
+ * exact. Recording is a few shifts and one increment.
+ */
+struct latency_histogram {
+  static constexpr unsigned exact = 32;   // values with a bucket each
+  static constexpr unsigned per_octave = exact / 2;
+  static constexpr unsigned buckets = exact + (64 - 5) * per_octave;
+
+  std::uint64_t counts[buckets] = {};
+  std::uint64_t total = 0;
+  std::uint64_t largest = 0;
+
+  /** Return the bucket of @a ns. */
+  static unsigned bucket(std::uint64_t ns) {
+    if (ns < exact)
+      return unsigned(ns);
+    unsigned shift = unsigned(63 - __builtin_clzll(ns)) - 4;
+    return exact + (shift - 1) * per_octave +
+           unsigned(ns >> shift) - per_octave;
+  }
+
+  /** Return the largest value bucket @a i holds. */
+  static std::uint64_t upper(unsigned i) {
+    if (i < exact)
+      return i;
+    unsigned shift = (i - exact) / per_octave + 1;
+    std::uint64_t top = per_octave + (i - exact) % per_octave + 1;
+    return (top << shift) - 1;
+  }
+
+  /** Count one call that took @a ns nanoseconds. */
+  void record(std::uint64_t ns) {
+    ++counts[bucket(ns)];
+    ++total;
+    if (ns > largest)
+      largest = ns;
+  }
+
+  /** Add the counts of @a other. */
+  void merge(const latency_histogram& other) {
+    for (unsigned i = 0; i < buckets; ++i)
+      counts[i] += other.counts[i];
+    total += other.total;
+    if (other.largest > largest)
+      largest = other.largest;
+  }
+
+  /** Return the number of calls recorded. */
+  std::uint64_t count() const {
+    return total;
+  }
+
+  /** Return the latency at or below which a fraction @a q of the calls
+   * ran, e.g. q = 0.99 for the 99th percentile; 0 if none were recorded.
+   * @pre 0 <= @a q <= 1 */
+  std::uint64_t percentile(double q) const {
+    if (total == 0)
+      return 0;
+    std::uint64_t rank = std::uint64_t(q * double(total));
+    if (double(rank) < q * double(total) || rank == 0)
+      ++rank;
+    std::uint64_t seen = 0;
+    for (unsigned i = 0; i < buckets; ++i) {
+      seen += counts[i];
+      if (seen >= rank)
+        return upper(i) < largest ? upper(i) : largest;
+    }
+    return largest;
+  }
+
+  std::uint64_t p50() const {
+    return percentile(0.5);
+  }
+  std::uint64_t p99() const {
+    return percentile(0.99);
+  }
+  std::uint64_t p999() const {
+    return percentile(0.999);
+  }
+  std::uint64_t max() const {
+    return largest;
+  }
+};
+
+
+/** Counters reported by Graph::stats(). Times are in nanoseconds. */
+struct graph_stats {
+  std::uint64_t add_node = 0;
+  std::uint64_t add_edge_new = 0;        // add_edge() calls that added an edge
+  std::uint64_t add_edge_duplicate = 0;  // add_edge() calls that found one
+  std::uint64_t has_edge = 0;
+  std::uint64_t has_edge_probes = 0;     // entries compared by has_edge()
+  std::uint64_t fetch_node = 0;
+  std::uint64_t fetch_edge = 0;
+  std::uint64_t reallocations = 0;       // node/edge array regrowths
+  std::uint64_t row_reallocations = 0;   // adjacency row regrowths
+  std::uint64_t rehashes = 0;            // edge hash table regrowths
+  std::uint64_t csr_merges = 0;          // frozen rows merged back into CSR
+
+  std::uint64_t memory_used = 0;         // bytes, as of the stats() call
+  std::uint64_t memory_reserved = 0;
+
+  std::uint64_t add_node_ns = 0;
+  std::uint64_t add_edge_ns = 0;
+  std::uint64_t has_edge_ns = 0;
+  std::uint64_t freeze_ns = 0;
+
+  latency_histogram add_node_latency;    // single add_node() calls
+  latency_histogram add_edge_latency;    // single add_edge() calls
+  latency_histogram has_edge_latency;    // single has_edge() calls
+  latency_histogram growth_latency;      // those of them that regrew storage
+};
+
+
+/** Bytes held by one part of a graph: @a used by its elements, and
+ * @a reserved for them, which includes spare capacity (used <= reserved). */
+struct memory_component {
+  std::size_t used = 0;
+  std::size_t reserved = 0;
+
+  /** Add an array of @a size elements of @a elem bytes, with room for
+   * @a capacity. */
+  void add(std::size_t size, std::size_t capacity, std::size_t elem) {
+    used += size * elem;
+    reserved += capacity * elem;
+  }
+};
+
+/** What Graph::memory_usage() reports, one component per kind of storage.
+ * Components a graph does not have stay 0. */
+struct graph_memory {
+  memory_component nodes;       // positions and values
+  memory_component edges;       // endpoint records, values and caches
+  memory_component adjacency;   // incidence rows, their headers and degrees
+  memory_component csr;         // frozen compressed rows
+  memory_component hash;        // edge hash tables: buckets and entries
+  memory_component properties;  // registered node and edge property arrays
+  memory_component other;       // tombstones, colorings, the graph object
+  /** Estimated heap bookkeeping: a 16-byte header per allocated block
+   * plus rounding of its size to 16 bytes, as glibc malloc does. */
+  std::size_t allocator_overhead = 0;
+
+  std::size_t used() const {
+    return nodes.used + edges.used + adjacency.used + csr.used + hash.used
+         + properties.used + other.used + allocator_overhead;
+  }
+  std::size_t reserved() const {
+    return nodes.reserved + edges.reserved + adjacency.reserved
+         + csr.reserved + hash.reserved + properties.reserved
+         + other.reserved + allocator_overhead;
+  }
+
+  /** Count one heap block of @a bytes toward allocator_overhead. Empty
+   * containers hold no block. */
+  void add_block(std::size_t bytes) {
+    if (bytes != 0)
+      allocator_overhead += 16 + (16 - bytes % 16) % 16;
+  }
+};
+
+
+/** @class stats_recorder
+ * @brief Collects graph_stats when @a Enabled, does nothing otherwise.
+ *
+ * A Graph keeps one recorder as a mutable member and calls it from every
+ * instrumented operation, including const ones such as has_edge().
+ */
+template <bool Enabled>
+class stats_recorder;
+
+/** Disabled recorder: empty, and every call compiles away. */
+template <>
+class stats_recorder<false> {
+ public:
+  /** Times the enclosing scope. Disabled: does nothing. */
+  struct scoped_timer {
+    scoped_timer(stats_recorder&, std::uint64_t graph_stats::*) {
+    }
+    scoped_timer(stats_recorder&, std::uint64_t graph_stats::*,
+                 latency_histogram graph_stats::*) {
+    }
+  };
+
+  void count(std::uint64_t graph_stats::*) {
+  }
+  void add(std::uint64_t graph_stats::*, std::uint64_t) {
+  }
+  void capacity_change(std::size_t, std::size_t,
+                       std::uint64_t graph_stats::* = nullptr) {
+  }
+  void set(std::uint64_t graph_stats::*, std::uint64_t) {
+  }
+  void reset() {
+  }
+
+  /** Return all-zero stats. */
+  const graph_stats& get() const {
+    static const graph_stats none;
+    return none;
+  }
+};
+
+/** Enabled recorder. */
+template <>
+class stats_recorder<true> {
+ public:
+  /** Adds the lifetime of this object, in nanoseconds, to one time field
+   * and, if given, records it in one latency histogram, and in
+   * growth_latency as well if storage regrew meanwhile. */
+  struct scoped_timer {
+    scoped_timer(stats_recorder& r, std::uint64_t graph_stats::* field,
+                 latency_histogram graph_stats::* histogram = nullptr)
+        : r_(r), field_(field), histogram_(histogram),
+          start_(std::chrono::steady_clock::now()) {
+      r_.grew_ = false;
+    }
+    ~scoped_timer() {
+      auto dt = std::chrono::steady_clock::now() - start_;
+      std::uint64_t ns = std::uint64_t(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(dt).count());
+      r_.stats_.*field_ += ns;
+      if (histogram_ != nullptr) {
+        (r_.stats_.*histogram_).record(ns);
+        if (r_.grew_)
+          r_.stats_.growth_latency.record(ns);
+      }
+    }
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer& operator=(const scoped_timer&) = delete;
+
+   private:
+    stats_recorder& r_;
+    std::uint64_t graph_stats::* field_;
+    latency_histogram graph_stats::* histogram_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  /** Increment one counter. */
+  void count(std::uint64_t graph_stats::* field) {
+    ++(stats_.*field);
+  }
+  /** Add @a n to one counter. */
+  void add(std::uint64_t graph_stats::* field, std::uint64_t n) {
+    stats_.*field += n;
+  }
+  /** Record a reallocation if a container's capacity, or a hash table's
+   * bucket count, went from @a before to @a after, in @a field: by default
+   * reallocations, else e.g. rehashes. The running timed call is then
+   * also recorded in growth_latency. */
+  void capacity_change(std::size_t before, std::size_t after,
+                       std::uint64_t graph_stats::* field = nullptr) {
+    if (before == after)
+      return;
+    ++(stats_.*(field ? field : &graph_stats::reallocations));
+    grew_ = true;
+  }
+  /** Set one counter to @a n. */
+  void set(std::uint64_t graph_stats::* field, std::uint64_t n) {
+    stats_.*field = n;
+  }
+  void reset() {
+    stats_ = graph_stats();
+  }
+
+  const graph_stats& get() const {
+    return stats_;
+  }
+
+ private:
+  graph_stats stats_;
+  bool grew_ = false;   // capacity_change() since the last timer started
+};
+
+#endif // CME212_GRAPH_STATS_HPP
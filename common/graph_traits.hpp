@@ -0,0 +1,93 @@
+#ifndef CME212_GRAPH_TRAITS_HPP
+#define CME212_GRAPH_TRAITS_HPP
+
+/** @file graph_traits.hpp
+ * @brief Compile-time tests for the optional raw-array interfaces of a
+ *        graph, so generic algorithms can take a fast path where one exists.
+ *
+ * Every algorithm in common/ runs on any Graph variant through its Node,
+ * Edge and incident iterator proxies. Some graphs also hand out their
+ * storage directly: CSR rows (common/static_graph.hpp), a contiguous
+ * position array and a degree array (hw1/Graph-24726.hpp). The traits
+ * here name those interfaces once, for algorithms to test with
+ * if constexpr and fall back to the proxies otherwise:
+ *
+ *   if constexpr (graph_traits::has_soa_positions<G>::value)
+ *     p = g.positions_data()[i];              // one load
+ *   else
+ *     p = g.node(i).position();               // through the proxy
+ *
+ *   has_csr_rows         offset(i) and neighbors_data(): node i's
+ *                        neighbors are neighbors_data()[offset(i),
+ *                        offset(i + 1)), in incident iterator order
+ *   has_soa_positions    positions_data(): the Points in index order
+ *   has_degree_array     degrees(): the degrees in index order
+ *   has_constant_degree  a degree array, CSR rows, or an O(1)
+ *                        Node::degree() it declares by specializing the
+ *                        trait
+ *   has_edge_index       edge(k) for every k < num_edges()
+ *
+ * Node::degree() alone does not make has_constant_degree true: it counts
+ * the row on some graphs (FilteredGraph), and on some Graph variants it
+ * disagrees with the incident iterators, so a graph opts in.
+ *
+ * csr_snapshot::row_offsets() and csr_snapshot::fill_neighbors() use these
+ * traits, so every algorithm that snapshots the adjacency through them
+ * (parallel_bfs.hpp, core_decomposition.hpp, force_layout.hpp, ...) takes
+ * the fast paths without testing for them itself.
+ */
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "CME212/Point.hpp"
+
+
+namespace graph_traits {
+
+/** Whether G has CSR rows: offset(i) and neighbors_data(). */
+template <typename G, typename = void>
+struct has_csr_rows : std::false_type {};
+template <typename G>
+struct has_csr_rows<G, std::void_t<
+    decltype(std::size_t(std::declval<const G&>().offset(0))),
+    decltype(std::size_t(std::declval<const G&>().neighbors_data()[0]))>>
+    : std::true_type {};
+
+/** Whether G has its positions in one array: positions_data(). */
+template <typename G, typename = void>
+struct has_soa_positions : std::false_type {};
+template <typename G>
+struct has_soa_positions<G, std::enable_if_t<std::is_convertible<
+    decltype(std::declval<const G&>().positions_data()), const Point*>::value>>
+    : std::true_type {};
+
+/** Whether G has its degrees in one array: degrees(). */
+template <typename G, typename = void>
+struct has_degree_array : std::false_type {};
+template <typename G>
+struct has_degree_array<G, std::void_t<
+    decltype(std::size_t(std::declval<const G&>().degrees()[0]))>>
+    : std::true_type {};
+
+/** Whether the degree of a node of G is O(1) to read and equal to the
+ * number of its incident edges: true with a degree array or CSR rows, and
+ * for graphs that specialize it. */
+template <typename G>
+struct has_constant_degree
+    : std::integral_constant<bool, has_degree_array<G>::value ||
+                                   has_csr_rows<G>::value> {};
+
+/** Whether the edges of G are numbered: edge(k) and num_edges(). */
+template <typename G, typename = void>
+struct has_edge_index : std::false_type {};
+template <typename G>
+struct has_edge_index<G, std::void_t<
+    decltype(std::declval<const G&>().edge(0)),
+    decltype(std::size_t(std::declval<const G&>().num_edges()))>>
+    : std::true_type {};
+
+} // end namespace graph_traits
+
+#endif // CME212_GRAPH_TRAITS_HPP
@@ -0,0 +1,209 @@
+#ifndef CME212_HALO_EXCHANGE_HPP
+#define CME212_HALO_EXCHANGE_HPP
+
+/** @file halo_exchange.hpp
+ * @brief MPI halo exchange of per-node values between the parts of a
+ *        partitioned graph.
+ *
+ * Every rank holds one SubgraphView (graph_partition.hpp), with rank r
+ * owning part r, and an array of values indexed by local node index. After
+ * the owned values change, the ghost entries are stale. HaloExchange
+ * refreshes them: each boundary value that another rank needs is packed
+ * into one contiguous send buffer per neighboring rank, and the values
+ * received come straight into the ghost range of that rank, which
+ * SubgraphView keeps contiguous, so nothing has to be unpacked.
+ *
+ * The exchange is split into start() and finish() so that work which
+ * needs no ghost values, such as updating the interior nodes, overlaps the
+ * communication:
+ *
+ *   halo.start(values.data());
+ *   update(0, view.num_interior());                 // interior nodes
+ *   halo.finish();
+ *   update(view.num_interior(), view.num_owned());  // boundary nodes
+ *
+ * exchange() runs exactly this sequence. This header needs MPI: include
+ * it only in programs built with mpicxx.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <mpi.h>
+
+#include "common/graph_partition.hpp"
+
+
+/** @class HaloExchange
+ * @brief Reusable send and receive plan for the ghosts of one part.
+ *
+ * The plan is built without communication. Edges are undirected, so the
+ * ghosts rank q holds of rank r are exactly the nodes of r adjacent to a
+ * ghost of q in r's own view, and both sides list them in global index
+ * order.
+ *
+ * @tparam T  Value type. It is sent as raw bytes, so it must be trivially
+ *            copyable.
+ */
+template <typename T>
+class HaloExchange {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "halo values are sent as raw bytes");
+
+ public:
+  /** Plan the exchange for @a view on communicator @a comm.
+   * @pre The calling rank of @a comm is view.part(), and every rank the
+   *      view has ghosts from builds the view of its own part of the same
+   *      partition
+   *
+   * Complexity: O(view.size() + number of local edges).
+   */
+  template <typename G>
+  explicit HaloExchange(const SubgraphView<G>& view,
+                        MPI_Comm comm = MPI_COMM_WORLD, int tag = 212)
+      : comm_(comm), tag_(tag), num_interior_(std::size_t(view.num_interior())),
+        num_owned_(std::size_t(view.num_owned())) {
+    int rank = 0;
+    MPI_Comm_rank(comm_, &rank);
+    assert(unsigned(rank) == view.part());
+    (void) rank;
+
+    std::size_t parts = view.ghost_parts().size();
+    std::vector<std::size_t> ghost_start(parts);
+    peers_.resize(parts);
+    for (std::size_t j = 0; j < parts; ++j) {
+      auto range = view.ghost_range(j);
+      ghost_start[j] = std::size_t(range.first);
+      peers_[j].rank = int(view.ghost_parts()[j]);
+      peers_[j].recv_first = std::size_t(range.first);
+      peers_[j].recv_count = std::size_t(range.second - range.first);
+    }
+
+    // Boundary nodes are visited in local, hence global, order, so every
+    // send list comes out sorted; last[j] drops repeats of a node
+    std::vector<std::size_t> last(parts, std::size_t(-1));
+    for (std::size_t k = num_interior_; k < num_owned_; ++k) {
+      auto nbrs = view.neighbors(typename G::size_type(k));
+      for (auto q = nbrs.first; q != nbrs.second; ++q) {
+        if (std::size_t(*q) < num_owned_)
+          continue;
+        std::size_t j = std::size_t(
+            std::upper_bound(ghost_start.begin(), ghost_start.end(),
+                             std::size_t(*q)) - ghost_start.begin()) - 1;
+        if (last[j] != k) {
+          last[j] = k;
+          peers_[j].send.push_back(k);
+        }
+      }
+    }
+
+    std::size_t total = 0;
+    for (peer& p : peers_) {
+      p.send_offset = total;
+      total += p.send.size();
+    }
+    send_buffer_.resize(total);
+    requests_.resize(2 * parts, MPI_REQUEST_NULL);
+  }
+
+  HaloExchange(const HaloExchange&) = delete;
+  HaloExchange& operator=(const HaloExchange&) = delete;
+
+  /** Wait for an exchange still in flight. */
+  ~HaloExchange() {
+    if (active_)
+      finish();
+  }
+
+  /** Return the number of ranks this part exchanges values with. */
+  std::size_t num_peers() const {
+    return peers_.size();
+  }
+
+  /** Return the number of values sent per exchange. */
+  std::size_t send_count() const {
+    return send_buffer_.size();
+  }
+
+  /** Return the number of values received per exchange, one per ghost. */
+  std::size_t recv_count() const {
+    std::size_t total = 0;
+    for (const peer& p : peers_)
+      total += p.recv_count;
+    return total;
+  }
+
+  /** Begin refreshing the ghost entries of @a values.
+   * @param[in,out] values  One value per local node of the view
+   * @pre No exchange is in flight
+   *
+   * Packs the boundary values the other ranks need and posts all sends
+   * and receives without waiting. Until finish() returns, the ghost
+   * entries of @a values must not be accessed, and the owned entries may
+   * be read and the interior ones written.
+   */
+  void start(T* values) {
+    assert(!active_);
+    for (std::size_t j = 0; j < peers_.size(); ++j) {
+      const peer& p = peers_[j];
+      MPI_Irecv(values + p.recv_first, int(p.recv_count * sizeof(T)),
+                MPI_BYTE, p.rank, tag_, comm_, &requests_[2 * j]);
+    }
+    for (std::size_t j = 0; j < peers_.size(); ++j) {
+      const peer& p = peers_[j];
+      T* out = send_buffer_.data() + p.send_offset;
+      for (std::size_t k = 0; k < p.send.size(); ++k)
+        out[k] = values[p.send[k]];
+      MPI_Isend(out, int(p.send.size() * sizeof(T)), MPI_BYTE, p.rank, tag_,
+                comm_, &requests_[2 * j + 1]);
+    }
+    active_ = true;
+  }
+
+  /** Wait until the exchange begun by start() is complete.
+   * @post The ghost entries hold the owners' values as of start()
+   */
+  void finish() {
+    assert(active_);
+    MPI_Waitall(int(requests_.size()), requests_.data(), MPI_STATUSES_IGNORE);
+    active_ = false;
+  }
+
+  /** Refresh the ghosts of @a values, calling @a interior(first, last) on
+   * the interior nodes while the messages are in flight and
+   * @a boundary(first, last) on the boundary nodes once they have
+   * arrived. Ranges are local indices.
+   */
+  template <typename Interior, typename Boundary>
+  void exchange(T* values, Interior interior, Boundary boundary) {
+    start(values);
+    interior(std::size_t(0), num_interior_);
+    finish();
+    boundary(num_interior_, num_owned_);
+  }
+
+ private:
+  // What is exchanged with one neighboring rank
+  struct peer {
+    int rank;
+    std::vector<std::size_t> send;  // local indices of the values to send
+    std::size_t send_offset;        // their place in send_buffer_
+    std::size_t recv_first;         // local index of the first ghost
+    std::size_t recv_count;
+  };
+
+  MPI_Comm comm_;
+  int tag_;
+  std::size_t num_interior_;
+  std::size_t num_owned_;
+  std::vector<peer> peers_;
+  std::vector<T> send_buffer_;
+  std::vector<MPI_Request> requests_;  // receive, send for each peer
+  bool active_ = false;
+};
+
+#endif // CME212_HALO_EXCHANGE_HPP
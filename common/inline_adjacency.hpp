@@ -0,0 +1,232 @@
+#ifndef CME212_INLINE_ADJACENCY_HPP
+#define CME212_INLINE_ADJACENCY_HPP
+
+/** @file inline_adjacency.hpp
+ * @brief Node records that hold a payload and the first few neighbor ids
+ *        together, with a shared spill pool for high-degree nodes.
+ *
+ * In a triangle mesh nearly every node has degree 8 or less. One
+ * std::vector per node row puts every row in its own heap block, so
+ * reading a node's position and then its neighbors costs two cache misses
+ * and a pointer chase. InlineAdjacency keeps one record per node:
+ *
+ *   payload     e.g. the position, 24 bytes for a Point
+ *   degree      number of neighbors
+ *   spill       where neighbors past the first N live in the pool
+ *   ids[N]      the first N neighbors
+ *
+ * With a Point payload, 32-bit ids and N = 8 that is exactly 64 bytes,
+ * and records are aligned to 64, so a typical node's position and
+ * neighbors share one cache line.
+ *
+ * Neighbors past the first N go to one pool shared by all nodes, in a
+ * chunk per spilled node that doubles when full. Outgrown chunks are left
+ * behind and reclaimed by compacting the pool once they outweigh the live
+ * ones, so the pool stays within a constant factor of the spilled
+ * neighbors.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+
+namespace inline_adjacency_detail {
+
+/** Record alignment: a cache line when the record fits in one, so no
+ * record straddles two. */
+constexpr std::size_t record_align(std::size_t size) {
+  return size <= 64 ? 64 : alignof(std::max_align_t);
+}
+
+} // end namespace inline_adjacency_detail
+
+
+/** @class InlineAdjacency
+ * @brief Per-node records of a payload and up to @a N inline neighbors.
+ *
+ * Rows keep insertion order. Walk one with degree() and neighbor(), or
+ * with for_each_neighbor(), which reads the inline ids and then the
+ * spilled ones without testing which part each id is in.
+ *
+ * @tparam P  Payload type stored with each node, e.g. Point.
+ * @tparam S  Node index type.
+ * @tparam N  Number of neighbors stored inline.
+ */
+template <typename P, typename S, std::size_t N = 8>
+class InlineAdjacency {
+  static_assert(N > 0, "InlineAdjacency needs at least one inline slot");
+
+ public:
+  using payload_type = P;
+  using size_type = S;
+
+  /** Number of neighbors each record holds inline. */
+  static constexpr std::size_t inline_degree = N;
+
+  /** Return the number of nodes. */
+  size_type size() const {
+    return size_type(records_.size());
+  }
+
+  /** Add a node with payload @a p and no neighbors.
+   * Complexity: O(1) amortized.
+   */
+  void add_node(const P& p) {
+    records_.emplace_back();
+    records_.back().payload = p;
+  }
+
+  /** Reserve room for @a n nodes. */
+  void reserve(std::size_t n) {
+    records_.reserve(n);
+  }
+
+  /** Remove all nodes. */
+  void clear() {
+    records_.clear();
+    pool_.clear();
+    waste_ = 0;
+  }
+
+  /** Return the payload of node @a a. */
+  P& payload(size_type a) {
+    return records_[a].payload;
+  }
+  const P& payload(size_type a) const {
+    return records_[a].payload;
+  }
+
+  /** Complexity: O(1). */
+  size_type degree(size_type a) const {
+    return records_[a].degree;
+  }
+
+  /** Return the @a k-th neighbor of @a a, in insertion order.
+   * @pre @a k < degree(@a a)
+   * Complexity: O(1).
+   */
+  size_type neighbor(size_type a, size_type k) const {
+    const record& r = records_[a];
+    assert(k < r.degree);
+    return k < N ? r.ids[k] : pool_[r.spill + 1 + (k - N)];
+  }
+
+  /** Call @a fn(b) for every neighbor b of @a a, in insertion order.
+   * Complexity: O(degree(a)).
+   */
+  template <typename F>
+  void for_each_neighbor(size_type a, F&& fn) const {
+    const record& r = records_[a];
+    std::size_t inline_count = std::min<std::size_t>(r.degree, N);
+    for (std::size_t k = 0; k < inline_count; ++k)
+      fn(r.ids[k]);
+    if (r.degree > N) {
+      const size_type* spilled = &pool_[r.spill + 1];
+      for (std::size_t k = 0; k < r.degree - N; ++k)
+        fn(spilled[k]);
+    }
+  }
+
+  /** Return true if @a b is a neighbor of @a a.
+   * Complexity: O(degree(a)).
+   */
+  bool contains(size_type a, size_type b) const {
+    const record& r = records_[a];
+    std::size_t inline_count = std::min<std::size_t>(r.degree, N);
+    if (std::find(r.ids, r.ids + inline_count, b) != r.ids + inline_count)
+      return true;
+    if (r.degree <= N)
+      return false;
+    const size_type* spilled = &pool_[r.spill + 1];
+    return std::find(spilled, spilled + (r.degree - N), b) !=
+           spilled + (r.degree - N);
+  }
+
+  /** Make @a a and @a b neighbors.
+   * @pre !contains(@a a, @a b) and @a a != @a b
+   * Complexity: O(1) amortized.
+   */
+  void insert(size_type a, size_type b) {
+    push(a, b);
+    push(b, a);
+  }
+
+  /** Append @a b to the row of @a a only, for directed rows.
+   * Complexity: O(1) amortized.
+   */
+  void push(size_type a, size_type b) {
+    record& r = records_[a];
+    if (r.degree < N) {
+      r.ids[r.degree++] = b;
+      return;
+    }
+    std::size_t extra = r.degree - N;
+    if (extra == 0 || extra == std::size_t(pool_[r.spill]))
+      grow(a, extra == 0 ? N : 2 * extra);
+    pool_[records_[a].spill + 1 + extra] = b;
+    ++records_[a].degree;
+  }
+
+  /** Return the number of nodes whose neighbors spill to the pool. */
+  std::size_t num_spilled() const {
+    std::size_t count = 0;
+    for (const record& r : records_)
+      count += r.degree > N;
+    return count;
+  }
+
+ private:
+  struct record_fields {
+    P payload;
+    size_type degree = 0;
+    // Offset of this node's chunk in pool_: its capacity, then the
+    // neighbors past the first N. Unused while degree <= N.
+    size_type spill = 0;
+    size_type ids[N];
+  };
+  struct alignas(inline_adjacency_detail::record_align(
+      sizeof(record_fields))) record : record_fields {
+  };
+
+  std::vector<record> records_;
+  std::vector<size_type> pool_;
+  // Pool entries in chunks that have been outgrown
+  std::size_t waste_ = 0;
+
+  /** Move the spilled neighbors of @a a to a new chunk at the end of the
+   * pool with room for @a capacity of them. */
+  void grow(size_type a, std::size_t capacity) {
+    if (waste_ > pool_.size() / 2)
+      compact();
+    std::size_t at = pool_.size();
+    pool_.resize(at + 1 + capacity);
+    pool_[at] = size_type(capacity);
+    record& r = records_[a];
+    if (r.degree > N) {
+      std::copy_n(&pool_[r.spill + 1], r.degree - N, &pool_[at + 1]);
+      waste_ += std::size_t(pool_[r.spill]) + 1;
+    }
+    r.spill = size_type(at);
+  }
+
+  /** Rewrite the pool with only the live chunks, in node order. */
+  void compact() {
+    std::vector<size_type> live;
+    live.reserve(pool_.size() - waste_);
+    for (record& r : records_) {
+      if (r.degree <= N)
+        continue;
+      std::size_t capacity = pool_[r.spill];
+      std::size_t at = live.size();
+      live.insert(live.end(), pool_.begin() + r.spill,
+                  pool_.begin() + r.spill + 1 + capacity);
+      r.spill = size_type(at);
+    }
+    pool_.swap(live);
+    waste_ = 0;
+  }
+};
+
+#endif // CME212_INLINE_ADJACENCY_HPP
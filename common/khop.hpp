@@ -0,0 +1,260 @@
+#ifndef CME212_KHOP_HPP
+#define CME212_KHOP_HPP
+
+/** @file khop.hpp
+ * @brief Batched k-hop neighborhood queries that allocate nothing per
+ *        query.
+ *
+ * Feature extraction asks for the nodes within k hops of millions of
+ * seeds. Collecting each neighborhood in a std::set and walking the
+ * incident iterators recursively allocates a tree node per result and
+ * visits nodes reached by several paths once per path. KHopEngine answers
+ * a whole batch of seeds from a CSR snapshot instead:
+ *
+ *   KHopEngine<Graph<V>> khop(g);
+ *   std::vector<std::size_t> offsets;
+ *   std::vector<Graph<V>::size_type> nodes;
+ *   khop.query(seeds.data(), seeds.size(), 2, offsets, nodes);
+ *   // the 2-hop neighborhood of seeds[s] is nodes[offsets[s], offsets[s + 1])
+ *
+ * Every thread keeps a visited array of 32-bit stamps. A query marks the
+ * nodes it reaches with the thread's current stamp and starts by bumping
+ * the stamp, which forgets the previous query's marks without touching
+ * them; the array is cleared only when the stamp wraps, once every 2^32 - 1
+ * queries. Each neighborhood is found by a breadth first search whose queue
+ * is its own slice of the thread's result buffer, so after the first batch
+ * has grown the buffers to their working size a query allocates nothing.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/trace.hpp"
+
+
+/** Tuning knobs for KHopEngine. */
+struct khop_options {
+  /** Worker threads. 0 means the size of ThreadPool::shared(). */
+  unsigned threads = 0;
+  /** List each seed first in its own neighborhood. */
+  bool include_seed = false;
+  /** Stop a neighborhood after this many nodes, 0 for no limit, to bound
+   * the cost of seeds next to hubs. The nodes kept are the nearest ones. */
+  std::size_t limit = 0;
+};
+
+/** What one batch did and how fast. */
+struct khop_report {
+  std::uint64_t seeds = 0;
+  std::uint64_t results = 0;          // nodes written, over all seeds
+  std::uint64_t edges = 0;            // incidences scanned
+  std::uint64_t truncated = 0;        // neighborhoods cut off at the limit
+  double seconds = 0;
+};
+
+
+/** @class KHopEngine
+ * @brief Reusable batched k-hop neighborhood queries over a snapshot of a
+ *        graph's adjacency.
+ *
+ * The constructor copies the neighbor lists into one CSR array, as
+ * BfsEngine does; changes to the graph after construction are not seen.
+ * Per-thread visited stamps and result buffers live in the engine and are
+ * reused by every query() call, which is therefore not safe to call from
+ * several threads at once on one engine.
+ *
+ * @tparam G  Graph type with size(), node(i).edge_begin()/edge_end() and
+ *            size_type.
+ */
+template <typename G>
+class KHopEngine {
+ public:
+  /** Type of node indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Snapshot the adjacency of @a g.
+   *
+   * Complexity: O(g.size() + g.num_edges()), spread over the threads.
+   */
+  explicit KHopEngine(const G& g, const khop_options& opt = khop_options())
+      : opt_(opt), threads_(csr_snapshot::thread_count(opt.threads)),
+        n_(std::size_t(g.size())),
+        offsets_(csr_snapshot::row_offsets(g, threads_)) {
+    neighbors_.resize(offsets_[n_]);
+    csr_snapshot::fill_neighbors(g, offsets_, threads_, neighbors_.data());
+  }
+
+  /** Return the number of nodes in the snapshot. */
+  size_type size() const {
+    return size_type(n_);
+  }
+
+  /** Find the nodes within @a k hops of each of @a count seeds.
+   * @param[in]  seeds    Array of @a count node indices
+   * @param[out] offsets  Resized to @a count + 1; the neighborhood of
+   *                      seeds[s] is nodes[offsets[s], offsets[s + 1])
+   * @param[out] nodes    Resized to offsets[count]. Each neighborhood lists
+   *                      every node at 1 to @a k hops from its seed once,
+   *                      nearer hops first, preceded by the seed itself
+   *                      with khop_options::include_seed.
+   * @return Counts and timing of the batch
+   *
+   * @pre Every seed < size()
+   *
+   * The seeds are split into one contiguous range per thread, so each
+   * thread's results form one block of @a nodes and are copied there in
+   * one pass. @a offsets and @a nodes are only reallocated when they lack
+   * the capacity, so reusing them across batches keeps the whole call
+   * free of allocations once the buffers have grown.
+   *
+   * Complexity: O(sum of the edges within k - 1 hops of each seed), spread
+   * over the threads.
+   */
+  khop_report query(const size_type* seeds, std::size_t count, unsigned k,
+                    std::vector<std::size_t>& offsets,
+                    std::vector<size_type>& nodes) {
+    CME212_TRACE_SCOPE("khop");
+    auto start = std::chrono::steady_clock::now();
+    khop_report report;
+    report.seeds = count;
+    offsets.resize(count + 1);
+    unsigned threads = unsigned(std::max<std::size_t>(
+        1, std::min<std::size_t>(threads_, count)));
+    if (scratch_.size() < threads)
+      scratch_.resize(threads);
+
+    csr_snapshot::parallel_ranges(threads, count, 1,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          scratch& s = scratch_[t];
+          if (s.stamp.size() != n_)
+            s.stamp.assign(n_, 0);
+          s.results.clear();
+          s.edges = 0;
+          s.truncated = 0;
+          s.first = b;
+          s.last = e;
+          for (std::size_t i = b; i < e; ++i) {
+            offsets[i] = s.results.size();
+            search(s, seeds[i], k);
+          }
+        });
+
+    // Place each thread's block after the blocks of the threads before it
+    std::size_t total = 0;
+    for (unsigned t = 0; t < threads; ++t) {
+      scratch& s = scratch_[t];
+      s.base = total;
+      total += s.results.size();
+      report.edges += s.edges;
+      report.truncated += s.truncated;
+    }
+    nodes.resize(total);
+    offsets[count] = total;
+    csr_snapshot::parallel_ranges(threads, threads, 1,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t t = b; t < e; ++t) {
+            const scratch& s = scratch_[t];
+            for (std::size_t i = s.first; i < s.last; ++i)
+              offsets[i] += s.base;
+            std::copy(s.results.begin(), s.results.end(),
+                      nodes.begin() + s.base);
+          }
+        });
+    report.results = total;
+    report.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return report;
+  }
+
+  /** Find the nodes within @a k hops of each of @a seeds, as
+   * query(seeds.data(), seeds.size(), k, offsets, nodes). */
+  khop_report query(const std::vector<size_type>& seeds, unsigned k,
+                    std::vector<std::size_t>& offsets,
+                    std::vector<size_type>& nodes) {
+    return query(seeds.data(), seeds.size(), k, offsets, nodes);
+  }
+
+  /** Return the bytes held by the per-thread stamps and buffers. */
+  std::size_t scratch_bytes() const {
+    std::size_t bytes = 0;
+    for (const scratch& s : scratch_)
+      bytes += s.stamp.capacity() * sizeof(std::uint32_t) +
+               s.results.capacity() * sizeof(size_type);
+    return bytes;
+  }
+
+ private:
+  /** Working memory of one thread, kept between batches. */
+  struct scratch {
+    std::vector<std::uint32_t> stamp;  // stamp[v] == current: v is reached
+    std::uint32_t current = 0;
+    std::vector<size_type> results;    // the thread's neighborhoods
+    std::size_t first = 0, last = 0;   // its range of seeds
+    std::size_t base = 0;              // where its block goes in the output
+    std::uint64_t edges = 0;
+    std::uint64_t truncated = 0;
+  };
+
+  khop_options opt_;
+  unsigned threads_;
+  std::size_t n_;
+  std::vector<std::size_t> offsets_;   // row i is neighbors_[offsets_[i]..)
+  std::vector<size_type> neighbors_;
+  std::vector<scratch> scratch_;
+
+  /** Append the k-hop neighborhood of @a seed to s.results, using the
+   * appended nodes as the search queue. */
+  void search(scratch& s, size_type seed, unsigned k) {
+    assert(std::size_t(seed) < n_);
+    if (++s.current == 0) {
+      // The stamp wrapped: old marks could look current
+      std::fill(s.stamp.begin(), s.stamp.end(), 0);
+      s.current = 1;
+    }
+    std::vector<size_type>& out = s.results;
+    std::size_t begin = out.size();
+    std::size_t limit = opt_.limit ? begin + opt_.limit : std::size_t(-1);
+    s.stamp[seed] = s.current;
+    if (opt_.include_seed) {
+      if (out.size() == limit) {
+        ++s.truncated;
+        return;
+      }
+      out.push_back(seed);
+    }
+
+    // Nodes [head, tail) of out are the frontier; the seed stands in for
+    // it on the first hop, as it may not be listed
+    std::size_t head = out.size(), tail = out.size();
+    for (unsigned hop = 1; hop <= k; ++hop) {
+      std::size_t frontier = hop == 1 ? 1 : tail - head;
+      if (frontier == 0)
+        break;
+      for (std::size_t f = 0; f < frontier; ++f) {
+        size_type u = hop == 1 ? seed : out[head + f];
+        std::size_t row_end = offsets_[u + 1];
+        s.edges += row_end - offsets_[u];
+        for (std::size_t j = offsets_[u]; j < row_end; ++j) {
+          size_type v = neighbors_[j];
+          if (s.stamp[v] == s.current)
+            continue;
+          if (out.size() == limit) {
+            ++s.truncated;
+            return;
+          }
+          s.stamp[v] = s.current;
+          out.push_back(v);
+        }
+      }
+      head = hop == 1 ? head : tail;
+      tail = out.size();
+    }
+  }
+};
+
+#endif // CME212_KHOP_HPP
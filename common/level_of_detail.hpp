@@ -0,0 +1,500 @@
+#ifndef CME212_LEVEL_OF_DETAIL_HPP
+#define CME212_LEVEL_OF_DETAIL_HPP
+
+/** @file level_of_detail.hpp
+ * @brief Coarse stand-ins of a graph for drawing it zoomed out: per-level
+ *        position and edge buffers, kept in step with the fine positions,
+ *        and the choice of level by screen-space error.
+ *
+ * A viewer drawing a 50M-node mesh from far away spends its frame on
+ * edges shorter than a pixel. An LodPyramid groups the fine nodes into
+ * clusters, level by level, each cluster drawn as one vertex at the
+ * centroid of its fine nodes and joined to the clusters its fine edges
+ * reach. The clusters come from either of
+ *
+ *   a CoarseningHierarchy   its parent() maps, i.e. heavy-edge matching
+ *   spatial clustering      cubic cells of a grid whose cells double in
+ *                           size from level to level, nested, found by
+ *                           sorting the nodes' Morton keys once
+ *
+ * and every level keeps the map from the level below, its prolongation,
+ * through which the centroids and errors are restricted level by level:
+ *
+ *   LodPyramid<GraphType> lod(g);                    // spatial clusters
+ *   ...
+ *   auto r = g.changed_positions();                  // after a step
+ *   lod.update_positions(g, r.first, r.second);
+ *   std::size_t l = lod.pick_level(projection, distance, 1.0);
+ *   if (l == 0) { draw g itself }
+ *   auto d = lod.changed(l);                         // upload only that
+ *   upload(lod.positions(l) + 3 * d.first, 3 * (d.second - d.first));
+ *   lod.clear_changes();
+ *
+ * A level's error is a bound on how far any fine node lies from the
+ * vertex of its cluster. pick_level() returns the coarsest level whose
+ * error projects to at most the given number of pixels, so only the detail
+ * the screen can show is drawn, and only the clusters whose fine nodes
+ * moved are uploaded again.
+ *
+ * Level 0 is the fine graph itself, which the viewer draws from its own
+ * arrays; the pyramid holds buffers for levels 1 and up only.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common/coarsening.hpp"
+#include "common/csr_snapshot.hpp"
+#include "common/dirty_range.hpp"
+#include "common/space_filling_curve.hpp"
+#include "common/trace.hpp"
+#include "CME212/Point.hpp"
+
+
+/** Tuning knobs for LodPyramid. */
+struct lod_options {
+  /** Worker threads. 0 means the size of ThreadPool::shared(). */
+  unsigned threads = 0;
+  /** Most levels, the fine graph included. */
+  unsigned max_levels = 12;
+  /** Stop once a level has at most this many clusters. */
+  std::size_t min_nodes = 1024;
+  /** Spatial clustering: each level keeps at most this fraction of the
+   * clusters of the level below, taking cells as large as needed. */
+  double keep = 0.25;
+};
+
+
+/** @class LodPyramid
+ * @brief Levels of clusters over the nodes of a graph, with the centroid
+ *        of every cluster, the edges between clusters and error bounds.
+ *
+ * Built once per topology; positions are refreshed by
+ * update_positions(). Buffers are plain arrays ready to upload: three
+ * floats per cluster, and two cluster indices per edge.
+ *
+ * @tparam G  Graph type with size(), node(i).position(),
+ *            node(i).edge_begin()/edge_end() and size_type.
+ */
+template <typename G>
+class LodPyramid {
+ public:
+  /** Type of node and cluster indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Cluster @a g spatially, on a grid whose cells double in size until
+   * a level has at most opt.min_nodes clusters.
+   *
+   * Complexity: O(n log n + m log m) for the n nodes and m edges, the
+   * Morton sort and the edge deduplication, spread over the threads.
+   */
+  explicit LodPyramid(const G& g, const lod_options& opt = lod_options())
+      : opt_(opt), threads_(csr_snapshot::thread_count(opt.threads)),
+        n_(std::size_t(g.size())) {
+    CME212_TRACE_SCOPE("lod_build");
+    std::vector<Point> points = fine_positions(g);
+    spatial_parents(points);
+    finish(g);
+    update_positions(g);
+  }
+
+  /** Take the clusters of @a h, which coarsens @a g: level l of the
+   * pyramid is level l of the hierarchy, up to opt.max_levels.
+   *
+   * Complexity: O(n + m log m), spread over the threads.
+   */
+  LodPyramid(const G& g, const CoarseningHierarchy<G>& h,
+             const lod_options& opt = lod_options())
+      : opt_(opt), threads_(csr_snapshot::thread_count(opt.threads)),
+        n_(std::size_t(g.size())) {
+    CME212_TRACE_SCOPE("lod_build");
+    assert(h.num_levels() == 1 || h.parent(0).size() == n_);
+    std::size_t levels = std::min<std::size_t>(h.num_levels(),
+                                               std::max(1u, opt.max_levels));
+    for (std::size_t l = 0; l + 1 < levels; ++l)
+      parents_.push_back(h.parent(l));
+    finish(g);
+    update_positions(g);
+  }
+
+  /** Return the number of levels, the fine graph included. */
+  std::size_t num_levels() const {
+    return parents_.size() + 1;
+  }
+
+  /** Return the number of clusters of level @a l, size() of the graph for
+   * level 0. */
+  std::size_t size(std::size_t l) const {
+    assert(l < num_levels());
+    return l == 0 ? n_ : counts_[l - 1].size();
+  }
+
+  /** Return the cluster of level @a l + 1 that each node or cluster of
+   * level @a l belongs to: the prolongation from level @a l + 1.
+   * @pre @a l + 1 < num_levels() */
+  const std::vector<size_type>& parent(std::size_t l) const {
+    return parents_[l];
+  }
+
+  /** Return the number of fine nodes in each cluster of level @a l.
+   * @pre 0 < @a l < num_levels() */
+  const std::vector<size_type>& counts(std::size_t l) const {
+    return counts_[l - 1];
+  }
+
+  /** Return the centroids of the clusters of level @a l as x, y, z floats,
+   * 3 size(@a l) of them.
+   * @pre 0 < @a l < num_levels() */
+  const float* positions(std::size_t l) const {
+    return positions_[l - 1].data();
+  }
+
+  /** Return the edges of level @a l as pairs of cluster indices, smaller
+   * first, each pair once and in increasing order: two clusters are joined
+   * if a fine edge joins their nodes.
+   * @pre 0 < @a l < num_levels() */
+  const std::vector<size_type>& edges(std::size_t l) const {
+    return edges_[l - 1];
+  }
+
+  /** Return a bound on the distance of any fine node from the vertex of
+   * its cluster at level @a l; 0 for level 0. */
+  double error(std::size_t l) const {
+    assert(l < num_levels());
+    return l == 0 ? 0.0 : error_[l - 1];
+  }
+
+  /** Return the coarsest level whose error, seen from @a distance, spans
+   * at most @a pixels on screen.
+   * @param[in] projection  Pixels per unit of length at unit distance,
+   *                        e.g. viewport height / (2 tan(fov_y / 2))
+   * @param[in] distance    Distance from the eye to the nearest point
+   *                        drawn
+   * @param[in] pixels      Largest error tolerated, in pixels
+   *
+   * Complexity: O(num_levels()).
+   */
+  std::size_t pick_level(double projection, double distance,
+                         double pixels) const {
+    std::size_t best = 0;
+    for (std::size_t l = 1; l < num_levels(); ++l) {
+      if (distance > 0 && error_[l - 1] * projection / distance <= pixels)
+        best = l;
+    }
+    return best;
+  }
+
+  /** Recompute the centroids and errors of every level from the positions
+   * of @a g, and mark every cluster changed.
+   * @pre @a g has the topology the pyramid was built from
+   *
+   * Complexity: O(n), spread over the threads.
+   */
+  void update_positions(const G& g) {
+    CME212_TRACE_SCOPE("lod_update");
+    for (std::size_t l = 1; l < num_levels(); ++l) {
+      double worst = 0;
+      std::vector<double> worsts(threads_, 0.0);
+      csr_snapshot::parallel_ranges(threads_, size(l), 1024,
+          [&](unsigned t, std::size_t b, std::size_t e) {
+            double w = 0;
+            for (std::size_t c = b; c < e; ++c)
+              w = std::max(w, refresh(g, l, c));
+            worsts[t] = w;
+          });
+      for (double w : worsts)
+        worst = std::max(worst, w);
+      error_[l - 1] = worst;
+      changes_[l - 1].mark(0, size_type(size(l)));
+    }
+  }
+
+  /** Recompute the clusters whose fine nodes include one of
+   * [@a first, @a last), on every level, and mark them changed.
+   * @pre @a g has the topology the pyramid was built from
+   *
+   * Errors only grow here, so a level's error stays a true bound; the
+   * next full update_positions() makes it tight again.
+   *
+   * Complexity: O(last - first + the fine nodes of the clusters
+   * recomputed), the last part spread over the threads.
+   */
+  void update_positions(const G& g, size_type first, size_type last) {
+    CME212_TRACE_SCOPE("lod_update");
+    std::vector<size_type> touched;
+    for (std::size_t i = first; i < std::min<std::size_t>(last, n_); ++i)
+      touched.push_back(size_type(i));
+    for (std::size_t l = 1; l < num_levels() && !touched.empty(); ++l) {
+      // The clusters of level l with a member in touched, each once
+      const std::vector<size_type>& up = parents_[l - 1];
+      std::vector<size_type> next;
+      next.reserve(touched.size());
+      for (size_type i : touched)
+        next.push_back(up[i]);
+      std::sort(next.begin(), next.end());
+      next.erase(std::unique(next.begin(), next.end()), next.end());
+
+      std::vector<double> worsts(threads_, 0.0);
+      csr_snapshot::parallel_ranges(threads_, next.size(), 256,
+          [&](unsigned t, std::size_t b, std::size_t e) {
+            double w = 0;
+            for (std::size_t k = b; k < e; ++k)
+              w = std::max(w, refresh(g, l, next[k]));
+            worsts[t] = w;
+          });
+      for (double w : worsts)
+        error_[l - 1] = std::max(error_[l - 1], w);
+      changes_[l - 1].mark(next.front(), next.back() + 1);
+      touched.swap(next);
+    }
+  }
+
+  /** Return the clusters of level @a l changed since clear_changes(), as
+   * one index range [first, second).
+   * @pre 0 < @a l < num_levels() */
+  std::pair<size_type, size_type> changed(std::size_t l) const {
+    return changes_[l - 1].clipped(size_type(size(l)));
+  }
+
+  /** Forget the changes of every level, e.g. once uploaded. */
+  void clear_changes() {
+    for (auto& c : changes_)
+      c.clear();
+  }
+
+ private:
+  lod_options opt_;
+  unsigned threads_;
+  std::size_t n_;
+  // parents_[l][i]: the cluster of level l + 1 of node or cluster i of l
+  std::vector<std::vector<size_type>> parents_;
+  // Per level l >= 1, at index l - 1: the members of cluster c in level
+  // l - 1 are members_[..][member_start_[..][c] .. c + 1)
+  std::vector<std::vector<std::size_t>> member_start_;
+  std::vector<std::vector<size_type>> members_;
+  std::vector<std::vector<size_type>> counts_;
+  std::vector<std::vector<float>> positions_;
+  std::vector<std::vector<float>> errors_;     // per cluster
+  std::vector<std::vector<size_type>> edges_;
+  std::vector<double> error_;
+  std::vector<DirtyRange<size_type>> changes_;
+
+  std::vector<Point> fine_positions(const G& g) const {
+    std::vector<Point> points(n_);
+    csr_snapshot::parallel_ranges(threads_, n_, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i)
+            points[i] = g.node(size_type(i)).position();
+        });
+    return points;
+  }
+
+  /** Fill parents_ with nested grid clusters of @a points: a cluster of
+   * level l is the nodes whose Morton keys agree above bit 3 s_l, for
+   * shifts s_l that grow until each level keeps at most opt_.keep of the
+   * clusters below. Clusters are numbered in key order, so the keys of
+   * one level, shifted, give the next in one pass. */
+  void spatial_parents(const std::vector<Point>& points) {
+    sfc::quantizer q(points.data(), n_);
+    std::vector<std::pair<std::uint64_t, size_type>> keyed(n_);
+    csr_snapshot::parallel_ranges(threads_, n_, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i) {
+            const Point& p = points[i];
+            keyed[i] = {sfc::morton_key(q.x(p), q.y(p), q.z(p)),
+                        size_type(i)};
+          }
+        });
+    std::sort(keyed.begin(), keyed.end());
+
+    // keys[k] is the key of node or cluster k of the current level, with
+    // order[k] the index it is known by
+    std::vector<std::uint64_t> keys(n_);
+    std::vector<size_type> order(n_);
+    for (std::size_t k = 0; k < n_; ++k) {
+      keys[k] = keyed[k].first;
+      order[k] = keyed[k].second;
+    }
+    keyed = {};
+    auto distinct = [&](unsigned shift) {
+      std::size_t c = 0;
+      for (std::size_t k = 0; k < keys.size(); ++k)
+        c += k == 0 || (keys[k] >> shift) != (keys[k - 1] >> shift);
+      return c;
+    };
+
+    unsigned shift = 0;
+    while (num_levels() < opt_.max_levels && keys.size() > opt_.min_nodes &&
+           shift < 3 * sfc::bits) {
+      std::size_t target = std::size_t(opt_.keep * double(keys.size()));
+      std::size_t count = keys.size();
+      while (shift < 3 * sfc::bits && count > target) {
+        shift += 3;
+        count = distinct(shift);
+      }
+      if (count >= keys.size())
+        break;
+
+      std::vector<size_type> parent(keys.size());
+      std::vector<std::uint64_t> next;
+      next.reserve(count);
+      for (std::size_t k = 0; k < keys.size(); ++k) {
+        std::uint64_t key = keys[k] >> shift << shift;
+        if (next.empty() || key != next.back())
+          next.push_back(key);
+        parent[order[k]] = size_type(next.size() - 1);
+      }
+      parents_.push_back(std::move(parent));
+      keys.swap(next);
+      order.resize(keys.size());
+      for (std::size_t k = 0; k < keys.size(); ++k)
+        order[k] = size_type(k);
+    }
+  }
+
+  /** Build the member lists, fine counts and edges of every level from
+   * parents_ and the edges of @a g. */
+  void finish(const G& g) {
+    std::size_t levels = parents_.size();
+    member_start_.resize(levels);
+    members_.resize(levels);
+    counts_.resize(levels);
+    positions_.resize(levels);
+    errors_.resize(levels);
+    edges_.resize(levels);
+    error_.assign(levels, 0.0);
+    changes_.assign(levels, DirtyRange<size_type>());
+
+    std::size_t below = n_;
+    for (std::size_t l = 0; l < levels; ++l) {
+      const std::vector<size_type>& up = parents_[l];
+      std::size_t nc = 0;
+      for (size_type c : up)
+        nc = std::max<std::size_t>(nc, std::size_t(c) + 1);
+      std::vector<std::size_t>& start = member_start_[l];
+      start.assign(nc + 1, 0);
+      for (size_type c : up)
+        ++start[std::size_t(c) + 1];
+      for (std::size_t c = 0; c < nc; ++c)
+        start[c + 1] += start[c];
+      members_[l].resize(below);
+      std::vector<std::size_t> next(start.begin(), start.end() - 1);
+      for (std::size_t i = 0; i < below; ++i)
+        members_[l][next[up[i]]++] = size_type(i);
+
+      counts_[l].assign(nc, 0);
+      csr_snapshot::parallel_ranges(threads_, nc, 4096,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t c = b; c < e; ++c) {
+              std::size_t fine = 0;
+              for (std::size_t k = start[c]; k < start[c + 1]; ++k)
+                fine += l == 0 ? 1 : counts_[l - 1][members_[l][k]];
+              counts_[l][c] = size_type(fine);
+            }
+          });
+      positions_[l].assign(3 * nc, 0.0f);
+      errors_[l].assign(nc, 0.0f);
+      below = nc;
+    }
+    build_edges(g);
+  }
+
+  /** Fill edges_ level by level: level 1 from the fine edges, each next
+   * level from the one below, through the parent maps. */
+  void build_edges(const G& g) {
+    if (parents_.empty())
+      return;
+    std::vector<std::size_t> offsets = csr_snapshot::row_offsets(g, threads_);
+    std::vector<size_type> neighbors(offsets[n_]);
+    csr_snapshot::fill_neighbors(g, offsets, threads_, neighbors.data());
+    std::vector<std::uint64_t> keys;
+    keys.reserve(offsets[n_] / 2);
+    const std::vector<size_type>& up = parents_[0];
+    for (std::size_t a = 0; a < n_; ++a) {
+      for (std::size_t k = offsets[a]; k < offsets[a + 1]; ++k) {
+        std::size_t b = neighbors[k];
+        if (b > a && up[a] != up[b])
+          keys.push_back(pack(up[a], up[b]));
+      }
+    }
+    offsets = {};
+    neighbors = {};
+    for (std::size_t l = 0; l < parents_.size(); ++l) {
+      std::sort(keys.begin(), keys.end());
+      keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+      std::vector<size_type>& out = edges_[l];
+      out.resize(2 * keys.size());
+      for (std::size_t k = 0; k < keys.size(); ++k) {
+        out[2 * k] = size_type(keys[k] >> 32);
+        out[2 * k + 1] = size_type(keys[k] & 0xFFFFFFFFu);
+      }
+      if (l + 1 == parents_.size())
+        break;
+      // The next level's edges, dropping those inside one cluster
+      const std::vector<size_type>& next = parents_[l + 1];
+      std::size_t kept = 0;
+      for (std::uint64_t key : keys) {
+        size_type a = next[key >> 32], b = next[key & 0xFFFFFFFFu];
+        if (a != b)
+          keys[kept++] = pack(a, b);
+      }
+      keys.resize(kept);
+    }
+  }
+
+  static std::uint64_t pack(size_type a, size_type b) {
+    static_assert(sizeof(size_type) <= 4,
+                  "LodPyramid packs two cluster indices in a 64-bit key");
+    if (b < a)
+      std::swap(a, b);
+    return std::uint64_t(a) << 32 | std::uint64_t(b);
+  }
+
+  /** Recompute the centroid and error of cluster @a c of level @a l from
+   * its members, fine nodes of @a g or clusters of level @a l - 1, and
+   * return the error: the largest member error plus the member's distance
+   * from the centroid, which bounds every fine node's distance. */
+  double refresh(const G& g, std::size_t l, std::size_t c) {
+    const std::vector<std::size_t>& start = member_start_[l - 1];
+    const std::vector<size_type>& members = members_[l - 1];
+    auto member = [&](size_type i, double& weight, double& err) {
+      if (l == 1) {
+        weight = 1;
+        err = 0;
+        return Point(g.node(i).position());
+      }
+      const float* p = &positions_[l - 2][3 * std::size_t(i)];
+      weight = double(counts_[l - 2][i]);
+      err = errors_[l - 2][i];
+      return Point(p[0], p[1], p[2]);
+    };
+
+    Point sum(0, 0, 0);
+    double total = 0, weight, err;
+    for (std::size_t k = start[c]; k < start[c + 1]; ++k) {
+      Point p = member(members[k], weight, err);
+      sum += p * weight;
+      total += weight;
+    }
+    Point center = total > 0 ? sum / total : sum;
+    double worst = 0;
+    for (std::size_t k = start[c]; k < start[c + 1]; ++k) {
+      Point p = member(members[k], weight, err);
+      worst = std::max(worst, err + norm(p - center));
+    }
+    float* out = &positions_[l - 1][3 * c];
+    out[0] = float(center.x);
+    out[1] = float(center.y);
+    out[2] = float(center.z);
+    // Round up, so the float stays a bound
+    errors_[l - 1][c] = std::nextafter(float(worst), 1e30f);
+    return double(errors_[l - 1][c]);
+  }
+};
+
+#endif // CME212_LEVEL_OF_DETAIL_HPP
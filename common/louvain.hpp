@@ -0,0 +1,469 @@
+#ifndef CME212_LOUVAIN_HPP
+#define CME212_LOUVAIN_HPP
+
+/** @file louvain.hpp
+ * @brief Parallel Louvain community detection by modularity over weighted
+ *        CSR rows.
+ *
+ * Every level alternates two phases. Local moving puts each node into the
+ * neighboring community that raises the modularity
+ *
+ *   Q = sum over communities c of  in_c / 2m - gamma (tot_c / 2m)^2
+ *
+ * the most, where in_c is the weight of the edges inside c counted from
+ * both ends, tot_c the summed weighted degree of its members and 2m the
+ * summed weighted degree of the graph. Aggregation then merges every
+ * community into one node of the next level with coarsening.hpp's
+ * contract_groups(); the weight inside a community becomes a self loop of
+ * its node. The levels stop once local moving leaves every node where it
+ * is:
+ *
+ *   auto comm = g.make_node_property<Graph<int>::size_type>();
+ *   louvain_report r = louvain(g, comm);        // comm[n] = community of n
+ *
+ * A sweep of local moving is synchronous: every node picks its target from
+ * the communities as they were when the sweep started, in parallel, and
+ * the moves are applied together. Each thread sums the weights from a
+ * node to its neighboring communities in its own small hash table. Two
+ * nodes alone in their communities only move into each other's in one
+ * direction, toward the smaller community id, so singletons do not swap
+ * forever. Simultaneous moves can still work against each other, mostly
+ * in the first sweeps of a level: a sweep that lowers the modularity is
+ * undone and retried with only a pseudo-random half of the nodes allowed
+ * to move, down to 1/16 of them, after which the level ends. Ties go to
+ * the smaller community id, so the result does not depend on the number
+ * of threads.
+ *
+ * With stored_weight the weights of a frozen Graph come straight from
+ * view_csr() and weights_view() (hw1/Graph-24726.hpp); any other functor is
+ * called on the incident edges, as for LaplacianOperator.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/coarsening.hpp"
+#include "common/csr_snapshot.hpp"
+#include "common/laplacian.hpp"
+#include "common/trace.hpp"
+
+
+/** Tuning knobs for louvain(). */
+struct louvain_options {
+  /** Worker threads. 0 means std::thread::hardware_concurrency(). */
+  unsigned threads = 0;
+  /** Most levels, the input graph included. */
+  unsigned max_levels = 32;
+  /** Most sweeps of local moving per level. */
+  unsigned max_sweeps = 32;
+  /** A level stops sweeping once a sweep raises Q by less than this. */
+  double tolerance = 1e-6;
+  /** Weight gamma of the expected edges in Q; larger values give more,
+   * smaller communities. */
+  double resolution = 1.0;
+};
+
+/** What one clustering found and how fast. */
+struct louvain_report {
+  std::uint64_t communities = 0;  // distinct ids, isolated nodes included
+  unsigned levels = 0;            // levels with at least one move
+  std::uint64_t sweeps = 0;       // sweeps of local moving, all levels
+  std::uint64_t moves = 0;        // node moves kept, all levels
+  double modularity = 0;          // Q of the result
+  double seconds = 0;             // wall time, including the label fill
+};
+
+/** Edge weight read from Edge::weight(), for graphs with stored weights.
+ * louvain() reads the whole array at once where the graph offers it. */
+struct stored_weight {
+  template <typename Edge>
+  double operator()(const Edge& e) const {
+    return double(e.weight());
+  }
+};
+
+
+namespace louvain_detail {
+
+template <typename G, typename = void>
+struct has_view_csr : std::false_type {};
+template <typename G>
+struct has_view_csr<G, std::void_t<
+    decltype(std::declval<const G&>().view_csr().weights)>>
+    : std::true_type {};
+
+/** Open-addressing map from community id to summed weight, cleared in
+ * time proportional to what was inserted. One per thread. */
+template <typename S>
+class gain_table {
+ public:
+  /** Empty the table and make room for @a n distinct keys. */
+  void reset(std::size_t n) {
+    for (std::size_t slot : used_)
+      key_[slot] = empty;
+    used_.clear();
+    std::size_t want = 16;
+    while (want < 2 * n)
+      want *= 2;
+    if (want > key_.size()) {
+      key_.assign(want, empty);
+      sum_.resize(want);
+    }
+    mask_ = key_.size() - 1;
+  }
+
+  /** Add @a w to the weight of community @a c. */
+  void add(S c, double w) {
+    std::size_t slot = hash(c) & mask_;
+    while (key_[slot] != c && key_[slot] != empty)
+      slot = (slot + 1) & mask_;
+    if (key_[slot] == empty) {
+      key_[slot] = c;
+      sum_[slot] = 0;
+      used_.push_back(slot);
+    }
+    sum_[slot] += w;
+  }
+
+  /** Return the weight of community @a c, 0 if it was never added. */
+  double get(S c) const {
+    std::size_t slot = hash(c) & mask_;
+    while (key_[slot] != empty) {
+      if (key_[slot] == c)
+        return sum_[slot];
+      slot = (slot + 1) & mask_;
+    }
+    return 0;
+  }
+
+  /** Call @a fn(c, w) for every community added since reset(), in the
+   * order they were first added. */
+  template <typename Fn>
+  void for_each(Fn fn) const {
+    for (std::size_t slot : used_)
+      fn(key_[slot], sum_[slot]);
+  }
+
+ private:
+  static constexpr S empty = S(-1);
+  std::vector<S> key_;
+  std::vector<double> sum_;
+  std::vector<std::size_t> used_;
+  std::size_t mask_ = 0;
+
+  static std::size_t hash(S c) {
+    std::uint64_t x = std::uint64_t(c) * 0x9E3779B97F4A7C15ull;
+    return std::size_t(x >> 29);
+  }
+};
+
+/** Return the weighted rows of @a g, from the CSR weights of a frozen
+ * graph when @a weight is stored_weight and it has them. */
+template <typename S, typename G, typename Weight>
+coarsening_detail::weighted_rows<S> read_rows(const G& g, Weight weight,
+                                              unsigned threads) {
+  coarsening_detail::weighted_rows<S> rows;
+  std::size_t n = std::size_t(g.size());
+  if constexpr (std::is_same<Weight, stored_weight>::value &&
+                has_view_csr<G>::value) {
+    auto v = g.view_csr();
+    if (v.valid() && v.weights != nullptr) {
+      rows.off.resize(n + 1);
+      for (std::size_t i = 0; i <= n; ++i)
+        rows.off[i] = std::size_t(v.offsets[i]);
+      rows.nbr.resize(v.nnz());
+      rows.w.resize(v.nnz());
+      csr_snapshot::parallel_ranges(threads, v.nnz(), 1 << 14,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for (std::size_t k = b; k < e; ++k) {
+              rows.nbr[k] = S(v.neighbor(k));
+              rows.w[k] = double(v.weights[k]);
+            }
+          });
+      return rows;
+    }
+  }
+  rows.off = csr_snapshot::row_offsets(g, threads);
+  rows.nbr.resize(rows.off.back());
+  rows.w.resize(rows.off.back());
+  csr_snapshot::fill_rows(g, rows.off, threads,
+      [&](std::size_t k, const auto& e) {
+        rows.nbr[k] = S(e.node2().index());
+        rows.w[k] = double(weight(e));
+      });
+  return rows;
+}
+
+/** One level of the clustering: its rows, the self loop weight of every
+ * node (the weight inside the community it stands for, from both ends),
+ * and every node's community. */
+template <typename S>
+struct level_state {
+  coarsening_detail::weighted_rows<S> rows;
+  std::vector<double> loop;
+  std::vector<double> degree;     // summed row weight plus loop
+  std::vector<S> comm;
+  std::vector<double> tot;        // summed degree of each community
+  std::vector<std::size_t> size;  // members of each community
+  double m2 = 0;                  // summed degree of all nodes
+};
+
+/** Share of the nodes, out of 2^16, below which a level gives up
+ * retrying sweeps with fewer movers. */
+constexpr std::uint32_t min_allowed = 1u << 12;
+
+/** Return a pseudo-random 16-bit number for node @a u in sweep @a sweep,
+ * which picks the nodes allowed to move once sweeps are thinned out. */
+inline std::uint32_t mover_hash(std::size_t u, unsigned sweep) {
+  std::uint64_t x = (std::uint64_t(u) << 8) ^ sweep;
+  x *= 0x9E3779B97F4A7C15ull;
+  return std::uint32_t(x >> 48);
+}
+
+/** Return the modularity of the communities of @a L. */
+template <typename S>
+double modularity(const level_state<S>& L, double gamma, unsigned threads) {
+  if (L.m2 <= 0)
+    return 0;
+  std::size_t n = L.rows.size();
+  std::vector<double> in(n);
+  csr_snapshot::parallel_ranges(threads, n, 1024,
+      [&](unsigned, std::size_t b, std::size_t e) {
+        for (std::size_t u = b; u < e; ++u) {
+          double s = L.loop[u];
+          for (std::size_t k = L.rows.off[u]; k < L.rows.off[u + 1]; ++k) {
+            if (L.comm[L.rows.nbr[k]] == L.comm[u])
+              s += L.rows.w[k];
+          }
+          in[u] = s;
+        }
+      });
+  // Summed in index order, so Q does not depend on the thread count
+  double q = 0;
+  for (std::size_t u = 0; u < n; ++u)
+    q += in[u] / L.m2 - gamma * (L.tot[u] / L.m2) * (L.tot[u] / L.m2);
+  return q;
+}
+
+} // end namespace louvain_detail
+
+
+/** Label every node of @a g with the id of its community, as found by
+ * Louvain modularity optimization.
+ * @param[out] community  Receives community[i] for every node index i
+ * @param[in]  weight     Edge weight functor on the incident Edges, as for
+ *                        LaplacianOperator: unit_weight, stored_weight, or
+ *                        any functor giving both orientations one weight
+ * @return Number of communities, levels, final modularity and timing
+ *
+ * @tparam Labels  Indexable by node index with at least g.size() entries,
+ *                 e.g. a NodeProperty<size_type> from make_node_property()
+ *                 or a std::vector<size_type>
+ *
+ * @post community[i] < r.communities, every id in use; ids are numbered in
+ *       order of the smallest node index of each community
+ *
+ * Weights must not be negative. The result does not depend on the number
+ * of threads. Reading the graph from several threads must be safe, which
+ * holds as long as operation counting (CME212_GRAPH_STATS) is off.
+ *
+ * Complexity: O((n + m) / threads) per sweep, with the levels shrinking
+ * geometrically on graphs with community structure.
+ */
+template <typename G, typename Labels, typename Weight = unit_weight>
+louvain_report louvain(const G& g, Labels& community,
+                       const louvain_options& opt = louvain_options(),
+                       Weight weight = Weight()) {
+  using namespace louvain_detail;
+  using size_type = typename G::size_type;
+  CME212_TRACE_SCOPE("louvain");
+  auto start = std::chrono::steady_clock::now();
+  unsigned threads = csr_snapshot::thread_count(opt.threads);
+  const double gamma = opt.resolution;
+  std::size_t n0 = std::size_t(g.size());
+  louvain_report report;
+
+  level_state<size_type> L;
+  L.rows = read_rows<size_type>(g, weight, threads);
+  L.loop.assign(n0, 0.0);
+  // label[i] is the node of the current level that node i of g is part of
+  std::vector<size_type> label(n0);
+  for (std::size_t i = 0; i < n0; ++i)
+    label[i] = size_type(i);
+
+  std::vector<gain_table<size_type>> tables(threads);
+  std::vector<std::vector<size_type>> moved(threads);
+  double q = 0;
+  for (unsigned lvl = 0; lvl < opt.max_levels; ++lvl) {
+    std::size_t n = L.rows.size();
+    L.degree.resize(n);
+    csr_snapshot::parallel_ranges(threads, n, 1024,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t u = b; u < e; ++u) {
+            double d = L.loop[u];
+            for (std::size_t k = L.rows.off[u]; k < L.rows.off[u + 1]; ++k)
+              d += L.rows.w[k];
+            L.degree[u] = d;
+          }
+        });
+    L.m2 = 0;
+    for (std::size_t u = 0; u < n; ++u)
+      L.m2 += L.degree[u];
+    L.comm.resize(n);
+    L.tot = L.degree;
+    L.size.assign(n, 1);
+    for (std::size_t u = 0; u < n; ++u)
+      L.comm[u] = size_type(u);
+    q = modularity(L, gamma, threads);
+    if (L.m2 <= 0)
+      break;
+
+    std::vector<size_type> target(n);
+    std::uint64_t level_moves = 0;
+    // Nodes whose mover_hash() is below this may move in a sweep
+    std::uint32_t allowed = 1u << 16;
+    for (unsigned sweep = 0; sweep < opt.max_sweeps; ++sweep) {
+      ++report.sweeps;
+      csr_snapshot::parallel_ranges(threads, n, 256,
+          [&](unsigned t, std::size_t b, std::size_t e) {
+            gain_table<size_type>& table = tables[t];
+            for (std::size_t u = b; u < e; ++u) {
+              size_type a = L.comm[u];
+              target[u] = a;
+              std::size_t first = L.rows.off[u], last = L.rows.off[u + 1];
+              if (first == last || mover_hash(u, sweep) >= allowed)
+                continue;
+              table.reset(last - first + 1);
+              table.add(a, 0.0);
+              for (std::size_t k = first; k < last; ++k) {
+                if (L.rows.nbr[k] != size_type(u))
+                  table.add(L.comm[L.rows.nbr[k]], L.rows.w[k]);
+              }
+              // Gain of joining c, against the graph without u:
+              // k_{u,c} - gamma k_u tot_c / 2m
+              double ku = L.degree[u];
+              double scale = gamma * ku / L.m2;
+              double best = table.get(a) - scale * (L.tot[a] - ku);
+              size_type best_c = a;
+              table.for_each([&](size_type c, double w) {
+                if (c == a)
+                  return;
+                double gain = w - scale * L.tot[c];
+                if (gain > best || (gain == best && c < best_c)) {
+                  best = gain;
+                  best_c = c;
+                }
+              });
+              // Two singletons only merge toward the smaller id
+              if (best_c != a && L.size[a] == 1 && L.size[best_c] == 1 &&
+                  best_c > a)
+                best_c = a;
+              target[u] = best_c;
+            }
+          });
+
+      for (auto& list : moved)
+        list.clear();
+      csr_snapshot::parallel_ranges(threads, n, 4096,
+          [&](unsigned t, std::size_t b, std::size_t e) {
+            for (std::size_t u = b; u < e; ++u) {
+              if (target[u] != L.comm[u])
+                moved[t].push_back(size_type(u));
+            }
+          });
+      std::uint64_t count = 0;
+      for (const auto& list : moved) {
+        for (size_type u : list) {
+          size_type a = L.comm[u], c = target[u];
+          L.tot[a] -= L.degree[u];
+          L.tot[c] += L.degree[u];
+          --L.size[a];
+          ++L.size[c];
+          L.comm[u] = c;
+          target[u] = a;
+        }
+        count += list.size();
+      }
+      if (count == 0)
+        break;
+      double next = modularity(L, gamma, threads);
+      if (next < q) {
+        // Simultaneous moves can work against each other; undo the
+        // sweep. target[u] now holds the community u left.
+        for (const auto& list : moved) {
+          for (size_type u : list) {
+            size_type c = L.comm[u], a = target[u];
+            L.tot[c] -= L.degree[u];
+            L.tot[a] += L.degree[u];
+            --L.size[c];
+            ++L.size[a];
+            L.comm[u] = a;
+          }
+        }
+        if (allowed <= min_allowed)
+          break;
+        allowed /= 2;
+        continue;
+      }
+      level_moves += count;
+      double gain = next - q;
+      q = next;
+      if (gain < opt.tolerance)
+        break;
+    }
+    if (level_moves == 0)
+      break;
+    report.moves += level_moves;
+    ++report.levels;
+
+    // Number the communities densely, in order of their smallest member
+    const size_type none = size_type(-1);
+    std::vector<size_type> dense(n, none);
+    std::vector<size_type> parent(n);
+    std::size_t nc = 0;
+    for (std::size_t u = 0; u < n; ++u) {
+      size_type c = L.comm[u];
+      if (dense[c] == none)
+        dense[c] = size_type(nc++);
+      parent[u] = dense[c];
+    }
+    std::vector<double> inside;
+    coarsening_detail::weighted_rows<size_type> coarse =
+        coarsening_detail::contract_groups(L.rows, parent, nc, threads, &inside);
+    for (std::size_t u = 0; u < n; ++u)
+      inside[parent[u]] += L.loop[u];
+    csr_snapshot::parallel_ranges(threads, n0, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i)
+            label[i] = parent[label[i]];
+        });
+    L.rows = std::move(coarse);
+    L.loop = std::move(inside);
+  }
+
+  // The nodes of the last level are the communities, already numbered by
+  // smallest member at every level, so by smallest node of g
+  std::vector<size_type> id(L.rows.size(), size_type(-1));
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < n0; ++i) {
+    if (id[label[i]] == size_type(-1))
+      id[label[i]] = size_type(count++);
+  }
+  csr_snapshot::parallel_ranges(threads, n0, 4096,
+      [&](unsigned, std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i)
+          community[i] = id[label[i]];
+      });
+  report.communities = count;
+  report.modularity = q;
+  report.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return report;
+}
+
+#endif // CME212_LOUVAIN_HPP
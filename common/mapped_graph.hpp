@@ -0,0 +1,449 @@
+#ifndef CME212_MAPPED_GRAPH_HPP
+#define CME212_MAPPED_GRAPH_HPP
+
+/** @file mapped_graph.hpp
+ * @brief Binary graph file format and a zero-copy, memory-mapped reader.
+ *
+ * A graph file is one header followed by six 64-byte aligned sections,
+ * all in native byte order:
+ *
+ *   positions       num_nodes Points, in node index order
+ *   values          num_nodes node values (trivially copyable V only)
+ *   edges           num_edges {source, dest} pairs of 32-bit node indices
+ *   edge values     num_edges edge values (trivially copyable E only)
+ *   csr offsets     num_nodes + 1 32-bit offsets into the incidences
+ *   csr incidences  2 * num_edges {neighbor, edge} pairs of 32-bit indices,
+ *                   each row sorted by neighbor
+ *
+ * Graph::save_binary() writes this layout straight from a frozen graph and
+ * Graph::open_mapped() returns a MappedGraph over it. Opening a file maps it
+ * and checks the header; nothing is parsed or allocated per element.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/graph_traits.hpp"
+#include "common/sorted_search.hpp"
+#include "CME212/Util.hpp"
+#include "CME212/Point.hpp"
+
+
+namespace graph_file {
+
+/** Bumped whenever the layout changes. */
+constexpr std::uint32_t version = 2;
+/** Alignment of every section. */
+constexpr std::uint64_t section_align = 64;
+
+/** Leading block of a graph file. */
+struct header {
+  char magic[8];              // "CME212G" plus a terminating 0
+  std::uint32_t version;
+  std::uint32_t point_size;   // sizeof(Point) of the writer
+  std::uint32_t value_size;   // sizeof(V) of the writer
+  std::uint32_t edge_value_size;  // sizeof(E) of the writer
+  std::uint64_t num_nodes;
+  std::uint64_t num_edges;
+  std::uint64_t positions_offset;
+  std::uint64_t values_offset;
+  std::uint64_t edges_offset;
+  std::uint64_t edge_values_offset;
+  std::uint64_t csr_offsets_offset;
+  std::uint64_t csr_incidences_offset;
+  std::uint64_t file_size;
+};
+
+/** One edge record. */
+struct edge_record {
+  std::uint32_t source;
+  std::uint32_t dest;
+};
+
+/** One CSR incidence record. */
+struct incidence_record {
+  std::uint32_t node;
+  std::uint32_t edge;
+};
+
+inline void set_magic(header& h) {
+  std::memcpy(h.magic, "CME212G", 8);
+}
+
+inline bool has_magic(const header& h) {
+  return std::memcmp(h.magic, "CME212G", 8) == 0;
+}
+
+/** Round @a n up to a multiple of section_align. */
+inline std::uint64_t align_up(std::uint64_t n) {
+  return (n + section_align - 1) / section_align * section_align;
+}
+
+/** Fill in the section offsets of @a h for its node and edge counts. */
+inline void layout(header& h) {
+  std::uint64_t at = align_up(sizeof(header));
+  h.positions_offset = at;
+  at = align_up(at + h.num_nodes * h.point_size);
+  h.values_offset = at;
+  at = align_up(at + h.num_nodes * h.value_size);
+  h.edges_offset = at;
+  at = align_up(at + h.num_edges * sizeof(edge_record));
+  h.edge_values_offset = at;
+  at = align_up(at + h.num_edges * h.edge_value_size);
+  h.csr_offsets_offset = at;
+  at = align_up(at + (h.num_nodes + 1) * sizeof(std::uint32_t));
+  h.csr_incidences_offset = at;
+  h.file_size = at + 2 * h.num_edges * sizeof(incidence_record);
+}
+
+/** @class writer
+ * @brief Writes the sections of a graph file at their laid-out offsets. */
+class writer {
+ public:
+  /** Create @a path and write @a h.
+   * @throws std::runtime_error if the file cannot be created or written
+   */
+  writer(const std::string& path, const header& h)
+      : path_(path), file_(std::fopen(path.c_str(), "wb")) {
+    if (!file_)
+      throw std::runtime_error("graph_file: cannot create " + path);
+    write_at(0, &h, sizeof(h));
+  }
+
+  ~writer() {
+    if (file_)
+      std::fclose(file_);
+  }
+
+  writer(const writer&) = delete;
+  writer& operator=(const writer&) = delete;
+
+  /** Write @a bytes bytes from @a data at file offset @a offset. */
+  void write_at(std::uint64_t offset, const void* data, std::size_t bytes) {
+    if (std::fseek(file_, long(offset), SEEK_SET) != 0 ||
+        (bytes != 0 && std::fwrite(data, 1, bytes, file_) != bytes))
+      throw std::runtime_error("graph_file: cannot write " + path_);
+  }
+
+  /** Extend the file to @a size bytes and flush it. */
+  void finish(std::uint64_t size) {
+    if (std::fflush(file_) != 0 || ftruncate(fileno(file_), off_t(size)) != 0)
+      throw std::runtime_error("graph_file: cannot write " + path_);
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+
+ private:
+  std::string path_;
+  std::FILE* file_;
+};
+
+} // end namespace graph_file
+
+
+/** @class MappedGraph
+ * @brief A frozen graph served directly from a memory-mapped graph file.
+ *
+ * Provides the read side of the Graph interface for a graph stored with
+ * Graph::save_binary(): nodes with position() and value(), edges with
+ * value(), incident iterators over the sorted CSR rows, and has_edge(). The
+ * topology is fixed but positions and node and edge values are writable. The file is mapped privately, so
+ * writes are copy-on-write and never reach the file.
+ *
+ * @tparam V  Node value type. Must be trivially copyable and match the
+ *            value type the file was written with.
+ * @tparam E  Edge value type, likewise.
+ */
+template <typename V, typename E = double>
+class MappedGraph {
+  static_assert(std::is_trivially_copyable<V>::value,
+                "MappedGraph requires a trivially copyable node value type");
+  static_assert(std::is_trivially_copyable<E>::value,
+                "MappedGraph requires a trivially copyable edge value type");
+  static_assert(std::is_trivially_copyable<Point>::value,
+                "MappedGraph requires a trivially copyable Point");
+
+ public:
+  using size_type = unsigned;
+  using node_value_type = V;
+  using edge_value_type = E;
+  using graph_type = MappedGraph;
+
+  class Node;
+  class Edge;
+  class IncidentIterator;
+  using node_type = Node;
+  using edge_type = Edge;
+  using incident_iterator = IncidentIterator;
+
+  /** Map the graph file at @a path.
+   * @throws std::runtime_error if the file cannot be opened or mapped, is
+   *         not a graph file, or was written with a different Point, V or E
+   *
+   * Complexity: O(1) -- pages are faulted in lazily as they are touched.
+   */
+  explicit MappedGraph(const std::string& path) : base_(nullptr), bytes_(0) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("MappedGraph: cannot open " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || std::size_t(st.st_size) < sizeof(header_)) {
+      ::close(fd);
+      throw std::runtime_error("MappedGraph: not a graph file: " + path);
+    }
+    bytes_ = std::size_t(st.st_size);
+    void* p = ::mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                     fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+      throw std::runtime_error("MappedGraph: cannot map " + path);
+    base_ = static_cast<char*>(p);
+
+    std::memcpy(&header_, base_, sizeof(header_));
+    if (!graph_file::has_magic(header_) ||
+        header_.version != graph_file::version ||
+        header_.point_size != sizeof(Point) ||
+        header_.value_size != sizeof(V) ||
+        header_.edge_value_size != sizeof(E) ||
+        header_.file_size > bytes_) {
+      unmap();
+      throw std::runtime_error("MappedGraph: incompatible graph file " + path);
+    }
+    positions_ = reinterpret_cast<Point*>(base_ + header_.positions_offset);
+    values_ = reinterpret_cast<V*>(base_ + header_.values_offset);
+    edges_ = reinterpret_cast<const graph_file::edge_record*>(
+        base_ + header_.edges_offset);
+    edge_values_ = reinterpret_cast<E*>(base_ + header_.edge_values_offset);
+    offsets_ = reinterpret_cast<const std::uint32_t*>(
+        base_ + header_.csr_offsets_offset);
+    incidences_ = reinterpret_cast<const graph_file::incidence_record*>(
+        base_ + header_.csr_incidences_offset);
+  }
+
+  MappedGraph(MappedGraph&& x) noexcept
+      : base_(x.base_), bytes_(x.bytes_), header_(x.header_),
+        positions_(x.positions_), values_(x.values_), edges_(x.edges_),
+        edge_values_(x.edge_values_), offsets_(x.offsets_), incidences_(x.incidences_) {
+    x.base_ = nullptr;
+    x.bytes_ = 0;
+  }
+
+  MappedGraph(const MappedGraph&) = delete;
+  MappedGraph& operator=(const MappedGraph&) = delete;
+
+  ~MappedGraph() {
+    unmap();
+  }
+
+  /** @class MappedGraph::Node
+   * @brief {graph, index} proxy for a mapped node. */
+  class Node : private totally_ordered<Node> {
+   public:
+    Node() : graph_(nullptr), index_(0) {
+    }
+
+    const Point& position() const { return graph_->positions_[index_]; }
+    Point& position() { return graph_->positions_[index_]; }
+    const V& value() const { return graph_->values_[index_]; }
+    V& value() { return graph_->values_[index_]; }
+    size_type index() const { return index_; }
+
+    /** Return the number of incident edges. Complexity: O(1). */
+    size_type degree() const {
+      return graph_->offsets_[index_ + 1] - graph_->offsets_[index_];
+    }
+
+    /** Iterate the incident edges, in increasing neighbor index order. */
+    incident_iterator edge_begin() const {
+      return IncidentIterator(graph_, index_,
+                              graph_->incidences_ + graph_->offsets_[index_]);
+    }
+    incident_iterator edge_end() const {
+      return IncidentIterator(graph_, index_,
+                              graph_->incidences_ + graph_->offsets_[index_ + 1]);
+    }
+
+    bool operator==(const Node& n) const {
+      return graph_ == n.graph_ && index_ == n.index_;
+    }
+    bool operator<(const Node& n) const {
+      return graph_ != n.graph_ ? graph_ < n.graph_ : index_ < n.index_;
+    }
+
+   private:
+    friend class MappedGraph;
+    MappedGraph* graph_;
+    size_type index_;
+    Node(const MappedGraph* g, size_type i)
+        : graph_(const_cast<MappedGraph*>(g)), index_(i) {
+    }
+  };
+
+  /** @class MappedGraph::Edge
+   * @brief Proxy for a mapped edge, oriented from node1() to node2(). */
+  class Edge : private totally_ordered<Edge> {
+   public:
+    Edge() : graph_(nullptr), index_(0), n1_(0), n2_(0) {
+    }
+
+    Node node1() const { return Node(graph_, n1_); }
+    Node node2() const { return Node(graph_, n2_); }
+    /** Return the index of this edge, in [0, num_edges()). */
+    size_type index() const { return index_; }
+    /** Return the value of this edge, shared by both orientations. */
+    E& value() { return graph_->edge_values_[index_]; }
+    const E& value() const { return graph_->edge_values_[index_]; }
+
+    /** Return the distance between the two endpoints. */
+    double length() const {
+      return norm(node1().position() - node2().position());
+    }
+
+    bool operator==(const Edge& e) const {
+      return graph_ == e.graph_ && index_ == e.index_;
+    }
+    bool operator<(const Edge& e) const {
+      return graph_ != e.graph_ ? graph_ < e.graph_ : index_ < e.index_;
+    }
+
+   private:
+    friend class MappedGraph;
+    MappedGraph* graph_;
+    size_type index_;
+    size_type n1_;
+    size_type n2_;
+    Edge(const MappedGraph* g, size_type i, size_type n1, size_type n2)
+        : graph_(const_cast<MappedGraph*>(g)), index_(i), n1_(n1), n2_(n2) {
+    }
+  };
+
+  /** @class MappedGraph::IncidentIterator
+   * @brief Walks one CSR row. Yields Edges with node1() == the row's node. */
+  class IncidentIterator : private totally_ordered<IncidentIterator> {
+   public:
+    using value_type        = Edge;
+    using pointer           = Edge*;
+    using reference         = Edge;
+    using difference_type   = std::ptrdiff_t;
+    using iterator_category = std::random_access_iterator_tag;
+
+    IncidentIterator() : graph_(nullptr), node_(0), pos_(nullptr) {
+    }
+
+    Edge operator*() const {
+      return Edge(graph_, pos_->edge, node_, pos_->node);
+    }
+    Edge operator[](difference_type n) const { return *(*this + n); }
+    IncidentIterator& operator++() { ++pos_; return *this; }
+    IncidentIterator operator++(int) { auto t = *this; ++pos_; return t; }
+    IncidentIterator& operator--() { --pos_; return *this; }
+    IncidentIterator operator--(int) { auto t = *this; --pos_; return t; }
+    IncidentIterator& operator+=(difference_type n) { pos_ += n; return *this; }
+    IncidentIterator& operator-=(difference_type n) { pos_ -= n; return *this; }
+    IncidentIterator operator+(difference_type n) const {
+      auto t = *this;
+      return t += n;
+    }
+    IncidentIterator operator-(difference_type n) const {
+      auto t = *this;
+      return t -= n;
+    }
+    difference_type operator-(const IncidentIterator& x) const {
+      return pos_ - x.pos_;
+    }
+    bool operator==(const IncidentIterator& x) const { return pos_ == x.pos_; }
+    bool operator<(const IncidentIterator& x) const { return pos_ < x.pos_; }
+
+   private:
+    friend class MappedGraph;
+    const MappedGraph* graph_;
+    size_type node_;
+    const graph_file::incidence_record* pos_;
+    IncidentIterator(const MappedGraph* g, size_type n,
+                     const graph_file::incidence_record* pos)
+        : graph_(g), node_(n), pos_(pos) {
+    }
+  };
+
+  size_type size() const { return size_type(header_.num_nodes); }
+  size_type num_nodes() const { return size(); }
+  size_type num_edges() const { return size_type(header_.num_edges); }
+
+  /** Return the node with index @a i.
+   * @pre @a i < num_nodes()
+   */
+  Node node(size_type i) const {
+    assert(i < num_nodes());
+    return Node(this, i);
+  }
+
+  /** Return the edge with index @a i.
+   * @pre @a i < num_edges()
+   */
+  Edge edge(size_type i) const {
+    assert(i < num_edges());
+    return Edge(this, i, edges_[i].source, edges_[i].dest);
+  }
+
+  /** Test whether @a a and @a b are connected by an edge.
+   *
+   * Complexity: O(log a.degree()), by searching a's sorted CSR row.
+   */
+  bool has_edge(const Node& a, const Node& b) const {
+    const graph_file::incidence_record* row = incidences_ + offsets_[a.index_];
+    return sorted_contains(row, a.degree(), b.index_, record_neighbor());
+  }
+
+  /** Return the contiguous array of node positions. */
+  Point* positions_data() { return positions_; }
+  const Point* positions_data() const { return positions_; }
+  /** Return the contiguous array of node values. */
+  V* values_data() { return values_; }
+  const V* values_data() const { return values_; }
+  /** Return the contiguous array of edge values. */
+  E* edge_values_data() { return edge_values_; }
+  const E* edge_values_data() const { return edge_values_; }
+
+ private:
+  struct record_neighbor {
+    std::uint32_t operator()(const graph_file::incidence_record& r) const {
+      return r.node;
+    }
+  };
+
+  char* base_;
+  std::size_t bytes_;
+  graph_file::header header_;
+  Point* positions_;
+  V* values_;
+  const graph_file::edge_record* edges_;
+  E* edge_values_;
+  const std::uint32_t* offsets_;
+  const graph_file::incidence_record* incidences_;
+
+  void unmap() {
+    if (base_)
+      ::munmap(base_, bytes_);
+    base_ = nullptr;
+  }
+};
+
+/** Node::degree() of a MappedGraph is the length of its CSR row. */
+namespace graph_traits {
+template <typename V, typename E>
+struct has_constant_degree<MappedGraph<V, E>> : std::true_type {};
+} // end namespace graph_traits
+
+#endif // CME212_MAPPED_GRAPH_HPP
@@ -0,0 +1,495 @@
+#ifndef CME212_MAX_FLOW_HPP
+#define CME212_MAX_FLOW_HPP
+
+/** @file max_flow.hpp
+ * @brief Maximum flow and minimum cut by push-relabel, with highest-label
+ *        selection, the gap heuristic and parallel global relabeling.
+ *
+ * Augmenting-path methods such as Edmonds-Karp search the whole residual
+ * graph once per path, and a mesh cut needs as many paths as the cut has
+ * edges. FlowEngine instead runs the push-relabel method of Goldberg and
+ * Tarjan, organized as in Cherkassky and Goldberg's HIPR, "On Implementing
+ * the Push-Relabel Method for the Maximum Flow Problem" (1997):
+ *
+ *   highest label   the active node (one with excess) of largest label is
+ *                   discharged next, which bounds the work by O(n^2 m^1/2)
+ *   gap heuristic   once no node has label d, nodes above d cannot reach
+ *                   the sink any more and are lifted out of the search
+ *   global relabel  every so often the labels are reset to exact residual
+ *                   distances to the sink by a backward BFS, which runs
+ *                   level-synchronously on the threads
+ *
+ * Every edge is an arc each way, both with the edge's capacity. The
+ * residual capacities live in one array in the snapshot's CSR entry
+ * order, so residual(k) lines up with the neighbors of row i at entries
+ * [offset(i), offset(i + 1)) and the same CSR position of any other
+ * per-entry array:
+ *
+ *   FlowEngine<G> flow(g, capacity);       // e.g. [](auto e){ return e.weight(); }
+ *   flow_report r = flow.run(s, t);        // r.flow, r.cut_edges
+ *   std::vector<G::size_type> side = flow.source_side();
+ *
+ * Only the first phase of push-relabel runs: it ends with a maximum
+ * preflow, whose value is the maximum flow and whose residual graph gives
+ * the minimum cut. Excess that cannot reach the sink is not returned to
+ * the source, so the residuals are those of that preflow.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/laplacian.hpp"
+#include "common/trace.hpp"
+
+
+/** Tuning knobs for FlowEngine. */
+struct flow_options {
+  /** Worker threads for the snapshot and the global relabels. 0 means
+   * std::thread::hardware_concurrency(). Pushes and relabels run on one. */
+  unsigned threads = 0;
+  /** Relabel globally once the relabel work since the last one exceeds
+   * this fraction of 6 n + m, as HIPR does. */
+  double global_relabel_frequency = 0.5;
+};
+
+/** What one run did and how fast. */
+struct flow_report {
+  double flow = 0;                    // value of the maximum flow
+  std::uint64_t cut_edges = 0;        // edges across the minimum cut
+  std::uint64_t source_side = 0;      // nodes on the source side of it
+  std::uint64_t pushes = 0;
+  std::uint64_t relabels = 0;
+  std::uint64_t global_relabels = 0;
+  std::uint64_t gaps = 0;             // gap heuristic lifts
+  double seconds = 0;
+};
+
+
+/** @class FlowEngine
+ * @brief Reusable push-relabel max-flow over a snapshot of a graph's
+ *        adjacency and edge capacities.
+ *
+ * The constructor copies the neighbor lists into one CSR array, evaluates
+ * the capacity functor on every incident edge and pairs every entry with
+ * the entry of the same edge in the other endpoint's row. run() may then
+ * be called for any number of source and sink pairs; each starts from the
+ * full capacities. Changes to the graph after construction are not seen.
+ *
+ * Reading the graph from several threads at once must be safe, which holds
+ * for the Graph variants as long as operation counting
+ * (CME212_GRAPH_STATS) is off.
+ *
+ * @tparam G  Graph type with size(), node(i).edge_begin()/edge_end() and
+ *            size_type.
+ */
+template <typename G>
+class FlowEngine {
+ public:
+  /** Type of node indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Snapshot the adjacency of @a g with capacities @a capacity.
+   * @param[in] capacity  Functor on the incident Edges returning a
+   *                      capacity >= 0, equal for both orientations, as
+   *                      for LaplacianOperator's weights
+   *
+   * Complexity: O(g.size() + g.num_edges() log d) for degrees at most d,
+   * spread over the threads.
+   */
+  template <typename Capacity = unit_weight>
+  explicit FlowEngine(const G& g, Capacity capacity = Capacity(),
+                      const flow_options& opt = flow_options())
+      : opt_(opt), threads_(csr_snapshot::thread_count(opt.threads)),
+        n_(std::size_t(g.size())),
+        offsets_(csr_snapshot::row_offsets(g, threads_)) {
+    std::size_t entries = offsets_[n_];
+    neighbors_.resize(entries);
+    capacity_.resize(entries);
+    csr_snapshot::fill_neighbors(g, offsets_, threads_, neighbors_.data());
+    csr_snapshot::fill_rows(g, offsets_, threads_,
+        [&](std::size_t k, const auto& e) {
+          capacity_[k] = double(capacity(e));
+        });
+    pair_entries();
+    residual_ = capacity_;
+  }
+
+  /** Return the number of nodes in the snapshot. */
+  size_type size() const {
+    return size_type(n_);
+  }
+
+  /** Return the first CSR entry of node @a i; its entries end at
+   * offset(@a i + 1). */
+  std::size_t offset(size_type i) const {
+    return offsets_[i];
+  }
+  /** Return the neighbor across CSR entry @a k. */
+  size_type neighbor(std::size_t k) const {
+    return neighbors_[k];
+  }
+  /** Return the residual capacity of the arc of CSR entry @a k, from the
+   * row's node to neighbor(k), after the last run(). */
+  double residual(std::size_t k) const {
+    return residual_[k];
+  }
+  /** Return the residual capacities of all entries, in CSR order. */
+  const std::vector<double>& residuals() const {
+    return residual_;
+  }
+  /** Return the flow on the arc of CSR entry @a k, negative if it runs
+   * the other way. */
+  double flow(std::size_t k) const {
+    return capacity_[k] - residual_[k];
+  }
+
+  /** Compute a maximum flow from @a source to @a sink and the minimum cut
+   * it saturates.
+   * @return The flow value, the cut and counts of the work
+   *
+   * @pre @a source != @a sink, both < size()
+   * @post on_source_side(v) is true exactly for the nodes on the source
+   *       side of a minimum cut: those from which @a sink cannot be
+   *       reached along arcs with residual capacity left. It is the cut
+   *       closest to the sink.
+   *
+   * Complexity: O(size()^2 sqrt(number of edges)) at worst; on meshes far
+   * less, with the global relabels taking O(size() + number of edges)
+   * each, spread over the threads.
+   */
+  flow_report run(size_type source, size_type sink) {
+    assert(source != sink && std::size_t(source) < n_ &&
+           std::size_t(sink) < n_);
+    CME212_TRACE_SCOPE("max_flow");
+    auto start = std::chrono::steady_clock::now();
+    report_ = flow_report();
+    source_ = source;
+    sink_ = sink;
+    residual_ = capacity_;
+    excess_.assign(n_, 0.0);
+    label_.assign(n_, size_type(0));
+    current_.assign(offsets_.begin(), offsets_.end() - 1);
+    active_head_.assign(n_ + 1, none);
+    active_next_.assign(n_, none);
+    all_head_.assign(n_ + 1, none);
+    all_next_.assign(n_, none);
+    all_prev_.assign(n_, none);
+
+    // Saturate every arc out of the source
+    for (std::size_t k = offsets_[source]; k < offsets_[source + 1]; ++k) {
+      double c = residual_[k];
+      if (c <= 0 || neighbors_[k] == source)
+        continue;
+      residual_[k] = 0;
+      residual_[reverse_[k]] += c;
+      excess_[neighbors_[k]] += c;
+      excess_[source] -= c;
+    }
+
+    global_relabel();
+    double budget = opt_.global_relabel_frequency *
+                    double(6 * n_ + offsets_[n_]);
+    work_ = 0;
+    while (max_active_ != none) {
+      size_type v = active_head_[max_active_];
+      if (v == none) {
+        --max_active_;
+        if (max_active_ == size_type(-1))
+          max_active_ = none;
+        continue;
+      }
+      active_head_[max_active_] = active_next_[v];
+      if (label_[v] != max_active_)
+        continue;
+      discharge(v);
+      if (double(work_) > budget) {
+        global_relabel();
+        work_ = 0;
+      }
+    }
+
+    // The nodes the final search reaches are the sink side of the cut
+    global_relabel();
+    report_.flow = excess_[sink];
+    for (std::size_t v = 0; v < n_; ++v) {
+      if (!on_source_side(size_type(v)))
+        continue;
+      ++report_.source_side;
+      for (std::size_t k = offsets_[v]; k < offsets_[v + 1]; ++k)
+        report_.cut_edges += !on_source_side(neighbors_[k]);
+    }
+    report_.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return report_;
+  }
+
+  /** Return true if node @a v is on the source side of the minimum cut of
+   * the last run(). */
+  bool on_source_side(size_type v) const {
+    return label_[v] >= size_type(n_);
+  }
+
+  /** Return the nodes on the source side of the minimum cut of the last
+   * run(), in increasing index order. */
+  std::vector<size_type> source_side() const {
+    std::vector<size_type> side;
+    side.reserve(report_.source_side);
+    for (std::size_t v = 0; v < n_; ++v) {
+      if (on_source_side(size_type(v)))
+        side.push_back(size_type(v));
+    }
+    return side;
+  }
+
+ private:
+  static constexpr size_type none = size_type(-1);
+
+  flow_options opt_;
+  unsigned threads_;
+  std::size_t n_;
+  std::vector<std::size_t> offsets_;   // row i is neighbors_[offsets_[i]..)
+  std::vector<size_type> neighbors_;
+  std::vector<std::size_t> reverse_;   // entry of the same edge, other way
+  std::vector<double> capacity_;
+  std::vector<double> residual_;
+
+  // State of one run. Labels are n_ for nodes that cannot reach the sink,
+  // the source among them. Active nodes (excess, label below n_) sit on a
+  // stack per label; every node below n_ but the source is also on a
+  // doubly linked list per label, which the gap heuristic empties.
+  size_type source_ = 0, sink_ = 0;
+  std::vector<double> excess_;
+  std::vector<size_type> label_;
+  std::vector<std::size_t> current_;   // next entry to push along
+  std::vector<size_type> active_head_, active_next_;
+  std::vector<size_type> all_head_, all_next_, all_prev_;
+  size_type max_active_ = none;        // no active label above it
+  size_type max_label_ = 0;            // no listed label above it
+  std::uint64_t work_ = 0;
+  flow_report report_;
+
+  /** Fill reverse_: the j-th entry of row u pointing to v pairs with the
+   * j-th entry of row v pointing to u. Parallel edges may pair up in
+   * either order, which changes nothing, as they join the same nodes. */
+  void pair_entries() {
+    std::size_t entries = offsets_[n_];
+    std::vector<std::size_t> sorted(entries);
+    csr_snapshot::parallel_ranges(threads_, n_, 1024,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t u = b; u < e; ++u) {
+            auto first = sorted.begin() + offsets_[u];
+            auto last = sorted.begin() + offsets_[u + 1];
+            for (std::size_t k = offsets_[u]; k < offsets_[u + 1]; ++k)
+              sorted[k] = k;
+            std::sort(first, last, [&](std::size_t x, std::size_t y) {
+              return neighbors_[x] < neighbors_[y] ||
+                     (neighbors_[x] == neighbors_[y] && x < y);
+            });
+          }
+        });
+    reverse_.resize(entries);
+    csr_snapshot::parallel_ranges(threads_, n_, 1024,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          auto by_neighbor = [&](std::size_t x, size_type v) {
+            return neighbors_[x] < v;
+          };
+          for (std::size_t u = b; u < e; ++u) {
+            auto row = sorted.begin() + offsets_[u];
+            auto row_end = sorted.begin() + offsets_[u + 1];
+            for (auto it = row; it != row_end; ++it) {
+              size_type v = neighbors_[*it];
+              std::size_t j = std::size_t(
+                  it - std::lower_bound(row, it, v, by_neighbor));
+              auto other = std::lower_bound(
+                  sorted.begin() + offsets_[v], sorted.begin() + offsets_[v + 1],
+                  size_type(u), by_neighbor);
+              // A self loop's entries pair with each other
+              reverse_[*it] = v == size_type(u) ? *it : other[j];
+            }
+          }
+        });
+  }
+
+  void push_active(size_type v) {
+    size_type d = label_[v];
+    active_next_[v] = active_head_[d];
+    active_head_[d] = v;
+    if (max_active_ == none || d > max_active_)
+      max_active_ = d;
+  }
+
+  void list_insert(size_type v) {
+    size_type d = label_[v];
+    all_prev_[v] = none;
+    all_next_[v] = all_head_[d];
+    if (all_head_[d] != none)
+      all_prev_[all_head_[d]] = v;
+    all_head_[d] = v;
+    max_label_ = std::max(max_label_, d);
+  }
+
+  void list_remove(size_type v) {
+    size_type d = label_[v];
+    if (all_prev_[v] != none)
+      all_next_[all_prev_[v]] = all_next_[v];
+    else
+      all_head_[d] = all_next_[v];
+    if (all_next_[v] != none)
+      all_prev_[all_next_[v]] = all_prev_[v];
+  }
+
+  /** Push the excess of @a v to lower neighbors, relabeling it when it has
+   * none left, until it has no excess or can no longer reach the sink. */
+  void discharge(size_type v) {
+    const size_type n = size_type(n_);
+    std::size_t end = offsets_[v + 1];
+    while (excess_[v] > 0) {
+      std::size_t k = current_[v];
+      for (; k < end; ++k) {
+        if (residual_[k] <= 0)
+          continue;
+        size_type w = neighbors_[k];
+        if (label_[w] + 1 != label_[v])
+          continue;
+        double delta = std::min(excess_[v], residual_[k]);
+        residual_[k] -= delta;
+        residual_[reverse_[k]] += delta;
+        if (excess_[w] == 0 && w != sink_)
+          push_active(w);
+        excess_[w] += delta;
+        excess_[v] -= delta;
+        ++report_.pushes;
+        if (excess_[v] == 0)
+          break;
+      }
+      current_[v] = k;
+      if (k < end)
+        return;
+
+      // No admissible arc left: relabel to one above the lowest
+      // neighbor with residual capacity
+      size_type old = label_[v];
+      size_type lowest = n;
+      for (std::size_t j = offsets_[v]; j < end; ++j) {
+        if (residual_[j] > 0)
+          lowest = std::min(lowest, label_[neighbors_[j]]);
+      }
+      work_ += 12 + (end - offsets_[v]);
+      ++report_.relabels;
+      list_remove(v);
+      if (all_head_[old] == none) {
+        // Gap: nothing at label old any more, so nothing above it reaches
+        // the sink
+        lift_above(old);
+        label_[v] = n;
+        ++report_.gaps;
+        return;
+      }
+      label_[v] = lowest >= n - 1 ? n : size_type(lowest + 1);
+      current_[v] = offsets_[v];
+      if (label_[v] == n)
+        return;
+      list_insert(v);
+    }
+  }
+
+  /** Give every listed node with a label above @a d the label n_. */
+  void lift_above(size_type d) {
+    for (size_type l = size_type(d + 1); l <= max_label_; ++l) {
+      for (size_type v = all_head_[l]; v != none; v = all_next_[v])
+        label_[v] = size_type(n_);
+      all_head_[l] = none;
+    }
+    max_label_ = d > 0 ? size_type(d - 1) : 0;
+  }
+
+  /** Set every label to the residual distance to the sink, or n_ where
+   * there is none, by a level-synchronous backward BFS on the threads, and
+   * rebuild the active stacks and label lists. */
+  void global_relabel() {
+    ++report_.global_relabels;
+    const size_type n = size_type(n_);
+    std::vector<std::atomic<std::uint64_t>> visited((n_ + 63) / 64);
+    csr_snapshot::parallel_ranges(threads_, n_, 64,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          std::fill(label_.begin() + b, label_.begin() + e, n);
+          for (std::size_t w = b / 64; w < (e + 63) / 64; ++w)
+            visited[w].store(0, std::memory_order_relaxed);
+        });
+    auto bit = [](std::size_t v) { return std::uint64_t(1) << (v % 64); };
+    visited[source_ / 64].fetch_or(bit(source_), std::memory_order_relaxed);
+    visited[sink_ / 64].fetch_or(bit(sink_), std::memory_order_relaxed);
+    label_[sink_] = 0;
+
+    std::vector<size_type> queue(1, sink_);
+    std::vector<std::vector<size_type>> parts(threads_);
+    for (size_type level = 1; !queue.empty(); ++level) {
+      csr_snapshot::parallel_ranges(threads_, queue.size(), 64,
+          [&](unsigned t, std::size_t b, std::size_t e) {
+            for (std::size_t i = b; i < e; ++i) {
+              size_type u = queue[i];
+              for (std::size_t k = offsets_[u]; k < offsets_[u + 1]; ++k) {
+                // v reaches u if the arc v -> u has capacity left
+                if (residual_[reverse_[k]] <= 0)
+                  continue;
+                size_type v = neighbors_[k];
+                std::atomic<std::uint64_t>& word = visited[v / 64];
+                if (word.load(std::memory_order_relaxed) & bit(v))
+                  continue;
+                if (!(word.fetch_or(bit(v), std::memory_order_relaxed) &
+                      bit(v))) {
+                  label_[v] = level;
+                  parts[t].push_back(v);
+                }
+              }
+            }
+          });
+      queue.clear();
+      for (auto& part : parts) {
+        queue.insert(queue.end(), part.begin(), part.end());
+        part.clear();
+      }
+    }
+
+    std::fill(active_head_.begin(), active_head_.end(), none);
+    std::fill(all_head_.begin(), all_head_.end(), none);
+    max_active_ = none;
+    max_label_ = 0;
+    for (std::size_t v = 0; v < n_; ++v) {
+      current_[v] = offsets_[v];
+      if (label_[v] >= n || size_type(v) == source_)
+        continue;
+      list_insert(size_type(v));
+      if (excess_[v] > 0 && size_type(v) != sink_)
+        push_active(size_type(v));
+    }
+  }
+};
+
+/** Return the value of a maximum flow from @a source to @a sink in @a g
+ * under @a capacity, and fill @a source_side with the source side of a
+ * minimum cut.
+ *
+ * Builds a FlowEngine for the one run; keep an engine around to run
+ * several.
+ */
+template <typename G, typename Capacity = unit_weight>
+double max_flow(const G& g, typename G::size_type source,
+                typename G::size_type sink,
+                std::vector<typename G::size_type>& source_side,
+                Capacity capacity = Capacity(),
+                const flow_options& opt = flow_options()) {
+  FlowEngine<G> engine(g, capacity, opt);
+  flow_report r = engine.run(source, sink);
+  source_side = engine.source_side();
+  return r.flow;
+}
+
+#endif // CME212_MAX_FLOW_HPP
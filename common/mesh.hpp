@@ -0,0 +1,310 @@
+#ifndef CME212_MESH_HPP
+#define CME212_MESH_HPP
+
+/** @file mesh.hpp
+ * @brief Triangles on top of a Graph, with triangle-edge adjacency in
+ *        compressed sparse row form.
+ *
+ * Shallow-water and FEM codes walk triangles and their neighbors across
+ * each side. Deriving those from a Graph means has_edge() probes for every
+ * combination of incident edges. A Mesh keeps the triangles in contiguous
+ * arrays next to the graph instead:
+ *
+ *   triangle t   nodes(t)       its three nodes
+ *                edges(t)       its three sides, side k joining nodes k and
+ *                               (k + 1) % 3 of the triangle
+ *                value(t)       per-triangle data, e.g. the conserved
+ *                               quantities of a finite volume scheme
+ *   mesh edge e  edge_nodes(e)  its two nodes, smaller index first
+ *                triangles(e)   the triangles that have side e, as a CSR
+ *                               slice: one for a boundary side, two inside
+ *
+ * so a flux loop runs over plain arrays:
+ *
+ *   Mesh<G, Q> mesh(g);
+ *   load_nodes(g, "tub.nodes");
+ *   load_mesh_triangles(mesh, "tub.tris");
+ *   for (size_type e = 0; e < mesh.num_edges(); ++e) {
+ *     const size_type* ts = mesh.triangles(e).begin();
+ *     if (mesh.triangles(e).size() == 2)
+ *       exchange(mesh.value(ts[0]), mesh.value(ts[1]), ...);
+ *   }
+ *
+ * Mesh edges are numbered by (smaller node, larger node), independent of
+ * the graph's own edge order. Every side is also an edge of the graph,
+ * added in bulk through add_edges() where the graph has it, so spring and
+ * Laplacian code keeps working on the same graph.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/graph_loader.hpp"
+#include "common/graph_range.hpp"
+#include "common/trace.hpp"
+
+
+/** @class Mesh
+ * @brief Triangles over the nodes of a graph, with values of type T.
+ *
+ * The mesh refers to its graph, which must outlive it. Adding triangles
+ * adds their sides to the graph and renumbers the mesh edges; node
+ * indices and triangle indices stay as they are.
+ *
+ * @tparam G  Graph type with size(), node(), and add_edge() or
+ *            add_edges(), e.g. Graph<V, E>.
+ * @tparam T  Triangle value type, default constructible.
+ */
+template <typename G, typename T = int>
+class Mesh {
+ public:
+  /** Type of node, triangle and mesh edge indices. */
+  using size_type = typename G::size_type;
+  using tri_value_type = T;
+  /** A triangle as three node indices, or three mesh edges. */
+  using triple_type = std::array<size_type, 3>;
+  using triangle_range = GraphRange<const size_type*>;
+
+  /** Index returned by neighbor() for a side on the boundary. */
+  static constexpr size_type invalid = size_type(-1);
+
+  /** Construct a mesh without triangles over @a g. */
+  explicit Mesh(G& g) : g_(&g), edge_start_(1, 0) {
+  }
+
+  /** Return the graph. */
+  G& graph() const {
+    return *g_;
+  }
+
+  size_type num_triangles() const {
+    return size_type(nodes_.size());
+  }
+  size_type num_edges() const {
+    return size_type(edge_nodes_.size());
+  }
+
+  /** Return the nodes of triangle @a t. */
+  const triple_type& nodes(size_type t) const {
+    assert(t < num_triangles());
+    return nodes_[t];
+  }
+  /** Return the mesh edges of triangle @a t; side k joins nodes(t)[k] and
+   * nodes(t)[(k + 1) % 3]. */
+  const triple_type& edges(size_type t) const {
+    assert(t < num_triangles());
+    return edges_[t];
+  }
+  /** Return the value of triangle @a t. */
+  T& value(size_type t) {
+    assert(t < num_triangles());
+    return values_[t];
+  }
+  const T& value(size_type t) const {
+    assert(t < num_triangles());
+    return values_[t];
+  }
+
+  /** Return the nodes of every triangle, num_triangles() of them. */
+  const triple_type* nodes_data() const {
+    return nodes_.data();
+  }
+  /** Return the mesh edges of every triangle, num_triangles() of them. */
+  const triple_type* edges_data() const {
+    return edges_.data();
+  }
+  /** Return the values of every triangle, num_triangles() of them. */
+  T* values_data() {
+    return values_.data();
+  }
+  const T* values_data() const {
+    return values_.data();
+  }
+
+  /** Return the two nodes of mesh edge @a e, smaller index first. */
+  const std::pair<size_type, size_type>& edge_nodes(size_type e) const {
+    assert(e < num_edges());
+    return edge_nodes_[e];
+  }
+
+  /** Return the triangles with side @a e, in increasing order. */
+  triangle_range triangles(size_type e) const {
+    assert(e < num_edges());
+    const size_type* first = edge_triangles_.data() + edge_start_[e];
+    std::size_t n = std::size_t(edge_start_[e + 1] - edge_start_[e]);
+    return triangle_range(first, first + n, n);
+  }
+
+  /** Return the triangle across side @a k of triangle @a t, or invalid if
+   * no other triangle has that side. If several do, the one with the
+   * smallest index is returned. */
+  size_type neighbor(size_type t, unsigned k) const {
+    assert(k < 3);
+    for (size_type u : triangles(edges(t)[k])) {
+      if (u != t)
+        return u;
+    }
+    return invalid;
+  }
+
+  /** Add the triangle of nodes @a a, @a b and @a c.
+   * @return Its index
+   *
+   * Complexity: as add_triangles() of one triangle; for many triangles,
+   * call add_triangles() once instead.
+   */
+  size_type add_triangle(size_type a, size_type b, size_type c) {
+    triple_type t = {a, b, c};
+    add_triangles(&t, &t + 1);
+    return num_triangles() - 1;
+  }
+
+  /** Add a triangle per element of [@a first, @a last), each three node
+   * indices, with value T().
+   * @return The index of the first new triangle
+   *
+   * @pre Every index is less than graph().size() and no triangle repeats
+   *      a node
+   * @post The new triangles follow the old ones in order, and their sides
+   *       are edges of the graph
+   *
+   * Complexity: O(g.size() + num_triangles()) on top of adding the sides
+   * to the graph.
+   */
+  template <typename InputIt>
+  size_type add_triangles(InputIt first, InputIt last) {
+    CME212_TRACE_SCOPE("mesh_add_triangles");
+    size_type begin = num_triangles();
+    pending_.clear();
+    for (; first != last; ++first) {
+      const auto& t = *first;
+      pending_.push_back(triple_type{size_type(t[0]), size_type(t[1]),
+                                     size_type(t[2])});
+    }
+    if (pending_.empty())
+      return begin;
+    graph_loader_detail::append_triangles(*g_, pending_, pairs_);
+    nodes_.insert(nodes_.end(), pending_.begin(), pending_.end());
+    values_.resize(nodes_.size());
+    number_edges();
+    return begin;
+  }
+
+  /** Remove every triangle. The graph keeps its edges. */
+  void clear() {
+    nodes_.clear();
+    edges_.clear();
+    values_.clear();
+    edge_nodes_.clear();
+    edge_start_.assign(1, 0);
+    edge_triangles_.clear();
+  }
+
+ private:
+  G* g_;
+  std::vector<triple_type> nodes_;
+  std::vector<triple_type> edges_;
+  std::vector<T> values_;
+  std::vector<std::pair<size_type, size_type>> edge_nodes_;
+  // Triangles of mesh edge e are edge_triangles_[edge_start_[e], .. e + 1)
+  std::vector<size_type> edge_start_;
+  std::vector<size_type> edge_triangles_;
+  // Staging for add_triangles()
+  std::vector<triple_type> pending_;
+  std::vector<std::pair<size_type, size_type>> pairs_;
+
+  /** Number the distinct sides of all triangles by (smaller node, larger
+   * node) and fill edges_ and the edge-to-triangle CSR arrays.
+   *
+   * The sides are counting sorted by their smaller node, then each node's
+   * short run is sorted by the larger node and triangle, so equal sides
+   * end up next to each other with their triangles in order. */
+  void number_edges() {
+    std::size_t n = std::size_t(g_->size());
+    std::size_t m = 3 * nodes_.size();
+    std::vector<size_type> start(n + 1, 0);
+    for (const triple_type& t : nodes_) {
+      for (unsigned k = 0; k < 3; ++k) {
+        assert(t[k] < n && t[k] != t[(k + 1) % 3]);
+        ++start[std::min(t[k], t[(k + 1) % 3]) + 1];
+      }
+    }
+    for (std::size_t i = 0; i < n; ++i)
+      start[i + 1] += start[i];
+
+    // Side (t, k) as 3 t + k, bucketed by its smaller node
+    std::vector<size_type> sides(m);
+    std::vector<size_type> next(start.begin(), start.end() - 1);
+    for (std::size_t s = 0; s < m; ++s) {
+      const triple_type& t = nodes_[s / 3];
+      unsigned k = unsigned(s % 3);
+      sides[next[std::min(t[k], t[(k + 1) % 3])]++] = size_type(s);
+    }
+    auto larger = [&](size_type s) {
+      const triple_type& t = nodes_[s / 3];
+      unsigned k = s % 3;
+      return std::max(t[k], t[(k + 1) % 3]);
+    };
+    for (std::size_t i = 0; i < n; ++i) {
+      std::sort(sides.begin() + start[i], sides.begin() + start[i + 1],
+                [&](size_type x, size_type y) {
+                  size_type lx = larger(x), ly = larger(y);
+                  return lx < ly || (lx == ly && x < y);
+                });
+    }
+
+    edges_.resize(nodes_.size());
+    edge_nodes_.clear();
+    edge_start_.clear();
+    edge_triangles_.resize(m);
+    for (std::size_t i = 0; i < n; ++i) {
+      for (size_type j = start[i]; j < start[i + 1]; ++j) {
+        size_type s = sides[j];
+        size_type b = larger(s);
+        if (j == start[i] || larger(sides[j - 1]) != b) {
+          edge_start_.push_back(j);
+          edge_nodes_.emplace_back(size_type(i), b);
+        }
+        edges_[s / 3][s % 3] = size_type(edge_nodes_.size() - 1);
+        edge_triangles_[j] = s / 3;
+      }
+    }
+    edge_start_.push_back(size_type(m));
+  }
+};
+
+
+/** Add a triangle per line of the triangle file @a path to @a mesh, whose
+ * sides become edges of its graph, in one add_triangles() call once the
+ * file is parsed.
+ * @return bytes, triangles and wall time of the load
+ * @throws std::runtime_error if the file cannot be read or has a line that
+ *         is not three non-negative integers
+ *
+ * @pre Every index in the file is less than mesh.graph().size() and no
+ *      triangle repeats a node
+ */
+template <typename G, typename T>
+load_report load_mesh_triangles(Mesh<G, T>& mesh, const std::string& path,
+                                const load_options& opt = load_options()) {
+  using size_type = typename G::size_type;
+  CME212_TRACE_SCOPE("load_mesh_triangles");
+  graph_loader_detail::chunk_reader reader(path, opt.chunk_bytes);
+  std::vector<std::array<size_type, 3>> all;
+  load_report report = graph_loader_detail::pipeline<size_type, 3>(
+      reader, opt, [&](const std::vector<std::array<size_type, 3>>& recs) {
+        all.insert(all.end(), recs.begin(), recs.end());
+      });
+  auto start = std::chrono::steady_clock::now();
+  mesh.add_triangles(all.begin(), all.end());
+  report.seconds += std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return report;
+}
+
+#endif // CME212_MESH_HPP
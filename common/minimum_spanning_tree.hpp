@@ -0,0 +1,213 @@
+#ifndef CME212_MINIMUM_SPANNING_TREE_HPP
+#define CME212_MINIMUM_SPANNING_TREE_HPP
+
+/** @file minimum_spanning_tree.hpp
+ * @brief Multithreaded minimum spanning forest by Boruvka's algorithm over
+ *        the edge array.
+ *
+ * Kruskal's algorithm sorts every edge before it can pick the first one.
+ * Boruvka's instead runs in rounds: every component picks its lightest edge
+ * to another component, all picked edges join the forest at once, and the
+ * edges inside the merged components are dropped. Each round at least
+ * halves the number of components, so there are at most log2(n) rounds,
+ * and each is one parallel pass over the edges still left:
+ *
+ *   std::vector<GraphType::size_type> tree;
+ *   mst_report r = minimum_spanning_tree(g, tree);      // edge indices
+ *   for (auto k : tree)
+ *     use(g.edge(k));
+ *
+ * Components are the trees of the lock-free union-find of
+ * connected_components.hpp. Picking the lightest edge of a component is a
+ * compare-and-swap minimum per root, with ties broken by edge index, which
+ * makes the edge order total, the forest unique and the result independent
+ * of the number of threads. Edge weights come from a weight functor, as
+ * for DeltaStepping: euclidean_weight (the default), edge_value_weight or
+ * stored_weight.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "common/connected_components.hpp"
+#include "common/csr_snapshot.hpp"
+#include "common/delta_stepping.hpp"
+#include "common/trace.hpp"
+
+
+/** Tuning knobs for minimum_spanning_tree(). */
+struct mst_options {
+  /** Worker threads. 0 means std::thread::hardware_concurrency(). */
+  unsigned threads = 0;
+};
+
+/** What one spanning forest holds and how fast it was found. */
+struct mst_report {
+  std::uint64_t edges = 0;    // edges in the forest
+  std::uint64_t trees = 0;    // components, isolated nodes included
+  std::uint64_t rounds = 0;   // Boruvka rounds
+  double weight = 0;          // total weight of the forest
+  double seconds = 0;         // wall time, including the weight pass
+};
+
+
+/** Fill @a tree with the indices of the edges of a minimum spanning forest
+ * of @a g, one tree per connected component.
+ * @param[out] tree    Receives the edge indices, in increasing order
+ * @param[in] weight   Edge weight functor, as for DeltaStepping
+ * @return Counts, total weight and timing
+ *
+ * @pre @a weight returns a finite value for every edge
+ * @post tree.size() == g.size() - (number of components)
+ *
+ * Edges removed by lazy_remove_edge() are left out. Reading the graph from
+ * several threads must be safe, which holds as long as operation counting
+ * (CME212_GRAPH_STATS) is off.
+ *
+ * Complexity: O(g.size() + g.num_edges()) weight evaluations, and
+ * O((g.size() + g.num_edges()) log g.size() / threads) work at worst;
+ * far fewer on meshes, whose edges mostly drop out after a few rounds.
+ */
+template <typename G, typename Weight = euclidean_weight>
+mst_report minimum_spanning_tree(const G& g,
+                                 std::vector<typename G::size_type>& tree,
+                                 Weight weight = Weight(),
+                                 const mst_options& opt = mst_options()) {
+  using namespace connected_components_detail;
+  using size_type = typename G::size_type;
+  CME212_TRACE_SCOPE("minimum_spanning_tree");
+  auto start = std::chrono::steady_clock::now();
+  unsigned threads = csr_snapshot::thread_count(opt.threads);
+  std::size_t n = std::size_t(g.size());
+  std::size_t m = std::size_t(g.num_edges());
+  const size_type none = size_type(-1);
+
+  // Endpoints of every edge still in play, in edge order; w[k] is the
+  // weight of edge k
+  struct candidate {
+    size_type a;
+    size_type b;
+    size_type edge;
+  };
+  std::vector<double> w(m);
+  std::vector<std::vector<candidate>> parts(threads);
+  bool tombstones = false;
+  if constexpr (has_edge_tombstones<G>::value)
+    tombstones = g.num_removed_edges() != 0;
+  csr_snapshot::parallel_ranges(threads, m, 4096,
+      [&](unsigned t, std::size_t b, std::size_t e) {
+        parts[t].reserve(e - b);
+        for (std::size_t k = b; k < e; ++k) {
+          auto edge = g.edge(size_type(k));
+          if constexpr (has_edge_tombstones<G>::value) {
+            if (tombstones && g.is_removed(edge))
+              continue;
+          }
+          w[k] = double(weight(edge));
+          size_type i = edge.node1().index();
+          size_type j = edge.node2().index();
+          if (i != j)
+            parts[t].push_back({i, j, size_type(k)});
+        }
+      });
+  std::vector<candidate> live;
+  for (auto& p : parts)
+    live.insert(live.end(), p.begin(), p.end());
+
+  // The total order that makes the lightest edge of a component unique
+  auto lighter = [&](size_type e, size_type f) {
+    return w[e] < w[f] || (w[e] == w[f] && e < f);
+  };
+
+  forest<size_type> f(n, threads);
+  std::unique_ptr<std::atomic<size_type>[]> best(new std::atomic<size_type>[n]);
+  std::vector<size_type> root(n);
+  csr_snapshot::parallel_ranges(threads, n, 4096,
+      [&](unsigned, std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i) {
+          best[i].store(none, std::memory_order_relaxed);
+          root[i] = size_type(i);
+        }
+      });
+
+  mst_report report;
+  tree.clear();
+  std::vector<std::vector<size_type>> picked(threads);
+  while (!live.empty()) {
+    ++report.rounds;
+
+    // Lightest edge out of every component, as a CAS minimum at its root
+    auto offer = [&](size_type r, size_type e) {
+      size_type cur = best[r].load(std::memory_order_relaxed);
+      while (cur == none || lighter(e, cur)) {
+        if (best[r].compare_exchange_weak(cur, e, std::memory_order_relaxed))
+          return;
+      }
+    };
+    csr_snapshot::parallel_ranges(threads, live.size(), 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t k = b; k < e; ++k) {
+            const candidate& c = live[k];
+            offer(root[c.a], c.edge);
+            offer(root[c.b], c.edge);
+          }
+        });
+
+    // Join along each picked edge, once even if both of its components
+    // picked it. The order being total, the picked edges form no cycle.
+    csr_snapshot::parallel_ranges(threads, live.size(), 4096,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for (std::size_t k = b; k < e; ++k) {
+            const candidate& c = live[k];
+            size_type ra = root[c.a];
+            size_type rb = root[c.b];
+            if (best[ra].load(std::memory_order_relaxed) == c.edge ||
+                best[rb].load(std::memory_order_relaxed) == c.edge) {
+              f.link(ra, rb);
+              picked[t].push_back(c.edge);
+            }
+          }
+        });
+    for (auto& p : picked) {
+      tree.insert(tree.end(), p.begin(), p.end());
+      p.clear();
+    }
+
+    // New roots, then drop the edges inside a component
+    csr_snapshot::parallel_ranges(threads, n, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i) {
+            root[i] = f.find(size_type(i));
+            best[i].store(none, std::memory_order_relaxed);
+          }
+        });
+    for (auto& p : parts)
+      p.clear();
+    csr_snapshot::parallel_ranges(threads, live.size(), 4096,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for (std::size_t k = b; k < e; ++k)
+            if (root[live[k].a] != root[live[k].b])
+              parts[t].push_back(live[k]);
+        });
+    live.clear();
+    for (auto& p : parts)
+      live.insert(live.end(), p.begin(), p.end());
+  }
+
+  std::sort(tree.begin(), tree.end());
+  report.edges = tree.size();
+  report.trees = n - tree.size();
+  for (size_type k : tree)
+    report.weight += w[k];
+  report.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return report;
+}
+
+#endif // CME212_MINIMUM_SPANNING_TREE_HPP
@@ -0,0 +1,116 @@
+#ifndef CME212_NODE_LAYOUT_HPP
+#define CME212_NODE_LAYOUT_HPP
+
+/** @file node_layout.hpp
+ * @brief How a graph stores its per-node fields: one record per node, or
+ *        the often read fields apart from the rarely read ones.
+ *
+ * A node record that holds the position next to the value makes every
+ * cache line a pass over positions loads carry values it never reads. The
+ * node workloads of bench/graph_bench.cpp show which field is hot:
+ * NeighborPositions, SpringForces, EdgeLengths and SymplecticStep read
+ * positions only, and only NodeAccess reads values as well. A graph takes
+ * its layout as a policy; the default, split_node_layout, keeps positions
+ * in a dense array of their own:
+ *
+ *   Graph<double> g;                              // split, the default
+ *   Graph<double, interleaved_node_layout> h;     // one record per node
+ *
+ * Each layout is a tag whose storage<P, V> holds the positions and values
+ * of all nodes, indexed by node index. Both have the same interface, so a
+ * graph reads position(i) and value(i) without knowing which it has.
+ */
+
+#include <cstddef>
+#include <vector>
+
+
+/** Positions in one dense array and values in another. A pass over
+ * positions reads nothing else, and positions() hands them out as one
+ * contiguous array. */
+struct split_node_layout {
+  template <typename P, typename V>
+  class storage {
+   public:
+    P& position(std::size_t i) {
+      return positions_[i];
+    }
+    const P& position(std::size_t i) const {
+      return positions_[i];
+    }
+    V& value(std::size_t i) {
+      return values_[i];
+    }
+    const V& value(std::size_t i) const {
+      return values_[i];
+    }
+
+    /** Return the contiguous array of positions. */
+    const P* positions() const {
+      return positions_.data();
+    }
+
+    std::size_t size() const {
+      return positions_.size();
+    }
+    void push_back(const P& p, const V& v) {
+      positions_.push_back(p);
+      values_.push_back(v);
+    }
+    void reserve(std::size_t n) {
+      positions_.reserve(n);
+      values_.reserve(n);
+    }
+    void clear() {
+      positions_.clear();
+      values_.clear();
+    }
+
+   private:
+    std::vector<P> positions_;  // hot: read by every geometric pass
+    std::vector<V> values_;     // cold: read by the algorithms that use them
+  };
+};
+
+/** One record of position and value per node. Suits access patterns that
+ * read both fields of each node they visit. */
+struct interleaved_node_layout {
+  template <typename P, typename V>
+  class storage {
+   public:
+    P& position(std::size_t i) {
+      return nodes_[i].position;
+    }
+    const P& position(std::size_t i) const {
+      return nodes_[i].position;
+    }
+    V& value(std::size_t i) {
+      return nodes_[i].value;
+    }
+    const V& value(std::size_t i) const {
+      return nodes_[i].value;
+    }
+
+    std::size_t size() const {
+      return nodes_.size();
+    }
+    void push_back(const P& p, const V& v) {
+      nodes_.push_back(record{p, v});
+    }
+    void reserve(std::size_t n) {
+      nodes_.reserve(n);
+    }
+    void clear() {
+      nodes_.clear();
+    }
+
+   private:
+    struct record {
+      P position;
+      V value;
+    };
+    std::vector<record> nodes_;
+  };
+};
+
+#endif // CME212_NODE_LAYOUT_HPP
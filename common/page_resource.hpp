@@ -0,0 +1,393 @@
+#ifndef CME212_PAGE_RESOURCE_HPP
+#define CME212_PAGE_RESOURCE_HPP
+
+/** @file page_resource.hpp
+ * @brief A memory resource that maps large graph buffers itself, places
+ *        their pages on NUMA nodes and backs them with huge pages.
+ *
+ * Linux puts a page on the NUMA node of the thread that first writes it.
+ * A loader thread that fills a Graph's node and edge arrays therefore puts
+ * all of them on its own socket, and workers on other sockets read every
+ * page remotely. PageResource maps each buffer of at least
+ * page_options::threshold bytes with mmap() and, before handing it out,
+ * either
+ *
+ *   first_touch  writes one byte per page from each of page_options::threads
+ *                threads, slice t of the pages from thread t, so a buffer
+ *                split into that many even ranges (Graph::edge_ranges(k),
+ *                csr_snapshot::parallel_ranges()) has range t on the node
+ *                of the thread that touched it, or
+ *   interleave   asks mbind(MPOL_INTERLEAVE) to spread the pages round-robin
+ *                over all online nodes, the choice for data that every
+ *                thread reads all of.
+ *
+ * Multi-gigabyte node and edge arrays also spend much of a sweep on TLB
+ * misses with 4 KB pages. page_options::huge asks for 2 MB pages instead:
+ *
+ *   advise    maps every large buffer 2 MB-aligned and marks it with
+ *             madvise(MADV_HUGEPAGE), so transparent huge pages back it
+ *             whenever the kernel has them to give, and
+ *   reserved  takes the buffer from the preallocated huge page pool
+ *             (MAP_HUGETLB, see /proc/sys/vm/nr_hugepages), falling back to
+ *             advise when the pool is empty.
+ *
+ * huge_page_bytes() reads back from /proc/self/smaps how much of the
+ * buffers the kernel did back with huge pages.
+ *
+ * Smaller requests go to the upstream resource. Any std::pmr container, or
+ * a Graph that takes a memory resource, can use it:
+ *
+ *   PageResource pages(page_options{numa_placement::first_touch, 32});
+ *   Graph<V> g(&pages);
+ *
+ * First-touch placement helps only if the workers run on the sockets of
+ * the threads that touched their ranges; pin both to the same cores when
+ * it matters. The resource itself binds no thread.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/csr_snapshot.hpp"
+
+
+/** Where PageResource puts the pages of a large buffer. */
+enum class numa_placement {
+  none,         // wherever they are first written, as by the default heap
+  first_touch,  // slice t of the buffer on the node of touching thread t
+  interleave    // round-robin over the online NUMA nodes
+};
+
+/** Which pages PageResource backs a large buffer with. */
+enum class huge_pages {
+  none,      // base pages
+  advise,    // 2 MB-aligned, with madvise(MADV_HUGEPAGE)
+  reserved   // the MAP_HUGETLB pool, or advise when it is empty
+};
+
+/** Settings of a PageResource. */
+struct page_options {
+  numa_placement placement = numa_placement::first_touch;
+  /** Threads that touch a buffer under first_touch; 0 means one per core.
+   * Use the number of workers that will split the graph into ranges. */
+  unsigned threads = 0;
+  /** Requests of fewer bytes go to the upstream resource. */
+  std::size_t threshold = std::size_t(2) << 20;
+  /** Page size to ask for. */
+  huge_pages huge = huge_pages::none;
+  /** Resource for small requests. */
+  std::pmr::memory_resource* upstream = std::pmr::get_default_resource();
+};
+
+/** What a PageResource has mapped. */
+struct page_report {
+  std::size_t mapped_bytes = 0;        // large buffers live now
+  std::size_t peak_mapped_bytes = 0;
+  std::uint64_t buffers = 0;           // large buffers mapped so far
+  std::uint64_t first_touched = 0;     // of which placed by first touch
+  std::uint64_t interleaved = 0;       // of which interleaved by mbind
+  std::uint64_t interleave_failed = 0; // mbind refused: first-touched
+  std::uint64_t huge_advised = 0;      // marked MADV_HUGEPAGE
+  std::uint64_t huge_reserved = 0;     // taken from the MAP_HUGETLB pool
+};
+
+
+namespace page_resource_detail {
+
+/** Linux's MPOL_INTERLEAVE, defined here so that no libnuma headers are
+ * needed. */
+constexpr int mpol_interleave = 3;
+
+inline std::size_t page_size() {
+  static const std::size_t size = std::size_t(::sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+/** Return the default huge page size from /proc/meminfo, or 2 MB. */
+inline std::size_t huge_page_size() {
+  static const std::size_t size = [] {
+    std::ifstream in("/proc/meminfo");
+    std::string key;
+    std::size_t kb = 0;
+    while (in >> key) {
+      if (key == "Hugepagesize:" && in >> kb)
+        return kb * 1024;
+      in.ignore(256, '\n');
+    }
+    return std::size_t(2) << 20;
+  }();
+  return size;
+}
+
+/** Round @a bytes up to a multiple of @a unit. */
+inline std::size_t round_up(std::size_t bytes, std::size_t unit) {
+  return (bytes + unit - 1) / unit * unit;
+}
+
+/** Return the mask of online NUMA nodes, from sysfs, with at least bit 0
+ * set. Lists such as "0-1,4" are understood; nodes past 63 are ignored. */
+inline std::uint64_t online_nodes() {
+  std::ifstream in("/sys/devices/system/node/online");
+  std::string list;
+  std::uint64_t mask = 0;
+  if (in >> list) {
+    std::size_t pos = 0;
+    while (pos < list.size()) {
+      std::size_t end = list.find(',', pos);
+      if (end == std::string::npos)
+        end = list.size();
+      std::string item = list.substr(pos, end - pos);
+      std::size_t dash = item.find('-');
+      unsigned lo = unsigned(std::stoul(item.substr(0, dash)));
+      unsigned hi = dash == std::string::npos
+                        ? lo : unsigned(std::stoul(item.substr(dash + 1)));
+      for (unsigned k = lo; k <= hi && k < 64; ++k)
+        mask |= std::uint64_t(1) << k;
+      pos = end + 1;
+    }
+  }
+  return mask ? mask : 1;
+}
+
+} // end namespace page_resource_detail
+
+
+/** @class PageResource
+ * @brief std::pmr::memory_resource that maps large buffers and places them
+ *        on NUMA nodes as described in the file comment.
+ *
+ * Allocation and deallocation may run on several threads at once. The
+ * resource must outlive everything allocated from it, and memory must be
+ * returned with the size it was allocated with, as std::pmr containers do.
+ */
+class PageResource : public std::pmr::memory_resource {
+ public:
+  explicit PageResource(const page_options& options = page_options())
+      : options_(options),
+        threads_(csr_snapshot::thread_count(options.threads)),
+        nodes_(page_resource_detail::online_nodes()) {
+  }
+
+  PageResource(const PageResource&) = delete;
+  PageResource& operator=(const PageResource&) = delete;
+
+  const page_options& options() const {
+    return options_;
+  }
+
+  /** Return the counts of large buffers so far. */
+  page_report report() const {
+    page_report r;
+    r.mapped_bytes = mapped_.load(std::memory_order_relaxed);
+    r.peak_mapped_bytes = peak_.load(std::memory_order_relaxed);
+    r.buffers = buffers_.load(std::memory_order_relaxed);
+    r.first_touched = first_touched_.load(std::memory_order_relaxed);
+    r.interleaved = interleaved_.load(std::memory_order_relaxed);
+    r.interleave_failed = interleave_failed_.load(std::memory_order_relaxed);
+    r.huge_advised = huge_advised_.load(std::memory_order_relaxed);
+    r.huge_reserved = huge_reserved_.load(std::memory_order_relaxed);
+    return r;
+  }
+
+  /** Return how many bytes of the live large buffers are backed by huge
+   * pages: all of each MAP_HUGETLB buffer, plus the AnonHugePages that
+   * /proc/self/smaps reports for mappings overlapping the others.
+   *
+   * The kernel may merge a buffer's mapping with an adjacent one of the
+   * same kind, whose huge pages are then counted too. Complexity: one read
+   * of /proc/self/smaps.
+   */
+  std::size_t huge_page_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t total = 0;
+    for (const auto& b : buffers_live_) {
+      if (b.second.reserved)
+        total += b.second.size;
+    }
+    std::ifstream in("/proc/self/smaps");
+    std::string line;
+    bool ours = false;
+    while (std::getline(in, line)) {
+      std::uintptr_t lo = 0, hi = 0;
+      char dash = 0;
+      std::istringstream head(line);
+      if (line.compare(0, 14, "AnonHugePages:") == 0) {
+        if (ours) {
+          std::istringstream field(line.substr(14));
+          std::size_t kb = 0;
+          field >> kb;
+          total += kb * 1024;
+        }
+      } else if (head >> std::hex >> lo >> dash >> hi && dash == '-') {
+        ours = overlaps(lo, hi);
+      }
+    }
+    return total;
+  }
+
+ private:
+  page_options options_;
+  unsigned threads_;
+  std::uint64_t nodes_;
+  std::atomic<std::size_t> mapped_{0};
+  std::atomic<std::size_t> peak_{0};
+  std::atomic<std::uint64_t> buffers_{0};
+  std::atomic<std::uint64_t> first_touched_{0};
+  std::atomic<std::uint64_t> interleaved_{0};
+  std::atomic<std::uint64_t> interleave_failed_{0};
+  std::atomic<std::uint64_t> huge_advised_{0};
+  std::atomic<std::uint64_t> huge_reserved_{0};
+
+  // Live large buffers by address: their mapped size and whether they came
+  // from the MAP_HUGETLB pool
+  struct buffer {
+    std::size_t size;
+    bool reserved;
+  };
+  mutable std::mutex mutex_;
+  std::map<std::uintptr_t, buffer> buffers_live_;
+
+  bool is_large(std::size_t bytes, std::size_t alignment) const {
+    return bytes >= options_.threshold
+        && alignment <= page_resource_detail::page_size();
+  }
+
+  /** Return true if some live buffer overlaps [@a lo, @a hi). Needs
+   * mutex_. */
+  bool overlaps(std::uintptr_t lo, std::uintptr_t hi) const {
+    auto it = buffers_live_.lower_bound(hi);
+    if (it == buffers_live_.begin())
+      return false;
+    --it;
+    return it->first + it->second.size > lo;
+  }
+
+  /** Map @a size bytes at a multiple of @a alignment, a multiple of the
+   * page size, by mapping @a alignment more and trimming both ends. */
+  static char* map_aligned(std::size_t size, std::size_t alignment) {
+    std::size_t page = page_resource_detail::page_size();
+    std::size_t slack = alignment > page ? alignment : 0;
+    void* p = ::mmap(nullptr, size + slack, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+      throw std::bad_alloc();
+    char* base = static_cast<char*>(p);
+    if (slack == 0)
+      return base;
+    char* aligned = reinterpret_cast<char*>(page_resource_detail::round_up(
+        reinterpret_cast<std::uintptr_t>(base), alignment));
+    if (aligned != base)
+      ::munmap(base, std::size_t(aligned - base));
+    std::size_t tail = slack - std::size_t(aligned - base);
+    if (tail != 0)
+      ::munmap(aligned + size, tail);
+    return aligned;
+  }
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    if (!is_large(bytes, alignment))
+      return options_.upstream->allocate(bytes, alignment);
+    using page_resource_detail::round_up;
+    std::size_t huge = page_resource_detail::huge_page_size();
+    std::size_t size = 0;
+    char* p = nullptr;
+    bool reserved = false;
+    if (options_.huge == huge_pages::reserved) {
+      size = round_up(bytes, huge);
+      void* q = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (q != MAP_FAILED) {
+        p = static_cast<char*>(q);
+        reserved = true;
+        huge_reserved_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    if (p == nullptr && options_.huge != huge_pages::none) {
+      size = round_up(bytes, huge);
+      p = map_aligned(size, huge);
+      ::madvise(p, size, MADV_HUGEPAGE);
+      huge_advised_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (p == nullptr) {
+      size = round_up(bytes, page_resource_detail::page_size());
+      p = map_aligned(size, 0);
+    }
+    place(p, size, options_.huge == huge_pages::none
+                       ? page_resource_detail::page_size() : huge);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      buffers_live_[reinterpret_cast<std::uintptr_t>(p)] = buffer{size, reserved};
+    }
+
+    buffers_.fetch_add(1, std::memory_order_relaxed);
+    std::size_t now = mapped_.fetch_add(size, std::memory_order_relaxed) + size;
+    std::size_t peak = peak_.load(std::memory_order_relaxed);
+    while (peak < now && !peak_.compare_exchange_weak(
+               peak, now, std::memory_order_relaxed)) {
+    }
+    return p;
+  }
+
+  void do_deallocate(void* p, std::size_t bytes,
+                     std::size_t alignment) override {
+    if (!is_large(bytes, alignment)) {
+      options_.upstream->deallocate(p, bytes, alignment);
+      return;
+    }
+    std::size_t size = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = buffers_live_.find(reinterpret_cast<std::uintptr_t>(p));
+      size = it->second.size;
+      buffers_live_.erase(it);
+    }
+    ::munmap(p, size);
+    mapped_.fetch_sub(size, std::memory_order_relaxed);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  /** Put the pages of the fresh mapping [@a p, @a p + @a size) where the
+   * options ask for them. First touch splits the mapping at multiples of
+   * @a unit, the size of the pages the kernel may fault it in with. */
+  void place(char* p, std::size_t size, std::size_t unit) {
+    if (options_.placement == numa_placement::none)
+      return;
+    if (options_.placement == numa_placement::interleave) {
+      // With one node there is nothing to spread
+      if ((nodes_ & (nodes_ - 1)) == 0)
+        return;
+      long rc = ::syscall(SYS_mbind, p, size,
+                          page_resource_detail::mpol_interleave,
+                          &nodes_, 64UL, 0U);
+      if (rc == 0) {
+        interleaved_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      interleave_failed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::size_t page = page_resource_detail::page_size();
+    csr_snapshot::parallel_ranges(threads_, size / page, unit / page,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t k = b; k < e; ++k)
+            static_cast<volatile char*>(p)[k * page] = 0;
+        });
+    first_touched_.fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+#endif // CME212_PAGE_RESOURCE_HPP
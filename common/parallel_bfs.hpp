@@ -0,0 +1,433 @@
+#ifndef CME212_PARALLEL_BFS_HPP
+#define CME212_PARALLEL_BFS_HPP
+
+/** @file parallel_bfs.hpp
+ * @brief Multithreaded, direction-optimizing breadth first search.
+ *
+ * BfsEngine takes a compact CSR snapshot of any graph with incident
+ * iterators (Node::edge_begin()/edge_end()) and then computes hop
+ * distances from a root on several threads, switching between top-down
+ * and bottom-up steps as in Beamer, Asanovic and Patterson,
+ * "Direction-Optimizing Breadth-First Search" (SC 2012).
+ *
+ * A top-down step expands the frontier queue, claiming each newly reached
+ * node with an atomic OR on a visited bitmap. A bottom-up step instead has
+ * every unvisited node look for a parent in a frontier bitmap, and stops at
+ * the first one it finds. This skips most edges once the frontier covers a
+ * large part of the graph. The search goes bottom-up while the frontier's
+ * edges outnumber the unexplored edges divided by alpha, and back top-down
+ * once the frontier holds fewer than num_nodes / beta nodes.
+ *
+ * BfsEngine::run_multi() searches from many sources at once in the style of
+ * Then et al., "The More the Merrier: Efficient Multi-Source Graph
+ * Traversal" (VLDB 2014): every node carries one bit per source, so a
+ * single sweep over the adjacency advances up to 64 * Words searches by a
+ * level.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/trace.hpp"
+
+
+/** Tuning knobs for BfsEngine. */
+struct bfs_options {
+  /** Worker threads. 0 means std::thread::hardware_concurrency(). */
+  unsigned threads = 0;
+  /** Go bottom-up when frontier edges > unexplored edges / alpha. */
+  double alpha = 15;
+  /** Go back top-down when frontier nodes < num_nodes / beta. */
+  double beta = 18;
+};
+
+/** What one search did and how fast. */
+struct bfs_report {
+  std::uint64_t reached = 0;          // nodes with a finite distance
+  std::uint64_t levels = 0;           // number of expanded frontiers
+  std::uint64_t top_down_steps = 0;
+  std::uint64_t bottom_up_steps = 0;
+  double seconds = 0;                 // wall time, including the dist fill
+};
+
+
+/** @class BfsEngine
+ * @brief Reusable parallel BFS over a snapshot of a graph's adjacency.
+ *
+ * The constructor copies the neighbor lists into one CSR array, on
+ * several threads. On graphs with a degrees() array (hw1/Graph-24726.hpp)
+ * the row offsets come straight from it; on others they take an extra
+ * counting pass over the incident iterators. Building costs about as much
+ * as one sequential BFS, so an engine pays off from the second search on
+ * and makes every search independent of the graph's own layout. Changes
+ * to the graph after construction are not seen.
+ *
+ * Reading the graph from several threads at once must be safe, which holds
+ * for the Graph variants as long as operation counting
+ * (CME212_GRAPH_STATS) is off.
+ *
+ * @tparam G  Graph type with size(), node(i).edge_begin()/edge_end() and
+ *            size_type.
+ */
+template <typename G>
+class BfsEngine {
+ public:
+  /** Type of node indices and distances, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Distance of a node the search did not reach. */
+  static constexpr size_type unreached = size_type(-1);
+
+  /** Snapshot the adjacency of @a g.
+   *
+   * Complexity: O(g.size() + g.num_edges()), spread over the threads.
+   */
+  explicit BfsEngine(const G& g, const bfs_options& opt = bfs_options())
+      : opt_(opt), threads_(csr_snapshot::thread_count(opt.threads)),
+        n_(std::size_t(g.size())),
+        offsets_(csr_snapshot::row_offsets(g, threads_)) {
+    neighbors_.resize(offsets_[n_]);
+    csr_snapshot::fill_neighbors(g, offsets_, threads_, neighbors_.data());
+  }
+
+  /** Return the number of nodes in the snapshot. */
+  size_type size() const {
+    return size_type(n_);
+  }
+
+  /** Return the first CSR entry of node @a i; its entries end at
+   * offset(@a i + 1). For algorithms that walk the snapshot between
+   * searches, such as the path counting of approx_analytics.hpp. */
+  std::size_t offset(size_type i) const {
+    return offsets_[i];
+  }
+  /** Return the neighbor across CSR entry @a k. */
+  size_type neighbor(std::size_t k) const {
+    return neighbors_[k];
+  }
+
+  /** Fill @a dist with the hop distance of every node from @a root.
+   * @param[out] dist  Resized to size(); dist[i] is the number of edges on
+   *                   a shortest path from @a root to node i, or unreached
+   * @return Counts and timing of the search
+   *
+   * @pre @a root < size()
+   *
+   * Complexity: O(size() + number of edges) work, spread over the threads.
+   */
+  bfs_report run(size_type root, std::vector<size_type>& dist) const {
+    assert(std::size_t(root) < n_);
+    CME212_TRACE_SCOPE("bfs");
+    auto start = std::chrono::steady_clock::now();
+    bfs_report report;
+
+    std::size_t words = (n_ + 63) / 64;
+    dist.resize(n_);
+    std::vector<std::atomic<std::uint64_t>> visited(words);
+    csr_snapshot::parallel_ranges(threads_, n_, 64,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          std::fill(dist.begin() + b, dist.begin() + e, unreached);
+          for (std::size_t w = b / 64; w < (e + 63) / 64; ++w)
+            visited[w].store(0, std::memory_order_relaxed);
+        });
+
+    dist[root] = 0;
+    visited[root / 64].store(bit(root), std::memory_order_relaxed);
+    std::vector<size_type> queue(1, root);
+    std::vector<std::uint64_t> front, next;
+    std::size_t frontier_nodes = 1;
+    std::size_t frontier_edges = degree(root);
+    std::size_t unexplored = offsets_[n_] - frontier_edges;
+    bool bottom_up = false;
+    report.reached = 1;
+
+    for (size_type level = 1; frontier_nodes != 0; ++level) {
+      if (!bottom_up && double(frontier_edges) > double(unexplored) / opt_.alpha) {
+        to_bitmap(queue, front);
+        bottom_up = true;
+      } else if (bottom_up && double(frontier_nodes) < double(n_) / opt_.beta) {
+        to_queue(front, queue);
+        bottom_up = false;
+      }
+
+      std::pair<std::size_t, std::size_t> step;
+      if (bottom_up) {
+        step = step_bottom_up(level, front, next, visited, dist);
+        front.swap(next);
+        ++report.bottom_up_steps;
+      } else {
+        step = step_top_down(level, queue, visited, dist);
+        ++report.top_down_steps;
+      }
+      frontier_nodes = step.first;
+      frontier_edges = step.second;
+      unexplored -= frontier_edges;
+      report.reached += frontier_nodes;
+      ++report.levels;
+    }
+
+    report.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return report;
+  }
+
+  /** Fill @a dist with the hop distances from every node of @a sources.
+   * @param[out] dist  Resized to sources.size() * size();
+   *                   dist[s * size() + i] is the distance from sources[s]
+   *                   to node i, or unreached
+   * @return Counts and timing of the search. reached counts (source, node)
+   *         pairs and levels is the most levels any batch took.
+   *
+   * @tparam Words  Sources per batch, in units of 64. Each node's
+   *                frontier is a Words x 64 bit lane, so Words = 4 fills a
+   *                256-bit register and a build with AVX2 (or AVX-512 at
+   *                Words = 8) vectorizes the per-lane OR/AND-NOT loops.
+   *
+   * @pre Every source < size()
+   *
+   * Sources are taken in batches of 64 * Words. A batch runs
+   * level-synchronous pull steps. Each node ORs the frontier lanes of its
+   * neighbors, masks out the sources that have already seen it, and
+   * records the new bits at this level. Every node is written only by the
+   * thread that owns it, so no atomics are needed, and one adjacency sweep
+   * serves the whole batch. Nodes that every source of the batch has
+   * already reached are skipped.
+   *
+   * Complexity: O(levels * (size() + number of edges) * Words) work per
+   * batch, spread over the threads.
+   */
+  template <std::size_t Words = 1>
+  bfs_report run_multi(const std::vector<size_type>& sources,
+                       std::vector<size_type>& dist) const {
+    static_assert(Words > 0, "run_multi needs at least one word per lane");
+    using lane = std::array<std::uint64_t, Words>;
+    constexpr std::size_t per_batch = 64 * Words;
+    CME212_TRACE_SCOPE_N("multi_source_bfs", sources.size());
+    auto start = std::chrono::steady_clock::now();
+    bfs_report report;
+
+    dist.resize(sources.size() * n_);
+    csr_snapshot::parallel_ranges(threads_, dist.size(), 1024,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          std::fill(dist.begin() + b, dist.begin() + e, unreached);
+        });
+
+    std::vector<lane> seen(n_), visit(n_), next(n_);
+    for (std::size_t first = 0; first < sources.size(); first += per_batch) {
+      std::size_t count = std::min(per_batch, sources.size() - first);
+      lane full{};
+      for (std::size_t s = 0; s < count; ++s)
+        full[s / 64] |= bit(s);
+
+      csr_snapshot::parallel_ranges(threads_, n_, 1024,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            std::fill(seen.begin() + b, seen.begin() + e, lane{});
+            std::fill(visit.begin() + b, visit.begin() + e, lane{});
+          });
+      for (std::size_t s = 0; s < count; ++s) {
+        size_type root = sources[first + s];
+        assert(std::size_t(root) < n_);
+        seen[root][s / 64] |= bit(s);
+        visit[root][s / 64] |= bit(s);
+        dist[(first + s) * n_ + root] = 0;
+      }
+      report.reached += count;
+
+      std::uint64_t levels = 0;
+      for (size_type level = 1; ; ++level) {
+        std::vector<std::uint64_t> found(threads_, 0);
+        csr_snapshot::parallel_ranges(threads_, n_, 64,
+            [&](unsigned t, std::size_t b, std::size_t e) {
+              for (std::size_t v = b; v < e; ++v) {
+                lane& mine = seen[v];
+                lane fresh{};
+                if (mine != full) {
+                  for (std::size_t j = offsets_[v]; j < offsets_[v + 1]; ++j) {
+                    const lane& theirs = visit[neighbors_[j]];
+                    for (std::size_t w = 0; w < Words; ++w)
+                      fresh[w] |= theirs[w];
+                  }
+                  for (std::size_t w = 0; w < Words; ++w) {
+                    fresh[w] &= ~mine[w];
+                    mine[w] |= fresh[w];
+                  }
+                  for (std::size_t w = 0; w < Words; ++w) {
+                    for (std::uint64_t x = fresh[w]; x != 0; x &= x - 1) {
+                      std::size_t s = 64 * w + lowest_bit(x);
+                      dist[(first + s) * n_ + v] = level;
+                      ++found[t];
+                    }
+                  }
+                }
+                next[v] = fresh;
+              }
+            });
+        visit.swap(next);
+        ++levels;
+        std::uint64_t total = 0;
+        for (std::uint64_t f : found)
+          total += f;
+        report.reached += total;
+        if (total == 0)
+          break;
+      }
+      report.levels = std::max(report.levels, levels);
+      report.bottom_up_steps += levels;
+    }
+
+    report.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return report;
+  }
+
+ private:
+  bfs_options opt_;
+  unsigned threads_;
+  std::size_t n_;
+  std::vector<std::size_t> offsets_;   // row i is neighbors_[offsets_[i]..)
+  std::vector<size_type> neighbors_;
+
+  static std::uint64_t bit(std::size_t v) {
+    return std::uint64_t(1) << (v % 64);
+  }
+
+  /** Return the index of the lowest set bit of @a x.
+   * @pre @a x != 0 */
+  static unsigned lowest_bit(std::uint64_t x) {
+#if defined(__GNUC__)
+    return unsigned(__builtin_ctzll(x));
+#else
+    unsigned k = 0;
+    while (!((x >> k) & 1))
+      ++k;
+    return k;
+#endif
+  }
+
+  std::size_t degree(std::size_t v) const {
+    return offsets_[v + 1] - offsets_[v];
+  }
+
+  /** Turn the frontier queue into a bitmap. */
+  void to_bitmap(const std::vector<size_type>& queue,
+                 std::vector<std::uint64_t>& bits) const {
+    bits.assign((n_ + 63) / 64, 0);
+    for (size_type v : queue)
+      bits[v / 64] |= bit(v);
+  }
+
+  /** Turn the frontier bitmap into a queue, in increasing node order. */
+  void to_queue(const std::vector<std::uint64_t>& bits,
+                std::vector<size_type>& queue) const {
+    std::vector<std::vector<size_type>> parts(threads_);
+    csr_snapshot::parallel_ranges(threads_, bits.size(), 1,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for (std::size_t w = b; w < e; ++w) {
+            for (std::uint64_t x = bits[w]; x != 0; x &= x - 1)
+              parts[t].push_back(size_type(64 * w + lowest_bit(x)));
+          }
+        });
+    queue.clear();
+    for (const auto& part : parts)
+      queue.insert(queue.end(), part.begin(), part.end());
+  }
+
+  /** Expand @a queue into the next frontier, claiming nodes atomically.
+   * @return (nodes, edges) of the new frontier, which replaces @a queue */
+  std::pair<std::size_t, std::size_t>
+  step_top_down(size_type level, std::vector<size_type>& queue,
+                std::vector<std::atomic<std::uint64_t>>& visited,
+                std::vector<size_type>& dist) const {
+    std::vector<std::vector<size_type>> parts(threads_);
+    std::vector<std::size_t> edges(threads_, 0);
+    csr_snapshot::parallel_ranges(threads_, queue.size(), 64,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for (std::size_t k = b; k < e; ++k) {
+            size_type u = queue[k];
+            for (std::size_t j = offsets_[u]; j < offsets_[u + 1]; ++j) {
+              size_type v = neighbors_[j];
+              std::atomic<std::uint64_t>& word = visited[v / 64];
+              if (word.load(std::memory_order_relaxed) & bit(v))
+                continue;
+              if (!(word.fetch_or(bit(v), std::memory_order_relaxed) & bit(v))) {
+                dist[v] = level;
+                parts[t].push_back(v);
+                edges[t] += degree(v);
+              }
+            }
+          }
+        });
+    queue.clear();
+    std::size_t total = 0;
+    for (unsigned t = 0; t < threads_; ++t) {
+      queue.insert(queue.end(), parts[t].begin(), parts[t].end());
+      total += edges[t];
+    }
+    return {queue.size(), total};
+  }
+
+  /** Give every unvisited node with a parent in @a front the distance
+   * @a level, recording them in @a next.
+   * @return (nodes, edges) of the new frontier
+   *
+   * Ranges are whole bitmap words, so every word of @a next and @a visited
+   * is written by one thread only. */
+  std::pair<std::size_t, std::size_t>
+  step_bottom_up(size_type level, const std::vector<std::uint64_t>& front,
+                 std::vector<std::uint64_t>& next,
+                 std::vector<std::atomic<std::uint64_t>>& visited,
+                 std::vector<size_type>& dist) const {
+    next.assign(front.size(), 0);
+    std::vector<std::size_t> nodes(threads_, 0), edges(threads_, 0);
+    csr_snapshot::parallel_ranges(threads_, n_, 64,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for (std::size_t v = b; v < e; ++v) {
+            std::atomic<std::uint64_t>& word = visited[v / 64];
+            if (word.load(std::memory_order_relaxed) & bit(v))
+              continue;
+            for (std::size_t j = offsets_[v]; j < offsets_[v + 1]; ++j) {
+              size_type u = neighbors_[j];
+              if (front[u / 64] & bit(u)) {
+                dist[v] = level;
+                next[v / 64] |= bit(v);
+                word.fetch_or(bit(v), std::memory_order_relaxed);
+                ++nodes[t];
+                edges[t] += degree(v);
+                break;
+              }
+            }
+          }
+        });
+    std::size_t total_nodes = 0, total_edges = 0;
+    for (unsigned t = 0; t < threads_; ++t) {
+      total_nodes += nodes[t];
+      total_edges += edges[t];
+    }
+    return {total_nodes, total_edges};
+  }
+};
+
+/** Return the hop distance of every node of @a g from @a root, with
+ * BfsEngine<G>::unreached for nodes in other components.
+ *
+ * Builds a BfsEngine for the one search; keep an engine around to run
+ * several.
+ */
+template <typename G>
+std::vector<typename G::size_type>
+bfs_distances(const G& g, typename G::size_type root,
+              const bfs_options& opt = bfs_options()) {
+  std::vector<typename G::size_type> dist;
+  BfsEngine<G>(g, opt).run(root, dist);
+  return dist;
+}
+
+#endif // CME212_PARALLEL_BFS_HPP
@@ -0,0 +1,241 @@
+#ifndef CME212_PERF_COUNTERS_HPP
+#define CME212_PERF_COUNTERS_HPP
+
+/** @file perf_counters.hpp
+ * @brief Hardware performance counters of the calling thread, read through
+ *        Linux perf_event_open().
+ *
+ * Wall-clock time says that one layout beats another but not why. These
+ * counters say how many cycles, instructions, branch mispredictions, L1
+ * data cache, last-level cache and data TLB misses a region of code cost:
+ *
+ *   PerfCounters perf;
+ *   perf.start();
+ *   walk_edges(g);
+ *   perf.stop();
+ *   perf_sample s = perf.read();
+ *   double llc_per_edge = s[perf_event::llc_misses] / g.num_edges();
+ *
+ * Every event is opened on its own, so one the machine lacks (many VMs
+ * expose no cache events) does not take the others with it; available()
+ * says which ones count, and error() why none do. Counting is limited to
+ * user space, which works at the default perf_event_paranoid level of 2.
+ * When the PMU has fewer counters than events the kernel multiplexes
+ * them, and read() scales each count up by the share of time it ran.
+ *
+ * Only the thread that made the PerfCounters is counted, not the workers
+ * of ThreadPool::shared(). Off Linux nothing is available.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+/** The events a PerfCounters counts. */
+enum class perf_event {
+  cycles,
+  instructions,
+  branch_misses,
+  l1d_misses,    // L1 data cache read misses
+  llc_misses,    // last-level cache read misses
+  dtlb_misses,   // data TLB read misses
+};
+
+/** Number of perf_event values. */
+constexpr std::size_t perf_event_count = 6;
+
+/** Return a short name for @a e, e.g. "LLC-misses". */
+inline const char* perf_event_name(perf_event e) {
+  switch (e) {
+    case perf_event::cycles:        return "cycles";
+    case perf_event::instructions:  return "instructions";
+    case perf_event::branch_misses: return "branch-misses";
+    case perf_event::l1d_misses:    return "L1D-misses";
+    case perf_event::llc_misses:    return "LLC-misses";
+    case perf_event::dtlb_misses:   return "dTLB-misses";
+  }
+  return "?";
+}
+
+/** Counts read by PerfCounters::read(). */
+struct perf_sample {
+  /** Count of each event, scaled for multiplexing; 0 if not available. */
+  double count[perf_event_count] = {};
+  /** Whether each event was counted. */
+  bool valid[perf_event_count] = {};
+
+  double operator[](perf_event e) const {
+    return count[std::size_t(e)];
+  }
+  bool has(perf_event e) const {
+    return valid[std::size_t(e)];
+  }
+  /** Instructions per cycle, or 0 without both counts. */
+  double ipc() const {
+    if (!has(perf_event::cycles) || !has(perf_event::instructions) ||
+        (*this)[perf_event::cycles] == 0)
+      return 0;
+    return (*this)[perf_event::instructions] / (*this)[perf_event::cycles];
+  }
+};
+
+
+/** @class PerfCounters
+ * @brief The perf_event counters of the calling thread, started and
+ *        stopped together.
+ *
+ * Counts accumulate over every start() .. stop() interval until reset().
+ */
+class PerfCounters {
+ public:
+  /** Open every event for the calling thread, stopped and at zero. */
+  PerfCounters() {
+    for (int& fd : fd_)
+      fd = -1;
+#ifdef __linux__
+    for (std::size_t i = 0; i < perf_event_count; ++i) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format =
+          PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      config(perf_event(i), attr);
+      fd_[i] = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+      if (fd_[i] < 0 && error_.empty())
+        error_ = std::string("perf_counters: perf_event_open failed: ") +
+                 std::strerror(errno);
+    }
+    if (any())
+      error_.clear();
+#else
+    error_ = "perf_counters: perf_event_open needs Linux";
+#endif
+  }
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  ~PerfCounters() {
+#ifdef __linux__
+    for (int fd : fd_)
+      if (fd >= 0)
+        close(fd);
+#endif
+  }
+
+  /** Return true if @a e is being counted. */
+  bool available(perf_event e) const {
+    return fd_[std::size_t(e)] >= 0;
+  }
+
+  /** Return true if any event is being counted. */
+  bool any() const {
+    for (int fd : fd_)
+      if (fd >= 0)
+        return true;
+    return false;
+  }
+
+  /** Return why no event could be opened, or "" if some could. */
+  const std::string& error() const {
+    return error_;
+  }
+
+  /** Start counting. */
+  void start() {
+    control(op::enable);
+  }
+
+  /** Stop counting; the counts so far are kept. */
+  void stop() {
+    control(op::disable);
+  }
+
+  /** Set every count back to zero. */
+  void reset() {
+    control(op::reset);
+  }
+
+  /** Return the counts so far. */
+  perf_sample read() const {
+    perf_sample s;
+#ifdef __linux__
+    for (std::size_t i = 0; i < perf_event_count; ++i) {
+      std::uint64_t v[3];   // value, time enabled, time running
+      if (fd_[i] < 0 || ::read(fd_[i], v, sizeof(v)) != ssize_t(sizeof(v)))
+        continue;
+      s.valid[i] = true;
+      if (v[2] != 0)
+        s.count[i] = double(v[0]) * (double(v[1]) / double(v[2]));
+    }
+#endif
+    return s;
+  }
+
+ private:
+  enum class op { enable, disable, reset };
+
+#ifdef __linux__
+  static void config(perf_event e, perf_event_attr& attr) {
+    constexpr std::uint64_t read_miss =
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    switch (e) {
+      case perf_event::cycles:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+      case perf_event::instructions:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+      case perf_event::branch_misses:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+      case perf_event::l1d_misses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | read_miss;
+        break;
+      case perf_event::llc_misses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_LL | read_miss;
+        break;
+      case perf_event::dtlb_misses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | read_miss;
+        break;
+    }
+  }
+
+  void control(op o) {
+    unsigned long request = o == op::enable  ? PERF_EVENT_IOC_ENABLE
+                          : o == op::disable ? PERF_EVENT_IOC_DISABLE
+                                             : PERF_EVENT_IOC_RESET;
+    for (int fd : fd_)
+      if (fd >= 0)
+        ioctl(fd, request, 0);
+  }
+#else
+  void control(op) {
+  }
+#endif
+
+  int fd_[perf_event_count];
+  std::string error_;
+};
+
+#endif // CME212_PERF_COUNTERS_HPP
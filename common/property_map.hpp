@@ -0,0 +1,419 @@
+#ifndef CME212_PROPERTY_MAP_HPP
+#define CME212_PROPERTY_MAP_HPP
+
+/** @file property_map.hpp
+ * @brief Hashes and dense per-node / per-edge property maps for Graph
+ *        proxies.
+ *
+ * Node and Edge are nested in the Graph class template, so std::hash
+ * cannot be specialized for them once for every graph. NodeHash and
+ * EdgeHash fill that role:
+ *
+ *   std::unordered_set<Node, NodeHash> seen;
+ *   std::unordered_map<Edge, double, EdgeHash> weight;
+ *
+ * When the data is wanted for many or most nodes or edges, a dense map
+ * indexed by the proxy's index is faster than any hash table and should be
+ * preferred:
+ *
+ *   NodePropertyMap<GraphType, double> dist(g, inf);
+ *   dist[n] = 0;
+ *
+ * A NodePropertyMap is a snapshot of the graph's size. A graph that owns a
+ * PropertyRegistry can instead hand out PropertyArrays, which it keeps the
+ * same length as its nodes or edges and renumbers along with them.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/edge_index.hpp"
+
+
+namespace property_map_detail {
+
+/** Spread 64 bits of key over a size_t (Fibonacci hashing), so that
+ * consecutive indices do not land in consecutive buckets. */
+inline std::size_t mix_hash(std::uint64_t key) {
+  key *= 0x9E3779B97F4A7C15ull;
+  return std::size_t(key ^ (key >> 32));
+}
+
+template <typename E, typename = void>
+struct has_edge_index : std::false_type {};
+template <typename E>
+struct has_edge_index<E, std::void_t<decltype(std::declval<const E&>().index())>>
+    : std::true_type {};
+
+} // end namespace property_map_detail
+
+
+/** @struct NodeHash
+ * @brief Hash of a Node consistent with Node::operator==: equal nodes have
+ *        the same index(). */
+struct NodeHash {
+  template <typename Node>
+  std::size_t operator()(const Node& n) const {
+    return property_map_detail::mix_hash(std::uint64_t(n.index()));
+  }
+};
+
+/** @struct EdgeHash
+ * @brief Hash of an Edge consistent with Edge::operator==.
+ *
+ * Uses the edge's index() when Edge has one, which is one load. Otherwise
+ * it hashes the canonical key of the two node indices, so both
+ * orientations of an edge hash alike.
+ */
+struct EdgeHash {
+  template <typename Edge>
+  std::size_t operator()(const Edge& e) const {
+    if constexpr (property_map_detail::has_edge_index<Edge>::value)
+      return property_map_detail::mix_hash(std::uint64_t(e.index()));
+    else
+      return property_map_detail::mix_hash(EdgeIndex<>::make_key(
+          std::uint32_t(e.node1().index()), std::uint32_t(e.node2().index())));
+  }
+};
+
+
+/** @class NodePropertyMap
+ * @brief One T per node of a graph, stored contiguously by node index.
+ *
+ * The map does not follow the graph: after nodes are added, resize() it;
+ * after nodes are renumbered (e.g. permute_nodes()), its entries refer to
+ * the old numbering.
+ *
+ * @tparam G  Graph type. G::node_type must have index().
+ * @tparam T  Value type.
+ */
+template <typename G, typename T>
+class NodePropertyMap {
+ public:
+  using node_type = typename G::node_type;
+  using size_type = std::size_t;
+  using value_type = T;
+  using reference = typename std::vector<T>::reference;
+  using const_reference = typename std::vector<T>::const_reference;
+
+  /** Construct an empty map. */
+  NodePropertyMap() = default;
+
+  /** Construct a map holding @a init for every node of @a g. */
+  explicit NodePropertyMap(const G& g, const T& init = T())
+      : data_(g.num_nodes(), init) {
+  }
+
+  /** Grow or shrink the map to the nodes of @a g, giving new entries
+   * @a init. */
+  void resize(const G& g, const T& init = T()) {
+    data_.resize(g.num_nodes(), init);
+  }
+
+  /** Set every entry to @a x. */
+  void fill(const T& x) {
+    data_.assign(data_.size(), x);
+  }
+
+  /** Return the value of node @a n.
+   * @pre n.index() < size()
+   *
+   * Complexity: O(1), one array access.
+   */
+  reference operator[](const node_type& n) {
+    return data_[n.index()];
+  }
+  const_reference operator[](const node_type& n) const {
+    return data_[n.index()];
+  }
+
+  size_type size() const {
+    return data_.size();
+  }
+  /** Return the values in node index order. */
+  std::vector<T>& values() {
+    return data_;
+  }
+  const std::vector<T>& values() const {
+    return data_;
+  }
+
+ private:
+  std::vector<T> data_;
+};
+
+/** @class EdgePropertyMap
+ * @brief One T per edge of a graph, stored contiguously by edge index.
+ *
+ * Both orientations of an edge share an entry. As with NodePropertyMap,
+ * resize() after adding edges; reordering the edges (e.g. sort_edges())
+ * leaves the entries in the old order.
+ *
+ * @tparam G  Graph type. G::edge_type must have index().
+ * @tparam T  Value type.
+ */
+template <typename G, typename T>
+class EdgePropertyMap {
+ public:
+  using edge_type = typename G::edge_type;
+  using size_type = std::size_t;
+  using value_type = T;
+  using reference = typename std::vector<T>::reference;
+  using const_reference = typename std::vector<T>::const_reference;
+
+  /** Construct an empty map. */
+  EdgePropertyMap() = default;
+
+  /** Construct a map holding @a init for every edge of @a g. */
+  explicit EdgePropertyMap(const G& g, const T& init = T())
+      : data_(g.num_edges(), init) {
+  }
+
+  /** Grow or shrink the map to the edges of @a g, giving new entries
+   * @a init. */
+  void resize(const G& g, const T& init = T()) {
+    data_.resize(g.num_edges(), init);
+  }
+
+  /** Set every entry to @a x. */
+  void fill(const T& x) {
+    data_.assign(data_.size(), x);
+  }
+
+  /** Return the value of edge @a e.
+   * @pre e.index() < size()
+   *
+   * Complexity: O(1), one array access.
+   */
+  reference operator[](const edge_type& e) {
+    return data_[e.index()];
+  }
+  const_reference operator[](const edge_type& e) const {
+    return data_[e.index()];
+  }
+
+  size_type size() const {
+    return data_.size();
+  }
+  /** Return the values in edge index order. */
+  std::vector<T>& values() {
+    return data_;
+  }
+  const std::vector<T>& values() const {
+    return data_;
+  }
+
+ private:
+  std::vector<T> data_;
+};
+
+
+/** @class PropertyRegistry
+ * @brief The per-node (or per-edge) arrays a graph keeps in step with its
+ *        own storage.
+ *
+ * The graph calls resize() whenever its number of nodes changes, gather()
+ * whenever it renumbers or compacts them and swap_remove() when it removes one by
+ * moving its last element into the hole. The registry only holds weak
+ * references: an array lives as long as some PropertyArray refers to it,
+ * and arrays that are gone are dropped on the next resize().
+ *
+ * Copying a graph does not copy its registry, since the arrays belong to
+ * the graph they were made from; the copy starts with an empty one.
+ *
+ * @tparam Index  The graph's size_type.
+ */
+template <typename Index>
+class PropertyRegistry {
+ public:
+  PropertyRegistry() = default;
+  PropertyRegistry(const PropertyRegistry&) {
+  }
+  PropertyRegistry(PropertyRegistry&&) = default;
+  PropertyRegistry& operator=(const PropertyRegistry&) {
+    entries_.clear();
+    return *this;
+  }
+  PropertyRegistry& operator=(PropertyRegistry&&) = default;
+
+  /** Storage of one array, type-erased for the registry. */
+  struct entry {
+    virtual ~entry() = default;
+    virtual void resize(std::size_t n) = 0;
+    virtual void gather(const Index* old_index, std::size_t n) = 0;
+    virtual void swap_remove(std::size_t i) = 0;
+    /** Return the bytes of the elements, and of the capacity behind them. */
+    virtual std::pair<std::size_t, std::size_t> bytes() const = 0;
+  };
+
+  /** Storage of an array of T, whose new entries get @a init. */
+  template <typename T>
+  struct storage : entry {
+    std::vector<T> data;
+    T init;
+
+    storage(std::size_t n, const T& x) : data(n, x), init(x) {
+    }
+    void resize(std::size_t n) override {
+      data.resize(n, init);
+    }
+    void gather(const Index* old_index, std::size_t n) override {
+      std::vector<T> out;
+      out.reserve(n);
+      for (std::size_t k = 0; k < n; ++k)
+        out.push_back(std::move(data[old_index[k]]));
+      data.swap(out);
+    }
+    void swap_remove(std::size_t i) override {
+      if (i + 1 != data.size())
+        data[i] = std::move(data.back());
+      data.pop_back();
+    }
+    std::pair<std::size_t, std::size_t> bytes() const override {
+      return {data.size() * sizeof(T), data.capacity() * sizeof(T)};
+    }
+  };
+
+  /** Create an array of @a n copies of @a init and register it. */
+  template <typename T>
+  std::shared_ptr<storage<T>> add(std::size_t n, const T& init) {
+    auto s = std::make_shared<storage<T>>(n, init);
+    entries_.push_back(s);
+    return s;
+  }
+
+  /** Resize every live array to @a n elements. */
+  void resize(std::size_t n) {
+    if (entries_.empty())
+      return;
+    std::size_t live = 0;
+    for (std::size_t k = 0; k < entries_.size(); ++k) {
+      if (std::shared_ptr<entry> e = entries_[k].lock()) {
+        e->resize(n);
+        entries_[live++] = entries_[k];
+      }
+    }
+    entries_.resize(live);
+  }
+
+  /** Renumber every live array: new[k] = old[old_index[k]] for k < n.
+   * @pre old_index[0..n) are distinct current indices: a permutation, or
+   *      the survivors of a compaction in increasing order
+   */
+  void gather(const Index* old_index, std::size_t n) {
+    for (const std::weak_ptr<entry>& w : entries_) {
+      if (std::shared_ptr<entry> e = w.lock())
+        e->gather(old_index, n);
+    }
+  }
+
+  /** Remove entry @a i of every live array, moving its last entry into
+   * entry @a i. */
+  void swap_remove(std::size_t i) {
+    for (const std::weak_ptr<entry>& w : entries_) {
+      if (std::shared_ptr<entry> e = w.lock())
+        e->swap_remove(i);
+    }
+  }
+
+  /** Return the bytes used and reserved by the live arrays, and their
+   * number.
+   * Complexity: O(number of registered arrays). */
+  std::pair<std::size_t, std::size_t> bytes(std::size_t& arrays) const {
+    std::pair<std::size_t, std::size_t> total(0, 0);
+    arrays = 0;
+    for (const std::weak_ptr<entry>& w : entries_) {
+      if (std::shared_ptr<entry> e = w.lock()) {
+        std::pair<std::size_t, std::size_t> b = e->bytes();
+        total.first += b.first;
+        total.second += b.second;
+        ++arrays;
+      }
+    }
+    return total;
+  }
+
+  /** Return true if no arrays were ever registered or all are gone. */
+  bool empty() const {
+    for (const std::weak_ptr<entry>& w : entries_) {
+      if (!w.expired())
+        return false;
+    }
+    return true;
+  }
+
+ private:
+  std::vector<std::weak_ptr<entry>> entries_;
+};
+
+/** @class PropertyArray
+ * @brief A contiguous array of T, one per node or edge, that its graph
+ *        keeps the same length as its nodes or edges.
+ *
+ * Made by the graph (e.g. Graph::make_node_property()), never directly.
+ * Copies share the same array. The array outlives its graph, but then no
+ * longer follows it.
+ *
+ * @tparam Key    Graph::node_type or Graph::edge_type. It must have index().
+ * @tparam T      Value type.
+ * @tparam Index  The graph's size_type.
+ */
+template <typename Key, typename T, typename Index>
+class PropertyArray {
+ public:
+  using key_type = Key;
+  using value_type = T;
+  using size_type = std::size_t;
+  using reference = typename std::vector<T>::reference;
+  using const_reference = typename std::vector<T>::const_reference;
+  using storage_type = typename PropertyRegistry<Index>::template storage<T>;
+
+  /** Construct an array that belongs to no graph. */
+  PropertyArray() = default;
+  explicit PropertyArray(std::shared_ptr<storage_type> s) : s_(std::move(s)) {
+  }
+
+  /** Return the value of @a key.
+   * @pre key.index() < size()
+   *
+   * Complexity: O(1), one array access.
+   */
+  reference operator[](const Key& key) {
+    return s_->data[key.index()];
+  }
+  const_reference operator[](const Key& key) const {
+    return s_->data[key.index()];
+  }
+  /** Return the value of the node or edge with index @a i. */
+  reference operator[](size_type i) {
+    return s_->data[i];
+  }
+  const_reference operator[](size_type i) const {
+    return s_->data[i];
+  }
+
+  size_type size() const {
+    return s_ ? s_->data.size() : 0;
+  }
+  /** Set every entry to @a x. */
+  void fill(const T& x) {
+    s_->data.assign(s_->data.size(), x);
+  }
+  /** Return the values in index order. The reference is invalidated when
+   * the graph grows. */
+  std::vector<T>& values() {
+    return s_->data;
+  }
+  const std::vector<T>& values() const {
+    return s_->data;
+  }
+
+ private:
+  std::shared_ptr<storage_type> s_;
+};
+
+#endif // CME212_PROPERTY_MAP_HPP
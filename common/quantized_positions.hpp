@@ -0,0 +1,243 @@
+#ifndef CME212_QUANTIZED_POSITIONS_HPP
+#define CME212_QUANTIZED_POSITIONS_HPP
+
+/** @file quantized_positions.hpp
+ * @brief Node positions as fixed-point integers relative to a bounding box,
+ *        for graphs that are only looked at.
+ *
+ * A viewer needs a few thousandths of the screen, not 53 bits: a Point is
+ * 24 bytes a node, where 16-bit coordinates inside the mesh's bounding box
+ * are 6 and 21-bit ones, packed three to a 64-bit word, are 8. Building a
+ * QuantizedPositions once lets a visualization job drop its own copy of
+ * the positions and keep 3 to 4 times as many nodes in memory:
+ *
+ *   QuantizedPositions<16> q(g);                 // box and codes of g
+ *   Point p = q.position(i);                     // one node, decoded
+ *   std::vector<float> xyz(3 * q.size());
+ *   q.decode(xyz.data());                        // the viewer's buffer
+ *
+ * Every axis of the box [min, max] is cut into 2^Bits - 1 equal steps, so
+ * a decoded coordinate is within half a step, (max - min) / (2^(Bits + 1)
+ * - 2), of the original: 1/131070 of the box at 16 bits and 1/4194302 at
+ * 21. decode() writes interleaved x, y, z floats in parallel; its loop is
+ * one multiply-add a coordinate on codes of one width, which the compiler
+ * vectorizes.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "CME212/Point.hpp"
+
+
+namespace quantized_positions_detail {
+
+/** Codes of one position: three 16-bit integers. */
+struct code16 {
+  std::uint16_t c[3];
+
+  std::uint32_t get(int axis) const {
+    return c[axis];
+  }
+  void set(int axis, std::uint32_t v) {
+    c[axis] = std::uint16_t(v);
+  }
+};
+
+/** Codes of one position: three 21-bit integers in one word, x in the low
+ * bits. */
+struct code21 {
+  std::uint64_t w;
+
+  std::uint32_t get(int axis) const {
+    return std::uint32_t(w >> (21 * axis)) & 0x1FFFFFu;
+  }
+  void set(int axis, std::uint32_t v) {
+    w = (w & ~(std::uint64_t(0x1FFFFF) << (21 * axis))) |
+        (std::uint64_t(v) << (21 * axis));
+  }
+};
+
+} // end namespace quantized_positions_detail
+
+
+/** @class QuantizedPositions
+ * @brief One fixed-point position per node, inside a fixed bounding box.
+ *
+ * The box is taken from the positions at construction. set() clamps a
+ * position that has moved outside it; call rebuild() to fit the box to the
+ * positions again.
+ *
+ * @tparam Bits  Bits per coordinate: 16 (6 bytes a node) or 21 (8 bytes).
+ */
+template <unsigned Bits = 16>
+class QuantizedPositions {
+  static_assert(Bits == 16 || Bits == 21,
+                "QuantizedPositions stores 16 or 21 bits per coordinate");
+
+ public:
+  /** Type of one node's codes. */
+  using code_type = std::conditional_t<Bits == 16,
+                                       quantized_positions_detail::code16,
+                                       quantized_positions_detail::code21>;
+
+  /** Largest code of a coordinate. */
+  static constexpr std::uint32_t max_code = (std::uint32_t(1) << Bits) - 1;
+
+  /** Construct an empty array. */
+  QuantizedPositions() {
+  }
+
+  /** Quantize the positions of the nodes of @a g.
+   * @param[in] threads  Threads to quantize with; 0 means all cores
+   *
+   * Complexity: O(g.size()), spread over the threads.
+   */
+  template <typename G>
+  explicit QuantizedPositions(const G& g, unsigned threads = 0) {
+    rebuild(g, threads);
+  }
+
+  /** Fit the box to the positions of @a g, and quantize them again. */
+  template <typename G>
+  void rebuild(const G& g, unsigned threads = 0) {
+    threads = csr_snapshot::thread_count(threads);
+    std::size_t n = std::size_t(g.size());
+    codes_.resize(n);
+    std::vector<Point> lo(threads, Point(HUGE_VAL, HUGE_VAL, HUGE_VAL));
+    std::vector<Point> hi(threads, Point(-HUGE_VAL, -HUGE_VAL, -HUGE_VAL));
+    csr_snapshot::parallel_ranges(threads, n, 1 << 14,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i) {
+            Point p = point(g, i);
+            lo[t] = Point(std::min(lo[t].x, p.x), std::min(lo[t].y, p.y),
+                          std::min(lo[t].z, p.z));
+            hi[t] = Point(std::max(hi[t].x, p.x), std::max(hi[t].y, p.y),
+                          std::max(hi[t].z, p.z));
+          }
+        });
+    Point box_lo = n ? lo[0] : Point(0, 0, 0);
+    Point box_hi = n ? hi[0] : Point(0, 0, 0);
+    for (unsigned t = 1; t < threads; ++t) {
+      box_lo = Point(std::min(box_lo.x, lo[t].x), std::min(box_lo.y, lo[t].y),
+                     std::min(box_lo.z, lo[t].z));
+      box_hi = Point(std::max(box_hi.x, hi[t].x), std::max(box_hi.y, hi[t].y),
+                     std::max(box_hi.z, hi[t].z));
+    }
+    set_box(box_lo, box_hi);
+    csr_snapshot::parallel_ranges(threads, n, 1 << 14,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i)
+            set(i, point(g, i));
+        });
+  }
+
+  /** Return the number of positions. */
+  std::size_t size() const {
+    return codes_.size();
+  }
+
+  /** Return the corners of the box. */
+  const Point& box_min() const {
+    return lo_;
+  }
+  const Point& box_max() const {
+    return hi_;
+  }
+
+  /** Return position @a i, decoded.
+   * @pre @a i < size()
+   *
+   * Complexity: O(1).
+   */
+  Point position(std::size_t i) const {
+    assert(i < codes_.size());
+    const code_type& c = codes_[i];
+    return Point(lo_.x + step_[0] * double(c.get(0)),
+                 lo_.y + step_[1] * double(c.get(1)),
+                 lo_.z + step_[2] * double(c.get(2)));
+  }
+
+  /** Store @a p as position @a i, clamped to the box.
+   * @pre @a i < size()
+   */
+  void set(std::size_t i, const Point& p) {
+    assert(i < codes_.size());
+    const double x[3] = {p.x, p.y, p.z};
+    const double lo[3] = {lo_.x, lo_.y, lo_.z};
+    code_type& c = codes_[i];
+    for (int a = 0; a < 3; ++a) {
+      double q = inv_step_[a] * (x[a] - lo[a]);
+      q = std::min(std::max(q, 0.0), double(max_code));
+      c.set(a, std::uint32_t(q + 0.5));
+    }
+  }
+
+  /** Append position @a p, clamped to the box. */
+  void push_back(const Point& p) {
+    codes_.push_back(code_type());
+    set(codes_.size() - 1, p);
+  }
+
+  /** Decode positions [@a first, @a last) to @a out as interleaved x, y, z
+   * floats: out[3 * (i - first) + axis].
+   * @param[in] threads  Threads to decode with; 0 means all cores
+   *
+   * Complexity: O(last - first), spread over the threads.
+   */
+  void decode(float* out, std::size_t first, std::size_t last,
+              unsigned threads = 0) const {
+    assert(first <= last && last <= codes_.size());
+    const float lo[3] = {float(lo_.x), float(lo_.y), float(lo_.z)};
+    const float step[3] = {float(step_[0]), float(step_[1]), float(step_[2])};
+    const code_type* codes = codes_.data() + first;
+    csr_snapshot::parallel_ranges(csr_snapshot::thread_count(threads),
+                                  last - first, 1 << 15,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t k = b; k < e; ++k) {
+            const code_type& c = codes[k];
+            out[3 * k + 0] = lo[0] + step[0] * float(c.get(0));
+            out[3 * k + 1] = lo[1] + step[1] * float(c.get(1));
+            out[3 * k + 2] = lo[2] + step[2] * float(c.get(2));
+          }
+        });
+  }
+  void decode(float* out, unsigned threads = 0) const {
+    decode(out, 0, codes_.size(), threads);
+  }
+
+  /** Return the bytes held by the codes. */
+  std::size_t memory_usage() const {
+    return codes_.capacity() * sizeof(code_type);
+  }
+
+ private:
+  std::vector<code_type> codes_;
+  Point lo_ = Point(0, 0, 0);
+  Point hi_ = Point(0, 0, 0);
+  double step_[3] = {0, 0, 0};        // box extent / max_code, per axis
+  double inv_step_[3] = {0, 0, 0};    // its inverse, 0 for a flat axis
+
+  template <typename G>
+  static Point point(const G& g, std::size_t i) {
+    return g.node(typename G::size_type(i)).position();
+  }
+
+  void set_box(const Point& lo, const Point& hi) {
+    lo_ = lo;
+    hi_ = hi;
+    const double extent[3] = {hi.x - lo.x, hi.y - lo.y, hi.z - lo.z};
+    for (int a = 0; a < 3; ++a) {
+      step_[a] = extent[a] / max_code;
+      inv_step_[a] = extent[a] > 0 ? max_code / extent[a] : 0;
+    }
+  }
+};
+
+#endif // CME212_QUANTIZED_POSITIONS_HPP
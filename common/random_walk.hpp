@@ -0,0 +1,356 @@
+#ifndef CME212_RANDOM_WALK_HPP
+#define CME212_RANDOM_WALK_HPP
+
+/** @file random_walk.hpp
+ * @brief Parallel random walks, uniform, weighted or node2vec-biased, over
+ *        a CSR snapshot of a graph.
+ *
+ * Picking a random neighbor through the incident iterators means counting
+ * degree() and advancing k steps, O(degree) per step. WalkEngine copies
+ * the neighbor lists into one sorted CSR array once, and then every step
+ * is O(1): an index into the row for unweighted walks, and one draw from
+ * the row's alias table (Walker, "An Efficient Method for Generating
+ * Discrete Random Variables with General Distributions", ACM TOMS 1977,
+ * built as in Vose, IEEE TSE 1991) for weighted ones:
+ *
+ *   WalkEngine<G> walks(g, [](const auto& e) { return e.value(); });
+ *   std::vector<WalkEngine<G>::size_type> out;
+ *   walks.run_all(10, 80, out);     // 10 walks of 80 nodes from every node
+ *   // walk k is out[80 k .. 80 k + 80)
+ *
+ * With walk_options::p and q the walks are second order, as in node2vec
+ * (Grover and Leskovec, KDD 2016): a step from v, having come from t, to x
+ * is weighted by 1/p if x == t, 1 if x is a neighbor of t and 1/q
+ * otherwise. Steps draw x from the first-order distribution and accept it
+ * with probability bias / max bias, as in KnightKing (Yang et al., SOSP
+ * 2019), so no per edge pair table is needed; the neighbor test is a
+ * binary search of t's sorted row. After a run of rejections, as at a leaf
+ * with a large p, the step samples its exact distribution in one pass over
+ * the row instead, so no walk stalls.
+ *
+ * Walks run in parallel, each writing its own slice of one output array.
+ * Every walk has its own random stream keyed by the seed and the walk
+ * number, so a seed gives the same walks whatever the thread count.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/graph_generators.hpp"
+#include "common/trace.hpp"
+
+
+/** Tuning knobs for WalkEngine. */
+struct walk_options {
+  /** Worker threads. 0 means all cores. */
+  unsigned threads = 0;
+  /** Seed of the walks' random streams. */
+  std::uint64_t seed = 212;
+  /** node2vec return parameter: weight 1/p to step back. */
+  double p = 1;
+  /** node2vec in-out parameter: weight 1/q to step away from the previous
+   *  node's neighborhood. */
+  double q = 1;
+};
+
+/** What a batch of walks did and how fast. */
+struct walk_report {
+  std::uint64_t walks = 0;     // walks run
+  std::uint64_t steps = 0;     // steps taken over all walks
+  std::uint64_t rejected = 0;  // node2vec candidates drawn and rejected
+  double seconds = 0;          // wall time
+};
+
+
+/** @class WalkEngine
+ * @brief Reusable random walker over a snapshot of a graph's adjacency.
+ *
+ * As for BfsEngine, changes to the graph after construction are not seen,
+ * and reading the graph from several threads at once must be safe.
+ *
+ * @tparam G  Graph type with size(), node(i).edge_begin()/edge_end() and
+ *            size_type.
+ */
+template <typename G>
+class WalkEngine {
+ public:
+  /** Type of node indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Fills the rest of a walk that reached a node without neighbors. */
+  static constexpr size_type no_node = size_type(-1);
+
+  /** Snapshot @a g for walks that pick each neighbor with equal
+   * probability.
+   *
+   * Complexity: O(g.size() + g.num_edges()) plus sorting every row, spread
+   * over the threads.
+   */
+  explicit WalkEngine(const G& g, const walk_options& opt = walk_options())
+      : opt_(opt), threads_(csr_snapshot::thread_count(opt.threads)),
+        n_(std::size_t(g.size())),
+        offsets_(csr_snapshot::row_offsets(g, threads_)) {
+    neighbors_.resize(offsets_[n_]);
+    csr_snapshot::fill_neighbors(g, offsets_, threads_, neighbors_.data());
+    csr_snapshot::parallel_ranges(threads_, n_, 1024,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i)
+            std::sort(neighbors_.begin() + offsets_[i],
+                      neighbors_.begin() + offsets_[i + 1]);
+        });
+  }
+
+  /** Snapshot @a g for walks that step along edge e with probability
+   * proportional to weight(e).
+   * @pre weight(e) >= 0 for every edge, the same for both orientations
+   *
+   * A node whose incident edges all weigh 0 ends a walk like a node
+   * without neighbors.
+   *
+   * Complexity: O(g.size() + g.num_edges()) plus sorting every row, spread
+   * over the threads.
+   */
+  template <typename Weight>
+  WalkEngine(const G& g, Weight weight,
+             const walk_options& opt = walk_options())
+      : opt_(opt), threads_(csr_snapshot::thread_count(opt.threads)),
+        n_(std::size_t(g.size())),
+        offsets_(csr_snapshot::row_offsets(g, threads_)) {
+    std::size_t m = offsets_[n_];
+    std::vector<std::pair<size_type, double>> entries(m);
+    csr_snapshot::fill_rows(g, offsets_, threads_,
+        [&](std::size_t k, const auto& e) {
+          entries[k] = {size_type(e.node2().index()), double(weight(e))};
+        });
+    neighbors_.resize(m);
+    weight_.resize(m);
+    prob_.resize(m);
+    alias_.resize(m);
+    csr_snapshot::parallel_ranges(threads_, n_, 1024,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          std::vector<double> scaled;
+          std::vector<std::uint32_t> small, large;
+          for (std::size_t i = b; i < e; ++i) {
+            std::sort(entries.begin() + offsets_[i],
+                      entries.begin() + offsets_[i + 1]);
+            for (std::size_t k = offsets_[i]; k < offsets_[i + 1]; ++k) {
+              neighbors_[k] = entries[k].first;
+              weight_[k] = float(entries[k].second);
+            }
+            build_alias(i, entries, scaled, small, large);
+          }
+        });
+  }
+
+  /** Return the number of nodes in the snapshot. */
+  size_type size() const {
+    return size_type(n_);
+  }
+
+  /** Run one walk of @a length nodes from each of @a starts[0, count).
+   * @param[out] out  Resized to count * length; walk k is
+   *                  out[k * length, (k + 1) * length), starting with
+   *                  starts[k], and ends in no_node entries if it reached
+   *                  a node it cannot leave
+   * @return Counts and timing of the walks
+   *
+   * @pre Every start < size()
+   *
+   * Complexity: O(count * length) steps, spread over the threads; a
+   * node2vec step makes max(1/p, 1, 1/q) / (its mean bias) draws on
+   * average.
+   */
+  walk_report run(const size_type* starts, std::size_t count,
+                  std::size_t length, std::vector<size_type>& out) const {
+    CME212_TRACE_SCOPE_N("random_walks", count);
+    auto start = std::chrono::steady_clock::now();
+    out.resize(count * length);
+    std::vector<walk_report> part(threads_);
+    csr_snapshot::parallel_ranges(threads_, count, 64,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          walk_report r;
+          for (std::size_t k = b; k < e; ++k)
+            walk(k, starts[k], length, out.data() + k * length, r);
+          part[t] = r;
+        });
+    walk_report report;
+    report.walks = count;
+    for (const walk_report& r : part) {
+      report.steps += r.steps;
+      report.rejected += r.rejected;
+    }
+    report.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return report;
+  }
+
+  /** Run @a per_node walks of @a length nodes from every node, the walks
+   * from node i being walks i * per_node .. of @a out, as in run().
+   *
+   * Complexity: O(size() * per_node * length), spread over the threads.
+   */
+  walk_report run_all(std::size_t per_node, std::size_t length,
+                      std::vector<size_type>& out) const {
+    std::vector<size_type> starts(n_ * per_node);
+    for (std::size_t i = 0; i < n_; ++i)
+      std::fill_n(starts.begin() + i * per_node, per_node, size_type(i));
+    return run(starts.data(), starts.size(), length, out);
+  }
+
+ private:
+  using rng_type = graph_generators_detail::element_rng;
+  // Salt of the walk streams, apart from the generators' streams
+  static constexpr std::uint64_t walk_salt = 3;
+  // Rejections in a row after which a node2vec step samples exactly
+  static constexpr unsigned max_rejections = 16;
+
+  walk_options opt_;
+  unsigned threads_;
+  std::size_t n_;
+  std::vector<std::size_t> offsets_;
+  std::vector<size_type> neighbors_;   // every row sorted
+  // Weight and alias table of weighted rows, one entry per row slot: slot j
+  // keeps itself with probability prob_[j] and passes on to alias_[j]
+  // otherwise. Empty for unweighted walks.
+  std::vector<float> weight_;
+  std::vector<float> prob_;
+  std::vector<std::uint32_t> alias_;
+
+  /** Fill the alias table of row @a i from the weights in @a entries,
+   * with scratch arrays of the calling thread. Rows with no weight get
+   * prob 0 and alias past the row, which walk() reads as a dead end. */
+  void build_alias(std::size_t i,
+                   const std::vector<std::pair<size_type, double>>& entries,
+                   std::vector<double>& scaled,
+                   std::vector<std::uint32_t>& small,
+                   std::vector<std::uint32_t>& large) {
+    std::size_t off = offsets_[i];
+    std::uint32_t d = std::uint32_t(offsets_[i + 1] - off);
+    double total = 0;
+    for (std::uint32_t j = 0; j < d; ++j)
+      total += entries[off + j].second;
+    if (!(total > 0)) {
+      std::fill_n(prob_.begin() + off, d, 0.0f);
+      std::fill_n(alias_.begin() + off, d, d);
+      return;
+    }
+    scaled.resize(d);
+    small.clear();
+    large.clear();
+    for (std::uint32_t j = 0; j < d; ++j) {
+      scaled[j] = entries[off + j].second * d / total;
+      (scaled[j] < 1 ? small : large).push_back(j);
+    }
+    while (!small.empty() && !large.empty()) {
+      std::uint32_t s = small.back(), l = large.back();
+      small.pop_back();
+      prob_[off + s] = float(scaled[s]);
+      alias_[off + s] = l;
+      scaled[l] -= 1 - scaled[s];
+      if (scaled[l] < 1) {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+    // What is left has probability 1 up to rounding
+    for (std::uint32_t j : large) {
+      prob_[off + j] = 1;
+      alias_[off + j] = j;
+    }
+    for (std::uint32_t j : small) {
+      prob_[off + j] = 1;
+      alias_[off + j] = j;
+    }
+  }
+
+  /** Draw a neighbor slot of row @a v, or return false at a dead end. */
+  bool draw(size_type v, rng_type& rng, std::size_t& slot) const {
+    std::size_t off = offsets_[v];
+    std::size_t d = offsets_[v + 1] - off;
+    if (d == 0)
+      return false;
+    std::size_t j = std::size_t(rng.below(d));
+    if (!prob_.empty() && !(rng.uniform() < prob_[off + j])) {
+      j = alias_[off + j];
+      if (j >= d)
+        return false;
+    }
+    slot = off + j;
+    return true;
+  }
+
+  /** Return true if @a x is a neighbor of @a t. */
+  bool adjacent(size_type t, size_type x) const {
+    return std::binary_search(neighbors_.begin() + offsets_[t],
+                              neighbors_.begin() + offsets_[t + 1], x);
+  }
+
+  /** Return a neighbor of @a v drawn with probability proportional to its
+   * weight times its node2vec bias, having come from @a t. */
+  size_type draw_exact(size_type v, size_type t, double back, double away,
+                       rng_type& rng) const {
+    std::size_t b = offsets_[v], e = offsets_[v + 1];
+    auto mass = [&](std::size_t k) {
+      size_type x = neighbors_[k];
+      double w = weight_.empty() ? 1.0 : double(weight_[k]);
+      return w * (x == t ? back : adjacent(t, x) ? 1.0 : away);
+    };
+    double total = 0;
+    for (std::size_t k = b; k < e; ++k)
+      total += mass(k);
+    double u = rng.uniform() * total;
+    std::size_t k = b;
+    for (; k + 1 < e; ++k) {
+      u -= mass(k);
+      if (u < 0)
+        break;
+    }
+    return neighbors_[k];
+  }
+
+  /** Write walk @a k of @a length nodes from @a v to @a path. */
+  void walk(std::size_t k, size_type v, std::size_t length, size_type* path,
+            walk_report& report) const {
+    assert(std::size_t(v) < n_);
+    if (length == 0)
+      return;
+    rng_type rng(opt_.seed, walk_salt, k);
+    bool biased = opt_.p != 1 || opt_.q != 1;
+    double back = 1 / opt_.p, away = 1 / opt_.q;
+    double top = std::max(std::max(back, 1.0), away);
+    path[0] = v;
+    std::size_t s = 1;
+    for (; s < length; ++s) {
+      std::size_t slot;
+      if (!draw(v, rng, slot))
+        break;
+      size_type x = neighbors_[slot];
+      if (biased && s >= 2) {
+        size_type t = path[s - 2];
+        for (unsigned tries = 0; ; ++tries) {
+          double bias = x == t ? back : adjacent(t, x) ? 1.0 : away;
+          if (rng.uniform() * top < bias)
+            break;
+          ++report.rejected;
+          if (tries == max_rejections) {
+            x = draw_exact(v, t, back, away, rng);
+            break;
+          }
+          draw(v, rng, slot);
+          x = neighbors_[slot];
+        }
+      }
+      path[s] = v = x;
+    }
+    report.steps += s - 1;
+    std::fill(path + s, path + length, no_node);
+  }
+};
+
+#endif // CME212_RANDOM_WALK_HPP
@@ -0,0 +1,361 @@
+#ifndef CME212_RELOCATING_VECTOR_HPP
+#define CME212_RELOCATING_VECTOR_HPP
+
+/** @file relocating_vector.hpp
+ * @brief Contiguous array that grows by realloc() and mremap() instead of
+ *        moving elements one by one, when its element type allows it.
+ *
+ * When a std::vector runs out of capacity it allocates a new buffer,
+ * move-constructs every element into it and destroys the old ones, even
+ * when the elements are plain bytes. For a type whose bytes can be moved
+ * to a new address without running any code, RelocatingVector instead
+ * hands the buffer to std::realloc(), which often extends it in place and
+ * otherwise copies it with one memcpy(). Buffers of map_threshold bytes or
+ * more are anonymous page mappings grown with mremap(), which moves page
+ * table entries rather than bytes, so growing a 1 GB node array costs
+ * microseconds, not a copy of a gigabyte:
+ *
+ *   RelocatingVector<internal_node> nodes;   // as for std::vector
+ *   nodes.push_back({position, value});
+ *
+ * Whether a type may be relocated so is the trait is_trivially_relocatable,
+ * true for trivially copyable types; specialize it for a type that holds,
+ * say, an owning pointer it never points back into the array from. Other
+ * types grow as in std::vector, by moving each element.
+ *
+ * Graphs that declare nodes_ and edges_ as graph_storage<...>
+ * (segmented_array.hpp) get RelocatingVector with
+ * -DCME212_RELOCATING_STORAGE=1.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+/** Whether an object of type T may be moved to another address by copying
+ * its bytes, the original then being forgotten rather than destroyed. */
+template <typename T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+
+namespace relocating_vector_detail {
+
+inline std::size_t page_size() {
+  static const std::size_t size = std::size_t(::sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+} // end namespace relocating_vector_detail
+
+
+/** @class RelocatingVector
+ * @brief A std::vector-like array whose growth relocates trivially
+ *        relocatable elements in bulk.
+ *
+ * Iterators are pointers. As for std::vector, growing invalidates every
+ * pointer and reference into the array, and its capacity doubles, so
+ * push_back() is O(1) amortized.
+ *
+ * @tparam T  Element type.
+ */
+template <typename T>
+class RelocatingVector {
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  /** Whether growth relocates the buffer in bulk rather than element by
+   * element. Over-aligned types take the element path, as malloc() only
+   * aligns to std::max_align_t. */
+  static constexpr bool bulk = is_trivially_relocatable<T>::value &&
+                               alignof(T) <= alignof(std::max_align_t);
+
+  /** Size in bytes from which a bulk buffer is a page mapping. */
+  static constexpr std::size_t map_threshold = std::size_t(1) << 21;
+
+  /** Construct an empty array. No memory is allocated until the first
+   * push_back(). */
+  RelocatingVector() : data_(nullptr), size_(0), capacity_(0), mapped_(0) {
+  }
+
+  /** Construct an array of @a n value-initialized elements. */
+  explicit RelocatingVector(size_type n) : RelocatingVector() {
+    resize(n);
+  }
+
+  RelocatingVector(const RelocatingVector& other) : RelocatingVector() {
+    reserve(other.size_);
+    if constexpr (std::is_trivially_copyable<T>::value) {
+      if (other.size_)
+        std::memcpy(static_cast<void*>(data_), other.data_, other.size_ * sizeof(T));
+    } else {
+      std::uninitialized_copy(other.begin(), other.end(), data_);
+    }
+    size_ = other.size_;
+  }
+
+  RelocatingVector(RelocatingVector&& other) noexcept : RelocatingVector() {
+    swap(other);
+  }
+
+  RelocatingVector& operator=(RelocatingVector other) noexcept {
+    swap(other);
+    return *this;
+  }
+
+  ~RelocatingVector() {
+    clear();
+    release(data_, capacity_, mapped_);
+  }
+
+  void swap(RelocatingVector& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(mapped_, other.mapped_);
+  }
+
+  size_type size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+  size_type capacity() const {
+    return capacity_;
+  }
+
+  T* data() {
+    return data_;
+  }
+  const T* data() const {
+    return data_;
+  }
+
+  reference operator[](size_type i) {
+    assert(i < size_);
+    return data_[i];
+  }
+  const_reference operator[](size_type i) const {
+    assert(i < size_);
+    return data_[i];
+  }
+
+  reference front() {
+    assert(!empty());
+    return data_[0];
+  }
+  const_reference front() const {
+    assert(!empty());
+    return data_[0];
+  }
+  reference back() {
+    assert(!empty());
+    return data_[size_ - 1];
+  }
+  const_reference back() const {
+    assert(!empty());
+    return data_[size_ - 1];
+  }
+
+  iterator begin() {
+    return data_;
+  }
+  iterator end() {
+    return data_ + size_;
+  }
+  const_iterator begin() const {
+    return data_;
+  }
+  const_iterator end() const {
+    return data_ + size_;
+  }
+
+  /** Make room for @a n elements without further growth.
+   * @post capacity() >= @a n
+   *
+   * Complexity: O(1) for a bulk array moved by mremap() or extended in
+   * place by realloc(), O(size()) otherwise.
+   */
+  void reserve(size_type n) {
+    if (n > capacity_)
+      grow(n);
+  }
+
+  /** Construct an element from @a args at the end.
+   * @post size() == old size() + 1
+   *
+   * Complexity: O(1) amortized.
+   */
+  template <typename... Args>
+  reference emplace_back(Args&&... args) {
+    if (size_ == capacity_) {
+      // args may refer into the buffer that growing frees
+      T x(std::forward<Args>(args)...);
+      grow(next_capacity(size_ + 1));
+      ::new (static_cast<void*>(data_ + size_)) T(std::move(x));
+    } else {
+      ::new (static_cast<void*>(data_ + size_)) T(std::forward<Args>(args)...);
+    }
+    return data_[size_++];
+  }
+
+  void push_back(const T& x) {
+    emplace_back(x);
+  }
+  void push_back(T&& x) {
+    emplace_back(std::move(x));
+  }
+
+  void pop_back() {
+    assert(!empty());
+    data_[--size_].~T();
+  }
+
+  /** Resize to @a n elements, value-initializing the new ones. */
+  void resize(size_type n) {
+    if (n > capacity_)
+      grow(std::max(n, next_capacity(n)));
+    while (size_ < n) {
+      ::new (static_cast<void*>(data_ + size_)) T();
+      ++size_;
+    }
+    while (size_ > n)
+      pop_back();
+  }
+
+  /** Destroy every element, keeping the capacity.
+   * @post size() == 0
+   */
+  void clear() {
+    if constexpr (!std::is_trivially_destructible<T>::value) {
+      for (size_type i = 0; i < size_; ++i)
+        data_[i].~T();
+    }
+    size_ = 0;
+  }
+
+  /** Reduce the capacity to size(), or to the whole pages that hold it
+   * for a page mapping. */
+  void shrink_to_fit() {
+    if (size_ == capacity_)
+      return;
+    if (size_ == 0) {
+      release(data_, capacity_, mapped_);
+      data_ = nullptr;
+      capacity_ = 0;
+      mapped_ = 0;
+      return;
+    }
+    grow(size_);
+  }
+
+ private:
+  T* data_;
+  size_type size_;
+  size_type capacity_;
+  // Length in bytes of the page mapping behind data_, 0 if data_ is from
+  // malloc() or std::allocator
+  std::size_t mapped_;
+
+  size_type next_capacity(size_type n) const {
+    return std::max<size_type>(std::max<size_type>(2 * capacity_, n), 8);
+  }
+
+  /** Move the elements to a buffer of @a n >= size() elements. */
+  void grow(size_type n) {
+    assert(n >= size_);
+    if constexpr (bulk)
+      relocate(n);
+    else
+      move_to(n);
+  }
+
+  /** Bulk growth: remap a page mapping, move into one once the buffer is
+   * large enough, and realloc() below that. */
+  void relocate(size_type n) {
+    std::size_t bytes = n * sizeof(T);
+    if (mapped_ || bytes >= map_threshold) {
+      std::size_t page = relocating_vector_detail::page_size();
+      bytes = (bytes + page - 1) / page * page;
+      void* p;
+      if (mapped_) {
+        p = ::mremap(data_, mapped_, bytes, MREMAP_MAYMOVE);
+      } else {
+        p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED && size_)
+          std::memcpy(p, static_cast<void*>(data_), size_ * sizeof(T));
+      }
+      if (p == MAP_FAILED)
+        throw std::bad_alloc();
+      if (!mapped_)
+        std::free(data_);
+      data_ = static_cast<T*>(p);
+      mapped_ = bytes;
+      capacity_ = bytes / sizeof(T);
+      return;
+    }
+    void* p = std::realloc(static_cast<void*>(data_), bytes);
+    if (!p)
+      throw std::bad_alloc();
+    data_ = static_cast<T*>(p);
+    capacity_ = n;
+  }
+
+  /** Element growth, as std::vector does it: move each element if that
+   * cannot throw, copy it otherwise. */
+  void move_to(size_type n) {
+    T* p = std::allocator<T>().allocate(n);
+    try {
+      if constexpr (std::is_nothrow_move_constructible<T>::value ||
+                    !std::is_copy_constructible<T>::value)
+        std::uninitialized_move(data_, data_ + size_, p);
+      else
+        std::uninitialized_copy(data_, data_ + size_, p);
+    } catch (...) {
+      std::allocator<T>().deallocate(p, n);
+      throw;
+    }
+    size_type size = size_;
+    clear();
+    release(data_, capacity_, mapped_);
+    data_ = p;
+    size_ = size;
+    capacity_ = n;
+  }
+
+  /** Free a buffer of @a capacity elements, mapped over @a mapped bytes
+   * if that is not 0. */
+  static void release(T* data, size_type capacity, std::size_t mapped) {
+    if (!data)
+      return;
+    if constexpr (bulk) {
+      (void) capacity;
+      if (mapped)
+        ::munmap(static_cast<void*>(data), mapped);
+      else
+        std::free(data);
+    } else {
+      (void) mapped;
+      std::allocator<T>().deallocate(data, capacity);
+    }
+  }
+};
+
+#endif // CME212_RELOCATING_VECTOR_HPP
@@ -0,0 +1,200 @@
+#ifndef CME212_RESULT_CACHE_HPP
+#define CME212_RESULT_CACHE_HPP
+
+/** @file result_cache.hpp
+ * @brief Memoized algorithm results, kept until the graph's topology
+ *        changes.
+ *
+ * Services that ask for the same derived data over and over (components,
+ * a degree ordering, BFS distances from a few popular roots) can put those
+ * queries behind a ResultCache. Every result is stored under a name and an
+ * optional integer argument and handed back without recomputing for as
+ * long as the graph's topology_version() stays the same:
+ *
+ *   ResultCache<GraphType> cache(g);
+ *   const auto& comp = cache.get("components", [](const GraphType& g) {
+ *     return connected_components(g);
+ *   });
+ *   const auto& dist = cache.get("bfs", root, [&](const GraphType& g) {
+ *     std::vector<size_type> d;
+ *     BfsEngine<const GraphType>(g).run(root, d);
+ *     return d;
+ *   });
+ *
+ * A graph takes a new version from next_topology_version() whenever a node
+ * or edge is added or removed and whenever nodes or edges are renumbered.
+ * Versions are unique across all graphs of the process, so a version names
+ * one topology: a copy shares it, and swapping or moving graphs can never
+ * make a cache mistake another graph's results for its own. Positions and
+ * values are not part of the topology; results that depend on them need
+ * their own invalidation.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+
+
+/** Return a topology version no graph has had before. Thread safe. */
+inline std::uint64_t next_topology_version() {
+  static std::atomic<std::uint64_t> counter(0);
+  return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+
+/** Hit and miss counts of a ResultCache. */
+struct result_cache_report {
+  std::size_t hits = 0;     // get() calls answered from the cache
+  std::size_t misses = 0;   // get() calls that ran their computation
+  std::size_t flushes = 0;  // times a new topology version dropped entries
+};
+
+
+namespace result_cache_detail {
+
+struct key {
+  std::string name;
+  std::uint64_t arg;
+
+  bool operator==(const key& x) const {
+    return arg == x.arg && name == x.name;
+  }
+};
+
+struct key_hash {
+  std::size_t operator()(const key& k) const {
+    std::size_t h = std::hash<std::string>()(k.name);
+    return h ^ (std::hash<std::uint64_t>()(k.arg) + 0x9e3779b97f4a7c15ull +
+                (h << 6) + (h >> 2));
+  }
+};
+
+/** A result of any type, with the type it was stored as. */
+struct entry {
+  std::shared_ptr<void> value;
+  std::type_index type;
+};
+
+} // end namespace result_cache_detail
+
+
+/** @class ResultCache
+ * @brief Results of computations on a graph, keyed by name and argument,
+ *        dropped as soon as the graph's topology changes.
+ *
+ * Every lookup compares the graph's topology_version() with the version
+ * the entries were computed at; on a change all entries go at once, since
+ * all of them are stale, so stale results never pile up. A hit costs one
+ * hash lookup.
+ *
+ * The cache refers to the graph, which must outlive it. It is not thread
+ * safe: calls must not race with each other or with changes to the graph.
+ *
+ * @tparam G  Graph type with topology_version(), e.g. Graph<V, E>.
+ */
+template <typename G>
+class ResultCache {
+ public:
+  /** Construct an empty cache of results on @a g. */
+  explicit ResultCache(const G& g) : g_(&g), version_(g.topology_version()) {
+  }
+
+  /** Return the graph. */
+  const G& graph() const {
+    return *g_;
+  }
+
+  /** Return the result stored as @a name, computing it as @a compute(g)
+   * first if the topology changed since, or it was never computed.
+   * @return A reference that stays valid until the entry is dropped: by
+   *         the next get() after a topology change, erase() or clear()
+   * @throws std::runtime_error if @a name was stored with another result
+   *         type
+   *
+   * Complexity: O(1) expected on a hit; one @a compute call on a miss.
+   */
+  template <typename F>
+  const auto& get(const std::string& name, F compute) {
+    return get(name, 0, std::move(compute));
+  }
+
+  /** Return the result stored as @a name for argument @a arg, e.g. the
+   * root of a search, computing it as @a compute(g) if needed. As get()
+   * without argument otherwise. */
+  template <typename F>
+  const auto& get(const std::string& name, std::uint64_t arg, F compute) {
+    using result_type = std::decay_t<std::invoke_result_t<F&, const G&>>;
+    refresh();
+    result_cache_detail::key k{name, arg};
+    auto it = entries_.find(k);
+    if (it != entries_.end()) {
+      if (it->second.type != std::type_index(typeid(result_type)))
+        throw std::runtime_error("ResultCache: " + name +
+                                 " was stored with another result type");
+      ++report_.hits;
+      return *static_cast<const result_type*>(it->second.value.get());
+    }
+    ++report_.misses;
+    auto value = std::make_shared<result_type>(compute(*g_));
+    const result_type& out = *value;
+    entries_.insert_or_assign(std::move(k),
+        result_cache_detail::entry{std::move(value),
+                                   std::type_index(typeid(result_type))});
+    return out;
+  }
+
+  /** Return true if a result is stored as @a name and @a arg for the
+   * current topology. */
+  bool contains(const std::string& name, std::uint64_t arg = 0) const {
+    return version_ == g_->topology_version() &&
+           entries_.count(result_cache_detail::key{name, arg}) != 0;
+  }
+
+  /** Drop the result stored as @a name and @a arg, if any. */
+  void erase(const std::string& name, std::uint64_t arg = 0) {
+    entries_.erase(result_cache_detail::key{name, arg});
+  }
+
+  /** Drop every result. */
+  void clear() {
+    entries_.clear();
+  }
+
+  /** Return the number of results stored, current or not yet dropped. */
+  std::size_t size() const {
+    return entries_.size();
+  }
+
+  /** Return the hit, miss and flush counts so far. */
+  const result_cache_report& report() const {
+    return report_;
+  }
+
+ private:
+  const G* g_;
+  std::uint64_t version_;
+  std::unordered_map<result_cache_detail::key, result_cache_detail::entry,
+                     result_cache_detail::key_hash> entries_;
+  result_cache_report report_;
+
+  /** Drop every entry if the topology changed since they were computed. */
+  void refresh() {
+    std::uint64_t v = g_->topology_version();
+    if (v == version_)
+      return;
+    if (!entries_.empty())
+      ++report_.flushes;
+    entries_.clear();
+    version_ = v;
+  }
+};
+
+#endif // CME212_RESULT_CACHE_HPP
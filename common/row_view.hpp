@@ -0,0 +1,117 @@
+#ifndef CME212_ROW_VIEW_HPP
+#define CME212_ROW_VIEW_HPP
+
+/** @file row_view.hpp
+ * @brief A zero-copy view over one row of a Graph's adjacency storage.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+
+/** @class RowView
+ * @brief Non-owning range over a contiguous row of ids.
+ *
+ * A RowView holds two pointers into a Graph's adjacency row and a small
+ * mapping functor. Dereferencing applies the functor to the stored id, so a
+ * row of edge ids or neighbor indices can be presented to callers as a range
+ * of neighbor Nodes without copying the row or allocating.
+ *
+ * @tparam Id  Type of the ids stored in the row (usually the Graph's
+ *             size_type).
+ * @tparam Fn  Copyable functor with a const call operator taking an Id and
+ *             returning the element to expose.
+ *
+ * The view is invalidated by any Graph operation that modifies the row,
+ * such as add_edge() on either endpoint.
+ */
+template <typename Id, typename Fn>
+class RowView {
+ public:
+  /** Type of the elements the view yields. */
+  using value_type = decltype(std::declval<const Fn&>()(std::declval<Id>()));
+  /** Type of sizes. */
+  using size_type = std::size_t;
+
+  /** @class RowView::iterator
+   * @brief Random access iterator over the view. Yields elements by value. */
+  class iterator {
+   public:
+    using value_type        = RowView::value_type;
+    using pointer           = void;
+    using reference         = RowView::value_type;
+    using difference_type   = std::ptrdiff_t;
+    using iterator_category = std::random_access_iterator_tag;
+
+    /** Construct an invalid iterator. */
+    iterator() : pos_(nullptr), fn_() {
+    }
+
+    value_type operator*() const { return fn_(*pos_); }
+    value_type operator[](difference_type n) const { return fn_(pos_[n]); }
+
+    iterator& operator++() { ++pos_; return *this; }
+    iterator operator++(int) { iterator tmp = *this; ++pos_; return tmp; }
+    iterator& operator--() { --pos_; return *this; }
+    iterator operator--(int) { iterator tmp = *this; --pos_; return tmp; }
+    iterator& operator+=(difference_type n) { pos_ += n; return *this; }
+    iterator& operator-=(difference_type n) { pos_ -= n; return *this; }
+    iterator operator+(difference_type n) const { iterator t = *this; return t += n; }
+    iterator operator-(difference_type n) const { iterator t = *this; return t -= n; }
+    difference_type operator-(const iterator& x) const { return pos_ - x.pos_; }
+
+    bool operator==(const iterator& x) const { return pos_ == x.pos_; }
+    bool operator!=(const iterator& x) const { return pos_ != x.pos_; }
+    bool operator<(const iterator& x) const { return pos_ < x.pos_; }
+    bool operator>(const iterator& x) const { return pos_ > x.pos_; }
+    bool operator<=(const iterator& x) const { return pos_ <= x.pos_; }
+    bool operator>=(const iterator& x) const { return pos_ >= x.pos_; }
+
+   private:
+    friend class RowView;
+    const Id* pos_;
+    Fn fn_;
+    iterator(const Id* pos, const Fn& fn) : pos_(pos), fn_(fn) {
+    }
+  };
+
+  /** Construct an empty view. */
+  RowView() : first_(nullptr), last_(nullptr), fn_() {
+  }
+
+  /** Construct a view of the ids in [@a first, @a last).
+   * @pre [@a first, @a last) is a valid contiguous range
+   */
+  RowView(const Id* first, const Id* last, const Fn& fn)
+      : first_(first), last_(last), fn_(fn) {
+  }
+
+  iterator begin() const { return iterator(first_, fn_); }
+  iterator end() const { return iterator(last_, fn_); }
+
+  /** Return the number of elements in the row. */
+  size_type size() const { return size_type(last_ - first_); }
+  /** Return true if the row is empty. */
+  bool empty() const { return first_ == last_; }
+
+  /** Return the @a i th element.
+   * @pre @a i < size()
+   */
+  value_type operator[](size_type i) const {
+    assert(i < size());
+    return fn_(first_[i]);
+  }
+
+  /** Return the raw ids of the row, without the mapping applied. */
+  const Id* ids_begin() const { return first_; }
+  const Id* ids_end() const { return last_; }
+
+ private:
+  const Id* first_;
+  const Id* last_;
+  Fn fn_;
+};
+
+#endif // CME212_ROW_VIEW_HPP
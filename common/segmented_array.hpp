@@ -0,0 +1,606 @@
+#ifndef CME212_SEGMENTED_ARRAY_HPP
+#define CME212_SEGMENTED_ARRAY_HPP
+
+/** @file segmented_array.hpp
+ * @brief Append-only array in fixed-size chunks whose elements never move.
+ *
+ * Graphs whose nodes_ and edges_ only grow can declare them as
+ * graph_storage<...>. By default that is std::vector. Build with
+ * -DCME212_SEGMENTED_STORAGE=1 to get SegmentedArray instead: add_node()
+ * then never relocates the existing nodes, so there is no latency spike
+ * when capacity runs out, and references to elements stay valid.
+ *
+ * SegmentedArray takes one writer. ConcurrentAppendArray takes any number
+ * of threads appending at once, without locks, for graphs whose add_node()
+ * is called from several producers.
+ *
+ * -DCME212_RELOCATING_STORAGE=1 instead keeps one contiguous buffer, as
+ * std::vector does, but grows it by realloc() or mremap() when the
+ * elements are trivially relocatable (relocating_vector.hpp).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/relocating_vector.hpp"
+
+#ifndef CME212_SEGMENTED_STORAGE
+#define CME212_SEGMENTED_STORAGE 0
+#endif
+#ifndef CME212_RELOCATING_STORAGE
+#define CME212_RELOCATING_STORAGE 0
+#endif
+
+
+namespace segmented_array_detail {
+
+/** Random access iterator over the elements of an array A of T, holding an
+ * index. */
+template <typename A, typename T, bool Const>
+class index_iterator {
+  using array_type = std::conditional_t<Const, const A, A>;
+
+ public:
+  using value_type = T;
+  using pointer = std::conditional_t<Const, const T*, T*>;
+  using reference = std::conditional_t<Const, const T&, T&>;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::random_access_iterator_tag;
+
+  index_iterator() : a_(nullptr), i_(0) {
+  }
+  index_iterator(array_type* a, std::size_t i) : a_(a), i_(i) {
+  }
+  /** Convert an iterator to a const_iterator. */
+  template <bool C = Const, typename = std::enable_if_t<C>>
+  index_iterator(const index_iterator<A, T, false>& it) : a_(it.a_), i_(it.i_) {
+  }
+
+  reference operator*() const {
+    return (*a_)[i_];
+  }
+  pointer operator->() const {
+    return &(*a_)[i_];
+  }
+  reference operator[](difference_type k) const {
+    return (*a_)[i_ + k];
+  }
+
+  index_iterator& operator++() {
+    ++i_;
+    return *this;
+  }
+  index_iterator operator++(int) {
+    index_iterator tmp = *this;
+    ++i_;
+    return tmp;
+  }
+  index_iterator& operator--() {
+    --i_;
+    return *this;
+  }
+  index_iterator operator--(int) {
+    index_iterator tmp = *this;
+    --i_;
+    return tmp;
+  }
+  index_iterator& operator+=(difference_type k) {
+    i_ += k;
+    return *this;
+  }
+  index_iterator& operator-=(difference_type k) {
+    i_ -= k;
+    return *this;
+  }
+  friend index_iterator operator+(index_iterator it, difference_type k) {
+    return it += k;
+  }
+  friend index_iterator operator+(difference_type k, index_iterator it) {
+    return it += k;
+  }
+  friend index_iterator operator-(index_iterator it, difference_type k) {
+    return it -= k;
+  }
+  friend difference_type operator-(const index_iterator& x,
+                                   const index_iterator& y) {
+    return difference_type(x.i_) - difference_type(y.i_);
+  }
+
+  bool operator==(const index_iterator& x) const { return i_ == x.i_; }
+  bool operator!=(const index_iterator& x) const { return i_ != x.i_; }
+  bool operator<(const index_iterator& x) const { return i_ < x.i_; }
+  bool operator>(const index_iterator& x) const { return i_ > x.i_; }
+  bool operator<=(const index_iterator& x) const { return i_ <= x.i_; }
+  bool operator>=(const index_iterator& x) const { return i_ >= x.i_; }
+
+ private:
+  friend class index_iterator<A, T, true>;
+  array_type* a_;
+  std::size_t i_;
+};
+
+} // end namespace segmented_array_detail
+
+
+/** @class SegmentedArray
+ * @brief Array of T stored in chunks of @a ChunkSize elements, reached
+ *        through a directory of chunk pointers.
+ *
+ * Growing never copies or moves an element: a full chunk is followed by a
+ * freshly allocated one, so references and pointers to elements stay valid
+ * until clear() or destruction. push_back() costs one element construction,
+ * plus one chunk allocation every ChunkSize elements and, when the
+ * directory fills up, a copy of its chunk pointers into one twice as large
+ * (n / ChunkSize pointers, never element data).
+ *
+ * One writer may append while other threads read. size() is published with
+ * release semantics after the new element is constructed, and replaced
+ * directories are kept until clear(), so a reader may load() any index
+ * below a size() it has loaded. operator[] reads the writer's own copy of
+ * the directory: it is as cheap as a plain two-level lookup, but only the
+ * writer, or any thread while nobody appends, may use it. Elements
+ * themselves are not synchronized: readers see an element as it was when
+ * it was published, as long as the writer does not modify it afterwards.
+ *
+ * @tparam T          Element type.
+ * @tparam ChunkSize  Elements per chunk, a power of two.
+ */
+template <typename T, std::size_t ChunkSize = 1024>
+class SegmentedArray {
+  static_assert(ChunkSize != 0 && (ChunkSize & (ChunkSize - 1)) == 0,
+                "ChunkSize must be a power of two");
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using reference = T&;
+  using const_reference = const T&;
+
+  using iterator = segmented_array_detail::index_iterator<SegmentedArray, T, false>;
+  using const_iterator = segmented_array_detail::index_iterator<SegmentedArray, T, true>;
+
+  /** Construct an empty array. No memory is allocated until the first
+   * push_back(). */
+  SegmentedArray() : dir_(nullptr), shared_dir_(nullptr), size_(0) {
+  }
+
+  /** Construct an array of @a n value-initialized elements. */
+  explicit SegmentedArray(size_type n) : SegmentedArray() {
+    for (size_type i = 0; i < n; ++i)
+      emplace_back();
+  }
+
+  SegmentedArray(const SegmentedArray& other) : SegmentedArray() {
+    for (size_type i = 0; i < other.size(); ++i)
+      push_back(other[i]);
+  }
+
+  SegmentedArray(SegmentedArray&& other) noexcept : SegmentedArray() {
+    swap(other);
+  }
+
+  SegmentedArray& operator=(SegmentedArray other) noexcept {
+    swap(other);
+    return *this;
+  }
+
+  ~SegmentedArray() {
+    clear();
+  }
+
+  void swap(SegmentedArray& other) noexcept {
+    std::swap(dir_, other.dir_);
+    T** d = shared_dir_.load(std::memory_order_relaxed);
+    shared_dir_.store(other.shared_dir_.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+    other.shared_dir_.store(d, std::memory_order_relaxed);
+    size_type n = size_.load(std::memory_order_relaxed);
+    size_.store(other.size_.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+    other.size_.store(n, std::memory_order_relaxed);
+    directories_.swap(other.directories_);
+  }
+
+  /** Return the number of published elements. */
+  size_type size() const {
+    return size_.load(std::memory_order_acquire);
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  /** Return element @a i.
+   * @pre @a i < size()
+   * @pre Called by the writer, or while no thread appends
+   *
+   * Complexity: O(1), two dependent loads.
+   */
+  reference operator[](size_type i) {
+    return dir_[i / ChunkSize][i % ChunkSize];
+  }
+  const_reference operator[](size_type i) const {
+    return dir_[i / ChunkSize][i % ChunkSize];
+  }
+
+  /** Return element @a i from a thread that reads while another appends.
+   * @pre @a i < a value of size() loaded by this thread
+   *
+   * Complexity: O(1), an acquire load of the directory and two dependent
+   * loads.
+   */
+  const_reference load(size_type i) const {
+    return shared_dir_.load(std::memory_order_acquire)[i / ChunkSize][i % ChunkSize];
+  }
+
+  reference back() {
+    assert(!empty());
+    return (*this)[size() - 1];
+  }
+  const_reference back() const {
+    assert(!empty());
+    return (*this)[size() - 1];
+  }
+
+  /** Construct an element from @a args at the end and publish it.
+   * @post size() == old size() + 1, and old elements have not moved
+   *
+   * Complexity: O(1) plus, every ChunkSize elements, one allocation.
+   */
+  template <typename... Args>
+  reference emplace_back(Args&&... args) {
+    size_type n = size_.load(std::memory_order_relaxed);
+    if (n % ChunkSize == 0)
+      add_chunk(n / ChunkSize);
+    T* p = dir_[n / ChunkSize] + n % ChunkSize;
+    ::new (static_cast<void*>(p)) T(std::forward<Args>(args)...);
+    size_.store(n + 1, std::memory_order_release);
+    return *p;
+  }
+
+  void push_back(const T& x) {
+    emplace_back(x);
+  }
+  void push_back(T&& x) {
+    emplace_back(std::move(x));
+  }
+
+  /** Destroy every element and release all memory.
+   * @post size() == 0
+   *
+   * Invalidates every reference into the array. Must not run while other
+   * threads read it.
+   */
+  void clear() {
+    size_type n = size_.load(std::memory_order_relaxed);
+    for (size_type i = 0; i < n; ++i)
+      dir_[i / ChunkSize][i % ChunkSize].~T();
+    for (size_type c = 0; c < (n + ChunkSize - 1) / ChunkSize; ++c)
+      std::allocator<T>().deallocate(dir_[c], ChunkSize);
+    directories_.clear();
+    dir_ = nullptr;
+    shared_dir_.store(nullptr, std::memory_order_relaxed);
+    size_.store(0, std::memory_order_relaxed);
+  }
+
+  iterator begin() {
+    return iterator(this, 0);
+  }
+  iterator end() {
+    return iterator(this, size());
+  }
+  const_iterator begin() const {
+    return const_iterator(this, 0);
+  }
+  const_iterator end() const {
+    return const_iterator(this, size());
+  }
+
+ private:
+  // Current directory: dir_[c] is chunk c. shared_dir_ is the same
+  // pointer for readers, published before any element of a new chunk, so
+  // a reader that has seen size() finds its chunk.
+  T** dir_;
+  std::atomic<T**> shared_dir_;
+  std::atomic<size_type> size_;
+  // Every directory allocated so far, the current one last. Replaced ones
+  // stay alive for readers that still hold them.
+  std::vector<std::unique_ptr<T*[]>> directories_;
+
+  /** Allocate chunk @a c, growing the directory first if it is full. */
+  void add_chunk(size_type c) {
+    size_type capacity = directories_.empty() ? 0 : size_type(4) << (directories_.size() - 1);
+    if (c == capacity) {
+      size_type grown = capacity ? 2 * capacity : 4;
+      std::unique_ptr<T*[]> dir(new T*[grown]());
+      for (size_type k = 0; k < c; ++k)
+        dir[k] = dir_[k];
+      directories_.push_back(std::move(dir));
+      dir_ = directories_.back().get();
+    }
+    dir_[c] = std::allocator<T>().allocate(ChunkSize);
+    shared_dir_.store(dir_, std::memory_order_release);
+  }
+};
+
+/** @class ConcurrentAppendArray
+ * @brief Append-only array of T that many threads may append to at once.
+ *
+ * Indices are reserved with one atomic fetch-add, and element i lives in
+ * segment k = floor(log2(i / FirstChunk + 1)), which holds FirstChunk << k
+ * elements. The segment table has a fixed size, so it is never reallocated
+ * and a segment, once installed, stays put: the first appender to reach a
+ * segment allocates it and installs it with a compare-and-swap, and an
+ * appender that loses the race frees its copy and uses the winner's. An
+ * append is thus wait-free: a bounded number of steps, whatever the other
+ * threads do.
+ *
+ * Elements finish construction out of order, so every element has a ready
+ * flag, set with release semantics once it is constructed. size() is the
+ * length of the prefix whose flags are all set: it advances a shared
+ * watermark past the ready elements it finds, so it only grows and costs
+ * O(1) amortized. Any thread may read element i below a size() it has
+ * loaded, through operator[] or load(), and the thread that appended
+ * element i may read it at once.
+ *
+ * Elements themselves are not synchronized, as in SegmentedArray.
+ *
+ * @tparam T           Element type.
+ * @tparam FirstChunk  Elements in segment 0, a power of two.
+ */
+template <typename T, std::size_t FirstChunk = 1024>
+class ConcurrentAppendArray {
+  static_assert(FirstChunk != 0 && (FirstChunk & (FirstChunk - 1)) == 0,
+                "FirstChunk must be a power of two");
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using reference = T&;
+  using const_reference = const T&;
+
+  using iterator = segmented_array_detail::index_iterator<ConcurrentAppendArray, T, false>;
+  using const_iterator = segmented_array_detail::index_iterator<ConcurrentAppendArray, T, true>;
+
+  /** Construct an empty array. No memory is allocated until the first
+   * append. */
+  ConcurrentAppendArray() : reserved_(0), published_(0) {
+    for (std::atomic<T*>& s : segments_)
+      s.store(nullptr, std::memory_order_relaxed);
+  }
+
+  /** Construct an array of @a n value-initialized elements. */
+  explicit ConcurrentAppendArray(size_type n) : ConcurrentAppendArray() {
+    for (size_type i = 0; i < n; ++i)
+      append();
+  }
+
+  ConcurrentAppendArray(const ConcurrentAppendArray& other)
+      : ConcurrentAppendArray() {
+    for (size_type i = 0; i < other.size(); ++i)
+      append(other[i]);
+  }
+
+  ConcurrentAppendArray(ConcurrentAppendArray&& other) noexcept
+      : ConcurrentAppendArray() {
+    swap(other);
+  }
+
+  ConcurrentAppendArray& operator=(ConcurrentAppendArray other) noexcept {
+    swap(other);
+    return *this;
+  }
+
+  ~ConcurrentAppendArray() {
+    clear();
+  }
+
+  /** Swap with @a other. Neither array may be in use by another thread. */
+  void swap(ConcurrentAppendArray& other) noexcept {
+    for (size_type k = 0; k < max_segments; ++k)
+      exchange(segments_[k], other.segments_[k]);
+    exchange(reserved_, other.reserved_);
+    exchange(published_, other.published_);
+  }
+
+  /** Return the number of published elements: every element below it is
+   * constructed.
+   *
+   * Complexity: O(1) amortized. Called while nothing is appended, it is
+   * one acquire load and a comparison.
+   */
+  size_type size() const {
+    size_type w = published_.load(std::memory_order_acquire);
+    size_type r = reserved_.load(std::memory_order_relaxed);
+    size_type v = w;
+    while (v < r && ready(v))
+      ++v;
+    while (w < v && !published_.compare_exchange_weak(
+               w, v, std::memory_order_release, std::memory_order_acquire)) {
+    }
+    return std::max(w, v);
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  /** Return element @a i.
+   * @pre @a i < a value of size() loaded by this thread, or @a i was
+   *      returned by this thread's append()
+   *
+   * Complexity: O(1), a table lookup and one dependent load.
+   */
+  reference operator[](size_type i) {
+    size_type k = segment_of(i);
+    return segments_[k].load(std::memory_order_relaxed)[i - segment_begin(k)];
+  }
+  const_reference operator[](size_type i) const {
+    size_type k = segment_of(i);
+    return segments_[k].load(std::memory_order_relaxed)[i - segment_begin(k)];
+  }
+
+  /** Synonym for operator[], for code shared with SegmentedArray readers. */
+  const_reference load(size_type i) const {
+    return (*this)[i];
+  }
+
+  reference back() {
+    assert(!empty());
+    return (*this)[size() - 1];
+  }
+  const_reference back() const {
+    assert(!empty());
+    return (*this)[size() - 1];
+  }
+
+  /** Construct an element from @a args at a newly reserved index.
+   * @return The element's index
+   * @post The element is published once every element below it is
+   *
+   * May run on any number of threads at once. Complexity: O(1),
+   * wait-free, plus one allocation by the first appender of each segment.
+   */
+  template <typename... Args>
+  size_type append(Args&&... args) {
+    size_type i = reserved_.fetch_add(1, std::memory_order_relaxed);
+    size_type k = segment_of(i);
+    assert(k < max_segments);
+    T* seg = segments_[k].load(std::memory_order_acquire);
+    if (seg == nullptr)
+      seg = install_segment(k);
+    size_type j = i - segment_begin(k);
+    ::new (static_cast<void*>(seg + j)) T(std::forward<Args>(args)...);
+    flags(seg, k)[j].store(1, std::memory_order_release);
+    return i;
+  }
+
+  template <typename... Args>
+  reference emplace_back(Args&&... args) {
+    return (*this)[append(std::forward<Args>(args)...)];
+  }
+  void push_back(const T& x) {
+    append(x);
+  }
+  void push_back(T&& x) {
+    append(std::move(x));
+  }
+
+  /** Destroy every element and release all memory.
+   * @post size() == 0
+   *
+   * Must not run while other threads append or read.
+   */
+  void clear() {
+    size_type n = reserved_.load(std::memory_order_relaxed);
+    for (size_type k = 0; k < max_segments; ++k) {
+      T* seg = segments_[k].load(std::memory_order_relaxed);
+      if (seg == nullptr)
+        continue;
+      size_type b = segment_begin(k);
+      for (size_type j = 0; b + j < n && j < segment_size(k); ++j)
+        seg[j].~T();
+      ::operator delete(static_cast<void*>(seg), std::align_val_t(alignof(T)));
+      segments_[k].store(nullptr, std::memory_order_relaxed);
+    }
+    reserved_.store(0, std::memory_order_relaxed);
+    published_.store(0, std::memory_order_relaxed);
+  }
+
+  iterator begin() {
+    return iterator(this, 0);
+  }
+  iterator end() {
+    return iterator(this, size());
+  }
+  const_iterator begin() const {
+    return const_iterator(this, 0);
+  }
+  const_iterator end() const {
+    return const_iterator(this, size());
+  }
+
+ private:
+  // Enough segments to cover every size_type index
+  static constexpr size_type max_segments = 8 * sizeof(size_type);
+
+  // segments_[k] is segment k, or nullptr until its first append. A segment
+  // is segment_size(k) elements followed by as many ready flags.
+  std::atomic<T*> segments_[max_segments];
+  // Indices handed out so far
+  std::atomic<size_type> reserved_;
+  // Watermark of size(), mutable because size() advances it
+  mutable std::atomic<size_type> published_;
+
+  static size_type segment_of(size_type i) {
+    unsigned long long q = (unsigned long long)(i / FirstChunk) + 1;
+    return size_type(63 - __builtin_clzll(q));
+  }
+  static size_type segment_begin(size_type k) {
+    return FirstChunk * ((size_type(1) << k) - 1);
+  }
+  static size_type segment_size(size_type k) {
+    return FirstChunk << k;
+  }
+
+  static size_type flags_offset(size_type k) {
+    return segment_size(k) * sizeof(T);
+  }
+  static std::atomic<unsigned char>* flags(T* seg, size_type k) {
+    return reinterpret_cast<std::atomic<unsigned char>*>(
+        reinterpret_cast<char*>(seg) + flags_offset(k));
+  }
+
+  /** Return true if element @a i has been constructed. */
+  bool ready(size_type i) const {
+    size_type k = segment_of(i);
+    T* seg = segments_[k].load(std::memory_order_acquire);
+    return seg != nullptr
+        && flags(seg, k)[i - segment_begin(k)].load(std::memory_order_acquire);
+  }
+
+  /** Allocate segment @a k and install it, unless another thread was
+   * faster. Return the installed segment. */
+  T* install_segment(size_type k) {
+    size_type n = segment_size(k);
+    void* raw = ::operator new(flags_offset(k) + n, std::align_val_t(alignof(T)));
+    T* seg = static_cast<T*>(raw);
+    std::atomic<unsigned char>* f = flags(seg, k);
+    for (size_type j = 0; j < n; ++j)
+      ::new (static_cast<void*>(f + j)) std::atomic<unsigned char>(0);
+    T* expected = nullptr;
+    if (segments_[k].compare_exchange_strong(expected, seg,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_acquire))
+      return seg;
+    ::operator delete(raw, std::align_val_t(alignof(T)));
+    return expected;
+  }
+
+  template <typename U>
+  static void exchange(std::atomic<U>& a, std::atomic<U>& b) {
+    U x = a.load(std::memory_order_relaxed);
+    a.store(b.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    b.store(x, std::memory_order_relaxed);
+  }
+};
+
+/** Element storage for Graph internals, chosen by CME212_SEGMENTED_STORAGE
+ * or CME212_RELOCATING_STORAGE (RelocatingVector, relocating_vector.hpp).
+ * Every choice provides size(), operator[], push_back(), emplace_back(),
+ * back(), clear() and random access iterators. */
+template <typename T>
+using graph_storage = std::conditional_t<bool(CME212_SEGMENTED_STORAGE),
+    SegmentedArray<T>,
+    std::conditional_t<bool(CME212_RELOCATING_STORAGE),
+                       RelocatingVector<T>, std::vector<T>>>;
+
+#endif // CME212_SEGMENTED_ARRAY_HPP
@@ -0,0 +1,122 @@
+#ifndef CME212_SLAB_POOL_HPP
+#define CME212_SLAB_POOL_HPP
+
+/** @file slab_pool.hpp
+ * @brief Slab-backed object pool for Graph internals stored by pointer.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+
+/** @class SlabPool
+ * @brief Allocates objects of type T out of a few large slabs.
+ *
+ * Objects are constructed back to back in slabs of @a SlabSize elements, so
+ * consecutively created objects are adjacent in memory. Pointers returned
+ * by create() stay valid until clear() or destruction, since slabs never
+ * move. Individual objects cannot be freed; clear() destroys all of them
+ * and releases the slabs in one pass, which costs one deallocation per slab
+ * instead of one per object.
+ *
+ * @tparam T         Type of the pooled objects.
+ * @tparam SlabSize  Number of objects per slab.
+ */
+template <typename T, std::size_t SlabSize = 4096>
+class SlabPool {
+ public:
+  /** Type of sizes. */
+  using size_type = std::size_t;
+
+  /** Construct an empty pool. No memory is allocated until first create. */
+  SlabPool() : slabs_(), used_(SlabSize), size_(0) {
+  }
+
+  SlabPool(const SlabPool&) = delete;
+  SlabPool& operator=(const SlabPool&) = delete;
+
+  /** Take over the slabs of @a other, leaving it empty. Pointers returned
+   * by other.create() stay valid and now belong to this pool.
+   *
+   * Complexity: O(1).
+   */
+  SlabPool(SlabPool&& other) noexcept : SlabPool() {
+    swap(other);
+  }
+
+  /** Destroy this pool's objects and take over the slabs of @a other.
+   *
+   * Complexity: O(size()) for the objects destroyed.
+   */
+  SlabPool& operator=(SlabPool&& other) noexcept {
+    if (this != &other) {
+      clear();
+      swap(other);
+    }
+    return *this;
+  }
+
+  /** Exchange the slabs, and so the objects, of this pool and @a other.
+   *
+   * Complexity: O(1).
+   */
+  void swap(SlabPool& other) noexcept {
+    slabs_.swap(other.slabs_);
+    std::swap(used_, other.used_);
+    std::swap(size_, other.size_);
+  }
+
+  ~SlabPool() {
+    clear();
+  }
+
+  /** Construct a T from @a args in the pool and return a pointer to it.
+   * @post size() == old size() + 1
+   *
+   * Complexity: O(1) amortized -- one allocation per SlabSize objects.
+   */
+  template <typename... Args>
+  T* create(Args&&... args) {
+    if (used_ == SlabSize) {
+      slabs_.push_back(std::allocator<T>().allocate(SlabSize));
+      used_ = 0;
+    }
+    T* p = slabs_.back() + used_;
+    ::new (static_cast<void*>(p)) T(std::forward<Args>(args)...);
+    ++used_;
+    ++size_;
+    return p;
+  }
+
+  /** Return the number of live objects. */
+  size_type size() const {
+    return size_;
+  }
+
+  /** Destroy every object and free every slab.
+   * @post size() == 0
+   *
+   * Invalidates all pointers returned by create().
+   */
+  void clear() {
+    for (size_type s = 0; s < slabs_.size(); ++s) {
+      size_type n = (s + 1 == slabs_.size()) ? used_ : SlabSize;
+      for (size_type i = 0; i < n; ++i)
+        slabs_[s][i].~T();
+      std::allocator<T>().deallocate(slabs_[s], SlabSize);
+    }
+    slabs_.clear();
+    used_ = SlabSize;
+    size_ = 0;
+  }
+
+ private:
+  std::vector<T*> slabs_;
+  size_type used_;  // objects constructed in the last slab
+  size_type size_;
+};
+
+#endif // CME212_SLAB_POOL_HPP
@@ -0,0 +1,202 @@
+#ifndef CME212_SMALL_VECTOR_HPP
+#define CME212_SMALL_VECTOR_HPP
+
+/** @file small_vector.hpp
+ * @brief A vector with inline storage for its first few elements.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+
+/** @class SmallVector
+ * @brief Contiguous sequence that stores up to @a N elements in place.
+ *
+ * Meant for per-node incidence lists: typical mesh degrees fit in the
+ * inline buffer, so building and walking a node's incidences never touches
+ * the allocator or leaves the node's cache lines. Past @a N elements the
+ * contents move to a heap buffer that grows geometrically, like
+ * std::vector.
+ *
+ * Iterators are plain pointers, so they are random access. They are
+ * invalidated by any operation that changes size(), and by moving the
+ * container.
+ *
+ * @tparam T  Element type.
+ * @tparam N  Number of elements stored inline.
+ */
+template <typename T, std::size_t N>
+class SmallVector {
+  static_assert(N > 0, "SmallVector needs at least one inline slot");
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  /** Construct an empty vector using the inline buffer. */
+  SmallVector() : data_(inline_data()), size_(0), capacity_(N) {
+  }
+
+  SmallVector(const SmallVector& x) : SmallVector() {
+    reserve(x.size_);
+    for (const T& v : x)
+      push_back(v);
+  }
+
+  SmallVector(SmallVector&& x) : SmallVector() {
+    steal(x);
+  }
+
+  SmallVector& operator=(const SmallVector& x) {
+    if (this != &x) {
+      clear();
+      reserve(x.size_);
+      for (const T& v : x)
+        push_back(v);
+    }
+    return *this;
+  }
+
+  SmallVector& operator=(SmallVector&& x) {
+    if (this != &x) {
+      clear();
+      release();
+      steal(x);
+    }
+    return *this;
+  }
+
+  ~SmallVector() {
+    clear();
+    release();
+  }
+
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+
+  size_type size() const { return size_; }
+  size_type capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+
+  T& operator[](size_type i) {
+    assert(i < size_);
+    return data_[i];
+  }
+  const T& operator[](size_type i) const {
+    assert(i < size_);
+    return data_[i];
+  }
+
+  /** Return true while the elements live in the inline buffer. */
+  bool is_inline() const {
+    return data_ == inline_data();
+  }
+
+  /** Append @a v.
+   * @post size() == old size() + 1
+   *
+   * Complexity: O(1) amortized. Allocates only when size() reaches a
+   * capacity of at least N.
+   */
+  void push_back(const T& v) {
+    emplace_back(v);
+  }
+  void push_back(T&& v) {
+    emplace_back(std::move(v));
+  }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    if (size_ == capacity_) {
+      // Build the element before growing, since args may refer into the
+      // buffer that grow() frees.
+      T v(std::forward<Args>(args)...);
+      grow(2 * capacity_);
+      return *::new (static_cast<void*>(data_ + size_++)) T(std::move(v));
+    }
+    T* p = ::new (static_cast<void*>(data_ + size_))
+        T(std::forward<Args>(args)...);
+    ++size_;
+    return *p;
+  }
+
+  /** Remove the last element.
+   * @pre !empty()
+   */
+  void pop_back() {
+    assert(size_ > 0);
+    data_[--size_].~T();
+  }
+
+  /** Make room for @a n elements without reallocating. */
+  void reserve(size_type n) {
+    if (n > capacity_)
+      grow(n);
+  }
+
+  /** Destroy every element. Keeps the current buffer. */
+  void clear() {
+    for (size_type i = 0; i < size_; ++i)
+      data_[i].~T();
+    size_ = 0;
+  }
+
+ private:
+  alignas(T) unsigned char inline_[N * sizeof(T)];
+  T* data_;
+  size_type size_;
+  size_type capacity_;
+
+  T* inline_data() {
+    return reinterpret_cast<T*>(inline_);
+  }
+  const T* inline_data() const {
+    return reinterpret_cast<const T*>(inline_);
+  }
+
+  /** Move the elements into a heap buffer of @a n slots. */
+  void grow(size_type n) {
+    T* fresh = std::allocator<T>().allocate(n);
+    for (size_type i = 0; i < size_; ++i) {
+      ::new (static_cast<void*>(fresh + i)) T(std::move(data_[i]));
+      data_[i].~T();
+    }
+    release();
+    data_ = fresh;
+    capacity_ = n;
+  }
+
+  /** Free the heap buffer, if any. Elements must already be destroyed. */
+  void release() {
+    if (!is_inline())
+      std::allocator<T>().deallocate(data_, capacity_);
+    data_ = inline_data();
+    capacity_ = N;
+  }
+
+  /** Move the contents of @a x into this empty, inline vector and leave
+   * @a x empty. A heap buffer is taken over; inline elements are moved. */
+  void steal(SmallVector& x) {
+    if (!x.is_inline()) {
+      data_ = x.data_;
+      size_ = x.size_;
+      capacity_ = x.capacity_;
+      x.data_ = x.inline_data();
+      x.size_ = 0;
+      x.capacity_ = N;
+    } else {
+      for (T& v : x)
+        emplace_back(std::move(v));
+      x.clear();
+    }
+  }
+};
+
+#endif // CME212_SMALL_VECTOR_HPP
@@ -0,0 +1,156 @@
+#ifndef CME212_SPACE_FILLING_CURVE_HPP
+#define CME212_SPACE_FILLING_CURVE_HPP
+
+/** @file space_filling_curve.hpp
+ * @brief Morton (Z-order) and Hilbert keys for ordering points in space.
+ *
+ * Sorting points by their key on a space-filling curve puts points that are
+ * close in space close in the sorted order. Graph::reorder() uses this to
+ * give mesh neighbors nearby indices, so sweeps over nodes and their
+ * incident edges touch memory in a cache-friendly order.
+ *
+ * Keys are 63-bit: each coordinate is quantized to 21 bits over the
+ * bounding cube of the point set.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "CME212/Point.hpp"
+
+
+namespace sfc {
+
+/** Bits per coordinate in a key. */
+constexpr unsigned bits = 21;
+
+/** Spread the low 21 bits of @a v so that bit k moves to bit 3k. */
+inline std::uint64_t spread_bits(std::uint32_t v) {
+  std::uint64_t x = v & 0x1FFFFF;
+  x = (x | x << 32) & 0x001F00000000FFFFull;
+  x = (x | x << 16) & 0x001F0000FF0000FFull;
+  x = (x | x << 8)  & 0x100F00F00F00F00Full;
+  x = (x | x << 4)  & 0x10C30C30C30C30C3ull;
+  x = (x | x << 2)  & 0x1249249249249249ull;
+  return x;
+}
+
+/** Return the Morton key of the quantized point (@a x, @a y, @a z): the
+ * bits of the three coordinates interleaved, x most significant. */
+inline std::uint64_t morton_key(std::uint32_t x, std::uint32_t y,
+                                std::uint32_t z) {
+  return spread_bits(x) << 2 | spread_bits(y) << 1 | spread_bits(z);
+}
+
+/** Return the position of the quantized point (@a x, @a y, @a z) along the
+ * 3D Hilbert curve of order 21.
+ *
+ * Uses Skilling's transform ("Programming the Hilbert curve", 2004): the
+ * coordinates are turned into the "transposed" Hilbert index in place, whose
+ * bits interleaved like a Morton key give the index. Unlike the Morton
+ * curve, consecutive Hilbert cells are always face neighbors.
+ */
+inline std::uint64_t hilbert_key(std::uint32_t x, std::uint32_t y,
+                                 std::uint32_t z) {
+  std::uint32_t X[3] = {x, y, z};
+  const std::uint32_t top = std::uint32_t(1) << (bits - 1);
+
+  // Inverse undo of the rotations and reflections
+  for (std::uint32_t q = top; q > 1; q >>= 1) {
+    std::uint32_t p = q - 1;
+    for (int i = 0; i < 3; ++i) {
+      if (X[i] & q) {
+        X[0] ^= p;
+      } else {
+        std::uint32_t t = (X[0] ^ X[i]) & p;
+        X[0] ^= t;
+        X[i] ^= t;
+      }
+    }
+  }
+
+  // Gray encode
+  X[1] ^= X[0];
+  X[2] ^= X[1];
+  std::uint32_t t = 0;
+  for (std::uint32_t q = top; q > 1; q >>= 1) {
+    if (X[2] & q)
+      t ^= q - 1;
+  }
+  for (int i = 0; i < 3; ++i)
+    X[i] ^= t;
+
+  return morton_key(X[0], X[1], X[2]);
+}
+
+/** Maps points to 21-bit integer coordinates over a common bounding cube.
+ *
+ * The same scale is used on every axis so that the curve cells stay cubes
+ * and flat (e.g. 2D) meshes still get the full resolution in their plane.
+ */
+class quantizer {
+ public:
+  /** Fit the cube to the @a n points starting at @a p.
+   * @tparam P  Point or another type with coordinates x, y and z */
+  template <typename P>
+  quantizer(const P* p, std::size_t n) : lo_(), scale_(0) {
+    if (n == 0)
+      return;
+    lo_ = Point(p[0].x, p[0].y, p[0].z);
+    Point hi = lo_;
+    for (std::size_t i = 1; i < n; ++i) {
+      lo_.x = std::min(lo_.x, double(p[i].x));
+      lo_.y = std::min(lo_.y, double(p[i].y));
+      lo_.z = std::min(lo_.z, double(p[i].z));
+      hi.x = std::max(hi.x, double(p[i].x));
+      hi.y = std::max(hi.y, double(p[i].y));
+      hi.z = std::max(hi.z, double(p[i].z));
+    }
+    double extent = std::max({hi.x - lo_.x, hi.y - lo_.y, hi.z - lo_.z});
+    if (extent > 0)
+      scale_ = double((std::uint32_t(1) << bits) - 1) / extent;
+  }
+
+  template <typename P>
+  std::uint32_t x(const P& p) const { return cell(p.x - lo_.x); }
+  template <typename P>
+  std::uint32_t y(const P& p) const { return cell(p.y - lo_.y); }
+  template <typename P>
+  std::uint32_t z(const P& p) const { return cell(p.z - lo_.z); }
+
+ private:
+  Point lo_;
+  double scale_;
+
+  std::uint32_t cell(double offset) const {
+    return std::uint32_t(offset * scale_);
+  }
+};
+
+/** Return the indices 0..n-1 of the @a n points at @a p in increasing order
+ * of @a key(x, y, z) over their quantized coordinates. Ties keep their
+ * original order.
+ *
+ * Complexity: O(n log n).
+ */
+template <typename P, typename KeyFn>
+std::vector<std::size_t> curve_order(const P* p, std::size_t n,
+                                     KeyFn key) {
+  quantizer q(p, n);
+  std::vector<std::pair<std::uint64_t, std::size_t>> keyed(n);
+  for (std::size_t i = 0; i < n; ++i)
+    keyed[i] = {key(q.x(p[i]), q.y(p[i]), q.z(p[i])), i};
+  std::sort(keyed.begin(), keyed.end());
+
+  std::vector<std::size_t> order(n);
+  for (std::size_t k = 0; k < n; ++k)
+    order[k] = keyed[k].second;
+  return order;
+}
+
+} // end namespace sfc
+
+#endif // CME212_SPACE_FILLING_CURVE_HPP
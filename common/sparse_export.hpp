@@ -0,0 +1,215 @@
+#ifndef CME212_SPARSE_EXPORT_HPP
+#define CME212_SPARSE_EXPORT_HPP
+
+/** @file sparse_export.hpp
+ * @brief The adjacency as CSR or COO index arrays for external sparse
+ *        solvers and partitioners.
+ *
+ * PETSc, METIS and most other sparse libraries take a graph as a row offset
+ * array and a column array (CSR) or as one row and one column index per
+ * entry (COO). export_csr() and export_coo() write those straight into the
+ * caller's arrays, in the caller's index type, on several threads:
+ *
+ *   sparse_export_options opt;
+ *   opt.base = 1;                             // Fortran style numbering
+ *   std::vector<idx_t> xadj(g.size() + 1);
+ *   std::vector<idx_t> adjncy(sparse_entries(g, opt));
+ *   export_csr(g, xadj.data(), adjncy.data(), adjncy.size(), opt);
+ *
+ * Graphs that keep a packed CSR copy of their adjacency can hand it out
+ * without any copy as a csr_view, e.g. Graph::view_csr() of a frozen graph;
+ * the view's arrays are the graph's own and use its index types.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+
+
+/** Layout of the arrays written by export_csr() and export_coo(). */
+struct sparse_export_options {
+  unsigned base = 0;        // index of the first row and column, 0 or 1
+  bool upper_only = false;  // one entry per edge, in the row of its smaller
+                            // endpoint, instead of one in each endpoint's row
+  unsigned threads = 0;     // 0 for the size of ThreadPool::shared()
+};
+
+
+/** @struct csr_view
+ * @brief Pointers into a graph's own CSR arrays.
+ *
+ * Row i has the entries k in [offsets[i], offsets[i + 1]). Entry k is the
+ * neighbor neighbors[k * stride] across the edge edges[k * stride], which
+ * indexes arrays such as Graph::edge_values_data(). Indices are 0-based and
+ * every edge is in both of its endpoints' rows. weights, if not null, holds
+ * one float per entry, weights[k] the weight of entry k, contiguous. A
+ * default constructed view is not valid(): the graph had no packed CSR
+ * arrays to show.
+ */
+template <typename Offset, typename Index>
+struct csr_view {
+  const Offset* offsets = nullptr;
+  const Index* neighbors = nullptr;
+  const Index* edges = nullptr;
+  const float* weights = nullptr;
+  std::size_t stride = 1;
+  std::size_t num_rows = 0;
+
+  bool valid() const {
+    return offsets != nullptr;
+  }
+  /** Return the number of entries, offsets[num_rows]. */
+  std::size_t nnz() const {
+    return valid() ? std::size_t(offsets[num_rows]) : 0;
+  }
+  Index neighbor(std::size_t k) const {
+    return neighbors[k * stride];
+  }
+  Index edge(std::size_t k) const {
+    return edges[k * stride];
+  }
+};
+
+
+namespace sparse_export_detail {
+
+/** Return the entry offsets of the rows as written with @a opt, 0-based. */
+template <typename G>
+std::vector<std::size_t> entry_offsets(const G& g,
+                                       const sparse_export_options& opt,
+                                       unsigned threads) {
+  if (!opt.upper_only)
+    return csr_snapshot::row_offsets(g, threads);
+  std::size_t n = std::size_t(g.size());
+  std::vector<std::size_t> offsets(n + 1, 0);
+  csr_snapshot::parallel_ranges(threads, n, 1024,
+      [&](unsigned, std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i) {
+          auto u = g.node(typename G::size_type(i));
+          std::size_t d = 0;
+          for (auto it = u.edge_begin(); it != u.edge_end(); ++it)
+            d += std::size_t((*it).node2().index()) > i;
+          offsets[i + 1] = d;
+        }
+      });
+  for (std::size_t i = 0; i < n; ++i)
+    offsets[i + 1] += offsets[i];
+  return offsets;
+}
+
+/** Throw unless @a entries entries fit in @a capacity and every written
+ * index fits in a T. */
+template <typename T>
+void check_fits(const char* who, std::size_t entries, std::size_t capacity,
+                std::size_t largest) {
+  if (entries > capacity)
+    throw std::runtime_error(std::string(who) + ": the arrays hold " +
+                             std::to_string(capacity) + " entries, " +
+                             std::to_string(entries) + " are needed");
+  if (largest > std::size_t(std::numeric_limits<T>::max()))
+    throw std::runtime_error(std::string(who) +
+                             ": the index type is too narrow for the graph");
+}
+
+/** Write the column of every entry of node i's row at cols[offsets[i]..],
+ * and its row at rows[offsets[i]..] if @a rows is not null. */
+template <typename G, typename T>
+void fill(const G& g, const std::vector<std::size_t>& offsets,
+          const sparse_export_options& opt, unsigned threads, T* rows,
+          T* cols) {
+  std::size_t base = opt.base;
+  csr_snapshot::parallel_ranges(threads, std::size_t(g.size()), 1024,
+      [&](unsigned, std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i) {
+          auto u = g.node(typename G::size_type(i));
+          std::size_t k = offsets[i];
+          for (auto it = u.edge_begin(); it != u.edge_end(); ++it) {
+            std::size_t j = std::size_t((*it).node2().index());
+            if (opt.upper_only && j <= i)
+              continue;
+            if (rows != nullptr)
+              rows[k] = T(i + base);
+            cols[k++] = T(j + base);
+          }
+          assert(k == offsets[i + 1]);
+        }
+      });
+}
+
+} // end namespace sparse_export_detail
+
+
+/** Return the number of entries export_csr() and export_coo() write for
+ * @a g with @a opt: twice the live edges, or once with opt.upper_only.
+ *
+ * Complexity: O(num_nodes()) given degrees(), else one pass over the
+ * incidences.
+ */
+template <typename G>
+std::size_t sparse_entries(const G& g, const sparse_export_options& opt = {}) {
+  unsigned threads = csr_snapshot::thread_count(opt.threads);
+  return sparse_export_detail::entry_offsets(g, opt, threads).back();
+}
+
+/** Write the adjacency of @a g as CSR: row i has the columns
+ * cols[offsets[i] - base .. offsets[i + 1] - base), its neighbors' indices
+ * plus opt.base, in incident iterator order.
+ * @param[out] offsets  g.size() + 1 entries
+ * @param[out] cols     @a capacity entries, at least sparse_entries(g, opt)
+ * @return The number of entries written to @a cols
+ * @throws std::runtime_error if @a cols is too small or T cannot hold the
+ *         largest index or offset. Nothing is written then.
+ *
+ * Complexity: Two passes over the incidences, split over opt.threads
+ * threads.
+ */
+template <typename G, typename T>
+std::size_t export_csr(const G& g, T* offsets, T* cols, std::size_t capacity,
+                       const sparse_export_options& opt = {}) {
+  unsigned threads = csr_snapshot::thread_count(opt.threads);
+  std::vector<std::size_t> off =
+      sparse_export_detail::entry_offsets(g, opt, threads);
+  std::size_t n = std::size_t(g.size());
+  std::size_t nnz = off[n];
+  sparse_export_detail::check_fits<T>("export_csr", nnz, capacity,
+      std::max(nnz, n) + opt.base);
+  for (std::size_t i = 0; i <= n; ++i)
+    offsets[i] = T(off[i] + opt.base);
+  sparse_export_detail::fill(g, off, opt, threads, static_cast<T*>(nullptr),
+                             cols);
+  return nnz;
+}
+
+/** Write the adjacency of @a g as COO: entry k is the pair (rows[k],
+ * cols[k]), indices plus opt.base, sorted by row and in incident iterator
+ * order within a row.
+ * @param[out] rows, cols  @a capacity entries each, at least
+ *                         sparse_entries(g, opt)
+ * @return The number of entries written
+ * @throws std::runtime_error if the arrays are too small or T cannot hold
+ *         the largest index. Nothing is written then.
+ *
+ * Complexity: Two passes over the incidences, split over opt.threads
+ * threads.
+ */
+template <typename G, typename T>
+std::size_t export_coo(const G& g, T* rows, T* cols, std::size_t capacity,
+                       const sparse_export_options& opt = {}) {
+  unsigned threads = csr_snapshot::thread_count(opt.threads);
+  std::vector<std::size_t> off =
+      sparse_export_detail::entry_offsets(g, opt, threads);
+  std::size_t n = std::size_t(g.size());
+  std::size_t nnz = off[n];
+  sparse_export_detail::check_fits<T>("export_coo", nnz, capacity,
+      n + opt.base);
+  sparse_export_detail::fill(g, off, opt, threads, rows, cols);
+  return nnz;
+}
+
+#endif // CME212_SPARSE_EXPORT_HPP
@@ -0,0 +1,343 @@
+#ifndef CME212_SPATIAL_INDEX_HPP
+#define CME212_SPATIAL_INDEX_HPP
+
+/** @file spatial_index.hpp
+ * @brief Uniform grid over node positions for box, radius and nearest
+ *        neighbor queries.
+ *
+ * Works with any Graph variant that has size() and node(i).position(), so
+ * range queries for collision constraints no longer scan every node.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "CME212/Point.hpp"
+
+
+/** @class SpatialIndex
+ * @brief Buckets the nodes of a graph into a uniform grid of cubic cells.
+ *
+ * The cell size is chosen so that a cell holds about @a points_per_cell
+ * nodes on average, and the cells are stored in compressed sparse row
+ * form: one offset per cell into a single array of node indices. A query
+ * only looks at the cells its region overlaps, so a box or radius query
+ * costs O(cells overlapped + nodes reported) and nearest(p, k) about
+ * O(k) for evenly spread nodes.
+ *
+ * The index keeps its own copy of the positions, taken at construction
+ * and refreshed by update(). Moving or adding nodes in the graph does not
+ * change query results until update() is called for them. A node that
+ * leaves its cell, and a node added after the build, is kept on a short
+ * overflow list that every query scans. Once that list grows past an
+ * eighth of the nodes the grid is rebuilt, so updates cost O(1) amortized.
+ *
+ * Nodes outside the grid's bounding box belong to the nearest border
+ * cell, so the results are exact wherever the nodes move.
+ *
+ * @tparam G  Graph type. Only size(), node(i).position() and size_type are
+ *            used.
+ */
+template <typename G>
+class SpatialIndex {
+ public:
+  /** Type of node indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Build the index over every node of @a g.
+   * @param[in] points_per_cell  Average number of nodes per grid cell
+   *
+   * The index refers to @a g, which must outlive it.
+   *
+   * Complexity: O(g.size()).
+   */
+  explicit SpatialIndex(const G& g, double points_per_cell = 2.0)
+      : g_(&g), points_per_cell_(points_per_cell) {
+    assert(points_per_cell > 0);
+    rebuild();
+  }
+
+  /** Return the number of indexed nodes. */
+  size_type size() const {
+    return size_type(pos_.size());
+  }
+
+  /** Re-read every position from the graph and rebuild the grid.
+   *
+   * Complexity: O(g.size()).
+   */
+  void rebuild() {
+    size_type n = g_->size();
+    pos_.resize(n);
+    for (size_type i = 0; i < n; ++i)
+      pos_[i] = g_->node(i).position();
+    build_grid();
+  }
+
+  /** Re-read the position of node @a i, or index it if it is new.
+   * @pre @a i < g.size()
+   * @post Queries see node @a i at its current position
+   *
+   * Nodes added to the graph are indexed by calling update() for each of
+   * them; a new index beyond size() also indexes every node before it.
+   *
+   * Complexity: O(1) amortized.
+   */
+  void update(size_type i) {
+    assert(i < g_->size());
+    while (size() <= i) {
+      size_type j = size();
+      pos_.push_back(g_->node(j).position());
+      home_.push_back(no_cell);
+      overflow_.push_back(j);
+    }
+    pos_[i] = g_->node(i).position();
+    if (home_[i] != no_cell && home_[i] != cell_of(pos_[i])) {
+      home_[i] = no_cell;
+      overflow_.push_back(i);
+    }
+    if (overflow_.size() > std::max<std::size_t>(64, pos_.size() / 8))
+      build_grid();
+  }
+
+  /** Return the nodes whose position lies in the closed box spanned by
+   * @a box.min() and @a box.max(), in no particular order.
+   *
+   * @tparam Box  A box type with min() and max() returning Points, such as
+   *              CME212's BoundingBox.
+   */
+  template <typename Box>
+  std::vector<size_type> nodes_in_box(const Box& box) const {
+    return nodes_in_box(box.min(), box.max());
+  }
+
+  /** Return the nodes whose position p has @a lo <= p <= @a hi in every
+   * coordinate, in no particular order.
+   *
+   * Complexity: O(cells overlapped + overflow nodes + result size).
+   */
+  std::vector<size_type> nodes_in_box(const Point& lo, const Point& hi) const {
+    std::vector<size_type> out;
+    auto inside = [&](const Point& p) {
+      return lo.x <= p.x && p.x <= hi.x && lo.y <= p.y && p.y <= hi.y &&
+             lo.z <= p.z && p.z <= hi.z;
+    };
+    visit_box(lo, hi, [&](size_type i) {
+      if (inside(pos_[i]))
+        out.push_back(i);
+    });
+    return out;
+  }
+
+  /** Return the nodes within distance @a r of @a c, in no particular order.
+   *
+   * Complexity: O(cells overlapped + overflow nodes + result size).
+   */
+  std::vector<size_type> nodes_within(const Point& c, double r) const {
+    std::vector<size_type> out;
+    double r2 = r * r;
+    visit_box(c - Point(r), c + Point(r), [&](size_type i) {
+      if (normSq(pos_[i] - c) <= r2)
+        out.push_back(i);
+    });
+    return out;
+  }
+
+  /** Return the @a k nodes closest to @a p, closest first.
+   * @return min(k, size()) node indices. Ties are broken by index.
+   *
+   * Searches rings of cells of growing radius around @a p and stops once
+   * no unvisited cell can hold a closer node than the k-th best so far.
+   *
+   * Complexity: about O(k + overflow nodes) for evenly spread nodes.
+   */
+  std::vector<size_type> nearest(const Point& p, size_type k) const {
+    k = std::min(k, size());
+    if (k == 0)
+      return {};
+
+    // Max-heap of the best k (squared distance, index) pairs so far
+    std::priority_queue<std::pair<double, size_type>> best;
+    auto offer = [&](size_type i) {
+      std::pair<double, size_type> cand(normSq(pos_[i] - p), i);
+      if (best.size() < k) {
+        best.push(cand);
+      } else if (cand < best.top()) {
+        best.pop();
+        best.push(cand);
+      }
+    };
+    for (size_type i : overflow_)
+      offer(i);
+
+    long c0[3];
+    for (int a = 0; a < 3; ++a)
+      c0[a] = axis_cell(p, a);
+    for (long r = 0; ; ++r) {
+      // Visit the cells at Chebyshev distance exactly r from c0
+      long lo[3], hi[3];
+      for (int a = 0; a < 3; ++a) {
+        lo[a] = std::max(0L, c0[a] - r);
+        hi[a] = std::min(dims_[a] - 1, c0[a] + r);
+      }
+      for (long z = lo[2]; z <= hi[2]; ++z) {
+        for (long y = lo[1]; y <= hi[1]; ++y) {
+          bool shell_yz = std::abs(z - c0[2]) == r || std::abs(y - c0[1]) == r;
+          for (long x = lo[0]; x <= hi[0]; ++x) {
+            if (!shell_yz && std::abs(x - c0[0]) != r)
+              x = (c0[0] + r <= hi[0]) ? c0[0] + r : hi[0] + 1;
+            if (x > hi[0])
+              break;
+            visit_cell(cell_at(x, y, z), offer);
+          }
+        }
+      }
+
+      // Distance from p to the nearest face of the visited block that
+      // still has unvisited cells beyond it
+      double reach = std::numeric_limits<double>::infinity();
+      for (int a = 0; a < 3; ++a) {
+        if (c0[a] - r > 0)
+          reach = std::min(reach, p[a] - (lo_[a] + double(c0[a] - r) * h_));
+        if (c0[a] + r < dims_[a] - 1)
+          reach = std::min(reach, lo_[a] + double(c0[a] + r + 1) * h_ - p[a]);
+      }
+      if (reach == std::numeric_limits<double>::infinity())
+        break;
+      if (best.size() == k && reach >= 0 && best.top().first <= reach * reach)
+        break;
+    }
+
+    std::vector<size_type> out(best.size());
+    for (std::size_t j = out.size(); j-- > 0; best.pop())
+      out[j] = best.top().second;
+    return out;
+  }
+
+ private:
+  // Marks a node that is not filed under any cell of the grid
+  static constexpr std::size_t no_cell = std::size_t(-1);
+
+  const G* g_;
+  double points_per_cell_;
+  std::vector<Point> pos_;             // positions as of the last update
+  Point lo_;                           // corner of cell (0, 0, 0)
+  double h_ = 1;                       // cell edge length
+  long dims_[3] = {1, 1, 1};           // cells per axis
+  std::vector<std::size_t> cell_start_;  // CSR offsets, one per cell + 1
+  std::vector<size_type> cell_nodes_;  // node indices grouped by cell
+  std::vector<std::size_t> home_;      // cell node i is filed under
+  std::vector<size_type> overflow_;    // nodes not filed in cell_nodes_
+
+  /** Size the grid to the current positions and file every node. */
+  void build_grid() {
+    std::size_t n = pos_.size();
+    Point hi;
+    lo_ = Point();
+    if (n != 0) {
+      lo_ = hi = pos_[0];
+      for (const Point& p : pos_) {
+        for (int a = 0; a < 3; ++a) {
+          lo_[a] = std::min(lo_[a], p[a]);
+          hi[a] = std::max(hi[a], p[a]);
+        }
+      }
+    }
+
+    // One cell edge for every axis; flat axes get a single layer of cells
+    double extent = std::max({hi.x - lo_.x, hi.y - lo_.y, hi.z - lo_.z});
+    double volume = 1;
+    int active = 0;
+    for (int a = 0; a < 3; ++a) {
+      if (hi[a] - lo_[a] > 1e-9 * extent) {
+        volume *= hi[a] - lo_[a];
+        ++active;
+      }
+    }
+    h_ = 1;
+    if (active != 0 && n != 0)
+      h_ = std::pow(volume * points_per_cell_ / double(n), 1.0 / active);
+    // Nearly flat axes can make h_ tiny; coarsen until the grid has at
+    // most a few cells per node
+    std::size_t cells;
+    do {
+      cells = 1;
+      for (int a = 0; a < 3; ++a) {
+        double span = std::min((hi[a] - lo_[a]) / h_, double(1 << 20));
+        dims_[a] = long(span) + 1;
+        cells *= std::size_t(dims_[a]);
+      }
+      if (cells > 4 * n + 8)
+        h_ *= 2;
+    } while (cells > 4 * n + 8);
+
+    // Counting sort of the nodes by cell
+    home_.resize(n);
+    cell_start_.assign(cells + 1, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+      home_[i] = cell_of(pos_[i]);
+      ++cell_start_[home_[i] + 1];
+    }
+    for (std::size_t c = 0; c < cells; ++c)
+      cell_start_[c + 1] += cell_start_[c];
+    cell_nodes_.resize(n);
+    std::vector<std::size_t> fill(cell_start_.begin(), cell_start_.end() - 1);
+    for (std::size_t i = 0; i < n; ++i)
+      cell_nodes_[fill[home_[i]]++] = size_type(i);
+    overflow_.clear();
+  }
+
+  /** Return the cell coordinate of @a p along axis @a a, clamped to the
+   * grid. */
+  long axis_cell(const Point& p, int a) const {
+    double t = std::floor((p[a] - lo_[a]) / h_);
+    if (!(t > 0))
+      return 0;
+    return long(std::min(t, double(dims_[a] - 1)));
+  }
+
+  std::size_t cell_at(long x, long y, long z) const {
+    return std::size_t((z * dims_[1] + y) * dims_[0] + x);
+  }
+
+  std::size_t cell_of(const Point& p) const {
+    return cell_at(axis_cell(p, 0), axis_cell(p, 1), axis_cell(p, 2));
+  }
+
+  /** Call @a f on every node still filed under cell @a c. */
+  template <typename F>
+  void visit_cell(std::size_t c, F& f) const {
+    for (std::size_t k = cell_start_[c]; k < cell_start_[c + 1]; ++k) {
+      size_type i = cell_nodes_[k];
+      if (home_[i] == c)
+        f(i);
+    }
+  }
+
+  /** Call @a f on every node that may lie in the box [@a lo, @a hi]: those
+   * filed under the overlapped cells and those on the overflow list. */
+  template <typename F>
+  void visit_box(const Point& lo, const Point& hi, F f) const {
+    if (lo.x > hi.x || lo.y > hi.y || lo.z > hi.z)
+      return;
+    for (size_type i : overflow_)
+      f(i);
+    long a[3], b[3];
+    for (int d = 0; d < 3; ++d) {
+      a[d] = axis_cell(lo, d);
+      b[d] = axis_cell(hi, d);
+    }
+    for (long z = a[2]; z <= b[2]; ++z)
+      for (long y = a[1]; y <= b[1]; ++y)
+        for (long x = a[0]; x <= b[0]; ++x)
+          visit_cell(cell_at(x, y, z), f);
+  }
+};
+
+#endif // CME212_SPATIAL_INDEX_HPP
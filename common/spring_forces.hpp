@@ -0,0 +1,310 @@
+#ifndef CME212_SPRING_FORCES_HPP
+#define CME212_SPRING_FORCES_HPP
+
+/** @file spring_forces.hpp
+ * @brief Vectorized mass-spring force kernel over flat edge arrays.
+ *
+ * The CME212 mass-spring step sums, for every node, the Hooke force of the
+ * springs on its incident edges. Written against the proxies, that is a
+ * position() call and a norm per incidence, and every spring is evaluated
+ * twice. SpringKernel evaluates each spring once in an edge pass and then
+ * gathers the per-edge forces into the nodes in a node pass:
+ *
+ *   edge pass  f[e] = K (|d| - L_e) d / |d|,  d = x[dst] - x[src]
+ *              over flat endpoint arrays, 4 (AVX2) or 8 (AVX-512) edges at
+ *              a time with gathered loads, and a scalar loop otherwise.
+ *   node pass  F[i] = sum of +f[e] over edges with src i and -f[e] over
+ *              edges with dst i, from a CSR incidence list.
+ *
+ * The node pass writes each node's force from one thread only, so both
+ * passes run in parallel without atomics or an edge coloring.
+ *
+ * The SIMD path is picked at compile time from __AVX512F__ / __AVX2__, so
+ * build with -mavx2, -mavx512f or -march=native to get it.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "common/csr_snapshot.hpp"
+#include "common/graph_traits.hpp"
+#include "CME212/Point.hpp"
+
+
+namespace spring_detail {
+
+/** Return true if Points are three packed doubles, which the gathered
+ * loads of the SIMD paths rely on. */
+constexpr bool packed_points() {
+  return sizeof(Point) == 3 * sizeof(double) &&
+         std::is_standard_layout<Point>::value;
+}
+
+} // end namespace spring_detail
+
+
+/** @class SpringKernel
+ * @brief Topology of a graph laid out for repeated spring force sweeps.
+ *
+ * Build it once; the edges must not change afterwards, but positions may,
+ * so compute() is called every time step.
+ *
+ * Springs are numbered in node order: those of node 0 to its higher
+ * numbered neighbors in incident iterator order, then those of node 1, and
+ * so on, each edge once. source() and target() name their endpoints.
+ *
+ * @tparam G  Graph type with size(), node(i).edge_begin()/edge_end()
+ *            and node(i).position(). Graphs with positions_data()
+ *            (hw1/Graph-24726.hpp) are read in place; others have their
+ *            positions gathered once per call.
+ */
+template <typename G>
+class SpringKernel {
+ public:
+  /** Type of node indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Record the endpoints of every edge of @a g, read from its incident
+   * iterators, which every Graph variant has.
+   * @param[in] threads  Threads for compute(); 0 means all cores
+   *
+   * Complexity: O(g.size() + g.num_edges()).
+   */
+  explicit SpringKernel(const G& g, unsigned threads = 0)
+      : threads_(csr_snapshot::thread_count(threads)), n_(g.size()),
+        m_(0), offsets_(n_ + 1, 0) {
+    src_.reserve(g.num_edges());
+    dst_.reserve(g.num_edges());
+    for (std::size_t i = 0; i < n_; ++i) {
+      auto node = g.node(size_type(i));
+      for (auto it = node.edge_begin(); it != node.edge_end(); ++it) {
+        std::size_t j = std::size_t((*it).node2().index());
+        if (i < j) {
+          src_.push_back(std::int64_t(i));
+          dst_.push_back(std::int64_t(j));
+          ++offsets_[i + 1];
+          ++offsets_[j + 1];
+        }
+      }
+    }
+    m_ = src_.size();
+    incidences_.resize(2 * m_);
+    fx_.resize(m_);
+    fy_.resize(m_);
+    fz_.resize(m_);
+    for (std::size_t i = 0; i < n_; ++i)
+      offsets_[i + 1] += offsets_[i];
+    std::vector<std::size_t> fill(offsets_.begin(), offsets_.end() - 1);
+    for (std::size_t e = 0; e < m_; ++e) {
+      incidences_[fill[src_[e]]++] = e << 1;
+      incidences_[fill[dst_[e]]++] = e << 1 | 1;
+    }
+  }
+
+  /** Return the number of springs. */
+  std::size_t num_springs() const {
+    return m_;
+  }
+
+  /** Return the endpoints of spring @a k, source(k) < target(k).
+   * @pre @a k < num_springs() */
+  size_type source(std::size_t k) const {
+    return size_type(src_[k]);
+  }
+  size_type target(std::size_t k) const {
+    return size_type(dst_[k]);
+  }
+
+  /** Write the spring force on every node of @a g into @a force.
+   * @param[in]  K      Spring constant
+   * @param[in]  L      Rest length of every spring
+   * @param[out] force  Array of g.size() Points
+   *
+   * @pre @a g has the edges this kernel was built from
+   * @post force[i] == sum over edges (i, j) of
+   *       K (|x_j - x_i| - L) (x_j - x_i) / |x_j - x_i|,
+   *       where zero-length springs contribute nothing
+   *
+   * Complexity: O(g.size() + g.num_edges()), spread over the threads.
+   */
+  void compute(const G& g, double K, double L, Point* force) const {
+    run(g, K, nullptr, L, force, false);
+  }
+
+  /** As compute(g, K, L, force), with spring k at rest length
+   * @a rest[k], in the numbering of source() and target(). */
+  void compute(const G& g, double K, const double* rest, Point* force) const {
+    run(g, K, rest, 0, force, false);
+  }
+
+  /** As compute(), but add the spring forces to @a force instead of
+   * overwriting it, so they combine with other forces without another
+   * pass over the nodes (see symplectic.hpp). */
+  void accumulate(const G& g, double K, double L, Point* force) const {
+    run(g, K, nullptr, L, force, true);
+  }
+  void accumulate(const G& g, double K, const double* rest,
+                  Point* force) const {
+    run(g, K, rest, 0, force, true);
+  }
+
+ private:
+  unsigned threads_;
+  std::size_t n_;
+  std::size_t m_;
+  // Edge endpoints, as 64-bit ints so they can feed gathers directly
+  std::vector<std::int64_t> src_;
+  std::vector<std::int64_t> dst_;
+  // Row i of incidences_ spans offsets_[i] .. offsets_[i + 1]; an entry is
+  // e << 1, plus 1 when node i is the dst of edge e
+  std::vector<std::size_t> offsets_;
+  std::vector<std::size_t> incidences_;
+  // Per-edge force on the src endpoint, one array per component. Scratch
+  // space for compute(), hence mutable.
+  mutable std::vector<double> fx_, fy_, fz_;
+  mutable std::vector<Point> gathered_;
+
+  void run(const G& g, double K, const double* rest, double L,
+           Point* force, bool add) const {
+    assert(std::size_t(g.size()) == n_ && std::size_t(g.num_edges()) == m_);
+    const Point* x = positions(g);
+    csr_snapshot::parallel_ranges(threads_, m_, 64,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          edge_pass(x, K, rest, L, b, e);
+        });
+    csr_snapshot::parallel_ranges(threads_, n_, 256,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          node_pass(b, e, force, add);
+        });
+  }
+
+  const Point* positions(const G& g) const {
+    if constexpr (graph_traits::has_soa_positions<G>::value) {
+      return g.positions_data();
+    } else {
+      gathered_.resize(n_);
+      for (std::size_t i = 0; i < n_; ++i)
+        gathered_[i] = g.node(size_type(i)).position();
+      return gathered_.data();
+    }
+  }
+
+  /** Evaluate springs [first, last) into fx_, fy_, fz_. */
+  void edge_pass(const Point* x, double K, const double* rest, double L,
+                 std::size_t first, std::size_t last) const {
+    std::size_t e = first;
+#if defined(__AVX512F__)
+    if constexpr (spring_detail::packed_points()) {
+      const double* base = reinterpret_cast<const double*>(x);
+      const __m512d k = _mm512_set1_pd(K);
+      for (; e + 8 <= last; e += 8) {
+        __m512i a = _mm512_loadu_si512(src_.data() + e);
+        __m512i b = _mm512_loadu_si512(dst_.data() + e);
+        // 3 * index, as x + (x << 1)
+        __m512i ia = _mm512_add_epi64(a, _mm512_slli_epi64(a, 1));
+        __m512i ib = _mm512_add_epi64(b, _mm512_slli_epi64(b, 1));
+        __m512d dx = _mm512_sub_pd(_mm512_i64gather_pd(ib, base, 8),
+                                   _mm512_i64gather_pd(ia, base, 8));
+        __m512d dy = _mm512_sub_pd(_mm512_i64gather_pd(ib, base + 1, 8),
+                                   _mm512_i64gather_pd(ia, base + 1, 8));
+        __m512d dz = _mm512_sub_pd(_mm512_i64gather_pd(ib, base + 2, 8),
+                                   _mm512_i64gather_pd(ia, base + 2, 8));
+        __m512d len = _mm512_sqrt_pd(_mm512_fmadd_pd(dx, dx,
+            _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dz, dz))));
+        __m512d r = rest ? _mm512_loadu_pd(rest + e) : _mm512_set1_pd(L);
+        // s = K (len - r) / len, and 0 for zero-length springs
+        __mmask8 nonzero = _mm512_cmp_pd_mask(len, _mm512_setzero_pd(), _CMP_GT_OQ);
+        __m512d s = _mm512_maskz_div_pd(nonzero,
+            _mm512_mul_pd(k, _mm512_sub_pd(len, r)), len);
+        _mm512_storeu_pd(fx_.data() + e, _mm512_mul_pd(s, dx));
+        _mm512_storeu_pd(fy_.data() + e, _mm512_mul_pd(s, dy));
+        _mm512_storeu_pd(fz_.data() + e, _mm512_mul_pd(s, dz));
+      }
+    }
+#elif defined(__AVX2__)
+    if constexpr (spring_detail::packed_points()) {
+      const double* base = reinterpret_cast<const double*>(x);
+      const __m256d k = _mm256_set1_pd(K);
+      const __m256d zero = _mm256_setzero_pd();
+      for (; e + 4 <= last; e += 4) {
+        __m256i a = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src_.data() + e));
+        __m256i b = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(dst_.data() + e));
+        // 3 * index, as x + (x << 1)
+        __m256i ia = _mm256_add_epi64(a, _mm256_slli_epi64(a, 1));
+        __m256i ib = _mm256_add_epi64(b, _mm256_slli_epi64(b, 1));
+        __m256d dx = _mm256_sub_pd(_mm256_i64gather_pd(base, ib, 8),
+                                   _mm256_i64gather_pd(base, ia, 8));
+        __m256d dy = _mm256_sub_pd(_mm256_i64gather_pd(base + 1, ib, 8),
+                                   _mm256_i64gather_pd(base + 1, ia, 8));
+        __m256d dz = _mm256_sub_pd(_mm256_i64gather_pd(base + 2, ib, 8),
+                                   _mm256_i64gather_pd(base + 2, ia, 8));
+        __m256d len2 = _mm256_add_pd(_mm256_mul_pd(dx, dx),
+            _mm256_add_pd(_mm256_mul_pd(dy, dy), _mm256_mul_pd(dz, dz)));
+        __m256d len = _mm256_sqrt_pd(len2);
+        __m256d r = rest ? _mm256_loadu_pd(rest + e) : _mm256_set1_pd(L);
+        // s = K (len - r) / len, and 0 for zero-length springs
+        __m256d s = _mm256_div_pd(_mm256_mul_pd(k, _mm256_sub_pd(len, r)), len);
+        s = _mm256_and_pd(s, _mm256_cmp_pd(len, zero, _CMP_GT_OQ));
+        _mm256_storeu_pd(fx_.data() + e, _mm256_mul_pd(s, dx));
+        _mm256_storeu_pd(fy_.data() + e, _mm256_mul_pd(s, dy));
+        _mm256_storeu_pd(fz_.data() + e, _mm256_mul_pd(s, dz));
+      }
+    }
+#endif
+    for (; e < last; ++e) {
+      Point d = x[dst_[e]] - x[src_[e]];
+      double len = norm(d);
+      double r = rest ? rest[e] : L;
+      double s = (len > 0) ? K * (len - r) / len : 0;
+      fx_[e] = s * d.x;
+      fy_[e] = s * d.y;
+      fz_[e] = s * d.z;
+    }
+  }
+
+  /** Sum the edge forces of nodes [first, last) into @a force, or onto it
+   * if @a add. */
+  void node_pass(std::size_t first, std::size_t last, Point* force,
+                 bool add) const {
+    for (std::size_t i = first; i < last; ++i) {
+      double sx = 0, sy = 0, sz = 0;
+      for (std::size_t k = offsets_[i]; k < offsets_[i + 1]; ++k) {
+        std::size_t e = incidences_[k] >> 1;
+        double sign = (incidences_[k] & 1) ? -1.0 : 1.0;
+        sx += sign * fx_[e];
+        sy += sign * fy_[e];
+        sz += sign * fz_[e];
+      }
+      if (add)
+        force[i] += Point(sx, sy, sz);
+      else
+        force[i] = Point(sx, sy, sz);
+    }
+  }
+};
+
+/** Return the spring force on every node of @a g for spring constant @a K
+ * and rest length @a L, as SpringKernel::compute() defines it.
+ *
+ * Builds a SpringKernel for the one call; keep a kernel around when the
+ * forces are needed every time step.
+ */
+template <typename G>
+std::vector<Point> compute_spring_forces(const G& g, double K, double L) {
+  std::vector<Point> force(g.size());
+  SpringKernel<G>(g).compute(g, K, L, force.data());
+  return force;
+}
+
+#endif // CME212_SPRING_FORCES_HPP
@@ -0,0 +1,180 @@
+#ifndef CME212_STABLE_HANDLE_HPP
+#define CME212_STABLE_HANDLE_HPP
+
+/** @file stable_handle.hpp
+ * @brief Node and edge handles that detect, in O(1), that the element
+ *        they named has been removed or moved.
+ *
+ * A Node or Edge proxy is a graph pointer and an index. Once the graph
+ * removes, compacts or renumbers its elements, an old proxy silently names
+ * whatever now sits at its index. Looking elements up by a permanent id
+ * through a std::map stays correct but costs a tree walk per access.
+ *
+ * A StableHandle instead packs the index together with the generation of
+ * its slot into one 64-bit word. The graph keeps a GenerationTable beside
+ * its node and edge arrays and retires a slot, bumping its generation,
+ * whenever the element in it goes away or is replaced by another. A
+ * handle is valid while the generation it carries is its slot's current
+ * one, which is one array load to check:
+ *
+ *   auto h = g.stable_handle(n);
+ *   ...                                 // removals, compact(), reorder()
+ *   if (g.is_valid(h))
+ *     use(g.node(h));
+ *
+ * A handle does not follow its element when the element moves; it only
+ * reports that it can no longer reach it. Callers that must follow moves
+ * pass a NodeMoved or EdgeMoved callback to the removing call.
+ */
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/** @class StableHandle
+ * @brief An index and its slot's generation, in one word.
+ *
+ * @tparam Tag  Type of the element named, so that node and edge handles
+ *              do not convert into each other.
+ *
+ * The index takes the low 32 bits and the generation the high 32 bits, so
+ * handles can name the first 2^32 - 1 elements of a graph. A generation
+ * wraps after 2^32 retirements of one slot, after which a handle that old
+ * would be taken for valid again.
+ */
+template <typename Tag>
+class StableHandle {
+ public:
+  using generation_type = std::uint32_t;
+
+  /** Construct an invalid handle, which no graph accepts. */
+  StableHandle() : bits_(~std::uint64_t(0)) {
+  }
+
+  /** Construct the handle of slot @a index in generation @a generation.
+   * @pre @a index < 2^32 - 1 */
+  StableHandle(std::size_t index, generation_type generation)
+      : bits_((std::uint64_t(generation) << 32) | std::uint64_t(index)) {
+    assert(index < std::size_t(0xFFFFFFFFu));
+  }
+
+  /** Return the index of the named element when the handle was made. */
+  std::size_t index() const {
+    return std::size_t(bits_ & 0xFFFFFFFFu);
+  }
+
+  /** Return the generation of the slot when the handle was made. */
+  generation_type generation() const {
+    return generation_type(bits_ >> 32);
+  }
+
+  /** Return the packed word, e.g. to store handles in an array of
+   * integers. */
+  std::uint64_t bits() const {
+    return bits_;
+  }
+
+  bool operator==(const StableHandle& h) const {
+    return bits_ == h.bits_;
+  }
+  bool operator!=(const StableHandle& h) const {
+    return bits_ != h.bits_;
+  }
+  /** Order handles by generation, then index: any fixed order will do for
+   * sorting and searching. */
+  bool operator<(const StableHandle& h) const {
+    return bits_ < h.bits_;
+  }
+
+ private:
+  std::uint64_t bits_;
+};
+
+
+/** @class GenerationTable
+ * @brief Per-slot generation counters of a node or edge array.
+ *
+ * @tparam Index  Index type of the array.
+ *
+ * Every slot starts in generation 0. The table stays empty until the first
+ * retirement and only grows to cover the highest slot ever retired, so a
+ * graph that never removes or renumbers anything pays nothing for it.
+ * Slots past its end are in generation 0.
+ *
+ * Its updates mirror those of a PropertyRegistry (property_map.hpp) and
+ * sit beside them in the graph: swap_remove() and gather() take the same
+ * arguments, plus the array size before the change.
+ */
+template <typename Index>
+class GenerationTable {
+ public:
+  using generation_type = std::uint32_t;
+
+  /** Return the current generation of slot @a i. Complexity: O(1). */
+  generation_type generation(std::size_t i) const {
+    return i < gen_.size() ? gen_[i] : generation_type(0);
+  }
+
+  /** Return true if @a h was made for the element now in its slot. */
+  template <typename Tag>
+  bool current(const StableHandle<Tag>& h) const {
+    return generation(h.index()) == h.generation();
+  }
+
+  /** End the generation of slot @a i: its element is gone or replaced. */
+  void retire(std::size_t i) {
+    if (i >= gen_.size())
+      gen_.resize(i + 1, 0);
+    ++gen_[i];
+  }
+
+  /** End the generation of every slot in [@a first, @a last). */
+  void retire(std::size_t first, std::size_t last) {
+    if (first >= last)
+      return;
+    if (last > gen_.size())
+      gen_.resize(last, 0);
+    for (std::size_t i = first; i < last; ++i)
+      ++gen_[i];
+  }
+
+  /** Record that the last of @a n elements moved into slot @a i, whose
+   * element was removed. */
+  void swap_remove(std::size_t i, std::size_t n) {
+    assert(i < n);
+    retire(i);
+    if (i + 1 != n)
+      retire(n - 1);
+  }
+
+  /** Record the renumbering new[k] = old[old_index[k]] for k < @a n of an
+   * array of @a old_n elements: slots whose element changed, and slots
+   * past the new end, are retired.
+   * Complexity: O(max(@a n, @a old_n)). */
+  void gather(const Index* old_index, std::size_t n, std::size_t old_n) {
+    for (std::size_t k = 0; k < n; ++k) {
+      if (std::size_t(old_index[k]) != k)
+        retire(k);
+    }
+    retire(n, old_n);
+  }
+
+  /** Return the bytes used and reserved by the counters. */
+  std::size_t bytes() const {
+    return gen_.size() * sizeof(generation_type);
+  }
+  std::size_t capacity_bytes() const {
+    return gen_.capacity() * sizeof(generation_type);
+  }
+
+  void swap(GenerationTable& other) noexcept {
+    gen_.swap(other.gen_);
+  }
+
+ private:
+  std::vector<generation_type> gen_;
+};
+
+#endif // CME212_STABLE_HANDLE_HPP
@@ -0,0 +1,461 @@
+#ifndef CME212_STATIC_GRAPH_HPP
+#define CME212_STATIC_GRAPH_HPP
+
+/** @file static_graph.hpp
+ * @brief A graph of fixed size whose topology is built at compile time.
+ *
+ * Stencils and element templates are tiny graphs that never change, yet
+ * building them with add_node() and add_edge() costs allocations and
+ * hashing every time. A StaticGraph<N, M> keeps N nodes and M edges in
+ * std::arrays and is constructed from an edge list in a constant
+ * expression, so incident loops over it have constant trip counts the
+ * compiler can unroll:
+ *
+ *   // The 27-point stencil: the center, node 13, joined to every other
+ *   // node of a 3 x 3 x 3 block
+ *   constexpr auto stencil = [] {
+ *     std::array<static_edge, 26> e{};
+ *     for (unsigned k = 0, j = 0; k < 27; ++k)
+ *       if (k != 13)
+ *         e[j++] = {13, k};
+ *     return StaticGraph<27, 26>(e);
+ *   }();
+ *   static_assert(stencil.node(13).degree() == 26);
+ *   for (auto e : stencil.node(13).incident_edges())
+ *     sum += w[e.node2().index()];
+ *
+ * Node, Edge and the iterators follow Graph: node(i), edge(i), has_edge(),
+ * node_begin()/node_end(), Node::edge_begin() and Edge::node2() work as
+ * they do there, so the generic algorithms take a StaticGraph unchanged.
+ * The graph carries topology only; per-node data lives in arrays indexed
+ * by Node::index().
+ */
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+
+#include "common/graph_range.hpp"
+
+
+/** An edge of a static graph's edge list, as its two node indices.
+ * (std::pair is not assignable in constant expressions before C++20.) */
+struct static_edge {
+  unsigned first;
+  unsigned second;
+};
+
+
+/** @class StaticGraph
+ * @brief An undirected graph of @a N nodes and @a M edges, fixed when it is
+ *        constructed.
+ *
+ * The adjacency is in compressed sparse row form: node i's neighbors are
+ * slots [offset(i), offset(i + 1)) of one array of 2 M entries, in
+ * increasing order, next to the index of the edge each slot belongs to.
+ * Every member is constexpr, and Node, Edge and iterators are small
+ * values that refer to the graph.
+ *
+ * @tparam N  Number of nodes, indexed 0 .. N - 1.
+ * @tparam M  Number of edges, indexed in the order of the edge list.
+ */
+template <std::size_t N, std::size_t M>
+class StaticGraph {
+ public:
+  using size_type = unsigned;
+
+  class Node;
+  class Edge;
+  class NodeIterator;
+  class EdgeIterator;
+  class IncidentIterator;
+  using node_type = Node;
+  using edge_type = Edge;
+  using node_iterator = NodeIterator;
+  using edge_iterator = EdgeIterator;
+  using incident_iterator = IncidentIterator;
+  using node_range = GraphRange<NodeIterator>;
+  using edge_range = GraphRange<EdgeIterator>;
+  using incident_range = GraphRange<IncidentIterator>;
+
+  /** Construct the graph of the edges @a edges, edge k joining
+   * @a edges[k].first and @a edges[k].second.
+   * @throws std::runtime_error if an edge has an endpoint not less than N,
+   *         joins a node to itself, or repeats an earlier edge; in a
+   *         constant expression this is a compile error instead
+   *
+   * Complexity: O(N + sum of squared degrees), all at compile time for a
+   * constexpr graph.
+   */
+  constexpr explicit StaticGraph(const std::array<static_edge, M>& edges)
+      : ends_(), offsets_(), slots_(), slot_edges_() {
+    for (std::size_t k = 0; k < M; ++k) {
+      size_type a = edges[k].first, b = edges[k].second;
+      if (a >= N || b >= N)
+        throw std::runtime_error("StaticGraph: edge endpoint out of range");
+      if (a == b)
+        throw std::runtime_error("StaticGraph: edge joins a node to itself");
+      ends_[k] = {a, b};
+      ++offsets_[a + 1];
+      ++offsets_[b + 1];
+    }
+    for (std::size_t i = 0; i < N; ++i)
+      offsets_[i + 1] += offsets_[i];
+
+    std::array<size_type, N + 1> next = offsets_;
+    for (std::size_t k = 0; k < M; ++k) {
+      size_type a = ends_[k].first, b = ends_[k].second;
+      insert(next[a]++, offsets_[a], b, size_type(k));
+      insert(next[b]++, offsets_[b], a, size_type(k));
+    }
+    for (std::size_t i = 0; i < N; ++i) {
+      for (size_type j = offsets_[i] + 1; j < offsets_[i + 1]; ++j) {
+        if (slots_[j] == slots_[j - 1])
+          throw std::runtime_error("StaticGraph: repeated edge");
+      }
+    }
+  }
+
+  static constexpr size_type size() {
+    return size_type(N);
+  }
+  static constexpr size_type num_nodes() {
+    return size_type(N);
+  }
+  static constexpr size_type num_edges() {
+    return size_type(M);
+  }
+
+  /** Return the node with index @a i.
+   * @pre @a i < N
+   */
+  constexpr Node node(size_type i) const {
+    assert(i < N);
+    return Node(this, i);
+  }
+
+  /** Return edge @a k of the edge list, with the endpoints in its order.
+   * @pre @a k < M
+   */
+  constexpr Edge edge(size_type k) const {
+    assert(k < M);
+    return Edge(this, ends_[k].first, ends_[k].second, k);
+  }
+
+  constexpr bool has_node(const Node& n) const {
+    return n.g_ == this && n.i_ < N;
+  }
+
+  /** Return true if nodes @a a and @a b are adjacent.
+   * Complexity: O(log(a.degree())).
+   */
+  constexpr bool has_edge(const Node& a, const Node& b) const {
+    return find(a.i_, b.i_) != npos;
+  }
+
+  /** Return the first slot of node @a i in the adjacency arrays; node i's
+   * neighbors are neighbors_data()[offset(i), offset(i + 1)). */
+  constexpr size_type offset(size_type i) const {
+    assert(i <= N);
+    return offsets_[i];
+  }
+  /** Return the 2 M neighbor indices, row by row. */
+  constexpr const size_type* neighbors_data() const {
+    return slots_.data();
+  }
+  /** Return the edge index of every adjacency slot, parallel to
+   * neighbors_data(). */
+  constexpr const size_type* slot_edges_data() const {
+    return slot_edges_.data();
+  }
+
+  /** @class StaticGraph::Node
+   * @brief A node of the graph, as the graph and an index. */
+  class Node {
+   public:
+    constexpr Node() : g_(nullptr), i_(0) {
+    }
+
+    constexpr size_type index() const {
+      return i_;
+    }
+    constexpr size_type degree() const {
+      return g_->offsets_[i_ + 1] - g_->offsets_[i_];
+    }
+
+    /** Return an iterator to the first incident edge, in increasing order
+     * of node2().index(). */
+    constexpr IncidentIterator edge_begin() const {
+      return IncidentIterator(g_, i_, g_->offsets_[i_]);
+    }
+    constexpr IncidentIterator edge_end() const {
+      return IncidentIterator(g_, i_, g_->offsets_[i_ + 1]);
+    }
+    /** Return the incident edges, each with node1() == *this. */
+    constexpr incident_range incident_edges() const {
+      return incident_range(edge_begin(), edge_end(), degree());
+    }
+
+    constexpr bool operator==(const Node& x) const {
+      return g_ == x.g_ && i_ == x.i_;
+    }
+    constexpr bool operator!=(const Node& x) const {
+      return !(*this == x);
+    }
+    constexpr bool operator<(const Node& x) const {
+      return i_ < x.i_;
+    }
+
+   private:
+    friend class StaticGraph;
+    const StaticGraph* g_;
+    size_type i_;
+
+    constexpr Node(const StaticGraph* g, size_type i) : g_(g), i_(i) {
+    }
+  };
+
+  /** @class StaticGraph::Edge
+   * @brief An edge of the graph, oriented from node1() to node2(). */
+  class Edge {
+   public:
+    constexpr Edge() : g_(nullptr), a_(0), b_(0), k_(0) {
+    }
+
+    constexpr Node node1() const {
+      return Node(g_, a_);
+    }
+    constexpr Node node2() const {
+      return Node(g_, b_);
+    }
+    /** Return the index of the edge in the edge list. */
+    constexpr size_type index() const {
+      return k_;
+    }
+
+    /** Edges compare by their index, whichever way they are oriented. */
+    constexpr bool operator==(const Edge& x) const {
+      return g_ == x.g_ && k_ == x.k_;
+    }
+    constexpr bool operator!=(const Edge& x) const {
+      return !(*this == x);
+    }
+    constexpr bool operator<(const Edge& x) const {
+      return k_ < x.k_;
+    }
+
+   private:
+    friend class StaticGraph;
+    const StaticGraph* g_;
+    size_type a_, b_, k_;
+
+    constexpr Edge(const StaticGraph* g, size_type a, size_type b,
+                   size_type k)
+        : g_(g), a_(a), b_(b), k_(k) {
+    }
+  };
+
+  /** @class StaticGraph::NodeIterator
+   * @brief Forward iterator over the nodes, in index order. */
+  class NodeIterator {
+   public:
+    using value_type = Node;
+    using pointer = Node*;
+    using reference = Node;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    constexpr NodeIterator() : g_(nullptr), i_(0) {
+    }
+
+    constexpr Node operator*() const {
+      return Node(g_, i_);
+    }
+    constexpr NodeIterator& operator++() {
+      ++i_;
+      return *this;
+    }
+    constexpr NodeIterator operator++(int) {
+      NodeIterator tmp = *this;
+      ++i_;
+      return tmp;
+    }
+    constexpr bool operator==(const NodeIterator& x) const {
+      return g_ == x.g_ && i_ == x.i_;
+    }
+    constexpr bool operator!=(const NodeIterator& x) const {
+      return !(*this == x);
+    }
+
+   private:
+    friend class StaticGraph;
+    const StaticGraph* g_;
+    size_type i_;
+
+    constexpr NodeIterator(const StaticGraph* g, size_type i)
+        : g_(g), i_(i) {
+    }
+  };
+
+  constexpr NodeIterator node_begin() const {
+    return NodeIterator(this, 0);
+  }
+  constexpr NodeIterator node_end() const {
+    return NodeIterator(this, size_type(N));
+  }
+  constexpr node_range nodes() const {
+    return node_range(node_begin(), node_end(), N);
+  }
+
+  /** @class StaticGraph::EdgeIterator
+   * @brief Forward iterator over the edges, in edge list order. */
+  class EdgeIterator {
+   public:
+    using value_type = Edge;
+    using pointer = Edge*;
+    using reference = Edge;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    constexpr EdgeIterator() : g_(nullptr), k_(0) {
+    }
+
+    constexpr Edge operator*() const {
+      return g_->edge(k_);
+    }
+    constexpr EdgeIterator& operator++() {
+      ++k_;
+      return *this;
+    }
+    constexpr EdgeIterator operator++(int) {
+      EdgeIterator tmp = *this;
+      ++k_;
+      return tmp;
+    }
+    constexpr bool operator==(const EdgeIterator& x) const {
+      return g_ == x.g_ && k_ == x.k_;
+    }
+    constexpr bool operator!=(const EdgeIterator& x) const {
+      return !(*this == x);
+    }
+
+   private:
+    friend class StaticGraph;
+    const StaticGraph* g_;
+    size_type k_;
+
+    constexpr EdgeIterator(const StaticGraph* g, size_type k)
+        : g_(g), k_(k) {
+    }
+  };
+
+  constexpr EdgeIterator edge_begin() const {
+    return EdgeIterator(this, 0);
+  }
+  constexpr EdgeIterator edge_end() const {
+    return EdgeIterator(this, size_type(M));
+  }
+  constexpr edge_range edges() const {
+    return edge_range(edge_begin(), edge_end(), M);
+  }
+
+  /** @class StaticGraph::IncidentIterator
+   * @brief Forward iterator over the edges of a node, as adjacency slots. */
+  class IncidentIterator {
+   public:
+    using value_type = Edge;
+    using pointer = Edge*;
+    using reference = Edge;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    constexpr IncidentIterator() : g_(nullptr), i_(0), j_(0) {
+    }
+
+    /** Return the edge, with node1() the node iterated around. */
+    constexpr Edge operator*() const {
+      return Edge(g_, i_, g_->slots_[j_], g_->slot_edges_[j_]);
+    }
+    constexpr IncidentIterator& operator++() {
+      ++j_;
+      return *this;
+    }
+    constexpr IncidentIterator operator++(int) {
+      IncidentIterator tmp = *this;
+      ++j_;
+      return tmp;
+    }
+    constexpr bool operator==(const IncidentIterator& x) const {
+      return g_ == x.g_ && j_ == x.j_;
+    }
+    constexpr bool operator!=(const IncidentIterator& x) const {
+      return !(*this == x);
+    }
+
+   private:
+    friend class StaticGraph;
+    const StaticGraph* g_;
+    size_type i_;
+    size_type j_;
+
+    constexpr IncidentIterator(const StaticGraph* g, size_type i,
+                               size_type j)
+        : g_(g), i_(i), j_(j) {
+    }
+  };
+
+ private:
+  static constexpr size_type npos = size_type(-1);
+
+  std::array<static_edge, M> ends_;
+  std::array<size_type, N + 1> offsets_;
+  std::array<size_type, 2 * M> slots_;
+  std::array<size_type, 2 * M> slot_edges_;
+
+  /** Place neighbor @a x of edge @a k into the sorted row prefix
+   * [@a first, @a last), which grows by one. */
+  constexpr void insert(size_type last, size_type first, size_type x,
+                        size_type k) {
+    size_type j = last;
+    for (; j > first && slots_[j - 1] > x; --j) {
+      slots_[j] = slots_[j - 1];
+      slot_edges_[j] = slot_edges_[j - 1];
+    }
+    slots_[j] = x;
+    slot_edges_[j] = k;
+  }
+
+  /** Return the slot of neighbor @a b in node @a a's row, or npos. */
+  constexpr size_type find(size_type a, size_type b) const {
+    size_type lo = offsets_[a], hi = offsets_[a + 1];
+    while (lo < hi) {
+      size_type mid = lo + (hi - lo) / 2;
+      if (slots_[mid] < b)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return lo < offsets_[a + 1] && slots_[lo] == b ? lo : npos;
+  }
+};
+
+
+/** Return the static graph of @a N nodes with the edges @a edges, the edge
+ * count deduced from the list:
+ *
+ *   constexpr auto square = make_static_graph<4>({{0, 1}, {1, 2}, {2, 3},
+ *                                                 {3, 0}});
+ *
+ * @throws std::runtime_error as StaticGraph's constructor
+ */
+template <std::size_t N, std::size_t M>
+constexpr StaticGraph<N, M> make_static_graph(const static_edge (&edges)[M]) {
+  std::array<static_edge, M> list{};
+  for (std::size_t k = 0; k < M; ++k)
+    list[k] = edges[k];
+  return StaticGraph<N, M>(list);
+}
+
+#endif // CME212_STATIC_GRAPH_HPP
@@ -0,0 +1,430 @@
+#ifndef CME212_SYMPLECTIC_HPP
+#define CME212_SYMPLECTIC_HPP
+
+/** @file symplectic.hpp
+ * @brief Symplectic Euler time stepping of node positions under composed
+ *        forces and constraints.
+ *
+ * The CME212 mass-spring step, written against the proxies, is
+ *
+ *   for each node n: n.position() += n.value().vel * dt
+ *   apply the constraints
+ *   for each node n: n.value().vel += force(n, t) * (dt / n.value().mass)
+ *
+ * with force() summing the springs through the incident iterators.
+ * SymplecticEuler keeps velocities and inverse masses in arrays of its own
+ * and runs the step as two fused passes over the nodes, split across
+ * threads, around one force evaluation:
+ *
+ *   pass 1  x[i] += v[i] dt, constrain node i, f[i] = 0
+ *   forces  each force adds its share to f
+ *   pass 2  v[i] += f[i] dt / m[i]
+ *
+ * Forces and constraints are functors, combined at compile time:
+ *
+ *   SpringKernel<G> springs(g);
+ *   SymplecticEuler<G> euler(g);
+ *   auto forces = make_forces(spring_force(springs, g, K, L),
+ *                             node_force([&](std::size_t i, const Point&,
+ *                                            const Point&) {
+ *                               return euler.mass(i) * Point(0, 0, -grav);
+ *                             }));
+ *   auto fixed = [](std::size_t i, Point& x, Point& v) { ... };
+ *   for (double t = 0; t < t_end; t += dt)
+ *     euler.step(dt, forces, fixed);
+ *
+ * A force is called as force(x, v, f, n, threads) and adds to f[0, n). A
+ * constraint is called as constraint(i, x[i], v[i]) for every node, right
+ * after x[i] moves, and may change both. However many constraints there
+ * are, make_constraints() folds them into one functor that inlines into
+ * pass 1, so each node's position and velocity are loaded once for all of
+ * them. The hw2 set is then
+ *
+ *   euler.pin(corner0);  euler.pin(corner1);   // fixed corners
+ *   auto constraints = make_constraints(
+ *       plane_constraint(Point(0, 0, 1), -0.75),
+ *       sphere_constraint(Point(0.5, 0.5, -0.5), 0.15));
+ *   euler.step(dt, forces, constraints);
+ */
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/graph_traits.hpp"
+#include "common/spring_forces.hpp"
+#include "CME212/Point.hpp"
+
+
+namespace symplectic_detail {
+
+template <typename G, typename = void>
+struct has_mark_positions_changed : std::false_type {};
+template <typename G>
+struct has_mark_positions_changed<G, std::void_t<
+    decltype(std::declval<G&>().mark_positions_changed(0, 0))>>
+    : std::true_type {};
+
+template <typename G, typename = void>
+struct has_invalidate_edge_cache : std::false_type {};
+template <typename G>
+struct has_invalidate_edge_cache<G, std::void_t<
+    decltype(std::declval<G&>().invalidate_edge_cache())>> : std::true_type {};
+
+/** Nodes per block of the node passes. */
+constexpr std::size_t grain = 1024;
+
+} // end namespace symplectic_detail
+
+
+/** Constraint that leaves every node alone. */
+struct no_constraint {
+  void operator()(std::size_t, Point&, Point&) const {
+  }
+};
+
+/** @class ConstraintSet
+ * @brief Constraints applied one after another to each node. */
+template <typename... Cs>
+class ConstraintSet {
+ public:
+  explicit ConstraintSet(Cs... cs) : cs_(std::move(cs)...) {
+  }
+  void operator()(std::size_t i, Point& x, Point& v) const {
+    std::apply([&](const Cs&... c) { (c(i, x, v), ...); }, cs_);
+  }
+
+ private:
+  std::tuple<Cs...> cs_;
+};
+
+/** Return the constraint that applies @a cs in order. */
+template <typename... Cs>
+ConstraintSet<Cs...> make_constraints(Cs... cs) {
+  return ConstraintSet<Cs...>(std::move(cs)...);
+}
+
+/** @class PlaneConstraint
+ * @brief Keeps nodes on one side of a plane, such as the floor at
+ *        z = -0.75: a node behind it is moved onto it and loses the part of
+ *        its velocity along the normal. */
+class PlaneConstraint {
+ public:
+  /** Keep nodes where dot(@a normal, x) >= @a offset.
+   * @pre norm(@a normal) == 1 */
+  PlaneConstraint(const Point& normal, double offset)
+      : normal_(normal), offset_(offset) {
+  }
+  void operator()(std::size_t, Point& x, Point& v) const {
+    double depth = dot(normal_, x) - offset_;
+    if (depth < 0) {
+      x -= depth * normal_;
+      v -= dot(normal_, v) * normal_;
+    }
+  }
+
+ private:
+  Point normal_;
+  double offset_;
+};
+
+/** Return the constraint that keeps nodes where dot(@a normal, x) >=
+ * @a offset. */
+inline PlaneConstraint plane_constraint(const Point& normal, double offset) {
+  return PlaneConstraint(normal, offset);
+}
+
+/** @class SphereConstraint
+ * @brief Keeps nodes out of a ball: a node inside is moved onto its surface
+ *        and loses the part of its velocity along the surface normal. */
+class SphereConstraint {
+ public:
+  /** Keep nodes at distance >= @a radius from @a center.
+   * @pre @a radius > 0 */
+  SphereConstraint(const Point& center, double radius)
+      : center_(center), radius_(radius) {
+  }
+  void operator()(std::size_t, Point& x, Point& v) const {
+    Point d = x - center_;
+    double d2 = normSq(d);
+    if (d2 < radius_ * radius_ && d2 > 0) {
+      Point r = d / std::sqrt(d2);
+      x = center_ + radius_ * r;
+      v -= dot(r, v) * r;
+    }
+  }
+
+ private:
+  Point center_;
+  double radius_;
+};
+
+/** Return the constraint that keeps nodes at distance >= @a radius from
+ * @a center. */
+inline SphereConstraint sphere_constraint(const Point& center, double radius) {
+  return SphereConstraint(center, radius);
+}
+
+/** @class ForceSet
+ * @brief The sum of several forces, each adding its share in turn. */
+template <typename... Fs>
+class ForceSet {
+ public:
+  explicit ForceSet(Fs... fs) : fs_(std::move(fs)...) {
+  }
+  void operator()(const Point* x, const Point* v, Point* f, std::size_t n,
+                  unsigned threads) const {
+    std::apply([&](const Fs&... force) { (force(x, v, f, n, threads), ...); },
+               fs_);
+  }
+
+ private:
+  std::tuple<Fs...> fs_;
+};
+
+/** Return the force that sums @a fs. */
+template <typename... Fs>
+ForceSet<Fs...> make_forces(Fs... fs) {
+  return ForceSet<Fs...>(std::move(fs)...);
+}
+
+/** @class NodeForce
+ * @brief A force that depends on each node alone, such as gravity or
+ *        damping: f[i] += fn(i, x[i], v[i]). */
+template <typename Fn>
+class NodeForce {
+ public:
+  explicit NodeForce(Fn fn) : fn_(std::move(fn)) {
+  }
+  void operator()(const Point* x, const Point* v, Point* f, std::size_t n,
+                  unsigned threads) const {
+    csr_snapshot::parallel_ranges(threads, n, symplectic_detail::grain,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i)
+            f[i] += fn_(i, x[i], v[i]);
+        });
+  }
+
+ private:
+  Fn fn_;
+};
+
+/** Return the force fn(i, x, v) applied to every node. */
+template <typename Fn>
+NodeForce<Fn> node_force(Fn fn) {
+  return NodeForce<Fn>(std::move(fn));
+}
+
+/** @class SpringForce
+ * @brief The springs of a SpringKernel, as a force.
+ *
+ * The kernel reads the positions from the graph itself, which
+ * SymplecticEuler keeps current before every force evaluation. The kernel
+ * and the graph must outlive the force.
+ */
+template <typename G>
+class SpringForce {
+ public:
+  SpringForce(const SpringKernel<G>& kernel, const G& g, double K, double L)
+      : kernel_(&kernel), g_(&g), K_(K), L_(L) {
+  }
+  void operator()(const Point*, const Point*, Point* f, std::size_t,
+                  unsigned) const {
+    kernel_->accumulate(*g_, K_, L_, f);
+  }
+
+ private:
+  const SpringKernel<G>* kernel_;
+  const G* g_;
+  double K_;
+  double L_;
+};
+
+/** Return the force of the springs of @a kernel over @a g, with spring
+ * constant @a K and rest length @a L. */
+template <typename G>
+SpringForce<G> spring_force(const SpringKernel<G>& kernel, const G& g,
+                            double K, double L) {
+  return SpringForce<G>(kernel, g, K, L);
+}
+
+
+/** @class SymplecticEuler
+ * @brief Symplectic Euler integrator over the node positions of a graph.
+ *
+ * Velocities and inverse masses live in the integrator, one per node, so
+ * node_value_type needs no vel or mass field. The graph's node set must not
+ * change while the integrator is used.
+ *
+ * @tparam G  Graph type with size() and node(i).position(). Graphs with
+ *            positions_data() (hw1/Graph-24726.hpp) are stepped in place,
+ *            and told of the moved nodes through mark_positions_changed()
+ *            and invalidate_edge_cache() when they have them. Others are
+ *            gathered into a copy and written back through
+ *            node(i).position(), which must then return a modifiable
+ *            Point, once per step.
+ */
+template <typename G>
+class SymplecticEuler {
+ public:
+  /** Type of node indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Prepare to step @a g, with every node at rest and of mass 1.
+   * @param[in] threads  Threads for the node passes and the built-in
+   *                     forces; 0 means all cores
+   *
+   * Complexity: O(g.size()).
+   */
+  explicit SymplecticEuler(G& g, unsigned threads = 0)
+      : g_(&g), threads_(csr_snapshot::thread_count(threads)),
+        n_(std::size_t(g.size())), velocity_(n_, Point(0, 0, 0)),
+        inv_mass_(n_, 1.0), force_(n_, Point(0, 0, 0)) {
+  }
+
+  /** Return the number of nodes stepped. */
+  std::size_t size() const {
+    return n_;
+  }
+
+  /** Return the velocity of node @a i, which may be assigned. */
+  Point& velocity(std::size_t i) {
+    return velocity_[i];
+  }
+  const Point& velocity(std::size_t i) const {
+    return velocity_[i];
+  }
+  /** Return the velocities in node index order. */
+  Point* velocities() {
+    return velocity_.data();
+  }
+
+  /** Return the mass of node @a i. */
+  double mass(std::size_t i) const {
+    return 1.0 / inv_mass_[i];
+  }
+  /** Set the mass of node @a i to @a m > 0. An infinite mass pins the
+   * node's velocity: forces no longer change it. */
+  void set_mass(std::size_t i, double m) {
+    assert(m > 0);
+    inv_mass_[i] = 1.0 / m;
+  }
+
+  /** Hold node @a i where it is: zero its velocity and make its mass
+   * infinite, so neither forces nor the node pass move it. Cheaper than a
+   * constraint that tests every node's index, and constraints still apply.
+   */
+  void pin(std::size_t i) {
+    velocity_[i] = Point(0, 0, 0);
+    inv_mass_[i] = 0;
+  }
+
+  /** Apply @a constraint to every node in one pass, without stepping, e.g.
+   * to project the initial state.
+   *
+   * Complexity: O(size()), spread over the threads.
+   */
+  template <typename Constraint>
+  void constrain(const Constraint& constraint) {
+    assert(std::size_t(g_->size()) == n_);
+    Point* x = positions();
+    Point* v = velocity_.data();
+    csr_snapshot::parallel_ranges(threads_, n_, symplectic_detail::grain,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i)
+            constraint(i, x[i], v[i]);
+        });
+    publish();
+  }
+
+  /** Return the force on every node in the last step(). */
+  const Point* forces() const {
+    return force_.data();
+  }
+
+  /** Advance the graph by @a dt.
+   * @param[in] force       Force functor, called as described in the file
+   *                        comment
+   * @param[in] constraint  Called as constraint(i, x, v) on every node
+   *                        right after its position update
+   *
+   * @pre g.size() == size()
+   * @post Every node moved by its old velocity times @a dt and was then
+   *       constrained, and its velocity grew by dt / mass times the force
+   *       at the new positions
+   *
+   * Complexity: O(size()) plus the forces, spread over the threads.
+   */
+  template <typename Force, typename Constraint = no_constraint>
+  void step(double dt, const Force& force,
+            const Constraint& constraint = Constraint()) {
+    assert(std::size_t(g_->size()) == n_);
+    Point* x = positions();
+    Point* v = velocity_.data();
+    Point* f = force_.data();
+    csr_snapshot::parallel_ranges(threads_, n_, symplectic_detail::grain,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i) {
+            x[i] += dt * v[i];
+            constraint(i, x[i], v[i]);
+            f[i] = Point(0, 0, 0);
+          }
+        });
+    publish();
+
+    force(x, v, f, n_, threads_);
+
+    const double* inv_mass = inv_mass_.data();
+    csr_snapshot::parallel_ranges(threads_, n_, symplectic_detail::grain,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          // Skip pinned nodes: a force scaled by their infinite mass, like
+          // gravity, is infinite, and 0 * inf is not 0
+          for (std::size_t i = b; i < e; ++i) {
+            if (inv_mass[i] != 0)
+              v[i] += (dt * inv_mass[i]) * f[i];
+          }
+        });
+  }
+
+ private:
+  G* g_;
+  unsigned threads_;
+  std::size_t n_;
+  std::vector<Point> velocity_;
+  std::vector<double> inv_mass_;
+  std::vector<Point> force_;
+  // Copy of the positions for graphs without positions_data()
+  std::vector<Point> gathered_;
+
+  /** Return the positions to update in place. */
+  Point* positions() {
+    if constexpr (graph_traits::has_soa_positions<G>::value) {
+      return g_->positions_data();
+    } else {
+      gathered_.resize(n_);
+      for (std::size_t i = 0; i < n_; ++i)
+        gathered_[i] = g_->node(size_type(i)).position();
+      return gathered_.data();
+    }
+  }
+
+  /** Make the updated positions visible through the graph. */
+  void publish() {
+    if constexpr (graph_traits::has_soa_positions<G>::value) {
+      if constexpr (symplectic_detail::has_mark_positions_changed<G>::value)
+        g_->mark_positions_changed(size_type(0), size_type(n_));
+      if constexpr (symplectic_detail::has_invalidate_edge_cache<G>::value)
+        g_->invalidate_edge_cache();
+    } else {
+      for (std::size_t i = 0; i < n_; ++i)
+        g_->node(size_type(i)).position() = gathered_[i];
+    }
+  }
+};
+
+#endif // CME212_SYMPLECTIC_HPP
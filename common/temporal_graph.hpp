@@ -0,0 +1,558 @@
+#ifndef CME212_TEMPORAL_GRAPH_HPP
+#define CME212_TEMPORAL_GRAPH_HPP
+
+/** @file temporal_graph.hpp
+ * @brief An undirected graph of timestamped edges whose incident rows are
+ *        sorted by time, for queries over a sliding window.
+ *
+ * An interaction graph gains an edge per interaction and is mostly asked
+ * about recent ones: "who did u talk to in the last hour?". Rebuilding a
+ * Graph per window copies every edge of the window each time. A
+ * TemporalGraph keeps every node's incident edges sorted by timestamp
+ * instead, so the edges of u in [t0, t1) are one contiguous stretch of its
+ * row, found by two binary searches:
+ *
+ *   TemporalGraph<int> g;
+ *   g.add_edge(a, b, now);                     // one interaction
+ *   for (auto e : a.edges_in(now - 3600, now))
+ *     ++talked[e.node2().index()];
+ *   g.expire_before(now - 86400);              // forget the day before
+ *   g.compact();                               // now and then
+ *
+ * Edges older than the horizon set by expire_before() are expired: every
+ * incident iteration starts at the first edge at or after the horizon, so
+ * no query reads them, but they keep their memory until compact(). As
+ * rows are sorted by time, the expired edges of a row are its prefix, and
+ * compact() drops them all in one pass over the rows, so the cost of
+ * expiring is paid once per batch rather than per edge.
+ *
+ * Node, Edge and the iterators follow DiGraph, and Node::edge_begin()
+ * walks the unexpired edges, so generic algorithms (BfsEngine, connected
+ * components, ...) run on the graph as of the horizon.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#include "common/graph_range.hpp"
+#include "common/result_cache.hpp"
+#include "CME212/Point.hpp"
+
+
+/** @class TemporalGraph
+ * @brief An undirected multigraph of positioned nodes with values of type
+ *        @a V and timestamped edges with values of type @a E.
+ *
+ * Each edge is one interaction at one time, so two nodes may share any
+ * number of edges; none joins a node to itself. An edge sits in the rows
+ * of both its endpoints, which are sorted by time, and edges of equal time
+ * in the order they were added. Adding edges in time order appends to the
+ * rows; an edge older than the newest of a row is inserted in place.
+ *
+ * @tparam V  Node value type.
+ * @tparam E  Edge value type.
+ */
+template <typename V, typename E = double>
+class TemporalGraph {
+ public:
+  using graph_type = TemporalGraph;
+  using size_type = std::uint32_t;
+  using node_value_type = V;
+  using edge_value_type = E;
+  /** Type of edge timestamps. */
+  using time_type = double;
+
+ private:
+  // One row entry: the time, the node across the edge and the edge itself
+  struct arc {
+    time_type time;
+    size_type node;
+    size_type edge;
+  };
+
+ public:
+  class Node;
+  class Edge;
+  class NodeIterator;
+  class EdgeIterator;
+  class IncidentIterator;
+  using node_type = Node;
+  using edge_type = Edge;
+  using node_iterator = NodeIterator;
+  using edge_iterator = EdgeIterator;
+  using incident_iterator = IncidentIterator;
+  using node_range = GraphRange<NodeIterator>;
+  using edge_range = GraphRange<EdgeIterator>;
+  using incident_range = GraphRange<IncidentIterator>;
+
+  /** Construct an empty graph with no horizon. */
+  TemporalGraph() = default;
+
+  size_type size() const {
+    return size_type(positions_.size());
+  }
+  size_type num_nodes() const {
+    return size();
+  }
+  /** Return the number of edges held, expired ones not yet compacted
+   * included. */
+  size_type num_edges() const {
+    return size_type(edges_.size());
+  }
+
+  /** Return a number that changes whenever the edges seen by iteration
+   * change: an added node or edge, a new horizon, compact() or clear(). */
+  std::uint64_t topology_version() const {
+    return topology_version_;
+  }
+
+  /** Add a node at @a position with value @a value.
+   * @post result.index() == old num_nodes()
+   * Complexity: O(1) amortized.
+   */
+  Node add_node(const Point& position,
+                const node_value_type& value = node_value_type()) {
+    positions_.push_back(position);
+    values_.push_back(value);
+    rows_.emplace_back();
+    changed();
+    return Node(this, size() - 1);
+  }
+
+  /** Return the node with index @a i.
+   * @pre @a i < num_nodes()
+   */
+  Node node(size_type i) const {
+    assert(i < size());
+    return Node(this, i);
+  }
+
+  /** Return edge @a k, seen from its first node.
+   * @pre @a k < num_edges()
+   */
+  Edge edge(size_type k) const {
+    assert(k < num_edges());
+    return Edge(this, edges_[k].a, edges_[k].b, k);
+  }
+
+  bool has_node(const Node& n) const {
+    return n.g_ == this && n.i_ < size();
+  }
+
+  /** Add an edge between @a a and @a b at time @a time with value @a value.
+   * @pre @a a and @a b are distinct nodes of this graph
+   * @post result.index() == old num_edges(), result.node1() == @a a
+   *
+   * An edge older than horizon() is added expired: it is held until the
+   * next compact() but never iterated.
+   *
+   * Complexity: O(1) amortized if @a time is at least the newest time in
+   * both rows, O(a.degree() + b.degree()) otherwise.
+   */
+  Edge add_edge(const Node& a, const Node& b, time_type time,
+                const edge_value_type& value = edge_value_type()) {
+    assert(has_node(a) && has_node(b) && a.i_ != b.i_);
+    size_type k = num_edges();
+    edges_.push_back({a.i_, b.i_, time});
+    edge_values_.push_back(value);
+    insert(rows_[a.i_], arc{time, b.i_, k});
+    insert(rows_[b.i_], arc{time, a.i_, k});
+    changed();
+    return Edge(this, a.i_, b.i_, k);
+  }
+
+  /** Return the horizon: edges of earlier times are expired. */
+  time_type horizon() const {
+    return horizon_;
+  }
+
+  /** Expire every edge older than @a time, unless the horizon is later
+   * already.
+   * @post horizon() == max(old horizon(), @a time)
+   *
+   * Expired edges are skipped by every iteration from now on, at the cost
+   * of one binary search per row visited; compact() frees them.
+   * Complexity: O(1).
+   */
+  void expire_before(time_type time) {
+    if (time > horizon_) {
+      horizon_ = time;
+      changed();
+    }
+  }
+
+  /** Drop the expired edges and renumber the others, keeping their order.
+   * @return The number of edges dropped
+   * @post Every edge has time() >= horizon()
+   *
+   * Invalidates outstanding Edge and iterator objects and edge indices.
+   * Complexity: O(num_nodes() + num_edges()).
+   */
+  size_type compact() {
+    // New index of every edge that stays; expired ones get none
+    constexpr size_type none = std::numeric_limits<size_type>::max();
+    std::vector<size_type> index(edges_.size(), none);
+    size_type kept = 0;
+    for (std::size_t k = 0; k < edges_.size(); ++k) {
+      if (!(edges_[k].time < horizon_)) {
+        index[k] = kept;
+        edges_[kept] = edges_[k];
+        edge_values_[kept] = edge_values_[k];
+        ++kept;
+      }
+    }
+    size_type dropped = size_type(edges_.size()) - kept;
+    edges_.resize(kept);
+    edge_values_.resize(kept);
+    for (std::vector<arc>& row : rows_) {
+      row.erase(row.begin(), first_live(row));
+      for (arc& x : row)
+        x.edge = index[x.edge];
+    }
+    changed();
+    return dropped;
+  }
+
+  /** Remove every node and edge and the horizon, keeping the storage of
+   * the arrays. */
+  void clear() {
+    positions_.clear();
+    values_.clear();
+    edges_.clear();
+    edge_values_.clear();
+    rows_.clear();
+    horizon_ = -std::numeric_limits<time_type>::infinity();
+    changed();
+  }
+
+  /** @class TemporalGraph::Node
+   * @brief A node of the graph, as the graph and an index. */
+  class Node {
+   public:
+    /** Construct an invalid node. */
+    Node() : g_(nullptr), i_(0) {
+    }
+
+    size_type index() const {
+      return i_;
+    }
+    Point& position() const {
+      return g_->positions_[i_];
+    }
+    node_value_type& value() const {
+      return g_->values_[i_];
+    }
+
+    /** Return the number of unexpired edges. Complexity: O(log degree). */
+    size_type degree() const {
+      return size_type(incident_edges().size());
+    }
+
+    /** Return an iterator to the first unexpired edge, in time order. */
+    IncidentIterator edge_begin() const {
+      return incident_edges().begin();
+    }
+    IncidentIterator edge_end() const {
+      return incident_edges().end();
+    }
+
+    /** Return the unexpired edges, with node1() == *this, in time order.
+     * Complexity: O(log degree). */
+    incident_range incident_edges() const {
+      return edges_in(g_->horizon_,
+                      std::numeric_limits<time_type>::infinity());
+    }
+
+    /** Return the edges of times in [@a t0, @a t1) that are not expired,
+     * with node1() == *this, in time order.
+     * Complexity: O(log degree), by two binary searches of the row. */
+    incident_range edges_in(time_type t0, time_type t1) const {
+      return g_->window(i_, t0, t1);
+    }
+
+    bool operator==(const Node& x) const {
+      return g_ == x.g_ && i_ == x.i_;
+    }
+    bool operator!=(const Node& x) const {
+      return !(*this == x);
+    }
+    bool operator<(const Node& x) const {
+      return g_ != x.g_ ? std::less<const TemporalGraph*>()(g_, x.g_)
+                        : i_ < x.i_;
+    }
+
+   private:
+    friend class TemporalGraph;
+    TemporalGraph* g_;
+    size_type i_;
+
+    Node(const TemporalGraph* g, size_type i)
+        : g_(const_cast<TemporalGraph*>(g)), i_(i) {
+    }
+  };
+
+  /** @class TemporalGraph::Edge
+   * @brief A timestamped edge, seen from node1(). */
+  class Edge {
+   public:
+    /** Construct an invalid edge. */
+    Edge() : g_(nullptr), a_(0), b_(0), k_(0) {
+    }
+
+    /** Return the node this edge was reached from. */
+    Node node1() const {
+      return Node(g_, a_);
+    }
+    /** Return the node across the edge from node1(). */
+    Node node2() const {
+      return Node(g_, b_);
+    }
+    /** Return the index of the edge, in the order the edges were added. */
+    size_type index() const {
+      return k_;
+    }
+    time_type time() const {
+      return g_->edges_[k_].time;
+    }
+    edge_value_type& value() const {
+      return g_->edge_values_[k_];
+    }
+    double length() const {
+      return norm(node1().position() - node2().position());
+    }
+
+    /** Edges compare by their index, from whichever end they are seen. */
+    bool operator==(const Edge& x) const {
+      return g_ == x.g_ && k_ == x.k_;
+    }
+    bool operator!=(const Edge& x) const {
+      return !(*this == x);
+    }
+    bool operator<(const Edge& x) const {
+      return g_ != x.g_ ? std::less<const TemporalGraph*>()(g_, x.g_)
+                        : k_ < x.k_;
+    }
+
+   private:
+    friend class TemporalGraph;
+    TemporalGraph* g_;
+    size_type a_, b_, k_;
+
+    Edge(const TemporalGraph* g, size_type a, size_type b, size_type k)
+        : g_(const_cast<TemporalGraph*>(g)), a_(a), b_(b), k_(k) {
+    }
+  };
+
+  /** @class TemporalGraph::NodeIterator
+   * @brief Forward iterator over the nodes, in index order. */
+  class NodeIterator {
+   public:
+    using value_type = Node;
+    using pointer = Node*;
+    using reference = Node;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    NodeIterator() : g_(nullptr), i_(0) {
+    }
+
+    Node operator*() const {
+      return Node(g_, i_);
+    }
+    NodeIterator& operator++() {
+      ++i_;
+      return *this;
+    }
+    NodeIterator operator++(int) {
+      NodeIterator tmp = *this;
+      ++i_;
+      return tmp;
+    }
+    bool operator==(const NodeIterator& x) const {
+      return g_ == x.g_ && i_ == x.i_;
+    }
+    bool operator!=(const NodeIterator& x) const {
+      return !(*this == x);
+    }
+
+   private:
+    friend class TemporalGraph;
+    const TemporalGraph* g_;
+    size_type i_;
+
+    NodeIterator(const TemporalGraph* g, size_type i) : g_(g), i_(i) {
+    }
+  };
+
+  NodeIterator node_begin() const {
+    return NodeIterator(this, 0);
+  }
+  NodeIterator node_end() const {
+    return NodeIterator(this, size());
+  }
+  node_range nodes() const {
+    return node_range(node_begin(), node_end(), size());
+  }
+
+  /** @class TemporalGraph::EdgeIterator
+   * @brief Forward iterator over the edges held, expired ones not yet
+   *        compacted included, in index order. */
+  class EdgeIterator {
+   public:
+    using value_type = Edge;
+    using pointer = Edge*;
+    using reference = Edge;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    EdgeIterator() : g_(nullptr), k_(0) {
+    }
+
+    Edge operator*() const {
+      return g_->edge(k_);
+    }
+    EdgeIterator& operator++() {
+      ++k_;
+      return *this;
+    }
+    EdgeIterator operator++(int) {
+      EdgeIterator tmp = *this;
+      ++k_;
+      return tmp;
+    }
+    bool operator==(const EdgeIterator& x) const {
+      return g_ == x.g_ && k_ == x.k_;
+    }
+    bool operator!=(const EdgeIterator& x) const {
+      return !(*this == x);
+    }
+
+   private:
+    friend class TemporalGraph;
+    const TemporalGraph* g_;
+    size_type k_;
+
+    EdgeIterator(const TemporalGraph* g, size_type k) : g_(g), k_(k) {
+    }
+  };
+
+  EdgeIterator edge_begin() const {
+    return EdgeIterator(this, 0);
+  }
+  EdgeIterator edge_end() const {
+    return EdgeIterator(this, num_edges());
+  }
+  edge_range edges() const {
+    return edge_range(edge_begin(), edge_end(), num_edges());
+  }
+
+  /** @class TemporalGraph::IncidentIterator
+   * @brief Forward iterator over a time window of one node's row. */
+  class IncidentIterator {
+   public:
+    using value_type = Edge;
+    using pointer = Edge*;
+    using reference = Edge;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    IncidentIterator() : g_(nullptr), i_(0), p_(nullptr) {
+    }
+
+    /** Return the edge, with node1() the node iterated around. */
+    Edge operator*() const {
+      return Edge(g_, i_, p_->node, p_->edge);
+    }
+    /** Return the time of the edge without forming it. */
+    time_type time() const {
+      return p_->time;
+    }
+    IncidentIterator& operator++() {
+      ++p_;
+      return *this;
+    }
+    IncidentIterator operator++(int) {
+      IncidentIterator tmp = *this;
+      ++p_;
+      return tmp;
+    }
+    bool operator==(const IncidentIterator& x) const {
+      return p_ == x.p_;
+    }
+    bool operator!=(const IncidentIterator& x) const {
+      return !(*this == x);
+    }
+
+   private:
+    friend class TemporalGraph;
+    const TemporalGraph* g_;
+    size_type i_;
+    const arc* p_;
+
+    IncidentIterator(const TemporalGraph* g, size_type i, const arc* p)
+        : g_(g), i_(i), p_(p) {
+    }
+  };
+
+ private:
+  struct edge_ends {
+    size_type a;
+    size_type b;
+    time_type time;
+  };
+
+  std::vector<Point> positions_;
+  std::vector<node_value_type> values_;
+  std::vector<edge_ends> edges_;
+  std::vector<edge_value_type> edge_values_;
+  // Per-node rows, sorted by time
+  std::vector<std::vector<arc>> rows_;
+  time_type horizon_ = -std::numeric_limits<time_type>::infinity();
+
+  std::uint64_t topology_version_ = next_topology_version();
+
+  void changed() {
+    topology_version_ = next_topology_version();
+  }
+
+  /** Insert @a x after every entry of @a row of the same or earlier time. */
+  static void insert(std::vector<arc>& row, arc x) {
+    if (row.empty() || !(x.time < row.back().time)) {
+      row.push_back(x);
+      return;
+    }
+    auto it = std::upper_bound(row.begin(), row.end(), x.time,
+        [](time_type t, const arc& y) { return t < y.time; });
+    row.insert(it, x);
+  }
+
+  /** Return the first entry of @a row at time @a t or later. */
+  static typename std::vector<arc>::const_iterator
+  lower(const std::vector<arc>& row, time_type t) {
+    return std::lower_bound(row.begin(), row.end(), t,
+        [](const arc& y, time_type v) { return y.time < v; });
+  }
+
+  typename std::vector<arc>::const_iterator
+  first_live(const std::vector<arc>& row) const {
+    return lower(row, horizon_);
+  }
+
+  incident_range window(size_type i, time_type t0, time_type t1) const {
+    const std::vector<arc>& row = rows_[i];
+    auto first = lower(row, std::max(t0, horizon_));
+    auto last = t1 <= std::max(t0, horizon_) ? first : lower(row, t1);
+    const arc* p = row.data() + (first - row.begin());
+    std::size_t n = std::size_t(last - first);
+    return incident_range(IncidentIterator(this, i, p),
+                          IncidentIterator(this, i, p + n), n);
+  }
+};
+
+#endif // CME212_TEMPORAL_GRAPH_HPP
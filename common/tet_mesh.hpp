@@ -0,0 +1,372 @@
+#ifndef CME212_TET_MESH_HPP
+#define CME212_TET_MESH_HPP
+
+/** @file tet_mesh.hpp
+ * @brief Tetrahedra on top of a Graph, with tet-to-node, tet-to-edge and
+ *        edge-to-tet tables, ingested in bulk.
+ *
+ * Loading a volume by calling add_edge() for the six sides of every
+ * tetrahedron probes the graph for each side once per tet that has it,
+ * five or six times for an interior edge. A TetMesh takes the tetrahedra
+ * in one batch instead: the sides of all of them are sorted by their
+ * canonical (smaller node, larger node) pair, bucketed by the smaller node
+ * and sorted within buckets on all threads, and only the distinct edges go
+ * to the graph, through one add_edges() call where the graph has it. The
+ * same sort numbers the mesh edges and fills the tables FEM assembly
+ * reads:
+ *
+ *   tet t        nodes(t)       its four nodes
+ *                edges(t)       its six sides, side k joining nodes
+ *                               side_nodes[k][0] and [k][1] of the tet
+ *                value(t)       per-tet data, e.g. material parameters
+ *   mesh edge e  edge_nodes(e)  its two nodes, smaller index first
+ *                tets(e)        the tets that have side e, increasing
+ *
+ *   TetMesh<G, Material> mesh(g);
+ *   load_nodes(g, "bunny.nodes");
+ *   tet_load_report r = load_mesh_tets(mesh, "bunny.tets");
+ *   std::cout << r.records_per_second() << " tets/s\n";
+ *   for (size_type t = 0; t < mesh.num_tets(); ++t)
+ *     assemble(K, mesh.nodes(t), mesh.value(t));
+ *
+ * A tet file has one "n1 n2 n3 n4" line of node indices per tetrahedron,
+ * read by graph_loader.hpp's chunked parallel parser. Mesh edges are
+ * numbered by (smaller node, larger node), as Mesh numbers triangle sides,
+ * independent of the graph's own edge order.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/graph_loader.hpp"
+#include "common/graph_range.hpp"
+#include "common/trace.hpp"
+
+
+/** What load_mesh_tets() did and how fast. */
+struct tet_load_report : load_report {
+  std::uint64_t edges = 0;        // mesh edges added by the new tets
+  double parse_seconds = 0;       // reading and parsing the file
+  double ingest_seconds = 0;      // numbering edges and adding them
+
+  /** Return the mesh edges added per second of ingest. */
+  double edges_per_second() const {
+    return ingest_seconds > 0 ? double(edges) / ingest_seconds : 0;
+  }
+};
+
+
+/** @class TetMesh
+ * @brief Tetrahedra over the nodes of a graph, with values of type T.
+ *
+ * The mesh refers to its graph, which must outlive it. Adding tets adds
+ * their sides to the graph and renumbers the mesh edges; node indices and
+ * tet indices stay as they are.
+ *
+ * @tparam G  Graph type with size(), node(), and add_edge() or
+ *            add_edges(), e.g. Graph<V, E>.
+ * @tparam T  Tet value type, default constructible.
+ */
+template <typename G, typename T = int>
+class TetMesh {
+ public:
+  /** Type of node, tet and mesh edge indices. */
+  using size_type = typename G::size_type;
+  using tet_value_type = T;
+  /** A tet as four node indices. */
+  using quad_type = std::array<size_type, 4>;
+  /** A tet as six mesh edges. */
+  using sextet_type = std::array<size_type, 6>;
+  using tet_range = GraphRange<const size_type*>;
+
+  /** The two nodes of a tet, by position in nodes(t), that side k joins. */
+  static constexpr unsigned side_nodes[6][2] = {
+      {0, 1}, {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3}};
+
+  /** Construct a mesh without tets over @a g.
+   * @param[in] threads  Threads for add_tets(); 0 means all cores */
+  explicit TetMesh(G& g, unsigned threads = 0)
+      : g_(&g), threads_(csr_snapshot::thread_count(threads)),
+        edge_start_(1, 0) {
+  }
+
+  /** Return the graph. */
+  G& graph() const {
+    return *g_;
+  }
+
+  size_type num_tets() const {
+    return size_type(nodes_.size());
+  }
+  size_type num_edges() const {
+    return size_type(edge_nodes_.size());
+  }
+
+  /** Return the nodes of tet @a t. */
+  const quad_type& nodes(size_type t) const {
+    assert(t < num_tets());
+    return nodes_[t];
+  }
+  /** Return the mesh edges of tet @a t; side k joins
+   * nodes(t)[side_nodes[k][0]] and nodes(t)[side_nodes[k][1]]. */
+  const sextet_type& edges(size_type t) const {
+    assert(t < num_tets());
+    return edges_[t];
+  }
+  /** Return the value of tet @a t. */
+  T& value(size_type t) {
+    assert(t < num_tets());
+    return values_[t];
+  }
+  const T& value(size_type t) const {
+    assert(t < num_tets());
+    return values_[t];
+  }
+
+  /** Return the nodes of every tet, num_tets() of them. */
+  const quad_type* nodes_data() const {
+    return nodes_.data();
+  }
+  /** Return the mesh edges of every tet, num_tets() of them. */
+  const sextet_type* edges_data() const {
+    return edges_.data();
+  }
+  /** Return the values of every tet, num_tets() of them. */
+  T* values_data() {
+    return values_.data();
+  }
+  const T* values_data() const {
+    return values_.data();
+  }
+
+  /** Return the two nodes of mesh edge @a e, smaller index first. */
+  const std::pair<size_type, size_type>& edge_nodes(size_type e) const {
+    assert(e < num_edges());
+    return edge_nodes_[e];
+  }
+
+  /** Return the tets with side @a e, in increasing order. */
+  tet_range tets(size_type e) const {
+    assert(e < num_edges());
+    const size_type* first = edge_tets_.data() + edge_start_[e];
+    std::size_t n = std::size_t(edge_start_[e + 1] - edge_start_[e]);
+    return tet_range(first, first + n, n);
+  }
+
+  /** Add a tet per element of [@a first, @a last), each four node indices,
+   * with value T().
+   * @return The index of the first new tet
+   *
+   * @pre Every index is less than graph().size(), no tet repeats a node,
+   *      and 6 num_tets() fits in size_type
+   * @post The new tets follow the old ones in order, and their sides are
+   *       edges of the graph
+   *
+   * All mesh edges are renumbered first, and the graph is then handed
+   * each mesh edge of a new tet once.
+   *
+   * Complexity: O(S log S) for the S = 6 num_tets() sides, spread over the
+   * threads, on top of adding the distinct new sides to the graph.
+   */
+  template <typename InputIt>
+  size_type add_tets(InputIt first, InputIt last) {
+    CME212_TRACE_SCOPE("mesh_add_tets");
+    size_type begin = num_tets();
+    for (; first != last; ++first) {
+      const auto& t = *first;
+      nodes_.push_back(quad_type{size_type(t[0]), size_type(t[1]),
+                                 size_type(t[2]), size_type(t[3])});
+    }
+    if (num_tets() == begin)
+      return begin;
+    values_.resize(nodes_.size());
+
+    number_edges();
+    // Edges with a new tet, whose tets are increasing, go to the graph
+    pairs_.clear();
+    for (size_type e = 0; e < num_edges(); ++e) {
+      if (edge_tets_[edge_start_[e + 1] - 1] >= begin)
+        pairs_.push_back(edge_nodes_[e]);
+    }
+    add_to_graph();
+    return begin;
+  }
+
+  /** Remove every tet. The graph keeps its edges. */
+  void clear() {
+    nodes_.clear();
+    edges_.clear();
+    values_.clear();
+    edge_nodes_.clear();
+    edge_start_.assign(1, 0);
+    edge_tets_.clear();
+  }
+
+ private:
+  G* g_;
+  unsigned threads_;
+  std::vector<quad_type> nodes_;
+  std::vector<sextet_type> edges_;
+  std::vector<T> values_;
+  std::vector<std::pair<size_type, size_type>> edge_nodes_;
+  // Tets of mesh edge e are edge_tets_[edge_start_[e], .. e + 1)
+  std::vector<std::size_t> edge_start_;
+  std::vector<size_type> edge_tets_;
+  // Staging for add_to_graph()
+  std::vector<std::pair<size_type, size_type>> pairs_;
+
+  /** Return the nodes of side @a s, side s % 6 of tet s / 6, smaller
+   * first. */
+  std::pair<size_type, size_type> side_ends(std::size_t s) const {
+    const quad_type& t = nodes_[s / 6];
+    size_type a = t[side_nodes[s % 6][0]], b = t[side_nodes[s % 6][1]];
+    return a < b ? std::make_pair(a, b) : std::make_pair(b, a);
+  }
+
+  /** Fill @a out with the sides of all tets, as their larger node and
+   * position 6 t + k, sorted by smaller node, larger node and position.
+   *
+   * The sides are counting sorted by their smaller node in one linear
+   * pass, and each node's short run is then sorted by the larger node on
+   * all threads, as Mesh sorts triangle sides, which takes a fraction of
+   * the time of a comparison sort of all sides. */
+  void sorted_sides(std::vector<std::pair<size_type, size_type>>& out) const {
+    std::size_t n = std::size_t(g_->size());
+    std::size_t m = 6 * nodes_.size();
+    std::vector<std::size_t> start(n + 1, 0);
+    for (const quad_type& t : nodes_) {
+      for (const unsigned* ends : side_nodes) {
+        assert(t[ends[0]] < n && t[ends[1]] < n && t[ends[0]] != t[ends[1]]);
+        ++start[std::min(t[ends[0]], t[ends[1]]) + 1];
+      }
+    }
+    for (std::size_t i = 0; i < n; ++i)
+      start[i + 1] += start[i];
+    out.resize(m);
+    {
+      std::vector<std::size_t> next(start.begin(), start.end() - 1);
+      for (std::size_t s = 0; s < m; ++s) {
+        std::pair<size_type, size_type> ends = side_ends(s);
+        out[next[ends.first]++] = {ends.second, size_type(s)};
+      }
+    }
+    csr_snapshot::parallel_ranges(threads_, n, 1024,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i)
+            std::sort(out.begin() + start[i], out.begin() + start[i + 1]);
+        });
+  }
+
+  /** Add the node pairs of pairs_ to the graph as edges. */
+  void add_to_graph() {
+    CME212_TRACE_SCOPE_N("add_edges", pairs_.size());
+    using pair_type = std::pair<size_type, size_type>;
+    if constexpr (graph_loader_detail::has_add_edges<
+                      G, typename std::vector<pair_type>::const_iterator>::
+                      value) {
+      g_->add_edges(pairs_.cbegin(), pairs_.cend());
+    } else {
+      for (const pair_type& p : pairs_)
+        g_->add_edge(g_->node(p.first), g_->node(p.second));
+    }
+  }
+
+  /** Number the distinct sides of all tets by their nodes and fill edges_
+   * and the edge-to-tet CSR arrays. A side starts a new edge where its
+   * nodes differ from the side before it; those starts are counted per
+   * thread range and offset by a prefix sum, so every range then numbers
+   * its sides on its own. */
+  void number_edges() {
+    std::vector<std::pair<size_type, size_type>> sides;
+    sorted_sides(sides);
+    std::size_t m = sides.size();
+    // Sides of one edge are adjacent and share their larger node
+    auto starts = [&](std::size_t j) {
+      return j == 0 || sides[j].first != sides[j - 1].first ||
+             side_ends(sides[j].second).first !=
+                 side_ends(sides[j - 1].second).first;
+    };
+
+    std::vector<std::size_t> counts(threads_ + 1, 0);
+    csr_snapshot::parallel_ranges(threads_, m, 6 * 1024,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          std::size_t c = 0;
+          for (std::size_t j = b; j < e; ++j)
+            c += starts(j);
+          counts[t + 1] = c;
+        });
+    for (unsigned t = 0; t < threads_; ++t)
+      counts[t + 1] += counts[t];
+    std::size_t num = counts[threads_];
+
+    edges_.resize(nodes_.size());
+    edge_nodes_.resize(num);
+    edge_start_.resize(num + 1);
+    edge_tets_.resize(m);
+    csr_snapshot::parallel_ranges(threads_, m, 6 * 1024,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          // The edge of the side before this range, if it continues here
+          std::size_t next = counts[t];
+          for (std::size_t j = b; j < e; ++j) {
+            std::size_t side = sides[j].second;
+            if (starts(j)) {
+              edge_nodes_[next] = side_ends(side);
+              edge_start_[next] = j;
+              ++next;
+            }
+            edges_[side / 6][side % 6] = size_type(next - 1);
+            edge_tets_[j] = size_type(side / 6);
+          }
+        });
+    edge_start_[num] = m;
+  }
+};
+
+template <typename G, typename T>
+constexpr unsigned TetMesh<G, T>::side_nodes[6][2];
+
+
+/** Add a tet per line of the tet file @a path to @a mesh, whose sides
+ * become edges of its graph, in one add_tets() call once the file is
+ * parsed.
+ * @return bytes, tets, distinct edges and wall times of the load
+ * @throws std::runtime_error if the file cannot be read or has a line that
+ *         is not four non-negative integers
+ *
+ * @pre Every index in the file is less than mesh.graph().size() and no
+ *      tet repeats a node
+ */
+template <typename G, typename T>
+tet_load_report load_mesh_tets(TetMesh<G, T>& mesh, const std::string& path,
+                               const load_options& opt = load_options()) {
+  using size_type = typename G::size_type;
+  CME212_TRACE_SCOPE("load_mesh_tets");
+  graph_loader_detail::chunk_reader reader(path, opt.chunk_bytes);
+  std::vector<std::array<size_type, 4>> all;
+  tet_load_report report;
+  static_cast<load_report&>(report) =
+      graph_loader_detail::pipeline<size_type, 4>(
+          reader, opt, [&](const std::vector<std::array<size_type, 4>>& recs) {
+            all.insert(all.end(), recs.begin(), recs.end());
+          });
+  report.parse_seconds = report.seconds;
+
+  auto start = std::chrono::steady_clock::now();
+  size_type old_edges = mesh.num_edges();
+  mesh.add_tets(all.begin(), all.end());
+  report.edges = mesh.num_edges() - old_edges;
+  report.ingest_seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  report.seconds += report.ingest_seconds;
+  return report;
+}
+
+#endif // CME212_TET_MESH_HPP
@@ -0,0 +1,949 @@
+#ifndef CME212_THREAD_POOL_HPP
+#define CME212_THREAD_POOL_HPP
+
+/** @file thread_pool.hpp
+ * @brief One work-stealing thread pool shared by every parallel algorithm,
+ *        and degree-aware parallel loops over a graph's nodes and edges.
+ *
+ * csr_snapshot::parallel_ranges(), which the traversals, generators,
+ * kernels and Graph-24726 all split their work with, used to start and join
+ * fresh threads on every call; a BFS paid that once per level. It now hands
+ * its ranges to the workers of ThreadPool::shared(), which stay asleep
+ * between calls. Range t of a call always goes to the same worker, so
+ * first-touch page placement (page_resource.hpp) lines up with the
+ * threads that later read the pages, especially once the pool is pinned.
+ *
+ * Loops that cannot be split evenly up front use parallel_for() instead.
+ * Every thread keeps a Chase-Lev deque of tasks (Chase and Lev, "Dynamic
+ * Circular Work-Stealing Deque", SPAA 2005, with the C11 orderings of Le,
+ * Pop, Cohen and Zappa Nardelli, PPoPP 2013). A task halves its range,
+ * pushes the upper half on its own deque and carries on with the lower
+ * half, down to the grain; an idle thread steals the oldest, largest half
+ * from another deque. parallel_for_nodes() halves by work rather than by
+ * count, taking degree + 1 per node from g.degrees() where the graph has
+ * it, so the hubs of a power-law graph end up in tasks of their own
+ * instead of behind a thread that got all of them:
+ *
+ *   ThreadPool::configure(pool_options{8, true});   // before the first use
+ *   parallel_for_nodes(g, [&](const auto& n) {
+ *     for (auto it = n.edge_begin(); it != n.edge_end(); ++it)
+ *       ...;                                          // runs on 8 threads
+ *   });
+ *   parallel_for_edges(g, [&](const auto& e) { ... });
+ *
+ * Threads that write neighboring elements of one array, e.g. node values,
+ * make a cache line they share bounce between their cores. Splitting with
+ * cache_aligned(data) only cuts ranges where a cache line of data begins,
+ * so no line is written by two tasks; a scatter-add, where every task may
+ * add to any element, goes through a ReductionBuffer, one private array
+ * per thread summed afterwards:
+ *
+ *   parallel_for_nodes(g, [&](auto n) { n.value() = ...; },
+ *                      cache_aligned(g.values_data()));
+ *   ReductionBuffer<Point> force(g.size());
+ *   parallel_for_edges(g, [&](const auto& e) {
+ *     Point* f = force.local();                      // this thread's array
+ *     f[e.node1().index()] += spring(e);
+ *     f[e.node2().index()] -= spring(e);
+ *   });
+ *   force.reduce(total);
+ *
+ * Which thread runs which edge is a matter of timing, so such sums can
+ * differ in the last bits from run to run; deterministic.hpp has
+ * counterparts that give the same bits on any thread count.
+ *
+ * A thread that waits for its loop runs other tasks meanwhile, so loops may
+ * nest. An exception thrown by the loop body is rethrown in the thread
+ * that started the loop, once the tasks already running have finished;
+ * the tasks not yet started are skipped.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "common/graph_traits.hpp"
+#include "common/trace.hpp"
+
+
+/** Configuration of a ThreadPool. */
+struct pool_options {
+  /** Threads, the calling thread included. 0 means
+   *  std::thread::hardware_concurrency(). */
+  unsigned threads = 0;
+  /** Whether to pin every worker to one core. */
+  bool pin = false;
+  /** Cores to pin to: worker w (1, 2, ...) gets cpus[(w - 1) % cpus.size()].
+   *  Empty means core w, leaving core 0 to the calling thread. */
+  std::vector<int> cpus;
+};
+
+/** Tuning knobs of parallel_for() and friends. */
+struct parallel_options {
+  /** Work below which a task is not split further: elements for
+   *  parallel_for() and parallel_for_edges(), degree + 1 per node for
+   *  parallel_for_nodes(). 0 means about 16 tasks per thread. */
+  std::size_t grain = 0;
+  /** Split only at origin + k * align for whole k, so that ranges start on
+   *  cache lines; see cache_aligned(). 1 splits anywhere. */
+  std::size_t align = 1;
+  std::size_t origin = 0;
+};
+
+/** Bytes per cache line, of the targets this is tuned for. */
+constexpr std::size_t cache_line_bytes = 64;
+
+/** Return the fewest consecutive elements of type T that start and end on
+ * cache line boundaries, given that the first one starts on one. */
+template <typename T>
+constexpr std::size_t cache_line_elements() {
+  return std::lcm(sizeof(T), cache_line_bytes) / sizeof(T);
+}
+
+/** Return options for a loop over the elements of @a data that splits it
+ * only where a cache line begins, so that no two tasks write to the same
+ * line, with @a grain as in parallel_options. If elements of @a data never
+ * start a line, the split is by cache_line_elements<T>() from index 0. */
+template <typename T>
+parallel_options cache_aligned(const T* data, std::size_t grain = 0) {
+  parallel_options opt;
+  opt.grain = grain;
+  opt.align = cache_line_elements<T>();
+  std::uintptr_t at = reinterpret_cast<std::uintptr_t>(data);
+  for (std::size_t k = 0; k < opt.align; ++k) {
+    if ((at + k * sizeof(T)) % cache_line_bytes == 0) {
+      opt.origin = k;
+      break;
+    }
+  }
+  return opt;
+}
+
+
+class ThreadPool;
+
+namespace thread_pool_detail {
+
+/** A unit of work; run() also frees it, if it was allocated. */
+struct task {
+  void (*run)(task*);
+};
+
+/** Single-producer, multi-consumer deque of tasks. The owning thread
+ * pushes and takes at the bottom; any thread steals from the top. */
+class task_deque {
+ public:
+  task_deque() : top_(0), bottom_(0), ring_(new ring(64)) {
+  }
+  ~task_deque() {
+    delete ring_.load(std::memory_order_relaxed);
+    for (ring* r : retired_)
+      delete r;
+  }
+  task_deque(const task_deque&) = delete;
+  task_deque& operator=(const task_deque&) = delete;
+
+  /** Owner only. */
+  void push(task* x) {
+    std::int64_t b = bottom_.load(std::memory_order_relaxed);
+    std::int64_t t = top_.load(std::memory_order_acquire);
+    ring* r = ring_.load(std::memory_order_relaxed);
+    if (b - t >= std::int64_t(r->size)) {
+      // Thieves may still be reading the old ring
+      retired_.push_back(r);
+      r = r->grow(t, b);
+      ring_.store(r, std::memory_order_release);
+    }
+    r->put(b, x);
+    bottom_.store(b + 1, std::memory_order_release);
+  }
+
+  /** Owner only. Return the newest task, or nullptr if there is none. */
+  task* take() {
+    std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    ring* r = ring_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_seq_cst);
+    std::int64_t t = top_.load(std::memory_order_seq_cst);
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    task* x = r->get(b);
+    if (t == b) {
+      // The last task: race the thieves for it
+      if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed))
+        x = nullptr;
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return x;
+  }
+
+  /** Any thread. Return the oldest task, or nullptr if there is none or
+   * another thread got it first. */
+  task* steal() {
+    std::int64_t t = top_.load(std::memory_order_seq_cst);
+    std::int64_t b = bottom_.load(std::memory_order_seq_cst);
+    if (t >= b)
+      return nullptr;
+    task* x = ring_.load(std::memory_order_acquire)->get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed))
+      return nullptr;
+    return x;
+  }
+
+ private:
+  struct ring {
+    explicit ring(std::size_t n) : size(n), slots(new std::atomic<task*>[n]) {
+    }
+    task* get(std::int64_t i) const {
+      return slots[std::size_t(i) & (size - 1)].load(std::memory_order_relaxed);
+    }
+    void put(std::int64_t i, task* x) {
+      slots[std::size_t(i) & (size - 1)].store(x, std::memory_order_relaxed);
+    }
+    ring* grow(std::int64_t t, std::int64_t b) const {
+      ring* r = new ring(2 * size);
+      for (std::int64_t i = t; i < b; ++i)
+        r->put(i, get(i));
+      return r;
+    }
+    std::size_t size;
+    std::unique_ptr<std::atomic<task*>[]> slots;
+  };
+
+  alignas(64) std::atomic<std::int64_t> top_;
+  alignas(64) std::atomic<std::int64_t> bottom_;
+  std::atomic<ring*> ring_;
+  std::vector<ring*> retired_;
+};
+
+/** Tasks addressed to one worker, which only it runs. */
+class mailbox {
+ public:
+  void push(task* x) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(x);
+    count_.store(tasks_.size(), std::memory_order_release);
+  }
+  task* pop() {
+    if (count_.load(std::memory_order_acquire) == 0)
+      return nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tasks_.empty())
+      return nullptr;
+    task* x = tasks_.front();
+    tasks_.erase(tasks_.begin());
+    count_.store(tasks_.size(), std::memory_order_release);
+    return x;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<task*> tasks_;
+  std::atomic<std::size_t> count_{0};
+};
+
+/** What one thread of a pool works from: a worker's for good, or a guest
+ * slot that a thread outside the pool holds while it waits for a loop. */
+struct slot {
+  explicit slot(unsigned i) : index(i) {
+  }
+  const unsigned index;        // position in the pool's slot array
+  task_deque deque;
+  mailbox inbox;
+  std::atomic<bool> taken{false};
+  std::uint32_t victim = 0;    // where the next steal attempt starts
+};
+
+/** Completion count and first error of one call. */
+struct job {
+  job(ThreadPool* p, std::size_t n) : pool(p), pending(n) {
+  }
+  bool done() const {
+    return pending.load(std::memory_order_acquire) == 0;
+  }
+  bool failed() const {
+    return has_error.load(std::memory_order_relaxed);
+  }
+  void fail(std::exception_ptr e) {
+    if (!has_error.exchange(true, std::memory_order_relaxed))
+      error = e;
+  }
+  /** Count @a n units of work as done. The job may be gone on return. */
+  inline void finish(std::size_t n);
+
+  ThreadPool* pool;
+  std::atomic<std::size_t> pending;
+  std::atomic<bool> has_error{false};
+  std::exception_ptr error;
+};
+
+/** Slot of the calling thread in @a pool, or nullptr. */
+struct current_slot {
+  const ThreadPool* pool = nullptr;
+  slot* self = nullptr;
+};
+inline current_slot& current() {
+  static thread_local current_slot c;
+  return c;
+}
+
+} // end namespace thread_pool_detail
+
+
+/** @class ThreadPool
+ * @brief Worker threads with work-stealing deques, for fork-join loops.
+ *
+ * Most code uses the process-wide ThreadPool::shared(), through
+ * csr_snapshot::parallel_ranges() or the loops below; a private pool is
+ * only needed to keep one library's work off the shared workers.
+ */
+class ThreadPool {
+ public:
+  /** Most workers a pool grows to. */
+  static constexpr unsigned max_workers = 255;
+
+  /** Start opt.threads - 1 workers; the thread that calls into the pool
+   * makes up the last one. */
+  explicit ThreadPool(const pool_options& opt = pool_options())
+      : options_(opt), slots_(guests + max_workers) {
+    for (unsigned s = 0; s < guests; ++s)
+      slots_[s].reset(new thread_pool_detail::slot(s));
+    slot_count_.store(guests, std::memory_order_release);
+    unsigned threads = opt.threads ? opt.threads
+                                   : std::thread::hardware_concurrency();
+    reserve(std::max(1u, threads));
+  }
+
+  /** Stop and join the workers. No call may still be running. */
+  ~ThreadPool() {
+    stop_.store(true, std::memory_order_release);
+    signal();
+    for (std::thread& th : threads_)
+      th.join();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /** Return the number of threads, the calling one included. */
+  unsigned size() const {
+    return workers_.load(std::memory_order_acquire) + 1;
+  }
+
+  /** Return the number of distinct slot_index() values. */
+  static constexpr unsigned num_slots() {
+    return guests + max_workers;
+  }
+
+  /** Return an index of the calling thread, less than num_slots(), that no
+   * other thread running work of this pool has at the same time; or
+   * num_slots() if the thread runs no work of this pool. Inside a loop
+   * body it tells apart the threads of the loop, e.g. to pick a private
+   * buffer, as ReductionBuffer does.
+   * Complexity: O(1). */
+  unsigned slot_index() const {
+    const thread_pool_detail::current_slot& c = thread_pool_detail::current();
+    return c.pool == this && c.self != nullptr ? c.self->index : num_slots();
+  }
+
+  /** Start workers until size() >= @a threads, up to max_workers. */
+  void reserve(unsigned threads) {
+    if (threads <= size())
+      return;
+    std::lock_guard<std::mutex> lock(grow_mutex_);
+    unsigned have = workers_.load(std::memory_order_relaxed);
+    unsigned want = std::min(threads - 1, max_workers);
+    for (unsigned w = have + 1; w <= want; ++w) {
+      slots_[guests + w - 1].reset(new thread_pool_detail::slot(guests + w - 1));
+      slot_count_.store(guests + w, std::memory_order_release);
+      threads_.emplace_back([this, w] { work(w); });
+    }
+    if (want > have)
+      workers_.store(want, std::memory_order_release);
+  }
+
+  /** Call fn(t) for every t < @a k, each as if on its own thread: the
+   * calling thread runs t = 0 and worker t the others (wrapping around
+   * past max_workers). The pool grows to @a k threads if it is smaller.
+   * Returns once every call has returned.
+   * @throws whatever the first failing fn(t) threw */
+  template <typename Fn>
+  void run_ranges(unsigned k, Fn&& fn) {
+    if (k <= 1) {
+      if (k == 1)
+        fn(0u);
+      return;
+    }
+    guest_scope scope(*this);
+    if (scope.self == nullptr) {
+      for (unsigned t = 0; t < k; ++t)
+        fn(t);
+      return;
+    }
+    // A worker calling in keeps its own index out of the rotation
+    unsigned caller = scope.worker;
+    reserve(k + (caller != 0));
+    unsigned workers = workers_.load(std::memory_order_acquire);
+
+    using fn_type = std::remove_reference_t<Fn>;
+    struct range_task : thread_pool_detail::task {
+      fn_type* fn;
+      thread_pool_detail::job* owner;
+      unsigned t;
+      static void call(thread_pool_detail::task* p) {
+        range_task* r = static_cast<range_task*>(p);
+        thread_pool_detail::job* j = r->owner;
+        if (!j->failed()) {
+          try {
+            CME212_TRACE_SCOPE_N("range", r->t);
+            (*r->fn)(r->t);
+          } catch (...) {
+            j->fail(std::current_exception());
+          }
+        }
+        j->finish(1);
+      }
+    };
+    thread_pool_detail::job j(this, k - 1);
+    std::vector<range_task> tasks(k - 1);
+    for (unsigned t = 1; t < k; ++t) {
+      range_task& r = tasks[t - 1];
+      r.run = &range_task::call;
+      r.fn = &fn;
+      r.owner = &j;
+      r.t = t;
+      unsigned w = (caller + t - 1) % workers + 1;
+      if (w == caller)
+        w = w % workers + 1;
+      slots_[guests + w - 1]->inbox.push(&r);
+    }
+    signal();
+    try {
+      CME212_TRACE_SCOPE_N("range", 0);
+      fn(0u);
+    } catch (...) {
+      j.fail(std::current_exception());
+    }
+    CME212_TRACE_SCOPE("wait");
+    wait(scope.self, &j);
+    if (j.error)
+      std::rethrow_exception(j.error);
+  }
+
+  /** Call fn(b, e) on disjoint ranges [b, e) that together cover [0, n),
+   * splitting them by work stealing down to opt.grain elements.
+   * @throws whatever the first failing fn threw */
+  template <typename Fn>
+  void parallel_for(std::size_t n, Fn&& fn,
+                    const parallel_options& opt = parallel_options()) {
+    split(nullptr, n, fn, opt);
+  }
+
+  /** As parallel_for(n, fn, opt), but element i costs
+   * cost[i + 1] - cost[i], and ranges are halved by cost.
+   * @pre @a cost has n + 1 nondecreasing entries */
+  template <typename Fn>
+  void parallel_for(const std::size_t* cost, std::size_t n, Fn&& fn,
+                    const parallel_options& opt = parallel_options()) {
+    split(cost, n, fn, opt);
+  }
+
+  /** Return the pool that csr_snapshot::parallel_ranges() and the loops
+   * below run on, made on first use from the options last given to
+   * configure(). */
+  static ThreadPool& shared() {
+    ThreadPool* p = shared_state().pool.load(std::memory_order_acquire);
+    if (p != nullptr)
+      return *p;
+    std::lock_guard<std::mutex> lock(shared_state().mutex);
+    if (!shared_state().owner)
+      shared_state().owner.reset(new ThreadPool(shared_state().options));
+    shared_state().pool.store(shared_state().owner.get(),
+                              std::memory_order_release);
+    return *shared_state().owner;
+  }
+
+  /** Set the options of shared(), replacing the pool if it was already
+   * made. Call it at startup, before anything runs on the pool. */
+  static void configure(const pool_options& opt) {
+    std::lock_guard<std::mutex> lock(shared_state().mutex);
+    shared_state().options = opt;
+    shared_state().pool.store(nullptr, std::memory_order_release);
+    shared_state().owner.reset();
+  }
+
+  /** Pin the calling thread to core @a cpu. Return false where that is not
+   * supported or the core is not available. */
+  static bool pin_this_thread(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+      return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+  }
+
+ private:
+  friend struct thread_pool_detail::job;
+
+  /** Slots for threads outside the pool that wait for a loop. */
+  static constexpr unsigned guests = 16;
+  /** Failed searches for work before a thread goes to sleep. */
+  static constexpr unsigned spins = 64;
+
+  struct shared_holder {
+    std::mutex mutex;
+    pool_options options;
+    std::unique_ptr<ThreadPool> owner;
+    std::atomic<ThreadPool*> pool{nullptr};
+  };
+  static shared_holder& shared_state() {
+    static shared_holder s;
+    return s;
+  }
+
+  /** The slot of the calling thread for the duration of one call: its own
+   * if it is a worker or already inside a call, else a free guest slot. */
+  struct guest_scope {
+    explicit guest_scope(ThreadPool& p) {
+      thread_pool_detail::current_slot& c = thread_pool_detail::current();
+      if (c.pool == &p) {
+        self = c.self;
+        worker = p.worker_index(self);
+        return;
+      }
+      for (unsigned s = 0; s < guests; ++s) {
+        thread_pool_detail::slot* g = p.slots_[s].get();
+        if (!g->taken.exchange(true, std::memory_order_acquire)) {
+          saved = c;
+          c.pool = &p;
+          c.self = g;
+          self = g;
+          guest = &g->taken;
+          return;
+        }
+      }
+    }
+    ~guest_scope() {
+      if (guest != nullptr) {
+        guest->store(false, std::memory_order_release);
+        thread_pool_detail::current() = saved;
+      }
+    }
+    guest_scope(const guest_scope&) = delete;
+    guest_scope& operator=(const guest_scope&) = delete;
+
+    thread_pool_detail::slot* self = nullptr;
+    unsigned worker = 0;                   // 1, 2, ... or 0 for a guest
+    std::atomic<bool>* guest = nullptr;    // the taken flag to release
+    thread_pool_detail::current_slot saved;
+  };
+
+  unsigned worker_index(const thread_pool_detail::slot* s) const {
+    for (unsigned w = 1; w <= workers_.load(std::memory_order_acquire); ++w)
+      if (slots_[guests + w - 1].get() == s)
+        return w;
+    return 0;
+  }
+
+  /** Body of worker @a w. */
+  void work(unsigned w) {
+    if (options_.pin) {
+      int cpu = options_.cpus.empty()
+                    ? int(w)
+                    : options_.cpus[(w - 1) % options_.cpus.size()];
+      pin_this_thread(cpu);
+    }
+    thread_pool_detail::slot* self = slots_[guests + w - 1].get();
+    thread_pool_detail::current() = thread_pool_detail::current_slot{this, self};
+    wait(self, nullptr);
+  }
+
+  /** Wake every sleeping thread to look for work or check its job. */
+  void signal() {
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) != 0) {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      wake_.notify_all();
+    }
+  }
+
+  /** Return a task for @a self: addressed to it, pushed by it, or stolen. */
+  thread_pool_detail::task* find(thread_pool_detail::slot* self) {
+    if (thread_pool_detail::task* x = self->inbox.pop())
+      return x;
+    if (thread_pool_detail::task* x = self->deque.take())
+      return x;
+    unsigned n = slot_count_.load(std::memory_order_acquire);
+    for (unsigned i = 0; i < n; ++i) {
+      thread_pool_detail::slot* v = slots_[(self->victim + i) % n].get();
+      if (v == self)
+        continue;
+      if (thread_pool_detail::task* x = v->deque.steal()) {
+        self->victim = (self->victim + i) % n;
+        return x;
+      }
+    }
+    return nullptr;
+  }
+
+  /** Run tasks until @a j is done, or until the pool stops if @a j is
+   * nullptr, sleeping whenever there are none. */
+  void wait(thread_pool_detail::slot* self, thread_pool_detail::job* j) {
+    auto finished = [&] {
+      return j ? j->done() : stop_.load(std::memory_order_acquire);
+    };
+    unsigned idle = 0;
+    while (!finished()) {
+      if (thread_pool_detail::task* x = find(self)) {
+        x->run(x);
+        idle = 0;
+        continue;
+      }
+      if (++idle < spins) {
+        std::this_thread::yield();
+        continue;
+      }
+      // Everything that could end the wait bumps the epoch after making
+      // itself visible, so a change of epoch after this read is not missed
+      std::uint64_t seen = epoch_.load(std::memory_order_seq_cst);
+      if (finished())
+        break;
+      if (thread_pool_detail::task* x = find(self)) {
+        x->run(x);
+        idle = 0;
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(sleep_mutex_);
+      sleepers_.fetch_add(1, std::memory_order_seq_cst);
+      wake_.wait(lock, [&] {
+        return epoch_.load(std::memory_order_seq_cst) != seen;
+      });
+      sleepers_.fetch_sub(1, std::memory_order_relaxed);
+      idle = 0;
+    }
+  }
+
+  /** Shared state of one parallel_for(). */
+  template <typename Fn>
+  struct split_job {
+    ThreadPool* pool;
+    thread_pool_detail::job* owner;
+    const std::size_t* cost;
+    std::size_t grain;
+    std::size_t align;
+    std::size_t origin;
+    Fn* fn;
+
+    std::size_t weight(std::size_t b, std::size_t e) const {
+      return cost ? cost[e] - cost[b] : e - b;
+    }
+    /** Split point of [b, e) that halves its weight, strictly inside;
+     * e if no allowed split point is. */
+    std::size_t middle(std::size_t b, std::size_t e) const {
+      std::size_t m;
+      if (!cost) {
+        m = b + (e - b) / 2;
+      } else {
+        std::size_t half = cost[b] + (cost[e] - cost[b]) / 2;
+        m = std::size_t(std::upper_bound(cost + b + 1, cost + e, half) - cost);
+        m = std::min(std::max(m, b + 1), e - 1);
+      }
+      if (align <= 1)
+        return m;
+      // The allowed point at or below m, else the first one above b
+      std::size_t k = m < origin ? origin : m - (m - origin) % align;
+      if (k <= b)
+        k = b < origin ? origin : b + align - (b - origin) % align;
+      return std::min(k, e);
+    }
+  };
+
+  /** A stolen or pushed half of a parallel_for(). */
+  template <typename Fn>
+  struct split_task : thread_pool_detail::task {
+    split_job<Fn>* job;
+    std::size_t b, e;
+    static void call(thread_pool_detail::task* p) {
+      split_task* s = static_cast<split_task*>(p);
+      split_job<Fn>* sj = s->job;
+      std::size_t b = s->b, e = s->e;
+      delete s;
+      sj->pool->run_piece(thread_pool_detail::current().self, *sj, b, e);
+    }
+  };
+
+  /** Run [b, e) of @a sj on the thread of @a self, pushing the upper half
+   * for thieves until what is left weighs at most the grain. */
+  template <typename Fn>
+  void run_piece(thread_pool_detail::slot* self, split_job<Fn>& sj,
+                 std::size_t b, std::size_t e) {
+    while (e - b > 1 && sj.weight(b, e) > sj.grain) {
+      std::size_t m = sj.middle(b, e);
+      if (m == e)
+        break;
+      split_task<Fn>* half = new split_task<Fn>();
+      half->run = &split_task<Fn>::call;
+      half->job = &sj;
+      half->b = m;
+      half->e = e;
+      self->deque.push(half);
+      signal();
+      e = m;
+    }
+    thread_pool_detail::job* j = sj.owner;
+    if (!j->failed()) {
+      try {
+        CME212_TRACE_SCOPE_N("chunk", e - b);
+        (*sj.fn)(b, e);
+      } catch (...) {
+        j->fail(std::current_exception());
+      }
+    }
+    j->finish(e - b);
+  }
+
+  template <typename Fn>
+  void split(const std::size_t* cost, std::size_t n, Fn& fn,
+             const parallel_options& opt) {
+    if (n == 0)
+      return;
+    std::size_t total = cost ? cost[n] - cost[0] : n;
+    std::size_t grain = opt.grain ? opt.grain
+                                  : std::max<std::size_t>(1, total / (16 * size()));
+    guest_scope scope(*this);
+    if (size() == 1 || total <= grain || scope.self == nullptr) {
+      fn(std::size_t(0), n);
+      return;
+    }
+    thread_pool_detail::job j(this, n);
+    split_job<Fn> sj{this, &j, cost, grain, std::max<std::size_t>(opt.align, 1),
+                     opt.origin, &fn};
+    run_piece(scope.self, sj, 0, n);
+    CME212_TRACE_SCOPE("wait");
+    wait(scope.self, &j);
+    if (j.error)
+      std::rethrow_exception(j.error);
+  }
+
+  pool_options options_;
+  // Guest slots first, then one per worker; entries are set once, before
+  // slot_count_ covers them, and never moved
+  std::vector<std::unique_ptr<thread_pool_detail::slot>> slots_;
+  std::atomic<unsigned> slot_count_{0};
+  std::atomic<unsigned> workers_{0};
+  std::vector<std::thread> threads_;
+  std::mutex grow_mutex_;
+
+  std::atomic<bool> stop_{false};
+  std::atomic<std::uint64_t> epoch_{0};
+  std::atomic<unsigned> sleepers_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+};
+
+inline void thread_pool_detail::job::finish(std::size_t n) {
+  ThreadPool* p = pool;
+  if (pending.fetch_sub(n, std::memory_order_acq_rel) == n)
+    p->signal();
+}
+
+
+namespace thread_pool_detail {
+
+template <typename G, typename = void>
+struct has_node_tombstones : std::false_type {};
+template <typename G>
+struct has_node_tombstones<G, std::void_t<
+    decltype(std::declval<const G&>().num_removed_nodes()),
+    decltype(std::declval<const G&>().is_removed(
+        std::declval<const G&>().node(0)))>> : std::true_type {};
+
+template <typename G, typename = void>
+struct has_edge_tombstones : std::false_type {};
+template <typename G>
+struct has_edge_tombstones<G, std::void_t<
+    decltype(std::declval<const G&>().num_removed_edges()),
+    decltype(std::declval<const G&>().is_removed(
+        std::declval<const G&>().edge(0)))>> : std::true_type {};
+
+} // end namespace thread_pool_detail
+
+
+/** Call fn(i) for every i < @a n on ThreadPool::shared().
+ * Complexity: O(n) calls, spread over the pool. */
+template <typename Fn>
+void parallel_for(std::size_t n, Fn fn,
+                  const parallel_options& opt = parallel_options()) {
+  ThreadPool::shared().parallel_for(n, [&](std::size_t b, std::size_t e) {
+    for (std::size_t i = b; i < e; ++i)
+      fn(i);
+  }, opt);
+}
+
+/** Call fn(n) for every node n of @a g, in parallel on
+ * ThreadPool::shared().
+ *
+ * On graphs with degrees() (hw1/Graph-24726.hpp), ranges of nodes are
+ * halved at equal sums of degree + 1, so a loop over each node's incident
+ * edges is spread evenly even when a few nodes hold most of the edges;
+ * the degrees are summed once up front, in O(g.size()). Other graphs are
+ * split by node count. Nodes removed by lazy_remove_node() are skipped.
+ *
+ * @pre @a fn may run concurrently on different nodes, and does not modify
+ *      the graph
+ */
+template <typename G, typename Fn>
+void parallel_for_nodes(const G& g, Fn fn,
+                        const parallel_options& opt = parallel_options()) {
+  using size_type = typename G::size_type;
+  std::size_t n = std::size_t(g.size());
+  auto body = [&](std::size_t b, std::size_t e) {
+    for (std::size_t i = b; i < e; ++i) {
+      auto node = g.node(size_type(i));
+      if constexpr (thread_pool_detail::has_node_tombstones<G>::value) {
+        if (g.num_removed_nodes() != 0 && g.is_removed(node))
+          continue;
+      }
+      fn(node);
+    }
+  };
+  if constexpr (graph_traits::has_degree_array<G>::value) {
+    const auto* degree = g.degrees();
+    std::vector<std::size_t> cost(n + 1);
+    cost[0] = 0;
+    for (std::size_t i = 0; i < n; ++i)
+      cost[i + 1] = cost[i] + std::size_t(degree[i]) + 1;
+    ThreadPool::shared().parallel_for(cost.data(), n, body, opt);
+  } else {
+    ThreadPool::shared().parallel_for(n, body, opt);
+  }
+}
+
+/** Call fn(e) for every edge e of @a g, g.edge(0) .. g.edge(num_edges() - 1),
+ * in parallel on ThreadPool::shared(). Edges removed by lazy_remove_edge()
+ * are skipped.
+ *
+ * @pre @a fn may run concurrently on different edges, and does not modify
+ *      the graph
+ */
+template <typename G, typename Fn>
+void parallel_for_edges(const G& g, Fn fn,
+                        const parallel_options& opt = parallel_options()) {
+  using size_type = typename G::size_type;
+  ThreadPool::shared().parallel_for(std::size_t(g.num_edges()),
+      [&](std::size_t b, std::size_t e) {
+        for (std::size_t k = b; k < e; ++k) {
+          auto edge = g.edge(size_type(k));
+          if constexpr (thread_pool_detail::has_edge_tombstones<G>::value) {
+            if (g.num_removed_edges() != 0 && g.is_removed(edge))
+              continue;
+          }
+          fn(edge);
+        }
+      }, opt);
+}
+
+
+/** @class ReductionBuffer
+ * @brief One private array of n values of type T per thread of a loop,
+ *        for scatter-adds, summed into one array afterwards.
+ *
+ * Inside a loop body on the pool, local() returns the calling thread's
+ * array, made and zeroed the first time that thread asks for it, so the
+ * writes of different threads never share a cache line and need no
+ * atomics. reduce() then adds the arrays of every thread that asked into
+ * an output array, in parallel over slices of it, and zeroes them for the
+ * next loop. Costs n values of memory per thread that used it.
+ *
+ * @tparam T  Value type with T() as zero and +=.
+ */
+template <typename T>
+class ReductionBuffer {
+ public:
+  /** Make arrays of @a n values for the threads of @a pool. */
+  explicit ReductionBuffer(std::size_t n,
+                           ThreadPool& pool = ThreadPool::shared())
+      : pool_(&pool), n_(n), rows_(ThreadPool::num_slots() + 1) {
+  }
+
+  /** Return the number of values per array. */
+  std::size_t size() const {
+    return n_;
+  }
+
+  /** Return the calling thread's array of size() values.
+   * @pre Called from a loop body running on the pool, or from outside any
+   *      loop, which counts as one more thread
+   * Complexity: O(1), and O(size()) on a thread's first call. */
+  T* local() {
+    // Outside a loop, slot_index() is num_slots(): the last array
+    std::unique_ptr<std::vector<T>>& r = rows_[pool_->slot_index()];
+    if (!r)
+      r.reset(new std::vector<T>(n_, T()));
+    return r->data();
+  }
+
+  /** Set out[i] += the sum of entry i of every thread's array, for every
+   * i < size(), and zero the arrays.
+   * @param[in] threads  Threads to add with; 0 means the pool's size
+   * Not for use concurrently with writes to the arrays.
+   * Complexity: O(size() * threads that wrote), spread over the threads. */
+  void reduce(T* out, unsigned threads = 0) {
+    CME212_TRACE_SCOPE_N("reduce", n_);
+    std::vector<T*> used;
+    for (std::unique_ptr<std::vector<T>>& r : rows_) {
+      if (r)
+        used.push_back(r->data());
+    }
+    if (threads == 0)
+      threads = pool_->size();
+    std::size_t blocks = (n_ + grain - 1) / grain;
+    threads = unsigned(std::max<std::size_t>(
+        1, std::min<std::size_t>(threads, blocks)));
+    pool_->run_ranges(threads, [&](unsigned t) {
+      std::size_t b = std::min(n_, blocks * t / threads * grain);
+      std::size_t e = std::min(n_, blocks * (t + 1) / threads * grain);
+      for (T* values : used) {
+        for (std::size_t i = b; i < e; ++i) {
+          out[i] += values[i];
+          values[i] = T();
+        }
+      }
+    });
+  }
+
+ private:
+  // Slices of reduce() are whole cache lines of out
+  static constexpr std::size_t grain = 16 * cache_line_elements<T>();
+
+  ThreadPool* pool_;
+  std::size_t n_;
+  // Array of each slot_index(), allocated by the thread that uses it
+  std::vector<std::unique_ptr<std::vector<T>>> rows_;
+};
+
+#endif // CME212_THREAD_POOL_HPP
@@ -0,0 +1,194 @@
+#ifndef CME212_TRACE_HPP
+#define CME212_TRACE_HPP
+
+/** @file trace.hpp
+ * @brief Scoped timeline spans for graph operations, written as Chrome
+ *        trace JSON for chrome://tracing or ui.perfetto.dev.
+ *
+ * Bulk loads, freeze() and compact(), reorder(), the algorithms in common/
+ * and every range and chunk of ThreadPool::shared() open a span with
+ * CME212_TRACE_SCOPE. The macro compiles to nothing unless the build has
+ * -DCME212_TRACE=1, so untraced builds pay nothing. In a traced build:
+ *
+ *   load_triangles(g, "mesh.tri");
+ *   g.freeze();
+ *   core_numbers(g, core);
+ *   graph_trace::write_chrome_json("run.json");   // open in ui.perfetto.dev
+ *
+ * shows one row per thread, with the pool workers' chunks under the phase
+ * that spawned them and the gaps where a thread waited. Each thread
+ * appends to its own buffer, so spans cost two clock reads and no lock;
+ * the buffers outlive their threads. graph_trace::write_chrome_json() and
+ * clear() must not run while traced work does.
+ *
+ * Untraced builds keep graph_trace::, writing an empty trace.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef CME212_TRACE
+#define CME212_TRACE 0
+#endif
+
+#define CME212_TRACE_CAT2(a, b) a##b
+#define CME212_TRACE_CAT(a, b) CME212_TRACE_CAT2(a, b)
+
+#if CME212_TRACE
+/** Record a span named @a name, a string literal, from here to the end of
+ *  the enclosing block. */
+#define CME212_TRACE_SCOPE(name) \
+  graph_trace::scope CME212_TRACE_CAT(cme212_trace_, __LINE__)(name)
+/** As CME212_TRACE_SCOPE, with an integer @a n (an index or a size) shown
+ *  among the span's arguments. */
+#define CME212_TRACE_SCOPE_N(name, n) \
+  graph_trace::scope CME212_TRACE_CAT(cme212_trace_, __LINE__)( \
+      name, std::int64_t(n))
+#else
+#define CME212_TRACE_SCOPE(name) ((void)0)
+#define CME212_TRACE_SCOPE_N(name, n) ((void)0)
+#endif
+
+
+namespace graph_trace {
+
+/** One finished span. */
+struct span {
+  const char* name;
+  std::int64_t begin;   // ns since the trace epoch
+  std::int64_t end;
+  std::int64_t n;       // argument, or -1
+};
+
+namespace detail {
+
+/** Spans of one thread, numbered in the order threads first traced. */
+struct buffer {
+  unsigned tid;
+  std::vector<span> spans;
+};
+
+struct registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<buffer>> buffers;
+  std::chrono::steady_clock::time_point epoch =
+      std::chrono::steady_clock::now();
+};
+
+inline registry& state() {
+  static registry r;
+  return r;
+}
+
+inline buffer& local() {
+  thread_local buffer* b = nullptr;
+  if (b == nullptr) {
+    registry& r = state();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.buffers.emplace_back(new buffer{unsigned(r.buffers.size()), {}});
+    b = r.buffers.back().get();
+  }
+  return *b;
+}
+
+inline std::int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - state().epoch).count();
+}
+
+/** @a ns as microseconds with three decimals, e.g. "1234.567". */
+inline std::string micros(std::int64_t ns) {
+  std::string frac = std::to_string(1000 + ns % 1000);
+  return std::to_string(ns / 1000) + "." + frac.substr(1);
+}
+
+} // end namespace detail
+
+/** @class scope
+ * @brief Records the span from its construction to its destruction on the
+ *        calling thread; made by CME212_TRACE_SCOPE.
+ */
+class scope {
+ public:
+  explicit scope(const char* name, std::int64_t n = -1)
+      : name_(name), n_(n), begin_(detail::now()) {
+  }
+  scope(const scope&) = delete;
+  scope& operator=(const scope&) = delete;
+  ~scope() {
+    std::int64_t end = detail::now();
+    detail::local().spans.push_back(span{name_, begin_, end, n_});
+  }
+
+ private:
+  const char* name_;
+  std::int64_t n_;
+  std::int64_t begin_;
+};
+
+/** Return the number of spans recorded so far. */
+inline std::size_t size() {
+  detail::registry& r = detail::state();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  std::size_t n = 0;
+  for (const auto& b : r.buffers)
+    n += b->spans.size();
+  return n;
+}
+
+/** Drop every recorded span. */
+inline void clear() {
+  detail::registry& r = detail::state();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  for (const auto& b : r.buffers)
+    b->spans.clear();
+}
+
+/** Write every recorded span to @a out as a Chrome trace: a JSON array of
+ * complete ("X") events in microseconds, one tid per thread. */
+inline void write_chrome_json(std::ostream& out) {
+  detail::registry& r = detail::state();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  out << "[";
+  const char* sep = "\n";
+  for (const auto& b : r.buffers) {
+    out << sep << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+        << b->tid << ",\"args\":{\"name\":\"thread " << b->tid << "\"}}";
+    sep = ",\n";
+    for (const span& s : b->spans) {
+      // Names are string literals from CME212_TRACE_SCOPE, so need no
+      // escaping
+      out << sep << "{\"name\":\"" << s.name << "\",\"ph\":\"X\",\"pid\":1"
+          << ",\"tid\":" << b->tid
+          << ",\"ts\":" << detail::micros(s.begin)
+          << ",\"dur\":" << detail::micros(s.end - s.begin);
+      if (s.n >= 0)
+        out << ",\"args\":{\"n\":" << s.n << "}";
+      out << "}";
+    }
+  }
+  out << "\n]\n";
+}
+
+/** Write the trace to the file @a path.
+ * @throws std::runtime_error if it cannot be written */
+inline void write_chrome_json(const std::string& path) {
+  std::ofstream out(path);
+  if (!out)
+    throw std::runtime_error("graph_trace: cannot open " + path);
+  write_chrome_json(out);
+  if (!out)
+    throw std::runtime_error("graph_trace: failed writing " + path);
+}
+
+} // end namespace graph_trace
+
+#endif // CME212_TRACE_HPP
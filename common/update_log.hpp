@@ -0,0 +1,362 @@
+#ifndef CME212_UPDATE_LOG_HPP
+#define CME212_UPDATE_LOG_HPP
+
+/** @file update_log.hpp
+ * @brief A lock-free log of node and edge inserts from a stream, applied
+ *        to a Graph in batches.
+ *
+ * Applying a stream one add_node() or add_edge() at a time leaves nothing
+ * to batch: every call looks up its edge and grows two adjacency rows on
+ * its own. An UpdateLog takes the stream instead, from any number of
+ * producer threads, and the consumer applies whatever has arrived in one
+ * batch:
+ *
+ *   UpdateLog<G> log(g, producers);
+ *   // producer thread t
+ *   auto i = log.add_node(t, p);
+ *   log.add_edge(t, i, j);
+ *   // consumer, once per frame or every few milliseconds
+ *   update_report r = apply_updates(g, log.take(), index);
+ *
+ * apply_updates() adds the batch's nodes with one add_nodes() call and its
+ * edges with one add_edges() call where the graph has them
+ * (hw1/Graph-24726.hpp), which sorts the edges by source, drops those the
+ * adjacency already holds and appends the rest in bulk. The same pass
+ * refreshes a SpatialIndex for the new nodes and, optionally, the frozen
+ * CSR layout; degrees are kept by the graph itself.
+ *
+ * Every producer owns a slot, as in ConcurrentGraphBuilder, but here the
+ * slot is a single-producer single-consumer queue, so take() may run while
+ * producers keep appending.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/spatial_index.hpp"
+#include "common/trace.hpp"
+#include "CME212/Point.hpp"
+
+
+/** Nodes and edges taken from an UpdateLog in one batch.
+ * @tparam S  Node index type.
+ */
+template <typename S>
+struct update_batch {
+  /** Index the first node of @a positions gets. */
+  S first_node = 0;
+  /** Positions of the new nodes, in index order. */
+  std::vector<Point> positions;
+  /** Edges as (smaller index, larger index), in arrival order per slot;
+   * repeats included. */
+  std::vector<std::pair<S, S>> edges;
+
+  bool empty() const {
+    return positions.empty() && edges.empty();
+  }
+};
+
+/** Options of apply_updates(). */
+struct update_options {
+  /** Call the graph's freeze() after the batch, if it has one. */
+  bool freeze = false;
+};
+
+/** What apply_updates() did. */
+struct update_report {
+  std::size_t nodes = 0;        // nodes added
+  std::size_t edges = 0;        // edges in the batch, repeats included
+  std::size_t new_edges = 0;    // edges the graph did not have yet
+};
+
+
+namespace update_log_detail {
+
+template <typename G, typename It, typename = void>
+struct has_add_nodes : std::false_type {};
+template <typename G, typename It>
+struct has_add_nodes<G, It, decltype(void(std::declval<G&>().add_nodes(
+    std::declval<It>(), std::declval<It>())))> : std::true_type {};
+
+template <typename G, typename It, typename = void>
+struct has_add_edges : std::false_type {};
+template <typename G, typename It>
+struct has_add_edges<G, It, decltype(void(std::declval<G&>().add_edges(
+    std::declval<It>(), std::declval<It>())))> : std::true_type {};
+
+template <typename G, typename = void>
+struct has_freeze : std::false_type {};
+template <typename G>
+struct has_freeze<G, std::void_t<decltype(std::declval<G&>().freeze())>>
+    : std::true_type {};
+
+} // end namespace update_log_detail
+
+
+/** @class UpdateLog
+ * @brief Node and edge inserts for a graph, appended concurrently and
+ *        taken in batches.
+ *
+ * Slot t may only be appended to by one thread at a time; different slots
+ * may be used at once, and take() may run concurrently with all of them.
+ * take() itself is for one consumer thread. Node indices are handed out
+ * in the order producers claim them, continuing after the nodes the graph
+ * had when the log was made.
+ *
+ * @tparam G  Graph type with size_type, used to apply the batches.
+ */
+template <typename G>
+class UpdateLog {
+ public:
+  using size_type = typename G::size_type;
+  using batch_type = update_batch<size_type>;
+
+  /** Log inserts for @a g from up to @a producers threads.
+   * @param[in] producers  Number of slots; 0 means one per core
+   *
+   * Every batch must be applied to @a g before the next is taken.
+   */
+  explicit UpdateLog(const G& g, unsigned producers = 0)
+      : next_(size_type(g.size())), taken_(size_type(g.size())),
+        slots_(csr_snapshot::thread_count(producers)) {
+  }
+
+  UpdateLog(const UpdateLog&) = delete;
+  UpdateLog& operator=(const UpdateLog&) = delete;
+
+  ~UpdateLog() {
+    for (slot& s : slots_) {
+      chunk* c = s.reader.head;
+      while (c != nullptr) {
+        chunk* next = c->next.load(std::memory_order_relaxed);
+        delete c;
+        c = next;
+      }
+    }
+  }
+
+  /** Return the number of slots. */
+  unsigned num_slots() const {
+    return unsigned(slots_.size());
+  }
+
+  /** Log a node at @a position from slot @a t.
+   * @return The index the node will have in the graph
+   *
+   * Complexity: O(1) amortized, one atomic increment and no locks.
+   */
+  size_type add_node(unsigned t, const Point& position) {
+    size_type i = next_.fetch_add(1, std::memory_order_relaxed);
+    append(t, op{i, i, position});
+    return i;
+  }
+
+  /** Log the edge between nodes @a a and @a b from slot @a t.
+   * @pre @a a != @a b, and both are nodes of the graph or were returned by
+   *      add_node()
+   *
+   * Complexity: O(1) amortized, and no locks.
+   */
+  void add_edge(unsigned t, size_type a, size_type b) {
+    assert(a != b);
+    append(t, op{std::min(a, b), std::max(a, b), Point()});
+  }
+
+  /** Take everything logged since the last take() that can be applied.
+   *
+   * A node whose index follows one that some producer has claimed but not
+   * logged yet, and every edge touching such a node, stays in the log for
+   * a later take(), so every batch extends the graph's nodes without gaps.
+   *
+   * Complexity: O(k) for the k inserts taken or held back.
+   */
+  batch_type take() {
+    CME212_TRACE_SCOPE("update_log_take");
+    for (slot& s : slots_)
+      drain(s.reader);
+
+    batch_type batch;
+    batch.first_node = taken_;
+    std::sort(nodes_.begin(), nodes_.end(),
+              [](const op& x, const op& y) { return x.a < y.a; });
+    std::size_t n = 0;
+    while (n < nodes_.size() && nodes_[n].a == taken_ + n)
+      ++n;
+    batch.positions.reserve(n);
+    for (std::size_t k = 0; k < n; ++k)
+      batch.positions.push_back(nodes_[k].position);
+    nodes_.erase(nodes_.begin(), nodes_.begin() + n);
+    taken_ += size_type(n);
+
+    std::size_t held = 0;
+    batch.edges.reserve(edges_.size());
+    for (const op& e : edges_) {
+      if (e.b < taken_)
+        batch.edges.emplace_back(e.a, e.b);
+      else
+        edges_[held++] = e;
+    }
+    edges_.resize(held);
+    return batch;
+  }
+
+  /** Return the number of inserts held back by take() so far. */
+  std::size_t num_held() const {
+    return nodes_.size() + edges_.size();
+  }
+
+ private:
+  // A node (a == b, its index) or an edge (a < b)
+  struct op {
+    size_type a;
+    size_type b;
+    Point position;
+  };
+
+  static constexpr std::uint32_t chunk_size = 1024;
+
+  // Slots are singly linked lists of chunks. The producer fills the chunk
+  // at the tail and publishes each op by storing size with release; the
+  // consumer reads up to size with acquire and frees a chunk once it is
+  // full, read and followed by another, so the producer never touches it
+  struct chunk {
+    op ops[chunk_size];
+    std::atomic<std::uint32_t> size{0};
+    std::atomic<chunk*> next{nullptr};
+  };
+
+  // The producer's and the consumer's ends, on separate cache lines
+  struct alignas(64) writer_end {
+    chunk* tail = nullptr;
+  };
+  struct alignas(64) reader_end {
+    chunk* head = nullptr;
+    std::uint32_t read = 0;
+  };
+  struct slot {
+    writer_end writer;
+    reader_end reader;
+    slot() {
+      writer.tail = reader.head = new chunk;
+    }
+    slot(const slot&) = delete;
+    slot& operator=(const slot&) = delete;
+  };
+
+  std::atomic<size_type> next_;
+  size_type taken_;
+  std::vector<slot> slots_;
+  // Held back by take(), consumer only
+  std::vector<op> nodes_;
+  std::vector<op> edges_;
+
+  void append(unsigned t, const op& x) {
+    assert(t < slots_.size());
+    writer_end& w = slots_[t].writer;
+    std::uint32_t i = w.tail->size.load(std::memory_order_relaxed);
+    if (i == chunk_size) {
+      chunk* c = new chunk;
+      w.tail->next.store(c, std::memory_order_release);
+      w.tail = c;
+      i = 0;
+    }
+    w.tail->ops[i] = x;
+    w.tail->size.store(i + 1, std::memory_order_release);
+  }
+
+  /** Move every published op of one slot to nodes_ and edges_. */
+  void drain(reader_end& r) {
+    while (true) {
+      std::uint32_t n = r.head->size.load(std::memory_order_acquire);
+      for (; r.read < n; ++r.read) {
+        const op& x = r.head->ops[r.read];
+        (x.a == x.b ? nodes_ : edges_).push_back(x);
+      }
+      if (n < chunk_size)
+        return;
+      chunk* next = r.head->next.load(std::memory_order_acquire);
+      if (next == nullptr)
+        return;
+      delete r.head;
+      r.head = next;
+      r.read = 0;
+    }
+  }
+};
+
+
+/** Add the nodes and edges of @a batch to @a g.
+ * @return The numbers of nodes, edges and new edges
+ *
+ * @pre g.size() == batch.first_node: every earlier batch of the log was
+ *      applied to @a g, and no node was added to it otherwise
+ * @post The batch's nodes have the indices their add_node() returned, with
+ *       default values, and g.has_edge() holds for every batch edge.
+ *
+ * With add_nodes() and add_edges() (hw1/Graph-24726.hpp) each runs once
+ * for the whole batch; otherwise the edges are sorted and deduplicated
+ * here, then added one at a time.
+ */
+template <typename G>
+update_report apply_updates(G& g, const update_batch<typename G::size_type>&
+                                      batch,
+                            const update_options& opt = {}) {
+  CME212_TRACE_SCOPE_N("apply_updates", batch.edges.size());
+  using size_type = typename G::size_type;
+  assert(size_type(g.size()) == batch.first_node);
+  update_report report;
+  report.nodes = batch.positions.size();
+  report.edges = batch.edges.size();
+
+  using point_iter = std::vector<Point>::const_iterator;
+  if constexpr (update_log_detail::has_add_nodes<G, point_iter>::value) {
+    if (!batch.positions.empty())
+      g.add_nodes(batch.positions.cbegin(), batch.positions.cend());
+  } else {
+    for (const Point& p : batch.positions)
+      g.add_node(p);
+  }
+
+  std::size_t before = std::size_t(g.num_edges());
+  using pair_iter =
+      typename std::vector<std::pair<size_type, size_type>>::const_iterator;
+  if constexpr (update_log_detail::has_add_edges<G, pair_iter>::value) {
+    if (!batch.edges.empty())
+      g.add_edges(batch.edges.cbegin(), batch.edges.cend());
+  } else {
+    std::vector<std::pair<size_type, size_type>> edges(batch.edges);
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    for (const auto& e : edges)
+      g.add_edge(g.node(e.first), g.node(e.second));
+  }
+  report.new_edges = std::size_t(g.num_edges()) - before;
+
+  if constexpr (update_log_detail::has_freeze<G>::value) {
+    if (opt.freeze)
+      g.freeze();
+  }
+  return report;
+}
+
+/** As apply_updates(g, batch, opt), then add the batch's nodes to
+ * @a index, a SpatialIndex over @a g. */
+template <typename G>
+update_report apply_updates(G& g, const update_batch<typename G::size_type>&
+                                      batch,
+                            SpatialIndex<G>& index,
+                            const update_options& opt = {}) {
+  update_report report = apply_updates(g, batch, opt);
+  for (std::size_t k = 0; k < batch.positions.size(); ++k)
+    index.update(batch.first_node + typename G::size_type(k));
+  return report;
+}
+
+#endif // CME212_UPDATE_LOG_HPP
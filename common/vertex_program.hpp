@@ -0,0 +1,336 @@
+#ifndef CME212_VERTEX_PROGRAM_HPP
+#define CME212_VERTEX_PROGRAM_HPP
+
+/** @file vertex_program.hpp
+ * @brief Multithreaded gather-apply iteration of vertex programs, such as
+ *        PageRank, label propagation and diffusion.
+ *
+ * A vertex program gives every node a value and updates all of them in
+ * synchronous rounds: a node combines one gather() term per neighbor and
+ * apply() turns the result into its new value. VertexEngine snapshots the
+ * adjacency of a graph into CSR form once, like BfsEngine, and runs any
+ * number of programs over it:
+ *
+ *   VertexEngine<G> engine(g);
+ *   std::vector<double> rank;
+ *   vp_report r = engine.run(pagerank_program(engine, 0.85), rank);
+ *
+ * Each round runs in one of two modes, as in Ligra:
+ *
+ *   pull  every node gathers from its whole row. Rows are read in order
+ *         and every node is written by one thread only, so the sweep
+ *         streams through memory and needs no atomics.
+ *   push  only the nodes that changed by more than the tolerance in the
+ *         last round (the frontier) are expanded: they mark themselves and
+ *         their neighbors with an atomic flag, and just the marked nodes
+ *         gather again.
+ *
+ * With vp_mode::automatic a round pushes while the frontier's edges are
+ * fewer than all edges / alpha, the point where a sparse round stops being
+ * cheaper than a dense one, and pulls otherwise. Iteration stops once no
+ * node changes by more than the tolerance.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common/csr_snapshot.hpp"
+#include "common/trace.hpp"
+
+
+/** How VertexEngine::run() chooses between pull and push rounds. */
+enum class vp_mode { automatic, pull, push };
+
+/** Tuning knobs for VertexEngine::run(). */
+struct vp_options {
+  /** Worker threads. 0 means std::thread::hardware_concurrency(). */
+  unsigned threads = 0;
+  /** Round limit; run() stops after this many rounds even if unconverged. */
+  unsigned max_iterations = 100;
+  /** A node is on the frontier if program.change() exceeds this. */
+  double tolerance = 1e-6;
+  vp_mode mode = vp_mode::automatic;
+  /** Push while frontier edges < all edges / alpha. */
+  double alpha = 20;
+};
+
+/** What one run did and how fast. */
+struct vp_report {
+  std::uint64_t iterations = 0;
+  std::uint64_t pull_steps = 0;
+  std::uint64_t push_steps = 0;
+  std::uint64_t updates = 0;       // apply() calls over all rounds
+  double residual = 0;             // sum of program.change() in the last round
+  bool converged = false;          // the last round changed no node by more
+                                   // than the tolerance
+  double seconds = 0;
+};
+
+
+/** @class VertexEngine
+ * @brief Reusable parallel vertex-program iteration over a snapshot of a
+ *        graph's adjacency.
+ *
+ * A program P is a copyable object with
+ *
+ *   using value_type = ...;
+ *   value_type init(size_type i) const;
+ *   value_type identity() const;                         // of combine()
+ *   value_type gather(size_type i, size_type j, const value_type& xj) const;
+ *   value_type combine(const value_type& a, const value_type& b) const;
+ *   value_type apply(size_type i, const value_type& xi,
+ *                    const value_type& acc) const;
+ *   double change(const value_type& before, const value_type& after) const;
+ *
+ * Round by round, node i's new value is apply(i, x_i, acc) where acc
+ * combines gather(i, j, x_j) over the neighbors j, all read from the
+ * previous round. combine() must be associative and commutative. Push
+ * rounds rely on a node whose own value and neighbors' values did not
+ * change keeping its value, which holds when apply() ignores x_i or is
+ * idempotent in it (as min() is).
+ *
+ * Reading the graph from several threads at once must be safe, which holds
+ * for the Graph variants as long as operation counting
+ * (CME212_GRAPH_STATS) is off.
+ *
+ * @tparam G  Graph type with size(), node(i).edge_begin()/edge_end() and
+ *            size_type.
+ */
+template <typename G>
+class VertexEngine {
+ public:
+  /** Type of node indices, as in the graph. */
+  using size_type = typename G::size_type;
+
+  /** Snapshot the adjacency of @a g.
+   * @param[in] threads  Threads for building; 0 means all cores
+   *
+   * Complexity: O(g.size() + g.num_edges()), spread over the threads.
+   */
+  explicit VertexEngine(const G& g, unsigned threads = 0)
+      : n_(std::size_t(g.size())),
+        offsets_(csr_snapshot::row_offsets(g,
+                                           csr_snapshot::thread_count(threads))) {
+    neighbors_.resize(offsets_[n_]);
+    csr_snapshot::fill_neighbors(g, offsets_, csr_snapshot::thread_count(threads),
+                                 neighbors_.data());
+  }
+
+  /** Return the number of nodes in the snapshot. */
+  size_type size() const {
+    return size_type(n_);
+  }
+
+  /** Return the number of neighbors of node @a i. */
+  size_type degree(size_type i) const {
+    return size_type(offsets_[i + 1] - offsets_[i]);
+  }
+
+  /** Iterate @a program to a fixed point.
+   * @param[in,out] values  Resized to size() and set to program.init(i);
+   *                        holds the last round's values on return
+   * @return Rounds, modes, residual and timing of the run
+   *
+   * Complexity: O(size() + number of edges) per pull round and O(frontier
+   * nodes + their edges + the edges of their neighbors) per push round,
+   * spread over the threads.
+   */
+  template <typename P>
+  vp_report run(const P& program, std::vector<typename P::value_type>& values,
+                const vp_options& opt = vp_options()) const {
+    using value_type = typename P::value_type;
+    CME212_TRACE_SCOPE("vertex_program");
+    auto start = std::chrono::steady_clock::now();
+    unsigned threads = csr_snapshot::thread_count(opt.threads);
+    vp_report report;
+
+    values.resize(n_);
+    csr_snapshot::parallel_ranges(threads, n_, 1024,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for (std::size_t i = b; i < e; ++i)
+            values[i] = program.init(size_type(i));
+        });
+
+    std::vector<value_type> next(n_);
+    std::vector<std::atomic<std::uint8_t>> marked(n_);
+    std::vector<std::vector<size_type>> local(threads);
+    std::vector<std::vector<std::pair<size_type, value_type>>> fresh(threads);
+    std::vector<double> residual(threads);
+    std::vector<std::size_t> edges(threads);
+
+    // Every node starts on the frontier
+    std::vector<size_type> frontier;
+    std::size_t frontier_edges = offsets_[n_];
+    bool all_active = true;
+
+    while (report.iterations < opt.max_iterations &&
+           (all_active || !frontier.empty())) {
+      bool push = opt.mode == vp_mode::push ||
+                  (opt.mode == vp_mode::automatic && !all_active &&
+                   double(frontier_edges) < double(offsets_[n_]) / opt.alpha);
+      std::fill(residual.begin(), residual.end(), 0.0);
+      std::fill(edges.begin(), edges.end(), 0);
+      for (auto& l : local)
+        l.clear();
+
+      if (!push) {
+        csr_snapshot::parallel_ranges(threads, n_, 1024,
+            [&](unsigned t, std::size_t b, std::size_t e) {
+              for (std::size_t i = b; i < e; ++i) {
+                next[i] = update(program, size_type(i), values);
+                double c = program.change(values[i], next[i]);
+                residual[t] += c;
+                if (c > opt.tolerance) {
+                  local[t].push_back(size_type(i));
+                  edges[t] += degree(size_type(i));
+                }
+              }
+            });
+        values.swap(next);
+        report.updates += n_;
+        ++report.pull_steps;
+      } else {
+        if (all_active) {
+          frontier.resize(n_);
+          for (std::size_t i = 0; i < n_; ++i)
+            frontier[i] = size_type(i);
+        }
+        // Mark the frontier and its neighbors; each target is claimed by
+        // the one thread whose flag exchange flips it
+        std::vector<std::vector<size_type>> targets(threads);
+        csr_snapshot::parallel_ranges(threads, frontier.size(), 256,
+            [&](unsigned t, std::size_t b, std::size_t e) {
+              auto claim = [&](size_type v) {
+                if (marked[v].load(std::memory_order_relaxed) == 0 &&
+                    marked[v].exchange(1, std::memory_order_relaxed) == 0)
+                  targets[t].push_back(v);
+              };
+              for (std::size_t k = b; k < e; ++k) {
+                size_type u = frontier[k];
+                claim(u);
+                for (std::size_t x = offsets_[u]; x < offsets_[u + 1]; ++x)
+                  claim(neighbors_[x]);
+              }
+            });
+        // Gather every target from the previous round's values, then
+        // publish them all at once
+        csr_snapshot::parallel_ranges(threads, threads, 1,
+            [&](unsigned, std::size_t b, std::size_t e) {
+              for (std::size_t t = b; t < e; ++t) {
+                fresh[t].clear();
+                for (size_type v : targets[t]) {
+                  value_type x = update(program, v, values);
+                  double c = program.change(values[v], x);
+                  residual[t] += c;
+                  if (c > opt.tolerance) {
+                    local[t].push_back(v);
+                    edges[t] += degree(v);
+                  }
+                  fresh[t].emplace_back(v, std::move(x));
+                }
+              }
+            });
+        csr_snapshot::parallel_ranges(threads, threads, 1,
+            [&](unsigned, std::size_t b, std::size_t e) {
+              for (std::size_t t = b; t < e; ++t) {
+                for (auto& p : fresh[t]) {
+                  values[p.first] = std::move(p.second);
+                  marked[p.first].store(0, std::memory_order_relaxed);
+                }
+              }
+            });
+        for (const auto& f : fresh)
+          report.updates += f.size();
+        ++report.push_steps;
+      }
+
+      frontier.clear();
+      frontier_edges = 0;
+      report.residual = 0;
+      for (unsigned t = 0; t < threads; ++t) {
+        frontier.insert(frontier.end(), local[t].begin(), local[t].end());
+        frontier_edges += edges[t];
+        report.residual += residual[t];
+      }
+      all_active = false;
+      ++report.iterations;
+    }
+
+    report.converged = frontier.empty() && !all_active;
+    report.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return report;
+  }
+
+ private:
+  std::size_t n_;
+  // Row i is neighbors_[offsets_[i] .. offsets_[i + 1])
+  std::vector<std::size_t> offsets_;
+  std::vector<size_type> neighbors_;
+
+  /** Return node @a i's value after one round of @a program. */
+  template <typename P, typename V>
+  typename P::value_type update(const P& program, size_type i,
+                                const V& values) const {
+    typename P::value_type acc = program.identity();
+    for (std::size_t k = offsets_[i]; k < offsets_[i + 1]; ++k) {
+      size_type j = neighbors_[k];
+      acc = program.combine(acc, program.gather(i, j, values[j]));
+    }
+    return program.apply(i, values[i], acc);
+  }
+};
+
+
+/** PageRank on an undirected graph: every node spreads its rank evenly
+ * over its edges, and rank_i = (1 - d) / n + d * sum of rank_j / deg_j.
+ *
+ * change() is the difference scaled by n, i.e. relative to the mean rank,
+ * so vp_options::tolerance means the same at every graph size. Isolated
+ * nodes keep (1 - d) / n and pass nothing on, so the ranks then sum to
+ * less than 1.
+ */
+template <typename G>
+class pagerank_program {
+ public:
+  using size_type = typename G::size_type;
+  using value_type = double;
+
+  pagerank_program(const VertexEngine<G>& engine, double damping = 0.85)
+      : engine_(&engine), damping_(damping),
+        n_(std::max<double>(1, engine.size())) {
+  }
+
+  double init(size_type) const {
+    return 1.0 / n_;
+  }
+  double identity() const {
+    return 0.0;
+  }
+  double gather(size_type, size_type j, double xj) const {
+    return xj / double(engine_->degree(j));
+  }
+  double combine(double a, double b) const {
+    return a + b;
+  }
+  double apply(size_type, double, double acc) const {
+    return (1.0 - damping_) / n_ + damping_ * acc;
+  }
+  double change(double before, double after) const {
+    return std::abs(after - before) * n_;
+  }
+
+ private:
+  const VertexEngine<G>* engine_;
+  double damping_;
+  double n_;
+};
+
+#endif // CME212_VERTEX_PROGRAM_HPP
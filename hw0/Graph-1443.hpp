@@ -6,9 +6,9 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <vector>
 #include <cassert>
-#include <map>
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
@@ -179,7 +179,8 @@ class Graph {
    */
   Node add_node(const Point& position) {
     // HW0: YOUR CODE HERE
-	mynodes[sizenode_] = position;
+	mynodes.push_back(position);
+	myadjacency.emplace_back();
 	++sizenode_;
 	return Node(this, sizenode_-1);
 
@@ -230,13 +231,13 @@ class Graph {
     /** Return a node of this Edge */
     Node node1() const {
       // HW0: YOUR CODE HERE
-	  return graphedge_->myedges[uidedge_][0];
+	  return Node(graphedge_, graphedge_->myedges[uidedge_][0]);
     }
 
     /** Return the other node of this Edge */
     Node node2() const {
       // HW0: YOUR CODE HERE
-	  return graphedge_->myedges[uidedge_][1];
+	  return Node(graphedge_, graphedge_->myedges[uidedge_][1]);
     }
 
     /** Test whether this edge and @a e are equal.
@@ -244,9 +245,10 @@ class Graph {
      * Equal edges represent the same undirected edge between two nodes.
      */
     bool operator==(const Edge& e) const {
-	  if(this->graphedge_->myedges[uidedge_] == e.graphedge_->myedges[uidedge_]
-			  or (graphedge_->myedges[uidedge_][1] == e.graphedge_->myedges[uidedge_][2]
-			  and graphedge_->myedges[uidedge_][2] == e.graphedge_->myedges[uidedge_][1]))
+	  const std::array<size_type, 2>& mine = graphedge_->myedges[uidedge_];
+	  const std::array<size_type, 2>& theirs = e.graphedge_->myedges[e.uidedge_];
+	  if(mine == theirs
+			  or (mine[0] == theirs[1] and mine[1] == theirs[0]))
 		  return true;
 	  else
 		  return false;
@@ -306,20 +308,18 @@ class Graph {
    * @pre @a a and @a b are valid nodes of this graph
    * @return True if for some @a i, edge(@a i) connects @a a and @a b.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(min(a.degree, b.degree)).
    */
   bool has_edge(const Node& a, const Node& b) const {
     // HW0: YOUR CODE HERE
 	assert(this->has_node(a));
 	assert(this->has_node(b));
-	for (std::map<size_type, std::vector<Node> >::const_iterator it = myedges.begin();
-			it != myedges.end(); ++it){
-		if (((it->second)[0] == a and (it->second)[1] == b) or
-				((it->second)[1] == a and (it->second)[0] == b)){
-			return true;
-		}
-	}
-	return false;
+	// Scan the shorter of the two neighbor rows
+	const std::vector<size_type>& rowa = myadjacency[a.uid_];
+	const std::vector<size_type>& rowb = myadjacency[b.uid_];
+	if (rowa.size() <= rowb.size())
+		return std::find(rowa.begin(), rowa.end(), b.uid_) != rowa.end();
+	return std::find(rowb.begin(), rowb.end(), a.uid_) != rowb.end();
   }
 
   /** Add an edge to the graph, or return the current edge if it already exists.
@@ -340,8 +340,9 @@ class Graph {
 	if (this->has_edge(a, b))
 		return Edge(this, sizeedge_);
 	else{
-		myedges[sizeedge_].push_back(a);
-		myedges[sizeedge_].push_back(b);
+		myedges.push_back({a.uid_, b.uid_});
+		myadjacency[a.uid_].push_back(b.uid_);
+		myadjacency[b.uid_].push_back(a.uid_);
 		++sizeedge_;
 		return Edge(this, sizeedge_-1);        // Invalid Edge
 	}
@@ -356,6 +357,7 @@ class Graph {
     // HW0: YOUR CODE HERE
 	mynodes.clear();
 	myedges.clear();
+	myadjacency.clear();
 	sizenode_ = 0;
 	sizeedge_ = 0;
 	assert(this->num_nodes() == 0 and this->num_edges() == 0);
@@ -363,8 +365,12 @@ class Graph {
 
  private:
   // HW0: YOUR CODE HERE
-  std::map<size_type, Point> mynodes;
-  std::map<size_type, std::vector<Node> > myedges;
+  // mynodes[i] is the position of node i
+  std::vector<Point> mynodes;
+  // myedges[k] holds the two node indices of edge k
+  std::vector<std::array<size_type, 2> > myedges;
+  // myadjacency[i] holds the indices of the neighbors of node i
+  std::vector<std::vector<size_type> > myadjacency;
   size_type sizenode_;
   size_type sizeedge_;
   // Use this space for your Graph class's internals:
@@ -8,10 +8,10 @@
 #include <algorithm>
 #include <vector>
 #include <cassert>
-#include <unordered_set>
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
+#include "common/adjacency_storage.hpp"
 
 
 /** @class Graph
@@ -22,10 +22,12 @@
  */
 class Graph {
  private:
-  std::map<unsigned, Point> internal_nodes;
+  //internal_nodes[i] is the position of node i
+  std::vector<Point> internal_nodes;
   unsigned size_,edge_size;
   std::map<unsigned, std::vector<unsigned>> internal_edges;
-  std::map<unsigned, std::unordered_set<unsigned>> connectivity ;
+  //Neighbor rows of every node, kept sorted so lookups bisect
+  sorted_adjacency::storage<unsigned> connectivity;
  // connectivity.insert(std::pair<unsigned, unordered_set<unsigned> (0,{}));
   
   // HW0: YOUR CODE HERE
@@ -184,8 +186,8 @@ class Graph {
        //size_type new_size = size() + 1;
        size_ ++;
        size_type new_node_id = size_ - 1;
-       internal_nodes.insert(std::pair<unsigned,Point> (new_node_id,position));
-       connectivity.insert(std::pair<size_type , std::unordered_set<unsigned>> (new_node_id,{}));
+       internal_nodes.push_back(position);
+       connectivity.add_node();
        node_type new_node(new_node_id,this);
     return new_node;        // Invalid node
   }
@@ -319,7 +321,7 @@ class Graph {
    * @pre @a a and @a b are valid nodes of this graph
    * @return True if for some @a i, edge(@a i) connects @a a and @a b.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(log(b.degree)).
    */
   bool has_edge(const Node& a, const Node& b) const {
     // HW0: YOUR CODE HERE
@@ -328,7 +330,7 @@ class Graph {
 	//for (size_type i=0; i< size();++i){
 		//std::unordered_set<size_type> set2 = internal_edges.at(i);
                
-	       if(connectivity.at(b.node_id).count(a.node_id)){
+	       if(connectivity.contains(b.node_id, a.node_id)){
 			return true;
 		}
 	return false;		
@@ -365,8 +367,7 @@ class Graph {
 			}
 			std::vector<size_type> nodes={new_edge.node1_id,new_edge.node2_id};
 			internal_edges.insert(std::pair<size_type, std::vector<size_type>> (new_edge.edge_id ,  nodes));
-                        connectivity[new_edge.node1_id].emplace(new_edge.node2_id);
-			connectivity[new_edge.node2_id].emplace(new_edge.node1_id);
+                        connectivity.insert(new_edge.node1_id, new_edge.node2_id);
 		}
 	
 
@@ -386,7 +387,7 @@ class Graph {
     edge_size = edge_.edge_id;
     internal_nodes.erase(internal_nodes.begin(),internal_nodes.end());
     internal_edges.erase(internal_edges.begin(),internal_edges.end());
-    connectivity.erase(connectivity.begin(),connectivity.end());
+    connectivity.clear();
     // HW0: YOUR CODE HERE
   }
 
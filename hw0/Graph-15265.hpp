@@ -219,13 +219,13 @@ class Graph {
     /** Return a node of this Edge */
     Node node1() const {
       assert(graph_);   // Check for validity
-      return graph_->node(graph_->edges_[edgeID_][0]);
+      return graph_->node(graph_->edges_[edgeID_].n1);
     }
 
     /** Return the other node of this Edge */
     Node node2() const {
       assert(graph_);   // Check for validity
-      return graph_->node(graph_->edges_[edgeID_][1]);
+      return graph_->node(graph_->edges_[edgeID_].n2);
     }
 
     /** Test whether this edge and @a e are equal.
@@ -235,10 +235,10 @@ class Graph {
     bool operator==(const Edge& e) const {
       assert(graph_ && e.getGraph());   // Check for validity
       assert(graph_ == e.getGraph());   // Check for same graph
-      auto pair = graph_->edges_[edgeID_];
-      auto ePair = e.getGraph()->edges_[e.getID()];
-      bool match = pair[0] == ePair[0] && pair[1] == ePair[1];
-      bool crossMatch = pair[1] == ePair[0] && pair[0] == ePair[1];
+      const edge_nodes& pair = graph_->edges_[edgeID_];
+      const edge_nodes& ePair = e.getGraph()->edges_[e.getID()];
+      bool match = pair.n1 == ePair.n1 && pair.n2 == ePair.n2;
+      bool crossMatch = pair.n2 == ePair.n1 && pair.n1 == ePair.n2;
       (void) e;           // Quiet compiler warning
       return match || crossMatch;
     }
@@ -341,8 +341,7 @@ class Graph {
       return edge(edgeMap_[search]);
     } else {
       std::string search = repString(a, b);
-      std::vector<size_type> entry {a.index(), b.index()};
-      edges_.push_back(entry);
+      edges_.push_back(edge_nodes{a.index(), b.index()});
       edgeMap_[search] = num_edges()-1;
       (void) a, (void) b;   // Quiet compiler warning
       return edge(num_edges()-1);
@@ -368,12 +367,19 @@ class Graph {
    */
   std::vector<Point> nodes_;
 
-  /** Data container for edges. Each edge is represented as a vector with two
-   * size_type elements. Each size_type corresponds to the ID number of a node.
-   * The ID number of the vector is used to index into the (outer) vector. This
-   * ID number can be found O(1), as explained below.
+  /** The two node ID numbers of an edge, stored inline so that the edge
+   * array is one contiguous block with no allocation per edge.
    */
-  std::vector<std::vector<size_type>> edges_;
+  struct edge_nodes {
+    size_type n1;
+    size_type n2;
+  };
+
+  /** Data container for edges. Each edge is represented by the ID numbers of
+   * its two nodes. The ID number of the edge is used to index into the
+   * vector. This ID number can be found O(1), as explained below.
+   */
+  std::vector<edge_nodes> edges_;
 
   /** Data container for O(1) edge lookups. Unordered_map key is string
    * representation of Edge. This representation is unique, see below.
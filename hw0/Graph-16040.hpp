@@ -177,7 +177,7 @@ class Graph {
   Node add_node(const Point& position) {
     // HW0: YOUR CODE HERE
     (void) position;      // Quiet compiler warning
-    nodes_[next_uid_node_] = position;
+    nodes_.push_back(position);
     next_uid_node_++;
     return Node(this,next_uid_node_-1); 
   }
@@ -325,14 +325,7 @@ class Graph {
   bool has_edge(const Node& a, const Node& b) const {
     // HW0: YOUR CODE HERE
     (void) a; (void) b;   // Quiet compiler warning
-    for (size_type i = 0; i < num_edges(); ++i)
-    {
-        if ( edge(i).node1()==a && edge(i).node2()==b )
-           return true;
-        if ( edge(i).node1()==b && edge(i).node2()==a )
-           return true;
-    }
-    return false;
+    return find_edge(a,b) < num_edges();
   }
 
   /** Add an edge to the graph, or return the current edge if it already exists.
@@ -350,16 +343,17 @@ class Graph {
   Edge add_edge(const Node& a, const Node& b) {
     // HW0: YOUR CODE HERE
     (void) a, (void) b;   // Quiet compiler warning
-    if ( has_edge(a,b) == false )
+    size_type i = find_edge(a,b);
+    if ( i == num_edges() )
     {
         local_edge_.uid1 = a.index();   
         local_edge_.uid2 = b.index();
-        edges_[next_uid_edge_] = local_edge_;
+        edges_.push_back(local_edge_);
         next_uid_edge_++;
         return Edge(this, next_uid_edge_-1);
     }
     else
-        return Edge(this, next_uid_edge_);
+        return Edge(this, i);
   }
 
   /** Remove all nodes and edges from this graph.
@@ -384,11 +378,24 @@ class Graph {
         size_type uid1;
         size_type uid2;
     };
-    std::map<size_type,Point> nodes_;
+    // Indexed by uid, which runs 0 .. size()-1 in insertion order
+    std::vector<Point> nodes_;
     size_type next_uid_node_;
-    std::map<size_type,internal_edge> edges_;
+    std::vector<internal_edge> edges_;
     size_type next_uid_edge_;
     internal_edge local_edge_;
+
+    // Index of the edge joining a and b, in either order, or num_edges()
+    size_type find_edge(const Node& a, const Node& b) const {
+        for (size_type i = 0; i < num_edges(); ++i)
+        {
+            if ( edges_[i].uid1==a.index() && edges_[i].uid2==b.index() )
+               return i;
+            if ( edges_[i].uid1==b.index() && edges_[i].uid2==a.index() )
+               return i;
+        }
+        return num_edges();
+    }
     
     Graph(const Graph&) = delete;
     Graph& operator=(const Graph&) = delete;
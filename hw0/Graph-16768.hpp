@@ -15,6 +15,7 @@
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
+#include "common/edge_index.hpp"
 
 
 /** @class Graph
@@ -360,24 +361,12 @@ class Graph {
    * @pre @a a and @a b are valid nodes of this graph
    * @return True if for some @a i, edge(@a i) connects @a a and @a b.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(1) expected.
    */
   bool has_edge(const Node& a, const Node& b) const {
-    bool flag = false;
-
-    //Iterate through all of the edges. If we find an edge where the source
-    //and destination indices match those of the indices of the nodes passed
-    //in, then we have found a match and we toggle the flag to true.
-    for(size_type i = 0; i < graph_edges.size(); i++) {
-      if ((a.index() == graph_edges[i].source &&
-           b.index() == graph_edges[i].dest)  ||
-          (b.index() == graph_edges[i].source &&
-           a.index() == graph_edges[i].dest))
-        flag = true;
-    }
-
-    //Returns depending on if the toggle was triggered.
-    return flag;
+    //The edge index is keyed on the unordered pair of node indices, so one
+    //probe answers the query for either orientation.
+    return edge_index_.contains(a.index(), b.index());
   }
 
   /** Add an edge to the graph, or return the current edge if it already exists
@@ -390,21 +379,16 @@ class Graph {
    * Can invalidate edge indexes -- in other words, old edge(@a i) might not
    * equal new edge(@a i). Must not invalidate outstanding Edge objects.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(1) amortized expected.
    */
   Edge add_edge(const Node& a, const Node& b) {
 
-    //This block of code is more or less the same code as the has_edge function
-    //If we find an existing edge, simply return it (we can't reuse has_edge)
-    //here since we need to know the uid of the object.
-    size_type counter;
-    for(counter = 0; counter < graph_edges.size(); counter++) {
-      if ((a.index() == graph_edges[counter].source &&
-           b.index() == graph_edges[counter].dest)  ||
-          (b.index() == graph_edges[counter].source &&
-           a.index() == graph_edges[counter].dest))
-          return Edge(this, counter);
-    }
+    //Try to register the edge under the next uid. If the edge index already
+    //holds this pair, it hands back the existing uid and we simply return it.
+    size_type counter = graph_edges.size();
+    auto inserted = edge_index_.insert(a.index(), b.index(), counter);
+    if (!inserted.second)
+      return Edge(this, inserted.first);
 
     //If the edge was not found, then we need to add it. We add it by
     //initializing with a new variable, setting the source and dest values
@@ -415,12 +399,7 @@ class Graph {
     new_edge.dest = b.index();
     graph_edges.push_back(new_edge);
 
-    //Ensuring that the edge has been added
-    if (has_edge(a, b)) {
-      return Edge(this, counter);
-    } else {
-      return Edge();        // Invalid Edge
-    }
+    return Edge(this, counter);
   }
 
   /** Remove all nodes and edges from this graph.
@@ -433,6 +412,7 @@ class Graph {
   void clear() {
     graph_nodes.clear();
     graph_edges.clear();
+    edge_index_.clear();
   }
 
  private:
@@ -454,6 +434,10 @@ class Graph {
   //and edges.
   std::vector<internal_node> graph_nodes;
   std::vector<internal_edge> graph_edges;
+
+  //Hash index from the unordered pair of node indices to the edge uid. Both
+  //has_edge and the duplicate check in add_edge go through it.
+  EdgeIndex<size_type> edge_index_;
 };
 
 #endif // CME212_GRAPH_HPP
@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <vector>
 #include <cassert>
+#include <utility>
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
@@ -60,11 +61,82 @@ class Graph {
   /** Construct an empty graph. */
   Graph()
     // HW0: YOUR CODE HERE
-    : nodes_(), edges_(), size_(0), next_uid_(0), nedges_(0), next_euid_(0) {
+    : nodes_(), edges_(), size_(0), next_uid_(0), nedges_(0), next_euid_(0),
+      node_capacity_(0) {
   }
 
-  /** Default destructor */
-  ~Graph() = default;
+  /** Destructor, frees the node and edge arrays */
+  ~Graph() {
+    delete[] edges_;
+    delete[] nodes_;
+  }
+
+  /** Move constructor, takes over the node and edge arrays of @a other.
+   * @post *this has the nodes and edges @a other had and @a other is empty
+   *
+   * Only the array pointers and counters move; no node or edge is copied.
+   * Node and Edge objects of @a other keep pointing at @a other.
+   *
+   * Complexity: O(1).
+   */
+  Graph(Graph&& other) noexcept : Graph() {
+    swap(other);
+  }
+
+  /** Move assignment, frees this graph's arrays and takes over those of
+   * @a other, leaving it empty.
+   *
+   * Complexity: O(1).
+   */
+  Graph& operator=(Graph&& other) noexcept {
+    if (this != &other) {
+      Graph taken(std::move(other));
+      swap(taken);
+    }
+    return *this;
+  }
+
+  /** Exchange the nodes and edges of this graph and @a other.
+   *
+   * Node and Edge objects keep pointing at the graph they came from.
+   *
+   * Complexity: O(1).
+   */
+  void swap(Graph& other) noexcept {
+    std::swap(nodes_, other.nodes_);
+    std::swap(edges_, other.edges_);
+    std::swap(size_, other.size_);
+    std::swap(next_uid_, other.next_uid_);
+    std::swap(nedges_, other.nedges_);
+    std::swap(next_euid_, other.next_euid_);
+    std::swap(node_capacity_, other.node_capacity_);
+  }
+
+  /** Exchange the contents of @a a and @a b, as a.swap(b). */
+  friend void swap(Graph& a, Graph& b) noexcept {
+    a.swap(b);
+  }
+
+  /** Return a deep copy of this graph, whose copy constructor is disabled.
+   * @post result has the same nodes and edges, with the same indices
+   *
+   * The node and edge structs hold no pointers, so each array is copied
+   * in one pass into an array of exactly its length.
+   *
+   * Complexity: O(num_nodes() + num_edges()).
+   */
+  Graph clone() const {
+    Graph g;
+    g.reserve_nodes(size_);
+    std::copy(nodes_, nodes_ + size_, g.nodes_);
+    if (nedges_ != 0) {
+      g.edges_ = new internal_edge[nedges_];
+      std::copy(edges_, edges_ + nedges_, g.edges_);
+    }
+    g.size_ = size_; g.next_uid_ = next_uid_;
+    g.nedges_ = nedges_; g.next_euid_ = next_euid_;
+    return g;
+  }
 
   //
   // NODES
@@ -173,25 +245,47 @@ class Graph {
    * @post new num_nodes() == old num_nodes() + 1
    * @post result_node.index() == old num_nodes()
    *
-   * Complexity: O(1) amortized operations.
+   * Complexity: O(1) amortized operations. The node array doubles its
+   * capacity when full, so N calls perform O(log N) allocations.
    */
   Node add_node(const Point& position) {
     // HW0: YOUR CODE HERE
-    internal_node* new_nodes = new internal_node[size_ + 1];
-    // Copy the current nodes  into a new array
-    for (size_type i = 0; i < size_; ++i)
-      new_nodes[i] = nodes_[i];
+    // Grow geometrically so the copy cost is amortized over many adds
+    if (size_ == node_capacity_)
+      reserve_nodes(node_capacity_ == 0 ? 8 : 2 * node_capacity_);
     //Set the point and uid for the new element
-    new_nodes[size_].pt = position;
-    new_nodes[size_].uid = next_uid_;
-    //Delete the old nodes and reassign values
-    delete[] nodes_;
-    nodes_ = new_nodes;
+    nodes_[size_].pt = position;
+    nodes_[size_].uid = next_uid_;
     ++size_;
     ++next_uid_;
     return Node(this, next_uid_-1); // Points to new element
   }
 
+  /** Make room for at least @a n nodes without further reallocation.
+   * @post node_capacity() >= @a n
+   * @post num_nodes() and every node's position and index are unchanged
+   *
+   * Loaders that know the node count up front can call this once so that
+   * the following add_node() calls never reallocate.
+   *
+   * Complexity: O(num_nodes()) if the array grows, O(1) otherwise.
+   */
+  void reserve_nodes(size_type n) {
+    if (n <= node_capacity_)
+      return;
+    internal_node* new_nodes = new internal_node[n];
+    // Copy the current nodes into the larger array
+    std::copy(nodes_, nodes_ + size_, new_nodes);
+    delete[] nodes_;
+    nodes_ = new_nodes;
+    node_capacity_ = n;
+  }
+
+  /** Return the number of nodes the graph can hold before reallocating. */
+  size_type node_capacity() const {
+    return node_capacity_;
+  }
+
   /** Determine if a Node belongs to this Graph
    * @return True if @a n is currently a Node of this Graph
    *
@@ -234,13 +328,13 @@ class Graph {
     /** Return a node of this Edge */
     Node node1() const {
       // HW0: YOUR CODE HERE
-      return fetch().nd1;      // Invalid Node
+      return graph_->node(fetch().nd1);
     }
 
     /** Return the other node of this Edge */
     Node node2() const {
       // HW0: YOUR CODE HERE
-      return fetch().nd2;      // Invalid Node
+      return graph_->node(fetch().nd2);
     }
 
     /** Test whether this edge and @a e are equal.
@@ -316,8 +410,8 @@ class Graph {
     // Loop through edges, if the right one is found break the loop
     bool edge_exists = false;
     for (size_type i = 0; i<num_edges(); ++i) {
-      if (((edges_[i].nd1 == a) && (edges_[i].nd2 == b)) ||
-	  ((edges_[i].nd2 == a) && (edges_[i].nd1 == b))) {
+      if (((edges_[i].nd1 == a.uid_) && (edges_[i].nd2 == b.uid_)) ||
+	  ((edges_[i].nd2 == a.uid_) && (edges_[i].nd1 == b.uid_))) {
 	edge_exists = true;
 	break;
       }
@@ -347,8 +441,8 @@ class Graph {
       for (size_type i = 0; i < nedges_; ++i)
 	new_edges[i] = edges_[i];
       // Set the nodes and uid for the new edge
-      new_edges[nedges_].nd1 = a;
-      new_edges[nedges_].nd2 = b;
+      new_edges[nedges_].nd1 = a.uid_;
+      new_edges[nedges_].nd2 = b.uid_;
       new_edges[nedges_].uid = next_euid_;
       // Delete the old edges and reassign values
       delete[] edges_;
@@ -358,8 +452,8 @@ class Graph {
       edgenum = next_euid_-1;
     } else {
       for (size_type i = 0; i<num_edges(); ++i) {
-	if (((edges_[i].nd1 == a) && (edges_[i].nd2 == b)) ||
-	    ((edges_[i].nd2 == a) && (edges_[i].nd1 == b))) {
+	if (((edges_[i].nd1 == a.uid_) && (edges_[i].nd2 == b.uid_)) ||
+	    ((edges_[i].nd2 == a.uid_) && (edges_[i].nd1 == b.uid_))) {
 	  edgenum = edges_[i].uid;
 	  break;
 	}
@@ -378,7 +472,10 @@ class Graph {
     // HW0: YOUR CODE HERE
     delete[] edges_;
     delete[] nodes_;
+    edges_ = nullptr;
+    nodes_ = nullptr;
     size_ = 0; next_uid_ = 0; nedges_ = 0; next_euid_ = 0;
+    node_capacity_ = 0;
   }
 
  private:
@@ -394,10 +491,12 @@ class Graph {
     size_type uid;
   };
 
-  // internal edge struct contains two nodes and a uid
+  // internal edge struct contains the uids of its two nodes and its own
+  // uid. Uids rather than Node objects, so that the arrays do not point
+  // back at the graph and can be handed to another one as they are.
   struct internal_edge {
-    Node  nd1;
-    Node  nd2;
+    size_type nd1;
+    size_type nd2;
     size_type uid;
   };
 
@@ -407,6 +506,7 @@ class Graph {
   size_type next_uid_;
   size_type nedges_;
   size_type next_euid_;
+  size_type node_capacity_; // allocated length of nodes_, >= size_
 
   // Disable copy and assignment of a Graph
   Graph(const Graph&) = delete;
@@ -11,6 +11,7 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <vector>
 #include <cassert>
 
@@ -26,7 +27,8 @@
  */
 class Graph {
  private:
-  // No internal types used for HW0
+  //Declare struct to hold one entry of a node's connections
+  struct NodeConnection;
 
  public:
   //
@@ -174,7 +176,7 @@ class Graph {
     this->nodes_.push_back(position);
 
     //Each Node needs to be initialized in nodeConnections for Edge management
-    this->nodeConnections_.push_back(std::vector<std::vector<size_type> >());
+    this->nodeConnections_.push_back(std::vector<NodeConnection>());
     
     return newNode;
   }
@@ -312,10 +314,9 @@ class Graph {
 
     //Iterate through the node connectivity matrix to see if the two nodes
     //are already connected
-    for (size_type iter = 0;
-	 iter < this->nodeConnections_[a.index()].size(); iter++)
+    for (const NodeConnection& c : this->nodeConnections_[a.index()])
       {
-	if (this->nodeConnections_[a.index()][iter][0] == b.index())
+	if (c.node_ == b.index())
 	  return true;
       }
     
@@ -346,13 +347,11 @@ class Graph {
     if (has_edge(a,b))
       {
 	Edge foundEdge;
-	for (size_type iter = 0;
-	     iter < this->nodeConnections_[a.index()].size(); iter++)
+	for (const NodeConnection& c : this->nodeConnections_[a.index()])
 	  {
-	    if (this->nodeConnections_[a.index()][iter][0] == b.index())
+	    if (c.node_ == b.index())
 	      {
-		foundEdge =
-		  this->edge(this->nodeConnections_[a.index()][iter][1]);
+		foundEdge = this->edge(c.edge_);
 	      }
 	  }
 	return foundEdge;
@@ -363,13 +362,13 @@ class Graph {
 	Edge newEdge(this, this->num_edges());
 
 	//Add the edge connection to the node connectivity vector
-	std::vector<size_type> temp1 = {b.index(),this->num_edges()};
+	NodeConnection temp1 = {b.index(),this->num_edges()};
 	this->nodeConnections_[a.index()].push_back(temp1);
-	std::vector<size_type> temp2 = {a.index(),this->num_edges()};
+	NodeConnection temp2 = {a.index(),this->num_edges()};
 	this->nodeConnections_[b.index()].push_back(temp2);
 	
 	// Add the edge to the vector of Node index pairs
-	std::vector<Node> temp3 = {a,b};
+	std::array<Node, 2> temp3 = {a,b};
 	this->edges_.push_back(temp3);
 
 	return newEdge;
@@ -391,14 +390,20 @@ class Graph {
   //A vector of Points that coorespond to the Nodes in the graph
   std::vector<Point> nodes_;
 
-  //Vector to hold the edges. The inner vector of Nodes contains
+  //Struct to hold a connected Node and the edge that connects them
+  struct NodeConnection {
+    size_type node_;
+    size_type edge_;
+  };
+
+  //Vector to hold the edges. Each array contains
   //Node a and b for each edge
-  std::vector<std::vector<Node> > edges_;
+  std::vector<std::array<Node, 2> > edges_;
 
-  //Vector of all Nodes. Each node has an associated vector of vectors.
-  //The inner most vector contains the index of a Node connected to the
-  //original Node and the edge that connects them.
-  std::vector<std::vector<std::vector<size_type> > > nodeConnections_;
+  //Vector of all Nodes. Each node has an associated vector of
+  //NodeConnections, stored back to back: the index of a Node connected
+  //to the original Node and the edge that connects them.
+  std::vector<std::vector<NodeConnection> > nodeConnections_;
 };
 
 #endif // CME212_GRAPH_HPP
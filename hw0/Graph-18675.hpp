@@ -11,6 +11,7 @@
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
+#include "common/edge_index.hpp"
 
 
 /** @class Graph
@@ -55,7 +56,8 @@ public:
   std::vector<Point>* nodes_;
 
   std::vector<std::pair<size_type, size_type>>* edges_list_;
-  std::map<std::pair<size_type, size_type>,size_type>* rev_edges_list_;
+  // Edge id of every edge, keyed on its unordered pair of node indices
+  EdgeIndex<size_type> rev_edges_list_;
 public:
 
   //
@@ -67,7 +69,6 @@ public:
     // HW0: YOUR CODE HERE
     nodes_ = new std::vector<Point>();
     edges_list_ = new std::vector<std::pair<size_type, size_type>>();
-    rev_edges_list_ = new std::map<std::pair<size_type, size_type>,size_type>;
   }
 
   /** Default destructor */
@@ -312,11 +313,11 @@ public:
    * @pre @a a and @a b are valid nodes of this graph
    * @return True if for some @a i, edge(@a i) connects @a a and @a b.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(1) expected.
    */
   bool has_edge(const Node& a, const Node& b) const {
     // HW0: YOUR CODE HERE
-    return rev_edges_list_->count(std::pair<size_type, size_type>(a.uid_,b.uid_));
+    return rev_edges_list_.contains(a.uid_,b.uid_);
   }
 
   /** Add an edge to the graph, or return the current edge if it already exists.
@@ -329,21 +330,18 @@ public:
    * Can invalidate edge indexes -- in other words, old edge(@a i) might not
    * equal new edge(@a i). Must not invalidate outstanding Edge objects.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(1) amortized expected.
    */
   Edge add_edge(const Node& a, const Node& b) {
-    std::map<std::pair<size_type, size_type>,size_type>::iterator found_edge=  rev_edges_list_->find(std::pair<size_type, size_type>(a.uid_,b.uid_));
-    if (found_edge== rev_edges_list_->end()){
+    //One key serves both orientations of the edge
+    const size_type old_sz = num_edges();
+    std::pair<size_type, bool> found_edge = rev_edges_list_.insert(a.uid_,b.uid_,old_sz);
+    if (found_edge.second){
      const std::pair<size_type, size_type> pair1  = std::pair<size_type, size_type>(a.uid_,b.uid_);
-     const std::pair<size_type, size_type> pair2 = std::pair<size_type, size_type>(b.uid_,a.uid_);
-
-     const size_type old_sz = num_edges();
      edges_list_->push_back(pair1);
-     rev_edges_list_->insert(std::pair<std::pair<size_type, size_type>,size_type>(pair1,old_sz));
-     rev_edges_list_->insert(std::pair<std::pair<size_type, size_type>,size_type>(pair2,old_sz));
      return edge(old_sz);
     }else{
-     return edge(found_edge->second);
+     return edge(found_edge.first);
     }
            // Invalid Edge
   }
@@ -357,7 +355,7 @@ public:
     //destroy items
     nodes_->clear();
     edges_list_->clear();
-    rev_edges_list_->clear();
+    rev_edges_list_.clear();
     // HW0: YOUR CODE HERE
   }
 
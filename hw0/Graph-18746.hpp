@@ -341,7 +341,7 @@ class Graph {
     // edge id related to node a. If b is in the value vector,
     // then there exists an edge between a and b.
     if (has_node(a) && has_node(b)){
-        std::vector<size_type> current = e_map.at(a.index());
+        const std::vector<size_type>& current = e_map.at(a.index());
         for (size_type i = 0; i < current.size(); ++i){
           Edge curr_e = edge(current[i]);
           if (((curr_e.node1() == a) && (curr_e.node2() == b)) || 
@@ -376,7 +376,7 @@ class Graph {
     // containing the indices of a and b and add to the vector
     // of edges. Also update the map of edges.
     if (has_node(a) && has_node(b) && !(a == b)){
-          std::vector<size_type> current = e_map.at(a.index());
+          const std::vector<size_type>& current = e_map.at(a.index());
           if (has_edge(a,b)){           
             for (size_type i = 0; i < current.size(); ++i){
                 Edge curr_e = edge(current[i]);
@@ -11,6 +11,7 @@
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
+#include "common/inline_adjacency.hpp"
 
 
 /** @class Graph
@@ -99,7 +100,7 @@ class Graph {
     /** Return this node's position. */
     const Point& position() const {
       // HW0: YOUR CODE HERE
-      return graph_->nodes_[node_idx_];
+      return graph_->adjacency_.payload(node_idx_);
     }
 
     /** Return this node's index, a number in the range [0, graph_size). */
@@ -170,9 +171,7 @@ class Graph {
    */
   Node add_node(const Point& position) {
     // HW0: YOUR CODE HERE
-    nodes_.push_back(position);
-    std::vector<size_type> neighbors;
-    adjacency_.push_back(neighbors);
+    adjacency_.add_node(position);
     nb_nodes_++;
     return Node(this, nb_nodes_ - 1);
   }
@@ -300,13 +299,7 @@ class Graph {
     // HW0: YOUR CODE HERE
     size_type idx_1 = a.index();
     size_type idx_2 = b.index();
-    std::vector<size_type> neighbors = adjacency_[idx_1];
-    for(size_type i=0 ; i < neighbors.size(); ++i){
-      if (neighbors[i] == idx_2){
-          return true;
-	}
-    }
-    return false;
+    return adjacency_.contains(idx_1, idx_2);
   }
 
   /** Add an edge to the graph, or return the current edge if it already exists.
@@ -330,8 +323,7 @@ class Graph {
         new_edge.node_1 = idx_1;
         new_edge.node_2 = idx_2;;
         edges_.push_back(new_edge);
-	adjacency_[idx_1].push_back(idx_2);
-	adjacency_[idx_2].push_back(idx_1);
+	adjacency_.insert(idx_1, idx_2);
 	nb_edges_++;
     }
     return Edge(this, idx_1, idx_2);
@@ -344,7 +336,6 @@ class Graph {
    */
   void clear() {
     // HW0: YOUR CODE HERE
-    nodes_.clear();
     edges_.clear();
     adjacency_.clear();
     nb_nodes_ = 0;
@@ -359,9 +350,9 @@ class Graph {
   // HW0: YOUR CODE HERE
   // Use this space for your Graph class's internals:
   //   helper functions, data members, and so forth.
-  std::vector<Point> nodes_;
+  // Each node's position and first 8 neighbors share one cache line
+  InlineAdjacency<Point, size_type> adjacency_;
   std::vector<node_pair> edges_;
-  std::vector<std::vector<size_type>> adjacency_;
   size_type nb_nodes_;
   size_type nb_edges_;
 };
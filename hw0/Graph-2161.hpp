@@ -13,6 +13,7 @@
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
+#include "common/edge_index.hpp"
 
 
 /** @class Graph
@@ -50,12 +51,20 @@ class Graph {
   unsigned int nodes_[0][2];
   unsigned int edges_[0][2];*/
 
+  // the two node ids of an edge, inline in one contiguous array
+  struct edge_nodes {
+    unsigned int n1;
+    unsigned int n2;
+  };
+
   std::vector<Point> nodes_pos_;
   std::vector<unsigned int> nodes_ids_;
-  std::vector<std::vector<unsigned int> > edges_nds_;
+  std::vector<edge_nodes> edges_nds_;
   std::vector<unsigned int> edges_ids_;
   unsigned int next_nid_;
   unsigned int next_eid_;
+  // maps the unordered pair of node ids to the edge's position in edges_nds_
+  EdgeIndex<unsigned int> edges_index_;
 
   /*std::vector<Point> nodes_pos_;
   std::map<unsigned int, unsigned int> nodes_map_;
@@ -300,7 +309,7 @@ class Graph {
     /** Return a node of this Edge */
     Node node1() const {
       // HW0: YOUR CODE HERE
-      unsigned nid = graph_->edges_nds_[edge_index()][0];
+      unsigned nid = graph_->edges_nds_[edge_index()].n1;
       Node new_node = Node(graph_, nid);
       return new_node;
       //return Node();      // Invalid Node
@@ -309,7 +318,7 @@ class Graph {
     /** Return the other node of this Edge */
     Node node2() const {
       // HW0: YOUR CODE HERE
-      unsigned nid = graph_->edges_nds_[edge_index()][1];
+      unsigned nid = graph_->edges_nds_[edge_index()].n2;
       Node new_node = Node(graph_, nid);
       return new_node;
       //return Node();      // Invalid Node
@@ -397,18 +406,11 @@ class Graph {
    * @pre @a a and @a b are valid nodes of this graph
    * @return True if for some @a i, edge(@a i) connects @a a and @a b.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(1) expected.
    */
   bool has_edge(const Node& a, const Node& b) const {
     // HW0: YOUR CODE HERE
-    for (unsigned i=0; i<edges_ids_.size(); ++i) {
-      unsigned nid0 = edges_nds_[i][0];
-      unsigned nid1 = edges_nds_[i][1];
-      if ((nid0==a.nid_ && nid1==b.nid_) || (nid0==b.nid_ && nid1==a.nid_)) {
-        return true;
-      }
-    }
-    return false;
+    return edges_index_.contains(a.nid_, b.nid_);
     //(void) a; (void) b;   // Quiet compiler warning
     //return false;
   }
@@ -423,19 +425,15 @@ class Graph {
    * Can invalidate edge indexes -- in other words, old edge(@a i) might not
    * equal new edge(@a i). Must not invalidate outstanding Edge objects.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(1) amortized expected.
    */
   Edge add_edge(const Node& a, const Node& b) {
     // HW0: YOUR CODE HERE
-    for (unsigned i=0; i<edges_ids_.size(); ++i) {
-      unsigned nid0 = edges_nds_[i][0];
-      unsigned nid1 = edges_nds_[i][1];
-      if ((nid0==a.nid_ && nid1==b.nid_) || (nid0==b.nid_ && nid1==a.nid_)) {
-        return edge(i);
-      }
+    auto found = edges_index_.insert(a.nid_, b.nid_, edges_nds_.size());
+    if (!found.second) {
+      return edge(found.first);
     }
-    std::vector<unsigned int> nids = {a.nid_, b.nid_};
-    edges_nds_.push_back(nids);
+    edges_nds_.push_back(edge_nodes{a.nid_, b.nid_});
     edges_ids_.push_back(next_eid_);
     Edge new_edge = Edge(this, next_eid_);
     ++next_eid_;
@@ -455,6 +453,7 @@ class Graph {
     nodes_ids_.clear();
     edges_nds_.clear();
     edges_ids_.clear();
+    edges_index_.clear();
   }
 
  private:
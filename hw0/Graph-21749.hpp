@@ -155,7 +155,7 @@ class Graph {
   Node add_node(const Point& position) {
     size_type curr_size = size();
     nodes_.push_back(position);
-    edges_.push_back(std::vector<size_type>{});
+    neighbors_.push_back(std::vector<size_type>{});
     return Node(this, curr_size);
   }
   /** Determine if a Node belongs to this Graph
@@ -246,35 +246,20 @@ class Graph {
 
   /** Return the total number of edges in the graph.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(1).
    */
   size_type num_edges() const {
-    size_type result = 0;
-    for (size_type i = 0; i < size(); ++ i)
-      result += edges_[i].size();
-    return result;
+    return edges_.size();
   }
 
   /** Return the edge with index @a i.
    * @pre 0 <= @a i < num_edges()
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(1).
    */
   Edge edge(size_type i) const {
     assert(i < num_edges());
-    size_type curr_index = 0;
-    for (size_type j = 0; j < size(); ++ j){
-      if (i >= curr_index + edges_[j].size())
-        curr_index += edges_[j].size();
-      else {
-        for (size_type k = 0; k < edges_[j].size(); ++ k){
-          if (curr_index == i)
-            return Edge(this, j, edges_[j][k]);
-          curr_index += 1;
-        }
-      }
-    }
-    return Edge();
+    return Edge(this, edges_[i].n1, edges_[i].n2);
   }
 
   /** Test whether two nodes are connected by an edge.
@@ -288,8 +273,8 @@ class Graph {
     assert(has_node(b));
     size_type min_index = std::min(a.index(),b.index());
     size_type max_index = std::max(a.index(),b.index());
-    for (size_type i = 0; i < edges_[min_index].size(); ++ i){
-      if (edges_[min_index][i] == max_index)
+    for (size_type i = 0; i < neighbors_[min_index].size(); ++ i){
+      if (neighbors_[min_index][i] == max_index)
         return true;
     }
     return false;
@@ -313,7 +298,8 @@ class Graph {
     size_type min_index = std::min(a.index(),b.index());
     size_type max_index = std::max(a.index(),b.index());
     if (!has_edge(a,b)){
-      edges_[min_index].push_back(max_index);
+      neighbors_[min_index].push_back(max_index);
+      edges_.push_back(edge_nodes{min_index, max_index});
     }
     return Edge(this, a.index(), b.index());
   }
@@ -325,7 +311,8 @@ class Graph {
    */
   void clear() {
     nodes_ = std::vector<Point>();
-    edges_ = std::vector<std::vector<size_type>>();
+    neighbors_ = std::vector<std::vector<size_type>>();
+    edges_ = std::vector<edge_nodes>();
   }
 
  private:
@@ -336,10 +323,20 @@ class Graph {
   // Internal representation of nodes
   std::vector<Point> nodes_;
 
-  // Internal representation of edges.
-  // This is an adjacency list representation
-  // edges[i][j] = k means that there is an edge between nodes_[i] & nodes_[k]
-  std::vector<std::vector<size_type>> edges_;
+  // Adjacency list for edge lookup.
+  // neighbors_[i][j] = k > i means that there is an edge between nodes_[i] &
+  // nodes_[k]
+  std::vector<std::vector<size_type>> neighbors_;
+
+  // The two node indices of an edge, smaller first
+  struct edge_nodes {
+    size_type n1;
+    size_type n2;
+  };
+
+  // Internal representation of edges, in the order they were added, so
+  // edge(i) is one array read
+  std::vector<edge_nodes> edges_;
 
 };
 
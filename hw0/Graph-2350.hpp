@@ -11,6 +11,7 @@
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
+#include "common/edge_index.hpp"
 
 
 /** @class Graph
@@ -311,18 +312,11 @@ class Graph {
    * @pre @a a and @a b are valid nodes of this graph
    * @return True if for some @a i, edge(@a i) connects @a a and @a b.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(1) expected.
    */
   bool has_edge(const node_type& a, const node_type& b) const {
     // HW0: YOUR CODE HERE
-    // In the double-layered nodes_edge_map_, the smaller index
-    // of the two nodes for each edge is used as key in first layer
-    size_type s = std::min(a.index_, b.index_);
-    size_type l = std::max(a.index_, b.index_);
-    if (nodes_edge_map_.count(s) == 1)
-      if (nodes_edge_map_.at(s).count(l) == 1)
-        return true;
-    return false;
+    return edge_index_.contains(a.index_, b.index_);
   }
 
   /** Add an edge to the graph, or return the current edge if it already exists.
@@ -335,18 +329,18 @@ class Graph {
    * Can invalidate edge indexes -- in other words, old edge(@a i) might not
    * equal new edge(@a i). Must not invalidate outstanding Edge objects.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(1) amortized expected.
    */
   edge_type add_edge(const node_type& a, const node_type& b) {
     // HW0: YOUR CODE HERE
     assert(this->has_node(a) && this->has_node(b));
-    // Check if such edge already exists
+    // One probe both checks for the edge and reserves its id; an existing
+    // edge keeps its original id
     size_type s = std::min(a.index_, b.index_);
     size_type l = std::max(a.index_, b.index_);
-    if (has_edge(a, b))
-      return edge_objs_[nodes_edge_map_[s][l]];
-    // Add the new edge to nodes_edge_map_
-    nodes_edge_map_[s][l] = num_edges();
+    auto found = edge_index_.insert(s, l, num_edges());
+    if (!found.second)
+      return edge_objs_[found.first];
     // Add the new edge object
     edge_objs_.push_back(Edge(this, num_edges()));
     // Add the new internal edge to graph
@@ -365,6 +359,7 @@ class Graph {
     // HW0: YOUR CODE HERE
     nodes_.clear();
     edges_.clear();
+    edge_index_.clear();
   }
 
  private:
@@ -385,7 +380,8 @@ class Graph {
   std::vector<internal_edge> edges_;
   std::vector<Node> node_objs_;
   std::vector<Edge> edge_objs_;
-  std::map<size_type, std::map<size_type, size_type>> nodes_edge_map_;
+  // Edge id of every edge, keyed on its unordered pair of node indices
+  EdgeIndex<size_type> edge_index_;
 };
 
 #endif // CME212_GRAPH_HPP
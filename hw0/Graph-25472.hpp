@@ -8,7 +8,7 @@
 #include <algorithm>
 #include <vector>
 #include <cassert>
-#include <set>
+#include <utility>
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
@@ -185,6 +185,7 @@ class Graph {
   Node add_node(const Point& position) {
     // HW0: YOUR CODE HERE
     nodes_.push_back(position);
+    incidence_.emplace_back();
     return Node(this,nodes_.size() - 1);        // Invalid node
   }
 
@@ -312,16 +313,13 @@ class Graph {
    * @pre @a a and @a b are valid nodes of this graph
    * @return True if for some @a i, edge(@a i) connects @a a and @a b.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(log(a.degree)).
    */
   bool has_edge(const Node& a, const Node& b) const {
     // HW0: YOUR CODE HERE
-    for (auto & edge: nodeEdges.at(a.index())) {
-        if (b.index() == edge) {
-            return true;
-        }
-    }
-    return false;
+    const std::vector<incidence>& row = incidence_[a.index()];
+    auto it = find_neighbor(row, b.index());
+    return it != row.end() && it->first == b.index();
   }
 
   /** Add an edge to the graph, or return the current edge if it already exists.
@@ -334,25 +332,24 @@ class Graph {
    * Can invalidate edge indexes -- in other words, old edge(@a i) might not
    * equal new edge(@a i). Must not invalidate outstanding Edge objects.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(log(a.degree) + a.degree + b.degree).
    */
   Edge add_edge(const Node& a, const Node& b) {
     // HW0: YOUR CODE HERE
+    std::vector<incidence>& aRow = incidence_[a.index()];
+    auto aPos = find_neighbor(aRow, b.index());
+    if (aPos != aRow.end() && aPos->first == b.index()) {
+        return Edge(this, aPos->second);
+    }
+    size_type id = edges_.size();
     std::vector<size_type> nodeVec = {a.index(), b.index()};
     edges_.push_back(nodeVec);
 
-    //update the map
-    std::set<size_type> aEdge = nodeEdges[a.index()];
-    aEdge.insert(edges_.size() -1);
-    nodeEdges[a.index()] = aEdge;
-    //assert( nodeEdges.find(a.index())->second == aEdge);
-
-    std::set<size_type> bEdge = nodeEdges[b.index()];
-    bEdge.insert(edges_.size() -1);
-    nodeEdges[a.index()] = bEdge;
-    //assert( nodeEdges.find(b.index())->second == bEdge);
-    //nodeEdges.emplace(b.index(),nodeEdges[b.index()].insert(edges_.size() -1));
-    return Edge(this,edges_.size() -1);        // Invalid Edge
+    //update both rows, keeping them sorted by neighbor
+    aRow.insert(aPos, incidence(b.index(), id));
+    std::vector<incidence>& bRow = incidence_[b.index()];
+    bRow.insert(find_neighbor(bRow, a.index()), incidence(a.index(), id));
+    return Edge(this, id);
   }
 
   /** Remove all nodes and edges from this graph.
@@ -363,7 +360,7 @@ class Graph {
   void clear() {
       nodes_.clear();
       edges_.clear();
-      nodeEdges.clear();
+      incidence_.clear();
   }
 
  private:
@@ -371,7 +368,21 @@ class Graph {
   // HW0: YOUR CODE HERE
   std::vector<Point> nodes_;
   std::vector<std::vector<size_type>> edges_;
-  std::map<size_type, std::set<size_type>> nodeEdges;
+
+  //(neighbor index, edge index) of one edge of a node
+  using incidence = std::pair<size_type, size_type>;
+  //incidence_[i] holds every edge of node i, sorted by neighbor index
+  std::vector<std::vector<incidence>> incidence_;
+
+  /** Return the first entry of @a row whose neighbor is not below @a n */
+  static std::vector<incidence>::const_iterator find_neighbor(
+      const std::vector<incidence>& row, size_type n) {
+    return std::lower_bound(row.begin(), row.end(), incidence(n, 0));
+  }
+  static std::vector<incidence>::iterator find_neighbor(
+      std::vector<incidence>& row, size_type n) {
+    return std::lower_bound(row.begin(), row.end(), incidence(n, 0));
+  }
   // Use this space for your Graph class's internals:
   //   helper functions, data members, and so forth.
 
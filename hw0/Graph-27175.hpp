@@ -7,9 +7,13 @@
 
 #include <algorithm>
 #include <cassert>
+#include <memory>
+#include <memory_resource>
 #include <set>
+#include <utility>
 #include <vector>
 
+#include "common/slab_pool.hpp"
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
 
@@ -60,17 +64,93 @@ class Graph {
     }
 
     /// Default destructor
-    ~Graph() {
+    /// 
+    /// The nodes, edges and incidence sets all live in a few large
+    /// pools (see the members below), so destruction frees a handful of
+    /// blocks instead of one allocation per node, edge and set entry.
+    /// 
+    ~Graph() = default;
+
+    // Nodes and edges are held by pointers into this Graph's pools.
+    Graph(const Graph&) = delete;
+    Graph& operator=(const Graph&) = delete;
+
+    /// Move constructor, takes over the pools of @a other.
+    /// @post *this has the nodes and edges @a other had and @a other is
+    ///       empty
+    /// 
+    /// The pools, the arena and the pointer arrays change hands as they
+    /// are: the slabs and arena blocks stay where they are, so every
+    /// pointer into them, and every set allocated from the arena, stays
+    /// valid. Node and Edge objects of @a other keep pointing at @a other.
+    /// 
+    /// Complexity: O(1).
+    /// 
+    Graph(Graph &&other) noexcept : Graph() {
+      swap(other);
+    }
+
+    /// Move assignment, frees this graph's nodes and edges and takes over
+    /// those of @a other, leaving it empty.
+    /// 
+    /// Complexity: O(1) plus freeing the old nodes and edges.
+    /// 
+    Graph &operator=(Graph &&other) noexcept {
+      if (this != &other) {
+        Graph taken(std::move(other));
+        swap(taken);
+      }
+      return *this;
+    }
+
+    /// Exchange the nodes and edges of this graph and @a other.
+    /// 
+    /// Node and Edge objects keep pointing at the graph they came from.
+    /// 
+    /// Complexity: O(1).
+    /// 
+    void swap(Graph &other) noexcept {
+      std::swap(num_nodes_, other.num_nodes_);
+      std::swap(num_edges_, other.num_edges_);
+      adjacency_arena_.swap(other.adjacency_arena_);
+      node_pool_.swap(other.node_pool_);
+      edge_pool_.swap(other.edge_pool_);
+      nodes_.swap(other.nodes_);
+      edges_.swap(other.edges_);
+    }
 
-      // Since edges_ and nodes_ store pointers to structs on the heap,
-      // we need to free that memory.
+    /// Exchange the contents of @a a and @a b, as a.swap(b).
+    friend void swap(Graph &a, Graph &b) noexcept {
+      a.swap(b);
+    }
 
-      for (size_type i = 0; i < num_nodes_; i++) {
-        delete nodes_[i];
+    /// Return a deep copy of this graph, whose copy constructor is
+    /// disabled.
+    /// @post result has the same nodes and edges, with the same indices
+    /// 
+    /// The copy gets pools and an arena of its own. Nodes and edges are
+    /// recreated in index order, so they are packed into the new slabs in
+    /// the same order, and each incidence set is copied from its sorted
+    /// source in one linear pass.
+    /// 
+    /// Complexity: O(num_nodes() + num_edges()).
+    /// 
+    Graph clone() const {
+      Graph g;
+      g.nodes_.reserve(nodes_.size());
+      g.edges_.reserve(edges_.size());
+      for (const internal_node *n : nodes_) {
+        internal_node *copy = g.node_pool_.create(n->position, g.arena());
+        copy->incident_edges.insert(n->incident_edges.begin(),
+                                    n->incident_edges.end());
+        g.nodes_.push_back(copy);
       }
-      for (size_type i = 0; i < num_edges_; i++) {
-        delete edges_[i];
+      for (const internal_edge *e : edges_) {
+        g.edges_.push_back(g.edge_pool_.create(e->one, e->two));
       }
+      g.num_nodes_ = num_nodes_;
+      g.num_edges_ = num_edges_;
+      return g;
     }
 
     // NODES
@@ -177,7 +257,7 @@ class Graph {
       // Just add a new internal_node to the end of nodes_ and
       // increment num_nodes_ after assigning the new node the old
       // value of num_nodes_ for its index.
-      nodes_.push_back(new internal_node(position));
+      nodes_.push_back(node_pool_.create(position, arena()));
       return Node(this, num_nodes_++);
     }
 
@@ -325,9 +405,9 @@ class Graph {
       }
 
       // If edge does not exist yet, wire it up in internal structures.
-      edges_.push_back(new internal_edge(a.index(), b.index()));
-      nodes_[a.index()]->incident_edges->insert(num_edges_);
-      nodes_[b.index()]->incident_edges->insert(num_edges_);
+      edges_.push_back(edge_pool_.create(a.index(), b.index()));
+      nodes_[a.index()]->incident_edges.insert(num_edges_);
+      nodes_[b.index()]->incident_edges.insert(num_edges_);
       return Edge(this, num_edges_++);
     }
 
@@ -339,6 +419,13 @@ class Graph {
     void clear() {
       nodes_.clear();
       edges_.clear();
+      // Destroy the nodes (and their sets) before releasing the arena
+      // their sets were allocated from.
+      node_pool_.clear();
+      edge_pool_.clear();
+      if (adjacency_arena_) {
+        adjacency_arena_->release();
+      }
       num_nodes_ = 0; num_edges_ = 0;
     }
 
@@ -353,14 +440,14 @@ class Graph {
     size_type find_edge(const Node &a, const Node &b) const {
 
       // Get the indices of the edges incident to a.
-      std::set<size_type> *a_edges = nodes_[a.index()]->incident_edges;
+      const incidence_set *a_edges = &nodes_[a.index()]->incident_edges;
 
       // Now search these indices to find the edge whose other endpoint
       // is b using the std::find_if function with a custom predicate.
       // References for find_if with custom predicates:
       //   http://www.cplusplus.com/reference/algorithm/find_if/
       //   https://stackoverflow.com/q/6679096/902812
-      std::set<size_type>::iterator it = std::find_if(
+      incidence_set::const_iterator it = std::find_if(
         a_edges->begin(), a_edges->end(), 
 
         // Use a lambda function for the custom predicate so that we
@@ -390,26 +477,34 @@ class Graph {
     // bullet of this section from Wikipedia on adjacency lists:
     // https://en.wikipedia.org/wiki/Adjacency_list#Implementation_details
 
+    // The arena the incidence sets allocate from, made by the first
+    // add_node() so that an empty Graph owns nothing.
+    std::pmr::memory_resource *arena() {
+      if (!adjacency_arena_) {
+        adjacency_arena_ =
+            std::make_unique<std::pmr::monotonic_buffer_resource>();
+      }
+      return adjacency_arena_.get();
+    }
+
+    // Set of incident edge indices, allocated from adjacency_arena_.
+    using incidence_set = std::pmr::set<size_type>;
+
     // Internal struct to bundle node data (Point) with a set of
     // indices of edges to which it's connected.
     struct internal_node {
 
-      // Constructor makes pointer to set that's stored on the heap.
-      internal_node(const Point &pos)
-          : position(pos), incident_edges(new std::set<size_type>()) {
-      }
-
-      // Free the heap memory.
-      ~internal_node() {
-        delete incident_edges;
+      // Constructor makes an empty set whose tree nodes are carved out
+      // of the Graph's adjacency arena.
+      internal_node(const Point &pos, std::pmr::memory_resource *arena)
+          : position(pos), incident_edges(arena) {
       }
 
       // Store node data.
       const Point position;
 
-      // Store a pointer to the set instead of the entire set in order
-      // to keep the amount of memory on the stack small.
-      std::set<size_type> *incident_edges; 
+      // Indices of the edges incident to this node.
+      incidence_set incident_edges; 
     };
 
     // Internal struct to store an edge.
@@ -428,6 +523,16 @@ class Graph {
     // to avoid casting results from nodes_.size() or edges_.size().
     size_type num_nodes_, num_edges_;
 
+    // Backing storage. Every incidence set allocates its tree nodes from
+    // adjacency_arena_, which hands out memory from a few geometrically
+    // growing blocks and frees them all at once. The internal_node and
+    // internal_edge structs themselves are packed into slabs. The arena is
+    // declared first so it outlives the sets that point into it, and held
+    // by pointer so that it stays put when the Graph is moved.
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> adjacency_arena_;
+    SlabPool<internal_node> node_pool_;
+    SlabPool<internal_edge> edge_pool_;
+
     // Positions associated with each node (access by index).
     std::vector<internal_node *> nodes_;
     std::vector<internal_edge *> edges_;
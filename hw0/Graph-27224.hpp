@@ -273,9 +273,7 @@ class Graph {
    */
   Edge edge(size_type i) const {
     // HW0: YOUR CODE HERE
-    size_type idx1 = edges_[i][0];
-    size_type idx2 = edges_[i][1];
-    return Edge(this, i, idx1, idx2);
+    return Edge(this, i, edges_[i].n1, edges_[i].n2);
   }
 
   /** Test whether two nodes are connected by an edge.
@@ -319,10 +317,7 @@ class Graph {
     if (has_edge(a, b)){
       return Edge(this, 0, idx1, idx2); // invalidate edge index
     } else {
-      std::vector<size_type> vertices;
-      vertices.push_back(idx1);
-      vertices.push_back(idx2);
-      edges_.push_back(vertices);
+      edges_.push_back(edge_nodes{idx1, idx2});
       ++n_edges_; 
       adj_[idx1].push_back(idx2); // update adjacency list
       return Edge(this, n_edges_-1, idx1, idx2);
@@ -350,7 +345,12 @@ class Graph {
   //   helper functions, data members, and so forth.
   std::vector<Point> nodes_;
   size_type n_nodes_;
-  std::vector<std::vector<size_type>> edges_;
+  // The two node indices of an edge, inline in one contiguous array
+  struct edge_nodes {
+    size_type n1;
+    size_type n2;
+  };
+  std::vector<edge_nodes> edges_;
   size_type n_edges_;
   std::map<size_type, std::vector<size_type>> adj_;
 
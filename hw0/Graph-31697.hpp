@@ -293,7 +293,7 @@ class Graph {
     // HW0: YOUR CODE HERE
     if (has_node(a) && has_node(b)) {
       Edge e;
-      std::vector<size_type> adj_a = adj_edges_.at(a.index());
+      const std::vector<size_type>& adj_a = adj_edges_.at(a.index());
       for (size_type i=0; i<adj_a.size(); i++) {
         e = edge(adj_a[i]);
         if (((a == e.node1()) && (b == e.node2())) || ((a == e.node2()) && (b == e.node1())))
@@ -319,7 +319,7 @@ class Graph {
     // HW0: YOUR CODE HERE
     if (has_node(a) && has_node(b) && !(a == b)) {
       Edge e;
-      std::vector<size_type> adj_a = adj_edges_.at(a.index());
+      const std::vector<size_type>& adj_a = adj_edges_.at(a.index());
       for (size_type i=0; i<adj_a.size(); i++) {
         e = edge(adj_a[i]);
         if (((a == e.node1()) && (b == e.node2())) || ((a == e.node2()) && (b == e.node1())))
@@ -6,11 +6,15 @@
  */
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <vector>
 #include <cassert>
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
+#include "common/edge_index.hpp"
 
 
 /** @class Graph
@@ -233,6 +237,8 @@ public:
         /** Construct an invalid Edge. */
         Edge(const Graph* g=nullptr) {
             graph = g;
+            n1 = n2 = uid = size_type(-1);
+            key_ = EdgeIndex<size_type>::make_key(n1, n2);
         }
 
         /** Return a node of this Edge */
@@ -253,12 +259,20 @@ public:
                 return Node();
         }
 
+        /** Return the canonical key of this edge,
+         * (min uid << 32) | max uid. Both orientations of an edge have the
+         * same key, and keys order edges by their smaller, then larger node.
+         */
+        std::uint64_t key() const {
+            return key_;
+        }
+
         /** Test whether this edge and @a e are equal.
          *
          * Equal edges represent the same undirected edge between two nodes.
          */
         bool operator==(const Edge &e) const {
-            return (e.node1()==node1()&&e.node2()==node2())||(e.node2()==node1()&&e.node1()==node2());
+            return (graph==e.graph)&&(key_==e.key_);
         }
 
         /** Test whether this edge is less than @a e in a global order.
@@ -267,41 +281,31 @@ public:
          * std::map<>. It need not have any interpretive meaning.
          */
         bool operator<(const Edge &e) const {
-            Node min1, min2, max1, max2;
-
-            if(node1()<node2()){
-                min1 = node1();
-                max1 = node2();
-            }
-            else{
-                min1 = node2();
-                max1 = node1();
-            }
-
-            if(e.node1()<e.node2()){
-                min2 = e.node1();
-                max2 = e.node2();
-            }
-            else{
-                min2 = e.node2();
-                max2 = e.node1();
-            }
-
-
-            return (min1<min2)||(min1==min2&&max1<max2);
+            if(graph!=e.graph)
+                return std::less<const Graph*>()(graph, e.graph);
+            return key_<e.key_;
         }
 
     private:
         // Allow Graph to access Edge's private member data and functions.
         friend class Graph;
+        friend struct std::hash<Edge>;
         const Graph* graph;
         size_type n1;
         size_type n2;
         size_type uid;
+        std::uint64_t key_; // key(), set once when the Edge is built
         // HW0: YOUR CODE HERE
         // Use this space to declare private data members and methods for Edge
         // that will not be visible to users, but may be useful within Graph.
         // i.e. Graph needs a way to construct valid Edge objects
+        Edge(const Graph* g, const internal_element_edge &e) {
+            graph = g;
+            uid = e.uid;
+            n1 = e.n1.uid;
+            n2 = e.n2.uid;
+            key_ = EdgeIndex<size_type>::make_key(n1, n2);
+        }
     };
 
     /** Return the total number of edges in the graph.
@@ -321,13 +325,7 @@ public:
     Edge edge(size_type i) const {
         // HW0: YOUR CODE HERE
         if(i<num_edges() && i>=0) {
-            Edge edge(this);
-            internal_element_edge e = edges[i];
-            edge.uid = i;
-            edge.n1 = e.n1.uid;
-            edge.n2 = e.n2.uid;
-
-            return edge;
+            return Edge(this, edges[i]);
         }
         else
             return Edge();
@@ -337,16 +335,11 @@ public:
      * @pre @a a and @a b are valid nodes of this graph
      * @return True if for some @a i, edge(@a i) connects @a a and @a b.
      *
-     * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+     * Complexity: O(1) expected.
      */
     bool has_edge(const Node &a, const Node &b) const {
         // HW0: YOUR CODE HERE
-        for(internal_element_edge e : edges){
-            if((e.n1==a && e.n2==b)||(e.n2==a && e.n1==b))
-                return true;
-        }
-
-        return false;
+        return edge_index.contains(a.uid, b.uid);
     }
 
     /** Add an edge to the graph, or return the current edge if it already exists.
@@ -359,20 +352,14 @@ public:
      * Can invalidate edge indexes -- in other words, old edge(@a i) might not
      * equal new edge(@a i). Must not invalidate outstanding Edge objects.
      *
-     * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+     * Complexity: O(1) amortized expected.
      */
     Edge add_edge(const Node &a, const Node &b) {
         // HW0: YOUR CODE HERE
 //        std::cout<<'Adding';
-        for(internal_element_edge e : edges){
-            if((e.n1==a && e.n2==b)||(e.n2==a && e.n1==b)){
-                Edge edge(this);
-                edge.uid = e.uid;
-                edge.n1 = e.n1.uid;
-                edge.n2 = e.n2.uid;
-
-                return edge;
-            }
+        auto found = edge_index.insert(a.uid, b.uid, edges.size());
+        if(!found.second){
+            return Edge(this, edges[found.first]);
         }
         internal_element_edge e;
         e.uid = edges.size();
@@ -380,12 +367,7 @@ public:
         e.n2 = b;
         edges.push_back(e);
 
-        Edge edge(this);
-        edge.uid = e.uid;
-        edge.n1 = e.n1.uid;
-        edge.n2 = e.n2.uid;
-
-        return edge;
+        return Edge(this, e);
     }
 
     /** Remove all nodes and edges from this graph.
@@ -399,6 +381,7 @@ public:
         begin_node_index = nodes.size();
         nodes.clear();
         edges.clear();
+        edge_index.clear();
     }
 
 private:
@@ -408,6 +391,8 @@ private:
     //   helper functions, data members, and so forth.
     std::vector<internal_element_node> nodes;
     std::vector<internal_element_edge> edges;
+    // packed (min uid, max uid) -> position in edges, for has_edge/add_edge
+    EdgeIndex<size_type> edge_index;
 
     size_type begin_node_index;
     size_type begin_edge_index;
@@ -424,4 +409,16 @@ private:
 
 };
 
+/** Hash of an Edge consistent with Edge::operator==, so edges can key
+ * unordered containers: both orientations of an edge hash alike. */
+namespace std {
+template <>
+struct hash<Graph::Edge> {
+    size_t operator()(const Graph::Edge &e) const {
+        uint64_t h = e.key() * 0x9E3779B97F4A7C15ull;
+        return size_t(h ^ (h >> 32)) ^ hash<const Graph*>()(e.graph);
+    }
+};
+}
+
 #endif // CME212_GRAPH_HPP
@@ -11,6 +11,7 @@
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
+#include "common/node_layout.hpp"
 
 
 /** @class Graph
@@ -18,8 +19,13 @@
  *
  * Users can add and retrieve nodes and edges. Edges are unique (there is at
  * most one edge between any pair of distinct nodes).
+ *
+ * @tparam V           Node value type
+ * @tparam NodeLayout  How positions and values are stored; see
+ *                     common/node_layout.hpp. The default keeps positions
+ *                     in a dense array apart from the values.
  */
-template <typename V>
+template <typename V, typename NodeLayout = split_node_layout>
 class Graph {
  private:
 
@@ -40,7 +46,6 @@ class Graph {
 
   /** Predeclaration of Node type. */
   class Node;
-  class nodeinfo;
   /** Synonym for Node (following STL conventions). */
   using node_type = Node;
   using node_value_type = V;
@@ -112,19 +117,19 @@ class Graph {
     Node() {
       // HW0: YOUR CODE HERE
       graph_ = NULL;
-      ptr_ = std::shared_ptr<nodeinfo>();
+      index_ = size_type(-1);
     }
 
     /** Return this node's position. */
     const Point& position() const {
       // HW0: YOUR CODE HERE
-      return ptr_->point;
+      return graph_->nodes_.position(index_);
     }
 
     /** Return this node's index, a number in the range [0, graph_size). */
     size_type index() const {
       // HW0: YOUR CODE HERE
-      return ptr_->index;
+      return index_;
     }
 
     // HW1: YOUR CODE HERE
@@ -136,7 +141,7 @@ class Graph {
      * Performs O(1) operations
      */
     node_value_type& value() {
-      return ptr_->value;
+      return graph_->nodes_.value(index_);
     }
 
     /** Constant function that returns the value associated with the node
@@ -146,7 +151,7 @@ class Graph {
      * Performs O(1) operations
      */
     const node_value_type& value() const {
-      return ptr_->value;
+      return graph_->nodes_.value(index_);
     }
 
     /** Returns the degree of the node
@@ -196,7 +201,7 @@ class Graph {
      */
     bool operator<(const Node& n) const {
       // HW0: YOUR CODE HERE
-      if (n.graph_==this->graph_) return n.ptr_<this->ptr_;
+      if (n.graph_==this->graph_) return n.index_<this->index_;
       else return n.graph_<this->graph_;
     }
 
@@ -204,11 +209,14 @@ class Graph {
     // Allow Graph to access Node's private member data and functions.
     friend class Graph;
     // HW0: YOUR CODE HERE
-    std::shared_ptr<Graph::nodeinfo> ptr_;
+    // A Node is just {graph, index}: copying one is two word copies and
+    // touches no reference count, which keeps iterator dereference cheap
+    // even when several threads walk the graph at once.
     Graph* graph_;
+    size_type index_;
     Node (const graph_type* g, const size_type &index){
       this->graph_ = const_cast<graph_type*>(g);
-      this->ptr_ = graph_->nodes_[index];
+      this->index_ = index;
     }
     // Use this space to declare private data members and methods for Node
     // that will not be visible to users, but may be useful within Graph.
@@ -239,7 +247,7 @@ class Graph {
   Node add_node(const Point& position, const node_value_type& value = node_value_type()) {
     // HW0: YOUR CODE HERE
     size_type index = this->nodes_.size();
-    this->nodes_.push_back(std::shared_ptr<nodeinfo>(new nodeinfo(position, index, value)));
+    this->nodes_.push_back(position, value);
     this->adj_.push_back(std::vector<edgeinfo>());
     return Node(this, index);
   }
@@ -343,26 +351,20 @@ class Graph {
 
   /** Return the total number of edges in the graph.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(1)
    */
   size_type num_edges() const {
-    size_type num = 0;
-    for (auto it = adj_.begin(); it != adj_.end(); ++it) {
-      num += (*it).size();
-    }
-    return num / 2;
+    return edges_.size();
   }
 
   /** Return the edge with index @a i.
    * @pre 0 <= @a i < num_edges()
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(1)
    */
   Edge edge(size_type i) const {
     // HW0: YOUR CODE HERE
-    auto it = edge_begin();
-    for (size_type c = 0; c < i and it != edge_end(); ++it, ++c) {}
-    return (*it);
+    return Edge(this, edges_[i].index, edges_[i].offset);
   }
 
   /** Test whether two nodes are connected by an edge.
@@ -411,9 +413,8 @@ class Graph {
     adj_[idx1].push_back(edgeinfo(idx2, offset2));
     adj_[idx2].push_back(edgeinfo(idx1, offset1));
 
-    // if (a<b) edges_.push_back(Edge(this, idx1, offset1));
-    // else edges_.push_back(Edge(this, idx2, offset2));
-    // return edges_[-1];
+    if (idx1 < idx2) edges_.push_back(edgeinfo(idx1, offset1));
+    else edges_.push_back(edgeinfo(idx2, offset2));
     if (a<b) return Edge(this, idx1, offset1);
     else return Edge(this, idx2, offset2);
   }
@@ -427,7 +428,7 @@ class Graph {
     // HW0: YOUR CODE HERE
     nodes_.clear();
     adj_.clear();
-    // edges_.clear();
+    edges_.clear();
   }
 
   //
@@ -608,7 +609,7 @@ class Graph {
      * Complexity: O(1)
      */
     Edge operator*() const{
-      return Edge(graph_, row_, col_);
+      return graph_->edge(pos_);
     }
 
     /** Move forward the iterator
@@ -617,8 +618,7 @@ class Graph {
      * Complexity: O(1)
      */
     EdgeIterator& operator++(){
-      col_++;
-      find_next();
+      pos_++;
       return (*this);
     }
 
@@ -629,32 +629,18 @@ class Graph {
      * Complexity: O(1)
      */
     bool operator==(const EdgeIterator& eit) const{
-        return eit.graph_ == graph_ and 
-               row_ == eit.row_ and col_ == eit.col_;
+        return eit.graph_ == graph_ and pos_ == eit.pos_;
     }
 
    private:
     friend class Graph;
     // HW1 #5: YOUR CODE HERE
     Graph* graph_;
-    size_type row_;
-    size_type col_;
-
-    void find_next() {
-      if (row_ == graph_->adj_.size()) return;
-      for (;row_ < graph_->size(); ++row_) {
-        for (;col_ < (graph_->adj_[row_]).size(); ++col_) {
-          if (row_ < (graph_->adj_[row_][col_]).index) return;
-        }
-        col_ = 0;
-      }
-    }
+    size_type pos_; // index into graph_->edges_
 
-    EdgeIterator(const Graph* g, size_type r, size_type c) {
+    EdgeIterator(const Graph* g, size_type p) {
       graph_ = const_cast<Graph*>(g);
-      row_ = r;
-      col_ = c;
-      find_next();
+      pos_ = p;
     }
   };
 
@@ -667,7 +653,7 @@ class Graph {
    * Complexity: O(1)
    */
   edge_iterator edge_begin() const {
-    return EdgeIterator(this, 0, 0);
+    return EdgeIterator(this, 0);
   }
 
   /** Returns an edge iterator at the `end` position
@@ -676,18 +662,9 @@ class Graph {
    * Complexity: O(1)
    */
   edge_iterator edge_end() const {
-    return EdgeIterator(this, size(), 0);
+    return EdgeIterator(this, num_edges());
   }
 
- 
-  class nodeinfo {
-    Point point;
-    size_type index;
-    node_value_type value;
-    friend class Graph;
-    nodeinfo(const Point &p, size_type i, node_value_type v): 
-              point(p), index(i), value(v) {}
-  };
 
   class edgeinfo {
     size_type index; // adjacent node index
@@ -700,13 +677,16 @@ class Graph {
     // HW0: YOUR CODE HERE
     // Use this space for your Graph class's internals:
     //   helper functions, data members, and so forth.
-    std::vector<std::shared_ptr<nodeinfo>> nodes_;
+    // Position and value of node i at index i, laid out by NodeLayout
+    typename NodeLayout::template storage<Point, node_value_type> nodes_;
     std::vector<std::vector<edgeinfo>> adj_; //each node has a collection of edges
     // here adj_[i][j] denotes the edge information for the j th edge for node_i
     // if we define this edge as (node_i, node_i1), adj_[i][j] will stores:
     // adj_[i][j].index == i1
     // adj_[i][j].offset == k, where adj_[i1][k] refers to the same edge
-    // std::vector<edge_type> edges_;
+    std::vector<edgeinfo> edges_; // one entry per edge, in insertion order
+    // edges_[e].index is the smaller endpoint i and edges_[e].offset the
+    // edge's position j in adj_[i], so edge iteration visits each edge once
 };
 
 #endif // CME212_GRAPH_HPP
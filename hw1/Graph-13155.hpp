@@ -10,6 +10,7 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <vector>
 
@@ -27,6 +28,8 @@ class Graph {
  private:
   //Declare struct to hold the point and value of a node
   struct NodeInfo;
+  //Declare struct to hold one entry of a node's connections
+  struct NodeConnection;
 
  public:
   //
@@ -213,7 +216,7 @@ class Graph {
     this->nodes_.push_back(n);
 
     //Each Node needs to be initialized in nodeConnections for Edge management
-    this->nodeConnections_.push_back(std::vector<std::vector<size_type> >());
+    this->nodeConnections_.push_back(std::vector<NodeConnection>());
     
     return addedNode;
   }
@@ -358,10 +361,9 @@ class Graph {
 
     //Iterate through the node connectivity matrix to see if the two nodes
     //are already connected
-    for (size_type iter = 0;
-	 iter < this->nodeConnections_[a.index()].size(); iter++)
+    for (const NodeConnection& c : this->nodeConnections_[a.index()])
       {
-	if (this->nodeConnections_[a.index()][iter][0] == b.index())
+	if (c.node_ == b.index())
 	  return true;
       }
     
@@ -391,13 +393,12 @@ class Graph {
     //If it is, find the Edge and return it. If not, create a new Edge
     if (has_edge(a,b))
       {
-	size_type foundEdgeIdx;
-	for (size_type iter = 0;
-	     iter < this->nodeConnections_[a.index()].size(); iter++)
+	size_type foundEdgeIdx = 0;
+	for (const NodeConnection& c : this->nodeConnections_[a.index()])
 	  {
-	    if (this->nodeConnections_[a.index()][iter][0] == b.index())
+	    if (c.node_ == b.index())
 	      {
-		foundEdgeIdx = this->nodeConnections_[a.index()][iter][1];
+		foundEdgeIdx = c.edge_;
 	      }
 	  }
 	return Edge(this,foundEdgeIdx,a.index(),b.index());
@@ -408,13 +409,13 @@ class Graph {
 	Edge addedEdge(this, this->num_edges(), a.index(), b.index());
 
 	//Add the edge connection to the node connectivity vector
-	std::vector<size_type> temp1 = {b.index(),this->num_edges()};
+	NodeConnection temp1 = {b.index(),this->num_edges()};
 	this->nodeConnections_[a.index()].push_back(temp1);
-	std::vector<size_type> temp2 = {a.index(),this->num_edges()};
+	NodeConnection temp2 = {a.index(),this->num_edges()};
 	this->nodeConnections_[b.index()].push_back(temp2);
 	
 	// Add the edge to the vector of Node index pairs
-	std::vector<size_type> temp3 = {a.index(), b.index()};
+	std::array<size_type, 2> temp3 = {a.index(), b.index()};
 	this->edges_.push_back(temp3);
 	
 	return addedEdge;
@@ -529,10 +530,10 @@ class Graph {
     /** Return the current Edge of this IncidentIterator */
     Edge operator*() const
     {
-      std::vector<size_type> edgeInfo =
+      const NodeConnection& edgeInfo =
 	this->graph_->nodeConnections_[rootNodeIndex_][idx_];
 
-      return Edge(this->graph_, edgeInfo[1], rootNodeIndex_, edgeInfo[0]);
+      return Edge(this->graph_, edgeInfo.edge_, rootNodeIndex_, edgeInfo.node_);
     }
 
     /** Increment this IncidentIterator to the next Edge connected to the node
@@ -658,21 +659,27 @@ class Graph {
   //A vector of Points that coorespond to the Nodes in the graph
   std::vector<NodeInfo> nodes_;
 
-  //Vector to hold the edges. The inner vector of size_types contains
+  //Vector to hold the edges. Each array contains
   //indices for nodes a and b for each edge
-  std::vector<std::vector<size_type> > edges_;
+  std::vector<std::array<size_type, 2> > edges_;
   
-  //Vector of all Nodes. Each node has an associated vector of vectors.
-  //The inner most vector contains the index of a Node connected to the
-  //original Node and the edge that connects them.
+  //Vector of all Nodes. Each node has an associated vector of
+  //NodeConnections, stored back to back: the index of a Node connected
+  //to the original Node and the edge that connects them.
   //Node A:<  <NodeB1, EdgeIndex1>, <NodeB2, EdgeIndex2> ... >
-  std::vector<std::vector<std::vector<size_type> > > nodeConnections_;
+  std::vector<std::vector<NodeConnection> > nodeConnections_;
 
   //Struct to hold the point and value of a node
   struct NodeInfo {
     Point position_;
     V value_;
   };  
+
+  //Struct to hold a connected Node and the edge that connects them
+  struct NodeConnection {
+    size_type node_;
+    size_type edge_;
+  };
 };
 
 #endif // CME212_GRAPH_HPP
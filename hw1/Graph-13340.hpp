@@ -10,6 +10,7 @@
 #include <tuple>
 #include <cassert>
 
+#include "common/segmented_array.hpp"
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
 
@@ -605,9 +606,11 @@ class Graph {
     size_type node2_uid;
   };
 
-  // STL containers for internal_nodes and internal_edges
-  std::vector<internal_node> nodes_;
-  std::vector<internal_edge> edges_;
+  // STL containers for internal_nodes and internal_edges; with
+  // CME212_RELOCATING_STORAGE, both are plain bytes for a trivially
+  // copyable V and grow without moving elements one by one
+  graph_storage<internal_node> nodes_;
+  graph_storage<internal_edge> edges_;
   std::vector<std::vector<std::tuple<size_type, size_type>>> adj_;
 
   //counters for constructor
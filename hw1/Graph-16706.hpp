@@ -9,6 +9,7 @@
 #include <vector>
 #include <cassert>
 
+#include "common/segmented_array.hpp"
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
 
@@ -210,7 +211,8 @@ class Graph {
    * @post new num_nodes() == old num_nodes() + 1
    * @post result_node.index() == old num_nodes()
    *
-   * Complexity: O(1) amortized operations.
+   * Complexity: O(1) amortized operations. With CME212_SEGMENTED_STORAGE,
+   * existing nodes are never moved.
    */
   Node add_node(const Point& position, const node_value_type& value = node_value_type()) {
     // HW0: YOUR CODE HERE
@@ -508,8 +510,10 @@ class Graph {
     size_type node2_index;
   };
 
-  std::vector<internal_node> nodes_;
-  std::vector<internal_edge> edges_;
+  // std::vector, or SegmentedArray with CME212_SEGMENTED_STORAGE, whose
+  // elements never move as the graph grows
+  graph_storage<internal_node> nodes_;
+  graph_storage<internal_edge> edges_;
 
 };
 
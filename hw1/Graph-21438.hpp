@@ -10,6 +10,7 @@
 #include <cassert>
 #include <unordered_map>
 
+#include "common/graph_range.hpp"
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
 
@@ -29,6 +30,9 @@ class Graph {
  // later in the Graph's definition.
  // (As with all the "YOUR CODE HERE" markings, you may not actually NEED
  // code here. Just use the space if you need it.)
+
+ // Entry of an adjacency row, defined with the graph's data below
+ struct InternalEdge;
  public:
  //
  // PUBLIC TYPE DEFINITIONS
@@ -62,6 +66,14 @@ class Graph {
   /** Synonym for IncidentIterator */
   using incident_iterator = IncidentIterator;
 
+  /** Type of neighbor iterators, which iterate over the nodes adjacent to
+      a node. */
+  class NeighborIterator;
+  /** Synonym for NeighborIterator */
+  using neighbor_iterator = NeighborIterator;
+  /** Range returned by Node::neighbors(), see common/graph_range.hpp. */
+  using neighbor_range = GraphRange<NeighborIterator>;
+
   /** Type of indexes and sizes.
       Return type of Graph::Node::index(), Graph::num_nodes(),
       Graph::num_edges(), and argument type of Graph::node(size_type) */
@@ -184,6 +196,37 @@ class Graph {
      return IncidentIterator(*this, this->degree());
    }
 
+    /** Return an iterator to the first node adjacent to this node
+    * @pre Node is valid
+    * @post If degree() > 0, *result == (*edge_begin()).node2()
+    *
+    * Reads the neighbor index straight from the adjacency row, without
+    * building an Edge.
+    **/
+    neighbor_iterator neighbor_begin() const {
+      return NeighborIterator(graph_, graph_->internal_edges[id_].data());
+    }
+
+    /** Return an iterator one past the last node adjacent to this node
+    * @pre Node is valid
+    */
+    neighbor_iterator neighbor_end() const {
+      const std::vector<InternalEdge>& row = graph_->internal_edges[id_];
+      return NeighborIterator(graph_, row.data() + row.size());
+    }
+
+    /** Return the nodes adjacent to this node, node2() of every incident
+    * edge in the same order, as a range of degree() Nodes
+    *
+    * @code
+    * for(auto n : node.neighbors())
+    *   sum += n.position();
+    * @endcode
+    **/
+    neighbor_range neighbors() const {
+      return neighbor_range(neighbor_begin(), neighbor_end(), degree());
+    }
+
     /** Test whether this node and @a n are equal.
      *
      * Equal nodes have the same graph and the same index.
@@ -255,8 +298,7 @@ class Graph {
   Node add_node(const Point& position, const node_value_type& val = node_value_type()){
     InternalNode n = {position, val};
     internal_nodes.push_back(n);
-    std::vector<InternalEdge> new_edges {};
-    internal_edges.push_back(new_edges);
+    internal_edges.emplace_back();
     return Node(this, this->size()-1);
   }
 
@@ -306,7 +348,7 @@ class Graph {
 
     /** Return the other node of this Edge */
     Node node2() const {
-      return graph_->internal_edges[n1_.get_id()][id_].n2_;
+      return Node(graph_, graph_->internal_edges[n1_.get_id()][id_].n2_);
     }
 
     /** Test whether this edge and @a e are equal.
@@ -382,8 +424,8 @@ class Graph {
     bool has_edge(const Node& a, const Node& b) const {
       // Iterate over all the internal edges, checking each to see
       // if any has endpoints @a a and @a b
-      for(auto e : internal_edges[a.get_id()]){
-        if(e.n2_ == b){
+      for(const InternalEdge& e : internal_edges[a.get_id()]){
+        if(e.n2_ == b.get_id()){
           return true;  
          }
        }    
@@ -408,7 +450,7 @@ class Graph {
      // returning a proxy associated with the InternalEdge with
      // endpoints a and b if such an InternalEdge exists
      for(size_type i = 0; i < a.degree(); ++i){
-        if(internal_edges[a.get_id()][i].n2_ == b){
+        if(internal_edges[a.get_id()][i].n2_ == b.get_id()){
           return Edge(a, i);
         }
       }
@@ -416,8 +458,8 @@ class Graph {
      // we need to add it, increment num_edges_
      // and return a proxy associated with it
   
-     internal_edges[a.get_id()].push_back(InternalEdge(a,b));
-     internal_edges[b.get_id()].push_back(InternalEdge(b,a));
+     internal_edges[a.get_id()].push_back(InternalEdge{b.get_id()});
+     internal_edges[b.get_id()].push_back(InternalEdge{a.get_id()});
      ++num_edges_;
      return Edge(a, internal_edges[a.get_id()].size() - 1);
     }
@@ -601,6 +643,65 @@ class Graph {
     IncidentIterator(const node_type node, size_type id = 0) : id_(id), node_(node) {}
   };
 
+  //
+  // Neighbor Iterator
+  //
+
+  /** @class Graph::NeighborIterator
+   * @brief Iterator over the nodes adjacent to one node, from
+   *        Node::neighbor_begin() or Node::neighbors(). A forward iterator
+   *        yielding Nodes by value. */
+  class NeighborIterator : private totally_ordered<NeighborIterator> {
+   public:
+    using value_type        = Node;
+    using pointer           = void;
+    using reference         = Node;                     // Proxy, by value
+    using difference_type   = std::ptrdiff_t;
+    using iterator_category = std::input_iterator_tag;  // Weak Category, Proxy
+
+    /** Construct an invalid NeighborIterator. */
+    NeighborIterator() {
+    }
+
+    /** Return the adjacent node this iterator points to
+     * @pre NeighborIterator is not one past the end
+     */
+    Node operator*() const {
+      return Node(graph_, entry_->n2_);
+    }
+
+    /** Increment the NeighborIterator
+     * @pre NeighborIterator is not one past the end
+     */
+    NeighborIterator& operator++() {
+      ++entry_;
+      return *this;
+    }
+
+    /** Return the index of the adjacent node, without building a Node.
+     * @pre NeighborIterator is not one past the end
+     */
+    size_type index() const {
+      return entry_->n2_;
+    }
+
+    bool operator==(const NeighborIterator& nit) const {
+      return entry_ == nit.entry_;
+    }
+
+    bool operator<(const NeighborIterator& nit) const {
+      return entry_ < nit.entry_;
+    }
+
+   private:
+    friend class Graph;
+    const graph_type* graph_ = nullptr;
+    const InternalEdge* entry_ = nullptr;
+
+    NeighborIterator(const graph_type* graph, const InternalEdge* entry)
+        : graph_(graph), entry_(entry) {}
+  };
+
   //
   // Edge Iterator
   //
@@ -750,12 +851,11 @@ class Graph {
      InternalNode(Point pos, V val) : p(pos), value(val) {}
    };
 
+   // One entry of an adjacency row: the index of the other node. The
+   // node whose row it is in is implied, so an entry is a single index
+   // rather than two Node proxies.
    struct InternalEdge{
-     node_type n1_;
-     node_type n2_;
-
-     InternalEdge(Node n1, Node n2) : n1_(n1), n2_(n2) {}
-
+     size_type n2_;
    };
    // We store the internal objects in vectors for simplicity.
    // For the edges, an unordered map keyed by the endpoints
@@ -776,7 +876,7 @@ class Graph {
    }
 
    const InternalEdge& fetch_edge(const Node& n, size_type id) const{
-     assert (0 <= id && id < num_edges_);
+     assert (0 <= id && id < n.degree());
      return internal_edges[n.get_id()].at(id);
    }
 
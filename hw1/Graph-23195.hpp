@@ -6,9 +6,11 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <vector>
 #include <cassert>
 
+#include "common/segmented_array.hpp"
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
 
@@ -68,9 +70,9 @@ class Graph {
   
   struct internal_node;
   struct internal_edge;
-  typedef typename std::vector<internal_node>::const_iterator NodeIterator_InternalNodeIterator;
-  typedef typename std::vector<size_type>::const_iterator IncidentIterator_InternalEdgelistIterator;
-  typedef typename std::vector<internal_edge>::const_iterator EdgeIterator_InternalEdgeIterator;
+  struct incidence_block;
+  typedef typename ConcurrentAppendArray<internal_node>::const_iterator NodeIterator_InternalNodeIterator;
+  typedef typename SegmentedArray<internal_edge>::const_iterator EdgeIterator_InternalEdgeIterator;
 
  public: 
   //
@@ -140,11 +142,11 @@ class Graph {
     
     /** Construction for the begin and end iterator for incident iterator. */
     incident_iterator edge_begin() const {
-      return IncidentIterator(graph_, id_, graph_->nodes_[id_].edgelist.begin());
+      return IncidentIterator(graph_, id_, 0, graph_->block(graph_->nodes_[id_].edgelist.first));
     }
     
     incident_iterator edge_end() const {
-      return IncidentIterator(graph_, id_, graph_->nodes_[id_].edgelist.end());
+      return IncidentIterator(graph_, id_, degree(), nullptr);
     }
 
     /** Test whether this node and @a n are equal.
@@ -200,14 +202,19 @@ class Graph {
    * @post new num_nodes() == old num_nodes() + 1
    * @post result_node.index() == old num_nodes()
    *
-   * Complexity: O(1) amortized operations.
+   * Any number of threads may add nodes at once, without locks, alongside
+   * the one thread that adds edges. Each call then reserves the next
+   * index, so the postconditions hold per call only when nobody else adds:
+   * the returned node is usable by its caller right away, and is counted
+   * by num_nodes() once every node with a smaller index is, too.
+   *
+   * Complexity: O(1), wait-free.
    */
   Node add_node(const Point& position, const node_value_type& value = node_value_type()) {
     internal_node new_node;
     new_node.point = position;
     new_node.value = value;
-    nodes_.push_back(new_node);
-    return Node(this, size_type(nodes_.size()-1));
+    return Node(this, size_type(nodes_.append(new_node)));
   }
 
   /** Determine if a Node belongs to this Graph
@@ -356,8 +363,8 @@ class Graph {
     new_edge.v2 = std::max(a.id_, b.id_);
     edges_.push_back(new_edge);
     size_type last_edge_id = edges_.size() - 1;
-    this->nodes_[a.id_].edgelist.push_back(last_edge_id);
-    this->nodes_[b.id_].edgelist.push_back(last_edge_id);
+    this->append_incidence(a.id_, last_edge_id);
+    this->append_incidence(b.id_, last_edge_id);
     return Edge(this, last_edge_id);
   }
 
@@ -369,6 +376,7 @@ class Graph {
   void clear() {
     nodes_.clear();
     edges_.clear();
+    blocks_.clear();
   }
 
   //
@@ -444,21 +452,26 @@ class Graph {
     using iterator_category = std::input_iterator_tag;  // Weak Category, Proxy
 
     /** Construct an invalid IncidentIterator. */
-    IncidentIterator() : graph_(nullptr), node_id_(size_type(0)), p_(){
+    IncidentIterator() : graph_(nullptr), node_id_(size_type(0)), pos_(0), slot_(0), block_(nullptr){
     }
 
     /** Operations for IncidentIterator Class. */    
     Edge operator*() const {
-      return Edge(graph_, *p_, graph_->edges_[*p_].v1 != node_id_);
+      size_type e = block_->edge[slot_];
+      return Edge(graph_, e, graph_->edges_[e].v1 != node_id_);
     }
     
     IncidentIterator& operator++() {
-      ++p_; 
+      ++pos_;
+      if (++slot_ == block_size) {
+        slot_ = 0;
+        block_ = graph_->block(block_->next);
+      }
       return (*this);
     }
     
     bool operator==(const IncidentIterator& ii) const {
-      return (p_ == ii.p_);
+      return (pos_ == ii.pos_);
     }
 
    private:
@@ -467,12 +480,14 @@ class Graph {
     /** Private variables for IncidentIterator Class. */
     Graph* graph_;
     size_type node_id_;
-    IncidentIterator_InternalEdgelistIterator p_;
+    size_type pos_;     // position in the node's incidence list
+    size_type slot_;    // pos_ % block_size
+    const incidence_block* block_;  // block holding position pos_
     
     /** Private Constructor for IncidentIterator Class. */
     IncidentIterator(const Graph* graph, size_type node_id, 
-                     IncidentIterator_InternalEdgelistIterator  p0)
-        : graph_(const_cast<Graph*>(graph)), node_id_(node_id), p_(p0) {
+                     size_type pos, const incidence_block* block)
+        : graph_(const_cast<Graph*>(graph)), node_id_(node_id), pos_(pos), slot_(0), block_(block) {
     }
   };
 
@@ -531,20 +546,322 @@ class Graph {
     return edge_iterator(this, this->edges_.end());
   }
 
+  //
+  // Snapshots
+  //
+
+  /** @class Graph::Snapshot
+   * @brief Immutable view of the graph as it was when snapshot() was called.
+   *
+   * A snapshot holds only the node and edge counts at that moment. Storage
+   * is add-only and chunked, so the elements it covers never move and it can
+   * be read from any number of threads while writers keep calling
+   * add_node() and add_edge(). Nodes and edges added later are invisible to
+   * it, including in the incident edges of older nodes.
+   *
+   * The writer must not change the value of a node it has published, and
+   * clear() or destroying the graph invalidates every snapshot.
+   */
+  class Snapshot {
+   public:
+    class Node;
+    class Edge;
+    class IncidentIterator;
+
+    /** Construct an empty snapshot. */
+    Snapshot() : graph_(nullptr), num_nodes_(0), num_edges_(0) {
+    }
+
+    /** Return the number of nodes in the snapshot. */
+    size_type size() const {
+      return num_nodes_;
+    }
+
+    /** Synonym for size(). */
+    size_type num_nodes() const {
+      return num_nodes_;
+    }
+
+    /** Return the number of edges in the snapshot. */
+    size_type num_edges() const {
+      return num_edges_;
+    }
+
+    /** Return the node with index @a i.
+     * @pre 0 <= @a i < num_nodes() */
+    Node node(size_type i) const {
+      assert(i < num_nodes_);
+      return Node(this, i);
+    }
+
+    /** Return the edge with index @a i.
+     * @pre 0 <= @a i < num_edges() */
+    Edge edge(size_type i) const {
+      assert(i < num_edges_);
+      return Edge(this, i, false);
+    }
+
+    /** Test whether two nodes are connected by an edge of the snapshot.
+     *
+     * Complexity: O(a.degree()).
+     */
+    bool has_edge(const Node& a, const Node& b) const {
+      for (auto ei = a.edge_begin(); ei != a.edge_end(); ++ei) {
+        if ((*ei).node2() == b) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /** @class Graph::Snapshot::Node
+     * @brief Read-only node of a snapshot. */
+    class Node : private totally_ordered<Node> {
+     public:
+      Node() : snap_(nullptr), id_(0) {
+      }
+      const Point& position() const {
+        return snap_->graph_->nodes_.load(id_).point;
+      }
+      size_type index() const {
+        return id_;
+      }
+      const node_value_type& value() const {
+        return snap_->graph_->nodes_.load(id_).value;
+      }
+      /** Return the number of incident edges in the snapshot, the count
+       * edge_begin() walks.
+       *
+       * Complexity: O(1) while no edge has been added since the snapshot,
+       * O(degree) otherwise.
+       */
+      size_type degree() const {
+        const Graph* g = snap_->graph_;
+        size_type d = g->nodes_.load(id_).edgelist.published_size();
+        // Edges are counted before their entries are published, so if none
+        // is newer than the snapshot, every entry counted in d is in it
+        if (g->edges_.size() == snap_->num_edges_)
+          return d;
+        d = 0;
+        for (auto ei = edge_begin(); ei != edge_end(); ++ei) {
+          ++d;
+        }
+        return d;
+      }
+      IncidentIterator edge_begin() const {
+        const incidence_list& list = snap_->graph_->nodes_.load(id_).edgelist;
+        // The count is loaded before first, which it publishes
+        size_type count = list.published_size();
+        return IncidentIterator(snap_, id_, count, snap_->graph_->shared_block(list.first));
+      }
+      IncidentIterator edge_end() const {
+        return IncidentIterator(snap_, id_, 0, nullptr);
+      }
+      bool operator==(const Node& n) const {
+        return (snap_ == n.snap_) && (id_ == n.id_);
+      }
+      bool operator<(const Node& n) const {
+        return (snap_ == n.snap_) ? (id_ < n.id_) : (snap_ < n.snap_);
+      }
+
+     private:
+      friend class Snapshot;
+      const Snapshot* snap_;
+      size_type id_;
+      Node(const Snapshot* snap, size_type id) : snap_(snap), id_(id) {
+      }
+    };
+
+    /** @class Graph::Snapshot::Edge
+     * @brief Read-only edge of a snapshot. */
+    class Edge : private totally_ordered<Edge> {
+     public:
+      Edge() : snap_(nullptr), id_(0), ifflip_(false) {
+      }
+      Node node1() const {
+        const internal_edge& e = snap_->graph_->edges_.load(id_);
+        return Node(snap_, ifflip_ ? e.v2 : e.v1);
+      }
+      Node node2() const {
+        const internal_edge& e = snap_->graph_->edges_.load(id_);
+        return Node(snap_, ifflip_ ? e.v1 : e.v2);
+      }
+      bool operator==(const Edge& e) const {
+        return (snap_ == e.snap_) && (id_ == e.id_);
+      }
+      bool operator<(const Edge& e) const {
+        return (snap_ == e.snap_) ? (id_ < e.id_) : (snap_ < e.snap_);
+      }
+
+     private:
+      friend class Snapshot;
+      const Snapshot* snap_;
+      size_type id_;
+      bool ifflip_;
+      Edge(const Snapshot* snap, size_type id, bool ifflip)
+          : snap_(snap), id_(id), ifflip_(ifflip) {
+      }
+    };
+
+    /** @class Graph::Snapshot::IncidentIterator
+     * @brief Iterator over the edges of a snapshot incident to a node, in
+     * the order they were added. A forward iterator. */
+    class IncidentIterator : private totally_ordered<IncidentIterator> {
+     public:
+      using value_type        = Edge;
+      using pointer           = Edge*;
+      using reference         = Edge&;
+      using difference_type   = std::ptrdiff_t;
+      using iterator_category = std::input_iterator_tag;
+
+      IncidentIterator() : snap_(nullptr), node_id_(0), pos_(0), slot_(0), count_(0), block_(nullptr) {
+      }
+      Edge operator*() const {
+        size_type e = current();
+        return Edge(snap_, e, snap_->graph_->edges_.load(e).v1 != node_id_);
+      }
+      IncidentIterator& operator++() {
+        ++pos_;
+        if (++slot_ == block_size && pos_ < count_) {
+          slot_ = 0;
+          block_ = snap_->graph_->shared_block(block_->next);
+        }
+        return (*this);
+      }
+      /** Iterators are equal at the same position, and every iterator
+       * past the snapshot's last incident edge equals edge_end(). */
+      bool operator==(const IncidentIterator& ii) const {
+        bool done = at_end(), ii_done = ii.at_end();
+        return (done || ii_done) ? (done && ii_done) : (pos_ == ii.pos_);
+      }
+
+     private:
+      friend class Snapshot;
+      const Snapshot* snap_;
+      size_type node_id_;
+      size_type pos_;
+      size_type slot_;   // pos_ % block_size
+      size_type count_;  // entries published when the walk started
+      const incidence_block* block_;
+
+      IncidentIterator(const Snapshot* snap, size_type node_id,
+                       size_type count, const incidence_block* block)
+          : snap_(snap), node_id_(node_id), pos_(0), slot_(0), count_(count), block_(block) {
+      }
+      size_type current() const {
+        return block_->edge[slot_];
+      }
+      // Entries of every list are in increasing edge order, so the walk
+      // ends at the first edge newer than the snapshot
+      bool at_end() const {
+        return pos_ >= count_ || current() >= snap_->num_edges_;
+      }
+    };
+
+   private:
+    friend class Graph;
+    const Graph* graph_;
+    size_type num_nodes_;
+    size_type num_edges_;
+
+    Snapshot(const Graph* graph, size_type num_nodes, size_type num_edges)
+        : graph_(graph), num_nodes_(num_nodes), num_edges_(num_edges) {
+    }
+  };
+
+  /** Return a snapshot of the graph's current nodes and edges.
+   *
+   * Safe to call from the writer thread while readers use earlier
+   * snapshots; the snapshot can then be handed to reader threads.
+   *
+   * Complexity: O(1).
+   */
+  Snapshot snapshot() const {
+    // Edges first: every edge counted has both endpoints among the nodes
+    // counted after it
+    size_type m = edges_.size();
+    size_type n = nodes_.size();
+    return Snapshot(this, n, m);
+  }
+
  private:  
+  /** Number of incident edge indices per incidence block. */
+  static constexpr size_type block_size = 7;
+  /** Marks the absence of a block. */
+  static constexpr size_type no_block = size_type(-1);
+
+  /** A node's incident edge indices, in insertion order, in a chain of
+   * blocks. @a count is the writer's own length; @a published is stored
+   * after the entry it adds is written, so a snapshot reader can walk the
+   * first published_size() entries while edges are appended. */
+  struct incidence_list {
+    size_type first = no_block;
+    size_type last = no_block;
+    size_type count = 0;
+    std::atomic<size_type> published{0};
+
+    incidence_list() = default;
+    incidence_list(const incidence_list& x)
+        : first(x.first), last(x.last), count(x.count), published(x.count) {
+    }
+    size_type size() const {
+      return count;
+    }
+    size_type published_size() const {
+      return published.load(std::memory_order_acquire);
+    }
+  };
+
   /** Internal type for node and edge.  */
   struct internal_node {
     Point point;
     node_value_type value;
-    std::vector<size_type> edgelist;
+    incidence_list edgelist;
   };
   struct internal_edge {
     size_type v1, v2;
   };
+  /** block_size incident edge indices and the index of the next block. */
+  struct incidence_block {
+    size_type edge[block_size];
+    size_type next = no_block;
+  };
   
-  /** Private variables @a nodes_ and @a edges_ for Graph class. */
-  std::vector<internal_node> nodes_;
-  std::vector<internal_edge> edges_;
+  /** Private variables @a nodes_ and @a edges_ for Graph class. Chunked
+   * storage, so elements never move and snapshots can read them while the
+   * graph grows. Nodes may come from several threads at once. */
+  ConcurrentAppendArray<internal_node> nodes_;
+  SegmentedArray<internal_edge> edges_;
+  SegmentedArray<incidence_block> blocks_;
+
+  /** Return block @a b, or nullptr for no_block. Blocks never move, so
+   * iterators keep the pointer. */
+  const incidence_block* block(size_type b) const {
+    return (b == no_block) ? nullptr : &blocks_[b];
+  }
+  /** block() for snapshot readers. */
+  const incidence_block* shared_block(size_type b) const {
+    return (b == no_block) ? nullptr : &blocks_.load(b);
+  }
+
+  /** Append edge @a e to the incidence list of node @a n. */
+  void append_incidence(size_type n, size_type e) {
+    incidence_list& list = nodes_[n].edgelist;
+    size_type d = list.count;
+    if (d % block_size == 0) {
+      blocks_.push_back(incidence_block());
+      size_type b = blocks_.size() - 1;
+      if (d == 0) {
+        list.first = b;
+      } else {
+        blocks_[list.last].next = b;
+      }
+      list.last = b;
+    }
+    blocks_[list.last].edge[d % block_size] = e;
+    list.count = d + 1;
+    list.published.store(d + 1, std::memory_order_release);
+  }
 };
 
 #endif // CME212_GRAPH_HPP
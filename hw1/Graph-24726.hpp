@@ -10,10 +10,39 @@
  // proxy_example.cpp may be found.
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <vector>
 #include <cassert>
-#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
 
+#include "common/checked_access.hpp"
+#include "common/connected_components.hpp"
+#include "common/csr_snapshot.hpp"
+#include "common/dirty_range.hpp"
+#include "common/file_resource.hpp"
+#include "common/float_point.hpp"
+#include "common/graph_range.hpp"
+#include "common/graph_snapshot.hpp"
+#include "common/graph_stats.hpp"
+#include "common/mapped_graph.hpp"
+#include "common/page_resource.hpp"
+#include "common/property_map.hpp"
+#include "common/result_cache.hpp"
+#include "common/sorted_search.hpp"
+#include "common/space_filling_curve.hpp"
+#include "common/sparse_export.hpp"
+#include "common/stable_handle.hpp"
+#include "common/trace.hpp"
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
 
@@ -23,14 +52,31 @@
  *
  * Users can add and retrieve nodes and edges. Edges are unique (there is at
  * most one edge between any pair of distinct nodes).
+ *
+ * @tparam V  Type of the value stored with every node.
+ * @tparam E  Type of the value stored with every edge, e.g. a spring's rest
+ *            length. Edge values live in one contiguous array indexed by
+ *            edge uid.
+ * @tparam Index  Unsigned integer type of node and edge indices, used as
+ *            size_type by Node, Edge, the iterators and every internal
+ *            array. std::uint16_t halves the adjacency footprint of small
+ *            subgraphs; std::uint64_t lifts the 4G node/edge limit.
+ * @tparam P  Type of node positions, stored in one array of num_nodes()
+ *            elements. Point by default; float3 or float4 from
+ *            common/float_point.hpp halve the bytes every pass over the
+ *            positions moves, at float precision.
  */
-template <typename V>
+template <typename V, typename E = double, typename Index = std::uint32_t,
+          typename P = Point>
 class Graph {
+  static_assert(std::is_unsigned<Index>::value,
+                "Graph index type must be an unsigned integer type");
 
  private:
   //Creating the structures for the internals of the graph classes
   struct internal_node;
   struct internal_edge;
+  struct csr_incidence;
 
  public:
 
@@ -46,6 +92,11 @@ class Graph {
   /** Synonym for Node (following STL conventions). */
   using node_type = Node;
 
+  /** Type returned by the non-const Node::position(). */
+  class PositionRef;
+  /** Synonym for PositionRef */
+  using position_reference = PositionRef;
+
   /** Predeclaration of Edge type. */
   class Edge;
   /** Synonym for Edge (following STL conventions). */
@@ -66,13 +117,147 @@ class Graph {
   /** Synonym for IncidentIterator */
   using incident_iterator = IncidentIterator;
 
+  /** Type of the end of an incident or neighbor range. */
+  struct IncidentSentinel {};
+  using incident_sentinel = IncidentSentinel;
+
+  /** Type of iterators over the neighbors of a node. */
+  class NeighborIterator;
+  using neighbor_iterator = NeighborIterator;
+
+  /** Ranges returned by nodes(), edges(), Node::incident_edges() and
+      Node::neighbors(): views in C++20, see common/graph_range.hpp. */
+  using node_range = GraphRange<NodeIterator>;
+  using edge_range = GraphRange<EdgeIterator>;
+  using incident_range = GraphRange<IncidentIterator, IncidentSentinel>;
+  using neighbor_range = GraphRange<NeighborIterator, IncidentSentinel>;
+
+  /** Type of compact edge handles, which name an oriented edge in one word. */
+  class EdgeHandle;
+  /** Synonym for EdgeHandle */
+  using edge_handle = EdgeHandle;
+
+  /** Types of generation-checked handles, which can be tested for
+      validity after removals and renumberings, see stable_handle(). */
+  using stable_node_handle = StableHandle<Node>;
+  using stable_edge_handle = StableHandle<Edge>;
+
   /** Type of indexes and sizes.
       Return type of Graph::Node::index(), Graph::num_nodes(),
       Graph::num_edges(), and argument type of Graph::node(size_type) */
-  using size_type = unsigned;
+  using size_type = Index;
 
-  using hash_map = std::unordered_map<size_type, size_type>;
   using node_value_type = V;
+  using edge_value_type = E;
+  /** Type of node positions. */
+  using point_type = P;
+  /** Range of one step of the position history, see history(). */
+  using history_range = GraphRange<const point_type*>;
+
+  /** Dense per-node and per-edge data indexed by Node::index() and
+      Edge::index(), e.g. NodeMap<double> dist(g, 0.0); dist[n] = 1.0; */
+  template <typename T>
+  using NodeMap = NodePropertyMap<Graph, T>;
+  template <typename T>
+  using EdgeMap = EdgePropertyMap<Graph, T>;
+
+  /** Per-node and per-edge arrays made by make_node_property() and
+      make_edge_property(), which the graph keeps in step with itself. */
+  template <typename T>
+  using NodeProperty = PropertyArray<Node, T, size_type>;
+  template <typename T>
+  using EdgeProperty = PropertyArray<Edge, T, size_type>;
+
+  /** Hash functors for unordered containers of nodes and edges, e.g.
+      std::unordered_set<Node, Graph::node_hash>. */
+  using node_hash = NodeHash;
+  using edge_hash = EdgeHash;
+
+  /** Node orderings that reorder() can compute. */
+  enum class Order {
+    Hilbert,  // position along a 3D Hilbert curve
+    Morton,   // position along a 3D Z-order curve
+    RCM       // reverse Cuthill-McKee, which reduces matrix bandwidth
+  };
+
+  /** Adjacency exported by to_csr_matrix(): row i holds the columns
+      columns[row_offsets[i] .. row_offsets[i + 1]) in increasing order,
+      with values[k] the value of the entry in columns[k]. */
+  struct csr_matrix {
+    size_type rows = 0;
+    std::vector<std::size_t> row_offsets;
+    std::vector<size_type> columns;
+    std::vector<edge_value_type> values;
+  };
+
+  /** Edge coloring returned by edge_coloring(): color c is the edges
+      edges[offsets[c] .. offsets[c + 1]) in increasing index order, and no
+      two edges of one color share a node. */
+  struct edge_color_classes {
+    std::vector<size_type> edges;
+    std::vector<std::size_t> offsets;
+
+    /** Return the number of colors. */
+    size_type colors() const {
+      return offsets.empty() ? 0 : size_type(offsets.size() - 1);
+    }
+  };
+
+  /** Node coloring returned by node_coloring(): color c is the nodes
+      nodes[offsets[c] .. offsets[c + 1]) in increasing index order, and no
+      two nodes of one color are adjacent. */
+  struct node_color_classes {
+    std::vector<size_type> nodes;
+    std::vector<std::size_t> offsets;
+
+    /** Return the number of colors. */
+    size_type colors() const {
+      return offsets.empty() ? 0 : size_type(offsets.size() - 1);
+    }
+  };
+
+  /** One tile of edge_tiles(): the edges [first, last), whose smaller
+      endpoints lie in node block source_block and larger endpoints in
+      node block target_block, blocks being block_size indices wide. */
+  struct edge_tile {
+    size_type source_block;
+    size_type target_block;
+    size_type first;
+    size_type last;
+  };
+
+  /** Edge tiling returned by edge_tiles(): tiles in the order their edges
+      are numbered. Empty, with block_size 0, unless tile_edges() ran since
+      the last topology change. */
+  struct edge_tile_layout {
+    size_type block_size = 0;
+    std::vector<edge_tile> tiles;
+
+    bool empty() const {
+      return tiles.empty();
+    }
+  };
+
+  /** Result of validate(): how many broken invariants it found, and a
+      description of the first max_messages of them. */
+  struct validation_report {
+    static constexpr std::size_t max_messages = 16;
+    std::size_t errors = 0;
+    std::vector<std::string> messages;
+
+    bool ok() const {
+      return errors == 0;
+    }
+  };
+
+  /** Index maps of extract(): where every node of the graph went, or
+      size_type(-1) for a node left out, and the original index of every
+      node and edge of the subgraph. */
+  struct subgraph_maps {
+    std::vector<size_type> node_map;
+    std::vector<size_type> node_origin;
+    std::vector<size_type> edge_origin;
+  };
 
   //
   // CONSTRUCTORS AND DESTRUCTOR
@@ -87,12 +272,82 @@ class Graph {
   * @pre none
   * @post Graph object is created
   *
-  * In this case, we also initialize the vector of internal_node and the
-  * vector of internal_edge here with this constructor (private members of
-  * the Graph class)
+  * In this case, we also initialize the node position and value arrays and
+  * the vector of internal_edge here with this constructor (private members
+  * of the Graph class)
   **/
   Graph()
-      : graph_nodes(), graph_edges() {
+      : Graph(std::pmr::get_default_resource()) {
+  }
+
+  /**
+  * @brief Construct an empty graph whose storage comes from @a resource.
+  *
+  * @param[in] resource  Memory resource for every container of the graph
+  * @return Graph Object
+  *
+  * @pre @a resource outlives the graph
+  * @post Graph object is created and get_memory_resource() == @a resource
+  *
+  * All node and edge arrays (values included), the adjacency rows (outer array and every row)
+  * and the CSR arrays allocate from @a resource. Backing the graph with a
+  * std::pmr::monotonic_buffer_resource makes building many short-lived
+  * graphs cheap: destroying one costs no per-container deallocation work
+  * beyond handing the memory back to the resource.
+  **/
+  explicit Graph(std::pmr::memory_resource* resource)
+      : node_positions_(resource), node_values_(resource),
+        front_positions_(resource), front_values_(resource),
+        history_(resource),
+        graph_edges(resource), edge_values_(resource), edge_cache_(resource),
+        adjacency_(resource), degrees_(resource), removed_nodes_(resource),
+        removed_edges_(resource), csr_offsets_(resource), csr_incidences_(resource),
+        csr_stale_(resource), edge_weights_(resource), csr_weights_(resource),
+        csr_columns_(resource) {
+  }
+
+  /**
+  * @brief Construct an empty graph whose large arrays are mapped and placed
+  *        on NUMA nodes as @a pages asks.
+  *
+  * @param[in] pages  Placement options, see common/page_resource.hpp
+  * @return Graph Object
+  *
+  * @post Graph object is created and get_memory_resource() is a
+  *       PageResource owned by the graph
+  *
+  * With numa_placement::first_touch and pages.threads set to the number of
+  * workers, every node, edge and CSR array of at least pages.threshold
+  * bytes is faulted in by that many threads, slice t by thread t, so the
+  * ranges of edge_ranges(pages.threads) and of an even split of the nodes
+  * lie on the nodes of the threads that touched them. The loader can then
+  * fill the arrays from one thread without pulling them onto its socket.
+  * With pages.huge set, those arrays are also 2 MB-aligned and backed by
+  * huge pages where the kernel provides them.
+  **/
+  explicit Graph(const page_options& pages)
+      : Graph(std::make_shared<PageResource>(pages)) {
+  }
+
+  /**
+  * @brief Construct an empty graph whose large arrays live in a file.
+  *
+  * @param[in] file  File options, see common/file_resource.hpp
+  * @return Graph Object
+  *
+  * @post Graph object is created and get_memory_resource() is a
+  *       FileResource owned by the graph
+  * @throws std::runtime_error if the file cannot be created or mapped
+  *
+  * The node, edge and CSR arrays of at least file.threshold bytes are
+  * placed in file.path, mapped shared, so the kernel pages out the cold
+  * parts of a build that outgrows RAM instead of failing it. Adjacency
+  * rows are small and stay on file.upstream until freeze() packs them
+  * into the CSR arrays. The file is removed with the graph unless
+  * file.keep_file is set.
+  **/
+  explicit Graph(const file_options& file)
+      : Graph(std::make_shared<FileResource>(file)) {
   }
 
   /**
@@ -105,6 +360,251 @@ class Graph {
   **/
   ~Graph() = default;
 
+  /**
+  * @brief Copy constructor and copy assignment, element by element.
+  *
+  * The copy allocates from the default resource and starts without
+  * property arrays, see PropertyRegistry.
+  **/
+  Graph(const Graph&) = default;
+  Graph& operator=(const Graph&) = default;
+
+  /**
+  * @brief Move constructor: take over the storage of @a other.
+  *
+  * @param[in,out] other  Graph to take the nodes and edges of
+  *
+  * @post *this has the nodes, edges, values, property arrays, tombstones
+  *       and frozen state @a other had, with the same indices, and the same
+  *       get_memory_resource()
+  * @post @a other is empty and still allocates from its resource
+  *
+  * Every array is handed over together with its allocator, so nothing is
+  * copied and nothing is allocated. Nodes and edges refer to each other by
+  * index, never by address, so nothing inside needs fixing up either; only
+  * the Node, Edge and iterator objects of @a other keep pointing at @a other.
+  *
+  * Complexity: O(1).
+  **/
+  Graph(Graph&& other) noexcept
+      : Graph(other.get_memory_resource()) {
+    owned_resource_ = other.owned_resource_;
+    swap(other);
+  }
+
+  /**
+  * @brief Move assignment: replace this graph by the contents of @a other.
+  *
+  * @param[in,out] other  Graph to take the nodes and edges of
+  *
+  * @post *this has what @a other had, as after Graph(std::move(other)), but
+  *       keeps its own get_memory_resource()
+  * @post @a other is empty
+  *
+  * If both graphs allocate from equal resources, which all graphs on the
+  * default resource do, the arrays are exchanged and this graph's old
+  * contents freed, with no allocation. Otherwise, as for std::pmr
+  * containers, the elements have to be copied into this graph's resource.
+  *
+  * Complexity: O(1) plus freeing the old contents with equal resources,
+  * O(num_nodes() + num_edges()) of @a other otherwise.
+  **/
+  Graph& operator=(Graph&& other) {
+    if(this == &other)
+      return *this;
+    if(*get_memory_resource() == *other.get_memory_resource()) {
+      Graph taken(std::move(other));
+      swap(taken);
+      return *this;
+    }
+    //The copy assignment replaces owned_resource_ before the arrays that
+    //live in it, so hold on to it until they have been reassigned
+    std::shared_ptr<std::pmr::memory_resource> keep = owned_resource_;
+    *this = static_cast<const Graph&>(other);
+    owned_resource_ = std::move(keep);
+    node_properties_ = std::move(other.node_properties_);
+    edge_properties_ = std::move(other.edge_properties_);
+    other.clear();
+    return *this;
+  }
+
+  /**
+  * @brief Exchange the contents of this graph and @a other.
+  *
+  * @param[in,out] other  Graph to exchange with
+  *
+  * @pre *get_memory_resource() == *other.get_memory_resource(), as for
+  *      swapping std::pmr containers
+  * @post Each graph has the nodes, edges, values, property arrays,
+  *       tombstones and frozen state the other had
+  *
+  * Exchanges the arrays themselves, not their elements. Node, Edge and
+  * iterator objects keep pointing at the graph they came from, and so see
+  * its new contents.
+  *
+  * Complexity: O(1).
+  **/
+  void swap(Graph& other) noexcept {
+    assert(*get_memory_resource() == *other.get_memory_resource());
+    using std::swap;
+    swap(owned_resource_, other.owned_resource_);
+    node_positions_.swap(other.node_positions_);
+    node_values_.swap(other.node_values_);
+    front_positions_.swap(other.front_positions_);
+    front_values_.swap(other.front_values_);
+    swap(double_buffered_, other.double_buffered_);
+    swap(buffer_generation_, other.buffer_generation_);
+    history_.swap(other.history_);
+    swap(history_head_, other.history_head_);
+    swap(history_depth_, other.history_depth_);
+    graph_edges.swap(other.graph_edges);
+    edge_values_.swap(other.edge_values_);
+    edge_cache_.swap(other.edge_cache_);
+    swap(expected_degree_, other.expected_degree_);
+    adjacency_.swap(other.adjacency_);
+    degrees_.swap(other.degrees_);
+    removed_nodes_.swap(other.removed_nodes_);
+    removed_edges_.swap(other.removed_edges_);
+    swap(num_removed_nodes_, other.num_removed_nodes_);
+    swap(num_removed_edges_, other.num_removed_edges_);
+    swap(compaction_threshold_, other.compaction_threshold_);
+    node_generations_.swap(other.node_generations_);
+    edge_generations_.swap(other.edge_generations_);
+    swap(parallel_edges_, other.parallel_edges_);
+    swap(bulk_load_, other.bulk_load_);
+    swap(rows_sorted_, other.rows_sorted_);
+    swap(concurrent_reads_, other.concurrent_reads_);
+    swap(position_changes_, other.position_changes_);
+    swap(edge_changes_, other.edge_changes_);
+    swap(bounds_lo_, other.bounds_lo_);
+    swap(bounds_hi_, other.bounds_hi_);
+    swap(bounds_sum_, other.bounds_sum_);
+    swap(bounds_valid_, other.bounds_valid_);
+    swap(node_properties_, other.node_properties_);
+    swap(edge_properties_, other.edge_properties_);
+    swap(coloring_, other.coloring_);
+    swap(coloring_valid_, other.coloring_valid_);
+    swap(node_coloring_, other.node_coloring_);
+    swap(node_coloring_version_, other.node_coloring_version_);
+    swap(edge_tiles_, other.edge_tiles_);
+    swap(edge_tiles_version_, other.edge_tiles_version_);
+    weld_heads_.swap(other.weld_heads_);
+    weld_next_.swap(other.weld_next_);
+    swap(weld_tolerance_, other.weld_tolerance_);
+    swap(weld_version_, other.weld_version_);
+    swap(topology_version_, other.topology_version_);
+    swap(stats_, other.stats_);
+    swap(frozen_, other.frozen_);
+    csr_offsets_.swap(other.csr_offsets_);
+    csr_incidences_.swap(other.csr_incidences_);
+    csr_stale_.swap(other.csr_stale_);
+    swap(csr_stale_rows_, other.csr_stale_rows_);
+    swap(csr_merge_threshold_, other.csr_merge_threshold_);
+    swap(weighted_, other.weighted_);
+    edge_weights_.swap(other.edge_weights_);
+    csr_weights_.swap(other.csr_weights_);
+    swap(csr_weights_valid_, other.csr_weights_valid_);
+    csr_columns_.swap(other.csr_columns_);
+    swap(csr_columns_valid_, other.csr_columns_valid_);
+  }
+
+  /** Exchange the contents of @a a and @a b, as a.swap(b). */
+  friend void swap(Graph& a, Graph& b) noexcept {
+    a.swap(b);
+  }
+
+  /**
+  * @brief Return a deep copy of this graph that allocates from the same
+  *        resource.
+  *
+  * @param[in] parallel  Whether to copy with all cores
+  * @return A graph with the same nodes, edges, values, adjacency rows,
+  *         tombstones and frozen state, with the same indices
+  *
+  * @post result.get_memory_resource() == get_memory_resource()
+  *
+  * Meant for forking a large state, e.g. to try several futures of one
+  * simulation. Every flat array is copied in contiguous slices, one per
+  * thread, with memcpy when its elements are trivially copyable. The
+  * adjacency rows are copied in the same single pass over the nodes, in
+  * parallel when the resource is std::pmr::new_delete_resource(), which
+  * may be called from several threads, and on this thread otherwise. As
+  * for the copy constructor, property arrays are not copied.
+  *
+  * Complexity: O(num_nodes() + num_edges()), spread over the threads.
+  **/
+  Graph clone(bool parallel = true) const {
+    unsigned threads = parallel ? csr_snapshot::thread_count(0) : 1;
+    Graph g(get_memory_resource());
+    g.owned_resource_ = owned_resource_;
+    clone_array(node_positions_, g.node_positions_, threads);
+    clone_array(node_values_, g.node_values_, threads);
+    clone_array(front_positions_, g.front_positions_, threads);
+    clone_array(front_values_, g.front_values_, threads);
+    g.double_buffered_ = double_buffered_;
+    g.buffer_generation_ = buffer_generation_;
+    g.history_.resize(history_.size());
+    for(std::size_t k = 0; k < history_.size(); ++k)
+      clone_array(history_[k], g.history_[k], threads);
+    g.history_head_ = history_head_;
+    g.history_depth_ = history_depth_;
+    clone_array(graph_edges, g.graph_edges, threads);
+    clone_array(edge_values_, g.edge_values_, threads);
+    clone_array(edge_cache_, g.edge_cache_, threads);
+    clone_array(degrees_, g.degrees_, threads);
+    clone_array(csr_offsets_, g.csr_offsets_, threads);
+    clone_array(csr_incidences_, g.csr_incidences_, threads);
+    clone_array(csr_stale_, g.csr_stale_, threads);
+    clone_array(edge_weights_, g.edge_weights_, threads);
+    g.removed_nodes_ = removed_nodes_;
+    g.removed_edges_ = removed_edges_;
+
+    //Rows allocate, so they are only built concurrently on a resource
+    //that may be called from several threads at once
+    std::size_t n = adjacency_.size();
+    g.adjacency_.resize(n);
+    unsigned row_threads =
+        get_memory_resource() == std::pmr::new_delete_resource() ? threads : 1;
+    csr_snapshot::parallel_ranges(row_threads, n, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for(std::size_t i = b; i < e; ++i)
+            g.adjacency_[i].assign(adjacency_[i].begin(), adjacency_[i].end());
+        });
+
+    g.expected_degree_ = expected_degree_;
+    g.num_removed_nodes_ = num_removed_nodes_;
+    g.num_removed_edges_ = num_removed_edges_;
+    g.compaction_threshold_ = compaction_threshold_;
+    g.node_generations_ = node_generations_;
+    g.edge_generations_ = edge_generations_;
+    g.parallel_edges_ = parallel_edges_;
+    g.bulk_load_ = bulk_load_;
+    g.rows_sorted_ = rows_sorted_;
+    g.position_changes_ = position_changes_;
+    g.edge_changes_ = edge_changes_;
+    std::copy(bounds_lo_, bounds_lo_ + 3, g.bounds_lo_);
+    std::copy(bounds_hi_, bounds_hi_ + 3, g.bounds_hi_);
+    std::copy(bounds_sum_, bounds_sum_ + 3, g.bounds_sum_);
+    g.bounds_valid_ = bounds_valid_;
+    g.coloring_ = coloring_;
+    g.coloring_valid_ = coloring_valid_;
+    g.node_coloring_ = node_coloring_;
+    g.node_coloring_version_ = node_coloring_version_;
+    g.edge_tiles_ = edge_tiles_;
+    g.edge_tiles_version_ = edge_tiles_version_;
+    g.weld_heads_ = weld_heads_;
+    g.weld_next_ = weld_next_;
+    g.weld_tolerance_ = weld_tolerance_;
+    g.weld_version_ = weld_version_;
+    g.topology_version_ = topology_version_;
+    g.stats_ = stats_;
+    g.frozen_ = frozen_;
+    g.csr_stale_rows_ = csr_stale_rows_;
+    g.csr_merge_threshold_ = csr_merge_threshold_;
+    g.weighted_ = weighted_;
+    return g;
+  }
+
   //
   // NODES
   //
@@ -152,18 +652,71 @@ class Graph {
     * @brief Return this node's position.
     *
     * @param none
-    * @return A Point object of the node with position.
+    * @return A point_type object of the node with position.
     *
     * @pre Node object exists with valid position
-    * @post A Point object is returned
+    * @post A point_type object is returned
     *
     * We use a private helper function, similar to that seen
     * in proxy_example.cpp to fetch the node position.
     **/
-    const Point& position() const {
+    const point_type& position() const {
       return fetch_node().node_pt;
     }
 
+    /**
+    * @brief Return this node's position, for reading or moving the node.
+    *
+    * @param none
+    * @return A PositionRef to the node's position
+    *
+    * @pre Node object exists with valid position
+    *
+    * Reading through the result has no side effects, so a loop over
+    * g.node(i).position() or (*it).position() is as cheap as one over
+    * const Nodes. Assigning to it is the tracked way to move a node; see
+    * PositionRef and set_position().
+    *
+    * Complexity: O(1).
+    **/
+    PositionRef position() {
+      return PositionRef(*this);
+    }
+
+    /**
+    * @brief Move this node to @a p.
+    *
+    * @param[in] p  The new position
+    *
+    * @pre Node object exists with valid position
+    * @post position() == @a p, this node is in changed_positions(), and the
+    *       cached length() and direction() of every edge incident to it will
+    *       be recomputed on their next use
+    *
+    * Complexity: O(degree()) while the edge cache is in use, O(1) otherwise.
+    **/
+    void set_position(const point_type& p) {
+      graph_->moved_position(uid_) = p;
+    }
+
+    /**
+    * @brief Return this node's position as recorded @a steps_back steps ago.
+    *
+    * @param[in] steps_back  0 for the newest Graph::record_positions(), 1
+    *                        for the one before, and so on
+    * @return The position, read from the graph's position history
+    *
+    * @pre @a steps_back < graph_->history_depth(), and this node existed,
+    *      with the same index, when that step was recorded
+    *
+    * Complexity: O(1).
+    **/
+    const point_type& position(unsigned steps_back) const {
+      const auto& slot = graph_->history_slot(steps_back);
+      assert(uid_ < slot.size());
+      return slot[uid_];
+    }
+
     /**
     * @brief Return this node's index
     *
@@ -216,17 +769,12 @@ class Graph {
     * @pre Node object exists
     * @post The unsigned degree of the Node is returned
     *
-    * Retrieves the degree of the node using the IncidentIterator class
+    * The degree is stored per node and kept up to date by add_edge() and
+    * the removals, so this is O(1). Edges removed by lazy_remove_edge() no
+    * longer count.
     **/
     size_type degree() const {
-      Node n = *this;
-      size_type counter = 0;
-
-      //Using the IncidentIterator class to iterate over
-      for(auto ii = n.edge_begin(); ii != n.edge_end(); ++ii) {
-        counter++;
-      }
-      return counter;
+      return graph_->degrees_[uid_];
     }
 
     /**
@@ -239,9 +787,35 @@ class Graph {
     * @post An incident_iterator object is returned pointing to the first edge
     **/
     incident_iterator edge_begin() const {
-      return IncidentIterator(graph_,
-                              graph_->edge_search.find(uid_)->second.begin(),
-                              uid_);
+      //Both the mutable rows and the frozen CSR rows are contiguous arrays
+      const csr_incidence* row = graph_->row_data(uid_);
+      const csr_incidence* end = row + graph_->row_size(uid_);
+      return IncidentIterator(graph_, graph_->next_live_incidence(row, end),
+                              end, uid_);
+    }
+
+    /**
+    * @brief Returns an incident iterator pointing to the edge @a k places
+    *        after edge_begin()
+    *
+    * @param[in] k  Number of incident edges to skip
+    * @return std::next(edge_begin(), k)
+    *
+    * @pre k <= degree()
+    *
+    * Lets several threads split the row of a high-degree node between
+    * them (see common/incident_partition.hpp) without each walking up to
+    * its share.
+    * Complexity: O(1), or O(k) while edges removed by lazy_remove_edge()
+    * are waiting for compaction.
+    **/
+    incident_iterator edge_begin(size_type k) const {
+      assert(k <= degree());
+      if(graph_->num_removed_edges_ != 0)
+        return std::next(edge_begin(), std::ptrdiff_t(k));
+      const csr_incidence* row = graph_->row_data(uid_);
+      const csr_incidence* end = row + graph_->row_size(uid_);
+      return IncidentIterator(graph_, row + k, end, uid_);
     }
 
     /**
@@ -254,9 +828,46 @@ class Graph {
     * @post An incident_iterator object is returned pointing to the last edge
     **/
     incident_iterator edge_end() const {
-      return IncidentIterator(graph_,
-                              graph_->edge_search.find(uid_)->second.end(),
-                              uid_);
+      const csr_incidence* end = graph_->row_data(uid_) + graph_->row_size(uid_);
+      return IncidentIterator(graph_, end, end, uid_);
+    }
+
+    /**
+    * @brief Returns the incident edges of this node as a range
+    *
+    * @param none
+    * @return A range from edge_begin() to a sentinel, for use as
+    *         for(Edge e : n.incident_edges())
+    *
+    * @pre this object exists
+    * @post The range visits the same edges as edge_begin()..edge_end()
+    *
+    * The row is found once. The end is a sentinel that an iterator equals
+    * once it reaches the end of the row it carries, so the loop does not
+    * re-evaluate edge_end() on every iteration.
+    **/
+    incident_range incident_edges() const {
+      return incident_range(edge_begin(), incident_sentinel(), degree());
+    }
+
+    /**
+    * @brief Returns the nodes adjacent to this node as a range
+    *
+    * @param none
+    * @return A range of degree() Nodes: node2() of every incident edge, in
+    *         the same order
+    *
+    * @pre this object exists
+    *
+    * Reads only the neighbor indices of the row, never the edge records,
+    * so a loop over neighbor positions is one pass over two arrays.
+    **/
+    neighbor_range neighbors() const {
+      const csr_incidence* row = graph_->row_data(uid_);
+      const csr_incidence* end = row + graph_->row_size(uid_);
+      return neighbor_range(
+          NeighborIterator(graph_, graph_->next_live_incidence(row, end), end),
+          incident_sentinel(), degree());
     }
 
     /**
@@ -342,23 +953,136 @@ class Graph {
     *
     * @pre graph_ is not a nullptr
     * @pre 0 <= uid_ < size of the graph
-    * @pre The vector graph_nodes is not empty
+    * @pre The node arrays are not empty
     * @post The result is a valid internal_node struct.
     *
     * The fetch_node helper function used above in the Node public functions
-    * This helper function retrieves the internal node referenced in the
-    * graph_nodes vector corresponding to the current Node object by matching
-    * uid_ (indices)
+    * This helper function gathers the position and value referenced in the
+    * node_positions_ and node_values_ arrays corresponding to the current
+    * Node object by matching uid_ (indices)
     **/
-    internal_node& fetch_node() const {
+    internal_node fetch_node() const {
       //checking to see if it's in bounds
       assert(uid_ >= 0 && uid_ < graph_->size());
+      graph_->stats_.count(&graph_stats::fetch_node);
 
-      return graph_->graph_nodes.at(uid_);
+      //The assert above is the bounds check in debug builds; release builds
+      //index the arrays directly unless CME212_CHECKED_ACCESS is set
+      return internal_node{access_type::get(graph_->node_positions_, uid_),
+                           access_type::get(graph_->node_values_, uid_)};
     }
 
     // Allow Graph to access Node's private member data and functions.
     friend class Graph;
+    friend class PositionRef;
+  };
+
+  /** @class Graph::PositionRef
+   * @brief The position of one node, as returned by the non-const
+   *        Node::position().
+   *
+   * Reads, through the conversion to const point_type& or the x, y and z
+   * members, have no side effects and are safe from several threads.
+   * Assignments move the node as Node::set_position() does: the node
+   * joins changed_positions() and the cached length() and direction() of
+   * its incident edges go stale. So n.position() = p and
+   * n.position() += v stay tracked while plain reads cost what they do
+   * through a const Node.
+   */
+  class PositionRef {
+    using coordinate =
+        std::decay_t<decltype(std::declval<const point_type&>().x)>;
+
+   public:
+    /** The coordinates, read-only: move the node by assigning to the
+     * PositionRef itself. */
+    const coordinate& x;
+    const coordinate& y;
+    const coordinate& z;
+
+    /** Return the position. Complexity: O(1). */
+    const point_type& get() const {
+      return node_.fetch_node().node_pt;
+    }
+
+    operator const point_type&() const {
+      return get();
+    }
+
+    /** Convert to a type the position converts to, e.g. Point for a graph
+     * of float3 positions. */
+    template <typename T, typename = std::enable_if_t<
+                              !std::is_same<T, point_type>::value &&
+                              std::is_convertible<const point_type&, T>::value>>
+    operator T() const {
+      return T(get());
+    }
+
+    /** Move the node to @a p.
+     * Complexity: O(degree()) while the edge cache is in use, O(1)
+     * otherwise. */
+    PositionRef& operator=(const point_type& p) {
+      node_.set_position(p);
+      return *this;
+    }
+    PositionRef& operator=(const PositionRef& r) {
+      return *this = point_type(r.get());
+    }
+
+    /** Move the node by @a d, or scale its position by @a s, as the
+     * operators of point_type do. Complexity: as operator=(). */
+    PositionRef& operator+=(const point_type& d) {
+      moved() += d;
+      return *this;
+    }
+    PositionRef& operator-=(const point_type& d) {
+      moved() -= d;
+      return *this;
+    }
+    PositionRef& operator*=(double s) {
+      moved() *= s;
+      return *this;
+    }
+    PositionRef& operator/=(double s) {
+      moved() /= s;
+      return *this;
+    }
+
+    /** Compare positions, as point_type does. */
+    friend bool operator==(const PositionRef& a, const PositionRef& b) {
+      return a.get() == b.get();
+    }
+    friend bool operator==(const PositionRef& a, const point_type& b) {
+      return a.get() == b;
+    }
+    friend bool operator==(const point_type& a, const PositionRef& b) {
+      return a == b.get();
+    }
+    friend bool operator!=(const PositionRef& a, const PositionRef& b) {
+      return !(a == b);
+    }
+    friend bool operator!=(const PositionRef& a, const point_type& b) {
+      return !(a == b);
+    }
+    friend bool operator!=(const point_type& a, const PositionRef& b) {
+      return !(a == b);
+    }
+
+   private:
+    friend class Node;
+
+    Node node_;
+
+    explicit PositionRef(const Node& n)
+        : PositionRef(n, n.fetch_node().node_pt) {
+    }
+    PositionRef(const Node& n, const point_type& p)
+        : x(p.x), y(p.y), z(p.z), node_(n) {
+    }
+
+    point_type& moved() {
+      return node_.graph_->moved_position(node_.uid_);
+    }
   };
 
   /**
@@ -369,14 +1093,14 @@ class Graph {
   *
   *
   * @pre Graph object has been constructed
-  * @pre The vector graph_nodes is not empty
-  * @post result == the number of nodes in graph_nodes
+  * @pre The node arrays are not empty
+  * @post result == the number of nodes in node_positions_
   *
   * Number of nodes is simply the size of the vector of internal nodes
   * Complexity: O(1).
   **/
   size_type size() const {
-    return graph_nodes.size();
+    return node_positions_.size();
   }
 
   /**
@@ -387,8 +1111,8 @@ class Graph {
   *
   *
   * @pre Graph object has been constructed
-  * @pre The vector graph_nodes is not empty
-  * @post result == the number of nodes in graph_nodes
+  * @pre The node arrays are not empty
+  * @post result == the number of nodes in node_positions_
   *
   * Synonym for size().
   **/
@@ -396,47 +1120,842 @@ class Graph {
     return size();
   }
 
-  /** Add a node to the graph, returning the added node.
-   * @param[in] position The new node's position
-   * @param[in] value  The value stored inside the node
-   * @post new num_nodes() == old num_nodes() + 1
-   * @post result_node.index() == old num_nodes()
-   *
-   * Complexity: O(1) amortized operations.
-   */
-  Node add_node(const Point& position,
-                const node_value_type& value = node_value_type ()) {
-    //Using the proxy's position argument, we initialize the internal_node
-    //variable with the correct position to add to the internal graph_nodes
-    //vector to correctly add this new node.
-
-    internal_node newNode;
-    newNode.node_pt = position;
-    newNode.val = value;
-    graph_nodes.push_back(newNode);
+  /**
+  * @brief Return the version of this graph's topology.
+  *
+  * @return A value that changes whenever a node or edge is added or
+  *         removed (lazily or not), and whenever nodes or edges are
+  *         renumbered: compact(), permute_nodes(), reorder(), clear() and
+  *         deserialize()
+  *
+  * Versions come from next_topology_version(), so they are unique across
+  * graphs: two graphs share one only if one is a copy of the other with no
+  * change since. Moving node positions or writing values keeps the
+  * version. ResultCache in common/result_cache.hpp keys on it.
+  *
+  * Complexity: O(1).
+  **/
+  std::uint64_t topology_version() const {
+    return topology_version_;
+  }
 
-    //Once we've added it to the vector, we return the new node wih the correct
-    //index
-    //NOTE: our nodes are zero indexed
-    return Node(this, this->num_nodes() - 1);
+  /**
+  * @brief Return the contiguous array of node positions.
+  *
+  * @param none
+  * @return Pointer to num_nodes() positions, where element i is the position of
+  *         node(i)
+  *
+  * @pre Graph object has been constructed
+  * @post For all i < num_nodes(), result[i] == node(i).position()
+  *
+  * Lets force and update loops stream positions directly instead of going
+  * through one Node proxy per element, and lets a viewer map or upload the
+  * array as one buffer (see changed_positions()). Writes through the
+  * pointer are not tracked: follow them with mark_positions_changed().
+  * Invalidated by add_node() and clear().
+  * Complexity: O(1).
+  **/
+  point_type* positions_data() {
+    return node_positions_.data();
+  }
+  const point_type* positions_data() const {
+    return node_positions_.data();
   }
 
-  /** Determine if a Node belongs to this Graph
-   * @param n   Node to check to see if it belongs in the graph
-   * @return True if @a n is currently a Node of this Graph
-   *
-   * @pre n is a valid Node
-   * @post n.index() < this->num_nodes()
-   * Complexity: O(1).
-   */
-  bool has_node(const Node& n) const {
-    //Since n.index() >= 0 is a tautology since n.index() is unsigned, we check
-    //to see if the index of the node is within the bounds of the size of
-    //the graph
-    if(n.index() < this->num_nodes())
-      return true;
+  /**
+  * @brief Return the contiguous array of node values.
+  *
+  * @param none
+  * @return Pointer to num_nodes() values, where element i is the value of
+  *         node(i)
+  *
+  * @pre Graph object has been constructed
+  * @post For all i < num_nodes(), result[i] == node(i).value()
+  *
+  * Invalidated by add_node() and clear().
+  * Complexity: O(1).
+  **/
+  node_value_type* values_data() {
+    return node_values_.data();
+  }
+  const node_value_type* values_data() const {
+    return node_values_.data();
+  }
 
-    return false;
+  /**
+  * @brief Return the contiguous array of node degrees.
+  *
+  * @param none
+  * @return Pointer to num_nodes() degrees, where element i is
+  *         node(i).degree()
+  *
+  * @pre Graph object has been constructed
+  * @post For all i < num_nodes(), result[i] == node(i).degree()
+  *
+  * Meant for partitioning and scheduling: an exclusive prefix sum over
+  * degrees()[0 .. num_nodes()) gives every node's offset into a packed
+  * incidence array without walking any row.
+  * Invalidated by add_node(), add_edge(), add_edges() and clear().
+  * Complexity: O(1).
+  **/
+  const size_type* degrees() const {
+    return degrees_.data();
+  }
+
+  /**
+  * @brief Return the contiguous array of edge values.
+  *
+  * @param none
+  * @return Pointer to num_edges() values, where element i is the value of
+  *         edge(i)
+  *
+  * @pre Graph object has been constructed
+  * @post For all i < num_edges(), result[i] == edge(i).value()
+  *
+  * Invalidated by add_edge(), add_edges() and clear().
+  * Complexity: O(1).
+  **/
+  edge_value_type* edge_values_data() {
+    return edge_values_.data();
+  }
+  const edge_value_type* edge_values_data() const {
+    return edge_values_.data();
+  }
+
+  /**
+  * @brief Return the endpoints of every edge as one contiguous index array.
+  *
+  * @param none
+  * @return Pointer to 2 * num_edges() node indices, where elements 2k and
+  *         2k + 1 are edge(k).node1().index() and edge(k).node2().index()
+  *
+  * @pre Graph object has been constructed
+  *
+  * Laid out as an index buffer for drawing the edges as lines over
+  * positions_data(), so a viewer needs no per-edge copy. Edges removed by
+  * lazy_remove_edge() stay in the array until compact(); check
+  * is_removed() if they must not be drawn.
+  * Invalidated by every change to the edges and by clear().
+  * Complexity: O(1).
+  **/
+  const size_type* edge_endpoints_data() const {
+    static_assert(sizeof(internal_edge) == 2 * sizeof(size_type),
+                  "internal_edge must be two packed node indices");
+    return reinterpret_cast<const size_type*>(graph_edges.data());
+  }
+
+  /**
+  * @brief Return the node indices whose position may have changed since
+  *        the last clear_changes().
+  *
+  * @param none
+  * @return [first, last): every node added, moved, renumbered or removed
+  *         since the last clear_changes() is in it, and
+  *         last <= num_nodes()
+  *
+  * A viewer that keeps its own copy of positions_data() refreshes only
+  * this slice on every frame, then calls clear_changes(). A node that was
+  * removed by remove_node() leaves its hole marked, since another node
+  * moved in; the array may also just be shorter, so compare num_nodes()
+  * as well. Position writes through Node::position() are tracked; see
+  * mark_positions_changed() for writes through positions_data().
+  * Complexity: O(1).
+  **/
+  std::pair<size_type, size_type> changed_positions() const {
+    return position_changes_.clipped(num_nodes());
+  }
+
+  /**
+  * @brief Return the edge indices whose endpoints may have changed since
+  *        the last clear_changes().
+  *
+  * @param none
+  * @return [first, last) within edge_endpoints_data(), in edges: every edge
+  *         added, moved, renumbered, tombstoned or revived since the last
+  *         clear_changes() is in it, and last <= num_edges()
+  *
+  * Complexity: O(1).
+  **/
+  std::pair<size_type, size_type> changed_edges() const {
+    return edge_changes_.clipped(num_edges());
+  }
+
+  /** Include nodes [@a first, @a last) in changed_positions(), after
+   *  writing their positions through positions_data(). Complexity: O(1). */
+  void mark_positions_changed(size_type first, size_type last) {
+    position_changes_.mark(first, last);
+    if(first < last)
+      bounds_valid_ = false;
+  }
+
+  /** Empty changed_positions() and changed_edges(), once a viewer has
+   *  caught up. Complexity: O(1). */
+  void clear_changes() {
+    position_changes_.clear();
+    edge_changes_.clear();
+  }
+
+  /**
+  * @brief Keep a second, front copy of the node positions and values, for
+  *        readers that run while the graph itself is being written.
+  *
+  * @param[in] threads  Threads to copy with; 0 means all cores
+  *
+  * @post double_buffered(), and the front buffer holds the current
+  *       positions and values
+  *
+  * The graph's own arrays become the back buffer: Node::position(),
+  * Node::value(), positions_data() and every other accessor read and write
+  * it as before. A viewer or checkpoint writer reads the front buffer
+  * through front_positions_data() and front_values_data() instead, which
+  * only swap_buffers() changes, so it can run on another thread while an
+  * integrator writes the next step:
+  *
+  *   g.enable_double_buffering();
+  *   for(;;) {
+  *     //each integrator thread writes step n + 1 from front step n
+  *     //viewer thread renders front_positions_data()[0, front_size())
+  *     //both wait at a barrier, then one thread calls
+  *     g.swap_buffers();
+  *   }
+  *
+  * Complexity: O(num_nodes()), spread over the threads.
+  **/
+  void enable_double_buffering(unsigned threads = 0) {
+    threads = csr_snapshot::thread_count(threads);
+    clone_array(node_positions_, front_positions_, threads);
+    clone_array(node_values_, front_values_, threads);
+    double_buffered_ = true;
+  }
+
+  /** Drop the front buffer and its memory. Complexity: O(1). */
+  void disable_double_buffering() {
+    std::pmr::vector<point_type>(front_positions_.get_allocator())
+        .swap(front_positions_);
+    std::pmr::vector<node_value_type>(front_values_.get_allocator())
+        .swap(front_values_);
+    double_buffered_ = false;
+  }
+
+  /** Return whether enable_double_buffering() is in effect. */
+  bool double_buffered() const {
+    return double_buffered_;
+  }
+
+  /**
+  * @brief Publish the back buffer as the front one, and take the old front
+  *        buffer as the new back.
+  *
+  * @param none
+  *
+  * @pre double_buffered(), and no thread reads the front buffer or writes
+  *      the graph during the call
+  * @post front_size() == num_nodes(), and the front buffer holds the
+  *       positions and values the graph had before the call
+  * @post buffer_generation() is one more than before
+  *
+  * Exchanges the arrays, not their elements: afterwards node i of the graph
+  * holds what front node i held, i.e. the step before the one just
+  * published. An integrator that writes every node of step n + 1 from the
+  * front step n, as a ping-pong update does, needs nothing more; one that
+  * updates positions in place calls sync_back_buffer() first. Nodes the
+  * graph gained since the last swap are copied into the new back buffer,
+  * and nodes it lost are dropped, so the graph keeps num_nodes() nodes.
+  * Every position counts as changed, as after mark_positions_changed(),
+  * and every cached edge length is invalidated.
+  *
+  * Invalidates positions_data(), values_data(), front_positions_data() and
+  * front_values_data(). Complexity: O(1), plus the copy of the nodes added
+  * since the last swap and O(num_edges()) while the edge cache is in use.
+  **/
+  void swap_buffers() {
+    assert(double_buffered_);
+    std::size_t n = node_positions_.size();
+    std::size_t old = front_positions_.size();
+    node_positions_.swap(front_positions_);
+    node_values_.swap(front_values_);
+    if(old < n) {
+      node_positions_.insert(node_positions_.end(),
+                             front_positions_.begin() + old,
+                             front_positions_.end());
+      node_values_.insert(node_values_.end(), front_values_.begin() + old,
+                          front_values_.end());
+    } else {
+      node_positions_.erase(node_positions_.begin() + n,
+                            node_positions_.end());
+      node_values_.erase(node_values_.begin() + n, node_values_.end());
+    }
+    ++buffer_generation_;
+    mark_positions_changed(0, size_type(n));
+    invalidate_edge_cache();
+  }
+
+  /**
+  * @brief Copy the front buffer into the back one.
+  *
+  * @param[in] threads  Threads to copy with; 0 means all cores
+  *
+  * @pre double_buffered(), and front_size() == num_nodes()
+  * @post node(i).position() and node(i).value() equal front node i
+  *
+  * Lets an integrator that updates positions in place, such as
+  * SymplecticEuler (common/symplectic.hpp), start each step from the one the
+  * front buffer holds. Readers of the front buffer may keep running.
+  *
+  * Complexity: O(num_nodes()), spread over the threads.
+  **/
+  void sync_back_buffer(unsigned threads = 0) {
+    assert(double_buffered_ && front_positions_.size() == num_nodes());
+    threads = csr_snapshot::thread_count(threads);
+    clone_array(front_positions_, node_positions_, threads);
+    clone_array(front_values_, node_values_, threads);
+    mark_positions_changed(0, num_nodes());
+    invalidate_edge_cache();
+  }
+
+  /** Return the number of nodes in the front buffer, num_nodes() as of the
+   *  last swap_buffers() or enable_double_buffering(). */
+  size_type front_size() const {
+    return size_type(front_positions_.size());
+  }
+
+  /**
+  * @brief Return the front buffer of node positions.
+  *
+  * @param none
+  * @return Pointer to front_size() positions, where element i is the
+  *         position of node i as of the last swap_buffers(), numbered as the
+  *         graph was then
+  *
+  * @pre double_buffered()
+  *
+  * Safe to read from any thread while the graph is written, added to or
+  * compacted; only swap_buffers(), disable_double_buffering() and clear()
+  * change it.
+  * Complexity: O(1).
+  **/
+  const point_type* front_positions_data() const {
+    return front_positions_.data();
+  }
+
+  /** Return the front buffer of node values, as front_positions_data(). */
+  const node_value_type* front_values_data() const {
+    return front_values_.data();
+  }
+
+  /** Return the number of swap_buffers() calls so far, for readers that
+   *  check whether the front buffer has moved on. Complexity: O(1). */
+  std::uint64_t buffer_generation() const {
+    return buffer_generation_;
+  }
+
+  /**
+  * @brief Keep the node positions of the last @a slots calls to
+  *        record_positions(), for velocity estimates and replay.
+  *
+  * @param[in] slots  Number of steps to keep, at least 1
+  *
+  * @post history_slots() == @a slots and history_depth() == 0
+  *
+  * Each slot is one contiguous array laid out as positions_data(), so a
+  * step is recorded with one parallel copy and read back per node with
+  * Node::position(steps_back) or per slot with history():
+  *
+  *   g.enable_position_history(4);
+  *   for(unsigned step = 0; ; ++step) {
+  *     advance(g);                        //integrator
+  *     g.record_positions();
+  *     if(g.history_depth() > 1)
+  *       v = (n.position(0) - n.position(1)) / dt;
+  *   }
+  *
+  * Calling it again with another number of slots drops what was recorded.
+  * Complexity: O(@a slots).
+  **/
+  void enable_position_history(unsigned slots) {
+    assert(slots > 0);
+    history_.clear();
+    history_.resize(slots);
+    history_head_ = 0;
+    history_depth_ = 0;
+  }
+
+  /** Drop the recorded positions and their memory. Complexity: O(slots). */
+  void disable_position_history() {
+    decltype(history_)(history_.get_allocator()).swap(history_);
+    history_head_ = 0;
+    history_depth_ = 0;
+  }
+
+  /** Return the number of steps the history keeps, 0 unless
+   *  enable_position_history() is in effect. */
+  unsigned history_slots() const {
+    return unsigned(history_.size());
+  }
+
+  /** Return the number of steps recorded and still kept, at most
+   *  history_slots(). */
+  unsigned history_depth() const {
+    return history_depth_;
+  }
+
+  /**
+  * @brief Record the current node positions as the newest step of the
+  *        history, in place of the oldest once every slot is full.
+  *
+  * @param[in] threads  Threads to copy with; 0 means all cores
+  *
+  * @pre history_slots() > 0
+  * @post history(0) holds node(i).position() for every i < num_nodes(), and
+  *       history(k + 1) holds what history(k) held before
+  *
+  * The oldest slot is overwritten in place, so once the node count is
+  * steady no step allocates.
+  * Complexity: O(num_nodes()), spread over the threads.
+  **/
+  void record_positions(unsigned threads = 0) {
+    assert(!history_.empty());
+    history_head_ = (history_head_ + 1) % unsigned(history_.size());
+    clone_array(node_positions_, history_[history_head_],
+                csr_snapshot::thread_count(threads));
+    history_depth_ = std::min(history_depth_ + 1, unsigned(history_.size()));
+  }
+
+  /**
+  * @brief Return the node positions recorded @a steps_back steps ago.
+  *
+  * @param[in] steps_back  0 for the newest record_positions(), 1 for the one
+  *                        before, and so on
+  * @return One position per node the graph had at the time, numbered as it
+  *         was then: element i is the position node i had
+  *
+  * @pre @a steps_back < history_depth()
+  *
+  * Invalidated by the next record_positions() that reuses the slot, and by
+  * enable_position_history(), disable_position_history() and clear().
+  * Complexity: O(1).
+  **/
+  history_range history(unsigned steps_back) const {
+    const std::pmr::vector<point_type>& slot = history_slot(steps_back);
+    return history_range(slot.data(), slot.data() + slot.size(), slot.size());
+  }
+
+  /** Axis-aligned bounding box and centroid of the node positions. */
+  struct node_bounds {
+    point_type min;       //componentwise smallest position
+    point_type max;       //componentwise largest position
+    point_type centroid;  //mean position
+    size_type count = 0;  //positions covered; min and max are meaningless
+                          //if 0
+
+    bool empty() const {
+      return count == 0;
+    }
+  };
+
+  /**
+  * @brief Return the bounding box and centroid of positions_data()[0,
+  *        num_nodes()), kept up to date as nodes are added.
+  *
+  * @param none
+  * @return result.count == num_nodes(), and every position lies in
+  *         [result.min, result.max]
+  *
+  * add_node() and add_nodes() extend the box and the position sum as they
+  * go, so a viewer that autoscales every frame pays nothing per node.
+  * Moving a node through Node::position() or mark_positions_changed() may
+  * shrink the box, so the next call recomputes it with bounds(); so do
+  * remove_node(), compact() and reading a snapshot. Lazily removed nodes
+  * still count until compact(). Like Edge::length(), this fills in a cache
+  * from a const method: do not call it from several threads at once.
+  *
+  * Complexity: O(1), or as bounds() after positions changed.
+  **/
+  node_bounds bounding_box() const {
+    if(!bounds_valid_)
+      return bounds();
+    return make_bounds();
+  }
+
+  /**
+  * @brief Recompute the bounding box and centroid of every position, in
+  *        parallel.
+  *
+  * @param[in] threads  Threads to reduce with; 0 means all cores
+  * @return As bounding_box(), which uses the result from now on
+  *
+  * For when positions changed in bulk, e.g. after a time step through
+  * positions_data(): each thread reduces one contiguous slice.
+  *
+  * Complexity: O(num_nodes()), spread over the threads.
+  **/
+  node_bounds bounds(unsigned threads = 0) const {
+    CME212_TRACE_SCOPE_N("bounds", num_nodes());
+    struct partial {
+      double lo[3], hi[3], sum[3];
+    };
+    threads = csr_snapshot::thread_count(threads);
+    std::vector<partial> parts(threads);
+    for(partial& q : parts)
+      reset_bounds(q.lo, q.hi, q.sum);
+    const point_type* p = node_positions_.data();
+    csr_snapshot::parallel_ranges(threads, num_nodes(), 1 << 14,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          partial& q = parts[t];
+          for(std::size_t i = b; i < e; ++i)
+            extend_bounds(q.lo, q.hi, q.sum, p[i]);
+        });
+    reset_bounds(bounds_lo_, bounds_hi_, bounds_sum_);
+    for(const partial& q : parts) {
+      for(int a = 0; a < 3; ++a) {
+        bounds_lo_[a] = std::min(bounds_lo_[a], q.lo[a]);
+        bounds_hi_[a] = std::max(bounds_hi_[a], q.hi[a]);
+        bounds_sum_[a] += q.sum[a];
+      }
+    }
+    bounds_valid_ = true;
+    return make_bounds();
+  }
+
+  /**
+  * @brief Return a new array of one T per node, for an algorithm's own
+  *        scratch data, e.g. auto dist = g.make_node_property<float>(inf).
+  *
+  * @param[in] init  Value of every entry, and of the entries new nodes get
+  * @return NodeProperty<T> p with p.size() == num_nodes() and p[n] == init
+  *         for every node n
+  *
+  * @post While p exists, p.size() == num_nodes() after every add_node(),
+  *       add_nodes(), remove_node() and clear(), and permute_nodes() and
+  *       remove_node() renumber p with the nodes, so p[n] always belongs to
+  *       node n
+  *
+  * The array is contiguous: p.values().data() can be handed to a kernel
+  * like positions_data(). Keeping data beside the graph this way needs no
+  * change to node_value_type and no hashing. Each live property adds O(1)
+  * to every add_node() call.
+  * Complexity: O(num_nodes()).
+  **/
+  template <typename T>
+  NodeProperty<T> make_node_property(const T& init = T()) const {
+    return NodeProperty<T>(node_properties_.add(num_nodes(), init));
+  }
+
+  /**
+  * @brief Return a new array of one T per edge, e.g. per-spring forces.
+  *
+  * @param[in] init  Value of every entry, and of the entries new edges get
+  * @return EdgeProperty<T> p with p.size() == num_edges() and p[e] == init
+  *         for every edge e
+  *
+  * @post While p exists, p.size() == num_edges() after every add_edge(),
+  *       add_edges(), remove_edge(), remove_node() and clear(), and the
+  *       removals and sort_edges() renumber p with the edges. Both orientations of an edge share its entry.
+  *
+  * Complexity: O(num_edges()).
+  **/
+  template <typename T>
+  EdgeProperty<T> make_edge_property(const T& init = T()) const {
+    return EdgeProperty<T>(edge_properties_.add(num_edges(), init));
+  }
+
+  /** Add a node to the graph, returning the added node.
+   * @param[in] position The new node's position
+   * @param[in] value  The value stored inside the node
+   * @post new num_nodes() == old num_nodes() + 1
+   * @post result_node.index() == old num_nodes()
+   *
+   * Complexity: O(1) amortized operations.
+   */
+  Node add_node(const point_type& position,
+                const node_value_type& value = node_value_type ()) {
+    return emplace_node(position, value);
+  }
+
+  /** Add a node to the graph, moving @a value into it.
+   * @param[in] position The new node's position
+   * @param[in] value  The value stored inside the node. It is moved from.
+   * @post new num_nodes() == old num_nodes() + 1
+   * @post result_node.index() == old num_nodes()
+   *
+   * Complexity: O(1) amortized operations.
+   */
+  Node add_node(const point_type& position, node_value_type&& value) {
+    return emplace_node(position, std::move(value));
+  }
+
+  /** Add a node whose value is constructed in place from @a args.
+   * @param[in] position The new node's position
+   * @param[in] args     Constructor arguments for the node's value
+   * @post new num_nodes() == old num_nodes() + 1
+   * @post result_node.index() == old num_nodes()
+   * @post result_node.value() == node_value_type(args...)
+   *
+   * The value is built directly in the value array, so no temporary is
+   * copied or moved for it.
+   *
+   * Complexity: O(1) amortized operations.
+   */
+  template <typename... Args>
+  Node emplace_node(const point_type& position, Args&&... args) {
+    typename stats_type::scoped_timer timer(stats_, &graph_stats::add_node_ns,
+                                            &graph_stats::add_node_latency);
+
+    //Using the proxy's position and value arguments, we append to the
+    //separate position and value arrays to correctly add this new node.
+    //Both arrays always have the same length. Growing either array moves
+    //the stored values rather than copying them.
+    size_type old_capacity = node_positions_.capacity();
+    node_positions_.push_back(position);
+    node_values_.emplace_back(std::forward<Args>(args)...);
+    stats_.capacity_change(old_capacity, node_positions_.capacity());
+
+    //Give the node its (empty) adjacency row and, while frozen, its empty
+    //CSR row
+    finish_node_batch(this->num_nodes() - 1);
+
+    //Once we've added it to the vector, we return the new node wih the correct
+    //index
+    //NOTE: our nodes are zero indexed
+    return Node(this, this->num_nodes() - 1);
+  }
+
+  /**
+   * @brief Add a batch of nodes with default values.
+   *
+   * @param[in] first  Iterator to the first new node's position
+   * @param[in] last   Iterator one past the last new node's position
+   * @return The index of the first new node, i.e. old num_nodes()
+   *
+   * @tparam InputIt   Iterator whose values convert to point_type
+   *
+   * @post new num_nodes() == old num_nodes() + (last - first)
+   * @post node(result + k).position() == first[k] and its value is
+   *       node_value_type()
+   *
+   * Equivalent to calling add_node() on every position in order, but for
+   * forward iterators the node arrays and the adjacency array are grown
+   * once for the whole batch.
+   *
+   * Complexity: O(last - first) amortized.
+   */
+  template <typename InputIt>
+  size_type add_nodes(InputIt first, InputIt last) {
+    typename stats_type::scoped_timer timer(stats_, &graph_stats::add_node_ns);
+    CME212_TRACE_SCOPE("add_nodes");
+    size_type first_index = num_nodes();
+    size_type old_capacity = node_positions_.capacity();
+    reserve_node_batch(first, last);
+    for(; first != last; ++first) {
+      node_positions_.push_back(*first);
+      node_values_.emplace_back();
+    }
+    stats_.capacity_change(old_capacity, node_positions_.capacity());
+    finish_node_batch(first_index);
+    return first_index;
+  }
+
+  /**
+   * @brief Add a batch of nodes from parallel position and value ranges.
+   *
+   * @param[in] first   Iterator to the first new node's position
+   * @param[in] last    Iterator one past the last new node's position
+   * @param[in] values  Iterator to the first new node's value. The values
+   *                    are moved from.
+   * @return The index of the first new node, i.e. old num_nodes()
+   *
+   * @tparam PosIt  Iterator whose values convert to point_type
+   * @tparam ValIt  Iterator over at least (last - first) node values
+   *
+   * @post new num_nodes() == old num_nodes() + (last - first)
+   * @post node(result + k) has position first[k] and the value that
+   *       values[k] held before the call
+   *
+   * Meant for loaders that parse positions and values into two arrays: each
+   * value is moved straight into the graph rather than copied through one
+   * add_node() call at a time.
+   *
+   * Complexity: O(last - first) amortized.
+   */
+  template <typename PosIt, typename ValIt>
+  size_type add_nodes(PosIt first, PosIt last, ValIt values) {
+    typename stats_type::scoped_timer timer(stats_, &graph_stats::add_node_ns);
+    CME212_TRACE_SCOPE("add_nodes");
+    size_type first_index = num_nodes();
+    size_type old_capacity = node_positions_.capacity();
+    reserve_node_batch(first, last);
+    for(; first != last; ++first, ++values) {
+      node_positions_.push_back(*first);
+      node_values_.push_back(std::move(*values));
+    }
+    stats_.capacity_change(old_capacity, node_positions_.capacity());
+    finish_node_batch(first_index);
+    return first_index;
+  }
+
+  /**
+   * @brief Return the node within @a tolerance of @a position, adding one
+   *        there if there is none.
+   *
+   * @param[in] position   Position of the wanted node
+   * @param[in] tolerance  Largest distance at which a node counts as the
+   *                       same; 0 asks for the exact position
+   * @param[in] value      Value of the node if it is added
+   * @return The nearest live node within @a tolerance, or the new node
+   *
+   * @pre @a tolerance >= 0
+   * @post result.position() is within @a tolerance of @a position
+   *
+   * For loaders of mesh files that repeat the vertices shared by patches:
+   * call it instead of add_node() and every vertex becomes one node as it
+   * is read, rather than a duplicate for weld_nodes() to merge afterwards.
+   * The lookup is a hash grid with cells @a tolerance wide, kept up to
+   * date by the nodes this adds and rebuilt in O(num_nodes()) by the first
+   * call after any other topology change or with another tolerance. Nodes
+   * moved since that rebuild are found at their old positions only.
+   *
+   * Complexity: O(1) expected for a fixed @a tolerance on inputs with
+   * few nodes per cell.
+   */
+  Node find_or_add_node(const point_type& position, double tolerance = 0,
+                        const node_value_type& value = node_value_type()) {
+    assert(tolerance >= 0);
+    if(weld_version_ != topology_version_ || weld_tolerance_ != tolerance)
+      build_weld_grid(tolerance);
+    const size_type none = size_type(-1);
+    size_type best = none;
+    double best_distance = HUGE_VAL;
+    for_each_weld_candidate(position, [&](size_type j) {
+      double d = weld_distance(node_positions_[j], position);
+      if(d <= tolerance && !node_removed(j) &&
+         (d < best_distance || (d == best_distance && j < best))) {
+        best = j;
+        best_distance = d;
+      }
+    });
+    if(best != none)
+      return Node(this, best);
+
+    Node n = add_node(position, value);
+    if(2 * std::size_t(num_nodes()) > weld_heads_.size())
+      build_weld_grid(tolerance);
+    else
+      weld_insert(n.index());
+    weld_version_ = topology_version_;
+    return n;
+  }
+
+  /**
+   * @brief Reserve storage for a graph of known final size.
+   *
+   * @param[in] nodes   Expected total number of nodes
+   * @param[in] edges   Expected total number of edges
+   * @param[in] degree  Expected average node degree. If 0, it is derived
+   *                    from 2 * @a edges / @a nodes.
+   *
+   * @pre Graph object exists
+   * @post Adding up to @a nodes nodes and @a edges edges does not reallocate
+   *       the node arrays, graph_edges or the outer adjacency array.
+   * @post The adjacency row of every existing and future node has room for
+   *       @a degree neighbors.
+   *
+   * Intended for loaders that read the element counts from a file header, so
+   * that every container is allocated once instead of growing repeatedly.
+   * Outstanding Node and Edge objects stay valid.
+   *
+   * Complexity: O(num_nodes()) plus the cost of the allocations.
+   */
+  void reserve(size_type nodes, size_type edges, size_type degree = 0) {
+    node_positions_.reserve(nodes);
+    node_values_.reserve(nodes);
+    graph_edges.reserve(edges);
+    edge_values_.reserve(edges);
+    if(weighted_)
+      edge_weights_.reserve(edges);
+    adjacency_.reserve(nodes);
+    degrees_.reserve(nodes);
+
+    if(degree == 0 && nodes != 0)
+      degree = (2 * std::uint64_t(edges) + nodes - 1) / nodes;
+    expected_degree_ = degree;
+    if(expected_degree_ != 0) {
+      for(incidence_row& row : adjacency_)
+        row.reserve(expected_degree_);
+    }
+  }
+
+  /**
+   * @brief Release the spare capacity of every internal container.
+   *
+   * @param none
+   * @return The bytes given back, the drop in memory_usage().reserved()
+   *
+   * @post Every node, edge, adjacency, CSR and flag array and every row has
+   *       capacity() == size(), so memory_usage().reserved() equals
+   *       memory_usage().used() except for the property arrays, which
+   *       belong to their handles
+   *
+   * Meant for the end of a bulk load: growth leaves each row and array
+   * with up to twice the capacity it needs, which across millions of rows
+   * adds up. Call freeze() as well for the CSR layout; its arrays are sized
+   * exactly from the start. The reserve() degree hint is dropped, so rows
+   * of nodes added later start empty.
+   *
+   * Invalidates nothing but pointers into the arrays, such as
+   * positions_data(). Complexity: O(num_nodes() + num_edges()), a copy of
+   * every array that has spare capacity.
+   **/
+  std::size_t shrink_to_fit() {
+    std::size_t before = memory_usage().reserved();
+    node_positions_.shrink_to_fit();
+    node_values_.shrink_to_fit();
+    front_positions_.shrink_to_fit();
+    front_values_.shrink_to_fit();
+    for(auto& slot : history_)
+      slot.shrink_to_fit();
+    graph_edges.shrink_to_fit();
+    edge_values_.shrink_to_fit();
+    edge_weights_.shrink_to_fit();
+    edge_cache_.shrink_to_fit();
+    for(incidence_row& row : adjacency_)
+      row.shrink_to_fit();
+    adjacency_.shrink_to_fit();
+    degrees_.shrink_to_fit();
+    removed_nodes_.shrink_to_fit();
+    removed_edges_.shrink_to_fit();
+    csr_offsets_.shrink_to_fit();
+    csr_incidences_.shrink_to_fit();
+    csr_stale_.shrink_to_fit();
+    coloring_.edges.shrink_to_fit();
+    coloring_.offsets.shrink_to_fit();
+    node_coloring_.nodes.shrink_to_fit();
+    node_coloring_.offsets.shrink_to_fit();
+    expected_degree_ = 0;
+    weld_heads_ = std::vector<size_type>();
+    weld_next_ = std::vector<size_type>();
+    weld_version_ = 0;
+    std::size_t after = memory_usage().reserved();
+    return before > after ? before - after : 0;
+  }
+
+  /** Determine if a Node belongs to this Graph
+   * @param n   Node to check to see if it belongs in the graph
+   * @return True if @a n is currently a Node of this Graph
+   *
+   * @pre n is a valid Node
+   * @post n.index() < this->num_nodes() and n was not removed by
+   *       lazy_remove_node()
+   * Complexity: O(1).
+   */
+  bool has_node(const Node& n) const {
+    //Since n.index() >= 0 is a tautology since n.index() is unsigned, we check
+    //to see if the index of the node is within the bounds of the size of
+    //the graph
+    if(n.index() < this->num_nodes() && !node_removed(n.index()))
+      return true;
+
+    return false;
   }
 
   /** Return the node with index @a i.
@@ -495,14 +2014,13 @@ class Graph {
     * @post Node that is returned corresponds to one of the nodes in the edge.
     **/
     Node node1() const {
-      //return a Node object with the correct index. Uses the helper function
-      //as defined in the private section. Direction corresponds to different
-      //directions of the edge (either (a,b) or (b,a)).
-      if(direction_) {
-        return Node(graph_, this->fetch_edge().source);
+      //Edges from an incident iterator know node1() already; the others
+      //are oriented as stored, with node1() the source
+      if(node1_ != stored_source) {
+        return Node(graph_, node1_);
       }
       else {
-        return Node(graph_, this->fetch_edge().dest);
+        return Node(graph_, this->fetch_edge().source);
       }
     }
 
@@ -516,15 +2034,128 @@ class Graph {
     * @post Node that is returned corresponds to the other node in the edge.
     **/
     Node node2() const {
-      //Same as above
-      if(direction_) {
-        return Node(graph_, this->fetch_edge().dest);
+      //The endpoint of the stored edge that is not node1()
+      const internal_edge& e = this->fetch_edge();
+      if(node1_ == stored_source || node1_ == e.source) {
+        return Node(graph_, e.dest);
       }
       else {
-        return Node(graph_, this->fetch_edge().source);
+        return Node(graph_, e.source);
       }
     }
 
+    /**
+    * @brief Return this edge's index
+    *
+    * @param none
+    * @return The edge's uid, in the range [0, num_edges())
+    *
+    * @pre Edge object exists and is valid
+    * @post Both orientations of the edge have the same index, and
+    *       graph.edge(index()) == *this
+    **/
+    size_type index() const {
+      return this->uid_;
+    }
+
+    /**
+    * @brief Return the reference to the edge's value
+    *
+    * @param none
+    * @return The edge_value_type value stored with this edge
+    *
+    * @pre Edge object exists and is valid
+    * @post Both orientations of the edge share the same value
+    *
+    * The values of all edges are stored contiguously in edge uid order, so
+    * this is one array access.
+    * Complexity: O(1).
+    **/
+    edge_value_type& value() {
+      return graph_->edge_values_[uid_];
+    }
+
+    /**
+    * @brief Return a constant reference to the edge's value
+    *
+    * @param none
+    * @return The const edge_value_type value stored with this edge
+    *
+    * @pre Edge object exists and is valid
+    *
+    * Complexity: O(1).
+    **/
+    const edge_value_type& value() const {
+      return graph_->edge_values_[uid_];
+    }
+
+    /**
+    * @brief Return the edge's weight.
+    *
+    * @param none
+    * @return The float weight stored with this edge, 1 unless set_weight()
+    *         changed it
+    *
+    * @pre The graph has_weights()
+    *
+    * Complexity: O(1).
+    **/
+    float weight() const {
+      assert(graph_->weighted_);
+      return graph_->edge_weights_[uid_];
+    }
+
+    /**
+    * @brief Set the edge's weight to @a w.
+    *
+    * @pre The graph has_weights()
+    * @post weight() == @a w, for both orientations
+    *
+    * Marks weights_view() stale; the next call refreshes it.
+    * Complexity: O(1).
+    **/
+    void set_weight(float w) {
+      assert(graph_->weighted_);
+      graph_->edge_weights_[uid_] = w;
+      graph_->csr_weights_valid_ = false;
+    }
+
+    /**
+    * @brief Return the length of this edge.
+    *
+    * @param none
+    * @return The distance between node1() and node2()
+    *
+    * @pre Edge object exists and is valid
+    *
+    * The length and unit direction of every edge are cached. The first call
+    * allocates the cache. After that, an edge is only recomputed when one of
+    * its endpoints has been moved through Node::position() since the edge
+    * was last used, so a time step that moves a few nodes only pays for the
+    * edges around them.
+    *
+    * Complexity: O(1) amortized.
+    **/
+    double length() const {
+      return graph_->edge_geometry(uid_).length;
+    }
+
+    /**
+    * @brief Return the unit vector pointing from node1() to node2().
+    *
+    * @param none
+    * @return (node2().position() - node1().position()) / length()
+    *
+    * @pre Edge object exists and length() > 0
+    *
+    * Shares the cache of length().
+    * Complexity: O(1) amortized.
+    **/
+    point_type direction() const {
+      edge_cache_entry c = graph_->edge_geometry(uid_);
+      return forward() ? c.unit : -c.unit;
+    }
+
     /**
     * @brief Test whether this edge and @a e are equal.
     *
@@ -578,25 +2209,39 @@ class Graph {
     //have a pointer to the referenced graph, and a uid for each Edge object
     graph_type* graph_;
     size_type uid_;
-    bool direction_;
+    //Index of node1(), or stored_source when node1() is the stored source
+    size_type node1_ = stored_source;
     // Allow Graph to access Edge's private member data and functions.
 
+    static constexpr size_type stored_source = ~size_type(0);
+
     /**
     * @brief Constructor for a valid edge with two arguments: the graph
     *        and a uid
     *
     * @param[in] graph        Graph object that contains the edge
     * @param[in] uid          unsigned integer of edge's index/unique id
+    * @param[in] node1        Index of node1(), one of the endpoints, or
+    *                         stored_source for the stored orientation
     * @return                 An Edge containing the initialized values
     *
     * @pre graph_ is not a nullptr
     * @pre 0 <= uid < size of the graph
     * @post A Edge e such that e.graph_ != nullptr and
     *       0 <= uid_ < number of edges is returned.
+    *
+    * Nothing is read from graph_edges, so incident iterators, which know
+    * node1() from the row they walk, make Edges without touching it.
     **/
-    Edge(const graph_type* graph, size_type uid, bool direction)
-        : graph_(const_cast<graph_type*>(graph)), uid_(uid),
-                 direction_(direction){
+    Edge(const graph_type* graph, size_type uid,
+         size_type node1 = stored_source)
+        : graph_(const_cast<graph_type*>(graph)), uid_(uid), node1_(node1){
+    }
+
+    /** Return true if node1() is the stored source of the edge. */
+    bool forward() const {
+      return node1_ == stored_source ||
+             node1_ == access_type::get(graph_->graph_edges, uid_).source;
     }
 
     /**
@@ -614,10 +2259,91 @@ class Graph {
     **/
     internal_edge& fetch_edge() const {
       assert(uid_ >= 0 && uid_ < graph_->num_edges());
+      graph_->stats_.count(&graph_stats::fetch_edge);
+
+      //The assert above is the bounds check in debug builds; release builds
+      //index the array directly unless CME212_CHECKED_ACCESS is set
+      return access_type::get(graph_->graph_edges, uid_);
+    }
+
+    friend class Graph;
+  };
+
+  /** @class Graph::EdgeHandle
+   * @brief A compact, graph-free name for an oriented edge.
+   *
+   * An EdgeHandle packs an edge uid and its orientation bit into a single
+   * size_type, so it is a quarter of the size of an Edge and vectors of
+   * handles sort and copy as plain integers. It converts implicitly from an
+   * Edge, and back with Graph::edge(handle).
+   *
+   * Handles order and compare by (uid, orientation). The top bit of the
+   * word is the orientation, so a graph can hand out handles for up to
+   * 2^(bits of size_type - 1) edges.
+   */
+  class EdgeHandle : private totally_ordered<EdgeHandle> {
+   public:
+    /**
+    * @brief Construct an invalid handle.
+    *
+    * @param none
+    * @return EdgeHandle object
+    **/
+    EdgeHandle() : bits_(~size_type(0)) {
+    }
+
+    /**
+    * @brief Construct the handle of @a e, keeping its orientation.
+    *
+    * @param[in] e  A valid Edge
+    * @return EdgeHandle h with h.index() == the uid of @a e
+    *
+    * @pre The uid of @a e is less than 2^(bits of size_type - 1)
+    **/
+    EdgeHandle(const Edge& e)
+        : bits_(size_type(size_type(e.uid_ << 1) | size_type(!e.forward()))) {
+      assert(e.uid_ < (size_type(1) << (8 * sizeof(size_type) - 1)));
+    }
+
+    /**
+    * @brief Return the uid of the named edge.
+    *
+    * @param none
+    * @return The edge's index in the graph's edge array
+    **/
+    size_type index() const {
+      return size_type(bits_ >> 1);
+    }
+
+    /**
+    * @brief Return whether the handle names the edge from dest to source.
+    *
+    * @param none
+    * @return True if node1() of the corresponding Edge is the node the
+    *         edge was added second, false otherwise
+    **/
+    bool flipped() const {
+      return (bits_ & 1) != 0;
+    }
+
+    /**
+    * @brief Test whether this handle and @a h name the same oriented edge.
+    **/
+    bool operator==(const EdgeHandle& h) const {
+      return bits_ == h.bits_;
+    }
 
-      return graph_->graph_edges.at(uid_);
+    /**
+    * @brief Order handles by edge uid, then by orientation.
+    **/
+    bool operator<(const EdgeHandle& h) const {
+      return bits_ < h.bits_;
     }
 
+   private:
+    //uid << 1, with the low bit set when the edge is flipped
+    size_type bits_;
+
     friend class Graph;
   };
 
@@ -652,12 +2378,29 @@ class Graph {
   Edge edge(size_type i) const {
     //Validate to see if index is in range and return the Edge object.
     if(i < this->num_edges())
-      return Edge(this, i, true);
+      return Edge(this, i);
 
     //Otherwise, return an invalid Edge
     return Edge();
   }
 
+  /**
+   * @brief Return the oriented edge named by @a h.
+   * @param[in] h  Handle of an edge of this graph
+   * @return Edge e with EdgeHandle(e) == @a h
+   *
+   * @pre @a h.index() < num_edges()
+   *
+   * Unchecked in release builds: this is the fast way back from a handle
+   * inside hot loops.
+   * Complexity: O(1).
+   */
+  Edge edge(const edge_handle& h) const {
+    assert(h.index() < num_edges());
+    return Edge(this, h.index(), h.flipped() ? graph_edges[h.index()].dest
+                                             : Edge::stored_source);
+  }
+
   /** Test whether two nodes are connected by an edge.
    * @param[in] a   A Node in the edge
    * @oaram[in] b   The other node in the edge
@@ -666,508 +2409,5102 @@ class Graph {
    * @pre @a a and @a b are valid nodes of this graph
    * @return True if for some @a i, edge(@a i) connects @a a and @a b.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(log min(a.degree(), b.degree())).
    */
   bool has_edge(const Node& a, const Node& b) const {
-    bool flag = false;
+    typename stats_type::scoped_timer timer(stats_, &graph_stats::has_edge_ns,
+                                            &graph_stats::has_edge_latency);
+    stats_.count(&graph_stats::has_edge);
 
-    //Search in the outer map in the edge_search map, the first
-    //key corresponds to the first node in the graph. The value of the
-    //outer-most map is another map. This map contains all the nodes that @a a
-    //connects to with an edge. We can then iterate through this inner map to
-    //find the indices of the edge if there is one that connects @a a to @a b.
-    //The following code is the nested iteration through the adjacency map.
-    auto search = edge_search.find(a.index());
-    if(search != edge_search.end()) {
-      //
-      auto secondSearch = (search->second).find(b.index());
-      if(secondSearch != (search->second).end())
-        flag = true;
+    //Every adjacency row is kept sorted by neighbor index, frozen or not, so
+    //the edge is found by searching the shorter of the two endpoint rows;
+    //rows left unsorted by a bulk load are sorted on the first lookup
+    sort_rows();
+    size_type u = a.index();
+    size_type v = b.index();
+    if(row_size(v) < row_size(u))
+      std::swap(u, v);
+    stats_.add(&graph_stats::has_edge_probes, search_probes(row_size(u)));
+    if(num_removed_edges_ != 0) {
+      const csr_incidence* x = find_incidence(u, v);
+      return x != nullptr && !edge_removed(x->edge);
     }
+    return sorted_contains(row_data(u), row_size(u), v, csr_neighbor());
+  }
+
+  /**
+  * @brief Answer @a count has_edge() queries at once.
+  *
+  * @param[in]  queries  Pairs of endpoints, each Node or node index
+  * @param[in]  count    Number of queries
+  * @param[out] out      out[i] is set to whether queries[i] is an edge
+  * @param[in]  threads  Threads to answer with; 0 means all cores
+  * @return How many of the queries are edges
+  *
+  * @pre Every endpoint is a valid node of this graph
+  * @post For all i < count, out[i] ==
+  *       has_edge(queries[i].first, queries[i].second)
+  *
+  * Meant for phases such as contact detection that ask millions of
+  * independent questions. Answered one by one, every query waits on two
+  * dependent cache misses, the row header and then the row. Each thread
+  * instead takes a contiguous share of the queries and walks it as a
+  * pipeline: the row header of query i + 2 * prefetch_distance and the row
+  * of query i + prefetch_distance are prefetched while query i is probed,
+  * so the misses of many queries overlap. Queries are looked up in the row
+  * of their lower endpoint, so runs of queries from one node, as a contact
+  * phase emits them, reuse one cached row. Short rows are probed with the
+  * vectorized scan of sorted_contains(). For a handful of queries,
+  * has_edge() is as fast.
+  *
+  * Complexity: O(log degree) per query, spread over the threads.
+  **/
+  template <typename N>
+  size_type has_edges(const std::pair<N, N>* queries, size_type count,
+                      bool* out, unsigned threads = 0) const {
+    typename stats_type::scoped_timer timer(stats_, &graph_stats::has_edge_ns);
+    stats_.add(&graph_stats::has_edge, count);
 
-    //Returns depending on if the toggle was triggered.
-    return flag;
+    threads = csr_snapshot::thread_count(threads);
+    sort_rows(threads);
+    std::vector<size_type> found(threads, 0);
+    csr_snapshot::parallel_ranges(threads, count, 1 << 12,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          auto lower = [&](std::size_t i) {
+            return std::min(endpoint_index(queries[i].first),
+                            endpoint_index(queries[i].second));
+          };
+          size_type hits = 0;
+          for(std::size_t i = b; i < e; ++i) {
+            if(i + 2 * prefetch_distance < e)
+              prefetch_row_header(lower(i + 2 * prefetch_distance));
+            if(i + prefetch_distance < e)
+              __builtin_prefetch(row_data(lower(i + prefetch_distance)));
+            size_type u = endpoint_index(queries[i].first);
+            size_type v = endpoint_index(queries[i].second);
+            if(v < u)
+              std::swap(u, v);
+            bool hit;
+            if(num_removed_edges_ == 0) {
+              hit = sorted_contains(row_data(u), row_size(u), v, csr_neighbor());
+            } else {
+              const csr_incidence* x = find_incidence(u, v);
+              hit = x != nullptr && !edge_removed(x->edge);
+            }
+            out[i] = hit;
+            hits += hit;
+          }
+          found[t] = hits;
+        });
+
+    size_type total = 0;
+    for(size_type f : found)
+      total += f;
+    return total;
   }
 
   /**
    * @brief Add an edge to the graph, or return the current edge
    *        if it already exists
    *
-   * @param[in] a   A Node in the edge
-   * @oaram[in] b   The other node in the edge
+   * @param[in] a      A Node in the edge
+   * @oaram[in] b      The other node in the edge
+   * @param[in] value  Value of the edge if it is new
    * @return an Edge object e with e.node1() == @a a and e.node2() == @a b
    *
    * @pre @a a and @a b are distinct valid nodes of this graph
    * @post has_edge(@a a, @a b) == true
-   * @post If old has_edge(@a a, @a b), new num_edges() == old num_edges().
-   *       Else,                        new num_edges() == old num_edges() + 1.
+   * @post If old has_edge(@a a, @a b), new num_edges() == old num_edges()
+   *       and the edge keeps its value.
+   *       Else,                        new num_edges() == old num_edges() + 1
+   *       and result.value() == @a value. An edge removed by
+   *       lazy_remove_edge() is restored in its old slot instead, so
+   *       num_edges() does not change.
    *
    * Can invalidate edge indexes -- in other words, old edge(@a i) might not
    * equal new edge(@a i). Must not invalidate outstanding Edge objects.
    *
-   * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+   * Complexity: O(a.degree() + b.degree()), for the sorted insertion into
+   * both adjacency rows.
    */
-  Edge add_edge(const Node& a, const Node& b) {
-    //If it has the edge in the graph, return in. Check both directions
-    if(has_edge(a, b)) {
-      return Edge(this, edge_search[a.index()][b.index()], true);
-    }
-    if(has_edge(b, a)) {
-      return Edge(this, edge_search[a.index()][b.index()], false);
-    }
-    //If the edge was not found, then we need to add it. We add it by
-    //initializing with a new variable, setting the source and dest values
-    //and appending it to our graph_edges vector. This way, we update this in
-    //memory. In addition, make sure we add it to the edge_search map for ease
-    //of search in the future
-    internal_edge new_edge;
-    new_edge.source = a.index();
-    new_edge.dest = b.index();
-    graph_edges.push_back(new_edge);
+  Edge add_edge(const Node& a, const Node& b,
+                const edge_value_type& value = edge_value_type()) {
+    typename stats_type::scoped_timer timer(stats_, &graph_stats::add_edge_ns,
+                                            &graph_stats::add_edge_latency);
 
-    size_type new_index = graph_edges.size() - 1;
-    edge_search[a.index()][b.index()] = new_index;
-    edge_search[b.index()][a.index()] = new_index;
-
-    return Edge(this, new_index, true);
+    assert(has_node(a) && has_node(b));
+    //If it has the edge in the graph, return it, oriented from a to b. A
+    //tombstoned edge is brought back in its old slot with the new value.
+    //A multigraph, or a bulk load, skips the lookup and always appends.
+    const csr_incidence* found = (parallel_edges_ || bulk_load_) ? nullptr
+                                 : find_incidence(a.index(), b.index());
+    if(found != nullptr) {
+      if(edge_removed(found->edge)) {
+        stats_.count(&graph_stats::add_edge_new);
+        revive_edge(found->edge);
+        edge_values_[found->edge] = value;
+      } else {
+        stats_.count(&graph_stats::add_edge_duplicate);
+      }
+      return Edge(this, found->edge, a.index());
+    }
+    stats_.count(&graph_stats::add_edge_new);
+    return Edge(this, append_edge(a.index(), b.index(), value));
   }
 
   /**
-   * @brief Remove all nodes and edges from this graph.
+   * @brief Add an edge known not to be in the graph, without looking for it.
    *
-   * @param none
+   * @param[in] a      A Node in the edge
+   * @param[in] b      The other node in the edge
+   * @param[in] value  Value of the edge
+   * @return The new edge e, with e.node1() == @a a and e.node2() == @a b
    *
-   * @pre Graph object exists
-   * @post num_nodes() == 0 && num_edges() == 0
+   * @pre @a a and @a b are distinct valid nodes of this graph
+   * @post new num_edges() == old num_edges() + 1 and result.value() == @a value
    *
-   * Invalidates all outstanding Node and Edge objects. As well as the
-   * edge_search map.
-   * Clearing here simply means flushing the vectors of any stored objects.
-   * We leave the destruction of these objects to the destructor.
+   * For inputs that are duplicate free by construction, such as generated
+   * meshes, where add_edge()'s search of the row is wasted. If the edge
+   * was in the graph after all, the graph now has two parallel edges
+   * between @a a and @a b, as with allows_parallel_edges(); dedup_edges()
+   * removes them again. A tombstoned edge between the two is not revived.
+   *
+   * Complexity: O(a.degree() + b.degree()), for the sorted insertion into
+   * both adjacency rows, without the search that precedes it in add_edge().
    */
-  void clear() {
-    graph_nodes.clear();
-    graph_edges.clear();
-    edge_search.clear();
+  Edge add_edge_unchecked(const Node& a, const Node& b,
+                          const edge_value_type& value = edge_value_type()) {
+    typename stats_type::scoped_timer timer(stats_, &graph_stats::add_edge_ns,
+                                            &graph_stats::add_edge_latency);
+    assert(has_node(a) && has_node(b) && a.index() != b.index());
+    stats_.count(&graph_stats::add_edge_new);
+    return Edge(this, append_edge(a.index(), b.index(), value));
   }
 
-  //
-  // Node Iterator
-  //
+  /**
+   * @brief Choose whether the graph is a multigraph.
+   *
+   * @param[in] allow  True to let add_edge() and add_edges() add parallel
+   *                   edges, false (the default) to deduplicate
+   *
+   * In a multigraph add_edge() and add_edges() never search for the edge
+   * or deduplicate a batch: ingest is a plain append. Parallel edges are
+   * ordinary edges with their own indices and values. Each is visited by
+   * edge and incident iteration and counted in the degrees, and each can be
+   * removed on its own. has_edge() and remove_edge(a, b) see whichever of
+   * them comes first in the row. dedup_edges() pays for the deduplication
+   * once, e.g. after ingest, whatever the setting.
+   **/
+  void set_allow_parallel_edges(bool allow) {
+    parallel_edges_ = allow;
+  }
+  bool allows_parallel_edges() const {
+    return parallel_edges_;
+  }
 
-  /** @class Graph::NodeIterator
-   * @brief Iterator class for nodes. A forward iterator. */
-  class NodeIterator : private totally_ordered<NodeIterator>{
-   public:
-    // These type definitions let us use STL's iterator_traits.
-    using value_type        = Node;                     // Element type
-    using pointer           = Node*;                    // Pointers to elements
-    using reference         = Node&;                    // Reference to elements
-    using difference_type   = std::ptrdiff_t;           // Signed difference
-    using iterator_category = std::input_iterator_tag;  // Weak Category, Proxy
+  /**
+   * @brief Start a trusted bulk load: add edges without keeping the
+   *        adjacency rows searchable until they are needed.
+   *
+   * @post in_bulk_load() == true
+   *
+   * For loaders of inputs that are duplicate free by construction, and
+   * jobs that only iterate afterwards. Until end_bulk_load(), add_edge()
+   * neither searches for the edge nor inserts it in order: the incidence
+   * is appended to both endpoint rows, as add_edge_unchecked() would add
+   * it without the sorted insertion. An edge added twice becomes two
+   * parallel edges, which dedup_edges() removes.
+   *
+   * Rows are sorted again, all at once and in parallel, by end_bulk_load()
+   * or by the first operation that searches them: has_edge(), has_edges(),
+   * a remove, add_edges(), freeze(), serialize(), dedup_edges() or
+   * validate(). Until then incident iteration visits each row in insertion
+   * order, not by neighbor. A lookup sorts even though it is const, so the
+   * first lookup after a bulk load must not run concurrently with other
+   * reads; call end_bulk_load() first where it could.
+   *
+   * Complexity: O(1).
+   **/
+  void begin_bulk_load() {
+    bulk_load_ = true;
+  }
 
-    /**
-    * @brief Construct an invalid NodeIterator.
-    *
-    * @param none
-    * @return NodeIterator object
-    *
-    * @pre none
-    * @post NodeIterator object is created
-    **/
-    NodeIterator() {
-    }
+  /**
+   * @brief End a bulk load begun by begin_bulk_load(), sorting every row
+   *        it left unsorted.
+   *
+   * @param[in] threads  Threads to sort the rows with; 0 means all cores
+   *
+   * @post in_bulk_load() == false, and add_edge() searches again
+   *
+   * Complexity: O(sum of d log d over the row lengths d), spread over the
+   * threads, if any row was appended to; O(1) otherwise.
+   **/
+  void end_bulk_load(unsigned threads = 0) {
+    bulk_load_ = false;
+    sort_rows(threads);
+  }
 
-    /**
-    * @brief Operator to deference the iterator and find what node the
-    *        iterator is pointing to.
-    *
-    * @param none
-    * @return Node object corresponding to the object the iterator is
-    *         pointing to.
-    *
-    * @pre this object is initialized
-    * @post The result is the Node that the iterator is pointing to.
-    *
-    * We use the iterInd_ which mimics the index of the node to search for the
-    * correct node for our purposes.
-    **/
-    Node operator*() const {
-      return Node(graph_, iterInd_);
-    }
+  /** Return whether a bulk load is in progress. */
+  bool in_bulk_load() const {
+    return bulk_load_;
+  }
 
-    /**
-    * @brief Operator to increment the iterator
-    *
-    * @param none
-    * @return NodeIterator object that now has an incremented index.
-    *
-    * @pre this object is initialized
-    * @post new iterInd_ = old iterInd_ + 1
-    *
-    * We use the iterInd_ which mimics the index of the node to search for the
-    * correct node for our purposes.
-    **/
-    NodeIterator& operator++() {
-      iterInd_++;
-      return *this;
+  /**
+   * @brief Start a period in which any number of threads may read the
+   *        graph at once, with nothing written behind their backs.
+   *
+   * @param[in] threads  Threads to bring the caches up to date with; 0
+   *                     means all cores
+   *
+   * @pre !in_bulk_load()
+   * @post concurrent_reads() == true
+   *
+   * Proxies hold a non-const pointer to their graph, and a few reads keep
+   * caches up to date as they go: Edge::length() fills in its cache,
+   * bounding_box() recomputes stale bounds, the first lookup after a bulk
+   * load sorts the rows, weights_view() refreshes its array. This sorts
+   * what is unsorted and refreshes what is stale up front, then turns every
+   * one of those writes off: until end_concurrent_reads(), Edge::length()
+   * and direction() compute what is not cached instead of caching it, and
+   * the graph's
+   * memory is only read by
+   *
+   *   has_edge() and has_edges(),
+   *   node(), edge(), the node, edge, incident and neighbor iterators and
+   *   ranges, for_each_neighbor(),
+   *   Node and Edge position, value, degree, length and weight reads,
+   *   positions_data(), values_data(), view_csr(), weights_view(),
+   *   bounding_box(),
+   *
+   * so calling them from several threads needs no lock:
+   *
+   *   g.begin_concurrent_reads();
+   *   //threads answer queries through g
+   *   g.end_concurrent_reads();
+   *
+   * Still not covered: edge_coloring(), node_coloring(), columns_view()
+   * and make_node_property() on a const graph (call the first three
+   * before, as their caches then stay valid), and every operation in a
+   * build with CME212_GRAPH_STATS set, whose counters are plain integers.
+   *
+   * Complexity: O(1) when nothing is stale; otherwise sorting the rows a
+   * bulk load appended to, recomputing the bounds and the invalid entries of
+   * the edge cache, spread over the threads.
+   **/
+  void begin_concurrent_reads(unsigned threads = 0) {
+    assert(!bulk_load_);
+    threads = csr_snapshot::thread_count(threads);
+    sort_rows(threads);
+    if(!bounds_valid_)
+      bounds(threads);
+    if(edge_cache_.size() == graph_edges.size()) {
+      csr_snapshot::parallel_ranges(threads, edge_cache_.size(), 1 << 14,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for(std::size_t k = b; k < e; ++k)
+              cached_edge(size_type(k));
+          });
     }
+    weights_view();
+    concurrent_reads_ = true;
+  }
 
-    /**
-    * @brief Operator to test equality of the the NodeIterator
-    *
-    * @param[in] ni the NodeIterator object to compare this to
-    * @return True if the NodeIterator objects are the same. False otherwise.
-    *
-    * @pre this object is initialized
-    * @pre ni is a valid NodeIterator object.
-    * @post if the result is true, then this->graph_ == ni.graph_ and
-    *       this->iterInd_ == ni.iterInd_. If false, then these conditions
-    *       do not have to hold.
-    **/
-    bool operator==(const NodeIterator& ni) const {
-      if(this->graph_ == ni.graph_ && this->iterInd_ == ni.iterInd_)
-        return true;
-      else
-        return false;
-    }
+  /**
+   * @brief End a period begun by begin_concurrent_reads().
+   *
+   * @pre No thread reads the graph during the call
+   * @post concurrent_reads() == false, and Edge::length() and direction()
+   *       fill in the edge cache again
+   *
+   * Complexity: O(1).
+   **/
+  void end_concurrent_reads() {
+    concurrent_reads_ = false;
+  }
 
-   private:
-    graph_type* graph_;
-    size_type iterInd_;
+  /** Return whether begin_concurrent_reads() is in effect. */
+  bool concurrent_reads() const {
+    return concurrent_reads_;
+  }
 
-    /**
-    * @brief Constructor for a valid NodeIterator with two arguments: the graph
-    *        and a uid
-    *
-    * @param[in] graph        Graph object that contains the node
-    * @param[in] iterInd      unsigned integer of index the iterator is
-    *                         pointing to
-    * @return                 An NodeIterator containing the initialized values
-    *
-    * @pre graph_ is not a nullptr
-    * @pre 0 <= iterInd < size of the graph
-    * @post A NodeIterator n such that n.graph_ != nullptr and
-    *       0 <= iterInd_ < size of the graph is returned.
-    **/
-    NodeIterator(const graph_type* graph, size_type iterInd)
-        : graph_(const_cast<graph_type*>(graph)), iterInd_(iterInd){
+  /**
+   * @brief Add a batch of edges in one pass.
+   *
+   * @param[in] first  Iterator to the first endpoint pair
+   * @param[in] last   Iterator one past the last endpoint pair
+   * @return The number of edges that were actually added
+   *
+   * @tparam InputIt   Iterator over pair-like values (anything std::get<0>
+   *                   and std::get<1> work on) holding either two Node
+   *                   objects or two node indices.
+   *
+   * @pre Every pair holds two distinct valid nodes of this graph
+   * @post has_edge(a, b) == true for every pair (a, b) in the range
+   * @post new num_edges() == old num_edges() + result, and every new edge
+   *       has value edge_value_type(). Edges removed by lazy_remove_edge()
+   *       are restored in their old slots instead; they count towards the
+   *       result but not towards num_edges().
+   *
+   * The pairs are normalized to (min index, max index), radix sorted and
+   * deduplicated in one linear pass, so an edge shared by several mesh
+   * elements is only looked up once. Edges already in the graph are
+   * skipped. New edges are appended in sorted order after reserving room for
+   * all of them at once. The order of the existing edges is preserved.
+   * Because the new pairs are sorted, the incidences each node receives
+   * arrive already sorted by neighbor and are merged into its row in one
+   * pass, rather than inserted one at a time.
+   * In a multigraph (set_allow_parallel_edges()) nothing is deduplicated
+   * or looked up: every pair becomes a new edge.
+   *
+   * Complexity: O(num_nodes() + k + sum of the touched row lengths) for a
+   * range of k pairs.
+   */
+  template <typename InputIt>
+  size_type add_edges(InputIt first, InputIt last) {
+    CME212_TRACE_SCOPE("add_edges");
+    sort_rows();
+    //Turn every pair into its canonical key
+    std::vector<edge_key> keys;
+    for(; first != last; ++first) {
+      size_type a = endpoint_index(std::get<0>(*first));
+      size_type b = endpoint_index(std::get<1>(*first));
+      assert(a != b && a < num_nodes() && b < num_nodes());
+      keys.push_back(make_key(a, b));
     }
 
-    friend class Graph;
+    sort_keys(keys);
+    if(!parallel_edges_)
+      keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    //Drop edges the graph already has, and count how many new incidences
+    //each node receives so the adjacency rows are sized only once
+    std::vector<size_type> new_degree(num_nodes(), 0);
+    size_type added = 0;
+    size_type revived = 0;
+    for(const edge_key& key : keys) {
+      size_type a = key_source(key);
+      size_type b = key_dest(key);
+      if(parallel_edges_) {
+        keys[added++] = key;
+        ++new_degree[a];
+        ++new_degree[b];
+        continue;
+      }
+      if(num_removed_edges_ != 0) {
+        const csr_incidence* x = find_incidence(a, b);
+        if(x != nullptr && edge_removed(x->edge)) {
+          revive_edge(x->edge);
+          edge_values_[x->edge] = edge_value_type();
+          ++revived;
+          continue;
+        }
+      }
+      if(has_edge(node(a), node(b)))
+        continue;
+      keys[added++] = key;
+      ++new_degree[a];
+      ++new_degree[b];
+    }
+    keys.resize(added);
+    if(added == 0)
+      return revived;
+
+    coloring_valid_ = false;
+    topology_changed();
+    stats_.add(&graph_stats::add_edge_new, added);
+    edge_changes_.mark(num_edges(), num_edges() + added);
+    size_type old_capacity = graph_edges.capacity();
+    graph_edges.reserve(graph_edges.size() + added);
+    edge_values_.resize(graph_edges.size() + added);
+    if(weighted_)
+      edge_weights_.resize(graph_edges.size() + added, 1.0f);
+    stats_.capacity_change(old_capacity, graph_edges.capacity());
+    for(size_type i = 0; i < num_nodes(); ++i) {
+      if(new_degree[i] != 0) {
+        incidence_row& row = adjacency_[i];
+        row.reserve(row.size() + new_degree[i]);
+      }
+    }
+
+    //Keys are sorted by (source, dest) with source < dest, so row n first
+    //receives its smaller neighbors (as a dest) in increasing order and then
+    //its larger ones (as a source) in increasing order: the appended tail of
+    //every row is already sorted
+    for(const edge_key& key : keys) {
+      internal_edge new_edge;
+      new_edge.source = key_source(key);
+      new_edge.dest = key_dest(key);
+      size_type new_index = graph_edges.size();
+      graph_edges.push_back(new_edge);
+      adjacency_[new_edge.source].push_back(
+          csr_incidence{new_edge.dest, new_index});
+      adjacency_[new_edge.dest].push_back(
+          csr_incidence{new_edge.source, new_index});
+    }
+    for(size_type i = 0; i < num_nodes(); ++i) {
+      if(new_degree[i] != 0) {
+        incidence_row& row = adjacency_[i];
+        std::inplace_merge(row.begin(), row.end() - new_degree[i], row.end(),
+                           by_neighbor);
+        degrees_[i] += new_degree[i];
+        mark_row_stale(i);
+      }
+    }
+    edge_properties_.resize(num_edges());
+    merge_stale_rows();
+    return added + revived;
+  }
+
+  /**
+   * @brief Append the nodes and edges of @a other, stitching the nodes it
+   *        shares with this graph.
+   *
+   * @param[in] other              A graph without removed nodes
+   * @param[in] boundary_node_map  Empty, or one entry per node of @a other:
+   *                               the index of the node of this graph that
+   *                               it is, or size_type(-1) for a new node
+   * @param[in] threads            Threads to copy with; 0 means all cores
+   * @return The index in this graph of every node of @a other
+   *
+   * @pre &@a other != this, and other.num_removed_nodes() == 0
+   * @pre Every mapped entry of @a boundary_node_map is < num_nodes()
+   * @post new num_nodes() == old num_nodes() + the number of unmapped nodes
+   *       of @a other, which are appended in order with their positions and
+   *       values
+   * @post For every live edge (i, j) of @a other whose ends map to distinct
+   *       nodes, has_edge(node(result[i]), node(result[j])) == true
+   *
+   * For assembling a mesh from pieces built in parallel. The piece is not
+   * replayed through add_node() and add_edge(): node arrays are appended
+   * in bulk, and edges and adjacency rows are copied with their indices
+   * offset by the old node and edge counts, so a piece with no boundary
+   * costs a copy of its arrays. Edges that touch the boundary are
+   * deduplicated on their canonical key, and those with both ends on it,
+   * the only ones that can already be in this graph, are looked up. Edges
+   * this graph already has keep
+   * their value, or are revived with the piece's value if they were
+   * removed; in a multigraph every edge is appended. A boundary node keeps
+   * its own position and value, and an edge whose ends map to the same
+   * node is dropped. New edges keep their values, and their weights if
+   * both graphs have weights, in @a other's edge order. A frozen graph
+   * serves the changed rows as stale rows until they are merged.
+   *
+   * Complexity: O(other.num_nodes() + other.num_edges()), spread over the
+   * threads, plus O(b log b + sum of the touched row lengths) for the b
+   * edges that touch the boundary.
+   **/
+  std::vector<size_type> merge(const Graph& other,
+                               const std::vector<size_type>& boundary_node_map
+                                   = std::vector<size_type>(),
+                               unsigned threads = 0) {
+    CME212_TRACE_SCOPE("merge");
+    assert(&other != this && other.num_removed_nodes_ == 0);
+    assert(boundary_node_map.empty() ||
+           boundary_node_map.size() == other.num_nodes());
+    const size_type none = size_type(-1);
+    threads = csr_snapshot::thread_count(threads);
+    sort_rows(threads);
+    size_type n0 = num_nodes();
+    size_type m0 = num_edges();
+    size_type n1 = other.num_nodes();
+    size_type m1 = other.num_edges();
+    bool boundary = !boundary_node_map.empty();
+
+    //Index of every node of other in this graph, and the new nodes
+    std::vector<size_type> node_map(n1);
+    if(!boundary) {
+      for(size_type i = 0; i < n1; ++i)
+        node_map[i] = n0 + i;
+      node_positions_.insert(node_positions_.end(),
+                             other.node_positions_.begin(),
+                             other.node_positions_.end());
+      node_values_.insert(node_values_.end(), other.node_values_.begin(),
+                          other.node_values_.end());
+    } else {
+      size_type next = n0;
+      for(size_type i = 0; i < n1; ++i) {
+        assert(boundary_node_map[i] == none || boundary_node_map[i] < n0);
+        node_map[i] = boundary_node_map[i] != none ? boundary_node_map[i]
+                                                   : next++;
+      }
+      node_positions_.reserve(next);
+      node_values_.reserve(next);
+      for(size_type i = 0; i < n1; ++i) {
+        if(node_map[i] >= n0) {
+          node_positions_.push_back(other.node_positions_[i]);
+          node_values_.push_back(other.node_values_[i]);
+        }
+      }
+    }
+    if(num_nodes() != n0)
+      finish_node_batch(n0);
+
+    //Index in this graph of every edge of other that becomes a new edge,
+    //none for the others. Two boundary entries may name the same node, so
+    //edges that touch the boundary are deduplicated on their canonical
+    //key; only those between boundary nodes can be here already, so only
+    //they are looked up.
+    std::vector<size_type> edge_map(m1, 0);
+    std::vector<std::pair<edge_key, size_type>> shared;
+    for(size_type k = 0; k < m1; ++k) {
+      if(other.edge_removed(k)) {
+        edge_map[k] = none;
+        continue;
+      }
+      size_type a = node_map[other.graph_edges[k].source];
+      size_type b = node_map[other.graph_edges[k].dest];
+      if(a == b)
+        edge_map[k] = none;
+      else if((a < n0 || b < n0) && !parallel_edges_)
+        shared.push_back({make_key(a, b), k});
+    }
+    std::sort(shared.begin(), shared.end());
+    for(std::size_t s = 0; s < shared.size(); ++s) {
+      size_type k = shared[s].second;
+      if(s != 0 && shared[s - 1].first == shared[s].first) {
+        edge_map[k] = none;
+        continue;
+      }
+      size_type a = key_source(shared[s].first);
+      size_type b = key_dest(shared[s].first);
+      if(b >= n0)
+        continue;
+      const csr_incidence* x = find_incidence(a, b);
+      if(x == nullptr)
+        continue;
+      if(edge_removed(x->edge)) {
+        revive_edge(x->edge);
+        edge_values_[x->edge] = other.edge_values_[k];
+      }
+      edge_map[k] = none;
+    }
+    size_type added = 0;
+    for(size_type k = 0; k < m1; ++k) {
+      if(edge_map[k] != none)
+        edge_map[k] = m0 + added++;
+    }
+
+    if(added != 0) {
+      coloring_valid_ = false;
+      topology_changed();
+      stats_.add(&graph_stats::add_edge_new, added);
+      edge_changes_.mark(m0, m0 + added);
+      size_type old_capacity = graph_edges.capacity();
+      graph_edges.resize(m0 + added);
+      edge_values_.resize(m0 + added);
+      if(weighted_)
+        edge_weights_.resize(m0 + added, 1.0f);
+      stats_.capacity_change(old_capacity, graph_edges.capacity());
+      bool weights = weighted_ && other.weighted_;
+      csr_snapshot::parallel_ranges(threads, m1, 1 << 14,
+          [&](unsigned, std::size_t b, std::size_t e) {
+            for(std::size_t k = b; k < e; ++k) {
+              size_type to = edge_map[k];
+              if(to == none)
+                continue;
+              graph_edges[to].source = node_map[other.graph_edges[k].source];
+              graph_edges[to].dest = node_map[other.graph_edges[k].dest];
+              edge_values_[to] = other.edge_values_[k];
+              if(weights)
+                edge_weights_[to] = other.edge_weights_[k];
+            }
+          });
+      edge_properties_.resize(num_edges());
+    }
+
+    //Rows of new nodes are copied whole, renumbered. A neighbor on the
+    //boundary sorts before every new node, so only rows that reach the
+    //boundary, or rows other left unsorted, need sorting again. Rows
+    //allocate, so as in clone() they are only built concurrently on a
+    //resource that may be called from several threads at once.
+    bool resort = boundary || !other.rows_sorted_;
+    unsigned row_threads =
+        get_memory_resource() == std::pmr::new_delete_resource() ? threads : 1;
+    csr_snapshot::parallel_ranges(row_threads, n1, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for(std::size_t i = b; i < e; ++i) {
+            size_type to = node_map[i];
+            if(to < n0)
+              continue;
+            const csr_incidence* from = other.row_data(size_type(i));
+            size_type len = other.row_size(size_type(i));
+            incidence_row& row = adjacency_[to];
+            row.reserve(len);
+            for(size_type j = 0; j < len; ++j) {
+              size_type k = edge_map[from[j].edge];
+              if(k != none)
+                row.push_back(csr_incidence{node_map[from[j].node], k});
+            }
+            if(resort && !std::is_sorted(row.begin(), row.end(),
+                                         by_neighbor_and_edge))
+              std::sort(row.begin(), row.end(), by_neighbor_and_edge);
+            degrees_[to] = size_type(row.size());
+          }
+        });
+
+    //Boundary rows take their new entries at the end, sorted and merged in
+    //one pass per row
+    if(boundary && added != 0) {
+      for(size_type i = 0; i < n1; ++i) {
+        size_type to = node_map[i];
+        if(to >= n0)
+          continue;
+        const csr_incidence* from = other.row_data(i);
+        size_type len = other.row_size(i);
+        incidence_row& row = adjacency_[to];
+        std::size_t old_size = row.size();
+        for(size_type j = 0; j < len; ++j) {
+          size_type k = edge_map[from[j].edge];
+          if(k != none)
+            row.push_back(csr_incidence{node_map[from[j].node], k});
+        }
+        if(row.size() == old_size)
+          continue;
+        std::sort(row.begin() + old_size, row.end(), by_neighbor_and_edge);
+        std::inplace_merge(row.begin(), row.begin() + old_size, row.end(),
+                           by_neighbor_and_edge);
+        degrees_[to] += size_type(row.size() - old_size);
+        mark_row_stale(to);
+      }
+    }
+    if(frozen_) {
+      for(size_type i = n0; i < num_nodes(); ++i) {
+        if(!adjacency_[i].empty())
+          mark_row_stale(i);
+      }
+      merge_stale_rows();
+    }
+    return node_map;
+  }
+
+  /**
+   * @brief Copy the subgraph induced by a selection of nodes into a new,
+   *        compact graph.
+   *
+   * @param[in]  selected  One flag per node: true to keep it
+   * @param[out] maps      If not null, filled with the node index map and
+   *                       the origin of every kept node and edge
+   * @param[in]  threads   Threads to copy with; 0 means all cores
+   * @return A graph with the kept nodes, in index order, and every live
+   *         edge with both ends kept, in edge order
+   *
+   * @pre selected.size() == num_nodes()
+   * @post result.num_nodes() is the number of selected live nodes, and
+   *       result.node(k) has the position and value of
+   *       node(maps->node_origin[k])
+   *
+   * For jobs that need a standalone dense graph rather than a
+   * FilteredGraph view, so that their loops run over contiguous arrays of
+   * the kept part only. Removed nodes and edges are left out. Nodes and
+   * edges are renumbered by parallel prefix sums over the flags, each
+   * thread counting its share and then numbering it from its offset.
+   * Positions, values, edges and weights are copied in parallel, and the
+   * rows are built in two passes per node, one counting the kept entries
+   * into the degrees and one filling rows of exactly that size. The
+   * renumbering keeps the order of the indices, so rows come out sorted.
+   * As in clone(), rows are only built concurrently on a resource that may
+   * be called from several threads at once, and property arrays are not
+   * copied. The subgraph uses this graph's memory resource and settings,
+   * and is frozen if this graph is.
+   *
+   * Complexity: O(num_nodes() + num_edges()), spread over the threads.
+   **/
+  Graph extract(const std::vector<bool>& selected,
+                subgraph_maps* maps = nullptr, unsigned threads = 0) const {
+    CME212_TRACE_SCOPE("extract");
+    assert(selected.size() == num_nodes());
+    const size_type none = size_type(-1);
+    threads = csr_snapshot::thread_count(threads);
+    sort_rows(threads);
+    Graph g(get_memory_resource());
+    g.owned_resource_ = owned_resource_;
+    g.expected_degree_ = expected_degree_;
+    g.compaction_threshold_ = compaction_threshold_;
+    g.parallel_edges_ = parallel_edges_;
+    g.csr_merge_threshold_ = csr_merge_threshold_;
+    g.weighted_ = weighted_;
+
+    std::vector<size_type> node_map(num_nodes());
+    size_type n = renumber(threads, num_nodes(), node_map,
+        [&](size_type i) { return selected[i] && !node_removed(i); });
+    std::vector<size_type> edge_map(num_edges());
+    size_type m = renumber(threads, num_edges(), edge_map,
+        [&](size_type k) {
+          return !edge_removed(k) && node_map[graph_edges[k].source] != none &&
+                 node_map[graph_edges[k].dest] != none;
+        });
+
+    std::vector<size_type> node_origin(n);
+    std::vector<size_type> edge_origin(m);
+    g.node_positions_.resize(n);
+    g.node_values_.resize(n);
+    csr_snapshot::parallel_ranges(threads, num_nodes(), 1 << 14,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for(std::size_t i = b; i < e; ++i) {
+            size_type to = node_map[i];
+            if(to == none)
+              continue;
+            node_origin[to] = size_type(i);
+            g.node_positions_[to] = node_positions_[i];
+            g.node_values_[to] = node_values_[i];
+          }
+        });
+    g.finish_node_batch(0);
+
+    g.graph_edges.resize(m);
+    g.edge_values_.resize(m);
+    if(weighted_)
+      g.edge_weights_.resize(m);
+    csr_snapshot::parallel_ranges(threads, num_edges(), 1 << 14,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for(std::size_t k = b; k < e; ++k) {
+            size_type to = edge_map[k];
+            if(to == none)
+              continue;
+            edge_origin[to] = size_type(k);
+            g.graph_edges[to].source = node_map[graph_edges[k].source];
+            g.graph_edges[to].dest = node_map[graph_edges[k].dest];
+            g.edge_values_[to] = edge_values_[k];
+            if(weighted_)
+              g.edge_weights_[to] = edge_weights_[k];
+          }
+        });
+    g.stats_.add(&graph_stats::add_edge_new, m);
+    g.edge_changes_.mark(0, m);
+    g.edge_properties_.resize(m);
+
+    //Count the kept entries of every row, then fill rows of that size
+    csr_snapshot::parallel_ranges(threads, n, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for(std::size_t i = b; i < e; ++i) {
+            const csr_incidence* row = row_data(node_origin[i]);
+            size_type len = row_size(node_origin[i]);
+            size_type d = 0;
+            for(size_type j = 0; j < len; ++j)
+              d += edge_map[row[j].edge] != none;
+            g.degrees_[i] = d;
+          }
+        });
+    unsigned row_threads =
+        get_memory_resource() == std::pmr::new_delete_resource() ? threads : 1;
+    csr_snapshot::parallel_ranges(row_threads, n, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for(std::size_t i = b; i < e; ++i) {
+            const csr_incidence* row = row_data(node_origin[i]);
+            size_type len = row_size(node_origin[i]);
+            incidence_row& out = g.adjacency_[i];
+            out.reserve(g.degrees_[i]);
+            for(size_type j = 0; j < len; ++j) {
+              size_type k = edge_map[row[j].edge];
+              if(k != none)
+                out.push_back(csr_incidence{node_map[row[j].node], k});
+            }
+          }
+        });
+    if(frozen_)
+      g.freeze();
+
+    if(maps != nullptr) {
+      maps->node_map = std::move(node_map);
+      maps->node_origin = std::move(node_origin);
+      maps->edge_origin = std::move(edge_origin);
+    }
+    return g;
+  }
+
+  /** Callback type of the remove functions that ignores every move. */
+  struct ignore_moves {
+    void operator()(size_type, size_type) const {
+    }
   };
 
   /**
-  * @brief Returns a node_iterator pointing to the first Node in the iterator.
+  * @brief Remove edge @a e from the graph.
   *
-  * @param none
-  * @return A node_iterator object pointing to the first element
+  * @param[in] e           A valid edge of this graph
+  * @param[in] edge_moved  Called as edge_moved(old_index, new_index) when
+  *                        an edge is renumbered
+  * @return 1, the number of edges removed
   *
-  * @pre this object exists
-  * @post A node_iterator object is returned pointing to the first node
+  * @pre @a e is a valid edge of this graph
+  * @post new num_edges() == old num_edges() - 1 and
+  *       has_edge(e.node1(), e.node2()) == false
+  * @post If e was not the last edge, the old last edge now has e's index:
+  *       edge_moved(old num_edges() - 1, e.index()) has been called
+  *
+  * The hole is filled by moving the last edge into it (swap-and-pop), so
+  * only that one edge is renumbered. Arrays from make_edge_property()
+  * follow automatically; @a edge_moved is for arrays kept elsewhere.
+  * Invalidates outstanding Edge objects of e and of the last edge, and
+  * IncidentIterators of both endpoints. A frozen graph is thawed.
+  *
+  * Complexity: O(e.node1().degree() + e.node2().degree()).
   **/
-  node_iterator node_begin() const {
-    return NodeIterator(this, 0);
+  template <typename EdgeMoved = ignore_moves>
+  size_type remove_edge(const Edge& e, EdgeMoved edge_moved = EdgeMoved()) {
+    assert(e.uid_ < num_edges());
+    erase_edge(e.uid_, edge_moved);
+    return 1;
   }
 
   /**
-  * @brief Returns a node_iterator pointing to the last Node in the iterator.
+  * @brief Remove the edge between @a a and @a b, if there is one.
   *
-  * @param none
-  * @return A node_iterator object pointing to the last element
+  * @param[in] a, b        Valid nodes of this graph
+  * @param[in] edge_moved  As for remove_edge(const Edge&)
+  * @return The number of edges removed, 0 or 1
   *
-  * @pre this object exists
-  * @post A node_iterator object is returned pointing to the last node
+  * @post has_edge(@a a, @a b) == false
+  *
+  * Complexity: O(a.degree() + b.degree()).
   **/
-  node_iterator node_end() const {
-    return NodeIterator(this, this->size());
+  template <typename EdgeMoved = ignore_moves>
+  size_type remove_edge(const Node& a, const Node& b,
+                        EdgeMoved edge_moved = EdgeMoved()) {
+    const csr_incidence* x = find_incidence(a.index(), b.index());
+    if(x == nullptr || edge_removed(x->edge))
+      return 0;
+    erase_edge(x->edge, edge_moved);
+    return 1;
   }
 
-  //
-  // Incident Iterator
-  //
+  /**
+  * @brief Remove the edge @a it points to.
+  *
+  * @param[in] it  A dereferenceable edge iterator of this graph
+  * @return An iterator to the same position, which now holds the edge moved
+  *         into the hole, or edge_end() if @a it was the last edge. Removing
+  *         edges in a loop is therefore: it = remove_edge(it), advancing
+  *         only past edges that are kept.
+  *
+  * Complexity: as remove_edge(const Edge&).
+  **/
+  edge_iterator remove_edge(edge_iterator it) {
+    ignore_moves none;
+    erase_edge(it.iterInd_, none);
+    return EdgeIterator(this, next_live_edge(it.iterInd_));
+  }
 
-  /** @class Graph::IncidentIterator
-   * @brief Iterator class for edges incident to a node. A forward iterator. */
-  class IncidentIterator : private totally_ordered<IncidentIterator>{
-   public:
-    // These type definitions let us use STL's iterator_traits.
-    using value_type        = Edge;                     // Element type
-    using pointer           = Edge*;                    // Pointers to elements
-    using reference         = Edge&;                    // Reference to elements
-    using difference_type   = std::ptrdiff_t;           // Signed difference
-    using iterator_category = std::input_iterator_tag;  // Weak Category, Proxy
+  /**
+  * @brief Remove node @a n and every edge incident to it.
+  *
+  * @param[in] n           A valid node of this graph
+  * @param[in] node_moved  Called as node_moved(old_index, new_index) when
+  *                        a node is renumbered
+  * @param[in] edge_moved  Called as edge_moved(old_index, new_index) when
+  *                        an edge is renumbered
+  * @return 1, the number of nodes removed
+  *
+  * @pre @a n is a valid node of this graph
+  * @post new num_nodes() == old num_nodes() - 1 and new num_edges() ==
+  *       old num_edges() - n.degree()
+  * @post If n was not the last node, the old last node now has n's index,
+  *       with its position, value and edges: node_moved(old num_nodes() - 1,
+  *       n.index()) has been called
+  *
+  * The incident edges go first, each by remove_edge(). Then the last node
+  * is moved into the hole, which renumbers it in the rows of its neighbors
+  * and in its edges; every other node keeps its index. Arrays from
+  * make_node_property() and make_edge_property() follow automatically.
+  * Invalidates outstanding Node objects of n and of the last node, Edge
+  * objects of the removed and renumbered edges, and iterators. A frozen
+  * graph is thawed.
+  *
+  * Complexity: O(sum of the degrees of the neighbors of n and of the last
+  * node), i.e. O(d^2) for degrees bounded by d.
+  **/
+  template <typename NodeMoved = ignore_moves,
+            typename EdgeMoved = ignore_moves>
+  size_type remove_node(const Node& n, NodeMoved node_moved = NodeMoved(),
+                        EdgeMoved edge_moved = EdgeMoved()) {
+    assert(has_node(n));
+    thaw();
+    size_type i = n.index();
 
-    /**
-    * @brief Construct an invalid IncidentIterator.
-    *
-    * @param none
-    * @return IncidentIterator object
-    *
-    * @pre none
-    * @post IncidentIterator object is created
-    **/
-    IncidentIterator() {
+    //The last incidence of a row is the cheapest to erase from it
+    while(!adjacency_[i].empty())
+      erase_edge(adjacency_[i].back().edge, edge_moved);
+
+    size_type last = num_nodes() - 1;
+    if(i != last) {
+      //The last node has the largest index, so it is the last entry of
+      //every neighbor's row; it moves down to its new place in each
+      for(const csr_incidence& x : adjacency_[last]) {
+        incidence_row& row = adjacency_[x.node];
+        assert(row.back().node == last);
+        row.pop_back();
+        insert_sorted(row, csr_incidence{i, x.edge});
+        edge_changes_.mark(x.edge);
+        internal_edge& e = graph_edges[x.edge];
+        if(e.source == last)
+          e.source = i;
+        else
+          e.dest = i;
+      }
+      node_positions_[i] = node_positions_[last];
+      position_changes_.mark(i);
+      node_values_[i] = std::move(node_values_[last]);
+      adjacency_[i] = std::move(adjacency_[last]);
+      degrees_[i] = degrees_[last];
+      if(i < removed_nodes_.size())
+        removed_nodes_[i] = node_removed(last);
+    }
+    node_positions_.pop_back();
+    bounds_valid_ = false;
+    node_values_.pop_back();
+    adjacency_.pop_back();
+    degrees_.pop_back();
+    if(removed_nodes_.size() > num_nodes())
+      removed_nodes_.pop_back();
+    node_properties_.swap_remove(i);
+    node_generations_.swap_remove(i, last + 1);
+    topology_changed();
+    if(i != last)
+      node_moved(last, i);
+    return 1;
+  }
+
+  /**
+  * @brief Remove the node @a it points to and its edges.
+  *
+  * @param[in] it  A dereferenceable node iterator of this graph
+  * @return An iterator to the same position, which now holds the node moved
+  *         into the hole, or node_end() if @a it was the last node
+  *
+  * Complexity: as remove_node(const Node&).
+  **/
+  node_iterator remove_node(node_iterator it) {
+    remove_node(*it);
+    return NodeIterator(this, next_live_node(it.iterInd_));
+  }
+
+  /**
+  * @brief Remove edge @a e by leaving a tombstone in its slot.
+  *
+  * @param[in] e           A valid, not yet removed edge of this graph
+  * @param[in] node_moved  As for compact(), if this triggers one
+  * @param[in] edge_moved  As for compact(), if this triggers one
+  *
+  * @post has_edge(e.node1(), e.node2()) == false, and both endpoint
+  *       degrees dropped by one
+  * @post num_edges() does not change: the slot stays until compact().
+  *       is_removed(e) == true, and edge iteration, incident iteration and
+  *       has_edge() skip it.
+  *
+  * Nothing is moved or renumbered, so outstanding Node, Edge and iterator
+  * objects stay valid, unless the tombstones now exceed
+  * compaction_threshold(): then compact() runs before returning. Adding
+  * the edge again restores it in its slot.
+  *
+  * Complexity: O(1), plus O(num_nodes() + num_edges()) for a compaction.
+  **/
+  template <typename NodeMoved = ignore_moves,
+            typename EdgeMoved = ignore_moves>
+  void lazy_remove_edge(const Edge& e, NodeMoved node_moved = NodeMoved(),
+                        EdgeMoved edge_moved = EdgeMoved()) {
+    assert(e.uid_ < num_edges() && !edge_removed(e.uid_));
+    tombstone_edge(e.uid_);
+    if(needs_compaction())
+      compact(node_moved, edge_moved);
+  }
+
+  /**
+  * @brief Remove node @a n and its edges by leaving tombstones.
+  *
+  * @param[in] n           A valid node of this graph
+  * @param[in] node_moved  As for compact(), if this triggers one
+  * @param[in] edge_moved  As for compact(), if this triggers one
+  *
+  * @post has_node(@a n) == false, and every edge incident to @a n is
+  *       removed as by lazy_remove_edge()
+  * @post num_nodes() does not change: the slot stays until compact().
+  *       Node iteration skips it.
+  *
+  * Unlike remove_node(), no row is rewired: the node and its edges are only
+  * marked. No edge may be added to a removed node. Compacts as
+  * lazy_remove_edge() does.
+  *
+  * Complexity: O(n.degree()), plus O(num_nodes() + num_edges()) for a
+  * compaction.
+  **/
+  template <typename NodeMoved = ignore_moves,
+            typename EdgeMoved = ignore_moves>
+  void lazy_remove_node(const Node& n, NodeMoved node_moved = NodeMoved(),
+                        EdgeMoved edge_moved = EdgeMoved()) {
+    assert(has_node(n));
+    size_type i = n.index();
+    const csr_incidence* row = row_data(i);
+    for(size_type k = 0, len = row_size(i); k < len; ++k) {
+      if(!edge_removed(row[k].edge))
+        tombstone_edge(row[k].edge);
     }
+    if(removed_nodes_.size() < num_nodes())
+      removed_nodes_.resize(num_nodes(), false);
+    removed_nodes_[i] = true;
+    ++num_removed_nodes_;
+    node_generations_.retire(i);
+    position_changes_.mark(i);
+    topology_changed();
+    if(needs_compaction())
+      compact(node_moved, edge_moved);
+  }
 
-    /**
-    * @brief Operator to deference the iterator and find what node the
-    *        iterator is pointing to. Note this only returns incident edges
-    *
-    * @param none
-    * @return Edge object corresponding to the object the iterator is
-    *         pointing to.
-    *
-    * @pre this object is initialized
-    * @post The result is the Edge that the iterator is pointing to.
-    **/
-    Edge operator*() const {
-      //For this object, our iterator is a map. Therefore, mapIter is an
-      //iterator over all the nodes/keys in the outer map. With each resulting
-      //map, we look to see how many of these inner maps have the node with
-      //index n_ as the key (meaning the node with index n_ is a destination
-      //node). We find the corresponding map and return the edge found.
-      if(graph_->graph_edges[mapIter_->second].source == n_) {
-        return Edge(graph_, mapIter_->second, true);
+  /** Return true if node @a n was removed by lazy_remove_node() and not yet
+   *  compacted away. Complexity: O(1). */
+  bool is_removed(const Node& n) const {
+    return node_removed(n.index());
+  }
+  /** Return true if edge @a e was removed by lazy_remove_edge() or
+   *  lazy_remove_node() and not yet compacted away. Complexity: O(1). */
+  bool is_removed(const Edge& e) const {
+    return edge_removed(e.uid_);
+  }
+
+  /** Return the number of node and edge tombstones, which num_nodes() and
+   *  num_edges() still count. Complexity: O(1). */
+  size_type num_removed_nodes() const {
+    return num_removed_nodes_;
+  }
+  size_type num_removed_edges() const {
+    return num_removed_edges_;
+  }
+
+  /**
+  * @brief Return a handle of node @a n that can be tested for validity.
+  *
+  * @param[in] n  A valid node of this graph
+  * @return Handle h with is_valid(h) and node(h) == @a n
+  *
+  * @pre n.index() < 2^32 - 1
+  * @post is_valid(h) stays true until @a n is removed, lazily or not, or
+  *       moved to another index by remove_node(), compact(),
+  *       permute_nodes(), reorder() or clear(); it is false from then on,
+  *       even once another node takes the slot.
+  *
+  * Unlike a Node, which keeps naming its index whatever comes to occupy it,
+  * a handle packs the index with the generation of its slot, so user code
+  * can keep long-lived references to nodes without a map from ids to
+  * indices. See common/stable_handle.hpp.
+  *
+  * Complexity: O(1).
+  **/
+  stable_node_handle stable_handle(const Node& n) const {
+    assert(has_node(n));
+    return stable_node_handle(n.index(),
+                              node_generations_.generation(n.index()));
+  }
+  /** Return a handle of edge @a e, valid until @a e is removed or
+   *  renumbered, as for nodes. Edge(h) has the stored orientation.
+   *  Complexity: O(1). */
+  stable_edge_handle stable_handle(const Edge& e) const {
+    assert(e.uid_ < num_edges());
+    return stable_edge_handle(e.uid_, edge_generations_.generation(e.uid_));
+  }
+
+  /** Return true if the node of @a h is still in this graph at the index
+   *  it had when @a h was made. Complexity: O(1). */
+  bool is_valid(const stable_node_handle& h) const {
+    return h.index() < num_nodes() && node_generations_.current(h) &&
+           !node_removed(size_type(h.index()));
+  }
+  /** Return true if the edge of @a h is still in this graph at the index
+   *  it had when @a h was made. Complexity: O(1). */
+  bool is_valid(const stable_edge_handle& h) const {
+    return h.index() < num_edges() && edge_generations_.current(h) &&
+           !edge_removed(size_type(h.index()));
+  }
+
+  /** Return the node of @a h, or an invalid Node if !is_valid(@a h).
+   *  Complexity: O(1). */
+  Node node(const stable_node_handle& h) const {
+    if(is_valid(h))
+      return Node(this, size_type(h.index()));
+    return Node();
+  }
+  /** Return the edge of @a h, or an invalid Edge if !is_valid(@a h).
+   *  Complexity: O(1). */
+  Edge edge(const stable_edge_handle& h) const {
+    if(is_valid(h))
+      return Edge(this, size_type(h.index()));
+    return Edge();
+  }
+
+  /**
+  * @brief Set when the lazy removals compact the graph on their own.
+  *
+  * @param[in] ratio  Tombstone fraction in [0, 1]
+  *
+  * A lazy removal compacts once the removed nodes exceed @a ratio *
+  * num_nodes() or the removed edges exceed @a ratio * num_edges(). The
+  * default is 0.25. A ratio of 1 disables automatic compaction, leaving it
+  * to explicit compact() calls, e.g. once per refinement step.
+  **/
+  void set_compaction_threshold(double ratio) {
+    assert(ratio >= 0 && ratio <= 1);
+    compaction_threshold_ = ratio;
+  }
+  double compaction_threshold() const {
+    return compaction_threshold_;
+  }
+
+  /**
+  * @brief Drop every tombstone, packing the live nodes and edges densely.
+  *
+  * @param[in] node_moved  Called as node_moved(old_index, new_index) for
+  *                        every live node whose index changes
+  * @param[in] edge_moved  Called as edge_moved(old_index, new_index) for
+  *                        every live edge whose index changes
+  *
+  * @post num_removed_nodes() == 0 and num_removed_edges() == 0
+  * @post Live nodes and edges keep their relative order, values and
+  *       orientation; new num_nodes() and num_edges() count only them
+  *
+  * One linear pass renumbers everything: the node and edge arrays, the
+  * adjacency rows, which stay sorted because the renumbering preserves
+  * order, the edge cache and the arrays from make_node_property() and
+  * make_edge_property(). The callbacks run in increasing index order with
+  * new_index <= old_index, so an external array compacts in place with
+  * a[new_index] = a[old_index] followed by a resize. A frozen graph stays
+  * frozen. Invalidates outstanding Node, Edge and iterator objects, and
+  * edge_coloring(). Does nothing if there are no tombstones.
+  *
+  * Complexity: O(num_nodes() + num_edges()).
+  **/
+  template <typename NodeMoved = ignore_moves,
+            typename EdgeMoved = ignore_moves>
+  void compact(NodeMoved node_moved = NodeMoved(),
+               EdgeMoved edge_moved = EdgeMoved()) {
+    if(num_removed_nodes_ == 0 && num_removed_edges_ == 0)
+      return;
+    CME212_TRACE_SCOPE("compact");
+    bool was_frozen = frozen_;
+    thaw();
+
+    //New index of every live node and edge, and the old index of every new
+    //one. Both renumberings are monotone.
+    const size_type none = size_type(-1);
+    std::vector<size_type> new_node(num_nodes(), none);
+    std::vector<size_type> old_node;
+    old_node.reserve(num_nodes() - num_removed_nodes_);
+    for(size_type i = 0; i < num_nodes(); ++i) {
+      if(!node_removed(i)) {
+        new_node[i] = size_type(old_node.size());
+        old_node.push_back(i);
       }
-      //For the reverse direction
-      else {
-        return Edge(graph_, mapIter_->second, false);
+    }
+    std::vector<size_type> new_edge(num_edges(), none);
+    std::vector<size_type> old_edge;
+    old_edge.reserve(num_edges() - num_removed_edges_);
+    for(size_type k = 0; k < num_edges(); ++k) {
+      if(!edge_removed(k)) {
+        new_edge[k] = size_type(old_edge.size());
+        old_edge.push_back(k);
+      }
+    }
+
+    //Every live slot moves down (or stays), so the arrays are packed in
+    //place, front to back
+    for(size_type j = 0; j < old_node.size(); ++j) {
+      size_type i = old_node[j];
+      incidence_row& row = adjacency_[i];
+      size_type len = 0;
+      for(const csr_incidence& x : row) {
+        if(new_edge[x.edge] != none)
+          row[len++] = csr_incidence{new_node[x.node], new_edge[x.edge]};
+      }
+      row.resize(len);
+      assert(len == degrees_[i]);
+      if(i != j) {
+        node_positions_[j] = node_positions_[i];
+        position_changes_.mark(j);
+        node_values_[j] = std::move(node_values_[i]);
+        adjacency_[j] = std::move(row);
+        degrees_[j] = degrees_[i];
+      }
+    }
+    size_type n = size_type(old_node.size());
+    node_positions_.erase(node_positions_.begin() + n, node_positions_.end());
+    bounds_valid_ = false;
+    node_values_.erase(node_values_.begin() + n, node_values_.end());
+    adjacency_.erase(adjacency_.begin() + n, adjacency_.end());
+    degrees_.resize(n);
+
+    //Cache entries past the end of a short cache have no slot to move to
+    size_type cached = 0;
+    for(size_type j = 0; j < old_edge.size(); ++j) {
+      size_type k = old_edge[j];
+      internal_edge& e = graph_edges[k];
+      graph_edges[j] = internal_edge{new_node[e.source], new_node[e.dest]};
+      if(k != j) {
+        edge_values_[j] = std::move(edge_values_[k]);
+        if(weighted_)
+          edge_weights_[j] = edge_weights_[k];
+      }
+      if(k < edge_cache_.size())
+        edge_cache_[cached++] = edge_cache_[k];
+    }
+    size_type m = size_type(old_edge.size());
+    graph_edges.resize(m);
+    edge_values_.erase(edge_values_.begin() + m, edge_values_.end());
+    if(weighted_)
+      edge_weights_.resize(m);
+    edge_cache_.resize(std::min(cached, m));
+
+    node_properties_.gather(old_node.data(), n);
+    edge_properties_.gather(old_edge.data(), m);
+    node_generations_.gather(old_node.data(), n, new_node.size());
+    edge_generations_.gather(old_edge.data(), m, new_edge.size());
+    edge_changes_.mark(0, m);
+    removed_nodes_.clear();
+    removed_edges_.clear();
+    num_removed_nodes_ = 0;
+    num_removed_edges_ = 0;
+    coloring_valid_ = false;
+    topology_changed();
+    if(was_frozen)
+      freeze();
+
+    for(size_type j = 0; j < n; ++j) {
+      if(old_node[j] != j)
+        node_moved(old_node[j], j);
+    }
+    for(size_type j = 0; j < m; ++j) {
+      if(old_edge[j] != j)
+        edge_moved(old_edge[j], j);
+    }
+  }
+
+  /**
+   * @brief Remove every parallel edge but the one with the smallest index.
+   *
+   * @param[in] node_moved  As for compact()
+   * @param[in] edge_moved  As for compact()
+   * @param[in] threads     Threads to scan the rows with; 0 means all cores
+   * @return The number of edges removed
+   *
+   * @post No two live edges join the same two nodes
+   * @post The kept edges keep their values and relative order
+   *
+   * The rows are sorted by neighbor, so parallel edges sit next to each
+   * other; each thread scans a share of the rows for runs of one neighbor,
+   * looking at every pair from its lower endpoint only. The duplicates are
+   * then tombstoned and compact() renumbers everything in one pass, which
+   * also drops the tombstones left by earlier lazy removals. Does nothing,
+   * and renumbers nothing, if there are no parallel edges.
+   *
+   * Complexity: O(num_nodes() + num_edges()), the scan spread over the
+   * threads.
+   **/
+  template <typename NodeMoved = ignore_moves,
+            typename EdgeMoved = ignore_moves>
+  size_type dedup_edges(NodeMoved node_moved = NodeMoved(),
+                        EdgeMoved edge_moved = EdgeMoved(),
+                        unsigned threads = 0) {
+    CME212_TRACE_SCOPE("dedup_edges");
+    threads = csr_snapshot::thread_count(threads);
+    sort_rows(threads);
+    std::vector<std::vector<size_type>> found(threads);
+    csr_snapshot::parallel_ranges(threads, num_nodes(), 1024,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for(size_type i = size_type(b); i < size_type(e); ++i) {
+            const csr_incidence* row = row_data(i);
+            size_type len = row_size(i);
+            size_type k = size_type(std::upper_bound(row, row + len, i,
+                [](size_type v, const csr_incidence& x) {
+                  return v < x.node;
+                }) - row);
+            //For each run of one neighbor, keep the live edge with the
+            //smallest index and report the others
+            while(k < len) {
+              size_type j = row[k].node;
+              size_type keep = size_type(-1);
+              size_type run = k;
+              for(; k < len && row[k].node == j; ++k) {
+                if(!edge_removed(row[k].edge))
+                  keep = std::min(keep, row[k].edge);
+              }
+              for(; run < k; ++run) {
+                size_type x = row[run].edge;
+                if(x != keep && !edge_removed(x))
+                  found[t].push_back(x);
+              }
+            }
+          }
+        });
+
+    size_type removed = 0;
+    for(const std::vector<size_type>& list : found) {
+      for(size_type x : list)
+        tombstone_edge(x);
+      removed += size_type(list.size());
+    }
+    if(removed != 0)
+      compact(node_moved, edge_moved);
+    return removed;
+  }
+
+  /**
+   * @brief Merge the nodes that lie within @a tolerance of each other.
+   *
+   * @param[in] tolerance   Largest distance at which two nodes are merged;
+   *                        0 merges only equal positions
+   * @param[in] node_moved  As for compact()
+   * @param[in] edge_moved  As for compact()
+   * @param[in] threads     Threads to search and rewire with; 0 means all
+   *                        cores
+   * @return The number of nodes merged away
+   *
+   * @pre @a tolerance >= 0
+   * @post No two live nodes lie within @a tolerance of each other, unless
+   *       they were already before the call as parts of different groups
+   *
+   * Nodes within @a tolerance of each other form a group, transitively,
+   * and each group becomes its node of smallest index, which keeps its
+   * position and value. Every edge of a merged node is moved to the
+   * group's node and keeps its value and orientation; edges inside a group
+   * are dropped, and an edge that would repeat one already there is
+   * dropped unless parallel edges are allowed. The pairs within
+   * @a tolerance are found through the hash grid of find_or_add_node(),
+   * each thread searching from a share of the nodes and joining the groups
+   * in a lock-free union-find, and the edges are classified in parallel
+   * too. The merged nodes and old edges are then tombstoned and compact()
+   * renumbers everything in one pass; node_moved is called for the nodes
+   * kept, not for those merged away. Does nothing, and renumbers nothing,
+   * if no two nodes are that close.
+   *
+   * Complexity: O(num_nodes() + num_edges()) expected on inputs with few
+   * nodes per cell, spread over the threads, plus O(degree) per moved
+   * edge.
+   **/
+  template <typename NodeMoved = ignore_moves,
+            typename EdgeMoved = ignore_moves>
+  size_type weld_nodes(double tolerance = 0,
+                       NodeMoved node_moved = NodeMoved(),
+                       EdgeMoved edge_moved = EdgeMoved(),
+                       unsigned threads = 0) {
+    CME212_TRACE_SCOPE("weld_nodes");
+    assert(tolerance >= 0);
+    threads = csr_snapshot::thread_count(threads);
+    size_type n = num_nodes();
+    build_weld_grid(tolerance);
+
+    //Group representative of every node: link each node to the earlier
+    //nodes within tolerance, then take roots, which are group minima
+    connected_components_detail::forest<size_type> groups(n, threads);
+    std::vector<size_type> close(threads, 0);
+    csr_snapshot::parallel_ranges(threads, n, 1024,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for(size_type i = size_type(b); i < size_type(e); ++i) {
+            if(node_removed(i))
+              continue;
+            const point_type& p = node_positions_[i];
+            for_each_weld_candidate(p, [&](size_type j) {
+              if(j < i && !node_removed(j) &&
+                 weld_distance(node_positions_[j], p) <= tolerance) {
+                groups.link(i, j);
+                ++close[t];
+              }
+            });
+          }
+        });
+    size_type pairs = 0;
+    for(size_type c : close)
+      pairs += c;
+    if(pairs == 0)
+      return 0;
+    std::vector<size_type> rep(n);
+    csr_snapshot::parallel_ranges(threads, n, 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for(std::size_t i = b; i < e; ++i)
+            rep[i] = groups.find(size_type(i));
+        });
+
+    //Edges with a merged endpoint: dropped if inside a group, else moved
+    struct moved_edge {
+      size_type edge;
+      size_type source;
+      size_type dest;
+    };
+    std::vector<std::vector<moved_edge>> moved(threads);
+    csr_snapshot::parallel_ranges(threads, num_edges(), 1 << 14,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for(size_type k = size_type(b); k < size_type(e); ++k) {
+            const internal_edge& x = graph_edges[k];
+            if(edge_removed(k) || (rep[x.source] == x.source &&
+                                   rep[x.dest] == x.dest))
+              continue;
+            moved[t].push_back(moved_edge{k, rep[x.source], rep[x.dest]});
+          }
+        });
+
+    for(const std::vector<moved_edge>& list : moved) {
+      for(const moved_edge& x : list)
+        tombstone_edge(x.edge);
+    }
+    size_type merged = 0;
+    if(removed_nodes_.size() < n)
+      removed_nodes_.resize(n, false);
+    for(size_type i = 0; i < n; ++i) {
+      if(rep[i] != i) {
+        removed_nodes_[i] = true;
+        position_changes_.mark(i);
+        ++merged;
+      }
+    }
+    num_removed_nodes_ += merged;
+    topology_changed();
+    for(const std::vector<moved_edge>& list : moved) {
+      for(const moved_edge& x : list) {
+        if(x.source == x.dest)
+          continue;
+        if(!parallel_edges_) {
+          const csr_incidence* found = find_incidence(x.source, x.dest);
+          if(found != nullptr && !edge_removed(found->edge))
+            continue;
+        }
+        Edge e = add_edge(node(x.source), node(x.dest), edge_values_[x.edge]);
+        if(weighted_)
+          edge_weights_[e.index()] = edge_weights_[x.edge];
+      }
+    }
+    compact(node_moved, edge_moved);
+    return merged;
+  }
+
+  /**
+   * @brief Remove all nodes and edges from this graph.
+   *
+   * @param none
+   *
+   * @pre Graph object exists
+   * @post num_nodes() == 0 && num_edges() == 0
+   *
+   * Invalidates all outstanding Node and Edge objects. As well as the
+   * adjacency rows.
+   * Clearing here simply means flushing the vectors of any stored objects.
+   * We leave the destruction of these objects to the destructor.
+   */
+  void clear() {
+    node_generations_.retire(0, num_nodes());
+    edge_generations_.retire(0, num_edges());
+    node_positions_.clear();
+    node_values_.clear();
+    front_positions_.clear();
+    front_values_.clear();
+    history_depth_ = 0;
+    graph_edges.clear();
+    edge_values_.clear();
+    edge_weights_.clear();
+    edge_cache_.clear();
+    adjacency_.clear();
+    rows_sorted_ = true;
+    degrees_.clear();
+    removed_nodes_.clear();
+    removed_edges_.clear();
+    num_removed_nodes_ = 0;
+    num_removed_edges_ = 0;
+    node_properties_.resize(0);
+    edge_properties_.resize(0);
+    position_changes_.clear();
+    edge_changes_.clear();
+    reset_bounds(bounds_lo_, bounds_hi_, bounds_sum_);
+    bounds_valid_ = true;
+    coloring_valid_ = false;
+    topology_changed();
+    thaw();
+  }
+
+  /**
+   * @brief Renumber the nodes in the order @a order computes.
+   *
+   * @param[in] order  The ordering to apply
+   * @return perm with perm[i] == the new index of the node that had index i.
+   *         Arrays the caller keeps per node follow the graph with
+   *         new_array[perm[i]] = old_array[i].
+   *
+   * @post Every node keeps its position, value and incident edges; only its
+   *       index changes, as in permute_nodes(result).
+   * @post Edges are renumbered in increasing order of (smaller endpoint,
+   *       larger endpoint) under the new node indices. Each edge keeps its
+   *       value and orientation.
+   *
+   * Order::Hilbert and Order::Morton sort the nodes by their position along
+   * a space-filling curve over node positions, so nodes that are close in
+   * space get close indices. Renumbering the edges to match means that
+   * incident iteration, which reads the edge array, walks it nearly in order
+   * as well instead of jumping around it.
+   *
+   * Order::RCM is the reverse Cuthill-McKee ordering, computed from the
+   * topology alone: each connected component is numbered breadth first from
+   * a pseudo-peripheral node, taking a node's unnumbered neighbors in order
+   * of increasing degree, and the whole numbering is then reversed. It keeps
+   * adjacent nodes close in index, so the matrix that to_csr_matrix()
+   * exports afterwards has a small bandwidth() and a small profile.
+   *
+   * Invalidates outstanding Node, Edge and iterator objects, and edge
+   * indices.
+   *
+   * Complexity: O(num_nodes() log(num_nodes()) + num_edges() log(num_edges())).
+   */
+  std::vector<size_type> reorder(Order order) {
+    CME212_TRACE_SCOPE("reorder");
+    std::vector<std::size_t> sequence;
+    if(order == Order::RCM) {
+      sequence = rcm_sequence();
+    } else if(order == Order::Morton) {
+      sequence = sfc::curve_order(node_positions_.data(), num_nodes(),
+                                  sfc::morton_key);
+    } else {
+      sequence = sfc::curve_order(node_positions_.data(), num_nodes(),
+                                  sfc::hilbert_key);
+    }
+
+    //sequence lists the old indices in their new order; invert it
+    std::vector<size_type> perm(num_nodes());
+    for(size_type k = 0; k < num_nodes(); ++k)
+      perm[sequence[k]] = k;
+    permute_nodes(perm);
+    sort_edges();
+    return perm;
+  }
+
+  /**
+  * @brief Renumber the edges tile by tile, so that an edge sweep reads the
+  *        positions of a few node blocks at a time.
+  *
+  * @param[in] block_size  Nodes per block; 0 picks default_tile_nodes()
+  * @return The tiles, as edge_tiles() returns them afterwards
+  *
+  * @post Edges whose smaller endpoint is in block i and larger endpoint in
+  *       block j, blocks being @a block_size node indices wide, are
+  *       numbered contiguously, tiles in order of (i, j) and edges in one
+  *       tile by canonical key
+  *
+  * An edge sweep in index order fetches both endpoints' positions, which
+  * for edges in insertion order are scattered over all nodes. After
+  * tiling, the edges of one tile touch only two blocks of positions, which
+  * stay in cache for the whole tile; the edge iterators, for_each_edge()
+  * and the edge arrays all follow the tiled order. The tiles also make
+  * units of parallel work:
+  *
+  *   const auto& layout = g.tile_edges();
+  *   //parallel for t over layout.tiles
+  *   //  for k in layout.tiles[t].first .. layout.tiles[t].last
+  *   //    sweep(g.edge(k))
+  *
+  * Node indices should be local first, e.g. by reorder(), so that
+  * neighbors fall into few blocks. Invalidates outstanding Edge objects
+  * and edge indices; the tiles stay valid until the next topology change.
+  *
+  * Complexity: O(num_edges() log(num_edges())).
+  **/
+  const edge_tile_layout& tile_edges(size_type block_size = 0) {
+    CME212_TRACE_SCOPE("tile_edges");
+    if(block_size == 0)
+      block_size = default_tile_nodes();
+    size_type m = num_edges();
+    auto tile_of = [&](size_type k) {
+      const internal_edge& e = graph_edges[k];
+      size_type a = std::min(e.source, e.dest) / block_size;
+      size_type b = std::max(e.source, e.dest) / block_size;
+      return std::make_pair(a, b);
+    };
+    std::vector<size_type> order(m);
+    for(size_type k = 0; k < m; ++k)
+      order[k] = k;
+    std::sort(order.begin(), order.end(), [&](size_type i, size_type j) {
+      auto ti = tile_of(i);
+      auto tj = tile_of(j);
+      if(ti != tj)
+        return ti < tj;
+      return make_key(graph_edges[i].source, graph_edges[i].dest) <
+             make_key(graph_edges[j].source, graph_edges[j].dest);
+    });
+    permute_edges(order);
+
+    edge_tiles_.block_size = block_size;
+    edge_tiles_.tiles.clear();
+    for(size_type k = 0; k < m; ++k) {
+      auto t = tile_of(k);
+      if(edge_tiles_.tiles.empty() ||
+         edge_tiles_.tiles.back().source_block != t.first ||
+         edge_tiles_.tiles.back().target_block != t.second)
+        edge_tiles_.tiles.push_back(edge_tile{t.first, t.second, k, k});
+      edge_tiles_.tiles.back().last = k + 1;
+    }
+    edge_tiles_version_ = topology_version_;
+    return edge_tiles_;
+  }
+
+  /**
+  * @brief Return the tiles of the last tile_edges(), or an empty layout if
+  *        a node or edge was added, removed or renumbered since.
+  *
+  * Complexity: O(1).
+  **/
+  const edge_tile_layout& edge_tiles() const {
+    static const edge_tile_layout none;
+    return edge_tiles_version_ == topology_version_ ? edge_tiles_ : none;
+  }
+
+  /**
+  * @brief Return the default block size of tile_edges(): as many nodes as
+  *        fill half of a 256 KiB L2 cache with the positions of two blocks.
+  **/
+  static constexpr size_type default_tile_nodes() {
+    return size_type((std::size_t(1) << 17) / (2 * sizeof(point_type)));
+  }
+
+  /**
+   * @brief Return the bandwidth of the adjacency matrix.
+   *
+   * @param none
+   * @return The largest |a.index() - b.index()| over all edges (a, b), or 0
+   *         if there are no edges
+   *
+   * Complexity: O(num_edges()).
+   */
+  size_type bandwidth() const {
+    size_type width = 0;
+    for(const internal_edge& e : graph_edges) {
+      size_type d = (e.source > e.dest) ? e.source - e.dest
+                                        : e.dest - e.source;
+      width = std::max(width, d);
+    }
+    return width;
+  }
+
+  /**
+   * @brief Export the adjacency as a compressed sparse row matrix.
+   *
+   * @param[in] diagonal  Whether to store an entry (i, i) in every row
+   * @return A num_nodes() x num_nodes() matrix with an entry (i, j) for
+   *         every edge between node(i) and node(j), in both rows, valued
+   *         with the edge's value. Diagonal entries, if requested, get
+   *         edge_value_type().
+   *
+   * Rows and columns follow the current node numbering, so calling
+   * reorder(Order::RCM) first yields a banded matrix. The rows are copied
+   * straight from the adjacency rows, which are already sorted by column.
+   *
+   * Complexity: O(num_nodes() + num_edges()).
+   */
+  csr_matrix to_csr_matrix(bool diagonal = false) const {
+    csr_matrix m;
+    m.rows = num_nodes();
+    std::size_t nnz = 2 * std::size_t(num_edges()) +
+                      (diagonal ? std::size_t(num_nodes()) : 0);
+    m.row_offsets.resize(std::size_t(num_nodes()) + 1);
+    m.columns.reserve(nnz);
+    m.values.reserve(nnz);
+    for(size_type i = 0; i < num_nodes(); ++i) {
+      m.row_offsets[i] = m.columns.size();
+      const csr_incidence* row = row_data(i);
+      size_type len = row_size(i);
+      bool pending = diagonal;
+      for(size_type k = 0; k < len; ++k) {
+        if(pending && row[k].node > i) {
+          m.columns.push_back(i);
+          m.values.push_back(edge_value_type());
+          pending = false;
+        }
+        m.columns.push_back(row[k].node);
+        m.values.push_back(edge_values_[row[k].edge]);
+      }
+      if(pending) {
+        m.columns.push_back(i);
+        m.values.push_back(edge_value_type());
+      }
+    }
+    m.row_offsets[num_nodes()] = m.columns.size();
+    return m;
+  }
+
+  /**
+   * @brief Renumber the nodes so that node i gets index @a perm[i].
+   *
+   * @param[in] perm  New index of every node
+   *
+   * @pre @a perm.size() == num_nodes() and @a perm is a permutation of
+   *      0..num_nodes()-1
+   * @post For every old index i, new node(perm[i]) has the position, value
+   *       and degree that old node(i) had, and is adjacent to
+   *       new node(perm[j]) exactly when old node(i) was adjacent to
+   *       old node(j)
+   * @post Edge indices and values do not change. Each edge keeps its
+   *       orientation: edge(k).node1() is the renumbered old
+   *       edge(k).node1().
+   *
+   * Invalidates outstanding Node, Edge and iterator objects: they keep
+   * their indices, which now name different nodes. A frozen graph stays
+   * frozen. Cached edge lengths stay valid, since no position changes, and
+   * so does edge_coloring(), since the same edges still share nodes.
+   *
+   * Complexity: O(num_nodes() + sum of d log d over the node degrees d).
+   */
+  void permute_nodes(const std::vector<size_type>& perm) {
+    assert(perm.size() == num_nodes());
+    CME212_TRACE_SCOPE("permute_nodes");
+    bool was_frozen = frozen_;
+    thaw();
+
+    std::pmr::memory_resource* resource = get_memory_resource();
+    std::pmr::vector<point_type> positions(num_nodes(), resource);
+    std::pmr::vector<node_value_type> values(resource);
+    values.reserve(num_nodes());
+    for(size_type i = 0; i < num_nodes(); ++i)
+      positions[perm[i]] = node_positions_[i];
+
+    //Values may not be default constructible, so they are moved into place
+    //in new index order through the inverse permutation
+    std::vector<size_type> old_index(num_nodes());
+    for(size_type i = 0; i < num_nodes(); ++i)
+      old_index[perm[i]] = i;
+    for(size_type k = 0; k < num_nodes(); ++k)
+      values.push_back(std::move(node_values_[old_index[k]]));
+
+    //Rows move with their node; every neighbor in them is renumbered, which
+    //breaks their order by neighbor index
+    std::pmr::vector<incidence_row> adjacency(resource);
+    adjacency.reserve(num_nodes());
+    std::pmr::vector<size_type> degrees(num_nodes(), resource);
+    for(size_type k = 0; k < num_nodes(); ++k) {
+      adjacency.push_back(std::move(adjacency_[old_index[k]]));
+      incidence_row& row = adjacency.back();
+      for(csr_incidence& x : row)
+        x.node = perm[x.node];
+      std::sort(row.begin(), row.end(), by_neighbor);
+      degrees[k] = degrees_[old_index[k]];
+    }
+
+    for(internal_edge& e : graph_edges) {
+      e.source = perm[e.source];
+      e.dest = perm[e.dest];
+    }
+
+    node_positions_.swap(positions);
+    node_values_.swap(values);
+    adjacency_.swap(adjacency);
+    rows_sorted_ = true;
+    degrees_.swap(degrees);
+    gather_flags(removed_nodes_, old_index.data(), num_nodes());
+    node_properties_.gather(old_index.data(), num_nodes());
+    node_generations_.gather(old_index.data(), num_nodes(), num_nodes());
+    position_changes_.mark(0, num_nodes());
+    edge_changes_.mark(0, num_edges());
+    topology_changed();
+    if(was_frozen)
+      freeze();
+  }
+
+  /**
+   * @brief Pack the adjacency into a compressed sparse row (CSR) layout.
+   *
+   * @param none
+   *
+   * @pre Graph object exists
+   * @post is_frozen() == true
+   * @post For every node n, n.edge_begin()..n.edge_end() walks one contiguous
+   *       slice of a single incidence array instead of its own row, in
+   *       increasing order of the adjacent node's index.
+   *
+   * The adjacency rows are already contiguous and sorted; freezing packs
+   * them back to back so that a sweep over every node's incidences streams
+   * through one array. The graph stays fully usable while frozen. add_node()
+   * keeps the CSR valid by appending an empty row. add_edge() and
+   * add_edges() of new edges keep the graph frozen too: the rows they
+   * change are served from the mutable per-node rows instead of their CSR
+   * slices, and once more than csr_merge_threshold() of the rows are
+   * stale the CSR arrays are rebuilt, so trickle updates keep near CSR
+   * speed at O(1 + num_edges() / num_nodes()) amortized per changed row.
+   * Removals thaw the graph back to the per-node rows. Calling freeze() on
+   * a frozen graph merges its stale rows, if any, and does nothing
+   * otherwise. Invalidates outstanding IncidentIterators.
+   *
+   * Complexity: O(num_nodes() + num_edges()).
+   */
+  void freeze() {
+    if(frozen_ && csr_stale_rows_ == 0)
+      return;
+    typename stats_type::scoped_timer timer(stats_, &graph_stats::freeze_ns);
+    CME212_TRACE_SCOPE("freeze");
+    sort_rows();
+
+    //Prefix sum of the row lengths leaves the start of row i in
+    //csr_offsets_[i]
+    csr_offsets_.assign(num_nodes() + 1, 0);
+    for(size_type i = 0; i < num_nodes(); ++i)
+      csr_offsets_[i + 1] = csr_offsets_[i] + adjacency_[i].size();
+
+    //Rows are kept sorted by neighbor index, so they are copied as they are
+    csr_incidences_.resize(2 * num_edges());
+    for(size_type i = 0; i < num_nodes(); ++i) {
+      std::copy(adjacency_[i].begin(), adjacency_[i].end(),
+                csr_incidences_.begin() + csr_offsets_[i]);
+    }
+
+    csr_stale_.assign(num_nodes(), 0);
+    csr_stale_rows_ = 0;
+    frozen_ = true;
+    csr_weights_valid_ = false;
+    csr_columns_valid_ = false;
+  }
+
+  /**
+   * @brief Return whether the adjacency is currently packed in CSR form.
+   *
+   * @param none
+   * @return True between a call to freeze() and the next mutation that thaws
+   *         the graph. False otherwise.
+   *
+   * Complexity: O(1).
+   */
+  bool is_frozen() const {
+    return frozen_;
+  }
+
+  /**
+   * @brief Set when edges added to a frozen graph rebuild its CSR arrays.
+   *
+   * @param[in] ratio  Fraction of the nodes in [0, 1]
+   *
+   * Rows changed while frozen are merged back by a full freeze() once they
+   * exceed @a ratio * num_nodes(). The default is 0.125. A ratio of 0
+   * rebuilds on every new edge; a ratio of 1 leaves merging to explicit
+   * freeze() calls.
+   **/
+  void set_csr_merge_threshold(double ratio) {
+    assert(ratio >= 0 && ratio <= 1);
+    csr_merge_threshold_ = ratio;
+  }
+  double csr_merge_threshold() const {
+    return csr_merge_threshold_;
+  }
+
+  /** Return the number of rows served from the per-node rows while frozen
+   *  because edges were added since the CSR arrays were built. */
+  size_type num_stale_rows() const {
+    return csr_stale_rows_;
+  }
+
+  /**
+   * @brief Return the CSR arrays of a frozen graph, without copying them.
+   *
+   * @param none
+   * @return A csr_view (common/sparse_export.hpp) of num_nodes() rows over
+   *         the graph's own offsets and incidences, with stride 2: entry k
+   *         is the neighbor view.neighbor(k) over edge view.edge(k). The
+   *         view is not valid() unless the graph is frozen without stale
+   *         rows and has no tombstones.
+   *
+   * For handing the topology to a solver or partitioner that can read the
+   * graph's index types as they are; the edge indices pick out the matrix
+   * values from edge_values_data(). Otherwise use export_csr() or
+   * export_coo(), which write any layout into the caller's arrays.
+   * Invalidated by every change to the edges, by freeze() and by clear().
+   * Complexity: O(1).
+   */
+  auto view_csr() const {
+    static_assert(sizeof(csr_incidence) == 2 * sizeof(size_type),
+                  "csr_incidence must be two packed indices");
+    csr_view<offset_type, size_type> view;
+    if(!frozen_ || csr_stale_rows_ != 0 || num_removed_nodes_ != 0 ||
+       num_removed_edges_ != 0)
+      return view;
+    const size_type* entries =
+        reinterpret_cast<const size_type*>(csr_incidences_.data());
+    view.offsets = csr_offsets_.data();
+    view.neighbors = entries;
+    view.edges = entries + 1;
+    view.stride = 2;
+    view.num_rows = num_nodes();
+    view.weights = weights_view();
+    return view;
+  }
+
+  /**
+   * @brief Give every edge a float weight, read by Edge::weight().
+   *
+   * @param[in] init  Weight of every current edge
+   *
+   * @post has_weights() == true, and every edge has weight @a init. Edges
+   *       added later start at weight 1.
+   *
+   * Weights are a known-width companion to the edge values for the
+   * numeric engines: one float per edge in edge index order that follows
+   * every renumbering (compact(), remove_edge(), sort_edges(), reorder()),
+   * and a copy in CSR order from weights_view() for loops that stream the
+   * targets and weights side by side. Snapshots and mapped graph files do
+   * not store them: deserialize() resets them to 1. Calling it again sets
+   * every weight to @a init.
+   *
+   * Complexity: O(num_edges()).
+   **/
+  void enable_weights(float init = 1.0f) {
+    weighted_ = true;
+    edge_weights_.assign(num_edges(), init);
+    csr_weights_valid_ = false;
+  }
+
+  /** Drop the weights, releasing their arrays. Complexity: O(1). */
+  void disable_weights() {
+    weighted_ = false;
+    std::pmr::vector<float>(get_memory_resource()).swap(edge_weights_);
+    std::pmr::vector<float>(get_memory_resource()).swap(csr_weights_);
+    csr_weights_valid_ = false;
+  }
+
+  /** Return true if enable_weights() gave the edges weights. */
+  bool has_weights() const {
+    return weighted_;
+  }
+
+  /**
+   * @brief Return the weights of a frozen graph in CSR order.
+   *
+   * @param none
+   * @return Pointer to view_csr().nnz() weights, where element k is the
+   *         weight of the edge of CSR entry k; nullptr unless has_weights()
+   *         and view_csr() is valid()
+   *
+   * The array lines up with the neighbors of view_csr() entry by entry, a
+   * contiguous float per entry, so a loop over a row reads the targets and
+   * the weights in step and vectorizes:
+   *
+   * @code
+   * auto v = g.view_csr();
+   * for(size_type k = v.offsets[i]; k < v.offsets[i + 1]; ++k)
+   *   s += v.weights[k] * x[v.neighbor(k)];
+   * @endcode
+   *
+   * Invalidated like view_csr() and by set_weight().
+   * Complexity: O(1), or O(num_edges()) for the first call after the
+   * weights or the CSR arrays changed.
+   **/
+  const float* weights_view() const {
+    if(!weighted_ || !frozen_ || csr_stale_rows_ != 0 ||
+       num_removed_nodes_ != 0 || num_removed_edges_ != 0)
+      return nullptr;
+    if(!csr_weights_valid_) {
+      csr_weights_.resize(csr_incidences_.size());
+      for(std::size_t k = 0; k < csr_incidences_.size(); ++k)
+        csr_weights_[k] = edge_weights_[csr_incidences_[k].edge];
+      csr_weights_valid_ = true;
+    }
+    return csr_weights_.data();
+  }
+
+  /**
+   * @brief Return the neighbors of a frozen graph's CSR entries as one
+   *        contiguous array.
+   *
+   * @param none
+   * @return Pointer to view_csr().nnz() indices, where element k is
+   *         view_csr().neighbor(k); nullptr unless view_csr() is valid()
+   *
+   * view_csr() interleaves every neighbor with its edge index. Libraries
+   * whose column arrays must have unit stride, such as an Eigen sparse
+   * matrix mapped by eigen_adjacency() (common/eigen_map.hpp), read this
+   * array instead, together with view_csr().offsets and weights_view().
+   * It is kept until the CSR arrays change, so repeated solves on one
+   * topology share it.
+   *
+   * Invalidated like view_csr().
+   * Complexity: O(1), or O(num_edges()) for the first call after the CSR
+   * arrays changed.
+   **/
+  const size_type* columns_view() const {
+    if(!frozen_ || csr_stale_rows_ != 0 || num_removed_nodes_ != 0 ||
+       num_removed_edges_ != 0)
+      return nullptr;
+    if(!csr_columns_valid_) {
+      csr_columns_.resize(csr_incidences_.size());
+      for(std::size_t k = 0; k < csr_incidences_.size(); ++k)
+        csr_columns_[k] = csr_incidences_[k].node;
+      csr_columns_valid_ = true;
+    }
+    return csr_columns_.data();
+  }
+
+  /**
+   * @brief Return the memory resource the graph allocates from.
+   *
+   * @param none
+   * @return The resource passed to the constructor, or the default resource
+   *         at construction time for a default-constructed graph
+   *
+   * Complexity: O(1).
+   */
+  std::pmr::memory_resource* get_memory_resource() const {
+    return graph_edges.get_allocator().resource();
+  }
+
+  /** Type of a graph opened with open_mapped(). */
+  using mapped_graph_type = MappedGraph<V, E>;
+
+  /**
+   * @brief Write the graph to @a path in the binary graph file format.
+   *
+   * @param[in] path  File to create or overwrite
+   *
+   * @pre node_value_type and edge_value_type are trivially copyable
+   * @post is_frozen() == true
+   * @post open_mapped(@a path) has the same nodes, positions, node values,
+   *       edges and edge values, with the same indices
+   * @throws std::runtime_error if the file cannot be written
+   *
+   * Freezes the graph first, then writes the position and value arrays, the
+   * edge and edge value arrays and the CSR arrays as they are laid out in memory. See
+   * common/mapped_graph.hpp for the format.
+   *
+   * Complexity: O(num_nodes() + num_edges()).
+   */
+  void save_binary(const std::string& path) {
+    static_assert(std::is_trivially_copyable<node_value_type>::value,
+                  "save_binary() requires a trivially copyable node value");
+    static_assert(std::is_trivially_copyable<edge_value_type>::value,
+                  "save_binary() requires a trivially copyable edge value");
+    static_assert(sizeof(size_type) == sizeof(std::uint32_t) &&
+                  sizeof(offset_type) == sizeof(std::uint32_t) &&
+                  sizeof(internal_edge) == sizeof(graph_file::edge_record) &&
+                  sizeof(csr_incidence) == sizeof(graph_file::incidence_record),
+                  "graph file records must match the in-memory layout");
+    freeze();
+
+    graph_file::header h = {};
+    graph_file::set_magic(h);
+    h.version = graph_file::version;
+    h.point_size = sizeof(point_type);
+    h.value_size = sizeof(node_value_type);
+    h.edge_value_size = sizeof(edge_value_type);
+    h.num_nodes = num_nodes();
+    h.num_edges = num_edges();
+    graph_file::layout(h);
+
+    graph_file::writer out(path, h);
+    out.write_at(h.positions_offset, node_positions_.data(),
+                 node_positions_.size() * sizeof(point_type));
+    out.write_at(h.values_offset, node_values_.data(),
+                 node_values_.size() * sizeof(node_value_type));
+    out.write_at(h.edges_offset, graph_edges.data(),
+                 graph_edges.size() * sizeof(internal_edge));
+    out.write_at(h.edge_values_offset, edge_values_.data(),
+                 edge_values_.size() * sizeof(edge_value_type));
+    out.write_at(h.csr_offsets_offset, csr_offsets_.data(),
+                 csr_offsets_.size() * sizeof(offset_type));
+    out.write_at(h.csr_incidences_offset, csr_incidences_.data(),
+                 csr_incidences_.size() * sizeof(csr_incidence));
+    out.finish(h.file_size);
+  }
+
+  /**
+   * @brief Map a file written by save_binary() as a read-only-topology graph.
+   *
+   * @param[in] path  File written by save_binary() for these value types
+   * @return A frozen MappedGraph served directly from the mapped file
+   *
+   * @throws std::runtime_error if the file is missing, is not a graph file,
+   *         or was written with a different point_type, node_value_type or
+   *         edge_value_type size
+   *
+   * Nothing is parsed or allocated per element, so opening costs the same
+   * for any graph size and pages are only read as they are touched. The
+   * result offers the read side of Graph: nodes, edges, incident iteration
+   * over the sorted CSR rows and has_edge(). Positions and node and edge
+   * values may be modified; the mapping is private, so the file itself never
+   * changes.
+   *
+   * Complexity: O(1).
+   */
+  static mapped_graph_type open_mapped(const std::string& path) {
+    return mapped_graph_type(path);
+  }
+
+  /**
+   * @brief Write a snapshot of the whole graph to @a out.
+   *
+   * @param[in,out] out  Stream to write to, opened in binary mode
+   *
+   * @pre node_value_type and edge_value_type are trivially copyable
+   * @post deserialize() of the written bytes restores the same nodes,
+   *       positions, values, edges, edge values, adjacency rows, tombstones
+   *       and frozen state
+   * @throws std::runtime_error if the stream fails
+   *
+   * Every array is written as one raw block and the adjacency rows as one
+   * CSR block, after a header that records every element size; see
+   * common/graph_snapshot.hpp. Unlike save_binary(), this does not freeze
+   * the graph. Property arrays, cached edge geometry and edge_coloring()
+   * are not part of a snapshot.
+   *
+   * Complexity: O(num_nodes() + num_edges()).
+   */
+  void serialize(std::ostream& out) const {
+    static_assert(std::is_trivially_copyable<node_value_type>::value,
+                  "serialize() requires a trivially copyable node value");
+    static_assert(std::is_trivially_copyable<edge_value_type>::value,
+                  "serialize() requires a trivially copyable edge value");
+    sort_rows();
+    graph_snapshot::header h = snapshot_header();
+    h.frozen = frozen_;
+    h.num_nodes = num_nodes();
+    h.num_edges = num_edges();
+    h.num_removed_nodes = num_removed_nodes_;
+    h.num_removed_edges = num_removed_edges_;
+    h.removed_node_flags = removed_nodes_.size();
+    h.removed_edge_flags = removed_edges_.size();
+    h.compaction_threshold = compaction_threshold_;
+
+    //The CSR arrays of a frozen graph without stale rows are the rows
+    //already packed; otherwise pack the offsets and write the rows one
+    //after another
+    bool packed = frozen_ && csr_stale_rows_ == 0;
+    std::pmr::vector<offset_type> offsets(get_memory_resource());
+    const offset_type* row_offsets = csr_offsets_.data();
+    if(!packed) {
+      offsets.resize(std::size_t(num_nodes()) + 1, 0);
+      for(size_type i = 0; i < num_nodes(); ++i)
+        offsets[i + 1] = offsets[i] + adjacency_[i].size();
+      row_offsets = offsets.data();
+    }
+    h.row_entries = row_offsets[num_nodes()];
+
+    graph_snapshot::write_block(out, &h, sizeof(h));
+    graph_snapshot::write_block(out, node_positions_.data(),
+                                node_positions_.size() * sizeof(point_type));
+    graph_snapshot::write_block(out, node_values_.data(),
+                                node_values_.size() * sizeof(node_value_type));
+    graph_snapshot::write_block(out, graph_edges.data(),
+                                graph_edges.size() * sizeof(internal_edge));
+    graph_snapshot::write_block(out, edge_values_.data(),
+                                edge_values_.size() * sizeof(edge_value_type));
+    graph_snapshot::write_block(out, degrees_.data(),
+                                degrees_.size() * sizeof(size_type));
+    graph_snapshot::write_block(out, row_offsets,
+                                (std::size_t(num_nodes()) + 1) *
+                                sizeof(offset_type));
+    if(packed) {
+      graph_snapshot::write_block(out, csr_incidences_.data(),
+                                  h.row_entries * sizeof(csr_incidence));
+    } else {
+      for(const incidence_row& row : adjacency_)
+        graph_snapshot::write_block(out, row.data(),
+                                    row.size() * sizeof(csr_incidence));
+    }
+    write_flags(out, removed_nodes_);
+    write_flags(out, removed_edges_);
+  }
+
+  /**
+   * @brief Replace the contents of this graph with a snapshot read from
+   *        @a in.
+   *
+   * @param[in,out] in  Stream positioned at a snapshot written by serialize()
+   *
+   * @pre The snapshot was written by a graph with the same node value, edge
+   *      value and index types
+   * @post The graph has exactly the nodes, edges, values, adjacency rows,
+   *       tombstones and frozen state that were serialized, with the same
+   *       indices
+   * @throws std::runtime_error if the stream is not a snapshot, was written
+   *         for other types, or ends early. The graph is then unchanged.
+   *
+   * Each block is read with one call straight into an array sized from the
+   * header, and the adjacency rows are cut out of the CSR block, so nothing
+   * is searched, sorted or hashed. Invalidates outstanding Node, Edge and
+   * iterator objects. Property arrays from make_node_property() and
+   * make_edge_property() keep working but are reset to default values, as
+   * after clear() and the same number of additions.
+   *
+   * Complexity: O(num_nodes() + num_edges()) of the snapshot.
+   */
+  void deserialize(std::istream& in) {
+    static_assert(std::is_trivially_copyable<node_value_type>::value,
+                  "deserialize() requires a trivially copyable node value");
+    static_assert(std::is_trivially_copyable<edge_value_type>::value,
+                  "deserialize() requires a trivially copyable edge value");
+    graph_snapshot::header h;
+    graph_snapshot::read_block(in, &h, sizeof(h));
+    graph_snapshot::check(h, snapshot_header());
+    std::size_t n = std::size_t(h.num_nodes);
+    std::size_t m = std::size_t(h.num_edges);
+
+    //Read into fresh arrays and swap them in only once all reads succeed
+    std::pmr::memory_resource* resource = get_memory_resource();
+    std::pmr::vector<point_type> positions(n, resource);
+    std::pmr::vector<node_value_type> values(n, resource);
+    std::pmr::vector<internal_edge> edges(m, resource);
+    std::pmr::vector<edge_value_type> edge_values(m, resource);
+    std::pmr::vector<size_type> degrees(n, resource);
+    std::pmr::vector<offset_type> offsets(n + 1, resource);
+    std::pmr::vector<csr_incidence> incidences(std::size_t(h.row_entries),
+                                               resource);
+    graph_snapshot::read_block(in, positions.data(), n * sizeof(point_type));
+    graph_snapshot::read_block(in, values.data(), n * sizeof(node_value_type));
+    graph_snapshot::read_block(in, edges.data(), m * sizeof(internal_edge));
+    graph_snapshot::read_block(in, edge_values.data(),
+                               m * sizeof(edge_value_type));
+    graph_snapshot::read_block(in, degrees.data(), n * sizeof(size_type));
+    graph_snapshot::read_block(in, offsets.data(),
+                               (n + 1) * sizeof(offset_type));
+    if(offsets[0] != 0 || offsets[n] != h.row_entries)
+      throw std::runtime_error("graph_snapshot: corrupt row offsets");
+    graph_snapshot::read_block(in, incidences.data(),
+                               incidences.size() * sizeof(csr_incidence));
+    std::pmr::vector<bool> removed_nodes(resource), removed_edges(resource);
+    read_flags(in, removed_nodes, std::size_t(h.removed_node_flags));
+    read_flags(in, removed_edges, std::size_t(h.removed_edge_flags));
+
+    std::pmr::vector<incidence_row> adjacency(resource);
+    adjacency.reserve(n);
+    for(std::size_t i = 0; i < n; ++i) {
+      if(offsets[i + 1] < offsets[i] || offsets[i + 1] > offsets[n])
+        throw std::runtime_error("graph_snapshot: corrupt row offsets");
+      adjacency.emplace_back(incidences.begin() + offsets[i],
+                             incidences.begin() + offsets[i + 1]);
+    }
+
+    node_positions_.swap(positions);
+    bounds_valid_ = false;
+    node_values_.swap(values);
+    graph_edges.swap(edges);
+    edge_values_.swap(edge_values);
+    if(weighted_)
+      edge_weights_.assign(m, 1.0f);
+    degrees_.swap(degrees);
+    adjacency_.swap(adjacency);
+    rows_sorted_ = true;
+    removed_nodes_.swap(removed_nodes);
+    removed_edges_.swap(removed_edges);
+    num_removed_nodes_ = size_type(h.num_removed_nodes);
+    num_removed_edges_ = size_type(h.num_removed_edges);
+    compaction_threshold_ = h.compaction_threshold;
+    edge_cache_.clear();
+    coloring_valid_ = false;
+    topology_changed();
+    node_properties_.resize(0);
+    node_properties_.resize(num_nodes());
+    edge_properties_.resize(0);
+    edge_properties_.resize(num_edges());
+    node_generations_.retire(0, positions.size());
+    edge_generations_.retire(0, edges.size());
+    position_changes_.clear();
+    position_changes_.mark(0, num_nodes());
+    edge_changes_.clear();
+    edge_changes_.mark(0, num_edges());
+
+    //A frozen snapshot keeps its CSR block as the frozen arrays
+    frozen_ = h.frozen != 0;
+    if(frozen_) {
+      csr_offsets_.swap(offsets);
+      csr_incidences_.swap(incidences);
+      csr_stale_.assign(n, 0);
+    } else {
+      std::pmr::vector<offset_type>(resource).swap(csr_offsets_);
+      std::pmr::vector<csr_incidence>(resource).swap(csr_incidences_);
+      std::pmr::vector<std::uint8_t>(resource).swap(csr_stale_);
+    }
+    csr_stale_rows_ = 0;
+  }
+
+  /**
+   * @brief Return the operation counters and timers of this graph.
+   *
+   * @param none
+   * @return The counts of add_node(), add_edge() (new and duplicate),
+   *         has_edge() and its probes, fetch_node()/fetch_edge() and node or
+   *         edge array reallocations and merges of stale frozen rows
+   *         since construction or the last reset_stats(), plus the time spent in the main operations and
+   *         the totals of memory_usage() at this call. Single add_node(),
+   *         add_edge() and has_edge() calls also land in latency
+   *         histograms, and those that regrew the node or edge arrays
+   *         in growth_latency as well.
+   *
+   * @pre Graph object exists
+   * @post Every field is 0 unless the code was compiled with
+   *       -DCME212_GRAPH_STATS=1
+   *
+   * Instrumentation is a compile-time choice. When it is off, the recording
+   * calls compile to nothing and the graph pays no runtime cost. When it is
+   * on, the counters are not synchronized, so they are only exact for
+   * single-threaded use.
+   *
+   * Complexity: O(1), or O(num_nodes()) for the memory totals when
+   * instrumentation is on.
+   */
+  const graph_stats& stats() const {
+    if constexpr (bool(CME212_GRAPH_STATS)) {
+      graph_memory m = memory_usage();
+      stats_.set(&graph_stats::memory_used, m.used());
+      stats_.set(&graph_stats::memory_reserved, m.reserved());
+    }
+    return stats_.get();
+  }
+
+  /**
+   * @brief Return how many bytes the graph holds, per component.
+   *
+   * @param none
+   * @return For each component, the bytes its elements use and the bytes
+   *         reserved for them, spare capacity included:
+   *         nodes       positions and values, with the front buffer
+   *                     of double buffering and the position history
+   *         edges       endpoint records, values and the length cache
+   *         adjacency   the rows' entries, one row header per node and the
+   *                     degree array
+   *         csr         the frozen CSR arrays, empty unless frozen
+   *         properties  arrays made by make_node_property() and
+   *                     make_edge_property() that are still alive
+   *         other       tombstone flags, the cached edge coloring and the
+   *                     Graph object itself
+   *         The graph keeps no edge hash table, so hash is 0.
+   *         allocator_overhead estimates the heap's own headers, one per
+   *         non-empty container, as for the default resource; a
+   *         PageResource or monotonic resource has less.
+   *
+   * The figures count what the containers hold, not what the memory
+   * resource has mapped: pages of a reserved but untouched capacity may
+   * not be resident yet.
+   *
+   * Complexity: O(num_nodes()), one visit per adjacency row.
+   */
+  graph_memory memory_usage() const {
+    graph_memory m;
+    auto add = [&m](memory_component& c, const auto& v) {
+      using elem = typename std::decay_t<decltype(v)>::value_type;
+      c.add(v.size(), v.capacity(), sizeof(elem));
+      m.add_block(v.capacity() * sizeof(elem));
+    };
+    add(m.nodes, node_positions_);
+    add(m.nodes, node_values_);
+    add(m.nodes, front_positions_);
+    add(m.nodes, front_values_);
+    add(m.nodes, history_);
+    for(const auto& slot : history_)
+      add(m.nodes, slot);
+    add(m.edges, graph_edges);
+    add(m.edges, edge_values_);
+    add(m.edges, edge_weights_);
+    add(m.edges, edge_cache_);
+    add(m.adjacency, adjacency_);
+    for(const incidence_row& row : adjacency_)
+      add(m.adjacency, row);
+    add(m.adjacency, degrees_);
+    add(m.csr, csr_offsets_);
+    add(m.csr, csr_incidences_);
+    add(m.csr, csr_stale_);
+    add(m.csr, csr_columns_);
+    add(m.csr, csr_weights_);
+
+    //Flags are bits, packed into words
+    for(const auto* flags : {&removed_nodes_, &removed_edges_}) {
+      m.other.used += (flags->size() + 7) / 8;
+      m.other.reserved += (flags->capacity() + 7) / 8;
+      m.add_block((flags->capacity() + 7) / 8);
+    }
+    add(m.other, coloring_.edges);
+    add(m.other, coloring_.offsets);
+    add(m.other, node_coloring_.nodes);
+    add(m.other, node_coloring_.offsets);
+    add(m.other, edge_tiles_.tiles);
+    add(m.other, weld_heads_);
+    add(m.other, weld_next_);
+    for(const auto* table : {&node_generations_, &edge_generations_}) {
+      m.other.used += table->bytes();
+      m.other.reserved += table->capacity_bytes();
+      m.add_block(table->capacity_bytes());
+    }
+    m.other.used += sizeof(Graph);
+    m.other.reserved += sizeof(Graph);
+
+    for(const auto* registry : {&node_properties_, &edge_properties_}) {
+      std::size_t arrays = 0;
+      std::pair<std::size_t, std::size_t> b = registry->bytes(arrays);
+      m.properties.used += b.first;
+      m.properties.reserved += b.second;
+      //Two headers per array: its shared storage object and its elements
+      m.allocator_overhead += 2 * 16 * arrays;
+    }
+    return m;
+  }
+
+  /**
+   * @brief Check the internal invariants of the graph.
+   *
+   * @param[in] parallel  Whether to check with all cores
+   * @return The number of broken invariants and the first few of them;
+   *         ok() if there are none
+   *
+   * Checks that the arrays agree in size, that every edge joins two
+   * distinct nodes in range, and that every adjacency row is sorted by
+   * neighbor, lists only edges that have the row's node as an endpoint,
+   * holds no repeated neighbor unless parallel edges are allowed, and
+   * counts its live entries in the degree array. Each edge must be listed
+   * exactly once in the row of each endpoint, which makes the rows
+   * symmetric. Tombstone counts and, while frozen, the CSR slices of the
+   * rows that are not stale are checked too. Rows are already sorted
+   * canonical keys, so nothing is sorted or searched: one pass over the
+   * rows and one over the edges, in slices per thread, with one atomic
+   * byte per edge recording which endpoint rows listed it.
+   *
+   * Cheap enough to run after every bulk load, e.g. after read_snapshot()
+   * or a loader, to catch corrupt input before it is used.
+   *
+   * Complexity: O(num_nodes() + num_edges()), spread over the threads.
+   **/
+  validation_report validate(bool parallel = true) const {
+    CME212_TRACE_SCOPE("validate");
+    unsigned threads = parallel ? csr_snapshot::thread_count(0) : 1;
+    sort_rows(threads);
+    std::size_t n = node_positions_.size();
+    std::size_t m = graph_edges.size();
+    validation_report report;
+
+    //Array sizes first: the other checks index by them
+    auto expect_size = [&](const char* what, std::size_t size,
+                           std::size_t want) {
+      if(size != want)
+        note(report, std::string(what) + " has " + std::to_string(size) +
+                     " entries, expected " + std::to_string(want));
+    };
+    expect_size("node value array", node_values_.size(), n);
+    expect_size("adjacency array", adjacency_.size(), n);
+    expect_size("degree array", degrees_.size(), n);
+    expect_size("edge value array", edge_values_.size(), m);
+    if(!edge_cache_.empty())
+      expect_size("edge cache", edge_cache_.size(), m);
+    if(weighted_)
+      expect_size("edge weight array", edge_weights_.size(), m);
+    if(removed_nodes_.size() > n)
+      expect_size("node tombstone array", removed_nodes_.size(), n);
+    if(removed_edges_.size() > m)
+      expect_size("edge tombstone array", removed_edges_.size(), m);
+    if(frozen_) {
+      expect_size("CSR offset array", csr_offsets_.size(), n + 1);
+      expect_size("CSR stale flag array", csr_stale_.size(), n);
+      if(csr_offsets_.size() == n + 1)
+        expect_size("CSR incidence array", csr_incidences_.size(),
+                    std::size_t(csr_offsets_[n]));
+    }
+    if(!report.ok())
+      return report;
+
+    std::unique_ptr<std::atomic<std::uint8_t>[]> listed(
+        new std::atomic<std::uint8_t>[m]);
+    std::vector<validation_report> parts(threads);
+
+    //Edge endpoints
+    csr_snapshot::parallel_ranges(threads, m, 1 << 14,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for(std::size_t k = b; k < e; ++k) {
+            listed[k].store(0, std::memory_order_relaxed);
+            const internal_edge& x = graph_edges[k];
+            if(x.source >= n || x.dest >= n || x.source == x.dest)
+              note(parts[t], "edge " + std::to_string(k) + " joins nodes " +
+                             std::to_string(x.source) + " and " +
+                             std::to_string(x.dest));
+          }
+        });
+    merge_reports(report, parts);
+
+    //Rows: order, endpoints, repeats, degrees and the frozen slices
+    csr_snapshot::parallel_ranges(threads, n, 1024,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          validation_report& r = parts[t];
+          for(std::size_t i = b; i < e; ++i) {
+            const incidence_row& row = adjacency_[i];
+            auto at = [i] {
+              return "row of node " + std::to_string(i);
+            };
+            size_type live = 0;
+            for(std::size_t j = 0; j < row.size(); ++j) {
+              const csr_incidence& x = row[j];
+              if(x.node >= n || x.edge >= m) {
+                note(r, at() + " lists neighbor " + std::to_string(x.node) +
+                        " by edge " + std::to_string(x.edge));
+                continue;
+              }
+              const internal_edge& edge = graph_edges[x.edge];
+              bool from = edge.source == i && edge.dest == x.node;
+              bool to = edge.dest == i && edge.source == x.node;
+              if(!from && !to) {
+                note(r, at() + " lists edge " + std::to_string(x.edge) +
+                        " to node " + std::to_string(x.node) +
+                        ", which does not join them");
+                continue;
+              }
+              std::uint8_t side = from ? 1 : 2;
+              if(listed[x.edge].fetch_or(side, std::memory_order_relaxed) &
+                 side)
+                note(r, at() + " lists edge " + std::to_string(x.edge) +
+                        " twice");
+              if(j > 0 && row[j - 1].node > x.node)
+                note(r, at() + " is not sorted by neighbor");
+              else if(j > 0 && row[j - 1].node == x.node &&
+                      !parallel_edges_ && i < x.node)
+                note(r, "nodes " + std::to_string(i) + " and " +
+                        std::to_string(x.node) + " share several edges");
+              live += !edge_removed(x.edge);
+            }
+            if(degrees_[i] != live)
+              note(r, at() + " has " + std::to_string(live) +
+                      " live edges, but degree " +
+                      std::to_string(degrees_[i]));
+            if(node_removed(i) && live != 0)
+              note(r, "removed node " + std::to_string(i) +
+                      " has live edges");
+            if(frozen_ && !csr_stale_[i]) {
+              std::size_t first = std::size_t(csr_offsets_[i]);
+              std::size_t last = std::size_t(csr_offsets_[i + 1]);
+              bool same = first <= last && last <= csr_incidences_.size() &&
+                          last - first == row.size();
+              for(std::size_t j = 0; same && j < row.size(); ++j)
+                same = csr_incidences_[first + j].node == row[j].node &&
+                       csr_incidences_[first + j].edge == row[j].edge;
+              if(!same)
+                note(r, "CSR slice of node " + std::to_string(i) +
+                        " differs from its row");
+            }
+          }
+        });
+    merge_reports(report, parts);
+
+    //Every edge in the rows of both endpoints, and the tombstone counts
+    std::vector<std::size_t> removed(threads, 0);
+    csr_snapshot::parallel_ranges(threads, m, 1 << 14,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          for(std::size_t k = b; k < e; ++k) {
+            std::uint8_t sides = listed[k].load(std::memory_order_relaxed);
+            if(sides != 3)
+              note(parts[t], "edge " + std::to_string(k) +
+                             " is missing from the row of its " +
+                             (sides & 1 ? "second" : "first") + " node");
+            removed[t] += edge_removed(size_type(k));
+          }
+        });
+    merge_reports(report, parts);
+    std::size_t removed_edges = 0;
+    for(std::size_t c : removed)
+      removed_edges += c;
+    std::size_t removed_nodes = std::size_t(
+        std::count(removed_nodes_.begin(), removed_nodes_.end(), true));
+    if(removed_nodes != num_removed_nodes_)
+      note(report, std::to_string(removed_nodes) + " node tombstones, but " +
+                   std::to_string(num_removed_nodes_) + " counted");
+    if(removed_edges != num_removed_edges_)
+      note(report, std::to_string(removed_edges) + " edge tombstones, but " +
+                   std::to_string(num_removed_edges_) + " counted");
+    return report;
+  }
+
+  /**
+   * @brief Zero every counter and timer returned by stats().
+   *
+   * @param none
+   *
+   * @pre Graph object exists
+   * @post Every field of stats() is 0
+   *
+   * Complexity: O(1).
+   */
+  void reset_stats() {
+    stats_.reset();
+  }
+
+  /**
+   * @brief Mark the cached length and direction of every edge stale.
+   *
+   * @param none
+   *
+   * @post Every Edge::length() and Edge::direction() is recomputed on its
+   *       next use
+   *
+   * Call this after moving nodes through positions_data(), which bypasses
+   * the tracking done by Node::position().
+   *
+   * Complexity: O(num_edges()) while the edge cache is in use, O(1)
+   * otherwise.
+   */
+  void invalidate_edge_cache() {
+    for(edge_cache_entry& c : edge_cache_)
+      c.valid = false;
+  }
+
+  //
+  // Node Iterator
+  //
+
+  /** @class Graph::NodeIterator
+   * @brief Iterator class for nodes. A forward iterator. */
+  class NodeIterator : private totally_ordered<NodeIterator>{
+   public:
+    // These type definitions let us use STL's iterator_traits.
+    using value_type        = Node;                     // Element type
+    using pointer           = Node*;                    // Pointers to elements
+    using reference         = Node;                     // Proxy, by value
+    using difference_type   = std::ptrdiff_t;           // Signed difference
+    using iterator_category = std::random_access_iterator_tag;
+
+    /**
+    * @brief Construct an invalid NodeIterator.
+    *
+    * @param none
+    * @return NodeIterator object
+    *
+    * @pre none
+    * @post NodeIterator object is created
+    **/
+    NodeIterator() {
+    }
+
+    /**
+    * @brief Operator to deference the iterator and find what node the
+    *        iterator is pointing to.
+    *
+    * @param none
+    * @return Node object corresponding to the object the iterator is
+    *         pointing to.
+    *
+    * @pre this object is initialized
+    * @post The result is the Node that the iterator is pointing to.
+    *
+    * We use the iterInd_ which mimics the index of the node to search for the
+    * correct node for our purposes.
+    **/
+    Node operator*() const {
+      return Node(graph_, iterInd_);
+    }
+
+    /**
+    * @brief Operator to increment the iterator
+    *
+    * @param none
+    * @return NodeIterator object that now has an incremented index.
+    *
+    * @pre this object is initialized
+    * @post new iterInd_ = old iterInd_ + 1
+    *
+    * We use the iterInd_ which mimics the index of the node to search for the
+    * correct node for our purposes.
+    **/
+    NodeIterator& operator++() {
+      iterInd_ = graph_->next_live_node(iterInd_ + 1);
+      return *this;
+    }
+
+    /**
+    * @brief Operator to test equality of the the NodeIterator
+    *
+    * @param[in] ni the NodeIterator object to compare this to
+    * @return True if the NodeIterator objects are the same. False otherwise.
+    *
+    * @pre this object is initialized
+    * @pre ni is a valid NodeIterator object.
+    * @post if the result is true, then this->graph_ == ni.graph_ and
+    *       this->iterInd_ == ni.iterInd_. If false, then these conditions
+    *       do not have to hold.
+    **/
+    bool operator==(const NodeIterator& ni) const {
+      if(this->graph_ == ni.graph_ && this->iterInd_ == ni.iterInd_)
+        return true;
+      else
+        return false;
+    }
+
+    /**
+    * @brief Operator to order two NodeIterators of the same graph
+    *
+    * @param[in] ni the NodeIterator object to compare this to
+    * @return True if this iterator points to an earlier node than @a ni
+    *
+    * @pre this object and @a ni iterate over the same graph
+    **/
+    bool operator<(const NodeIterator& ni) const {
+      return this->iterInd_ < ni.iterInd_;
+    }
+
+    //Like EdgeIterator, the iterator is only an index into the node arrays,
+    //so it supports the full set of random access operations. Parallel
+    //algorithms such as std::for_each(std::execution::par_unseq, ...) need
+    //this to split the node range across threads. Only ++ skips nodes
+    //removed by lazy_remove_node(); the arithmetic below counts index slots,
+    //tombstones included, so compact() before splitting the range.
+
+    /**
+    * @brief Return the node @a n positions after this one
+    *
+    * @param[in] n  Signed offset from this iterator
+    * @return The Node with index iterInd_ + @a n
+    *
+    * @pre 0 <= iterInd_ + @a n < size of the graph
+    **/
+    Node operator[](difference_type n) const {
+      return *(*this + n);
+    }
+
+    NodeIterator operator++(int) {
+      NodeIterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    NodeIterator& operator--() {
+      --iterInd_;
+      return *this;
+    }
+
+    NodeIterator operator--(int) {
+      NodeIterator tmp = *this;
+      --iterInd_;
+      return tmp;
+    }
+
+    NodeIterator& operator+=(difference_type n) {
+      iterInd_ = size_type(iterInd_ + n);
+      return *this;
+    }
+
+    NodeIterator& operator-=(difference_type n) {
+      iterInd_ = size_type(iterInd_ - n);
+      return *this;
+    }
+
+    NodeIterator operator+(difference_type n) const {
+      NodeIterator tmp = *this;
+      return tmp += n;
+    }
+
+    friend NodeIterator operator+(difference_type n, const NodeIterator& ni) {
+      return ni + n;
+    }
+
+    NodeIterator operator-(difference_type n) const {
+      NodeIterator tmp = *this;
+      return tmp -= n;
+    }
+
+    /**
+    * @brief Return the number of nodes between @a ni and this iterator
+    *
+    * @param[in] ni the NodeIterator object to measure from
+    * @return iterInd_ - @a ni.iterInd_
+    *
+    * @pre this object and @a ni iterate over the same graph
+    **/
+    difference_type operator-(const NodeIterator& ni) const {
+      return difference_type(iterInd_) - difference_type(ni.iterInd_);
+    }
+
+   private:
+    graph_type* graph_;
+    size_type iterInd_;
+
+    /**
+    * @brief Constructor for a valid NodeIterator with two arguments: the graph
+    *        and a uid
+    *
+    * @param[in] graph        Graph object that contains the node
+    * @param[in] iterInd      unsigned integer of index the iterator is
+    *                         pointing to
+    * @return                 An NodeIterator containing the initialized values
+    *
+    * @pre graph_ is not a nullptr
+    * @pre 0 <= iterInd < size of the graph
+    * @post A NodeIterator n such that n.graph_ != nullptr and
+    *       0 <= iterInd_ < size of the graph is returned.
+    **/
+    NodeIterator(const graph_type* graph, size_type iterInd)
+        : graph_(const_cast<graph_type*>(graph)), iterInd_(iterInd){
+    }
+
+    friend class Graph;
+  };
+
+  /**
+  * @brief Returns a node_iterator pointing to the first Node in the iterator.
+  *
+  * @param none
+  * @return A node_iterator object pointing to the first element
+  *
+  * @pre this object exists
+  * @post A node_iterator object is returned pointing to the first node
+  **/
+  node_iterator node_begin() const {
+    return NodeIterator(this, next_live_node(0));
+  }
+
+  /**
+  * @brief Returns a node_iterator pointing to the last Node in the iterator.
+  *
+  * @param none
+  * @return A node_iterator object pointing to the last element
+  *
+  * @pre this object exists
+  * @post A node_iterator object is returned pointing to the last node
+  **/
+  node_iterator node_end() const {
+    return NodeIterator(this, this->size());
+  }
+
+  /**
+  * @brief Return the nodes of the graph as a range.
+  *
+  * @param none
+  * @return The range node_begin()..node_end(), sized by the number of nodes
+  *         it visits, which leaves out lazily removed ones
+  *
+  * Random access, and in C++20 a borrowed std::ranges view, so it feeds
+  * std::views pipelines and std::ranges algorithms directly.
+  **/
+  node_range nodes() const {
+    return node_range(node_begin(), node_end(),
+                      std::size_t(num_nodes() - num_removed_nodes_));
+  }
+
+  //
+  // Incident Iterator
+  //
+
+  /** @class Graph::IncidentIterator
+   * @brief Iterator class for edges incident to a node. A forward iterator. */
+  class IncidentIterator : private totally_ordered<IncidentIterator>{
+   public:
+    // These type definitions let us use STL's iterator_traits.
+    using value_type        = Edge;                     // Element type
+    using pointer           = void;                     // No addressable element
+    using reference         = Edge;                     // Proxy, by value
+    using difference_type   = std::ptrdiff_t;           // Signed difference
+    using iterator_category = std::input_iterator_tag;  // Weak Category, Proxy
+    using iterator_concept  = std::forward_iterator_tag;
+
+    /**
+    * @brief Construct an invalid IncidentIterator.
+    *
+    * @param none
+    * @return IncidentIterator object
+    *
+    * @pre none
+    * @post IncidentIterator object is created
+    **/
+    IncidentIterator() {
+    }
+
+    /**
+    * @brief Operator to deference the iterator and find what node the
+    *        iterator is pointing to. Note this only returns incident edges
+    *
+    * @param none
+    * @return Edge object corresponding to the object the iterator is
+    *         pointing to.
+    *
+    * @pre this object is initialized
+    * @post The result is the Edge that the iterator is pointing to.
+    **/
+    Edge operator*() const {
+      //Every row entry stores the edge uid next to the neighbor index. The
+      //edge is oriented so that node1() is the node we iterate around, which
+      //the Edge takes as it is instead of loading the edge record.
+      return Edge(graph_, rowIter_->edge, n_);
+    }
+
+    /**
+    * @brief Operator to increment the iterator
+    *
+    * @param none
+    * @return incident_iterator object that now is pointing to the next entry
+    *         of the adjacency row
+    *
+    * @pre this object is initialized
+    * @post new rowIter_ now points to the next entry of the row
+    **/
+    incident_iterator& operator++() {
+      rowIter_ = graph_->next_live_incidence(rowIter_ + 1, rowEnd_);
+      return *this;
+    }
+    incident_iterator operator++(int) {
+      incident_iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    /**
+    * @brief Operator to test equality of the the IncidentIterator
+    *
+    * @param[in] iit the IncidentIterator object to compare this to
+    * @return True if the IncidentIterator objects are the same.
+    *         False otherwise.
+    *
+    * @pre this object is initialized
+    * @pre iit is a valid IncidentIterator object.
+    * @post if the result is true, then this->graph_ == ni.graph_ and
+    *       this->n_ == ni.n_ and this->rowIter_ == iit.rowIter_.
+    *       If false, then these conditions do not have to hold.
+    **/
+    bool operator==(const incident_iterator& iit) const {
+      if(this->graph_ == iit.graph_ && this->rowIter_ == iit.rowIter_ &&
+         this->n_ == iit.n_) {
+        return true;
+      }
+      else {
+        return false;
+      }
+    }
+
+    /** Test whether @a iit is at the end of its row. */
+    friend bool operator==(const incident_iterator& iit, incident_sentinel) {
+      return iit.rowIter_ == iit.rowEnd_;
+    }
+    friend bool operator==(incident_sentinel s, const incident_iterator& iit) {
+      return iit == s;
+    }
+    friend bool operator!=(const incident_iterator& iit, incident_sentinel s) {
+      return !(iit == s);
+    }
+    friend bool operator!=(incident_sentinel s, const incident_iterator& iit) {
+      return !(iit == s);
+    }
+
+   private:
+     //rowIter_ walks the adjacency row of the node with index n_, which is
+     //either the node's own row or, while the graph is frozen, its slice of
+     //the CSR incidence array. Both are contiguous csr_incidence arrays.
+     graph_type* graph_ = nullptr;
+     const csr_incidence* rowIter_ = nullptr;
+     const csr_incidence* rowEnd_ = nullptr;
+     size_type n_;
+
+     /**
+     * @brief Constructor for a valid IncidentIterator with three arguments:
+     *        the graph, the position in the adjacency row and the node n
+     *        that the iterator is trying to find incident edges to.
+     *
+     * @param[in] graph   Graph object that contains the node
+     * @param[in] rowIter position inside the adjacency row of @a n
+     * @param[in] rowEnd  end of the adjacency row of @a n
+     * @param[in] n       index of node we are trying to find all edges
+     *                    incident to.
+     * @return            An IncidentIterator containing the initialized values
+     *
+     * @pre graph_ is not a nullptr
+     * @pre rowIter lies within (or one past the end of) row @a n
+     * @pre 0 <= n < size of the graph
+     **/
+     IncidentIterator(const graph_type* graph, const csr_incidence* rowIter,
+                      const csr_incidence* rowEnd, size_type n)
+         : graph_(const_cast<graph_type*>(graph)), rowIter_(rowIter),
+           rowEnd_(rowEnd), n_(n){
+     }
+
+    friend class Graph;
+  };
+
+  /** @class Graph::NeighborIterator
+   * @brief Iterator over the nodes adjacent to one node, from
+   *        Node::neighbors(). A forward iterator yielding Nodes by value. */
+  class NeighborIterator {
+   public:
+    using value_type        = Node;
+    using pointer           = void;
+    using reference         = Node;                     // Proxy, by value
+    using difference_type   = std::ptrdiff_t;
+    using iterator_category = std::input_iterator_tag;
+    using iterator_concept  = std::forward_iterator_tag;
+
+    /** Construct an invalid NeighborIterator. */
+    NeighborIterator() {
+    }
+
+    Node operator*() const {
+      return Node(graph_, rowIter_->node);
+    }
+
+    NeighborIterator& operator++() {
+      rowIter_ = graph_->next_live_incidence(rowIter_ + 1, rowEnd_);
+      return *this;
+    }
+    NeighborIterator operator++(int) {
+      NeighborIterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    bool operator==(const NeighborIterator& x) const {
+      return rowIter_ == x.rowIter_;
+    }
+    bool operator!=(const NeighborIterator& x) const {
+      return !(*this == x);
+    }
+
+    /** Test whether @a x is at the end of its row. */
+    friend bool operator==(const NeighborIterator& x, incident_sentinel) {
+      return x.rowIter_ == x.rowEnd_;
+    }
+    friend bool operator==(incident_sentinel s, const NeighborIterator& x) {
+      return x == s;
+    }
+    friend bool operator!=(const NeighborIterator& x, incident_sentinel s) {
+      return !(x == s);
+    }
+    friend bool operator!=(incident_sentinel s, const NeighborIterator& x) {
+      return !(x == s);
+    }
+
+   private:
+    //Walks a row as IncidentIterator does, reading only the neighbor index
+    graph_type* graph_ = nullptr;
+    const csr_incidence* rowIter_ = nullptr;
+    const csr_incidence* rowEnd_ = nullptr;
+
+    NeighborIterator(const graph_type* graph, const csr_incidence* rowIter,
+                     const csr_incidence* rowEnd)
+        : graph_(const_cast<graph_type*>(graph)), rowIter_(rowIter),
+          rowEnd_(rowEnd) {
+    }
+
+    friend class Graph;
+  };
+
+  //
+  // Edge Iterator
+  //
+
+  /** @class Graph::EdgeIterator
+   * @brief Iterator class for edges. A forward iterator. */
+  class EdgeIterator : private totally_ordered<EdgeIterator> {
+   public:
+    // These type definitions let us use STL's iterator_traits.
+    using value_type        = Edge;                     // Element type
+    using pointer           = Edge*;                    // Pointers to elements
+    using reference         = Edge;                     // Proxy, by value
+    using difference_type   = std::ptrdiff_t;           // Signed difference
+    using iterator_category = std::random_access_iterator_tag;
+
+    /**
+    * @brief Construct an invalid EdgeIterator.
+    *
+    * @param none
+    * @return EdgeIterator object
+    *
+    * @pre none
+    * @post EdgeIterator object is created
+    **/
+    EdgeIterator() {
+    }
+
+    /**
+    * @brief Operator to deference the iterator and find what edge the
+    *        iterator is pointing to.
+    *
+    * @param none
+    * @return Edge object corresponding to the object the iterator is
+    *         pointing to.
+    *
+    * @pre this object is initialized
+    * @post The result is the Edge that the iterator is pointing to.
+    *
+    * We use the iterInd_ which mimics the index of the edge to search for the
+    * correct edge for our purposes.
+    **/
+    Edge operator*() const {
+      return Edge(graph_, iterInd_);
+    }
+
+    /**
+    * @brief Operator to increment the iterator
+    *
+    * @param none
+    * @return EdgeIterator object that now has an incremented index.
+    *
+    * @pre this object is initialized
+    * @post new iterInd_ = old iterInd_ + 1
+    *
+    * We use the iterInd_ which mimics the index of the node to search for the
+    * correct node for our purposes.
+    **/
+    EdgeIterator& operator++() {
+      iterInd_ = graph_->next_live_edge(iterInd_ + 1);
+      return *this;
+    }
+
+    /**
+    * @brief Operator to test equality of the the EdgeIterator
+    *
+    * @param[in] ni the EdgeIterator object to compare this to
+    * @return True if the EdgeIterator objects are the same. False otherwise.
+    *
+    * @pre this object is initialized
+    * @pre @a ni is a valid EdgeIterator object.
+    * @post if the result is true, then this->graph_ == ei.graph_ and
+    *       this->iterInd_ == ei.iterInd_. If false, then these conditions
+    *       do not have to hold.
+    **/
+    bool operator==(const EdgeIterator& ei) const {
+      if(this->graph_ == ei.graph_ && this->iterInd_ == ei.iterInd_) {
+        return true;
+      }
+      else {
+        return false;
+      }
+    }
+
+    /**
+    * @brief Operator to order two EdgeIterators of the same graph
+    *
+    * @param[in] ei the EdgeIterator object to compare this to
+    * @return True if this iterator points to an earlier edge than @a ei
+    *
+    * @pre this object and @a ei iterate over the same graph
+    **/
+    bool operator<(const EdgeIterator& ei) const {
+      return this->iterInd_ < ei.iterInd_;
+    }
+
+    //The iterator is only an index into graph_edges, so it supports the full
+    //set of random access operations. This is what lets edge_ranges() and
+    //parallel algorithms split an edge sweep into independent pieces. As for
+    //NodeIterator, only ++ skips tombstones.
+
+    /**
+    * @brief Return the edge @a n positions after this one
+    *
+    * @param[in] n  Signed offset from this iterator
+    * @return The Edge at index iterInd_ + @a n
+    *
+    * @pre 0 <= iterInd_ + @a n < number of edges
+    **/
+    Edge operator[](difference_type n) const {
+      return *(*this + n);
+    }
+
+    EdgeIterator operator++(int) {
+      EdgeIterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    EdgeIterator& operator--() {
+      --iterInd_;
+      return *this;
+    }
+
+    EdgeIterator operator--(int) {
+      EdgeIterator tmp = *this;
+      --iterInd_;
+      return tmp;
+    }
+
+    EdgeIterator& operator+=(difference_type n) {
+      iterInd_ = size_type(iterInd_ + n);
+      return *this;
+    }
+
+    EdgeIterator& operator-=(difference_type n) {
+      iterInd_ = size_type(iterInd_ - n);
+      return *this;
+    }
+
+    EdgeIterator operator+(difference_type n) const {
+      EdgeIterator tmp = *this;
+      return tmp += n;
+    }
+
+    friend EdgeIterator operator+(difference_type n, const EdgeIterator& ei) {
+      return ei + n;
+    }
+
+    EdgeIterator operator-(difference_type n) const {
+      EdgeIterator tmp = *this;
+      return tmp -= n;
+    }
+
+    /**
+    * @brief Return the number of edges between @a ei and this iterator
+    *
+    * @param[in] ei the EdgeIterator object to measure from
+    * @return iterInd_ - @a ei.iterInd_
+    *
+    * @pre this object and @a ei iterate over the same graph
+    **/
+    difference_type operator-(const EdgeIterator& ei) const {
+      return difference_type(iterInd_) - difference_type(ei.iterInd_);
+    }
+
+
+   private:
+     graph_type* graph_;
+     size_type iterInd_;
+
+     /**
+     * @brief Constructor for a valid EdgeIterator with two arguments: the
+     *        graph and a uid
+     *
+     * @param[in] graph        Graph object that contains the node
+     * @param[in] iterInd      unsigned integer of index the iterator is
+     *                         pointing to
+     * @return                 An EdgeIterator containing the initialized values
+     *
+     * @pre graph_ is not a nullptr
+     * @pre 0 <= iterInd < number of edges
+     * @post A EdgeIterator n such that n.graph_ != nullptr and
+     *       0 <= iterInd_ < number of edges is returned.
+     **/
+     EdgeIterator(const graph_type* graph, size_type iterInd)
+         : graph_(const_cast<graph_type*>(graph)), iterInd_(iterInd){
+     }
+
+    friend class Graph;
+  };
+
+  /**
+  * @brief Returns a edge_iterator pointing to the first Edge in the iterator.
+  *
+  * @param none
+  * @return A edge_iterator object pointing to the first element
+  *
+  * @pre this object exists
+  * @post A edge_iterator object is returned pointing to the first edge
+  **/
+  edge_iterator edge_begin() const {
+    return EdgeIterator(this, next_live_edge(0));
+  }
+
+  /**
+  * @brief Returns a edge_iterator pointing to the last Edge in the iterator.
+  *
+  * @param none
+  * @return A edge_iterator object pointing to the last element
+  *
+  * @pre this object exists
+  * @post A edge_iterator object is returned pointing to the last edge
+  **/
+  edge_iterator edge_end() const {
+    return EdgeIterator(this, num_edges());
+  }
+
+  /**
+  * @brief Return the edges of the graph as a range.
+  *
+  * @param none
+  * @return The range edge_begin()..edge_end(), sized by the number of edges
+  *         it visits, which leaves out lazily removed ones
+  *
+  * As nodes(), a random access, borrowed view in C++20.
+  **/
+  edge_range edges() const {
+    return edge_range(edge_begin(), edge_end(),
+                      std::size_t(num_edges() - num_removed_edges_));
+  }
+
+  /** Synonyms for edge_begin() and edge_end(), kept for existing callers. */
+  edge_iterator ee_edge_begin() const {
+    return edge_begin();
+  }
+  edge_iterator ee_edge_end() const {
+    return edge_end();
+  }
+
+  /**
+  * @brief Split the edges into @a k balanced, independent ranges.
+  *
+  * @param[in] k  Number of ranges, usually the number of threads
+  * @return A vector of @a k pairs [first, last) of edge_iterators
+  *
+  * @pre @a k > 0
+  * @post The ranges cover edge_begin() .. edge_end() exactly once, in
+  *       order, and their sizes differ by at most one.
+  *
+  * Each range touches a disjoint slice of graph_edges, so the ranges can be
+  * processed concurrently (for example one per OpenMP thread) as long as
+  * the graph itself is not modified.
+  * Complexity: O(k).
+  **/
+  std::vector<std::pair<edge_iterator, edge_iterator>>
+  edge_ranges(size_type k) const {
+    assert(k > 0);
+    std::vector<std::pair<edge_iterator, edge_iterator>> ranges;
+    ranges.reserve(k);
+
+    //The first num_edges() % k ranges get one extra edge
+    size_type chunk = num_edges() / k;
+    size_type extra = num_edges() % k;
+    size_type first = 0;
+    for(size_type i = 0; i < k; ++i) {
+      size_type last = first + chunk + (i < extra ? 1 : 0);
+      ranges.emplace_back(EdgeIterator(this, first), EdgeIterator(this, last));
+      first = last;
+    }
+    return ranges;
+  }
+
+  /**
+  * @brief Call f(e) on every incident edge e of @a n, oriented so that
+  *        e.node1() == @a n, in the order of the incident iterators.
+  *
+  * @param[in] n         Node whose neighbors to visit
+  * @param[in] f         Called with each incident Edge; e.node2() is the
+  *                      neighbor
+  * @param[in] distance  How many row entries ahead to prefetch
+  *
+  * @pre @a n is a live node of this graph, and @a f does not modify the
+  *      graph
+  *
+  * An incident walk that reads e.node2().position() stalls on every
+  * neighbor: its position, and the edge record that orients the edge, are
+  * dependent cache misses the hardware prefetcher cannot predict. This
+  * walk issues prefetches for both @a distance entries ahead of the one
+  * it hands to @a f, so on graphs larger than the last level cache the
+  * misses overlap. Smaller graphs gain little; a distance of 0 turns the
+  * prefetches off.
+  *
+  * Complexity: O(n.degree()).
+  **/
+  template <typename F>
+  void for_each_neighbor(const Node& n, F f,
+                         size_type distance = prefetch_distance) const {
+    size_type i = n.index();
+    const csr_incidence* row = row_data(i);
+    size_type len = row_size(i);
+    //The first entries get no look-ahead from the loop, so fetch them now;
+    //for short rows, that is the whole row
+    for(size_type k = 0; k < distance && k < len; ++k)
+      prefetch_incidence(row[k]);
+    for(size_type k = 0; k < len; ++k) {
+      if(k + distance < len)
+        prefetch_incidence(row[k + distance]);
+      if(num_removed_edges_ != 0 && edge_removed(row[k].edge))
+        continue;
+      f(Edge(this, row[k].edge, i));
+    }
+  }
+
+  /**
+  * @brief Call f(e) on every live edge e in index order, as the edge
+  *        iterators visit them.
+  *
+  * @param[in] f         Called with each Edge
+  * @param[in] distance  How many edges ahead to prefetch
+  *
+  * @pre @a f does not modify the graph
+  *
+  * The edge records are read in order, which the hardware prefetcher keeps
+  * up with, but their endpoints' positions are scattered. This sweep
+  * prefetches the positions of both endpoints @a distance edges ahead; a
+  * distance of 0 turns that off.
+  *
+  * Complexity: O(num_edges()).
+  **/
+  template <typename F>
+  void for_each_edge(F f, size_type distance = prefetch_distance) const {
+    size_type m = num_edges();
+    const internal_edge* edges = graph_edges.data();
+    for(size_type k = 0; k < m; ++k) {
+      if(distance != 0 && k + distance < m) {
+        __builtin_prefetch(node_positions_.data() + edges[k + distance].source);
+        __builtin_prefetch(node_positions_.data() + edges[k + distance].dest);
+      }
+      if(num_removed_edges_ != 0 && edge_removed(k))
+        continue;
+      f(Edge(this, k));
+    }
+  }
+
+  /**
+  * @brief Call f(n) on every live node n, with the nodes split into
+  *        contiguous index ranges across threads.
+  *
+  * @param[in] f        Called with each Node, from several threads at once
+  * @param[in] threads  Threads to split the nodes over; 0 means all cores
+  *
+  * @pre @a f may run concurrently on different nodes: it may write the
+  *      value of its own node, but must not modify the graph otherwise
+  *
+  * Runs on ThreadPool::shared(), the calling thread taking the first
+  * range. Graphs of a few thousand nodes stay on the calling thread.
+  *
+  * Complexity: O(num_nodes() / threads) calls to @a f per thread.
+  **/
+  template <typename F>
+  void for_each_node(F f, unsigned threads = 0) const {
+    csr_snapshot::parallel_ranges(csr_snapshot::thread_count(threads),
+                                  num_nodes(), 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for(size_type i = size_type(b); i < size_type(e); ++i) {
+            if(num_removed_nodes_ == 0 || !node_removed(i))
+              f(Node(this, i));
+          }
+        });
+  }
+
+  /**
+  * @brief Replace the value v of every live node by f(v).
+  *
+  * @param[in] f        Called with each node value; its result, converted
+  *                     to node_value_type, becomes the new value
+  * @param[in] threads  Threads to split the nodes over; 0 means all cores
+  *
+  * @pre @a f may run concurrently on different values
+  *
+  * A loop over the value array itself, in contiguous slices per thread:
+  * with an arithmetic value type and an inlinable @a f such as
+  * [](double) { return 0.0; } it vectorizes.
+  *
+  * Complexity: O(num_nodes() / threads) calls to @a f per thread.
+  **/
+  template <typename F>
+  void transform_values(F f, unsigned threads = 0) {
+    node_value_type* v = node_values_.data();
+    csr_snapshot::parallel_ranges(csr_snapshot::thread_count(threads),
+                                  num_nodes(), 4096,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          if(num_removed_nodes_ == 0) {
+            for(std::size_t i = b; i < e; ++i)
+              v[i] = node_value_type(f(v[i]));
+            return;
+          }
+          for(std::size_t i = b; i < e; ++i) {
+            if(!node_removed(size_type(i)))
+              v[i] = node_value_type(f(v[i]));
+          }
+        });
+  }
+
+  /**
+  * @brief Combine the values of all live nodes with @a op, starting from
+  *        @a init.
+  *
+  * @param[in] init     Initial value of the result
+  * @param[in] op       Binary operation on T, e.g. std::plus<double>()
+  * @param[in] threads  Threads to split the nodes over; 0 means all cores
+  * @return init combined with every live node value, each converted to T
+  *
+  * @pre @a op is associative and commutative, as for std::reduce(); the
+  *      grouping of the values is unspecified
+  *
+  * Each thread reduces a contiguous slice of the value array into four
+  * interleaved partial results, so that for arithmetic values the loop
+  * vectorizes without reassociating a single running sum, and the
+  * partials are combined in thread order. For floating point values the
+  * result may therefore differ by rounding from a serial loop, but is the
+  * same on every call with the same number of threads.
+  *
+  * Complexity: O(num_nodes() / threads) applications of @a op per thread.
+  **/
+  template <typename T, typename Op>
+  T reduce_values(T init, Op op, unsigned threads = 0) const {
+    threads = csr_snapshot::thread_count(threads);
+    const node_value_type* v = node_values_.data();
+    struct partial {
+      T value;
+      bool empty;
+    };
+    std::vector<partial> parts(threads, partial{init, true});
+    csr_snapshot::parallel_ranges(threads, num_nodes(), 4096,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          if(num_removed_nodes_ == 0 && e - b >= 4) {
+            T acc[4] = {T(v[b]), T(v[b + 1]), T(v[b + 2]), T(v[b + 3])};
+            std::size_t i = b + 4;
+            for(; i + 4 <= e; i += 4) {
+              for(int j = 0; j < 4; ++j)
+                acc[j] = op(acc[j], T(v[i + j]));
+            }
+            for(; i < e; ++i)
+              acc[0] = op(acc[0], T(v[i]));
+            parts[t] = partial{op(op(acc[0], acc[1]), op(acc[2], acc[3])),
+                               false};
+            return;
+          }
+          for(std::size_t i = b; i < e; ++i) {
+            if(node_removed(size_type(i)))
+              continue;
+            if(parts[t].empty)
+              parts[t] = partial{T(v[i]), false};
+            else
+              parts[t].value = op(parts[t].value, T(v[i]));
+          }
+        });
+    T result = init;
+    for(const partial& p : parts) {
+      if(!p.empty)
+        result = op(result, p.value);
+    }
+    return result;
+  }
+
+  /**
+  * @brief Write the vector from node1() to node2() of every edge in
+  *        [@a first, @a last) to @a out.
+  *
+  * @param[out] out    Receives last - first vectors
+  * @param[in]  first  Index of the first edge
+  * @param[in]  last   One past the index of the last edge
+  *
+  * @pre first <= last <= num_edges()
+  * @post For all first <= k < last, out[k - first] ==
+  *       edge(k).node2().position() - edge(k).node1().position()
+  *
+  * The batched form of n.position() - m.position(): one pass over the
+  * endpoint array and positions_data(), with no proxy, cache check or
+  * removal test per edge, so the loop is left to the compiler to
+  * vectorize, gathers included. Edges removed by lazy_remove_edge() are
+  * written like the others, as in edge_endpoints_data(). Disjoint ranges,
+  * e.g. from edge_ranges(), can be filled concurrently.
+  * Complexity: O(last - first).
+  **/
+  void edge_vectors(point_type* out, size_type first, size_type last) const {
+    assert(first <= last && last <= num_edges());
+    const internal_edge* edges = graph_edges.data();
+    const point_type* p = node_positions_.data();
+    for(size_type k = first; k < last; ++k)
+      out[k - first] = p[edges[k].dest] - p[edges[k].source];
+  }
+  /** Write the vector of every edge, num_edges() in all, to @a out. */
+  void edge_vectors(point_type* out) const {
+    edge_vectors(out, 0, num_edges());
+  }
+
+  /**
+  * @brief Write the length of every edge in [@a first, @a last) to @a out.
+  *
+  * @param[out] out    Receives last - first lengths
+  * @param[in]  first  Index of the first edge
+  * @param[in]  last   One past the index of the last edge
+  *
+  * @pre first <= last <= num_edges()
+  * @post For all first <= k < last, out[k - first] == edge(k).length(),
+  *       up to rounding to T
+  *
+  * @tparam T  Floating point type of the lengths, e.g. float for a float3
+  *            graph
+  *
+  * The coordinate differences of each block of edges are gathered into
+  * three separate arrays before the norms are taken, so the square roots
+  * run in one straight loop, which the compiler vectorizes once sqrt need
+  * not set errno (-fno-math-errno). Neither reads nor fills the cache
+  * behind Edge::length(). Removed edges and concurrency as for
+  * edge_vectors().
+  * Complexity: O(last - first).
+  **/
+  template <typename T>
+  void edge_lengths(T* out, size_type first, size_type last) const {
+    assert(first <= last && last <= num_edges());
+    using coordinate = std::decay_t<decltype(std::declval<const point_type&>().x)>;
+    const internal_edge* edges = graph_edges.data();
+    const point_type* p = node_positions_.data();
+    constexpr size_type block = 256;
+    coordinate dx[block], dy[block], dz[block];
+    for(size_type b = first; b < last; b += block) {
+      size_type len = std::min(block, size_type(last - b));
+      for(size_type k = 0; k < len; ++k) {
+        const point_type& s = p[edges[b + k].source];
+        const point_type& d = p[edges[b + k].dest];
+        dx[k] = d.x - s.x;
+        dy[k] = d.y - s.y;
+        dz[k] = d.z - s.z;
+      }
+      T* o = out + (b - first);
+      for(size_type k = 0; k < len; ++k)
+        o[k] = T(std::sqrt(dx[k] * dx[k] + dy[k] * dy[k] + dz[k] * dz[k]));
+    }
+  }
+  /** Write the length of every edge, num_edges() in all, to @a out. */
+  template <typename T>
+  void edge_lengths(T* out) const {
+    edge_lengths(out, 0, num_edges());
+  }
+
+  /**
+  * @brief Copy the positions of the neighbors of @a n to @a out.
+  *
+  * @param[in]  n    Node whose neighbors to gather
+  * @param[out] out  Receives n.degree() positions
+  * @return n.degree(), the number of positions written
+  *
+  * @pre @a n is a valid node of this graph and @a out has room for
+  *      n.degree() positions
+  * @post out[k] is the position of the k-th neighbor of @a n in the order
+  *       of the incident iterators
+  *
+  * Per-node kernels such as Laplacian smoothing read every neighbor
+  * position through an incident walk, one proxy and one dependent load at
+  * a time. Gathered into a dense scratch array first, the positions are a
+  * plain loop over the row, left to the compiler to vectorize with gathers,
+  * and the kernel's own math runs on contiguous memory. Edges removed by
+  * lazy_remove_edge() are skipped, as by the incident iterators.
+  *
+  * Complexity: O(n.degree()).
+  **/
+  size_type gather_neighbor_positions(const Node& n, point_type* out) const {
+    size_type i = n.index();
+    return gather_row_positions(row_data(i), row_size(i), out);
+  }
+
+  /**
+  * @brief Copy the neighbor positions of every node in [@a first, @a last)
+  *        to @a out, one node after the other.
+  *
+  * @param[in]  first    Index of the first node
+  * @param[in]  last     One past the index of the last node
+  * @param[out] out      Receives the neighbor positions of all the nodes
+  * @param[out] offsets  Receives last - first + 1 offsets into @a out
+  * @return The number of positions written, offsets[last - first]
+  *
+  * @pre first <= last <= num_nodes(), and @a out has room for the sum of
+  *      the degrees of the nodes, e.g. from degrees()
+  * @post For every node i in the range, out[offsets[i - first] ..
+  *       offsets[i - first + 1]) holds what gather_neighbor_positions()
+  *       writes for node(i)
+  *
+  * The batched form, for kernels that sweep a block of nodes: the offsets
+  * come from the degree array, and the rows of later nodes are prefetched
+  * while earlier ones are copied. Disjoint node ranges can be filled
+  * concurrently into separate buffers.
+  *
+  * Complexity: O(last - first + sum of their degrees).
+  **/
+  std::size_t gather_neighbor_positions(size_type first, size_type last,
+                                        point_type* out,
+                                        std::size_t* offsets) const {
+    assert(first <= last && last <= num_nodes());
+    offsets[0] = 0;
+    for(size_type i = first; i < last; ++i)
+      offsets[i - first + 1] = offsets[i - first] + degrees_[i];
+    for(size_type i = first; i < last; ++i) {
+      if(i + prefetch_distance < last)
+        prefetch_row_header(i + prefetch_distance);
+      if(i + 1 < last)
+        __builtin_prefetch(row_data(i + 1));
+      gather_row_positions(row_data(i), row_size(i), out + offsets[i - first]);
+    }
+    return offsets[last - first];
+  }
+
+  /**
+  * @brief Color the edges so that edges of one color share no node.
+  *
+  * @param[in] threads  Threads to color with; 0 means all cores
+  * @return The edge indices grouped by color
+  *
+  * @post Every edge index appears in exactly one color, and the two edges
+  *       of any pair in one color have four distinct endpoints
+  *
+  * A loop over the edges that writes to both endpoints of each edge, such
+  * as accumulating spring forces into node values, can run the edges of
+  * one color in parallel with plain stores:
+  *
+  *   const auto& classes = g.edge_coloring();
+  *   for(size_type c = 0; c < classes.colors(); ++c)
+  *     //parallel for k in classes.offsets[c] .. classes.offsets[c + 1]
+  *     //  scatter(g.edge(classes.edges[k]))
+  *
+  * The coloring is greedy and speculative: each thread gives its share of
+  * the edges, in index order, the smallest color free among their
+  * neighbors, then edges that ended up with the color of a lower-indexed
+  * neighbor colored concurrently are redone, usually only a few. This uses
+  * at most 2 * max degree - 1 colors. With one thread it is the sequential
+  * greedy coloring in index order; with more the colors may differ.
+  *
+  * The result is cached until the next add_edge() or add_edges() that adds
+  * an edge, clear() or reorder(); permute_nodes() keeps it. The first call
+  * after a change fills the cache, so it must not race with other calls.
+  *
+  * Complexity: O(sum of d^2 over the node degrees d) for a fresh coloring,
+  * spread over the threads, and O(1) when cached.
+  **/
+  const edge_color_classes& edge_coloring(unsigned threads = 0) const {
+    if(!coloring_valid_) {
+      color_edges(csr_snapshot::thread_count(threads));
+      coloring_valid_ = true;
+    }
+    return coloring_;
+  }
+
+  /**
+  * @brief Color the nodes so that no two adjacent nodes share a color.
+  *
+  * @param[in] threads  Threads to color with; 0 means all cores
+  * @return The node indices grouped by color
+  *
+  * @post Every node index not removed by lazy_remove_node() appears in
+  *       exactly one color, and no edge joins two nodes of one color
+  *
+  * A Gauss-Seidel or SOR sweep, which updates each node from its
+  * neighbors' latest values, can run the nodes of one color in parallel
+  * and the colors one after another:
+  *
+  *   const auto& classes = g.node_coloring();
+  *   for(size_type c = 0; c < classes.colors(); ++c)
+  *     //parallel for k in classes.offsets[c] .. classes.offsets[c + 1]
+  *     //  relax(g.node(classes.nodes[k]))
+  *
+  * Speculative greedy like edge_coloring(): each thread gives its share of
+  * the nodes the smallest color free among their neighbors, and nodes that
+  * clash with a lower-indexed neighbor are redone. This uses at most
+  * max degree + 1 colors, and with one thread it is the sequential greedy
+  * coloring in index order.
+  *
+  * The result is cached for the current topology_version(), so any added
+  * or removed node or edge and any renumbering recolors on the next call,
+  * while moving nodes or writing values keeps it. The first call after a
+  * change fills the cache, so it must not race with other calls.
+  *
+  * Complexity: O(num_nodes() + sum of the degrees) for a fresh coloring,
+  * spread over the threads, and O(1) when cached.
+  **/
+  const node_color_classes& node_coloring(unsigned threads = 0) const {
+    if(node_coloring_version_ != topology_version_) {
+      color_nodes(csr_snapshot::thread_count(threads));
+      node_coloring_version_ = topology_version_;
+    }
+    return node_coloring_;
+  }
+
+
+ private:
+  //internal_node is the view of one node that fetch_node() hands back.
+  //Positions and values live in separate arrays (structure of arrays), so it
+  //holds references into both rather than the data itself.
+  struct internal_node {
+    point_type& node_pt;
+    node_value_type& val;
+  };
+
+  //internal_edge is the internal struct that we will use to store the edges
+  //It contains the Node index of the first node and the index of the
+  //second node names source and dest respectively.
+  struct internal_edge {
+    size_type source;
+    size_type dest;
+  };
+
+  //Resource made by the page_options or file_options constructor, if any.
+  //Declared before the containers so that it outlives them.
+  std::shared_ptr<std::pmr::memory_resource> owned_resource_;
+
+  /** Construct an empty graph that allocates from, and keeps alive,
+   *  @a resource. */
+  explicit Graph(std::shared_ptr<std::pmr::memory_resource> resource)
+      : Graph(resource.get()) {
+    owned_resource_ = std::move(resource);
+  }
+
+  //Internal STL container that we will use to store the actual nodes
+  //and edges.
+  //Node data is stored as a structure of arrays: node_positions_[i] and
+  //node_values_[i] belong to node i. Kernels that only touch positions then
+  //stream a dense array of Points without dragging the values through cache.
+  std::pmr::vector<point_type> node_positions_;
+  std::pmr::vector<node_value_type> node_values_;
+  //Front buffer of enable_double_buffering(): the positions and values as
+  //of the last swap_buffers(), read by other threads while the arrays above
+  //are written. Empty unless double_buffered_.
+  std::pmr::vector<point_type> front_positions_;
+  std::pmr::vector<node_value_type> front_values_;
+  bool double_buffered_ = false;
+  std::uint64_t buffer_generation_ = 0;
+  //Slots of enable_position_history(), each a copy of node_positions_ made
+  //by record_positions(). history_[history_head_] is the newest of the
+  //history_depth_ recorded steps, and older ones precede it, cyclically.
+  std::pmr::vector<std::pmr::vector<point_type>> history_;
+  unsigned history_head_ = 0;
+  unsigned history_depth_ = 0;
+  std::pmr::vector<internal_edge> graph_edges;
+  //edge_values_[i] is the value of edge i, kept beside graph_edges so that
+  //per-edge loops stream one dense array
+  std::pmr::vector<edge_value_type> edge_values_;
+
+  //Cached geometry of one edge, oriented from source to dest
+  struct edge_cache_entry {
+    point_type unit;
+    double length;
+    bool valid;
+  };
+
+  //Lazily allocated cache behind Edge::length() and Edge::direction().
+  //Empty until the first call, so graphs that never ask pay nothing; after
+  //that it has one entry per edge and is mutable because it is filled in by
+  //const accessors.
+  mutable std::pmr::vector<edge_cache_entry> edge_cache_;
+
+  //Default look-ahead of for_each_neighbor() and for_each_edge(), in
+  //entries: far enough to cover a memory access at one entry per few
+  //nanoseconds, near enough that the lines are still cached when used
+  static constexpr size_type prefetch_distance = 8;
+
+  //Average degree hint from reserve(), used to pre-size new adjacency rows
+  size_type expected_degree_ = 0;
+
+  //One entry of an adjacency row (per-node or frozen CSR): the neighbor
+  //across the edge and the uid of the edge itself in graph_edges.
+  struct csr_incidence {
+    size_type node;
+    size_type edge;
+  };
+
+  //Projection for searching a sorted row by neighbor index
+  struct csr_neighbor {
+    size_type operator()(const csr_incidence& x) const {
+      return x.node;
+    }
+  };
+
+  //Ordering of row entries by neighbor index
+  static bool by_neighbor(const csr_incidence& x, const csr_incidence& y) {
+    return x.node < y.node;
+  }
+
+  //Ordering of row entries by neighbor index, then by edge among parallel
+  //edges: the order add_edge() keeps
+  static bool by_neighbor_and_edge(const csr_incidence& x,
+                                   const csr_incidence& y) {
+    return x.node < y.node || (x.node == y.node && x.edge < y.edge);
+  }
+
+  //Adjacency rows. adjacency_[i] holds one entry per edge incident to node
+  //i, sorted by neighbor index, so has_edge() is a search of a short
+  //contiguous array and incident iteration walks it in order. Each edge
+  //costs two 8 byte entries here instead of two hash map nodes.
+  //Being a pmr container, it hands its resource on to every row.
+  using incidence_row = std::pmr::vector<csr_incidence>;
+  std::pmr::vector<incidence_row> adjacency_;
+
+  //degrees_[i] is the number of live edges in adjacency_[i], which is all
+  //of them unless some were tombstoned, kept as one dense array so that
+  //degrees() can hand out all of them at once
+  std::pmr::vector<size_type> degrees_;
+
+  //Tombstones left by lazy_remove_node() and lazy_remove_edge(). A flag
+  //vector is empty until the first lazy removal and may be shorter than the
+  //node or edge arrays: slots past its end are live. The counts let the
+  //iterators skip the checks entirely while there are no tombstones.
+  std::pmr::vector<bool> removed_nodes_;
+  std::pmr::vector<bool> removed_edges_;
+  size_type num_removed_nodes_ = 0;
+  size_type num_removed_edges_ = 0;
+  double compaction_threshold_ = 0.25;
+
+  //Generation of every node and edge slot, behind stable_handle(). A slot
+  //is retired when its element is removed, tombstoned or replaced by a
+  //renumbering, which invalidates the handles made before.
+  GenerationTable<size_type> node_generations_;
+  GenerationTable<size_type> edge_generations_;
+
+  //Set by set_allow_parallel_edges(): add_edge() and add_edges() append
+  //without searching or deduplicating
+  bool parallel_edges_ = false;
+
+  //Set between begin_bulk_load() and end_bulk_load(): add_edge() appends
+  //without searching, and rows take new entries at their end, leaving
+  //rows_sorted_ false until sort_rows() restores the order by neighbor.
+  //Mutable because the first lookup sorts them, const or not.
+  bool bulk_load_ = false;
+  mutable bool rows_sorted_ = true;
+
+  //Set between begin_concurrent_reads() and end_concurrent_reads(): reads
+  //through the proxies then write nothing, not even to the caches above
+  bool concurrent_reads_ = false;
+
+  //What changed since the last clear_changes(), for viewers that mirror
+  //positions_data() and edge_endpoints_data()
+  DirtyRange<size_type> position_changes_;
+  DirtyRange<size_type> edge_changes_;
+
+  //Arrays handed out by make_node_property() and make_edge_property().
+  //Mutable so that const algorithms can make their own scratch arrays.
+  mutable PropertyRegistry<size_type> node_properties_;
+  mutable PropertyRegistry<size_type> edge_properties_;
+
+  //Running bounds behind bounding_box(): per axis the smallest and largest
+  //coordinate and the coordinate sum of every position. Extended by each
+  //added node; once a tracked write or a removal may have shrunk them,
+  //bounds_valid_ is false and the next bounding_box() recomputes them.
+  mutable double bounds_lo_[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL};
+  mutable double bounds_hi_[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+  mutable double bounds_sum_[3] = {0, 0, 0};
+  mutable bool bounds_valid_ = true;
+
+  //Cache behind edge_coloring(), filled in by the const accessor
+  mutable edge_color_classes coloring_;
+  mutable bool coloring_valid_ = false;
+
+  //Cache behind node_coloring(), valid while node_coloring_version_ equals
+  //topology_version_; versions start at 1, so 0 means never filled
+  mutable node_color_classes node_coloring_;
+  mutable std::uint64_t node_coloring_version_ = 0;
+
+  //Tiles of the last tile_edges(), valid while edge_tiles_version_ equals
+  //topology_version_
+  edge_tile_layout edge_tiles_;
+  std::uint64_t edge_tiles_version_ = 0;
+
+  //Hash grid behind find_or_add_node(): cells of side weld_tolerance_,
+  //hashed into weld_heads_, each slot the head of a chain of nodes through
+  //weld_next_. Cells that share a slot share its chain, which only costs
+  //distance checks. Valid while weld_version_ equals topology_version_.
+  std::vector<size_type> weld_heads_;
+  std::vector<size_type> weld_next_;
+  double weld_tolerance_ = 0;
+  std::uint64_t weld_version_ = 0;
+
+  //Behind topology_version(), renewed by topology_changed()
+  std::uint64_t topology_version_ = next_topology_version();
+
+  //Operation counters behind stats(). Mutable so that const operations such
+  //as has_edge() can be counted too.
+  using stats_type = stats_recorder<CME212_GRAPH_STATS>;
+  mutable stats_type stats_;
+
+  //How the proxies index the node and edge arrays: checked only when built
+  //with CME212_CHECKED_ACCESS
+  using access_type = element_access<CME212_CHECKED_ACCESS != 0>;
+
+  //Type of CSR row offsets. Offsets count incidences, two per edge, so
+  //narrow indices get 32-bit offsets; otherwise they match the index width.
+  using offset_type = std::conditional_t<(sizeof(Index) < sizeof(std::uint32_t)),
+                                         std::uint32_t, Index>;
+
+  //Frozen compressed sparse row adjacency. Row i spans
+  //csr_incidences_[csr_offsets_[i] .. csr_offsets_[i + 1]). Only valid while
+  //frozen_ is true; the adjacency_ rows stay the source of truth.
+  bool frozen_ = false;
+  std::pmr::vector<offset_type> csr_offsets_;
+  std::pmr::vector<csr_incidence> csr_incidences_;
+
+  //Rows changed by add_edge() and add_edges() since the CSR arrays were
+  //built. While frozen, row i is read from adjacency_[i] instead of its CSR
+  //slice if csr_stale_[i] is set, and the CSR arrays are rebuilt once more
+  //than csr_merge_threshold_ * num_nodes() rows are stale.
+  std::pmr::vector<std::uint8_t> csr_stale_;
+  size_type csr_stale_rows_ = 0;
+  double csr_merge_threshold_ = 0.125;
+
+  //Weights of enable_weights(). edge_weights_[k] is the weight of edge k
+  //and stays empty while weighted_ is false. csr_weights_ repeats them in
+  //the order of csr_incidences_ for weights_view(), which rebuilds it on
+  //demand once a topology change, a freeze() or set_weight() has made it
+  //stale; it is mutable because that happens in a const accessor.
+  bool weighted_ = false;
+  std::pmr::vector<float> edge_weights_;
+  mutable std::pmr::vector<float> csr_weights_;
+  mutable bool csr_weights_valid_ = false;
+
+  //The neighbors of csr_incidences_ without their edge indices, for
+  //columns_view(), rebuilt on demand after a topology change or freeze()
+  mutable std::pmr::vector<size_type> csr_columns_;
+  mutable bool csr_columns_valid_ = false;
+
+  /** Make @a to, which is empty, a copy of @a from, @a threads slices at a
+   *  time. */
+  template <typename T>
+  static void clone_array(const std::pmr::vector<T>& from,
+                          std::pmr::vector<T>& to, unsigned threads) {
+    if(threads == 1) {
+      to.assign(from.begin(), from.end());
+      return;
+    }
+    to.resize(from.size());
+    csr_snapshot::parallel_ranges(threads, from.size(), 1 << 14,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          if constexpr(std::is_trivially_copyable<T>::value) {
+            if(b != e)
+              std::memcpy(to.data() + b, from.data() + b, (e - b) * sizeof(T));
+          } else {
+            std::copy(from.begin() + b, from.begin() + e, to.begin() + b);
+          }
+        });
+  }
+
+  /** Return the history slot recorded @a steps_back steps ago. */
+  const std::pmr::vector<point_type>& history_slot(unsigned steps_back) const {
+    assert(steps_back < history_depth_);
+    unsigned k = unsigned(history_.size());
+    return history_[(history_head_ + k - steps_back) % k];
+  }
+
+  /** Return a snapshot header filled in with this graph's element sizes. */
+  static graph_snapshot::header snapshot_header() {
+    graph_snapshot::header h = {};
+    graph_snapshot::set_magic(h);
+    h.version = graph_snapshot::version;
+    h.index_size = sizeof(size_type);
+    h.offset_size = sizeof(offset_type);
+    h.point_size = sizeof(point_type);
+    h.value_size = sizeof(node_value_type);
+    h.edge_value_size = sizeof(edge_value_type);
+    return h;
+  }
+
+  /** Write a tombstone flag vector as one byte per flag. */
+  static void write_flags(std::ostream& out, const std::pmr::vector<bool>& flags) {
+    std::vector<std::uint8_t> bytes(flags.begin(), flags.end());
+    graph_snapshot::write_block(out, bytes.data(), bytes.size());
+  }
+
+  /** Read @a count flags written by write_flags() into @a flags. */
+  static void read_flags(std::istream& in, std::pmr::vector<bool>& flags,
+                         std::size_t count) {
+    std::vector<std::uint8_t> bytes(count);
+    graph_snapshot::read_block(in, bytes.data(), count);
+    flags.assign(bytes.begin(), bytes.end());
+  }
+
+  /** Return the first entry of the adjacency row of node @a i, which is its
+   *  CSR slice while frozen. */
+  const csr_incidence* row_data(size_type i) const {
+    if(frozen_ && !csr_stale_[i])
+      return csr_incidences_.data() + csr_offsets_[i];
+    return adjacency_[i].data();
+  }
+
+  /** Start loading the neighbor position and edge record of @a x. */
+  /** Prefetch what row_data(@a i) and row_size(@a i) read first. */
+  void prefetch_row_header(size_type i) const {
+    if(frozen_)
+      __builtin_prefetch(csr_offsets_.data() + i);
+    else
+      __builtin_prefetch(adjacency_.data() + i);
+  }
+  void prefetch_incidence(const csr_incidence& x) const {
+    __builtin_prefetch(node_positions_.data() + x.node);
+    __builtin_prefetch(graph_edges.data() + x.edge);
+  }
+
+  /** Return the length of the adjacency row of node @a i, i.e. its degree. */
+  size_type row_size(size_type i) const {
+    if(frozen_ && !csr_stale_[i])
+      return size_type(csr_offsets_[i + 1] - csr_offsets_[i]);
+    return size_type(adjacency_[i].size());
+  }
+
+  /** Return the entry for neighbor @a b in the row of @a a, or nullptr. */
+  const csr_incidence* find_incidence(size_type a, size_type b) const {
+    sort_rows();
+    const csr_incidence* row = row_data(a);
+    size_type len = row_size(a);
+    const csr_incidence* it = branchless_lower_bound(row, len, b,
+                                                     csr_neighbor());
+    if(it != row + len && it->node == b)
+      return it;
+    return nullptr;
+  }
+
+  /** Return the up to date cache entry of edge @a i, allocating the cache
+   *  or recomputing the entry as needed. */
+  const edge_cache_entry& cached_edge(size_type i) const {
+    if(edge_cache_.size() != graph_edges.size())
+      edge_cache_.resize(graph_edges.size(), edge_cache_entry{point_type(), 0, false});
+    edge_cache_entry& c = edge_cache_[i];
+    if(!c.valid) {
+      point_type d = node_positions_[graph_edges[i].dest] -
+                node_positions_[graph_edges[i].source];
+      c.length = norm(d);
+      c.unit = (c.length > 0) ? d / c.length : point_type();
+      c.valid = true;
+    }
+    return c;
+  }
+
+  /** Return the geometry of edge @a i: its cache entry or, during
+   *  concurrent reads, a fresh one when the cache has none. */
+  edge_cache_entry edge_geometry(size_type i) const {
+    if(concurrent_reads_ && (edge_cache_.size() != graph_edges.size() ||
+                             !edge_cache_[i].valid)) {
+      point_type d = node_positions_[graph_edges[i].dest] -
+                node_positions_[graph_edges[i].source];
+      double length = norm(d);
+      return edge_cache_entry{(length > 0) ? d / length : point_type(),
+                              length, true};
+    }
+    return cached_edge(i);
+  }
+
+  /** Return the position of node @a n for writing, after marking @a n in
+   *  changed_positions() and the cache entries of its incident edges
+   *  stale. */
+  point_type& moved_position(size_type n) {
+    invalidate_incident_edges(n);
+    position_changes_.mark(n);
+    bounds_valid_ = false;
+    return access_type::get(node_positions_, n);
+  }
+
+  /** Mark the cache entries of the edges incident to node @a n stale. */
+  void invalidate_incident_edges(size_type n) {
+    if(edge_cache_.empty())
+      return;
+    const csr_incidence* row = row_data(n);
+    for(size_type k = 0, len = row_size(n); k < len; ++k) {
+      if(row[k].edge < edge_cache_.size())
+        edge_cache_[row[k].edge].valid = false;
+    }
+  }
+
+  /** Append the edge from node @a a to node @a b and insert it into both
+   *  rows, without looking for it first. Return its index. */
+  size_type append_edge(size_type a, size_type b,
+                        const edge_value_type& value) {
+    topology_changed();
+    //Add the edge by initializing a new internal_edge, setting the source
+    //and dest values and appending it to our graph_edges vector. In
+    //addition, make sure we add it to both endpoint rows for ease of search
+    //in the future
+
+    coloring_valid_ = false;
+
+    internal_edge new_edge;
+    new_edge.source = a;
+    new_edge.dest = b;
+    size_type old_capacity = graph_edges.capacity();
+    graph_edges.push_back(new_edge);
+    edge_values_.push_back(value);
+    if(weighted_)
+      edge_weights_.push_back(1.0f);
+    stats_.capacity_change(old_capacity, graph_edges.capacity());
+
+    size_type new_index = graph_edges.size() - 1;
+    edge_changes_.mark(new_index);
+    std::size_t row_a = adjacency_[a].capacity();
+    std::size_t row_b = adjacency_[b].capacity();
+    if(bulk_load_) {
+      adjacency_[a].push_back(csr_incidence{b, new_index});
+      adjacency_[b].push_back(csr_incidence{a, new_index});
+      rows_sorted_ = false;
+    } else {
+      sort_rows();
+      insert_sorted(adjacency_[a], csr_incidence{b, new_index});
+      insert_sorted(adjacency_[b], csr_incidence{a, new_index});
+    }
+    //Rows regrow often and cheaply, so they are counted but do not mark the
+    //call in growth_latency
+    stats_.add(&graph_stats::row_reallocations,
+               (row_a != adjacency_[a].capacity()) +
+               (row_b != adjacency_[b].capacity()));
+    ++degrees_[a];
+    ++degrees_[b];
+    edge_properties_.resize(num_edges());
+    //A frozen graph serves the two changed rows from adjacency_ until the
+    //CSR arrays are merged
+    mark_row_stale(a);
+    mark_row_stale(b);
+    merge_stale_rows();
+    return new_index;
+  }
+
+  /** Sort the rows that a bulk load appended to by neighbor, and by edge
+   *  among parallel edges, the order add_edge() keeps. Const because the
+   *  rows hold the same entries either way; see begin_bulk_load(). */
+  void sort_rows(unsigned threads = 0) const {
+    if(rows_sorted_)
+      return;
+    CME212_TRACE_SCOPE("sort_rows");
+    auto& rows = const_cast<std::pmr::vector<incidence_row>&>(adjacency_);
+    csr_snapshot::parallel_ranges(csr_snapshot::thread_count(threads),
+                                  rows.size(), 1024,
+        [&](unsigned, std::size_t b, std::size_t e) {
+          for(std::size_t i = b; i < e; ++i)
+            std::sort(rows[i].begin(), rows[i].end(), by_neighbor_and_edge);
+        });
+    rows_sorted_ = true;
+  }
+
+  /** Copy the neighbor positions of the @a len entries of @a row, skipping
+   *  removed edges, to @a out. Return the number copied. */
+  size_type gather_row_positions(const csr_incidence* row, size_type len,
+                                 point_type* out) const {
+    const point_type* p = node_positions_.data();
+    if(num_removed_edges_ == 0) {
+      for(size_type k = 0; k < len; ++k)
+        out[k] = p[row[k].node];
+      return len;
+    }
+    size_type count = 0;
+    for(size_type k = 0; k < len; ++k) {
+      if(!edge_removed(row[k].edge))
+        out[count++] = p[row[k].node];
+    }
+    return count;
+  }
+
+  /** Set map[i], for i < @a n, to the number of kept indices before i if
+   *  keep(i), and to size_type(-1) otherwise; return the number kept. Each
+   *  thread counts its share of the indices, then numbers it from the
+   *  total of the shares before it. */
+  template <typename Keep>
+  static size_type renumber(unsigned threads, size_type n,
+                            std::vector<size_type>& map, Keep keep) {
+    std::vector<size_type> counts(threads + 1, 0);
+    csr_snapshot::parallel_ranges(threads, n, 1 << 14,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          size_type c = 0;
+          for(std::size_t i = b; i < e; ++i)
+            c += bool(keep(size_type(i)));
+          counts[t + 1] = c;
+        });
+    for(unsigned t = 0; t < threads; ++t)
+      counts[t + 1] += counts[t];
+    csr_snapshot::parallel_ranges(threads, n, 1 << 14,
+        [&](unsigned t, std::size_t b, std::size_t e) {
+          size_type next = counts[t];
+          for(std::size_t i = b; i < e; ++i)
+            map[i] = keep(size_type(i)) ? next++ : size_type(-1);
+        });
+    return counts[threads];
+  }
+
+  /** Insert @a x into the sorted @a row, keeping it sorted by neighbor. */
+  static void insert_sorted(incidence_row& row, const csr_incidence& x) {
+    row.insert(std::upper_bound(row.begin(), row.end(), x, by_neighbor), x);
+  }
+
+  /** Return the entry of edge @a k, whose neighbor is @a b, in the row of
+   *  @a a. Parallel edges share a neighbor, so the edge index decides. */
+  typename incidence_row::iterator incidence_of(size_type a, size_type b,
+                                                size_type k) {
+    sort_rows();
+    incidence_row& row = adjacency_[a];
+    auto it = std::lower_bound(row.begin(), row.end(), csr_incidence{b, 0},
+                               by_neighbor);
+    while(it != row.end() && it->node == b && it->edge != k)
+      ++it;
+    assert(it != row.end() && it->node == b);
+    return it;
+  }
+
+  /** Erase the incidence of edge @a k, to neighbor @a b, from the row of
+   *  @a a. */
+  void erase_incidence(size_type a, size_type b, size_type k) {
+    adjacency_[a].erase(incidence_of(a, b, k));
+  }
+
+  /** Return the hash grid slot of the cell that holds @a p, or of the
+   *  cell offset from it by (@a dx, @a dy, @a dz) cells. With tolerance 0
+   *  a cell is one exact position. */
+  std::size_t weld_slot(const point_type& p, int dx = 0, int dy = 0,
+                        int dz = 0) const {
+    const double x[3] = {double(p.x), double(p.y), double(p.z)};
+    const int d[3] = {dx, dy, dz};
+    std::uint64_t h = 0;
+    for(int a = 0; a < 3; ++a) {
+      std::uint64_t c;
+      if(weld_tolerance_ > 0) {
+        c = std::uint64_t(std::int64_t(std::floor(x[a] / weld_tolerance_)) +
+                          d[a]);
+      } else {
+        double v = x[a] + 0.0;            //-0.0 hashes as 0.0
+        std::memcpy(&c, &v, sizeof(c));
+      }
+      h = (h ^ c) * 0x9E3779B97F4A7C15ull;
+      h ^= h >> 29;
+    }
+    return std::size_t(h) & (weld_heads_.size() - 1);
+  }
+
+  /** Call @a fn(j) on every node j in a grid slot a node within the grid's
+   *  tolerance of @a p could be in. Nodes may come up more than once and
+   *  may be farther away; callers check the distance. */
+  template <typename Fn>
+  void for_each_weld_candidate(const point_type& p, Fn fn) const {
+    const size_type none = size_type(-1);
+    int reach = weld_tolerance_ > 0 ? 1 : 0;
+    std::size_t seen[27];
+    int slots = 0;
+    for(int dx = -reach; dx <= reach; ++dx) {
+      for(int dy = -reach; dy <= reach; ++dy) {
+        for(int dz = -reach; dz <= reach; ++dz) {
+          std::size_t h = weld_slot(p, dx, dy, dz);
+          if(std::find(seen, seen + slots, h) != seen + slots)
+            continue;
+          seen[slots++] = h;
+          for(size_type j = weld_heads_[h]; j != none; j = weld_next_[j])
+            fn(j);
+        }
+      }
+    }
+  }
+
+  /** Distance between two positions, as compared with a weld tolerance. */
+  static double weld_distance(const point_type& a, const point_type& b) {
+    double dx = double(a.x) - double(b.x);
+    double dy = double(a.y) - double(b.y);
+    double dz = double(a.z) - double(b.z);
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+  }
+
+  /** Rebuild the hash grid of find_or_add_node() over every live node, with
+   *  cells @a tolerance wide and at least two slots per node. */
+  void build_weld_grid(double tolerance) {
+    weld_tolerance_ = tolerance;
+    std::size_t slots = 64;
+    while(slots < 2 * std::size_t(num_nodes()))
+      slots *= 2;
+    weld_heads_.assign(slots, size_type(-1));
+    weld_next_.assign(num_nodes(), size_type(-1));
+    for(size_type i = 0; i < num_nodes(); ++i) {
+      if(!node_removed(i))
+        weld_insert(i);
+    }
+    weld_version_ = topology_version_;
+  }
+
+  /** Put node @a i into its hash grid slot. */
+  void weld_insert(size_type i) {
+    if(weld_next_.size() <= i)
+      weld_next_.resize(std::size_t(i) + 1, size_type(-1));
+    std::size_t h = weld_slot(node_positions_[i]);
+    weld_next_[i] = weld_heads_[h];
+    weld_heads_[h] = i;
+  }
+
+  /** Record one broken invariant in @a r, keeping its description if
+   *  there is still room. */
+  static void note(validation_report& r, std::string message) {
+    if(r.messages.size() < validation_report::max_messages)
+      r.messages.push_back(std::move(message));
+    ++r.errors;
+  }
+
+  /** Move the findings of the per-thread reports @a parts into @a r, in
+   *  thread order, and empty them. */
+  static void merge_reports(validation_report& r,
+                            std::vector<validation_report>& parts) {
+    for(validation_report& p : parts) {
+      r.errors += p.errors;
+      for(std::string& message : p.messages) {
+        if(r.messages.size() < validation_report::max_messages)
+          r.messages.push_back(std::move(message));
+      }
+      p = validation_report();
+    }
+  }
+
+  /** Return true if node slot @a i holds a tombstone. */
+  bool node_removed(size_type i) const {
+    return i < removed_nodes_.size() && removed_nodes_[i];
+  }
+  /** Return true if edge slot @a k holds a tombstone. */
+  bool edge_removed(size_type k) const {
+    return k < removed_edges_.size() && removed_edges_[k];
+  }
+
+  /** Return the first node slot at or after @a i that is not a tombstone,
+   *  or num_nodes(). */
+  size_type next_live_node(size_type i) const {
+    if(num_removed_nodes_ != 0) {
+      while(node_removed(i))
+        ++i;
+    }
+    return i;
+  }
+  /** Return the first edge slot at or after @a k that is not a tombstone,
+   *  or num_edges(). */
+  size_type next_live_edge(size_type k) const {
+    if(num_removed_edges_ != 0) {
+      while(edge_removed(k))
+        ++k;
+    }
+    return k;
+  }
+  /** Return the first row entry in [@a p, @a end) whose edge is not a
+   *  tombstone, or @a end. */
+  const csr_incidence* next_live_incidence(const csr_incidence* p,
+                                           const csr_incidence* end) const {
+    if(num_removed_edges_ != 0) {
+      while(p != end && edge_removed(p->edge))
+        ++p;
+    }
+    return p;
+  }
+
+  /** Give the graph a new topology_version(). */
+  void topology_changed() {
+    topology_version_ = next_topology_version();
+    csr_weights_valid_ = false;
+    csr_columns_valid_ = false;
+  }
+
+  /** Mark edge @a k removed and take it off its endpoints' degrees. */
+  void tombstone_edge(size_type k) {
+    if(removed_edges_.size() < num_edges())
+      removed_edges_.resize(num_edges(), false);
+    removed_edges_[k] = true;
+    ++num_removed_edges_;
+    edge_generations_.retire(k);
+    edge_changes_.mark(k);
+    topology_changed();
+    --degrees_[graph_edges[k].source];
+    --degrees_[graph_edges[k].dest];
+  }
+  /** Undo tombstone_edge(@a k). */
+  void revive_edge(size_type k) {
+    removed_edges_[k] = false;
+    --num_removed_edges_;
+    edge_changes_.mark(k);
+    topology_changed();
+    ++degrees_[graph_edges[k].source];
+    ++degrees_[graph_edges[k].dest];
+  }
+
+  /** Return true if the tombstones exceed compaction_threshold(). */
+  bool needs_compaction() const {
+    return double(num_removed_nodes_) > compaction_threshold_ * double(num_nodes()) ||
+           double(num_removed_edges_) > compaction_threshold_ * double(num_edges());
+  }
+
+  /** Apply new[k] = old[old_index[k]] for k < @a n to a tombstone vector,
+   *  which stays empty if it is. */
+  static void gather_flags(std::pmr::vector<bool>& flags,
+                           const size_type* old_index, size_type n) {
+    if(flags.empty())
+      return;
+    std::pmr::vector<bool> out(n, false, flags.get_allocator());
+    for(size_type k = 0; k < n; ++k)
+      out[k] = old_index[k] < flags.size() && flags[old_index[k]];
+    flags.swap(out);
+  }
+
+  /** Point the incidence of edge @a old, to neighbor @a b, in the row of
+   *  @a a at edge @a k. */
+  void renumber_incidence(size_type a, size_type b, size_type old,
+                          size_type k) {
+    incidence_of(a, b, old)->edge = k;
+  }
+
+  /**
+   * @brief Remove edge @a k by moving the last edge into its place.
+   *
+   * The rows of both endpoints lose their incidence of the edge, and the
+   * two incidences of the moved edge are renumbered. Edge values, the
+   * cached geometry and the edge properties move along.
+   **/
+  template <typename EdgeMoved>
+  void erase_edge(size_type k, EdgeMoved& edge_moved) {
+    thaw();
+    coloring_valid_ = false;
+    topology_changed();
+    size_type last = num_edges() - 1;
+    internal_edge gone = graph_edges[k];
+    erase_incidence(gone.source, gone.dest, k);
+    erase_incidence(gone.dest, gone.source, k);
+    //A tombstone is no longer counted in the degrees
+    if(edge_removed(k)) {
+      --num_removed_edges_;
+    } else {
+      --degrees_[gone.source];
+      --degrees_[gone.dest];
+    }
+    if(k != last) {
+      internal_edge moved = graph_edges[last];
+      renumber_incidence(moved.source, moved.dest, last, k);
+      renumber_incidence(moved.dest, moved.source, last, k);
+      graph_edges[k] = moved;
+      edge_changes_.mark(k);
+      edge_values_[k] = std::move(edge_values_[last]);
+      if(weighted_)
+        edge_weights_[k] = edge_weights_[last];
+      //The cache may be shorter than graph_edges; a moved edge with no
+      //entry leaves a stale one behind
+      if(k < edge_cache_.size()) {
+        if(last < edge_cache_.size())
+          edge_cache_[k] = edge_cache_[last];
+        else
+          edge_cache_[k].valid = false;
       }
+      if(k < removed_edges_.size())
+        removed_edges_[k] = edge_removed(last);
     }
+    graph_edges.pop_back();
+    edge_values_.pop_back();
+    if(weighted_)
+      edge_weights_.pop_back();
+    if(removed_edges_.size() > graph_edges.size())
+      removed_edges_.pop_back();
+    if(edge_cache_.size() > graph_edges.size())
+      edge_cache_.resize(graph_edges.size());
+    edge_properties_.swap_remove(k);
+    edge_generations_.swap_remove(k, last + 1);
+    if(k != last)
+      edge_moved(last, k);
+  }
 
-    /**
-    * @brief Operator to increment the iterator
-    *
-    * @param none
-    * @return incident_iterator object that now is pointing to the next object
-    *         in the map iterator
-    *
-    * @pre this object is initialized
-    * @post new mapIter_ now points to the next map in the iterator
-    **/
-    incident_iterator& operator++() {
-      mapIter_++;
-      return *this;
+  /** Return the number of entries sorted_contains() compares in a row of
+   *  length @a len. */
+  static size_type search_probes(size_type len) {
+    if(len <= sorted_search_linear_cutoff)
+      return len;
+    size_type steps = 1;
+    while(len > 1) {
+      len -= len / 2;
+      ++steps;
     }
+    return steps;
+  }
 
-    /**
-    * @brief Operator to test equality of the the IncidentIterator
-    *
-    * @param[in] iit the IncidentIterator object to compare this to
-    * @return True if the IncidentIterator objects are the same.
-    *         False otherwise.
-    *
-    * @pre this object is initialized
-    * @pre iit is a valid IncidentIterator object.
-    * @post if the result is true, then this->graph_ == ni.graph_ and
-    *       this->n_ == ni.n_ and this->mapIter_ == iit.mapIter_.
-    *       If false, then these conditions do not have to hold.
-    **/
-    bool operator==(const incident_iterator& iit) const {
-      if(this->graph_ == iit.graph_ && this->mapIter_ == iit.mapIter_ &&
-         this->n_ == iit.n_) {
-        return true;
+  /** Return the index of an endpoint given either as a Node or an index. */
+  static size_type endpoint_index(const Node& n) {
+    return n.index();
+  }
+  static size_type endpoint_index(size_type i) {
+    return i;
+  }
+
+  //Canonical sort key of an undirected edge, ordered by (min, max) node
+  //index. Indices of up to 32 bits are packed into one 64-bit integer so
+  //that they can be radix sorted; wider indices use a pair.
+  static constexpr bool packed_keys = sizeof(size_type) <= sizeof(std::uint32_t);
+  using edge_key = std::conditional_t<packed_keys, std::uint64_t,
+                                      std::pair<size_type, size_type>>;
+
+  static edge_key make_key(size_type a, size_type b) {
+    if(b < a)
+      std::swap(a, b);
+    if constexpr (packed_keys)
+      return (std::uint64_t(a) << 32) | b;
+    else
+      return edge_key(a, b);
+  }
+  static size_type key_source(const edge_key& key) {
+    if constexpr (packed_keys)
+      return size_type(key >> 32);
+    else
+      return key.first;
+  }
+  static size_type key_dest(const edge_key& key) {
+    if constexpr (packed_keys)
+      return size_type(key & 0xFFFFFFFFu);
+    else
+      return key.second;
+  }
+
+  //Depth of a node that a search has not reached yet
+  static constexpr size_type npos = size_type(-1);
+
+  /**
+   * @brief Breadth first search from @a root over the incident iterators.
+   *
+   * @param[in]     root   Node to start from
+   * @param[in,out] depth  Per node depth, all npos on entry for the nodes
+   *                       of @a root's component
+   * @param[out]    queue  The nodes of the component, in visiting order
+   * @return The depth of the last node reached, i.e. the eccentricity of
+   *         @a root
+   **/
+  size_type bfs_depths(size_type root, std::vector<size_type>& depth,
+                       std::vector<size_type>& queue) const {
+    queue.clear();
+    queue.push_back(root);
+    depth[root] = 0;
+    for(std::size_t head = 0; head < queue.size(); ++head) {
+      Node u = node(queue[head]);
+      for(const Edge& e : u.incident_edges()) {
+        size_type v = e.node2().index();
+        if(depth[v] == npos) {
+          depth[v] = depth[u.index()] + 1;
+          queue.push_back(v);
+        }
       }
-      else {
-        return false;
+    }
+    return depth[queue.back()];
+  }
+
+  /**
+   * @brief Return the reverse Cuthill-McKee order of the nodes.
+   *
+   * @return The old node indices listed in their new order
+   *
+   * Components are taken in order of their minimum degree node. Each is
+   * started from a pseudo-peripheral node found with the George-Liu
+   * search: repeatedly jump to the lowest degree node of the deepest BFS
+   * level for as long as that makes the BFS deeper.
+   **/
+  std::vector<std::size_t> rcm_sequence() const {
+    size_type n = num_nodes();
+    std::vector<size_type> by_degree(n);
+    for(size_type i = 0; i < n; ++i)
+      by_degree[i] = i;
+    std::stable_sort(by_degree.begin(), by_degree.end(),
+                     [this](size_type a, size_type b) {
+                       return degrees_[a] < degrees_[b];
+                     });
+    auto lower_degree = [this](size_type a, size_type b) {
+      return degrees_[a] < degrees_[b] ||
+             (degrees_[a] == degrees_[b] && a < b);
+    };
+
+    std::vector<std::size_t> sequence;
+    sequence.reserve(n);
+    std::vector<bool> numbered(n, false);
+    std::vector<size_type> depth(n, npos);
+    std::vector<size_type> queue;
+    std::vector<size_type> fresh;
+    for(size_type start : by_degree) {
+      if(numbered[start])
+        continue;
+
+      //George-Liu pseudo-peripheral node search
+      size_type root = start;
+      size_type ecc = bfs_depths(root, depth, queue);
+      while(true) {
+        size_type best = queue.back();
+        for(auto it = queue.rbegin(); it != queue.rend() && depth[*it] == ecc;
+            ++it) {
+          if(lower_degree(*it, best))
+            best = *it;
+        }
+        for(size_type v : queue)
+          depth[v] = npos;
+        size_type best_ecc = bfs_depths(best, depth, queue);
+        if(best_ecc <= ecc)
+          break;
+        root = best;
+        ecc = best_ecc;
+      }
+      for(size_type v : queue)
+        depth[v] = npos;
+
+      //Cuthill-McKee: breadth first, neighbors by increasing degree
+      std::size_t head = sequence.size();
+      sequence.push_back(root);
+      numbered[root] = true;
+      for(; head < sequence.size(); ++head) {
+        Node u = node(size_type(sequence[head]));
+        fresh.clear();
+        for(const Edge& e : u.incident_edges()) {
+          size_type v = e.node2().index();
+          if(!numbered[v]) {
+            numbered[v] = true;
+            fresh.push_back(v);
+          }
+        }
+        std::sort(fresh.begin(), fresh.end(), lower_degree);
+        sequence.insert(sequence.end(), fresh.begin(), fresh.end());
       }
     }
 
-   private:
-     //Note that for this object, we are iterating over maps instead of simple
-     //size_type indices. This is so that we can search for the index through
-     //iterating over the map. mapIter_ is an iterator over the maps and n_ is
-     //the index of the node we are tryiing to find all edges incident to.
-     graph_type* graph_;
-     hash_map::iterator mapIter_;
-     size_type n_;
+    std::reverse(sequence.begin(), sequence.end());
+    return sequence;
+  }
 
-     /**
-     * @brief Constructor for a valid NodeIterator with three arguments: the
-     *        graph and the map iterator and the node n that the iterator
-     *        is trying to find incident edges to.
-     *
-     * @param[in] graph   Graph object that contains the node
-     * @param[in] mapIter map iterator that will iterator over map objects
-     * @param[in] n       index of node we are trying to find all edges
-     *                    incident to.
-     * @return            An IncidentIterator containing the initialized values
-     *
-     * @pre graph_ is not a nullptr
-     * @pre mapIter is a valid iterator and has been initialized.
-     * @pre 0 <= n < size of the graph
-     * @post A IncidentIterator iit such that iit.graph_ != nullptr and
-     *       0 <= n_ < size of the graph is returned and mapIter is a valid
-     *       iterator.
-     **/
-     IncidentIterator(const graph_type* graph, hash_map::iterator mapIter,
-                      size_type n)
-         : graph_(const_cast<graph_type*>(graph)), mapIter_(mapIter), n_(n){
-     }
-    friend class Graph;
-  };
+  /**
+   * @brief Renumber the edges in increasing order of their canonical key.
+   *
+   * Moves edge values and cached geometry with their edges and rewrites
+   * the edge uids in every adjacency row, which keeps the rows sorted since
+   * they are ordered by neighbor.
+   **/
+  void sort_edges() {
+    size_type m = num_edges();
+    std::vector<size_type> order(m);
+    for(size_type k = 0; k < m; ++k)
+      order[k] = k;
+    std::sort(order.begin(), order.end(), [this](size_type i, size_type j) {
+      return make_key(graph_edges[i].source, graph_edges[i].dest) <
+             make_key(graph_edges[j].source, graph_edges[j].dest);
+    });
+    permute_edges(order);
+  }
 
-  //
-  // Edge Iterator
-  //
+  /**
+   * @brief Renumber the edges so that new edge k is old edge order[k].
+   *
+   * The work behind sort_edges() and tile_edges(): moves edge values,
+   * weights and cached geometry with their edges and rewrites the edge
+   * uids in every adjacency row.
+   **/
+  void permute_edges(const std::vector<size_type>& order) {
+    size_type m = num_edges();
+    assert(order.size() == m);
+    std::pmr::memory_resource* resource = get_memory_resource();
+    std::pmr::vector<internal_edge> edges(resource);
+    std::pmr::vector<edge_value_type> values(resource);
+    std::pmr::vector<edge_cache_entry> cache(resource);
+    edges.reserve(m);
+    values.reserve(m);
+    //A cache that predates the newest edges is simply dropped; it refills
+    //on demand
+    bool keep_cache = (edge_cache_.size() == m);
+    if(keep_cache)
+      cache.reserve(m);
+    std::vector<size_type> new_uid(m);
+    for(size_type k = 0; k < m; ++k) {
+      new_uid[order[k]] = k;
+      edges.push_back(graph_edges[order[k]]);
+      values.push_back(std::move(edge_values_[order[k]]));
+      if(keep_cache)
+        cache.push_back(edge_cache_[order[k]]);
+    }
+    if(weighted_) {
+      std::pmr::vector<float> weights(m, resource);
+      for(size_type k = 0; k < m; ++k)
+        weights[k] = edge_weights_[order[k]];
+      edge_weights_.swap(weights);
+    }
+    for(incidence_row& row : adjacency_) {
+      for(csr_incidence& x : row)
+        x.edge = new_uid[x.edge];
+    }
+    for(csr_incidence& x : csr_incidences_)
+      x.edge = new_uid[x.edge];
 
-  /** @class Graph::EdgeIterator
-   * @brief Iterator class for edges. A forward iterator. */
-  class EdgeIterator : private totally_ordered<EdgeIterator> {
-   public:
-    // These type definitions let us use STL's iterator_traits.
-    using value_type        = Edge;                     // Element type
-    using pointer           = Edge*;                    // Pointers to elements
-    using reference         = Edge&;                    // Reference to elements
-    using difference_type   = std::ptrdiff_t;           // Signed difference
-    using iterator_category = std::input_iterator_tag;  // Weak Category, Proxy
+    graph_edges.swap(edges);
+    edge_values_.swap(values);
+    edge_cache_.swap(cache);
+    gather_flags(removed_edges_, order.data(), m);
+    edge_properties_.gather(order.data(), m);
+    edge_generations_.gather(order.data(), m, m);
+    edge_changes_.mark(0, m);
+    coloring_valid_ = false;
+    topology_changed();
+  }
 
-    /**
-    * @brief Construct an invalid EdgeIterator.
-    *
-    * @param none
-    * @return EdgeIterator object
-    *
-    * @pre none
-    * @post EdgeIterator object is created
-    **/
-    EdgeIterator() {
+  /**
+   * @brief Call @a f on the uid of every edge that shares a node with
+   * edge @a e.
+   **/
+  template <typename F>
+  void for_each_adjacent_edge(size_type e, F f) const {
+    for(size_type end : {graph_edges[e].source, graph_edges[e].dest}) {
+      const csr_incidence* row = row_data(end);
+      size_type len = row_size(end);
+      for(size_type k = 0; k < len; ++k) {
+        if(row[k].edge != e)
+          f(row[k].edge);
+      }
     }
+  }
 
-    /**
-    * @brief Operator to deference the iterator and find what edge the
-    *        iterator is pointing to.
-    *
-    * @param none
-    * @return Edge object corresponding to the object the iterator is
-    *         pointing to.
-    *
-    * @pre this object is initialized
-    * @post The result is the Edge that the iterator is pointing to.
-    *
-    * We use the iterInd_ which mimics the index of the edge to search for the
-    * correct edge for our purposes.
-    **/
-    Edge operator*() const {
-      return Edge(graph_, iterInd_, true);
+  /**
+   * @brief Fill coloring_ with a greedy coloring of the edges on
+   * @a threads threads, as described at edge_coloring().
+   **/
+  void color_edges(unsigned threads) const {
+    size_type m = num_edges();
+    //Colors are read while other threads write them, hence atomics; relaxed
+    //loads and stores compile to plain moves
+    std::vector<std::atomic<size_type>> color(m);
+    std::vector<size_type> pending(m);
+    for(size_type e = 0; e < m; ++e) {
+      color[e].store(npos, std::memory_order_relaxed);
+      pending[e] = e;
     }
+    auto color_of = [&color](size_type e) {
+      return color[e].load(std::memory_order_relaxed);
+    };
+    std::vector<char> clash;
 
-    /**
-    * @brief Operator to increment the iterator
-    *
-    * @param none
-    * @return EdgeIterator object that now has an incremented index.
-    *
-    * @pre this object is initialized
-    * @post new iterInd_ = old iterInd_ + 1
-    *
-    * We use the iterInd_ which mimics the index of the node to search for the
-    * correct node for our purposes.
-    **/
-    EdgeIterator& operator++() {
-      ++iterInd_;
-      return *this;
+    while(!pending.empty()) {
+      //Give every pending edge the smallest color its neighbors lack
+      csr_snapshot::parallel_ranges(threads, pending.size(), 256,
+          [&](unsigned, std::size_t b, std::size_t end) {
+            std::vector<char> taken;
+            for(std::size_t k = b; k < end; ++k) {
+              size_type e = pending[k];
+              //An edge has fewer neighbors than this, so a color below it
+              //is always free
+              size_type bound = degrees_[graph_edges[e].source] +
+                                degrees_[graph_edges[e].dest];
+              taken.assign(bound, 0);
+              for_each_adjacent_edge(e, [&](size_type f) {
+                size_type c = color_of(f);
+                if(c < bound)
+                  taken[c] = 1;
+              });
+              size_type c = 0;
+              while(taken[c])
+                ++c;
+              color[e].store(c, std::memory_order_relaxed);
+            }
+          });
+
+      //Neighbors colored at the same time on different threads may have
+      //picked the same color; the higher index of each such pair tries again
+      if(threads == 1)
+        break;
+      clash.assign(pending.size(), 0);
+      csr_snapshot::parallel_ranges(threads, pending.size(), 256,
+          [&](unsigned, std::size_t b, std::size_t end) {
+            for(std::size_t k = b; k < end; ++k) {
+              size_type e = pending[k];
+              size_type c = color_of(e);
+              for_each_adjacent_edge(e, [&](size_type f) {
+                if(f < e && color_of(f) == c)
+                  clash[k] = 1;
+              });
+            }
+          });
+
+      std::size_t left = 0;
+      for(std::size_t k = 0; k < pending.size(); ++k) {
+        if(clash[k])
+          pending[left++] = pending[k];
+      }
+      pending.resize(left);
+      for(size_type e : pending)
+        color[e].store(npos, std::memory_order_relaxed);
     }
 
-    /**
-    * @brief Operator to test equality of the the EdgeIterator
-    *
-    * @param[in] ni the EdgeIterator object to compare this to
-    * @return True if the EdgeIterator objects are the same. False otherwise.
-    *
-    * @pre this object is initialized
-    * @pre @a ni is a valid EdgeIterator object.
-    * @post if the result is true, then this->graph_ == ei.graph_ and
-    *       this->iterInd_ == ei.iterInd_. If false, then these conditions
-    *       do not have to hold.
-    **/
-    bool operator==(const EdgeIterator& ei) const {
-      if(this->graph_ == ei.graph_ && this->iterInd_ == ei.iterInd_) {
-        return true;
+    //Counting sort of the edges by color keeps each color in index order
+    size_type colors = 0;
+    for(size_type e = 0; e < m; ++e)
+      colors = std::max(colors, size_type(color_of(e) + 1));
+    coloring_.offsets.assign(std::size_t(colors) + 1, 0);
+    for(size_type e = 0; e < m; ++e)
+      ++coloring_.offsets[color_of(e) + 1];
+    for(size_type c = 0; c < colors; ++c)
+      coloring_.offsets[c + 1] += coloring_.offsets[c];
+    coloring_.edges.resize(m);
+    std::vector<std::size_t> fill(coloring_.offsets.begin(),
+                                  coloring_.offsets.end() - 1);
+    for(size_type e = 0; e < m; ++e)
+      coloring_.edges[fill[color_of(e)]++] = e;
+  }
+
+  /**
+   * @brief Fill node_coloring_ with a greedy coloring of the live nodes on
+   * @a threads threads, as described at node_coloring().
+   **/
+  void color_nodes(unsigned threads) const {
+    size_type n = num_nodes();
+    std::vector<std::atomic<size_type>> color(n);
+    std::vector<size_type> pending;
+    pending.reserve(n);
+    for(size_type i = 0; i < n; ++i) {
+      color[i].store(npos, std::memory_order_relaxed);
+      if(!node_removed(i))
+        pending.push_back(i);
+    }
+    auto color_of = [&color](size_type i) {
+      return color[i].load(std::memory_order_relaxed);
+    };
+    std::vector<char> clash;
+
+    while(!pending.empty()) {
+      csr_snapshot::parallel_ranges(threads, pending.size(), 256,
+          [&](unsigned, std::size_t b, std::size_t end) {
+            std::vector<char> taken;
+            for(std::size_t k = b; k < end; ++k) {
+              size_type i = pending[k];
+              //A node has at most this many neighbors, so a color up to it
+              //is always free
+              const incidence_row& row = adjacency_[i];
+              size_type bound = size_type(row.size() + 1);
+              taken.assign(bound, 0);
+              for(const csr_incidence& x : row) {
+                size_type c = color_of(x.node);
+                if(c < bound)
+                  taken[c] = 1;
+              }
+              size_type c = 0;
+              while(taken[c])
+                ++c;
+              color[i].store(c, std::memory_order_relaxed);
+            }
+          });
+
+      if(threads == 1)
+        break;
+      clash.assign(pending.size(), 0);
+      csr_snapshot::parallel_ranges(threads, pending.size(), 256,
+          [&](unsigned, std::size_t b, std::size_t end) {
+            for(std::size_t k = b; k < end; ++k) {
+              size_type i = pending[k];
+              size_type c = color_of(i);
+              for(const csr_incidence& x : adjacency_[i]) {
+                if(x.node < i && color_of(x.node) == c)
+                  clash[k] = 1;
+              }
+            }
+          });
+
+      std::size_t left = 0;
+      for(std::size_t k = 0; k < pending.size(); ++k) {
+        if(clash[k])
+          pending[left++] = pending[k];
       }
-      else {
-        return false;
+      pending.resize(left);
+      for(size_type i : pending)
+        color[i].store(npos, std::memory_order_relaxed);
+    }
+
+    size_type colors = 0;
+    std::size_t live = 0;
+    for(size_type i = 0; i < n; ++i) {
+      if(color_of(i) != npos) {
+        colors = std::max(colors, size_type(color_of(i) + 1));
+        ++live;
       }
     }
+    node_coloring_.offsets.assign(std::size_t(colors) + 1, 0);
+    for(size_type i = 0; i < n; ++i) {
+      if(color_of(i) != npos)
+        ++node_coloring_.offsets[color_of(i) + 1];
+    }
+    for(size_type c = 0; c < colors; ++c)
+      node_coloring_.offsets[c + 1] += node_coloring_.offsets[c];
+    node_coloring_.nodes.resize(live);
+    std::vector<std::size_t> fill(node_coloring_.offsets.begin(),
+                                  node_coloring_.offsets.end() - 1);
+    for(size_type i = 0; i < n; ++i) {
+      if(color_of(i) != npos)
+        node_coloring_.nodes[fill[color_of(i)]++] = i;
+    }
+  }
 
+  /** Sort edge keys ascending: radix sort when packed, std::sort otherwise. */
+  static void sort_keys(std::vector<edge_key>& keys) {
+    if constexpr (packed_keys)
+      radix_sort(keys);
+    else
+      std::sort(keys.begin(), keys.end());
+  }
 
-   private:
-     graph_type* graph_;
-     size_type iterInd_;
+  /**
+   * @brief Sort packed edge keys with an LSD radix sort on 16-bit digits.
+   *
+   * @param[in,out] keys  The keys to sort in ascending order
+   *
+   * Passes over a digit that is the same for every key are skipped, so
+   * graphs with fewer than 65536 nodes only pay for two of the four passes.
+   *
+   * Complexity: O(keys.size()) per pass.
+   **/
+  static void radix_sort(std::vector<std::uint64_t>& keys) {
+    std::vector<std::uint64_t> buffer(keys.size());
+    std::vector<std::size_t> count(1 << 16);
+    for(unsigned shift = 0; shift < 64; shift += 16) {
+      std::fill(count.begin(), count.end(), 0);
+      for(std::uint64_t key : keys)
+        ++count[(key >> shift) & 0xFFFF];
+      if(keys.empty() || count[(keys[0] >> shift) & 0xFFFF] == keys.size())
+        continue;
 
-     /**
-     * @brief Constructor for a valid EdgeIterator with two arguments: the
-     *        graph and a uid
-     *
-     * @param[in] graph        Graph object that contains the node
-     * @param[in] iterInd      unsigned integer of index the iterator is
-     *                         pointing to
-     * @return                 An EdgeIterator containing the initialized values
-     *
-     * @pre graph_ is not a nullptr
-     * @pre 0 <= iterInd < number of edges
-     * @post A EdgeIterator n such that n.graph_ != nullptr and
-     *       0 <= iterInd_ < number of edges is returned.
-     **/
-     EdgeIterator(const graph_type* graph, size_type iterInd)
-         : graph_(const_cast<graph_type*>(graph)), iterInd_(iterInd){
-     }
+      std::size_t sum = 0;
+      for(std::size_t& c : count) {
+        std::size_t digit_count = c;
+        c = sum;
+        sum += digit_count;
+      }
+      for(std::uint64_t key : keys)
+        buffer[count[(key >> shift) & 0xFFFF]++] = key;
+      keys.swap(buffer);
+    }
+  }
 
-    friend class Graph;
-  };
+  /**
+   * @brief Drop the CSR arrays and return to the mutable adjacency rows.
+   *
+   * @post is_frozen() == false
+   **/
+  void thaw() {
+    if(!frozen_)
+      return;
+    frozen_ = false;
+    csr_offsets_.clear();
+    csr_incidences_.clear();
+    csr_stale_.clear();
+    csr_stale_rows_ = 0;
+  }
 
   /**
-  * @brief Returns a edge_iterator pointing to the first Edge in the iterator.
-  *
-  * @param none
-  * @return A edge_iterator object pointing to the first element
-  *
-  * @pre this object exists
-  * @post A edge_iterator object is returned pointing to the first edge
-  **/
-  edge_iterator ee_edge_begin() const {
-    return EdgeIterator(this, 0);
+   * @brief Serve the row of node @a i from adjacency_ until the next merge,
+   *        if the graph is frozen.
+   **/
+  void mark_row_stale(size_type i) {
+    if(frozen_ && !csr_stale_[i]) {
+      csr_stale_[i] = 1;
+      ++csr_stale_rows_;
+    }
   }
 
   /**
-  * @brief Returns a edge_iterator pointing to the last Edge in the iterator.
-  *
-  * @param none
-  * @return A edge_iterator object pointing to the last element
-  *
-  * @pre this object exists
-  * @post A edge_iterator object is returned pointing to the last edge
-  **/
-  edge_iterator ee_edge_end() const {
-    return EdgeIterator(this, num_edges());
+   * @brief Rebuild the CSR arrays if more rows are stale than
+   *        csr_merge_threshold() allows.
+   **/
+  void merge_stale_rows() {
+    if(frozen_ && csr_stale_rows_ > csr_merge_threshold_ * num_nodes()) {
+      stats_.count(&graph_stats::csr_merges);
+      freeze();
+    }
   }
 
+  /**
+   * @brief Grow the node arrays and adjacency_ once for a batch of nodes.
+   *
+   * Only forward iterators can be measured without consuming them; single
+   * pass ranges fall back to amortized growth.
+   **/
+  template <typename It>
+  void reserve_node_batch(It first, It last) {
+    using category = typename std::iterator_traits<It>::iterator_category;
+    if constexpr (std::is_base_of<std::forward_iterator_tag, category>::value) {
+      size_type total = num_nodes() + size_type(std::distance(first, last));
+      node_positions_.reserve(total);
+      node_values_.reserve(total);
+      adjacency_.reserve(total);
+      degrees_.reserve(total);
+    }
+  }
 
- private:
-  //internal_node is the internal struct that we will use to store the nodes
-  //It contains simply a Point object to store the positions we will be using.
-  struct internal_node {
-    Point node_pt;
-    node_value_type val;
-  };
+  //Empty running bounds
+  static void reset_bounds(double* lo, double* hi, double* sum) {
+    for(int a = 0; a < 3; ++a) {
+      lo[a] = HUGE_VAL;
+      hi[a] = -HUGE_VAL;
+      sum[a] = 0;
+    }
+  }
 
-  //internal_edge is the internal struct that we will use to store the edges
-  //It contains the Node index of the first node and the index of the
-  //second node names source and dest respectively.
-  struct internal_edge {
-    size_type source;
-    size_type dest;
-  };
+  //Grow running bounds by one position
+  static void extend_bounds(double* lo, double* hi, double* sum,
+                            const point_type& p) {
+    const double x[3] = {double(p.x), double(p.y), double(p.z)};
+    for(int a = 0; a < 3; ++a) {
+      lo[a] = std::min(lo[a], x[a]);
+      hi[a] = std::max(hi[a], x[a]);
+      sum[a] += x[a];
+    }
+  }
 
-  //Internal STL container that we will use to store the actual nodes
-  //and edges.
-  std::vector<internal_node> graph_nodes;
-  std::vector<internal_edge> graph_edges;
+  //bounding_box() from valid running bounds
+  node_bounds make_bounds() const {
+    node_bounds r;
+    r.count = num_nodes();
+    if(r.count == 0)
+      return r;
+    r.min = point_type(bounds_lo_[0], bounds_lo_[1], bounds_lo_[2]);
+    r.max = point_type(bounds_hi_[0], bounds_hi_[1], bounds_hi_[2]);
+    r.centroid = point_type(bounds_sum_[0] / r.count,
+                            bounds_sum_[1] / r.count,
+                            bounds_sum_[2] / r.count);
+    return r;
+  }
 
-  //The nested maps to make edge search faster. Acts as a sort of adjacency
-  //matrix that is unordered.
-  std::unordered_map<size_type, hash_map> edge_search;
+  /**
+   * @brief Do the per-node bookkeeping of add_node() for every node from
+   * @a first_index on, once their positions and values are stored.
+   *
+   * Every node gets its own empty adjacency row, with room for the degree
+   * hint from reserve(). A new node has no incident edges, so a
+   * frozen graph only needs empty CSR rows appended to stay valid.
+   **/
+  void finish_node_batch(size_type first_index) {
+    stats_.add(&graph_stats::add_node, num_nodes() - first_index);
+    position_changes_.mark(first_index, num_nodes());
+    topology_changed();
+    if(bounds_valid_) {
+      for(size_type i = first_index; i < num_nodes(); ++i)
+        extend_bounds(bounds_lo_, bounds_hi_, bounds_sum_, node_positions_[i]);
+    }
+    adjacency_.resize(num_nodes());
+    degrees_.resize(num_nodes(), 0);
+    if(expected_degree_ != 0) {
+      for(size_type i = first_index; i < num_nodes(); ++i)
+        adjacency_[i].reserve(expected_degree_);
+    }
+    if(frozen_) {
+      csr_offsets_.resize(num_nodes() + 1, csr_offsets_.back());
+      csr_stale_.resize(num_nodes(), 0);
+    }
+    node_properties_.resize(num_nodes());
+  }
 };
 
 #endif
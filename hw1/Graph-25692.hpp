@@ -11,6 +11,7 @@
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
+#include "common/row_view.hpp"
 
 
 /** @class Graph
@@ -68,6 +69,20 @@ class Graph {
       Graph::num_edges(), and argument type of Graph::node(size_type) */
   using size_type = unsigned;
 
+  /** Maps an edge index from a node's edge_map_ row to the neighbor across
+   *  that edge. Used by Node::neighbors(). */
+  struct neighbor_of {
+    const Graph* graph;
+    size_type uid;
+    Node operator()(size_type edge_idx) const {
+      const std::vector<size_type>& ends = graph->edges_[edge_idx];
+      return Node(graph, ends[0] == uid ? ends[1] : ends[0]);
+    }
+  };
+
+  /** Zero-copy range of a node's neighbors, see Node::neighbors(). */
+  using neighbor_range = RowView<size_type, neighbor_of>;
+
   //
   // CONSTRUCTORS AND DESTRUCTOR
   //
@@ -167,6 +182,19 @@ class Graph {
       return IncidentIterator(graph_,uid_,degree());
     }
 
+    /** Return the neighbors of the node as a zero-copy range.
+     *  @post the range has degree() elements, in the same order as
+     *        edge_begin()..edge_end()
+     *
+     *  The range reads edge_map_ in place, so no row is copied. It is
+     *  invalidated by add_edge() on this node.
+     */
+    neighbor_range neighbors() const{
+      const std::vector<size_type>& row = graph_->edge_map_.at(uid_);
+      return neighbor_range(row.data(),row.data()+row.size(),
+                            neighbor_of{graph_,uid_});
+    }
+
     /** Test whether this node and @a n are equal.
      *
      * Equal nodes have the same graph and the same index.
@@ -356,7 +384,7 @@ class Graph {
   bool has_edge(const Node& a, const Node& b) const {
     // HW0: YOUR CODE HERE
     if (has_node(a) && has_node(b)){
-      std::vector<size_type> temp = edge_map_.at(a.index());
+      const std::vector<size_type>& temp = edge_map_.at(a.index());
       for (size_type i=0; i<temp.size();i++){
         if (((edge(temp[i]).node1()==a) &&(edge(temp[i]).node2()==b)) ||
           ((edge(temp[i]).node1()==b) &&(edge(temp[i]).node2()==a))){
@@ -386,7 +414,7 @@ class Graph {
     if (!(a==b) && has_node(a) && has_node(b)){ 
       // check if edge ab exists    
       // read the index of edge with node a
-      std::vector<size_type> temp = edge_map_.at(a.index());
+      const std::vector<size_type>& temp = edge_map_.at(a.index());
       for (size_type i=0; i<temp.size();i++){
         if (((edge(temp[i]).node1()==a) &&(edge(temp[i]).node2()==b)) ||
             ((edge(temp[i]).node1()==b) &&(edge(temp[i]).node2()==a))){
@@ -11,6 +11,7 @@
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
+#include "common/row_view.hpp"
 
 template <typename V>
 /** @class Graph
@@ -61,6 +62,16 @@ class Graph {
 		Graph::num_edges(), and argument type of Graph::node(size_type) */
 	using size_type = unsigned;
 
+	/** Maps a neighbor index from an adjacency row to its Node */
+	struct node_at {
+		const Graph* m_graph_ptr;
+		Node operator()(size_type node_index) const {
+			return Node(m_graph_ptr, node_index);
+		}
+	};
+	/** Zero-copy range of a node's neighbors, see Node::neighbors() */
+	using neighbor_range = RowView<size_type, node_at>;
+
 	//
 	// CONSTRUCTORS AND DESTRUCTOR
 	//
@@ -125,6 +136,14 @@ class Graph {
 		incident_iterator edge_end() const {
 			return IncidentIterator(m_graph_ptr, m_node_index, (m_graph_ptr->m_adjacency)[m_node_index].size());
 		}
+		/** Return the neighbors of this node as a zero-copy range over its
+		 *  adjacency row, in the same order as edge_begin()..edge_end().
+		 *  Invalidated by add_edge() on this node.
+		 */
+		neighbor_range neighbors() const {
+			const std::vector<size_type>& row = (m_graph_ptr->m_adjacency)[m_node_index];
+			return neighbor_range(row.data(), row.data() + row.size(), node_at{m_graph_ptr});
+		}
 		/** Test whether this node and @a n are equal.
 		 *
 		 * Equal nodes have the same graph and the same index.
@@ -307,7 +326,7 @@ class Graph {
 		if (a.m_graph_ptr!=this || b.m_graph_ptr!=this) {
 			return false;
  		}
- 		std::vector<size_type> tmp = m_adjacency[a.index()];
+ 		const std::vector<size_type>& tmp = m_adjacency[a.index()];
  		size_type index = b.index();
  		for (unsigned i=0; i<tmp.size(); i++) {
 	 		if (tmp[i]==index) {
@@ -330,7 +349,7 @@ class Graph {
 	 */
 	Edge add_edge(const Node& a, const Node& b) {
 		if (a.m_graph_ptr==this && b.m_graph_ptr==this) {
- 			std::vector<size_type> tmp = m_adjacency[a.index()];
+ 			const std::vector<size_type>& tmp = m_adjacency[a.index()];
  			size_type index = b.index();
  			for (unsigned i=0; i<tmp.size(); i++) {
 	 			if (tmp[i]==index) {
@@ -8,9 +8,11 @@
 
 #include <algorithm>
 #include <cassert>
+#include <memory_resource>
 #include <set>
 #include <vector>
 
+#include "common/slab_pool.hpp"
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
 
@@ -79,18 +81,16 @@ class Graph {
     }
 
     /// Default destructor
-    ~Graph() {
-
-      // Since edges_ and nodes_ store pointers to structs on the heap,
-      // we need to free that memory.
+    /// 
+    /// The nodes, edges and incidence sets all live in a few large
+    /// pools (see the members below), so destruction frees a handful of
+    /// blocks instead of one allocation per node, edge and set entry.
+    /// 
+    ~Graph() = default;
 
-      for (size_type i = 0; i < num_nodes_; i++) {
-        delete nodes_[i];
-      }
-      for (size_type i = 0; i < num_edges_; i++) {
-        delete edges_[i];
-      }
-    }
+    // Nodes and edges are held by pointers into this Graph's pools.
+    Graph(const Graph&) = delete;
+    Graph& operator=(const Graph&) = delete;
 
     // NODES
 
@@ -163,13 +163,9 @@ class Graph {
      * @pre     Edges have been added to parent graph
      */
     size_type degree() const { // number of edges incident to a node
-      size_type nConnect = 0;
-      for (size_type ii = 0; ii = graph_->size(); ii++) {
-	if graph_->has_edge(index_,ii) {
-	    nConnect = nConnect + 1;
-	  }
-      }
-      return nConnect; //problem 3
+      // Every incident edge index is kept in the node's set, so its size
+      // is the degree; no need to test every other node.
+      return graph_->nodes_[index_]->incident_edges.size(); //problem 3
     }
 
     /**
@@ -260,7 +256,7 @@ class Graph {
       // Just add a new internal_node to the end of nodes_ and
       // increment num_nodes_ after assigning the new node the old
       // value of num_nodes_ for its index.
-    nodes_.push_back(new internal_node(position, nodeVal));
+    nodes_.push_back(node_pool_.create(position, nodeVal, &adjacency_arena_));
     return Node(this, num_nodes_++);
     }
 
@@ -408,9 +404,9 @@ class Graph {
       }
 
       // If edge does not exist yet, wire it up in internal structures.
-      edges_.push_back(new internal_edge(a.index(), b.index()));
-      nodes_[a.index()]->incident_edges->insert(num_edges_);
-      nodes_[b.index()]->incident_edges->insert(num_edges_);
+      edges_.push_back(edge_pool_.create(a.index(), b.index()));
+      nodes_[a.index()]->incident_edges.insert(num_edges_);
+      nodes_[b.index()]->incident_edges.insert(num_edges_);
       return Edge(this, num_edges_++);
     }
 
@@ -422,6 +418,11 @@ class Graph {
     void clear() {
       nodes_.clear();
       edges_.clear();
+      // Destroy the nodes (and their sets) before releasing the arena
+      // their sets were allocated from.
+      node_pool_.clear();
+      edge_pool_.clear();
+      adjacency_arena_.release();
       num_nodes_ = 0; num_edges_ = 0;
     }
 
@@ -674,14 +675,14 @@ class Graph {
     size_type find_edge(const Node &a, const Node &b) const {
 
       // Get the indices of the edges incident to a.
-      std::set<size_type> *a_edges = nodes_[a.index()]->incident_edges;
+      const incidence_set *a_edges = &nodes_[a.index()]->incident_edges;
 
       // Now search these indices to find the edge whose other endpoint
       // is b using the std::find_if function with a custom predicate.
       // References for find_if with custom predicates:
       //   http://www.cplusplus.com/reference/algorithm/find_if/
       //   https://stackoverflow.com/q/6679096/902812
-      std::set<size_type>::iterator it = std::find_if(
+      incidence_set::const_iterator it = std::find_if(
         a_edges->begin(), a_edges->end(), 
 
         // Use a lambda function for the custom predicate so that we
@@ -711,28 +712,26 @@ class Graph {
     // bullet of this section from Wikipedia on adjacency lists:
     // https://en.wikipedia.org/wiki/Adjacency_list#Implementation_details
 
+    // Set of incident edge indices, allocated from adjacency_arena_.
+    using incidence_set = std::pmr::set<size_type>;
+
     // Internal struct to bundle node data (Point) with a set of
     // indices of edges to which it's connected.
   template <typename V>
     struct internal_node {
 
-      // Constructor makes pointer to set that's stored on the heap.
-      internal_node(const Point &pos, V &nVal)
-	: position(pos), nodeVal(nVal), incident_edges(new std::set<size_type>()) {
-      }
-
-      // Free the heap memory.
-      ~internal_node() {
-        delete incident_edges;
+      // Constructor makes an empty set whose tree nodes are carved out
+      // of the Graph's adjacency arena.
+      internal_node(const Point &pos, V &nVal, std::pmr::memory_resource *arena)
+	: position(pos), nodeVal(nVal), incident_edges(arena) {
       }
 
       // Store node data.
       const Point position;
       V  nodeVal;
 
-      // Store a pointer to the set instead of the entire set in order
-      // to keep the amount of memory on the stack small.
-      std::set<size_type> *incident_edges; 
+      // Indices of the edges incident to this node.
+      incidence_set incident_edges; 
     };
 
     // Internal struct to store an edge.
@@ -751,6 +750,15 @@ class Graph {
     // to avoid casting results from nodes_.size() or edges_.size().
     size_type num_nodes_, num_edges_;
 
+    // Backing storage. Every incidence set allocates its tree nodes from
+    // adjacency_arena_, which hands out memory from a few geometrically
+    // growing blocks and frees them all at once. The internal_node and
+    // internal_edge structs themselves are packed into slabs. The arena is
+    // declared first so it outlives the sets that point into it.
+    std::pmr::monotonic_buffer_resource adjacency_arena_;
+    SlabPool<internal_node> node_pool_;
+    SlabPool<internal_edge> edge_pool_;
+
     // Positions associated with each node (access by index).
     std::vector<internal_node *> nodes_;
     std::vector<internal_edge *> edges_;
@@ -445,10 +445,10 @@ class Graph {
      *
      * @pre Graph needs to contain edge at the given index @i.
      *
-     * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+     * Complexity: O(1).
      */
     Edge edge(size_type i) const {
-        return *std::next(edge_begin(), i);
+        return *EdgeIterator(i, this);
     }
     
     /** Checking if an edge exists between two nodes.
@@ -508,7 +508,7 @@ class Graph {
     
     /** Remove all vertices and edges from this graph.
      *
-     * clear() empties vertices and adjacencyList.
+     * clear() empties vertices, edges and adjacencyList.
      * @return an object newEdge starting @a a and ending @a b.
      *
      * @post num_nodes() and num)edge() becomes 0.
@@ -516,9 +516,11 @@ class Graph {
      * Invalidates all outstanding Node and Edge objects.
      */
     void clear() {
-        // Removes all elements of the vertices and adjacencyList.
+        // Removes all elements of the vertices, edges and adjacencyList.
         verticesVec.clear();
+        edgeVec.clear();
         adjacencyList.clear();
+        total_edges = 0;
     }
     
     //
@@ -724,8 +726,9 @@ class Graph {
         Edge operator*() const {
             Edge connection;
             connection.gridEdge = edgeIterGrid;
-            connection.edgeHead = (*iterHead).index();
-            connection.edgeTail = (*iterTail).node2().index();
+            connection.edgeHead = edgeIterGrid -> edgeVec[edgePos].head;
+            connection.edgeTail = edgeIterGrid -> edgeVec[edgePos].tail;
+            connection.edgeIdx = edgePos;
             
             return connection;
         }
@@ -739,8 +742,7 @@ class Graph {
          * i.e., iterator != graph.edge_end().
          */
         EdgeIterator& operator++() {
-            ++iterTail;
-            IncIterFun();
+            ++edgePos;
             return *this;
         }
         
@@ -752,8 +754,7 @@ class Graph {
          * @return False otherwise.
          */
         bool operator==(const EdgeIterator& e) const {
-            return ( e.iterHead == iterHead && e.iterTail ==iterTail &&
-                     e.edgeIterGrid == e.edgeIterGrid);
+            return ( e.edgePos == edgePos && e.edgeIterGrid == edgeIterGrid);
         }
         
         /** Checks if EdgeIterator and the one provided are equal.
@@ -764,45 +765,19 @@ class Graph {
          * @return False otherwise.
          */
         bool operator!=(const EdgeIterator& e) const {
-            return !( e.iterHead == iterHead && e.iterTail == iterTail &&
-                      e.edgeIterGrid == e.edgeIterGrid);
+            return !(*this == e);
         }
         
     private:
         friend class Graph;
         
-        NodeIterator iterHead = (*edgeIterGrid).node_begin();
-        IncidentIterator iterTail = (*iterHead).edge_begin();
+        // Walks edgeVec, which holds every edge exactly once, so no
+        // incidence has to be skipped.
+        size_type edgePos; // Idx of the current edge in edgeVec.
         Graph* edgeIterGrid;
         
-        /* Iterates over incident edges. */
-        void IncIterFun() {
-            // Executes if iterHead is not poiting to the last node.
-            while (iterHead != (*edgeIterGrid).node_end()) {
-                
-                // Executes if iterTail is not pointing to the end of incidents.
-                while (iterTail != (*iterHead).edge_end()) {
-                    // Forces global ordering of edges to prevent their duplicates.
-                    if ((*iterHead) < (*iterTail).node2()) ++iterTail;
-                    else break;
-                }
-                
-                // Updates location.
-                if (iterTail == (*iterHead).edge_end()) {
-                    ++iterHead;
-                    iterTail = (*iterHead).edge_begin();
-                }
-                else break;
-            }
-            
-            if (iterHead == (*edgeIterGrid).node_end() ) {
-                iterHead = (*edgeIterGrid).node_begin();
-                iterTail = (*iterHead).edge_begin();
-            }
-        }
-        
-        EdgeIterator(NodeIterator n1, IncidentIterator i1, const Graph* g) :
-        iterHead(n1), iterTail(i1), edgeIterGrid(const_cast<Graph *>(g)) { IncIterFun();}
+        EdgeIterator(size_type e1, const Graph* g) :
+        edgePos(e1), edgeIterGrid(const_cast<Graph *>(g)) {}
     };
     
     /** Obtains a pointer to the first edge in a graph.
@@ -811,7 +786,7 @@ class Graph {
      * @return an edge iterator.
      */
     edge_iterator edge_begin() const {
-        return EdgeIterator(node_begin(), (*node_begin()).edge_begin(), this);
+        return EdgeIterator(0, this);
     }
     
     /** Obtains a pointer to the last edge in a graph.
@@ -820,7 +795,7 @@ class Graph {
      * @return an edge iterator.
      */
     edge_iterator edge_end() const {
-        return EdgeIterator(node_end(), (*node_begin()).edge_end(), this);
+        return EdgeIterator(num_edges(), this);
     }
     
 private:
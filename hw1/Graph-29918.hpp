@@ -7,10 +7,10 @@
 
 #include <algorithm>
 #include <cassert>
-#include <set>
 #include <vector>
 #include <cassert>
 
+#include "common/small_vector.hpp"
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
 
@@ -59,14 +59,14 @@ class Graph {
     // analagous with Slaven's examples from Lecture 3. In particular,
     // my member variables are now of type std::vector<Node> and
     // std::vector<Edge>. Additionally, the incident_edges_ member of
-    // the InternalEdge struct is also a container of proxy objects: an
-    // std::set<Edge>.
+    // the InternalEdge struct is also a container of proxy objects: a
+    // SmallVector<Edge, 8>.
     //
     // This implementation allowed me to come up with a very sly
     // implementation of NodeIterator, EdgeIterator, and
     // IncidentIterator: I simply type alias'ed them to
     // std::vector<Node>::iterator, std::vector<Edge>::iterator, and
-    // std::set<Edge>::iterator respectively.
+    // SmallVector<Edge, 8>::const_iterator respectively.
     //
     // I personally think this is a cleaner implementation. However, in
     // order to assuage any concerns that I haven't actaully
@@ -94,7 +94,10 @@ class Graph {
 
     /// Type of incident iterators, which iterate incident edges to a node.
     /// Synonym for IncidentIterator
-    using IncidentIterator = typename std::set<Edge>::iterator;
+    /// 
+    /// This is SmallVector<Edge, max_inline_degree>::const_iterator.
+    /// It is spelled out here because Edge is still incomplete.
+    using IncidentIterator = const Edge *;
     using incident_iterator = IncidentIterator;
 
     /// Type of indexes and sizes.
@@ -112,14 +115,17 @@ class Graph {
     /// Destroy the graph and free memory.
     ~Graph() {
 
-      // Since edges_ and nodes_ store pointers to structs on the heap,
-      // we need to free that memory.
-      nodes_->clear();
-      edges_->clear();
+      // The proxies in nodes_ and edges_ point to structs on the heap,
+      // which the graph owns through node_store_ and edge_store_.
+      release_internals();
       delete nodes_;
       delete edges_;
     }
 
+    /// The graph owns its internal structs, which copies would share.
+    Graph(const Graph &) = delete;
+    Graph &operator=(const Graph &) = delete;
+
 
     /// @class Graph::Node
     /// @brief Class representing the graph's nodes.
@@ -171,20 +177,20 @@ class Graph {
         /// Return the degree of the node by getting the number of
         /// edges incident to the node.
         size_type degree() const {
-          return node_->incident_edges_->size();
+          return node_->incident_edges_.size();
         }
 
         /// Return iterator pointing to first incident edge.
         IncidentIterator edge_begin() const {
-          // Since an InternalNode already contains a std::set<Edge> of
-          // incident Edges, we can just return an iterator to the
-          // beginning of that set.
-          return node_->incident_edges_->begin();
+          // Since an InternalNode already contains a list of incident
+          // Edges, we can just return an iterator to the beginning of
+          // that list.
+          return node_->incident_edges_.begin();
         }
 
         /// Return iterator to one past the last incident edge.
         IncidentIterator edge_end() const {
-          return node_->incident_edges_->end();
+          return node_->incident_edges_.end();
         }
 
         /// Test whether this node and @a n are equal.
@@ -221,8 +227,8 @@ class Graph {
         size_type index_;
 
         /// Private constructor.
-        Node(const Point &position, Value &value, size_type ind) 
-            : node_(new InternalNode(position, value)), index_(ind) {
+        Node(InternalNode *node, size_type ind)
+            : node_(node), index_(ind) {
         }
     };
 
@@ -247,9 +253,18 @@ class Graph {
     /// Complexity: O(1) amortized operations.
     /// 
     Node &add_node(const Point &position, const Value &val = Value()) {
-      // Just add a new internal_node to the end of nodes_.
-      nodes_->push_back(Node(position, const_cast<Value &>(val), num_nodes()));
-      return (*nodes_)[num_nodes() - 1];
+      // Just add a new internal_node to the end of nodes_, reusing one
+      // left over from before a clear() if there is one.
+      size_type i = num_nodes();
+      if (i < node_store_.size()) {
+        InternalNode *reused = node_store_[i];
+        reused->pos_ = position;
+        reused->val_ = val;
+      } else {
+        node_store_.push_back(new InternalNode(position, val));
+      }
+      nodes_->push_back(Node(node_store_[i], i));
+      return (*nodes_)[i];
     }
 
     /// Determine if a Node belongs to this Graph
@@ -309,7 +324,7 @@ class Graph {
         /// 
         bool operator==(const Edge &e) const {
           // Can simply compare the addresses of the 'real' objects.
-          return edge_ = e.edge_;
+          return edge_ == e.edge_;
         }
 
         /// Test whether this edge is less than @a e in a global order.
@@ -333,8 +348,8 @@ class Graph {
         size_type index_;
 
         /// Private constructor.
-        Edge(const Node &a, const Node &b, size_type ind)
-            : edge_(new InternalEdge(a, b)), index_(ind) {
+        Edge(InternalEdge *edge, size_type ind)
+            : edge_(edge), index_(ind) {
         }
     };
 
@@ -393,20 +408,42 @@ class Graph {
         return *it;
       }
 
-      edges_->push_back(Edge(a, b, num_edges()));
-      (*nodes_)[a.index()].node_->incident_edges_->insert((*edges_)[num_edges() - 1]);
-      (*nodes_)[b.index()].node_->incident_edges_->insert((*edges_)[num_edges() - 1]);
+      size_type k = num_edges();
+      if (k < edge_store_.size()) {
+        edge_store_[k]->one_ = a;
+        edge_store_[k]->two_ = b;
+      } else {
+        edge_store_.push_back(new InternalEdge(a, b));
+      }
+      edges_->push_back(Edge(edge_store_[k], k));
+      // find_edge() already ruled out a duplicate, so a plain append
+      // keeps each incidence list free of repeats.
+      (*nodes_)[a.index()].node_->incident_edges_.push_back((*edges_)[num_edges() - 1]);
+      (*nodes_)[b.index()].node_->incident_edges_.push_back((*edges_)[num_edges() - 1]);
       return (*edges_)[num_edges() - 1];
     }
 
     /// Remove all nodes and edges from this graph.
+    /// @param[in] keep_capacity Whether to keep the allocated storage
     /// @post num_nodes() == 0 && num_edges() == 0
     /// 
+    /// With @a keep_capacity, the internal node and edge structs, their
+    /// incidence lists and the proxy arrays are kept for the nodes and
+    /// edges added next, so rebuilding a graph of up to the old size does
+    /// not allocate. Otherwise they are all freed.
     /// Invalidates all outstanding Node and Edge objects.
     /// 
-    void clear() {
+    void clear(bool keep_capacity = true) {
       nodes_->clear();
       edges_->clear();
+      if (keep_capacity) {
+        for (InternalNode *n : node_store_)
+          n->incident_edges_.clear();
+      } else {
+        release_internals();
+        std::vector<Node>().swap(*nodes_);
+        std::vector<Edge>().swap(*edges_);
+      }
     }
 
     /// Returns iterator pointing to the first node in the graph.
@@ -431,6 +468,16 @@ class Graph {
 
   private:
 
+    // Free every internal struct, spares included.
+    void release_internals() {
+      for (InternalNode *n : node_store_)
+        delete n;
+      for (InternalEdge *e : edge_store_)
+        delete e;
+      std::vector<InternalNode *>().swap(node_store_);
+      std::vector<InternalEdge *>().swap(edge_store_);
+    }
+
     // Helper function to get an incident edge if it exists.
     // 
     // Searches through the edges incident to Node a for one whose
@@ -463,27 +510,27 @@ class Graph {
     // bullet of this section from Wikipedia on adjacency lists:
     // https://en.wikipedia.org/wiki/Adjacency_list#Implementation_details
 
-    // Internal struct to bundle node data (Point) with a set of
-    // indices of edges to which it's connected.
-    struct InternalNode {
+    // Number of incident Edges a node stores inline before its list
+    // spills to the heap. Interior nodes of a triangle mesh have degree
+    // ~6, so they never allocate.
+    static constexpr std::size_t max_inline_degree = 8;
 
-      // Constructor makes pointer to set that's stored on the heap.
-      InternalNode(const Point &pos, Value &val)
-          : pos_(pos), val_(val), incident_edges_(new std::set<Edge>()) {
-      }
+    // Internal struct to bundle node data (Point) with a list of
+    // the edges to which it's connected.
+    struct InternalNode {
 
-      // Free the heap memory.
-      ~InternalNode() {
-        delete incident_edges_;
+      InternalNode(const Point &pos, const Value &val)
+          : pos_(pos), val_(val), incident_edges_() {
       }
 
-      // Store node data.
-      const Point pos_;
+      // Store node data. Reset when the struct is reused after clear().
+      Point pos_;
       Value val_;
 
-      // Store a pointer to the set instead of the entire set in order
-      // to keep the amount of memory on the stack small.
-      std::set<Edge> *incident_edges_;
+      // The incident Edges live inside the node itself up to
+      // max_inline_degree of them, so walking them reads the node's own
+      // memory instead of chasing red-black tree pointers.
+      SmallVector<Edge, max_inline_degree> incident_edges_;
     };
 
     // Internal struct to store an edge.
@@ -494,13 +541,18 @@ class Graph {
       }
       
       // Keep pointers to node endpoints (as indices).
-      const Node one_;
-      const Node two_;
+      Node one_;
+      Node two_;
     };
     
     // Positions associated with each node (access by index).
     std::vector<Node> *nodes_;
     std::vector<Edge> *edges_;
+
+    // Every internal struct ever allocated, in index order. Entries past
+    // num_nodes() and num_edges() are spares, left by clear() for reuse.
+    std::vector<InternalNode *> node_store_;
+    std::vector<InternalEdge *> edge_store_;
 };
 
 #endif // CME212_GRAPH_HPP
@@ -846,9 +846,9 @@
     // These type definitions let us use STL's iterator_traits.
     using value_type        = Edge;                     // Element type
     using pointer           = Edge*;                    // Pointers to elements
-    using reference         = Edge&;                    // Reference to elements
+    using reference         = Edge;                     // Proxy, by value
     using difference_type   = std::ptrdiff_t;           // Signed difference
-    using iterator_category = std::input_iterator_tag;  // Weak Category, Proxy
+    using iterator_category = std::random_access_iterator_tag;
 
     /** Construct an invalid EdgeIterator. */
     EdgeIterator() {
@@ -888,6 +888,58 @@
       return this->graph_ == rhs.graph_ && this->ptrIdx_ == rhs.ptrIdx_; 
     }
 
+    /** Iterator ordering. Only meaningful for iterators of the same Graph.
+     * @return True if this iterator points before @a rhs.
+     */
+    bool operator<(const EdgeIterator& rhs) const {
+      return this->ptrIdx_ < rhs.ptrIdx_;
+    }
+
+    // Random access: the iterator is just an index into the edge vector,
+    // so it can jump and be split into independent sub-ranges.
+
+    /** Access the Edge @a n positions after this one. */
+    Edge operator[](difference_type n) const {
+      return *(*this + n);
+    }
+    EdgeIterator operator++(int) {
+      EdgeIterator tmp = *this;
+      ++ptrIdx_;
+      return tmp;
+    }
+    EdgeIterator& operator--() {
+      --ptrIdx_;
+      return *this;
+    }
+    EdgeIterator operator--(int) {
+      EdgeIterator tmp = *this;
+      --ptrIdx_;
+      return tmp;
+    }
+    EdgeIterator& operator+=(difference_type n) {
+      ptrIdx_ = size_type(ptrIdx_ + n);
+      return *this;
+    }
+    EdgeIterator& operator-=(difference_type n) {
+      ptrIdx_ = size_type(ptrIdx_ - n);
+      return *this;
+    }
+    EdgeIterator operator+(difference_type n) const {
+      EdgeIterator tmp = *this;
+      return tmp += n;
+    }
+    friend EdgeIterator operator+(difference_type n, const EdgeIterator& it) {
+      return it + n;
+    }
+    EdgeIterator operator-(difference_type n) const {
+      EdgeIterator tmp = *this;
+      return tmp -= n;
+    }
+    /** Number of Edges between @a rhs and this iterator. */
+    difference_type operator-(const EdgeIterator& rhs) const {
+      return difference_type(ptrIdx_) - difference_type(rhs.ptrIdx_);
+    }
+
    private:
     friend class Graph;
     // HW1 #5: YOUR CODE HERE
@@ -938,6 +990,30 @@
     return EdgeIterator{this,this->num_edges()};
   }
 
+  /** Split the Edges into @a k balanced, independent ranges.
+   * @pre @a k > 0
+   *
+   * @return @a k pairs [first, last) of Edge Iterators that together cover
+   *         edge_begin() to edge_end() exactly once, in order. Range sizes
+   *         differ by at most one, so each range can be handed to its own
+   *         thread (e.g. one per OpenMP thread).
+   */
+  std::vector<std::pair<edge_iterator, edge_iterator>>
+  edge_ranges(size_type k) const {
+    assert(k > 0);
+    std::vector<std::pair<edge_iterator, edge_iterator>> ranges;
+    ranges.reserve(k);
+    size_type chunk = this->num_edges() / k;
+    size_type extra = this->num_edges() % k;
+    size_type first = 0;
+    for (size_type i = 0; i < k; ++i) {
+      size_type last = first + chunk + (i < extra ? 1 : 0);
+      ranges.emplace_back(EdgeIterator{this, first}, EdgeIterator{this, last});
+      first = last;
+    }
+    return ranges;
+  }
+
  private:
 
   // HW0: YOUR CODE HERE
@@ -11,6 +11,7 @@
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
+#include "common/inline_adjacency.hpp"
 
 
 /** @class Graph
@@ -118,7 +119,7 @@ class Graph {
     /** Return this node's position. */
     const Point& position() const {
       // HW0: YOUR CODE HERE
-      return graph_->nodes_[node_idx_].first;
+      return graph_->adjacency_.payload(node_idx_);
     }
 
     /** Return this node's index, a number in the range [0, graph_size). */
@@ -140,7 +141,7 @@ class Graph {
     * Complexity: O(1).
     */
     node_value_type& value() {
-      return graph_->nodes_[node_idx_].second;
+      return graph_->values_[node_idx_];
     }
 
     /** Return this node's value without modifying it.
@@ -148,7 +149,7 @@ class Graph {
     * Complexity: O(1).
     */
     const node_value_type& value() const {
-      return graph_->nodes_[node_idx_].second;
+      return graph_->values_[node_idx_];
     }
 
     /** Return this node's degree.
@@ -156,7 +157,7 @@ class Graph {
     * Complexity: O(1).
     */
     size_type degree() const {
-      return graph_->adjacency_[node_idx_].size();
+      return graph_->adjacency_.degree(node_idx_);
     }
 
     /** Return an incident edge iterator pointing to the first incident edge.
@@ -240,10 +241,8 @@ class Graph {
    */
   Node add_node(const Point& position, const node_value_type& node_value = node_value_type()) {
     // HW0: YOUR CODE HERE
-    std::pair <Point, node_value_type> node_data (position, node_value);
-    nodes_.push_back(node_data);
-    std::vector<size_type> neighbors;
-    adjacency_.push_back(neighbors);
+    adjacency_.add_node(position);
+    values_.push_back(node_value);
     ++nb_nodes_;
     return Node(this, nb_nodes_ - 1);
   }
@@ -371,13 +370,7 @@ class Graph {
     // HW0: YOUR CODE HERE
     size_type idx_1 = a.index();
     size_type idx_2 = b.index();
-    std::vector<size_type> neighbors = adjacency_[idx_1];
-    for(size_type i=0 ; i < neighbors.size(); ++i){
-      if (neighbors[i] == idx_2){
-          return true;
-	}
-    }
-    return false;
+    return adjacency_.contains(idx_1, idx_2);
   }
 
   /** Add an edge to the graph, or return the current edge if it already exists.
@@ -401,8 +394,7 @@ class Graph {
         new_edge.node_1 = idx_1;
         new_edge.node_2 = idx_2;;
         edges_.push_back(new_edge);
-	adjacency_[idx_1].push_back(idx_2);
-	adjacency_[idx_2].push_back(idx_1);
+	adjacency_.insert(idx_1, idx_2);
 	nb_edges_++;
     }
     return Edge(this, idx_1, idx_2);
@@ -415,7 +407,7 @@ class Graph {
    */
   void clear() {
     // HW0: YOUR CODE HERE
-    nodes_.clear();
+    values_.clear();
     edges_.clear();
     adjacency_.clear();
     nb_nodes_ = 0;
@@ -539,12 +531,12 @@ class Graph {
     // bool operator==(const IncidentIterator&) const
 
     /** Return the edge that the incident iterator points to.
-    * @pre 0 <= incident_counter_ < graph_->adjacency_[node_idx_].size()
+    * @pre 0 <= incident_counter_ < graph_->adjacency_.degree(node_idx_)
     *
     * Complexity: O(1).
     */
     Edge operator*() const {
-      size_type incident_node_idx_ = graph_->adjacency_[node_idx_][incident_counter_];
+      size_type incident_node_idx_ = graph_->adjacency_.neighbor(node_idx_, incident_counter_);
       return Edge(graph_, node_idx_, incident_node_idx_);
     }
 
@@ -606,12 +598,12 @@ class Graph {
     // bool operator==(const EdgeIterator&) const
 
     /** Return the edge that the edge iterator points to.
-    * @pre 0 <= node_idx_ < graph_->num_nodes() and 0 <= incident_counter_ < graph->adjacency_[node_idx_].size()
+    * @pre 0 <= node_idx_ < graph_->num_nodes() and 0 <= incident_counter_ < graph->adjacency_.degree(node_idx_)
     *
     * Complexity: O(1).
     */
     Edge operator*() const {
-      size_type incident_node_idx_ = graph_->adjacency_[node_idx_][incident_counter_];
+      size_type incident_node_idx_ = graph_->adjacency_.neighbor(node_idx_, incident_counter_);
       return Edge(graph_, node_idx_, incident_node_idx_);
     }
 
@@ -653,8 +645,8 @@ class Graph {
     */
     void get_next_valid_edge() {
       while (node_idx_ < graph_->adjacency_.size()) {
-        while (incident_counter_ < graph_->adjacency_[node_idx_].size()) {
-          size_type next_node_idx_ = graph_->adjacency_[node_idx_][incident_counter_];
+        while (incident_counter_ < graph_->adjacency_.degree(node_idx_)) {
+          size_type next_node_idx_ = graph_->adjacency_.neighbor(node_idx_, incident_counter_);
           if (node_idx_ < next_node_idx_) {
             return;
           }
@@ -700,9 +692,10 @@ class Graph {
   // HW0: YOUR CODE HERE
   // Use this space for your Graph class's internals:
   // helper functions, data members, and so forth.
-  std::vector<std::pair<Point, node_value_type>> nodes_;
+  // Each node's position and first 8 neighbors share one cache line
+  InlineAdjacency<Point, size_type> adjacency_;
+  std::vector<node_value_type> values_;
   std::vector<node_pair> edges_;
-  std::vector<std::vector<size_type>> adjacency_;
   size_type nb_nodes_;
   size_type nb_edges_;
 };
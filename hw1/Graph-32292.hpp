@@ -12,6 +12,7 @@
 
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
+#include "common/row_view.hpp"
 
 
 /** @class Graph
@@ -69,6 +70,20 @@ class Graph {
       Graph::num_edges(), and argument type of Graph::node(size_type) */
   using size_type = unsigned;
 
+  /** Maps an edge index from a node's adjacency row to the neighbor across
+   *  that edge. Used by Node::neighbors(). */
+  struct neighbor_of {
+    const Graph* graph;
+    size_type uid;
+    Node operator()(size_type edge_idx) const {
+      const std::vector<size_type>& ends = graph->edges_[edge_idx];
+      return Node(graph, ends[0] == uid ? ends[1] : ends[0]);
+    }
+  };
+
+  /** Zero-copy range of a node's neighbors, see Node::neighbors(). */
+  using neighbor_range = RowView<size_type, neighbor_of>;
+
   /** Type of node value. */
   using node_value_type = V;
 
@@ -200,6 +215,23 @@ class Graph {
       return IncidentIterator(graph_, uid_, degree());
     }
 
+    /** Return the neighbors of the node as a zero-copy range.
+    * @return  A random access range of Node objects, one per incident edge,
+    *          in the same order as edge_begin()..edge_end().
+    *
+    * @pre     uid_ < graph_->size().
+    *
+    * The range reads the adjacency row in place and is invalidated by
+    * add_edge() on this node.
+    *
+    * Complexity: O(1).
+    */
+    neighbor_range neighbors() const {
+      const std::vector<size_type>& row = graph_->adj_edges_.at(uid_);
+      return neighbor_range(row.data(), row.data() + row.size(),
+                            neighbor_of{graph_, uid_});
+    }
+
     /** Test whether this node and @a n are equal.
      *
      * Equal nodes have the same graph and the same index.
@@ -389,7 +421,7 @@ class Graph {
     // HW0: YOUR CODE HERE
     if (has_node(a) && has_node(b)) {
       Edge e;
-      std::vector<size_type> adj_a = adj_edges_.at(a.index());
+      const std::vector<size_type>& adj_a = adj_edges_.at(a.index());
       for (size_type i=0; i<adj_a.size(); i++) {
         e = edge(adj_a[i]);
         if (((a == e.node1()) && (b == e.node2())) || ((a == e.node2()) && (b == e.node1())))
@@ -415,7 +447,7 @@ class Graph {
     // HW0: YOUR CODE HERE
     if (has_node(a) && has_node(b) && !(a == b)) {
       Edge e;
-      std::vector<size_type> adj_a = adj_edges_.at(a.index());
+      const std::vector<size_type>& adj_a = adj_edges_.at(a.index());
       for (size_type i=0; i<adj_a.size(); i++) {
         e = edge(adj_a[i]);
         if (((a == e.node1()) && (b == e.node2())) || ((a == e.node2()) && (b == e.node1())))
@@ -8,8 +8,9 @@
 #include <algorithm>
 #include <vector>
 #include <cassert>
-#include <unordered_map>
+#include <utility>
 
+#include "common/edge_index.hpp"
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
 
@@ -58,10 +59,19 @@ public:
   // (As with all the "YOUR CODE HERE" markings, you may not actually NEED
   // code here. Just use the space if you need it.)
 
-  std::unordered_map<size_type,Point>* nodes_;
-  std::unordered_map<size_type,node_value_type>* node_values_;
-  std::unordered_map<size_type,std::pair<size_type, size_type>>* edges_list_;
-  std::unordered_map<size_type,std::unordered_map<size_type, size_type>*>* rev_edges_list_;
+  // Node i has position nodes_[i] and value node_values_[i]
+  std::vector<Point> nodes_;
+  std::vector<node_value_type> node_values_;
+  // Row of the adjacency list of one node: (neighbor id, edge id) pairs
+  using incidence_list = std::vector<std::pair<size_type, size_type>>;
+
+  // Edge i connects edges_list_[i].first < edges_list_[i].second
+  std::vector<std::pair<size_type, size_type>> edges_list_;
+  // rev_edges_list_[n] lists the edges incident to node n, for iteration.
+  // Rows past num_nodes() are empty spares kept by clear() for reuse.
+  std::vector<incidence_list> rev_edges_list_;
+  // Packed-key table from a pair of node ids to the edge id, for lookups
+  EdgeIndex<size_type> edge_index_;
 public:
   //
   // PUBLIC TYPE DEFINITIONS
@@ -91,26 +101,76 @@ public:
   Graph() {
     /**
     * General remarks on the datastructure:
-    * We use unordered maps to store the values, as it is more scalable than a vector.
+    * Node positions and values are stored in vectors indexed by node id.
     * For the sake of simplicity, we store the edges as an unordered map of
     * unordered maps, corresponding to an adjacency matrix, which allows an easy
     * iteration. However, we also keep a list of all edges as pairs of indexes.
     * This allows to quickly find the edge having a given index, and to
     * quickly iterate over the edges. Since we do not have space constraints in the subject,
     * I have chosen to keep this implementation until there are additional constraints.
+    *
+    * The edge structures are stored by value: the pairs in a vector indexed
+    * by edge id, one adjacency row per node in a vector, and a flat
+    * EdgeIndex for has_edge(), so that a lookup is one hash probe into one
+    * array instead of two hash lookups through two separately allocated maps.
+    * The node arrays are members too, so a moved graph just hands its tables
+    * over, and clear() keeps all of them allocated for the next graph.
     */
-
-    // Nodes
-    node_values_ = new std::unordered_map<size_type,node_value_type> ();
-    nodes_ = new std::unordered_map<size_type,Point>();
-    // Edges
-    edges_list_ = new std::unordered_map<size_type,std::pair<size_type, size_type>>();
-    rev_edges_list_ = new std::unordered_map<size_type,std::unordered_map<size_type, size_type>*>;
   }
 
   /** Default destructor */
   ~Graph() = default;
 
+  /** Copy constructor and copy assignment, copying every node and edge. */
+  Graph(const Graph&) = default;
+  Graph& operator=(const Graph&) = default;
+
+  /** Move constructor: take over the nodes and edges of @a other.
+   * @post *this has the nodes and edges @a other had, with the same indices,
+   *       and @a other is empty
+   *
+   * The maps and arrays are handed over, not copied. Nodes and edges only
+   * ever refer to each other by index, so nothing needs fixing up, but the
+   * Node and Edge objects of @a other keep pointing at @a other.
+   *
+   * Complexity: O(1).
+   */
+  Graph(Graph&& other) noexcept : Graph() {
+    swap(other);
+  }
+
+  /** Move assignment: replace this graph by the contents of @a other and
+   * leave @a other empty.
+   *
+   * Complexity: O(1) plus freeing this graph's old contents.
+   */
+  Graph& operator=(Graph&& other) noexcept {
+    if (this != &other) {
+      Graph taken(std::move(other));
+      swap(taken);
+    }
+    return *this;
+  }
+
+  /** Exchange the contents of this graph and @a other.
+   *
+   * Node and Edge objects keep pointing at the graph they came from.
+   *
+   * Complexity: O(1).
+   */
+  void swap(Graph& other) noexcept {
+    nodes_.swap(other.nodes_);
+    node_values_.swap(other.node_values_);
+    edges_list_.swap(other.edges_list_);
+    rev_edges_list_.swap(other.rev_edges_list_);
+    std::swap(edge_index_, other.edge_index_);
+  }
+
+  /** Exchange the contents of @a a and @a b, as a.swap(b). */
+  friend void swap(Graph& a, Graph& b) noexcept {
+    a.swap(b);
+  }
+
   //
   // NODES
   //
@@ -144,7 +204,7 @@ public:
 
     /** Return this node's position. */
     const Point& position() const {
-      Point& point = (*(graph_->nodes_))[uid_];
+      const Point& point = graph_->nodes_.at(uid_);
       return point;
     }
 
@@ -169,7 +229,8 @@ public:
      */
 
     node_value_type & value(){
-      node_value_type& node_value = (*(graph_->node_values_))[uid_];
+      //graph_ is const, the values it owns are not
+      node_value_type& node_value = const_cast<Graph*>(graph_)->node_values_.at(uid_);
       return node_value;
     }
 
@@ -180,37 +241,37 @@ public:
      * Constant version, cannot be used to change the value
      */
     const node_value_type & value() const{
-      const node_value_type& node_value = (*(graph_->node_values_))[uid_];
+      const node_value_type& node_value = graph_->node_values_.at(uid_);
       return node_value;
     }
 
     /* * Return the degree of a node
      * @return number of neighbors of the node in the graph
      * @pre this is a valid node
-     * @pre the rev_edges_list_ map has been properly initialised, i.e each node
-     *      index has at least an empty map
+     * @pre the rev_edges_list_ has been properly initialised, i.e each node
+     *      index has at least an empty row
      *
      */
 
     size_type degree() const{
-      assert(graph_->rev_edges_list_->count(uid_)>0);
-      return (*(graph_->rev_edges_list_))[uid_]->size();
+      assert(uid_ < graph_->rev_edges_list_.size());
+      return graph_->rev_edges_list_[uid_].size();
     }
 
     /* * Return an iterator of neighbors
      * @return iterator of type incident_iterator, iterates over the neighbors of
      *         the node
      * @pre this is a valid node
-     * @pre the rev_edges_list_ map has been properly initialised, i.e each node
-     *      index has at least an empty map
+     * @pre the rev_edges_list_ has been properly initialised, i.e each node
+     *      index has at least an empty row
      * @post the iterator will iterate exactly over the neighbors
      *
      * To iterate over the neighbors, we simply initialize an iterator using the
-     * built- in iterators of the standard library over the unordered_maps
+     * built- in iterators of the standard library over the node's row
      */
     incident_iterator edge_begin() const{
-     assert (graph_->rev_edges_list_->count(uid_)>0);
-     std::unordered_map<size_type,size_type>::iterator it = (*(graph_->rev_edges_list_))[uid_]->begin();
+     assert (uid_ < graph_->rev_edges_list_.size());
+     typename incidence_list::const_iterator it = graph_->rev_edges_list_[uid_].begin();
      incident_iterator ni  = incident_iterator(graph_,it,uid_);
      return ni;
     }
@@ -218,16 +279,16 @@ public:
     /* * Return an iterator of neighbors
      * @return iterator correponding to the end of the neighbors
      * @pre this is a valid node
-     * @pre the rev_edges_list_ map has been properly initialised, i.e each node
-     *      index has at least an empty map
+     * @pre the rev_edges_list_ has been properly initialised, i.e each node
+     *      index has at least an empty row
      * @post the iterator is equal to the end of iteration over neighbors
      *
      * To iterate over the neighbors, we simply initialize an iterator using the
-     * built- in iterators of the standard library over the unordered_maps
+     * built- in iterators of the standard library over the node's row
      */
     incident_iterator edge_end() const{
-     assert (graph_->rev_edges_list_->count(uid_)>0);
-     std::unordered_map<size_type,size_type>::iterator it = (*(graph_->rev_edges_list_))[uid_]->end();
+     assert (uid_ < graph_->rev_edges_list_.size());
+     typename incidence_list::const_iterator it = graph_->rev_edges_list_[uid_].end();
      incident_iterator ni  = incident_iterator(graph_,it,uid_);
      return ni;
     }
@@ -279,7 +340,7 @@ public:
    */
   size_type size() const {
     // HW0: YOUR CODE HERE
-    return nodes_->size();
+    return nodes_.size();
   }
 
   /** Synonym for size(). */
@@ -298,11 +359,12 @@ public:
 
   Node add_node(const Point& position,const node_value_type& node_value = node_value_type()) {
     size_type old_size = size();
-    nodes_->insert({{old_size,position}});
-    node_values_->insert({{old_size,node_value}});
+    nodes_.push_back(position);
+    node_values_.push_back(node_value);
     Node new_node = Node(this,old_size);
-    std::unordered_map<size_type,size_type> * new_map = new std::unordered_map<size_type,size_type> ();
-    rev_edges_list_->insert({{old_size,new_map}});
+    //A row left over from before a clear() is reused, with its buffer
+    if (rev_edges_list_.size() == old_size)
+      rev_edges_list_.emplace_back();
 
     return new_node;
   }
@@ -402,7 +464,7 @@ public:
    * Since we have used an extra map for the edges, this is O(1) complexity
    */
   size_type num_edges() const {
-    return edges_list_->size();
+    return edges_list_.size();
   }
 
   /** Return the edge with index @a i.
@@ -413,7 +475,7 @@ public:
    * Since we have used an extra map for the edges, this is O(1) complexity
    */
   Edge edge(size_type i) const{
-    std::pair<size_type, size_type> edge_pair = (*edges_list_)[i];
+    std::pair<size_type, size_type> edge_pair = edges_list_[i];
     const Edge result_edge = Edge(this,i,edge_pair.first,edge_pair.second);
     return result_edge;
   }
@@ -423,16 +485,11 @@ public:
    * @return True if for some @a i, edge(@a i) connects @a a and @a b.
    *
    * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
-   * We simply have to perform a lookup in the adjacency table, using the nodes
-   * indexes
+   * We simply have to perform a lookup in the edge index, using the nodes
+   * indexes. This is O(1) expected and usually touches one cache line.
    */
   bool has_edge(const Node& a, const Node& b) const {
-    size_type min_idx,max_idx;
-    min_idx = (a.uid_<b.uid_)?a.uid_:b.uid_;
-    max_idx = (a.uid_>=b.uid_)?a.uid_:b.uid_;
-    return (rev_edges_list_->count(min_idx)>0)&&((*rev_edges_list_)[min_idx]->count(max_idx) >0);
-
-
+    return edge_index_.contains(a.uid_, b.uid_);
   }
 
   /** Add an edge to the graph, or return the current edge if it already exists.
@@ -452,46 +509,53 @@ public:
     size_type min_idx,max_idx;
     min_idx = (a.uid_<b.uid_)?a.uid_:b.uid_;
     max_idx = (a.uid_>=b.uid_)?a.uid_:b.uid_;
-    if (has_edge(a,b)){
+    //Compute the new index
+    const size_type old_sz = num_edges();
+    //A single probe either finds the existing edge or claims its slot
+    std::pair<size_type, bool> found = edge_index_.insert(min_idx, max_idx, old_sz);
+    if (!found.second){
      // If we actually have an edge, we just return it
      // To do so, we can use the edge method, that has a constant cost due to
-     // the storage of an additional map of pairs. We can retrieve the index of
-     // the existing edge in constant time
-      return edge((*(*rev_edges_list_)[min_idx])[max_idx]);
+     // the storage of the edge pairs. The index gave us the existing edge's id
+      return edge(found.first);
     }
     else{
-     //Compute the new index
-      const size_type old_sz = num_edges();
-      const std::pair<size_type, size_type> pair1  = std::pair<size_type, size_type>(min_idx,max_idx);
-
-      //Insert in pairs map
-      edges_list_->insert({{old_sz, pair1}});
+      //Insert in pairs list
+      edges_list_.push_back(std::pair<size_type, size_type>(min_idx,max_idx));
       //We check that the adjacency lists are properly built
-      assert (rev_edges_list_->count(min_idx));
-      assert (rev_edges_list_->count(max_idx));
-
-      assert (!((*rev_edges_list_)[min_idx]->count(max_idx)));
-      assert (!((*rev_edges_list_)[max_idx]->count(min_idx)));
+      assert (min_idx < rev_edges_list_.size());
+      assert (max_idx < rev_edges_list_.size());
 
       //We add the new edge
-      (*rev_edges_list_)[min_idx]->insert({{max_idx,old_sz}});
-      (*rev_edges_list_)[max_idx]->insert({{min_idx,old_sz}});
+      rev_edges_list_[min_idx].push_back({max_idx,old_sz});
+      rev_edges_list_[max_idx].push_back({min_idx,old_sz});
       //this method has O(1) cost, hence we can use it to return the result
      return edge(old_sz);
   }
 }
 
   /** Remove all nodes and edges from this graph.
+   * @param[in] keep_capacity  Whether to keep the allocated storage
    * @post num_nodes() == 0 && num_edges() == 0
    *
+   * With @a keep_capacity, every array, adjacency row and the edge index
+   * keep their buffers, so rebuilding a graph of up to the old size does
+   * not allocate. Otherwise all storage is freed.
    * Invalidates all outstanding Node and Edge objects.
+   *
+   * Complexity: O(old num_nodes()) plus the edge index table size.
    */
-  void clear() {
-    //destroy items
-    nodes_->clear();
-    edges_list_->clear();
-    rev_edges_list_->clear();
-    node_values_->clear();
+  void clear(bool keep_capacity = true) {
+    if (!keep_capacity) {
+      Graph().swap(*this);
+      return;
+    }
+    nodes_.clear();
+    node_values_.clear();
+    edges_list_.clear();
+    for (incidence_list& row : rev_edges_list_)
+      row.clear();
+    edge_index_.clear();
   }
 
   //
@@ -602,10 +666,9 @@ public:
    * @brief Iterator class for edges incident to a node. A forward iterator.
    *
    * To implement the IncidentIterator class, we use the fact that we have stored
-   * our edges as an adjacency matrix encoded as a map of maps. As a result, the
+   * our edges as an adjacency list with one row per node. As a result, the
    * iteration over the neighbors of a given node is simply the iteration over
-   * the unordered map at this particular index, i.e over a row of the adjacency
-   * list
+   * the row at this particular index
    * We can therefore use built-in iterators, and store the built in iterator
    * ove the neighbors, the id of the node over whose neighbors we iterate, and
    * a pointer to the graph
@@ -622,7 +685,7 @@ public:
     /** Construct an invalid IncidentIterator. */
     IncidentIterator() {
       graph_ = nullptr;
-      it = nullptr;
+      it = typename incidence_list::const_iterator();
       source_node_id = size_type(-1);
     }
 
@@ -635,7 +698,7 @@ public:
 
     /* * Access to the item
     * @return the current iteration item
-    * Given that the iterator over the unordered map give the edge id and the id
+    * Given that the iterator over the row gives the edge id and the id
     * of the neighbor, and that our structure stores the id of the source node,
     * we simply have to build the appropriate Edge object and return it
     *
@@ -672,11 +735,11 @@ public:
    private:
     friend class Graph;
     const Graph * graph_;
-    std::unordered_map<size_type,size_type>::iterator it;
+    typename incidence_list::const_iterator it;
     size_type source_node_id;
 
     /* *Valid constructor for Incident iterators  */
-    IncidentIterator(const Graph * graph,std::unordered_map<size_type,size_type>::iterator ite,size_type source_node_ide){
+    IncidentIterator(const Graph * graph,typename incidence_list::const_iterator ite,size_type source_node_ide){
       graph_ = graph;
       it = ite;
       source_node_id = source_node_ide;
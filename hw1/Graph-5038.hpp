@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <vector>
 #include <cassert>
+#include "common/adjacency_storage.hpp"
 #include "CME212/Util.hpp"
 #include "CME212/Point.hpp"
 
@@ -22,9 +23,19 @@ using namespace std;
  * @brief A template for 3D undirected graphs.
  * Users can add and retrieve nodes and edges. Edges are unique (there is at
  * most one edge between any pair of distinct nodes).
+ *
+ * @tparam V        Type of the value stored at each node.
+ * @tparam Storage  Adjacency storage policy (common/adjacency_storage.hpp).
+ *                  list_adjacency keeps rows in insertion order.
+ *                  sorted_adjacency keeps them sorted by neighbor index so
+ *                  has_edge() can binary search them. dense_adjacency uses
+ *                  an N x N bit matrix, for small dense graphs: has_edge()
+ *                  is one bit test. With either of the last two, incident
+ *                  edges are visited in neighbor order rather than insertion
+ *                  order.
  */
 
-template<typename V>
+template<typename V, typename Storage = list_adjacency>
 
 class Graph {
 
@@ -39,7 +50,7 @@ private:
     struct edge_struct;
     struct node_struct;
     vector<node_struct> nodes;
-    vector<vector<size_type>> adjacency_list;
+    typename Storage::template storage<size_type> adjacency_;
     vector<edge_struct> edge_list;
 
 public:
@@ -75,7 +86,7 @@ public:
 
 
     /** Construct an empty graph. */
-    Graph() : nodes(), adjacency_list(), edge_list() {
+    Graph() : nodes(), adjacency_(), edge_list() {
     }
 
     /** Default destructor */
@@ -151,8 +162,7 @@ public:
          * @return @a deg of type size_type
          */
         size_type degree() const {
-            size_type deg = static_cast<size_type>(graph_->adjacency_list[uid_].size());
-            return deg;
+            return graph_->adjacency_.degree(uid_);
         }
 
         /**
@@ -162,7 +172,7 @@ public:
          * @return  @a IIter object of type incident_iterator
          */
         incident_iterator edge_begin() const {
-            incident_iterator IIter(uid_, 0, const_cast<Graph *>(graph_));
+            incident_iterator IIter(uid_, graph_->adjacency_.begin(uid_), const_cast<Graph *>(graph_));
             return IIter;
         }
 
@@ -174,7 +184,7 @@ public:
          * @return  @a IIter object of type incident_iterator
          */
         incident_iterator edge_end() const {
-            incident_iterator IIter(uid_, degree(), const_cast<Graph *>(graph_));
+            incident_iterator IIter(uid_, graph_->adjacency_.end(uid_), const_cast<Graph *>(graph_));
             return IIter;
         }
 
@@ -244,12 +254,12 @@ public:
         new_node.idx =  static_cast<size_type>(nodes.size(); */
         node_struct new_node{
                 .point = position,
-                .val = a,
-                .idx =  static_cast<size_type>(nodes.size())
+                .idx =  static_cast<size_type>(nodes.size()),
+                .val = a
         };
         nodes.emplace_back(new_node);
         /*DEBUG_MSG("Adding with index " << nodes.size() - 1);*/
-        adjacency_list.emplace_back(vector<size_type>());
+        adjacency_.add_node();
         return Node(this, static_cast<size_type>(nodes.size() - 1));
     }
 
@@ -369,15 +379,11 @@ public:
      * @pre @a a and @a b are valid nodes of this graph
      * @return True if for some @a i, edge(@a i) connects @a a and @a b.
      *
-     * Complexity: No more than O(num_nodes() + num_edges()), hopefully less
+     * Complexity: O(a.degree()), O(log a.degree()) with sorted_adjacency,
+     * O(1) with dense_adjacency
      */
     bool has_edge(const Node &a, const Node &b) const {
-        for (size_type i = 0; i < adjacency_list[a.uid_].size(); ++i) {
-            if (b.uid_ == adjacency_list[a.uid_][i]) {
-                return true;
-            }
-        }
-        return false;
+        return adjacency_.contains(a.uid_, b.uid_);
     }
 
     /** Add an edge to the graph, or return the current edge if it already exists.
@@ -398,8 +404,7 @@ public:
             return Edge(this, a.uid_, b.uid_);
         }
         n_edges += 1;
-        adjacency_list[a.uid_].push_back(b.uid_);
-        adjacency_list[b.uid_].push_back(a.uid_);
+        adjacency_.insert(a.uid_, b.uid_);
         edge_struct new_edge{
                 .n1_id = a.uid_,
                 .n2_id = b.uid_
@@ -420,8 +425,9 @@ public:
      */
     void clear() {
         nodes.clear();
-        adjacency_list.clear();
+        adjacency_.clear();
         edge_list.clear();
+        n_edges = 0;
     }
 
     //
@@ -526,7 +532,7 @@ public:
          * @return An Edge object corresponding to the current position
          */
         Edge operator*() const {
-            return Edge(Igraph_, outer_id_, Igraph_->adjacency_list[outer_id_][inner_id_]);
+            return Edge(Igraph_, outer_id_, Igraph_->adjacency_.neighbor(outer_id_, inner_id_));
         }
 
 
@@ -536,7 +542,7 @@ public:
          * @return reference to the iterator after incrementing
          */
         IncidentIterator &operator++() {
-            inner_id_ = inner_id_ + 1;
+            inner_id_ = Igraph_->adjacency_.next(outer_id_, inner_id_);
             return *this;
 
         }
@@ -554,10 +560,12 @@ public:
     private:
         friend class Graph;
         size_type outer_id_;
-        size_type inner_id_;
+        // Cursor into the adjacency storage of node outer_id_
+        typename Storage::template storage<size_type>::cursor inner_id_;
         graph_type *Igraph_;
 
-        IncidentIterator(size_type outer_id, size_type inner_id, const graph_type *graph) : outer_id_(outer_id),
+        IncidentIterator(size_type outer_id, typename Storage::template storage<size_type>::cursor inner_id,
+                         const graph_type *graph) : outer_id_(outer_id),
                                                                                             inner_id_(inner_id),
                                                                                             Igraph_(const_cast<Graph *> (graph)) {
 
@@ -694,7 +702,6 @@ private:
         size_type n2_id;
     };
 
-
 };
 
 #endif // CME212_GRAPH_HPP